@@ -347,7 +347,30 @@ float _efficientnet_wd(void)
 #define _net_model _imagenet_resnet50_v1d
 #define _net_wd _resnet_wd
 
-static void train_imagenet(const int batch_size, ccv_cnnp_dataframe_t* const train_data, ccv_cnnp_dataframe_t* const test_data, ccv_array_t* const test_set)
+static void _categorized_from_record(void* const* const* const column_data, const int column_size, const int batch_size, void** const data, void* const context, ccv_nnc_stream_context_t* const stream_context)
+{
+	int i;
+	for (i = 0; i < batch_size; i++)
+	{
+		const ccv_cnnp_record_t* const record = (const ccv_cnnp_record_t*)column_data[0][i];
+		if (!data[i])
+			data[i] = ccmalloc(sizeof(ccv_categorized_t));
+		int c = 1;
+		// The meta is the line from the list, in the format of "label filename". If the record cannot be read, the
+		// image is filled with 0, label it as the first category.
+		if (record)
+			sscanf(record->meta, "%d", &c);
+		// imageNet's category class starts from 1, thus, minus 1 to get 0-index
+		((ccv_categorized_t*)data[i])->c = c - 1;
+	}
+}
+
+static void _categorized_deinit(void* const data, void* const context)
+{
+	ccfree(data);
+}
+
+static void train_imagenet(const int batch_size, ccv_cnnp_dataframe_t* const train_data, const int train_from_shards, ccv_cnnp_dataframe_t* const test_data, ccv_array_t* const test_set)
 {
 	// Prepare model.
 	ccv_cnnp_model_t* const imagenet = _net_model();
@@ -361,7 +384,8 @@ static void train_imagenet(const int batch_size, ccv_cnnp_dataframe_t* const tra
 	ccv_cnnp_model_set_workspace_size(imagenet, 1llu * 1024 * 1024 * 1024);
 	// ccv_cnnp_model_set_memory_compression(imagenet, 1);
 	// Prepare training data.
-	const int read_image_idx = ccv_cnnp_dataframe_read_image(train_data, 0, offsetof(ccv_categorized_t, file) + offsetof(ccv_file_info_t, filename), 0);
+	const int read_image_idx = train_from_shards ? ccv_cnnp_dataframe_decode_image(train_data, 0, 0) : ccv_cnnp_dataframe_read_image(train_data, 0, offsetof(ccv_categorized_t, file) + offsetof(ccv_file_info_t, filename), 0);
+	const int categorized_idx = train_from_shards ? ccv_cnnp_dataframe_map(train_data, _categorized_from_record, 0, _categorized_deinit, COLUMN_ID_LIST(0), 0, 0, 0) : 0;
 	ccv_cnnp_random_jitter_t random_jitter = {
 		.brightness = 0.4,
 		.contrast = 0.4,
@@ -386,14 +410,15 @@ static void train_imagenet(const int batch_size, ccv_cnnp_dataframe_t* const tra
 			.rows = 224,
 		},
 	};
-	const int image_jitter_idx = ccv_cnnp_dataframe_image_random_jitter(train_data, read_image_idx, CCV_32F, random_jitter, 0);
-	ccv_nnc_tensor_param_t fp16_params = CPU_TENSOR_NHWC(TRAIN_DT, 224, 224, 3);
-	const int image_jitter_in_idx = ccv_cnnp_dataframe_make_tuple(train_data, COLUMN_ID_LIST(image_jitter_idx), 0);
-	const int image_jitter_out_fp16_idx = ccv_cnnp_dataframe_cmd_exec(train_data, image_jitter_in_idx, CMD_DATATYPE_CONVERSION_FORWARD(), ccv_nnc_no_hint, 0, 0, 1, &fp16_params, 1, 0, 0);
-	const int image_jitter_fp16_idx = ccv_cnnp_dataframe_extract_tuple(train_data, image_jitter_out_fp16_idx, 0, 0);
+	// Jitter straight into the datatype and format of the batch, thus, batching is just a copy.
+	const int image_jitter_fp16_idx = ccv_cnnp_dataframe_image_random_jitter_tensor(train_data, read_image_idx, CCV_TRAIN_DT, CCV_TENSOR_FORMAT_NCHW, random_jitter, 0);
 	const float eta = 0.1;
-	const int one_hot_idx = ccv_cnnp_dataframe_one_hot(train_data, 0, offsetof(ccv_categorized_t, c), 1000, 1 - eta + eta / 1000, eta / 1000, CCV_TRAIN_DT, CCV_TENSOR_FORMAT_NCHW, 0);
-	ccv_cnnp_dataframe_shuffle(train_data);
+	const int one_hot_idx = ccv_cnnp_dataframe_one_hot(train_data, categorized_idx, offsetof(ccv_categorized_t, c), 1000, 1 - eta + eta / 1000, eta / 1000, CCV_TRAIN_DT, CCV_TENSOR_FORMAT_NCHW, 0);
+	// Shards are shuffled by shard and by chunk, such that they are still read sequentially.
+	if (train_from_shards)
+		ccv_cnnp_dataframe_shards_shuffle(train_data);
+	else
+		ccv_cnnp_dataframe_shuffle(train_data);
 	ccv_cnnp_dataframe_t* const batch_train_data = ccv_cnnp_dataframe_combine_new(train_data, COLUMN_ID_LIST(image_jitter_fp16_idx, one_hot_idx), batch_size, device_count, CCV_TENSOR_FORMAT_NCHW);
 	int t, i, j;
 	int train_device_columns[device_count * 2 + 1];
@@ -405,7 +430,8 @@ static void train_imagenet(const int batch_size, ccv_cnnp_dataframe_t* const tra
 		train_device_columns[device_count + i] = ccv_cnnp_dataframe_add_aux(batch_train_data, params, 0);
 	}
 	train_device_columns[device_count * 2] = 0;
-	ccv_cnnp_dataframe_iter_t* const iter = ccv_cnnp_dataframe_iter_new(batch_train_data, train_device_columns, device_count * 2 + 1);
+	// Decode, jitter and batch the training data on a background thread, keep 2 batches ready ahead.
+	ccv_cnnp_dataframe_iter_t* const iter = ccv_cnnp_dataframe_async_iter_new(batch_train_data, train_device_columns, device_count * 2 + 1, 2);
 	// Prepare test data.
 	const int read_test_image_idx = ccv_cnnp_dataframe_read_image(test_data, 0, offsetof(ccv_categorized_t, file) + offsetof(ccv_file_info_t, filename), 0);
 	ccv_cnnp_random_jitter_t no_jitter = {
@@ -427,10 +453,7 @@ static void train_imagenet(const int batch_size, ccv_cnnp_dataframe_t* const tra
 			.rows = 224,
 		},
 	};
-	const int test_image_idx = ccv_cnnp_dataframe_image_random_jitter(test_data, read_test_image_idx, CCV_32F, no_jitter, 0);
-	const int test_image_in_idx = ccv_cnnp_dataframe_make_tuple(test_data, COLUMN_ID_LIST(test_image_idx), 0);
-	const int test_image_out_fp16_idx = ccv_cnnp_dataframe_cmd_exec(test_data, test_image_in_idx, CMD_DATATYPE_CONVERSION_FORWARD(), ccv_nnc_no_hint, 0, 0, 1, &fp16_params, 1, 0, 0);
-	const int test_image_fp16_idx = ccv_cnnp_dataframe_extract_tuple(test_data, test_image_out_fp16_idx, 0, 0);
+	const int test_image_fp16_idx = ccv_cnnp_dataframe_image_random_jitter_tensor(test_data, read_test_image_idx, CCV_TRAIN_DT, CCV_TENSOR_FORMAT_NCHW, no_jitter, 0);
 	ccv_cnnp_dataframe_t* const batch_test_data = ccv_cnnp_dataframe_combine_new(test_data, COLUMN_ID_LIST(test_image_fp16_idx), batch_size, device_count, CCV_TENSOR_FORMAT_NCHW);
 	int test_device_columns[device_count * 2];
 	for (i = 0; i < device_count; i++)
@@ -536,7 +559,10 @@ static void train_imagenet(const int batch_size, ccv_cnnp_dataframe_t* const tra
 			printf("Epoch %d (%d), test accuracy %lf%%, time %.3f\n", epoch, t, (double)correct * 100 / ccv_cnnp_dataframe_row_count(test_data), (float)elapsed_time / 1000);
 			ccv_cnnp_dataframe_iter_set_cursor(test_iter, 0);
 			++epoch;
-			ccv_cnnp_dataframe_shuffle(train_data);
+			if (train_from_shards)
+				ccv_cnnp_dataframe_shards_shuffle(train_data);
+			else
+				ccv_cnnp_dataframe_shuffle(train_data);
 			ccv_cnnp_dataframe_iter_set_cursor(iter, 0);
 		}
 		int n;
@@ -584,6 +610,23 @@ static ccv_array_t* _array_from_disk_new(const char* const list, const char* con
 	return categorizeds;
 }
 
+static ccv_array_t* _shards_from_disk_new(const char* const list)
+{
+	FILE *r = fopen(list, "r");
+	assert(r && "list doesn't exists");
+	ccv_array_t* const shards = ccv_array_new(sizeof(char*), 64, 0);
+	char* file = (char*)malloc(1024);
+	while (fscanf(r, "%1023s", file) != EOF)
+	{
+		char* const filename = (char*)ccmalloc(1024);
+		strncpy(filename, file, 1024);
+		ccv_array_push(shards, &filename);
+	}
+	free(file);
+	fclose(r);
+	return shards;
+}
+
 int main(int argc, char** argv)
 {
 	ccv_nnc_init();
@@ -595,12 +638,14 @@ int main(int argc, char** argv)
 		{"test-list", 1, 0, 0},
 		/* optional parameters */
 		{"base-dir", 1, 0, 0},
+		{"train-shards", 1, 0, 0},
 		{0, 0, 0, 0}
 	};
 	int c;
 	char* train_list = 0;
 	char* test_list = 0;
 	char* base_dir = 0;
+	char* train_shards = 0;
 	while (getopt_long_only(argc, argv, "", imagenet_options, &c) != -1)
 	{
 		switch (c)
@@ -616,18 +661,26 @@ int main(int argc, char** argv)
 			case 3:
 				base_dir = optarg;
 				break;
+			case 4:
+				train_shards = optarg;
+				break;
 		}
 	}
-	ccv_array_t* const train_set = _array_from_disk_new(train_list, base_dir);
-	ccv_cnnp_dataframe_t* const train_data = ccv_cnnp_dataframe_from_array_new(train_set);
+	// The shards (written by the shard tool) are read with large sequential reads, rather than one small read per image.
+	ccv_array_t* const train_set = train_shards ? _shards_from_disk_new(train_shards) : _array_from_disk_new(train_list, base_dir);
+	ccv_cnnp_dataframe_t* const train_data = train_shards ? ccv_cnnp_dataframe_from_shards_new((const char* const*)ccv_array_get(train_set, 0), train_set->rnum, 0) : ccv_cnnp_dataframe_from_array_new(train_set);
+	assert(train_data && "cannot read the training data");
 	ccv_array_t* const test_set = _array_from_disk_new(test_list, base_dir);
 	ccv_cnnp_dataframe_t* const test_data = ccv_cnnp_dataframe_from_array_new(test_set);
-	train_imagenet(128, train_data, test_data, test_set);
+	train_imagenet(128, train_data, train_shards != 0, test_data, test_set);
 	ccv_cnnp_dataframe_free(train_data);
 	ccv_cnnp_dataframe_free(test_data);
 	int i;
 	for (i = 0; i < train_set->rnum; i++)
-		ccfree(((ccv_categorized_t*)ccv_array_get(train_set, i))->file.filename);
+		if (train_shards)
+			ccfree(*(char**)ccv_array_get(train_set, i));
+		else
+			ccfree(((ccv_categorized_t*)ccv_array_get(train_set, i))->file.filename);
 	ccv_array_free(train_set);
 	for (i = 0; i < test_set->rnum; i++)
 		ccfree(((ccv_categorized_t*)ccv_array_get(test_set, i))->file.filename);
@@ -306,6 +306,12 @@ static void train_imdb(const int vocab_size, const int batch_size, const int max
 	};
 	ccv_cnnp_model_t* const transformer = ccv_cnnp_dynamic_new(_dynamic_classifier_transformer, &classifier_transformer_params, 0);
 	ccv_cnnp_model_set_data_parallel(transformer, device_count);
+	// Compile for the longest sequence, thus, shorter batches re-initialize the arena instead of recompiling.
+	const ccv_nnc_tensor_param_t max_inputs[] = {
+		GPU_TENSOR_NCHW(000, 32F, batch_size, max_length, embedding_size),
+		GPU_TENSOR_NCHW(000, 32S, batch_size, max_length, max_length),
+	};
+	ccv_cnnp_model_set_max_inputs(transformer, max_inputs, 2);
 	const int epoch_end = (ccv_cnnp_dataframe_row_count(train_data) + device_count * batch_size - 1) / (device_count * batch_size);
 	ccv_cnnp_dataframe_shuffle(train_data);
 	ccv_nnc_cmd_t adam = CMD_ADAM_FORWARD(1, 0.0001, 0.9, 0.98, 0, 1e-9);
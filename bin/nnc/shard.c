@@ -0,0 +1,227 @@
+#include <ccv.h>
+#include <nnc/ccv_nnc.h>
+#include <nnc/ccv_nnc_easy.h>
+#include <ctype.h>
+#include <getopt.h>
+
+static void exit_with_help(void)
+{
+	printf(
+	"\n  \033[1mUSAGE\033[0m\n\n    shard [OPTION...]\n\n"
+	"  \033[1mREQUIRED OPTIONS\033[0m\n\n"
+	"    --list : text file with one sample per line, the line is kept as the meta of the record [example: 12 n01440764/n01440764_10026.JPEG]\n"
+	"    --output : the prefix of the shard files, writes PREFIX-00000.shard ... and PREFIX.shards that lists them\n\n"
+	"  \033[1mOTHER OPTIONS\033[0m\n\n"
+	"    --base-dir : change the base directory so that the program can read images from there\n"
+	"    --field : which whitespace-separated field of the line is the file name, starts from 0 [DEFAULT TO 1]\n"
+	"    --shard-size : the size of each shard in MiB [DEFAULT TO 256]\n\n"
+	"  Consecutive lines with the same file name are kept in one record, with these lines as the meta (for example, the bounding boxes of an image).\n\n"
+	);
+	exit(0);
+}
+
+// Copy the field out of the line, returns 0 if the line doesn't have that many fields.
+static int _field_from_line(const char* const line, const int field, char* const name, const size_t name_size)
+{
+	const char* p = line;
+	int i;
+	for (i = 0; ; i++)
+	{
+		while (*p && isspace(*p))
+			++p;
+		if (!*p)
+			return 0;
+		const char* const start = p;
+		while (*p && !isspace(*p))
+			++p;
+		if (i == field)
+		{
+			const size_t len = ccv_min((size_t)(p - start), name_size - 1);
+			memcpy(name, start, len);
+			name[len] = 0;
+			return 1;
+		}
+	}
+}
+
+static void* _file_read(const char* const filename, size_t* const size)
+{
+	FILE* const r = fopen(filename, "rb");
+	if (!r)
+		return 0;
+	fseek(r, 0, SEEK_END);
+	*size = ftell(r);
+	fseek(r, 0, SEEK_SET);
+	void* const data = ccmalloc(ccv_max(*size, 1));
+	if (fread(data, 1, *size, r) != *size)
+	{
+		ccfree(data);
+		fclose(r);
+		return 0;
+	}
+	fclose(r);
+	return data;
+}
+
+typedef struct {
+	char* output;
+	FILE* shards;
+	ccv_cnnp_shard_writer_t* writer;
+	int shard_count;
+	size_t shard_size;
+	size_t written;
+	int record_count;
+} shard_state_t;
+
+static void _shard_add(shard_state_t* const state, const char* const base_dir, const char* const name, const char* const meta, const size_t meta_size)
+{
+	char filename[2048];
+	if (base_dir)
+		snprintf(filename, sizeof(filename), "%s/%s", base_dir, name);
+	else
+		snprintf(filename, sizeof(filename), "%s", name);
+	size_t size = 0;
+	void* const data = _file_read(filename, &size);
+	if (!data)
+	{
+		fprintf(stderr, "cannot read %s, skipped\n", filename);
+		return;
+	}
+	if (state->writer && state->written + size + meta_size > state->shard_size)
+	{
+		if (ccv_cnnp_shard_writer_free(state->writer) != 0)
+		{
+			fprintf(stderr, "failed to write shard %d\n", state->shard_count - 1);
+			exit(-1);
+		}
+		state->writer = 0;
+	}
+	if (!state->writer)
+	{
+		char shard_name[2048];
+		snprintf(shard_name, sizeof(shard_name), "%s-%05d.shard", state->output, state->shard_count);
+		state->writer = ccv_cnnp_shard_writer_new(shard_name);
+		if (!state->writer)
+		{
+			fprintf(stderr, "cannot create %s\n", shard_name);
+			exit(-1);
+		}
+		fprintf(state->shards, "%s\n", shard_name);
+		++state->shard_count;
+		state->written = 0;
+	}
+	if (ccv_cnnp_shard_writer_add(state->writer, data, size, meta, meta_size) != 0)
+	{
+		fprintf(stderr, "failed to write %s\n", filename);
+		exit(-1);
+	}
+	state->written += size + meta_size;
+	++state->record_count;
+	ccfree(data);
+}
+
+int main(int argc, char** argv)
+{
+	static struct option shard_options[] = {
+		/* help */
+		{"help", 0, 0, 0},
+		/* required parameters */
+		{"list", 1, 0, 0},
+		{"output", 1, 0, 0},
+		/* optional parameters */
+		{"base-dir", 1, 0, 0},
+		{"field", 1, 0, 0},
+		{"shard-size", 1, 0, 0},
+		{0, 0, 0, 0}
+	};
+	int c;
+	char* list = 0;
+	char* output = 0;
+	char* base_dir = 0;
+	int field = 1;
+	int shard_size = 256;
+	while (getopt_long_only(argc, argv, "", shard_options, &c) != -1)
+	{
+		switch (c)
+		{
+			case 0:
+				exit_with_help();
+			case 1:
+				list = optarg;
+				break;
+			case 2:
+				output = optarg;
+				break;
+			case 3:
+				base_dir = optarg;
+				break;
+			case 4:
+				field = atoi(optarg);
+				break;
+			case 5:
+				shard_size = atoi(optarg);
+				break;
+		}
+	}
+	if (!list || !output || field < 0 || shard_size <= 0)
+		exit_with_help();
+	FILE* const r = fopen(list, "r");
+	if (!r)
+	{
+		fprintf(stderr, "cannot open %s\n", list);
+		return -1;
+	}
+	char shards_name[2048];
+	snprintf(shards_name, sizeof(shards_name), "%s.shards", output);
+	shard_state_t state = {
+		.output = output,
+		.shards = fopen(shards_name, "w"),
+		.shard_size = (size_t)shard_size * 1024 * 1024,
+	};
+	if (!state.shards)
+	{
+		fprintf(stderr, "cannot create %s\n", shards_name);
+		return -1;
+	}
+	char* line = 0;
+	size_t line_size = 0;
+	ssize_t len;
+	char name[1024];
+	char last_name[1024] = {0};
+	// The meta of the current record, which are the lines with the same file name.
+	ccv_array_t* const meta = ccv_array_new(1, 1024, 0);
+	while ((len = getline(&line, &line_size, r)) != -1)
+	{
+		while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+			line[--len] = 0;
+		if (!_field_from_line(line, field, name, sizeof(name)))
+			continue;
+		if (meta->rnum > 0 && strcmp(name, last_name) != 0)
+		{
+			_shard_add(&state, base_dir, last_name, (char*)ccv_array_get(meta, 0), meta->rnum);
+			ccv_array_clear(meta);
+		}
+		if (meta->rnum > 0)
+		{
+			const char newline = '\n';
+			ccv_array_push(meta, &newline);
+		}
+		ssize_t i;
+		for (i = 0; i < len; i++)
+			ccv_array_push(meta, line + i);
+		memcpy(last_name, name, sizeof(name));
+	}
+	if (meta->rnum > 0)
+		_shard_add(&state, base_dir, last_name, (char*)ccv_array_get(meta, 0), meta->rnum);
+	ccv_array_free(meta);
+	free(line);
+	fclose(r);
+	if (state.writer && ccv_cnnp_shard_writer_free(state.writer) != 0)
+	{
+		fprintf(stderr, "failed to write shard %d\n", state.shard_count - 1);
+		return -1;
+	}
+	fclose(state.shards);
+	printf("%d records written into %d shards, listed in %s\n", state.record_count, state.shard_count, shards_name);
+	return 0;
+}
@@ -489,6 +489,14 @@ static void train_wmt(const int epoch_limit, const int src_vocab_size, const int
 	};
 	ccv_cnnp_model_t* const wmt = ccv_cnnp_dynamic_new(_dynamic_encoder_decoder, &encoder_decoder_params, 0);
 	ccv_cnnp_model_set_data_parallel(wmt, device_count);
+	// Compile for the longest sequence, thus, shorter batches re-initialize the arena instead of recompiling.
+	const ccv_nnc_tensor_param_t max_inputs[] = {
+		GPU_TENSOR_NCHW(000, 32F, batch_size, max_length, embedding_size),
+		GPU_TENSOR_NCHW(000, 32F, batch_size, max_length, embedding_size),
+		GPU_TENSOR_NCHW(000, 32S, batch_size, max_length, max_length),
+		GPU_TENSOR_NCHW(000, 32S, batch_size, max_length, max_length),
+	};
+	ccv_cnnp_model_set_max_inputs(wmt, max_inputs, 4);
 	const int epoch_end = (ccv_cnnp_dataframe_row_count(train_data) + device_count * batch_size - 1) / (device_count * batch_size);
 	ccv_cnnp_dataframe_shuffle(train_data);
 	ccv_nnc_cmd_t adam = CMD_ADAM_FORWARD(1, 0.0001, 0.9, 0.98, 0, 1e-9);
@@ -15,6 +15,9 @@ def _ccv_setting_impl(repository_ctx):
     if repository_ctx.attr.have_libjpeg:
         defines.append("HAVE_LIBJPEG")
         linkopts.append("-ljpeg")
+    if repository_ctx.attr.have_zlib:
+        defines.append("HAVE_ZLIB")
+        linkopts.append("-lz")
     if repository_ctx.attr.have_fftw3:
         defines.append("HAVE_FFTW3")
         linkopts += ["-lfftw3", "-lfftw3f"]
@@ -66,6 +69,7 @@ ccv_setting = repository_rule(
         "have_cblas": attr.bool(),
         "have_libpng": attr.bool(),
         "have_libjpeg": attr.bool(),
+        "have_zlib": attr.bool(),
         "have_fftw3": attr.bool(),
         "have_pthread": attr.bool(),
         "have_liblinear": attr.bool(),
@@ -48,7 +48,8 @@ enum {
 	CCV_32F = 0x04000,
 	CCV_64S = 0x08000,
 	CCV_64F = 0x10000,
-	CCV_16F = 0x20000, // We can still squeeze in 2 more types. (0xFF000 are for data types).
+	CCV_16F = 0x20000,
+	CCV_16BF = 0x40000, // We can still squeeze in 1 more type. (0xFF000 are for data types).
 };
 
 enum {
@@ -63,6 +64,8 @@ static const int _ccv_get_data_type_size[] = {
 	-1, 4,
 	-1, -1, -1, 8,
 	-1, -1, -1, -1, -1, -1, -1, 8,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
 	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2
 };
 
@@ -214,6 +217,12 @@ void* ccv_cache_out(ccv_cache_t* cache, uint64_t sign, uint8_t* type);
  * @return -1 if cannot find the object, otherwise return 0.
  */
 int ccv_cache_delete(ccv_cache_t* cache, uint64_t sign);
+/**
+ * Free the least recently used objects until the cache is no larger than the given size.
+ * @param cache The cache.
+ * @param size The size in bytes the cache should shrink to.
+ */
+void ccv_cache_shrink(ccv_cache_t* cache, size_t size);
 /**
  * Clean up the cache, free all objects inside and other memory space occupied.
  * @param cache The cache.
@@ -443,7 +452,7 @@ uint64_t ccv_cache_generate_signature(const char* msg, int len, uint64_t sig_sta
 #define CCV_DEFAULT_CACHE_SIZE (1024 * 1024 * 64)
 
 /**
- * Drain up the cache.
+ * Drain up the cache (the calling thread's cache, and the process-wide cache if it is enabled).
  */
 void ccv_drain_cache(void);
 /**
@@ -460,6 +469,29 @@ void ccv_enable_default_cache(void);
  */
 void ccv_enable_cache(size_t size);
 
+typedef struct {
+	uint64_t hit; // lookups that returned a cached object
+	uint64_t miss; // lookups that had to compute
+	uint64_t eviction; // objects evicted to stay within the memory budget
+	size_t size; // the memory currently held by the cache, in bytes
+	size_t up; // the memory budget, in bytes
+} ccv_cache_stats_t;
+
+/**
+ * Enable a process-wide cache for ccv, shared by all threads. Unlike the cache enabled with ccv_enable_cache, which is per thread, a matrix computed on one thread can be reused on another, and all threads share one memory budget. The cache is striped into shards with their own locks, thus, threads rarely contend. When enabled, it takes precedence over the per-thread cache. Enable it before other threads start to use ccv.
+ * @param size The upper limit of the cache, in bytes.
+ */
+void ccv_enable_shared_cache(size_t size);
+/**
+ * Drain up and disable the process-wide cache. Other threads shouldn't use ccv at this point.
+ */
+void ccv_disable_shared_cache(void);
+/**
+ * Get the hit / miss / eviction counts of the process-wide cache.
+ * @param stats The statistics.
+ */
+void ccv_shared_cache_stats(ccv_cache_stats_t* stats);
+
 #define ccv_get_dense_matrix_cell_by(type, x, row, col, ch) \
 	(((type) & CCV_32S) ? (void*)((x)->data.i32 + ((row) * (x)->cols + (col)) * CCV_GET_CHANNEL(type) + (ch)) : \
 	(((type) & CCV_32F) ? (void*)((x)->data.f32+ ((row) * (x)->cols + (col)) * CCV_GET_CHANNEL(type) + (ch)) : \
@@ -580,6 +612,16 @@ int ccv_read_impl(const void* in, ccv_dense_matrix_t** x, int type, int rows, in
 // this is a way to implement function-signature based dispatch, you can call either
 // ccv_read(in, x, type) or ccv_read(in, x, type, rows, cols, scanline)
 // notice that you can implement this with va_* functions, but that is not type-safe
+/**
+ * Read image from a file or a region of memory, but let the decoder skip the resolution that will be thrown away by a subsequent resize. For JPEG, the image is decoded at 1/2, 1/4 or 1/8 scale directly in DCT domain, picking the smallest scale at which the shorter side is still no less than shorter and the longer side is still no less than longer. Other formats are read at full resolution. Thus, the result is always larger or equal to the requested size (unless the original is smaller), you still need to resize it to the exact size.
+ * @param in The file name or the data memory.
+ * @param x The output image.
+ * @param type CCV_IO_ANY_FILE or CCV_IO_ANY_STREAM, in conjunction with CCV_IO_GRAY or CCV_IO_RGB_COLOR.
+ * @param size The size of that data memory region (0 if it is a file).
+ * @param shorter The minimal length of the shorter side (0 if don't care).
+ * @param longer The minimal length of the longer side (0 if don't care). If both are 0, it reads at full resolution.
+ */
+int ccv_read_scaled(const void* in, ccv_dense_matrix_t** x, int type, int size, int shorter, int longer);
 /**
  * Write image to a file. This function has soft dependencies on [LibJPEG](http://libjpeg.sourceforge.net/) and [LibPNG](http://www.libpng.org/pub/png/libpng.html). No these libraries, no JPEG nor PNG write support.
  * @param mat The input image.
@@ -871,6 +913,9 @@ ccv_dense_matrix_t ccv_reshape(ccv_dense_matrix_t* a, int y, int x, int rows, in
 // 32-bit float to 16-bit float
 void ccv_float_to_half_precision(float* f, uint16_t* h, size_t len);
 void ccv_half_precision_to_float(uint16_t* h, float* f, size_t len);
+// 32-bit float to bfloat16 (the upper 16 bits of 32-bit float, rounded to nearest even)
+void ccv_float_to_bfloat(float* f, uint16_t* h, size_t len);
+void ccv_bfloat_to_float(uint16_t* h, float* f, size_t len);
 
 /* basic data structures ccv_util.c */
 
@@ -212,6 +212,12 @@ static void _ccv_cache_depleted(ccv_cache_t* cache, size_t size)
 		_ccv_cache_lru(cache);
 }
 
+void ccv_cache_shrink(ccv_cache_t* cache, size_t size)
+{
+	if (cache->rnum > 0)
+		_ccv_cache_depleted(cache, size);
+}
+
 int ccv_cache_put(ccv_cache_t* cache, uint64_t sign, void* x, uint32_t size, uint8_t type)
 {
 	assert(((uint64_t)x & 0x3) == 0);
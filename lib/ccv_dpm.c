@@ -9,6 +9,9 @@
 #ifdef USE_OPENMP
 #include <omp.h>
 #endif
+#if defined(HAVE_SSE2)
+#include <xmmintrin.h>
+#endif
 #ifdef HAVE_LIBLINEAR
 #include <linear.h>
 #endif
@@ -48,56 +51,118 @@ static void _ccv_dpm_feature_pyramid(ccv_dense_matrix_t* a, ccv_dense_matrix_t**
 	double scale = pow(2.0, 1.0 / (interval + 1.0));
 	memset(pyr, 0, (scale_upto + next * 2) * sizeof(ccv_dense_matrix_t*));
 	pyr[next] = a;
-	int i;
-	for (i = 1; i <= interval; i++)
-		ccv_resample(pyr[next], &pyr[next + i], 0, (int)(pyr[next]->rows / pow(scale, i)), (int)(pyr[next]->cols / pow(scale, i)), CCV_INTER_AREA);
-	for (i = next; i < scale_upto + next; i++)
-		ccv_sample_down(pyr[i], &pyr[i + next], 0, 0, 0);
-	ccv_dense_matrix_t* hog;
+	parallel_for(i, interval) {
+		ccv_resample(pyr[next], &pyr[next + i + 1], 0, (int)(pyr[next]->rows / pow(scale, i + 1)), (int)(pyr[next]->cols / pow(scale, i + 1)), CCV_INTER_AREA);
+	} parallel_endfor
+	/* each interval halves its own chain of levels, thus, the chains can be sampled down independently */
+	parallel_for(i, next) {
+		int j;
+		for (j = next + i; j < scale_upto + next; j += next)
+			ccv_sample_down(pyr[j], &pyr[j + next], 0, 0, 0);
+	} parallel_endfor
 	/* a more efficient way to generate up-scaled hog (using smaller size) */
-	for (i = 0; i < next; i++)
-	{
-		hog = 0;
+	parallel_for(i, next) {
+		ccv_dense_matrix_t* hog = 0;
 		ccv_hog(pyr[i + next], &hog, 0, 9, CCV_DPM_WINDOW_SIZE / 2 /* this is */);
 		pyr[i] = hog;
+	} parallel_endfor
+	parallel_for(i, scale_upto + next) {
+		ccv_dense_matrix_t* hog = 0;
+		ccv_hog(pyr[i + next], &hog, 0, 9, CCV_DPM_WINDOW_SIZE);
+		if (i > 0) // the first one is the input image, which is not ours to free
+			ccv_matrix_free(pyr[i + next]);
+		pyr[i + next] = hog;
+	} parallel_endfor
+}
+
+/* the dot product between the hog feature and the filter, over a block of rows */
+static inline float _ccv_dpm_filter_at(const float* a, const int a_step, const float* w, const int w_step, const int rows, const int len)
+{
+	int i, j;
+	float sum = 0;
+#if defined(HAVE_SSE2)
+	__m128 s0 = _mm_setzero_ps();
+	__m128 s1 = _mm_setzero_ps();
+	__m128 s2 = _mm_setzero_ps();
+	__m128 s3 = _mm_setzero_ps();
+	for (i = 0; i < rows; i++)
+	{
+		for (j = 0; j < len - 15; j += 16)
+		{
+			s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + j), _mm_loadu_ps(w + j)));
+			s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a + j + 4), _mm_loadu_ps(w + j + 4)));
+			s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_loadu_ps(a + j + 8), _mm_loadu_ps(w + j + 8)));
+			s3 = _mm_add_ps(s3, _mm_mul_ps(_mm_loadu_ps(a + j + 12), _mm_loadu_ps(w + j + 12)));
+		}
+		for (; j < len - 3; j += 4)
+			s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + j), _mm_loadu_ps(w + j)));
+		for (; j < len; j++)
+			sum += a[j] * w[j];
+		a += a_step;
+		w += w_step;
 	}
-	hog = 0;
-	ccv_hog(pyr[next], &hog, 0, 9, CCV_DPM_WINDOW_SIZE);
-	pyr[next] = hog;
-	for (i = next + 1; i < scale_upto + next * 2; i++)
+	union {
+		float f[4];
+		__m128 p;
+	} vs;
+	vs.p = _mm_add_ps(_mm_add_ps(s0, s1), _mm_add_ps(s2, s3));
+	sum += vs.f[0] + vs.f[1] + vs.f[2] + vs.f[3];
+#else
+	for (i = 0; i < rows; i++)
 	{
-		hog = 0;
-		ccv_hog(pyr[i], &hog, 0, 9, CCV_DPM_WINDOW_SIZE);
-		ccv_matrix_free(pyr[i]);
-		pyr[i] = hog;
+		for (j = 0; j < len; j++)
+			sum += a[j] * w[j];
+		a += a_step;
+		w += w_step;
 	}
+#endif
+	return sum;
 }
 
-static void _ccv_dpm_compute_score(ccv_dpm_root_classifier_t* root_classifier, ccv_dense_matrix_t* hog, ccv_dense_matrix_t* hog2x, ccv_dense_matrix_t** _response, ccv_dense_matrix_t** part_feature, ccv_dense_matrix_t** dx, ccv_dense_matrix_t** dy)
+/* correlate the hog feature with the filter and sum over channels, the filter is centered the same way as in
+ * ccv_filter, but the feature is padded with zeros. Because the channels of one row are continuous in memory,
+ * the filter at any location is a dot product of a few continuous rows, which vectorizes well. This is cheaper than
+ * ccv_filter for the small filters we have, and doesn't leave undefined values at the border */
+static void _ccv_dpm_filter(ccv_dense_matrix_t* a, ccv_dense_matrix_t* w, ccv_dense_matrix_t* d)
 {
-	ccv_dense_matrix_t* response = 0;
-	ccv_filter(hog, root_classifier->root.w, &response, 0, CCV_NO_PADDING);
-	ccv_dense_matrix_t* root_feature = 0;
-	ccv_flatten(response, (ccv_matrix_t**)&root_feature, 0, 0);
-	ccv_matrix_free(response);
-	*_response = root_feature;
+	assert(CCV_GET_DATA_TYPE(a->type) == CCV_32F && CCV_GET_DATA_TYPE(w->type) == CCV_32F && CCV_GET_CHANNEL(a->type) == CCV_GET_CHANNEL(w->type));
+	assert(d->rows == a->rows && d->cols == a->cols && CCV_GET_DATA_TYPE(d->type) == CCV_32F && CCV_GET_CHANNEL(d->type) == CCV_C1);
+	int ch = CCV_GET_CHANNEL(a->type);
+	int wh = (w->rows - 1) / 2, ww = (w->cols - 1) / 2;
+	int a_step = a->step / sizeof(float), w_step = w->step / sizeof(float);
+	int x, y;
+	float* d_ptr = d->data.f32;
+	for (y = 0; y < a->rows; y++)
+	{
+		int start_y = ccv_max(0, wh - y);
+		int end_y = ccv_min(w->rows, a->rows - y + wh);
+		for (x = 0; x < a->cols; x++)
+		{
+			int start_x = ccv_max(0, ww - x);
+			int end_x = ccv_min(w->cols, a->cols - x + ww);
+			d_ptr[x] = _ccv_dpm_filter_at(a->data.f32 + (y + start_y - wh) * a_step + (x + start_x - ww) * ch, a_step, w->data.f32 + start_y * w_step + start_x * ch, w_step, end_y - start_y, (end_x - start_x) * ch);
+		}
+		d_ptr += d->step / sizeof(float);
+	}
+}
+
+/* the part_response is the scratch for part filter responses before the distance transform, if it is 0,
+ * we allocate one. Otherwise, like everywhere else, the _response, part_feature, dx, dy will be reused if they are not 0 */
+static void _ccv_dpm_compute_score(ccv_dpm_root_classifier_t* root_classifier, ccv_dense_matrix_t* hog, ccv_dense_matrix_t* hog2x, ccv_dense_matrix_t** _response, ccv_dense_matrix_t* part_response, ccv_dense_matrix_t** part_feature, ccv_dense_matrix_t** dx, ccv_dense_matrix_t** dy)
+{
+	ccv_dense_matrix_t* root_feature = *_response = ccv_dense_matrix_renew(*_response, hog->rows, hog->cols, CCV_32F | CCV_C1, CCV_32F | CCV_C1, 0);
+	_ccv_dpm_filter(hog, root_classifier->root.w, root_feature);
 	if (hog2x == 0)
 		return;
-	ccv_make_matrix_mutable(root_feature);
 	int rwh = (root_classifier->root.w->rows - 1) / 2, rww = (root_classifier->root.w->cols - 1) / 2;
 	int rwh_1 = root_classifier->root.w->rows / 2, rww_1 = root_classifier->root.w->cols / 2;
+	ccv_dense_matrix_t* response = ccv_dense_matrix_renew(part_response, hog2x->rows, hog2x->cols, CCV_32F | CCV_C1, CCV_32F | CCV_C1, 0);
 	int i, x, y;
 	for (i = 0; i < root_classifier->count; i++)
 	{
 		ccv_dpm_part_classifier_t* part = root_classifier->part + i;
-		ccv_dense_matrix_t* response = 0;
-		ccv_filter(hog2x, part->w, &response, 0, CCV_NO_PADDING);
-		ccv_dense_matrix_t* feature = 0;
-		ccv_flatten(response, (ccv_matrix_t**)&feature, 0, 0);
-		ccv_matrix_free(response);
-		part_feature[i] = dx[i] = dy[i] = 0;
-		ccv_distance_transform(feature, &part_feature[i], 0, &dx[i], 0, &dy[i], 0, part->dx, part->dy, part->dxx, part->dyy, CCV_NEGATIVE | CCV_GSEDT);
-		ccv_matrix_free(feature);
+		_ccv_dpm_filter(hog2x, part->w, response);
+		ccv_distance_transform(response, &part_feature[i], 0, &dx[i], 0, &dy[i], 0, part->dx, part->dy, part->dxx, part->dyy, CCV_NEGATIVE | CCV_GSEDT);
 		int pwh = (part->w->rows - 1) / 2, pww = (part->w->cols - 1) / 2;
 		int offy = part->y + pwh - rwh * 2;
 		int miny = pwh, maxy = part_feature[i]->rows - part->w->rows + pwh;
@@ -115,6 +180,8 @@ static void _ccv_dpm_compute_score(ccv_dpm_root_classifier_t* root_classifier, c
 			f_ptr += root_feature->cols;
 		}
 	}
+	if (part_response == 0)
+		ccv_matrix_free(response);
 }
 
 #ifdef HAVE_LIBLINEAR
@@ -868,10 +935,10 @@ static ccv_dpm_feature_vector_t* _ccv_dpm_collect_best(ccv_dense_matrix_t* image
 				continue;
 			}
 			ccv_dense_matrix_t* root_feature = 0;
-			ccv_dense_matrix_t* part_feature[CCV_DPM_PART_MAX];
-			ccv_dense_matrix_t* dx[CCV_DPM_PART_MAX];
-			ccv_dense_matrix_t* dy[CCV_DPM_PART_MAX];
-			_ccv_dpm_compute_score(root_classifier, pyr[j], pyr[j - next], &root_feature, part_feature, dx, dy);
+			ccv_dense_matrix_t* part_feature[CCV_DPM_PART_MAX] = {0};
+			ccv_dense_matrix_t* dx[CCV_DPM_PART_MAX] = {0};
+			ccv_dense_matrix_t* dy[CCV_DPM_PART_MAX] = {0};
+			_ccv_dpm_compute_score(root_classifier, pyr[j], pyr[j - next], &root_feature, 0, part_feature, dx, dy);
 			int rwh = (root_classifier->root.w->rows - 1) / 2, rww = (root_classifier->root.w->cols - 1) / 2;
 			int rwh_1 = root_classifier->root.w->rows / 2, rww_1 = root_classifier->root.w->cols / 2;
 			float* f_ptr = (float*)ccv_get_dense_matrix_cell_by(CCV_32F | CCV_C1, root_feature, rwh, 0, 0);
@@ -944,10 +1011,10 @@ static ccv_array_t* _ccv_dpm_collect_all(gsl_rng* rng, ccv_dense_matrix_t* image
 		for (j = next; j < scale_upto + next * 2; j++)
 		{
 			ccv_dense_matrix_t* root_feature = 0;
-			ccv_dense_matrix_t* part_feature[CCV_DPM_PART_MAX];
-			ccv_dense_matrix_t* dx[CCV_DPM_PART_MAX];
-			ccv_dense_matrix_t* dy[CCV_DPM_PART_MAX];
-			_ccv_dpm_compute_score(root_classifier, pyr[j], pyr[j - next], &root_feature, part_feature, dx, dy);
+			ccv_dense_matrix_t* part_feature[CCV_DPM_PART_MAX] = {0};
+			ccv_dense_matrix_t* dx[CCV_DPM_PART_MAX] = {0};
+			ccv_dense_matrix_t* dy[CCV_DPM_PART_MAX] = {0};
+			_ccv_dpm_compute_score(root_classifier, pyr[j], pyr[j - next], &root_feature, 0, part_feature, dx, dy);
 			int rwh = (root_classifier->root.w->rows - 1) / 2, rww = (root_classifier->root.w->cols - 1) / 2;
 			int rwh_1 = root_classifier->root.w->rows / 2, rww_1 = root_classifier->root.w->cols / 2;
 			float* f_ptr = (float*)ccv_get_dense_matrix_cell_by(CCV_32F | CCV_C1, root_feature, rwh, 0, 0);
@@ -2042,9 +2109,49 @@ static int _ccv_is_equal_same_class(const void* _r1, const void* _r2, void* data
 		(int)(r2->rect.height * 1.5 + 0.5) >= r1->rect.height;
 }
 
+typedef struct {
+	ccv_dense_matrix_t response;
+	ccv_dense_matrix_t part_response;
+	ccv_dense_matrix_t part_feature[CCV_DPM_PART_MAX];
+	ccv_dense_matrix_t dx[CCV_DPM_PART_MAX];
+	ccv_dense_matrix_t dy[CCV_DPM_PART_MAX];
+	size_t size;
+	unsigned char* data;
+} ccv_dpm_scratch_t;
+
+/* lay the matrices to score the root classifier on this level over the scratch memory, it only grows when the
+ * level is larger than any seen before by this thread */
+static void _ccv_dpm_scratch_reserve(ccv_dpm_scratch_t* scratch, ccv_dpm_root_classifier_t* root, ccv_dense_matrix_t* hog, ccv_dense_matrix_t* hog2x)
+{
+	size_t root_size = ((size_t)hog->rows * hog->cols * sizeof(float) + 15) & -16;
+	// the part feature is float, the dx, dy are int, they are of the same size
+	size_t part_size = ((size_t)hog2x->rows * hog2x->cols * sizeof(float) + 15) & -16;
+	size_t size = root_size + part_size * (1 + root->count * 3);
+	if (size > scratch->size)
+	{
+		if (scratch->data)
+			ccfree(scratch->data);
+		scratch->data = (unsigned char*)ccmalloc(size);
+		scratch->size = size;
+	}
+	unsigned char* ptr = scratch->data;
+	scratch->response = ccv_dense_matrix(hog->rows, hog->cols, CCV_32F | CCV_C1, ptr, 0);
+	ptr += root_size;
+	scratch->part_response = ccv_dense_matrix(hog2x->rows, hog2x->cols, CCV_32F | CCV_C1, ptr, 0);
+	ptr += part_size;
+	int i;
+	for (i = 0; i < root->count; i++)
+	{
+		scratch->part_feature[i] = ccv_dense_matrix(hog2x->rows, hog2x->cols, CCV_32F | CCV_C1, ptr, 0);
+		scratch->dx[i] = ccv_dense_matrix(hog2x->rows, hog2x->cols, CCV_32S | CCV_C1, ptr + part_size, 0);
+		scratch->dy[i] = ccv_dense_matrix(hog2x->rows, hog2x->cols, CCV_32S | CCV_C1, ptr + part_size * 2, 0);
+		ptr += part_size * 3;
+	}
+}
+
 ccv_array_t* ccv_dpm_detect_objects(ccv_dense_matrix_t* a, ccv_dpm_mixture_model_t** _model, int count, ccv_dpm_param_t params)
 {
-	int c, i, j, k, x, y;
+	int c, i, j, k;
 	double scale = pow(2.0, 1.0 / (params.interval + 1.0));
 	int next = params.interval + 1;
 	int scale_upto = _ccv_dpm_scale_upto(a, _model, count, params.interval);
@@ -2052,82 +2159,126 @@ ccv_array_t* ccv_dpm_detect_objects(ccv_dense_matrix_t* a, ccv_dpm_mixture_model
 		return 0;
 	ccv_dense_matrix_t** pyr = (ccv_dense_matrix_t**)alloca((scale_upto + next * 2) * sizeof(ccv_dense_matrix_t*));
 	_ccv_dpm_feature_pyramid(a, pyr, scale_upto, params.interval);
+	int level_count = scale_upto + next;
+	double* level_scale = (double*)alloca(level_count * sizeof(double));
+	level_scale[0] = 1.0;
+	for (i = 1; i < level_count; i++)
+		level_scale[i] = level_scale[i - 1] * scale;
+	int* mixture_offset = (int*)alloca((count + 1) * sizeof(int));
+	mixture_offset[0] = 0;
+	for (c = 0; c < count; c++)
+		mixture_offset[c + 1] = mixture_offset[c] + _model[c]->count;
+	int mixture_count = mixture_offset[count];
+	/* every root mixture of every model on every level is one job. The jobs are ordered by level, thus, the larger
+	 * levels are picked up first. Each job collects into its own array, these are merged in the same order as
+	 * if we ran the jobs one after another, thus, the result doesn't depend on how the jobs are scheduled */
+	int job_count = level_count * mixture_count;
+	ccv_array_t** job_seq = (ccv_array_t**)cccalloc(job_count, sizeof(ccv_array_t*));
+#ifdef USE_OPENMP
+	int scratch_count = omp_get_max_threads();
+#else
+	int scratch_count = 1;
+#endif
+	ccv_dpm_scratch_t* scratch = (ccv_dpm_scratch_t*)cccalloc(scratch_count, sizeof(ccv_dpm_scratch_t));
+	parallel_for(n, job_count) {
+		int l = n / mixture_count + next;
+		int m = n % mixture_count;
+		int mc = 0;
+		while (m >= mixture_offset[mc + 1])
+			++mc;
+		ccv_dpm_root_classifier_t* root = _model[mc]->root + m - mixture_offset[mc];
+		double scale_x = level_scale[l - next];
+		double scale_y = level_scale[l - next];
+#ifdef USE_OPENMP
+		ccv_dpm_scratch_t* job_scratch = scratch + omp_get_thread_num();
+#else
+		ccv_dpm_scratch_t* job_scratch = scratch;
+#endif
+		_ccv_dpm_scratch_reserve(job_scratch, root, pyr[l], pyr[l - next]);
+		ccv_dense_matrix_t* root_feature = &job_scratch->response;
+		ccv_dense_matrix_t* part_feature[CCV_DPM_PART_MAX];
+		ccv_dense_matrix_t* dx[CCV_DPM_PART_MAX];
+		ccv_dense_matrix_t* dy[CCV_DPM_PART_MAX];
+		int p, x, y;
+		for (p = 0; p < root->count; p++)
+		{
+			part_feature[p] = job_scratch->part_feature + p;
+			dx[p] = job_scratch->dx + p;
+			dy[p] = job_scratch->dy + p;
+		}
+		_ccv_dpm_compute_score(root, pyr[l], pyr[l - next], &root_feature, &job_scratch->part_response, part_feature, dx, dy);
+		int rwh = (root->root.w->rows - 1) / 2, rww = (root->root.w->cols - 1) / 2;
+		int rwh_1 = root->root.w->rows / 2, rww_1 = root->root.w->cols / 2;
+		/* these values are designed to make sure works with odd/even number of rows/cols
+		 * of the root classifier:
+		 * suppose the image is 6x6, and the root classifier is 6x6, the scan area should starts
+		 * at (2,2) and end at (2,2), thus, it is capped by (rwh, rww) to (6 - rwh_1 - 1, 6 - rww_1 - 1)
+		 * this computation works for odd root classifier too (i.e. 5x5) */
+		float* f_ptr = (float*)ccv_get_dense_matrix_cell_by(CCV_32F | CCV_C1, root_feature, rwh, 0, 0);
+		for (y = rwh; y < root_feature->rows - rwh_1; y++)
+		{
+			for (x = rww; x < root_feature->cols - rww_1; x++)
+				if (f_ptr[x] + root->beta > params.threshold)
+				{
+					ccv_root_comp_t comp;
+					comp.neighbors = 1;
+					comp.classification.id = mc + 1;
+					comp.classification.confidence = f_ptr[x] + root->beta;
+					comp.pnum = root->count;
+					float drift_x = root->alpha[0],
+						  drift_y = root->alpha[1],
+						  drift_scale = root->alpha[2];
+					for (p = 0; p < root->count; p++)
+					{
+						ccv_dpm_part_classifier_t* part = root->part + p;
+						comp.part[p].neighbors = 1;
+						comp.part[p].classification.id = mc;
+						int pww = (part->w->cols - 1) / 2, pwh = (part->w->rows - 1) / 2;
+						int offy = part->y + pwh - rwh * 2;
+						int offx = part->x + pww - rww * 2;
+						int iy = ccv_clamp(y * 2 + offy, pwh, part_feature[p]->rows - part->w->rows + pwh);
+						int ix = ccv_clamp(x * 2 + offx, pww, part_feature[p]->cols - part->w->cols + pww);
+						int ry = ccv_get_dense_matrix_cell_value_by(CCV_32S | CCV_C1, dy[p], iy, ix, 0);
+						int rx = ccv_get_dense_matrix_cell_value_by(CCV_32S | CCV_C1, dx[p], iy, ix, 0);
+						drift_x += part->alpha[0] * rx + part->alpha[1] * ry;
+						drift_y += part->alpha[2] * rx + part->alpha[3] * ry;
+						drift_scale += part->alpha[4] * rx + part->alpha[5] * ry;
+						ry = iy - ry;
+						rx = ix - rx;
+						comp.part[p].rect = ccv_rect((int)((rx - pww) * CCV_DPM_WINDOW_SIZE / 2 * scale_x + 0.5), (int)((ry - pwh) * CCV_DPM_WINDOW_SIZE / 2 * scale_y + 0.5), (int)(part->w->cols * CCV_DPM_WINDOW_SIZE / 2 * scale_x + 0.5), (int)(part->w->rows * CCV_DPM_WINDOW_SIZE / 2 * scale_y + 0.5));
+						comp.part[p].classification.confidence = -ccv_get_dense_matrix_cell_value_by(CCV_32F | CCV_C1, part_feature[p], iy, ix, 0);
+					}
+					comp.rect = ccv_rect((int)((x + drift_x) * CCV_DPM_WINDOW_SIZE * scale_x - rww * CCV_DPM_WINDOW_SIZE * scale_x * (1.0 + drift_scale) + 0.5), (int)((y + drift_y) * CCV_DPM_WINDOW_SIZE * scale_y - rwh * CCV_DPM_WINDOW_SIZE * scale_y * (1.0 + drift_scale) + 0.5), (int)(root->root.w->cols * CCV_DPM_WINDOW_SIZE * scale_x * (1.0 + drift_scale) + 0.5), (int)(root->root.w->rows * CCV_DPM_WINDOW_SIZE * scale_y * (1.0 + drift_scale) + 0.5));
+					if (!job_seq[n])
+						job_seq[n] = ccv_array_new(sizeof(ccv_root_comp_t), 64, 0);
+					ccv_array_push(job_seq[n], &comp);
+				}
+			f_ptr += root_feature->cols;
+		}
+	} parallel_endfor
+	for (i = 0; i < scratch_count; i++)
+		if (scratch[i].data)
+			ccfree(scratch[i].data);
+	ccfree(scratch);
+	for (i = 0; i < scale_upto + next * 2; i++)
+		ccv_matrix_free(pyr[i]);
 	ccv_array_t* idx_seq;
 	ccv_array_t* seq = ccv_array_new(sizeof(ccv_root_comp_t), 64, 0);
 	ccv_array_t* seq2 = ccv_array_new(sizeof(ccv_root_comp_t), 64, 0);
 	ccv_array_t* result_seq = ccv_array_new(sizeof(ccv_root_comp_t), 64, 0);
 	for (c = 0; c < count; c++)
 	{
-		ccv_dpm_mixture_model_t* model = _model[c];
-		double scale_x = 1.0;
-		double scale_y = 1.0;
-		for (i = next; i < scale_upto + next * 2; i++)
-		{
-			for (j = 0; j < model->count; j++)
+		ccv_array_clear(seq);
+		for (i = 0; i < level_count; i++)
+			for (j = mixture_offset[c]; j < mixture_offset[c + 1]; j++)
 			{
-				ccv_dpm_root_classifier_t* root = model->root + j;
-				ccv_dense_matrix_t* root_feature = 0;
-				ccv_dense_matrix_t* part_feature[CCV_DPM_PART_MAX];
-				ccv_dense_matrix_t* dx[CCV_DPM_PART_MAX];
-				ccv_dense_matrix_t* dy[CCV_DPM_PART_MAX];
-				_ccv_dpm_compute_score(root, pyr[i], pyr[i - next], &root_feature, part_feature, dx, dy);
-				int rwh = (root->root.w->rows - 1) / 2, rww = (root->root.w->cols - 1) / 2;
-				int rwh_1 = root->root.w->rows / 2, rww_1 = root->root.w->cols / 2;
-				/* these values are designed to make sure works with odd/even number of rows/cols
-				 * of the root classifier:
-				 * suppose the image is 6x6, and the root classifier is 6x6, the scan area should starts
-				 * at (2,2) and end at (2,2), thus, it is capped by (rwh, rww) to (6 - rwh_1 - 1, 6 - rww_1 - 1)
-				 * this computation works for odd root classifier too (i.e. 5x5) */
-				float* f_ptr = (float*)ccv_get_dense_matrix_cell_by(CCV_32F | CCV_C1, root_feature, rwh, 0, 0);
-				for (y = rwh; y < root_feature->rows - rwh_1; y++)
-				{
-					for (x = rww; x < root_feature->cols - rww_1; x++)
-						if (f_ptr[x] + root->beta > params.threshold)
-						{
-							ccv_root_comp_t comp;
-							comp.neighbors = 1;
-							comp.classification.id = c + 1;
-							comp.classification.confidence = f_ptr[x] + root->beta;
-							comp.pnum = root->count;
-							float drift_x = root->alpha[0],
-								  drift_y = root->alpha[1],
-								  drift_scale = root->alpha[2];
-							for (k = 0; k < root->count; k++)
-							{
-								ccv_dpm_part_classifier_t* part = root->part + k;
-								comp.part[k].neighbors = 1;
-								comp.part[k].classification.id = c;
-								int pww = (part->w->cols - 1) / 2, pwh = (part->w->rows - 1) / 2;
-								int offy = part->y + pwh - rwh * 2;
-								int offx = part->x + pww - rww * 2;
-								int iy = ccv_clamp(y * 2 + offy, pwh, part_feature[k]->rows - part->w->rows + pwh);
-								int ix = ccv_clamp(x * 2 + offx, pww, part_feature[k]->cols - part->w->cols + pww);
-								int ry = ccv_get_dense_matrix_cell_value_by(CCV_32S | CCV_C1, dy[k], iy, ix, 0);
-								int rx = ccv_get_dense_matrix_cell_value_by(CCV_32S | CCV_C1, dx[k], iy, ix, 0);
-								drift_x += part->alpha[0] * rx + part->alpha[1] * ry;
-								drift_y += part->alpha[2] * rx + part->alpha[3] * ry;
-								drift_scale += part->alpha[4] * rx + part->alpha[5] * ry;
-								ry = iy - ry;
-								rx = ix - rx;
-								comp.part[k].rect = ccv_rect((int)((rx - pww) * CCV_DPM_WINDOW_SIZE / 2 * scale_x + 0.5), (int)((ry - pwh) * CCV_DPM_WINDOW_SIZE / 2 * scale_y + 0.5), (int)(part->w->cols * CCV_DPM_WINDOW_SIZE / 2 * scale_x + 0.5), (int)(part->w->rows * CCV_DPM_WINDOW_SIZE / 2 * scale_y + 0.5));
-								comp.part[k].classification.confidence = -ccv_get_dense_matrix_cell_value_by(CCV_32F | CCV_C1, part_feature[k], iy, ix, 0);
-							}
-							comp.rect = ccv_rect((int)((x + drift_x) * CCV_DPM_WINDOW_SIZE * scale_x - rww * CCV_DPM_WINDOW_SIZE * scale_x * (1.0 + drift_scale) + 0.5), (int)((y + drift_y) * CCV_DPM_WINDOW_SIZE * scale_y - rwh * CCV_DPM_WINDOW_SIZE * scale_y * (1.0 + drift_scale) + 0.5), (int)(root->root.w->cols * CCV_DPM_WINDOW_SIZE * scale_x * (1.0 + drift_scale) + 0.5), (int)(root->root.w->rows * CCV_DPM_WINDOW_SIZE * scale_y * (1.0 + drift_scale) + 0.5));
-							ccv_array_push(seq, &comp);
-						}
-					f_ptr += root_feature->cols;
-				}
-				for (k = 0; k < root->count; k++)
-				{
-					ccv_matrix_free(part_feature[k]);
-					ccv_matrix_free(dx[k]);
-					ccv_matrix_free(dy[k]);
-				}
-				ccv_matrix_free(root_feature);
+				ccv_array_t* level_seq = job_seq[i * mixture_count + j];
+				if (!level_seq)
+					continue;
+				for (k = 0; k < level_seq->rnum; k++)
+					ccv_array_push(seq, ccv_array_get(level_seq, k));
+				ccv_array_free(level_seq);
 			}
-			scale_x *= scale;
-			scale_y *= scale;
-		}
 		/* the following code from OpenCV's haar feature implementation */
 		if (params.min_neighbors == 0)
 		{
@@ -2227,9 +2378,7 @@ ccv_array_t* ccv_dpm_detect_objects(ccv_dense_matrix_t* a, ccv_dpm_mixture_model
 			ccfree(comps);
 		}
 	}
-
-	for (i = 0; i < scale_upto + next * 2; i++)
-		ccv_matrix_free(pyr[i]);
+	ccfree(job_seq);
 
 	ccv_array_free(seq);
 	ccv_array_free(seq2);
@@ -2341,7 +2490,8 @@ ccv_dpm_mixture_model_t* ccv_dpm_read_mixture_model(const char* directory)
 		model->root[i].root.w = (ccv_dense_matrix_t*)m;
 		m += ccv_compute_dense_matrix_size(w->rows, w->cols, w->type);
 		memcpy(model->root[i].root.w, w, ccv_compute_dense_matrix_size(w->rows, w->cols, w->type));
-		model->root[i].root.w->data.u8 = (unsigned char*)(model->root[i].root.w + 1);
+		// the data is not right after the header (it is aligned), keep the offset it has in the copied matrix
+		model->root[i].root.w->data.u8 = (unsigned char*)model->root[i].root.w + (w->data.u8 - (unsigned char*)w);
 		ccfree(w);
 		for (j = 0; j < model->root[i].count; j++)
 		{
@@ -2349,7 +2499,7 @@ ccv_dpm_mixture_model_t* ccv_dpm_read_mixture_model(const char* directory)
 			model->root[i].part[j].w = (ccv_dense_matrix_t*)m;
 			m += ccv_compute_dense_matrix_size(w->rows, w->cols, w->type);
 			memcpy(model->root[i].part[j].w, w, ccv_compute_dense_matrix_size(w->rows, w->cols, w->type));
-			model->root[i].part[j].w->data.u8 = (unsigned char*)(model->root[i].part[j].w + 1);
+			model->root[i].part[j].w->data.u8 = (unsigned char*)model->root[i].part[j].w + (w->data.u8 - (unsigned char*)w);
 			ccfree(w);
 		}
 	}
@@ -30,7 +30,7 @@
 #include "io/_ccv_io_binary.inc"
 #include "io/_ccv_io_raw.inc"
 
-static int _ccv_read_and_close_fd(FILE* fd, ccv_dense_matrix_t** x, int type)
+static int _ccv_read_and_close_fd(FILE* fd, ccv_dense_matrix_t** x, int type, int shorter, int longer)
 {
 	int ctype = (type & 0xF00) ? CCV_8U | ((type & 0xF00) >> 8) : 0;
 	if ((type & 0XFF) == CCV_IO_ANY_FILE)
@@ -51,7 +51,7 @@ static int _ccv_read_and_close_fd(FILE* fd, ccv_dense_matrix_t** x, int type)
 	{
 #ifdef HAVE_LIBJPEG
 		case CCV_IO_JPEG_FILE:
-			_ccv_read_jpeg_fd(fd, x, ctype);
+			_ccv_read_jpeg_fd(fd, x, ctype, shorter, longer);
 			break;
 #endif
 #ifdef HAVE_LIBPNG
@@ -172,7 +172,7 @@ static fpos_t seekfn(void* context, fpos_t off, int whence)
 }
 #endif
 
-int ccv_read_impl(const void* in, ccv_dense_matrix_t** x, int type, int rows, int cols, int scanline)
+static int _ccv_read(const void* in, ccv_dense_matrix_t** x, int type, int rows, int cols, int scanline, int shorter, int longer)
 {
 	FILE* fd = 0;
 	if (type & CCV_IO_ANY_FILE)
@@ -181,7 +181,7 @@ int ccv_read_impl(const void* in, ccv_dense_matrix_t** x, int type, int rows, in
 		fd = fopen((const char*)in, "rb");
 		if (!fd)
 			return CCV_IO_ERROR;
-		return _ccv_read_and_close_fd(fd, x, type);
+		return _ccv_read_and_close_fd(fd, x, type, shorter, longer);
 	} else if (type & CCV_IO_ANY_STREAM) {
 		assert(rows > 8 && cols == 0 && scanline == 0);
 		assert((type & 0xFF) != CCV_IO_DEFLATE_STREAM); // deflate stream (compressed stream) is not supported yet
@@ -201,7 +201,7 @@ int ccv_read_impl(const void* in, ccv_dense_matrix_t** x, int type, int rows, in
 			return CCV_IO_ERROR;
 		// mimicking itself as a "file"
 		type = (type & ~0x10) | 0x20;
-		return _ccv_read_and_close_fd(fd, x, type);
+		return _ccv_read_and_close_fd(fd, x, type, shorter, longer);
 #endif
 	} else if (type & CCV_IO_ANY_RAW) {
 		return _ccv_read_raw(x, (void*)in /* it can be modifiable if it is NO_COPY mode */, type, rows, cols, scanline);
@@ -209,6 +209,17 @@ int ccv_read_impl(const void* in, ccv_dense_matrix_t** x, int type, int rows, in
 	return CCV_IO_UNKNOWN;
 }
 
+int ccv_read_impl(const void* in, ccv_dense_matrix_t** x, int type, int rows, int cols, int scanline)
+{
+	return _ccv_read(in, x, type, rows, cols, scanline, 0, 0);
+}
+
+int ccv_read_scaled(const void* in, ccv_dense_matrix_t** x, int type, int size, int shorter, int longer)
+{
+	assert((type & CCV_IO_ANY_FILE) || (type & CCV_IO_ANY_STREAM));
+	return _ccv_read(in, x, type, (type & CCV_IO_ANY_STREAM) ? size : 0, 0, 0, shorter, longer);
+}
+
 int ccv_write(ccv_dense_matrix_t* mat, char* out, int* len, int type, void* conf)
 {
 	FILE* fd = 0;
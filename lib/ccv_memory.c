@@ -1,6 +1,9 @@
 #include "ccv.h"
 #include "ccv_internal.h"
 #include "3rdparty/siphash/siphash24.h"
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
 static __thread ccv_cache_t ccv_cache;
 
@@ -13,13 +16,133 @@ static __thread ccv_cache_t ccv_cache;
 /* option to enable/disable cache */
 static __thread int ccv_cache_opt = 0;
 
+/**
+ * The process-wide cache. It is striped into shards by the top bits of the signature, each shard is a radix-tree
+ * cache with its own lock. The shards share one memory budget: any shard can take the whole budget, and when
+ * a put goes over it, the least recently used objects of the fullest shard are evicted until it fits again.
+ * Thus, a shard that happens to fill up first doesn't starve the others.
+ * When it is enabled, it takes precedence over the per-thread cache.
+ **/
+#define CCV_SHARED_CACHE_SHARDS (16)
+
+typedef struct {
+	ccv_cache_t cache;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_t mutex;
+#endif
+} __attribute__((aligned(64))) ccv_shared_cache_shard_t;
+
+static struct {
+	int opt;
+	size_t up;
+	size_t size; // accessed atomically, the sum of sizes of all shards
+	uint64_t hit;
+	uint64_t miss;
+	uint64_t eviction;
+	ccv_shared_cache_shard_t shards[CCV_SHARED_CACHE_SHARDS];
+} ccv_shared_cache = {
+	.opt = 0,
+};
+
+static inline ccv_shared_cache_shard_t* _ccv_shared_cache_shard(uint64_t sig)
+{
+	// the radix tree dices from the lower bits, thus, use the top bits to pick the shard
+	return ccv_shared_cache.shards + (sig >> 60) % CCV_SHARED_CACHE_SHARDS;
+}
+
+static inline void _ccv_shared_cache_shard_lock(ccv_shared_cache_shard_t* shard)
+{
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&shard->mutex);
+#endif
+}
+
+static inline void _ccv_shared_cache_shard_unlock(ccv_shared_cache_shard_t* shard)
+{
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&shard->mutex);
+#endif
+}
+
+static inline void _ccv_shared_cache_resize(size_t old_size, size_t new_size)
+{
+	if (new_size > old_size)
+		__atomic_add_fetch(&ccv_shared_cache.size, new_size - old_size, __ATOMIC_RELAXED);
+	else if (new_size < old_size)
+		__atomic_sub_fetch(&ccv_shared_cache.size, old_size - new_size, __ATOMIC_RELAXED);
+}
+
+static void* _ccv_shared_cache_out(uint64_t sig, uint8_t* type)
+{
+	ccv_shared_cache_shard_t* shard = _ccv_shared_cache_shard(sig);
+	_ccv_shared_cache_shard_lock(shard);
+	size_t old_size = shard->cache.size;
+	void* x = ccv_cache_out(&shard->cache, sig, type);
+	_ccv_shared_cache_resize(old_size, shard->cache.size);
+	_ccv_shared_cache_shard_unlock(shard);
+	__atomic_add_fetch(x ? &ccv_shared_cache.hit : &ccv_shared_cache.miss, 1, __ATOMIC_RELAXED);
+	return x;
+}
+
+// evict from the fullest shard, one shard at a time, until the shards together are within the budget again
+static void _ccv_shared_cache_evict(void)
+{
+	for (;;)
+	{
+		const size_t size = __atomic_load_n(&ccv_shared_cache.size, __ATOMIC_RELAXED);
+		if (size <= ccv_shared_cache.up)
+			return;
+		int i;
+		ccv_shared_cache_shard_t* fullest = 0;
+		size_t fullest_size = 0;
+		for (i = 0; i < CCV_SHARED_CACHE_SHARDS; i++)
+		{
+			ccv_shared_cache_shard_t* shard = ccv_shared_cache.shards + i;
+			_ccv_shared_cache_shard_lock(shard);
+			if (shard->cache.size > fullest_size)
+				fullest = shard, fullest_size = shard->cache.size;
+			_ccv_shared_cache_shard_unlock(shard);
+		}
+		if (!fullest)
+			return;
+		_ccv_shared_cache_shard_lock(fullest);
+		const size_t old_size = fullest->cache.size;
+		const uint32_t old_rnum = fullest->cache.rnum;
+		const size_t over = size - ccv_shared_cache.up;
+		ccv_cache_shrink(&fullest->cache, old_size > over ? old_size - over : 0);
+		_ccv_shared_cache_resize(old_size, fullest->cache.size);
+		const uint32_t evicted = old_rnum - fullest->cache.rnum;
+		_ccv_shared_cache_shard_unlock(fullest);
+		if (evicted > 0)
+			__atomic_add_fetch(&ccv_shared_cache.eviction, evicted, __ATOMIC_RELAXED);
+	}
+}
+
+static int _ccv_shared_cache_put(uint64_t sig, void* x, size_t size, uint8_t type)
+{
+	ccv_shared_cache_shard_t* shard = _ccv_shared_cache_shard(sig);
+	_ccv_shared_cache_shard_lock(shard);
+	const size_t old_size = shard->cache.size;
+	const uint32_t old_rnum = shard->cache.rnum;
+	int result = (size <= UINT32_MAX) ? ccv_cache_put(&shard->cache, sig, x, (uint32_t)size, type) : -1;
+	_ccv_shared_cache_resize(old_size, shard->cache.size);
+	// either inserted one (0) or replaced one (1), the rest were evicted
+	const uint32_t evicted = (result >= 0) ? old_rnum + (result == 0) - shard->cache.rnum : 0;
+	_ccv_shared_cache_shard_unlock(shard);
+	if (evicted > 0)
+		__atomic_add_fetch(&ccv_shared_cache.eviction, evicted, __ATOMIC_RELAXED);
+	if (result >= 0)
+		_ccv_shared_cache_evict();
+	return result;
+}
+
 ccv_dense_matrix_t* ccv_dense_matrix_new(int rows, int cols, int type, void* data, uint64_t sig)
 {
 	ccv_dense_matrix_t* mat;
-	if (ccv_cache_opt && sig != 0 && !data && !(type & CCV_NO_DATA_ALLOC))
+	if ((ccv_cache_opt || ccv_shared_cache.opt) && sig != 0 && !data && !(type & CCV_NO_DATA_ALLOC))
 	{
 		uint8_t type;
-		mat = (ccv_dense_matrix_t*)ccv_cache_out(&ccv_cache, sig, &type);
+		mat = (ccv_dense_matrix_t*)(ccv_shared_cache.opt ? _ccv_shared_cache_out(sig, &type) : ccv_cache_out(&ccv_cache, sig, &type));
 		if (mat)
 		{
 			assert(type == 0);
@@ -172,7 +295,7 @@ void ccv_matrix_free(ccv_matrix_t* mat)
 	{
 		ccv_dense_matrix_t* dmt = (ccv_dense_matrix_t*)mat;
 		dmt->refcount = 0;
-		if (!ccv_cache_opt || // e don't enable cache
+		if ((!ccv_cache_opt && !ccv_shared_cache.opt) || // e don't enable cache
 			!(dmt->type & CCV_REUSABLE) || // or this is not a reusable piece
 			dmt->sig == 0 || // or this doesn't have valid signature
 			(dmt->type & CCV_NO_DATA_ALLOC)) // or this matrix is allocated as header-only, therefore we cannot cache it
@@ -184,7 +307,10 @@ void ccv_matrix_free(ccv_matrix_t* mat)
 				   CCV_GET_DATA_TYPE(dmt->type) == CCV_64S ||
 				   CCV_GET_DATA_TYPE(dmt->type) == CCV_64F);
 			size_t size = ccv_compute_dense_matrix_size(dmt->rows, dmt->cols, dmt->type);
-			ccv_cache_put(&ccv_cache, dmt->sig, dmt, size, 0 /* type 0 */);
+			if (!ccv_shared_cache.opt)
+				ccv_cache_put(&ccv_cache, dmt->sig, dmt, size, 0 /* type 0 */);
+			else if (_ccv_shared_cache_put(dmt->sig, dmt, size, 0 /* type 0 */) < 0)
+				ccfree(dmt);
 		}
 	} else if (type & CCV_MATRIX_SPARSE) {
 		ccv_sparse_matrix_t* smt = (ccv_sparse_matrix_t*)mat;
@@ -207,10 +333,10 @@ void ccv_matrix_free(ccv_matrix_t* mat)
 ccv_array_t* ccv_array_new(int rsize, int rnum, uint64_t sig)
 {
 	ccv_array_t* array;
-	if (ccv_cache_opt && sig != 0)
+	if ((ccv_cache_opt || ccv_shared_cache.opt) && sig != 0)
 	{
 		uint8_t type;
-		array = (ccv_array_t*)ccv_cache_out(&ccv_cache, sig, &type);
+		array = (ccv_array_t*)(ccv_shared_cache.opt ? _ccv_shared_cache_out(sig, &type) : ccv_cache_out(&ccv_cache, sig, &type));
 		if (array)
 		{
 			assert(type == 1);
@@ -252,14 +378,30 @@ void ccv_array_free_immediately(ccv_array_t* array)
 
 void ccv_array_free(ccv_array_t* array)
 {
-	if (!ccv_cache_opt || !(array->type & CCV_REUSABLE) || array->sig == 0)
+	if ((!ccv_cache_opt && !ccv_shared_cache.opt) || !(array->type & CCV_REUSABLE) || array->sig == 0)
 	{
 		array->refcount = 0;
 		ccfree(array->data);
 		ccfree(array);
 	} else {
 		size_t size = sizeof(ccv_array_t) + array->size * array->rsize;
-		ccv_cache_put(&ccv_cache, array->sig, array, size, 1 /* type 1 */);
+		if (!ccv_shared_cache.opt)
+			ccv_cache_put(&ccv_cache, array->sig, array, size, 1 /* type 1 */);
+		else if (_ccv_shared_cache_put(array->sig, array, size, 1 /* type 1 */) < 0)
+			ccv_array_free_immediately(array);
+	}
+}
+
+static void _ccv_drain_shared_cache(void)
+{
+	int i;
+	for (i = 0; i < CCV_SHARED_CACHE_SHARDS; i++)
+	{
+		ccv_shared_cache_shard_t* shard = ccv_shared_cache.shards + i;
+		_ccv_shared_cache_shard_lock(shard);
+		_ccv_shared_cache_resize(shard->cache.size, 0);
+		ccv_cache_cleanup(&shard->cache);
+		_ccv_shared_cache_shard_unlock(shard);
 	}
 }
 
@@ -267,6 +409,8 @@ void ccv_drain_cache(void)
 {
 	if (ccv_cache.rnum > 0)
 		ccv_cache_cleanup(&ccv_cache);
+	if (ccv_shared_cache.opt)
+		_ccv_drain_shared_cache();
 }
 
 void ccv_disable_cache(void)
@@ -286,6 +430,49 @@ void ccv_enable_default_cache(void)
 	ccv_enable_cache(CCV_DEFAULT_CACHE_SIZE);
 }
 
+void ccv_enable_shared_cache(size_t size)
+{
+	if (ccv_shared_cache.opt)
+		ccv_disable_shared_cache();
+	int i;
+	for (i = 0; i < CCV_SHARED_CACHE_SHARDS; i++)
+	{
+		ccv_cache_init(&ccv_shared_cache.shards[i].cache, size, 2, ccv_matrix_free_immediately, ccv_array_free_immediately);
+#ifdef HAVE_PTHREAD
+		pthread_mutex_init(&ccv_shared_cache.shards[i].mutex, 0);
+#endif
+	}
+	ccv_shared_cache.up = size;
+	ccv_shared_cache.size = 0;
+	ccv_shared_cache.hit = ccv_shared_cache.miss = ccv_shared_cache.eviction = 0;
+	ccv_shared_cache.opt = 1;
+}
+
+void ccv_disable_shared_cache(void)
+{
+	if (!ccv_shared_cache.opt)
+		return;
+	ccv_shared_cache.opt = 0;
+	_ccv_drain_shared_cache();
+	int i;
+	for (i = 0; i < CCV_SHARED_CACHE_SHARDS; i++)
+	{
+		ccv_cache_close(&ccv_shared_cache.shards[i].cache);
+#ifdef HAVE_PTHREAD
+		pthread_mutex_destroy(&ccv_shared_cache.shards[i].mutex);
+#endif
+	}
+}
+
+void ccv_shared_cache_stats(ccv_cache_stats_t* stats)
+{
+	stats->hit = __atomic_load_n(&ccv_shared_cache.hit, __ATOMIC_RELAXED);
+	stats->miss = __atomic_load_n(&ccv_shared_cache.miss, __ATOMIC_RELAXED);
+	stats->eviction = __atomic_load_n(&ccv_shared_cache.eviction, __ATOMIC_RELAXED);
+	stats->size = __atomic_load_n(&ccv_shared_cache.size, __ATOMIC_RELAXED);
+	stats->up = ccv_shared_cache.up;
+}
+
 static uint8_t key_siphash[16] = "libccvky4siphash";
 
 uint64_t ccv_cache_generate_signature(const char* msg, int len, uint64_t sig_start, ...)
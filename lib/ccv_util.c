@@ -1654,6 +1654,25 @@ void ccv_half_precision_to_float(uint16_t* h, float* f, size_t len)
 		u[i] = _ccv_mantissa_table[_ccv_offset_table[h[i] >> 10] + (h[i] & 0x3ff)] + _ccv_exponent_table[h[i] >> 10];
 }
 
+void ccv_float_to_bfloat(float* f, uint16_t* h, size_t len)
+{
+	int i;
+	uint32_t* u = (uint32_t*)f;
+	for (i = 0; i < len; i++)
+		if ((u[i] & 0x7fffffff) > 0x7f800000) // Keep NaN a quiet NaN, rounding may carry it into infinity.
+			h[i] = (u[i] >> 16) | 0x40;
+		else // Round to nearest even.
+			h[i] = (u[i] + 0x7fff + ((u[i] >> 16) & 1)) >> 16;
+}
+
+void ccv_bfloat_to_float(uint16_t* h, float* f, size_t len)
+{
+	int i;
+	uint32_t* u = (uint32_t*)f;
+	for (i = 0; i < len; i++)
+		u[i] = (uint32_t)h[i] << 16;
+}
+
 void ccv_array_push(ccv_array_t* array, const void* r)
 {
 	array->rnum++;
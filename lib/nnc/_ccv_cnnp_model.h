@@ -130,6 +130,13 @@ typedef struct {
 		ccv_array_t* parameters;
 		int max_saved_aux_size;
 	} minimize;
+	struct {
+		int size; // The number of tensor symbols when the ranges were collected.
+		float* ranges; // The min and the max observed for each tensor symbol, min > max if never observed.
+		int quantized; // Whether the graph is quantized, thus, it can only be evaluated without gradients.
+	} calibration;
+	struct ccv_cnnp_model_async_checkpoint_s* async_checkpoint; // The snapshot and the writer for asynchronous checkpoints.
+	ccv_array_t* reshapes; // The symbols absorbed for input shapes within the maximum shapes, to switch between them without building the model again.
 	ccv_nnc_cmd_t loss;
 	ccv_nnc_tensor_symbol_t* f;
 	ccv_nnc_tensor_symbol_t fits[1];
@@ -152,6 +159,7 @@ struct ccv_cnnp_model_s {
 	ccv_cnnp_compiled_data_t* compiled_data;
 	int parallel_count; // How many parallel devices.
 	int memory_compression; // Whether to enable memory compression for training phase.
+	ccv_nnc_tensor_param_t* max_inputs; // The maximum shapes of inputs the compiled graph is planned for, can be 0.
 	size_t workspace_size; // Set the default workspace size.
 	void* data; // Temporary storage for some internal functions.
 };
@@ -299,5 +307,6 @@ static inline void ccv_cnnp_model_add_to_parameter_indices(ccv_cnnp_model_t* con
 }
 
 void ccv_cnnp_model_tensors_init(const ccv_cnnp_model_t* const model, ccv_cnnp_compiled_data_t* const compiled_data);
+void ccv_cnnp_model_async_checkpoint_free(ccv_cnnp_compiled_data_t* const compiled_data);
 
 #endif
@@ -18,6 +18,7 @@
 
 #define CCV_NNC_IS_EXTERN_TENSOR_VIEW(tv) ((uintptr_t)(tv) & 1)
 #define CCV_NNC_TENSOR_VIEW(tv) ((ccv_nnc_tensor_view_t*)((uintptr_t)(tv) & ~(uintptr_t)1))
+#define CCV_NNC_DYNAMIC_GRAPH_CPU_CACHE_LIMIT (256 * 1024 * 1024) // The default high-water mark of retained CPU memory, 256MiB.
 
 enum {
 	CCV_NNC_TENSOR_VARIABLE,
@@ -90,7 +91,7 @@ KHASH_MAP_INIT_INT(synced_stream, ccv_nnc_synced_stream_t);
 
 typedef struct dy_alloc_metadata_s dy_alloc_metadata_t;
 struct dy_alloc_metadata_s {
-	int device;
+	int type; // The memory type and device of this allocation.
 	size_t size;
 	intptr_t str;
 	rb_node(dy_alloc_metadata_t) link;
@@ -116,6 +117,8 @@ struct ccv_nnc_dynamic_graph_s {
 	ccv_array_t* stateful_execs; // Array keeps track of the stateful execs. The stateful execs type can have additional apply_gradients calls to update its internal states.
 	khash_t(dy_str)* freed; // The freed memory allocations.
 	khash_t(dy_alloc)* allocd; // The allocated memory.
+	size_t cpu_freed_size; // The size of CPU memory retained in freed for reuse.
+	size_t cpu_cache_limit; // The high-water mark of CPU memory retained in freed.
 	ccv_nnc_symbolic_graph_t* tape; // Symbolic graph to keep track of computation.
 	khash_t(synced_stream)* synced_streams; // Keeps track of streams on both GPU / CPU and devices so it can be used properly during execution.
 	khash_t(signal_container)* signal_container; // Signals for streams.
@@ -294,7 +297,7 @@ static inline int ccv_nnc_tensor_variable_contains_value(ccv_nnc_tensor_variable
 }
 
 void ccv_nnc_dynamic_graph_exec_ret(ccv_nnc_dynamic_graph_t* const graph, const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, const ccv_nnc_tensor_variable_t* const inputs, const int input_size, ccv_nnc_tensor_variable_t* const outputs, const int output_size, const int parallel, ccv_nnc_stream_context_t* const stream_context, ccv_nnc_graph_exec_symbol_t* const graph_execs);
-void* ccv_nnc_dynamic_graph_xpu_alloc(ccv_nnc_dynamic_graph_t* const graph, const int device, ccv_nnc_stream_context_t* const stream, const size_t size);
+void* ccv_nnc_dynamic_graph_xpu_alloc(ccv_nnc_dynamic_graph_t* const graph, const int type, ccv_nnc_stream_context_t* const stream, const size_t size);
 void ccv_nnc_dynamic_graph_xpu_free(ccv_nnc_dynamic_graph_t* const graph, void* const ptr);
 void ccv_nnc_dynamic_graph_xpu_alloc_destroy(ccv_nnc_dynamic_graph_t* const graph);
 
@@ -56,6 +56,13 @@ CCV_WARN_UNUSED(co_scheduler_t*) ccv_nnc_stream_context_get_scheduler(ccv_nnc_st
 #define co_stream_await(_stream) do { if (!_co_stream_await(_self_, _stream)) { return (co_state_t){ __LINE__, 0 }; } case __LINE__: ; } while (0)
 int _co_stream_await(co_routine_t* const self, ccv_nnc_stream_context_t* const stream);
 
+// Run the command after everything previously submitted to the CPU stream. It returns immediately if the stream is
+// backed by the thread pool, the tensors are read when the command runs, thus, they cannot be changed in between.
+// The neighbor discovery context is copied along with the command and set on the stream while the command runs.
+void ccv_nnc_stream_cpu_cmd_exec(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, const ccv_nnc_stream_context_neighbor_discovery_f discovery, const void* const discovery_context, const size_t discovery_context_size, ccv_nnc_stream_context_t* const stream_context);
+// Wait for jobs on the CPU stream such that the caller can run things on it inline.
+void ccv_nnc_stream_cpu_sync(ccv_nnc_stream_context_t* const stream_context);
+
 khash_t(signal_container)* ccv_nnc_signal_container_new(void);
 ccv_nnc_stream_signal_t* ccv_nnc_emit_signal_from_container(khash_t(signal_container)* container, ccv_nnc_stream_context_t* const stream);
 void ccv_nnc_signal_container_free(khash_t(signal_container)* signal_container);
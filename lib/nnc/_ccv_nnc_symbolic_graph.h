@@ -28,6 +28,7 @@ typedef struct {
 	int inc[CCV_NNC_MAX_DIM_ALLOC];
 	ccv_array_t* s_ref; // Reference to the tensor number in its sub graphs, Starts at 1.
 	char* name;
+	ccv_nnc_tensor_t* constant; // The content of this tensor symbol if it is a constant.
 	ccv_nnc_tensor_param_t info;
 } ccv_nnc_tensor_symbol_info_t;
 
@@ -151,10 +152,12 @@ struct ccv_nnc_tensor_arena_s {
 		uint64_t size;
 		uint8_t* ptr;
 	}* buffers;
+	uint64_t size_lower_bound; // The peak size of the tensors that cannot share memory, for the buffers above.
 	// Real allocated tensor header metadata (this is a mixed pool of ccv_tensor_t, ccv_tensor_view_t,
 	// ccv_tensor_multiview_t, thus, it is aligned to a 16-byte boundary).
 	ccv_array_t* tensor_metadata;
 	ccv_array_t* m_tensor_idx; // The index into multi-view tensors in tensor_metadata.
+	ccv_array_t* constants; // The copies of constant tensor symbols' content, these are bound to the arena.
 };
 
 struct ccv_nnc_graph_exec_arena_s {
@@ -208,6 +211,7 @@ void ccv_nnc_symbolic_graph_symbol_infer(const ccv_nnc_symbolic_graph_t* const s
 
 int ccv_nnc_over_tensor_symbol_aliases(const ccv_nnc_tensor_symbol_info_t* const tensor_a, const ccv_nnc_tensor_symbol_info_t* const tensor_b);
 int ccv_nnc_tensor_symbol_map_raw(ccv_nnc_symbolic_graph_t* const graph, const ccv_nnc_tensor_symbol_t symbol);
+ccv_nnc_tensor_t* ccv_nnc_tensor_constant_copy(const ccv_nnc_tensor_param_t info, const ccv_nnc_tensor_t* const tensor);
 
 #endif
 
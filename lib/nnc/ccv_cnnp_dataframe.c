@@ -10,6 +10,7 @@
 #else
 #include "3rdparty/sfmt/SFMT.h"
 #endif
+#include <pthread.h>
 
 typedef struct {
 	ccv_array_t* columns;
@@ -167,6 +168,23 @@ typedef struct {
 
 KHASH_MAP_INIT_INT64(iter_ctx, ccv_cnnp_dataframe_column_ctx_t*)
 
+typedef struct {
+	int depth; // How many rows the producer keeps ready ahead of the consumer.
+	int slot_size; // One more than the depth, the extra one is the row held by the consumer.
+	int running; // Whether the producer thread is running (and need to be joined).
+	int stop; // Ask the producer thread to stop.
+	int produce_idx; // The next row the producer will prepare.
+	int head; // The slot the consumer will read next.
+	int ready; // How many slots are ready starting from the head.
+	int held; // The slot the consumer holds, -1 if none.
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t produced;
+	pthread_cond_t consumed;
+	ccv_nnc_stream_context_t** stream_contexts; // The stream context a slot handed out with, need to wait for it before reuse the slot.
+	ccv_cnnp_dataframe_data_item_t* slots; // The data of the slots, slot_size * column_size.
+} ccv_cnnp_dataframe_async_t;
+
 struct ccv_cnnp_dataframe_iter_s {
 	int flag; // Whether we called next or not.
 	int idx;
@@ -180,6 +198,7 @@ struct ccv_cnnp_dataframe_iter_s {
 	void** fetched_data; // The cache to store fetched data.
 	khash_t(iter_ctx)* column_ctx; // Column context specific to a stream context. The key will be a parent stream context and value will be child stream context + signal.
 	ccv_array_t* prefetches; // The prefetch contents.
+	ccv_cnnp_dataframe_async_t* async; // The background producer, only available for asynchronous iterator.
 	int* column_idxs;
 	ccv_cnnp_dataframe_data_item_t cached_data[1]; // The data cached when deriving data.
 };
@@ -209,6 +228,24 @@ ccv_cnnp_dataframe_iter_t* ccv_cnnp_dataframe_iter_new(ccv_cnnp_dataframe_t* con
 	return iter;
 }
 
+ccv_cnnp_dataframe_iter_t* ccv_cnnp_dataframe_async_iter_new(ccv_cnnp_dataframe_t* const dataframe, const int* const column_idxs, const int column_idx_size, const int depth)
+{
+	assert(depth > 0);
+	ccv_cnnp_dataframe_iter_t* const iter = ccv_cnnp_dataframe_iter_new(dataframe, column_idxs, column_idx_size);
+	const int slot_size = depth + 1;
+	ccv_cnnp_dataframe_async_t* const async = (ccv_cnnp_dataframe_async_t*)cccalloc(1, sizeof(ccv_cnnp_dataframe_async_t) + sizeof(ccv_nnc_stream_context_t*) * slot_size + sizeof(ccv_cnnp_dataframe_data_item_t) * slot_size * iter->column_size);
+	async->depth = depth;
+	async->slot_size = slot_size;
+	async->held = -1;
+	async->stream_contexts = (ccv_nnc_stream_context_t**)(async + 1);
+	async->slots = (ccv_cnnp_dataframe_data_item_t*)(async->stream_contexts + slot_size);
+	pthread_mutex_init(&async->mutex, 0);
+	pthread_cond_init(&async->produced, 0);
+	pthread_cond_init(&async->consumed, 0);
+	iter->async = async;
+	return iter;
+}
+
 static void _ccv_cnnp_dataframe_data_ctx_columns_free(ccv_cnnp_dataframe_t* const dataframe, ccv_array_t* const columns)
 {
 	int i, j;
@@ -412,10 +449,147 @@ static void _ccv_cnnp_dataframe_column_data(ccv_cnnp_dataframe_t* const datafram
 	}
 }
 
+// Push the data in the slot back to reusable state. If the slot was handed out with a stream context, the data
+// may still be in use on that stream context, wait for it first.
+static void _ccv_cnnp_dataframe_async_recycle(ccv_cnnp_dataframe_iter_t* const iter, const int slot)
+{
+	ccv_cnnp_dataframe_async_t* const async = iter->async;
+	if (async->stream_contexts[slot])
+	{
+		ccv_nnc_stream_context_wait(async->stream_contexts[slot]);
+		async->stream_contexts[slot] = 0;
+	}
+	const int column_size = iter->column_size;
+	ccv_cnnp_dataframe_data_item_t* const cached_data = async->slots + slot * column_size;
+	int i;
+	for (i = 0; i < column_size; i++)
+		if (cached_data[i].flag)
+		{
+			_ccv_cnnp_dataframe_enqueue_data(iter->dataframe, cached_data[i].data, i, cached_data[i].ctx);
+			cached_data[i].flag = 0;
+			cached_data[i].data = 0;
+			cached_data[i].ctx = 0;
+		}
+}
+
+// Prepare the next row into the slot after the ready ones. This is called with the mutex locked, and the mutex is
+// released while preparing the data, thus, the consumer can take the ready rows meanwhile.
+static void _ccv_cnnp_dataframe_async_produce(ccv_cnnp_dataframe_iter_t* const iter)
+{
+	ccv_cnnp_dataframe_async_t* const async = iter->async;
+	ccv_cnnp_dataframe_t* const dataframe = iter->dataframe;
+	int idx = async->produce_idx++;
+	const int slot = (async->head + async->ready) % async->slot_size;
+	pthread_mutex_unlock(&async->mutex);
+	_ccv_cnnp_dataframe_async_recycle(iter, slot);
+	ccv_cnnp_dataframe_data_item_t* const cached_data = async->slots + slot * iter->column_size;
+	// The rows are prepared without stream context, thus, these are ready to use by any stream context.
+	_ccv_cnnp_dataframe_prepare_data_ctx(dataframe, 0);
+	int i;
+	for (i = 0; i < iter->column_idx_size; i++)
+	{
+		void* fetched_data[1];
+		_ccv_cnnp_dataframe_column_data(dataframe, iter, cached_data, fetched_data, dataframe->shuffled_idx ? dataframe->shuffled_idx + idx : &idx, 1, iter->column_idxs[i], 1, 0);
+	}
+	pthread_mutex_lock(&async->mutex);
+	++async->ready;
+	pthread_cond_signal(&async->produced);
+}
+
+static void* _ccv_cnnp_dataframe_async_main(void* const userdata)
+{
+	ccv_cnnp_dataframe_iter_t* const iter = (ccv_cnnp_dataframe_iter_t*)userdata;
+	ccv_cnnp_dataframe_async_t* const async = iter->async;
+	const int row_count = iter->dataframe->row_count;
+	pthread_mutex_lock(&async->mutex);
+	for (;;)
+	{
+		// Wait until the consumer releases a slot, this is the backpressure.
+		while (!async->stop && async->produce_idx < row_count && async->ready + (async->held >= 0) >= async->slot_size)
+			pthread_cond_wait(&async->consumed, &async->mutex);
+		if (async->stop || async->produce_idx >= row_count)
+			break;
+		_ccv_cnnp_dataframe_async_produce(iter);
+	}
+	pthread_mutex_unlock(&async->mutex);
+	return 0;
+}
+
+// Start the producer thread if it is not running yet. This is called with the mutex locked.
+static void _ccv_cnnp_dataframe_async_start(ccv_cnnp_dataframe_iter_t* const iter)
+{
+	ccv_cnnp_dataframe_async_t* const async = iter->async;
+	if (async->running || async->produce_idx >= iter->dataframe->row_count)
+		return;
+	async->stop = 0;
+	async->running = (pthread_create(&async->thread, 0, _ccv_cnnp_dataframe_async_main, iter) == 0);
+}
+
+static void _ccv_cnnp_dataframe_async_stop(ccv_cnnp_dataframe_iter_t* const iter)
+{
+	ccv_cnnp_dataframe_async_t* const async = iter->async;
+	if (!async->running)
+		return;
+	pthread_mutex_lock(&async->mutex);
+	async->stop = 1;
+	pthread_cond_signal(&async->consumed);
+	pthread_mutex_unlock(&async->mutex);
+	pthread_join(async->thread, 0);
+	async->running = 0;
+}
+
+static int _ccv_cnnp_dataframe_async_iter_next(ccv_cnnp_dataframe_iter_t* const iter, void** const data_ref, const int column_idx_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	ccv_cnnp_dataframe_t* const dataframe = iter->dataframe;
+	ccv_cnnp_dataframe_async_t* const async = iter->async;
+	const int idx = iter->idx;
+	iter->flag = 1; // Mark it as we called next already.
+	pthread_mutex_lock(&async->mutex);
+	// Release the row held since the last call back to the producer.
+	if (async->held >= 0)
+	{
+		async->held = -1;
+		pthread_cond_signal(&async->consumed);
+	}
+	if (idx >= dataframe->row_count)
+	{
+		pthread_mutex_unlock(&async->mutex);
+		if (idx > dataframe->row_count) // If we exceed row count, return -2.
+			return -2;
+		++iter->idx;
+		return -1;
+	}
+	_ccv_cnnp_dataframe_async_start(iter);
+	while (!async->ready)
+	{
+		if (async->running)
+			pthread_cond_wait(&async->produced, &async->mutex);
+		else // Cannot start the producer thread, prepare the row on the caller's thread instead.
+			_ccv_cnnp_dataframe_async_produce(iter);
+	}
+	const int slot = async->head;
+	async->head = (async->head + 1) % async->slot_size;
+	--async->ready;
+	async->held = slot;
+	async->stream_contexts[slot] = stream_context;
+	pthread_mutex_unlock(&async->mutex);
+	const ccv_cnnp_dataframe_data_item_t* const cached_data = async->slots + slot * iter->column_size;
+	int i;
+	for (i = 0; i < column_idx_size; i++)
+		data_ref[i] = cached_data[iter->column_idxs[i]].data;
+	++iter->idx;
+	// Nothing left to prepare, join the producer thread such that the dataframe can be shuffled safely.
+	if (iter->idx == dataframe->row_count)
+		_ccv_cnnp_dataframe_async_stop(iter);
+	return 0;
+}
+
 int ccv_cnnp_dataframe_iter_next(ccv_cnnp_dataframe_iter_t* const iter, void** const data_ref, const int column_idx_size, ccv_nnc_stream_context_t* const stream_context)
 {
 	ccv_cnnp_dataframe_t* const dataframe = iter->dataframe;
 	assert(column_idx_size <= iter->column_idx_size);
+	if (iter->async)
+		return _ccv_cnnp_dataframe_async_iter_next(iter, data_ref, column_idx_size, stream_context);
 	const int column_size = dataframe->column_size + (dataframe->derived_column_data ? dataframe->derived_column_data->rnum : 0);
 	int i;
 	// Push existing data back to reusable state (note, these may not be reused immediately because they may be on a different stream context).
@@ -480,6 +654,15 @@ void ccv_cnnp_dataframe_iter_peek(ccv_cnnp_dataframe_iter_t* const iter, void**
 	assert(idx >= 0);
 	assert(idx < dataframe->row_count);
 	int i;
+	if (iter->async)
+	{
+		// All the columns of the row are prepared already.
+		assert(iter->async->held >= 0);
+		const ccv_cnnp_dataframe_data_item_t* const cached_data = iter->async->slots + iter->async->held * iter->column_size;
+		for (i = 0; i < data_ref_size; i++)
+			data_ref[i] = cached_data[iter->column_idxs[i + offset]].data;
+		return;
+	}
 	for (i = 0; i < data_ref_size; i++)
 		_ccv_cnnp_dataframe_column_data(dataframe, iter, iter->cached_data, data_ref + i, dataframe->shuffled_idx ? dataframe->shuffled_idx + idx : &idx, 1, iter->column_idxs[i + offset], 1, stream_context);
 }
@@ -559,6 +742,16 @@ int ccv_cnnp_dataframe_iter_prefetch(ccv_cnnp_dataframe_iter_t* const iter, cons
 {
 	ccv_cnnp_dataframe_t* const dataframe = iter->dataframe;
 	assert(dataframe);
+	if (iter->async)
+	{
+		// The producer thread prefetches in the background, only need to make sure it is running.
+		if (iter->idx >= dataframe->row_count)
+			return -1;
+		pthread_mutex_lock(&iter->async->mutex);
+		_ccv_cnnp_dataframe_async_start(iter);
+		pthread_mutex_unlock(&iter->async->mutex);
+		return 0;
+	}
 	const int column_size = dataframe->column_size + (dataframe->derived_column_data ? dataframe->derived_column_data->rnum : 0);
 	int i, j;
 	assert(iter->idx <= dataframe->row_count);
@@ -658,6 +851,18 @@ int ccv_cnnp_dataframe_iter_set_cursor(ccv_cnnp_dataframe_iter_t* const iter, co
 		return 0;
 	iter->idx = idx;
 	iter->flag = 0;
+	if (iter->async)
+	{
+		ccv_cnnp_dataframe_async_t* const async = iter->async;
+		_ccv_cnnp_dataframe_async_stop(iter);
+		// Push the ready rows back to reusable state, the row held by the consumer stays until the next call.
+		int i;
+		for (i = 0; i < async->ready; i++)
+			_ccv_cnnp_dataframe_async_recycle(iter, (async->head + i) % async->slot_size);
+		async->ready = 0;
+		async->produce_idx = idx;
+		return 0;
+	}
 	_ccv_cnnp_null_prefetches(iter);
 	return 0;
 }
@@ -667,6 +872,17 @@ void ccv_cnnp_dataframe_iter_free(ccv_cnnp_dataframe_iter_t* const iter)
 	ccv_cnnp_dataframe_t* const dataframe = iter->dataframe;
 	const int column_size = iter->column_size;
 	int i;
+	if (iter->async)
+	{
+		ccv_cnnp_dataframe_async_t* const async = iter->async;
+		_ccv_cnnp_dataframe_async_stop(iter);
+		for (i = 0; i < async->slot_size; i++)
+			_ccv_cnnp_dataframe_async_recycle(iter, i);
+		pthread_mutex_destroy(&async->mutex);
+		pthread_cond_destroy(&async->produced);
+		pthread_cond_destroy(&async->consumed);
+		ccfree(async);
+	}
 	// Push existing data back to reusable state (note, these may not be reused immediately because they may be on a different stream context).
 	for (i = 0; i < column_size; i++)
 		if (iter->cached_data[i].flag)
@@ -174,23 +174,50 @@ int ccv_cnnp_dataframe_read_image(ccv_cnnp_dataframe_t* const dataframe, const i
 	return ccv_cnnp_dataframe_map(dataframe, _ccv_cnnp_read_image, 0, _ccv_cnnp_image_deinit, COLUMN_ID_LIST(column_idx), (void*)(uintptr_t)structof, 0, name);
 }
 
+static void _ccv_cnnp_decode_image(void* const* const* const column_data, const int column_size, const int batch_size, void** const data, void* const context, ccv_nnc_stream_context_t* const stream_context)
+{
+	parallel_for(i, batch_size) {
+		if (data[i])
+			ccv_matrix_free(data[i]);
+		const ccv_cnnp_record_t* const record = (const ccv_cnnp_record_t*)column_data[0][i];
+		data[i] = 0;
+		if (record && record->size > 8) // Too small to be an image otherwise.
+			ccv_read(record->data, (ccv_dense_matrix_t**)&data[i], CCV_IO_ANY_STREAM | CCV_IO_RGB_COLOR, (int)record->size);
+	} parallel_endfor
+}
+
+int ccv_cnnp_dataframe_decode_image(ccv_cnnp_dataframe_t* const dataframe, const int column_idx, const char* name)
+{
+	return ccv_cnnp_dataframe_map(dataframe, _ccv_cnnp_decode_image, 0, _ccv_cnnp_image_deinit, COLUMN_ID_LIST(column_idx), 0, 0, name);
+}
+
 // MARK - Apply Random Jitter to Image
 
 typedef struct {
 	sfmt_t sfmt;
 	int datatype;
+	int format;
 	ccv_cnnp_random_jitter_t random_jitter;
 } ccv_cnnp_random_jitter_context_t;
 
+static void _ccv_cnnp_image_lighting_pca(float pca[3], const float alpha_r, const float alpha_g, const float alpha_b)
+{
+	// These eigenvector values can be computed out of imageNet dataset (see ccv_convnet for how that is done). Here I just copied
+	// from mxnet: https://github.com/apache/incubator-mxnet/blob/master/src/operator/image/image_random-inl.h#L632
+	pca[0] = alpha_r * (55.46 * -0.5675) + alpha_g * (4.794 * 0.7192) + alpha_b * (1.148 * 0.4009);
+	pca[1] = alpha_r * (55.46 * -0.5808) + alpha_g * (4.794 * -0.0045) + alpha_b * (1.148 * -0.8140);
+	pca[2] = alpha_r * (55.46 * -0.5836) + alpha_g * (4.794 * -0.6948) + alpha_b * (1.148 * 0.4203);
+}
+
 static void _ccv_cnnp_image_lighting(ccv_dense_matrix_t* image, const float alpha_r, const float alpha_g, const float alpha_b)
 {
 	assert(CCV_GET_DATA_TYPE(image->type) == CCV_32F);
 	assert(CCV_GET_CHANNEL(image->type) == CCV_C3);
-	// These eigenvector values can be computed out of imageNet dataset (see ccv_convnet for how that is done). Here I just copied
-	// from mxnet: https://github.com/apache/incubator-mxnet/blob/master/src/operator/image/image_random-inl.h#L632
-	const float pca_r = alpha_r * (55.46 * -0.5675) + alpha_g * (4.794 * 0.7192) + alpha_b * (1.148 * 0.4009);
-	const float pca_g = alpha_r * (55.46 * -0.5808) + alpha_g * (4.794 * -0.0045) + alpha_b * (1.148 * -0.8140);
-	const float pca_b = alpha_r * (55.46 * -0.5836) + alpha_g * (4.794 * -0.6948) + alpha_b * (1.148 * 0.4203);
+	float pca[3];
+	_ccv_cnnp_image_lighting_pca(pca, alpha_r, alpha_g, alpha_b);
+	const float pca_r = pca[0];
+	const float pca_g = pca[1];
+	const float pca_b = pca[2];
 	int i;
 	const int size = image->rows * image->cols;
 	float* const ptr = image->data.f32;
@@ -262,6 +289,84 @@ static void _ccv_cnnp_normalize(ccv_dense_matrix_t* const image, const float mea
 	}
 }
 
+typedef struct {
+	int resize_rows;
+	int resize_cols;
+	int need_crop;
+	int cropped; // Whether the crop is done on the original image already, the resize is the final size in that case.
+	int crop_x;
+	int crop_y;
+	ccv_rect_t slice; // The region from the original image to be resized.
+} ccv_cnnp_random_jitter_crop_t;
+
+static ccv_cnnp_random_jitter_crop_t _ccv_cnnp_random_jitter_crop(const int rows, const int cols, const ccv_cnnp_random_jitter_t random_jitter, sfmt_t* const sfmt)
+{
+	const int resize = ccv_clamp((int)(sfmt_genrand_real1(sfmt) * (random_jitter.resize.max - random_jitter.resize.min) + 0.5) + random_jitter.resize.min, random_jitter.resize.min, random_jitter.resize.max);
+	int resize_rows = ccv_max(resize, (int)(rows * (float)resize / cols + 0.5));
+	int resize_cols = ccv_max(resize, (int)(cols * (float)resize / rows + 0.5));
+	if (random_jitter.aspect_ratio > 0)
+	{
+		const float aspect_ratio = sqrtf(_ccv_cnnp_random_logexp(sfmt,  random_jitter.aspect_ratio));
+		resize_rows = (int)(resize_rows * aspect_ratio + 0.5);
+		resize_cols = (int)(resize_cols / aspect_ratio + 0.5);
+	}
+	if (random_jitter.resize.roundup > 0)
+	{
+		const int roundup = random_jitter.resize.roundup;
+		const int roundup_2 = roundup / 2;
+		resize_rows = (resize_rows + roundup_2) / roundup * roundup;
+		resize_cols = (resize_cols + roundup_2) / roundup * roundup;
+	}
+	ccv_cnnp_random_jitter_crop_t crop = {
+		.need_crop = (random_jitter.size.cols > 0 && random_jitter.size.rows > 0 &&
+			((resize_cols != random_jitter.size.cols || resize_rows != random_jitter.size.rows) ||
+			 (random_jitter.offset.x != 0 || random_jitter.offset.y != 0))),
+		.slice = ccv_rect(0, 0, cols, rows),
+	};
+	if (crop.need_crop)
+	{
+		// Compute crop x, y.
+		int crop_x = random_jitter.center_crop ?
+			(resize_cols - random_jitter.size.cols + 1) / 2 : // Otherwise, random select x.
+			(int)(sfmt_genrand_real1(sfmt) * (resize_cols - random_jitter.size.cols + 1));
+		crop_x = ccv_clamp(crop_x,
+			ccv_min(0, resize_cols - random_jitter.size.cols),
+			ccv_max(0, resize_cols - random_jitter.size.cols));
+		int crop_y = random_jitter.center_crop ?
+			(resize_rows - random_jitter.size.rows + 1) / 2 : // Otherwise, random select y.
+			(int)(sfmt_genrand_real1(sfmt) * (resize_rows - random_jitter.size.rows + 1));
+		crop_y = ccv_clamp(crop_y,
+			ccv_min(0, resize_rows - random_jitter.size.rows),
+			ccv_max(0, resize_rows - random_jitter.size.rows));
+		if (random_jitter.offset.x != 0)
+			crop_x += sfmt_genrand_real1(sfmt) * random_jitter.offset.x * 2 - random_jitter.offset.x;
+		if (random_jitter.offset.y != 0)
+			crop_y += sfmt_genrand_real1(sfmt) * random_jitter.offset.y * 2 - random_jitter.offset.y;
+		// If we can fill in the whole view (not introducing any 0 padding), we can first crop and then scale down / up.
+		if (resize_cols >= random_jitter.size.cols && resize_rows >= random_jitter.size.rows)
+		{
+			const float scale_x = (float)cols / resize_cols;
+			const float scale_y = (float)rows / resize_rows;
+			const int slice_cols = (int)(random_jitter.size.cols * scale_x + 0.5);
+			const int slice_rows = (int)(random_jitter.size.rows * scale_y + 0.5);
+			assert(slice_cols <= cols);
+			assert(slice_rows <= rows);
+			const int x = ccv_clamp((int)(crop_x * scale_x + 0.5), 0, cols - slice_cols);
+			const int y = ccv_clamp((int)(crop_y * scale_y + 0.5), 0, rows - slice_rows);
+			crop.slice = ccv_rect(x, y, slice_cols, slice_rows);
+			resize_cols = random_jitter.size.cols;
+			resize_rows = random_jitter.size.rows;
+			crop.cropped = 1;
+		} else {
+			crop.crop_x = crop_x;
+			crop.crop_y = crop_y;
+		}
+	}
+	crop.resize_rows = resize_rows;
+	crop.resize_cols = resize_cols;
+	return crop;
+}
+
 static void _ccv_cnnp_random_jitter(void* const* const* const column_data, const int column_size, const int batch_size, void** const data, void* const context, ccv_nnc_stream_context_t* const stream_context)
 {
 	sfmt_t* const sfmt = (sfmt_t*)ccmalloc(sizeof(sfmt_t) * batch_size);
@@ -276,64 +381,24 @@ static void _ccv_cnnp_random_jitter(void* const* const* const column_data, const
 		if (data[i])
 			ccv_matrix_free(data[i]);
 		ccv_dense_matrix_t* const input = (ccv_dense_matrix_t*)column_data[0][i];
-		const int resize = ccv_clamp((int)(sfmt_genrand_real1(&sfmt[i]) * (random_jitter.resize.max - random_jitter.resize.min) + 0.5) + random_jitter.resize.min, random_jitter.resize.min, random_jitter.resize.max);
-		int resize_rows = ccv_max(resize, (int)(input->rows * (float)resize / input->cols + 0.5));
-		int resize_cols = ccv_max(resize, (int)(input->cols * (float)resize / input->rows + 0.5));
-		if (random_jitter.aspect_ratio > 0)
-		{
-			const float aspect_ratio = sqrtf(_ccv_cnnp_random_logexp(&sfmt[i],  random_jitter.aspect_ratio));
-			resize_rows = (int)(resize_rows * aspect_ratio + 0.5);
-			resize_cols = (int)(resize_cols / aspect_ratio + 0.5);
-		}
-		if (random_jitter.resize.roundup > 0)
+		// No image (for example, the record cannot be read or decoded), fill in 0 at the final size if there is one.
+		if (!input)
 		{
-			const int roundup = random_jitter.resize.roundup;
-			const int roundup_2 = roundup / 2;
-			resize_rows = (resize_rows + roundup_2) / roundup * roundup;
-			resize_cols = (resize_cols + roundup_2) / roundup * roundup;
+			data[i] = 0;
+			if (random_jitter.size.rows > 0 && random_jitter.size.cols > 0)
+			{
+				data[i] = ccv_dense_matrix_new(random_jitter.size.rows, random_jitter.size.cols, CCV_32F | CCV_C3, 0, 0);
+				ccv_zero(data[i]);
+			}
+			continue;
 		}
-		const int need_crop = (random_jitter.size.cols > 0 && random_jitter.size.rows > 0 &&
-			((resize_cols != random_jitter.size.cols || resize_rows != random_jitter.size.rows) ||
-			 (random_jitter.offset.x != 0 || random_jitter.offset.y != 0)));
-		int cropped = 0, crop_x = 0, crop_y = 0;
+		const ccv_cnnp_random_jitter_crop_t crop = _ccv_cnnp_random_jitter_crop(input->rows, input->cols, random_jitter, &sfmt[i]);
+		const int resize_rows = crop.resize_rows;
+		const int resize_cols = crop.resize_cols;
 		ccv_dense_matrix_t* sliced = 0;
-		if (need_crop)
-		{
-			// Compute crop x, y.
-			crop_x = random_jitter.center_crop ?
-				(resize_cols - random_jitter.size.cols + 1) / 2 : // Otherwise, random select x.
-				(int)(sfmt_genrand_real1(&sfmt[i]) * (resize_cols - random_jitter.size.cols + 1));
-			crop_x = ccv_clamp(crop_x,
-				ccv_min(0, resize_cols - random_jitter.size.cols),
-				ccv_max(0, resize_cols - random_jitter.size.cols));
-			crop_y = random_jitter.center_crop ?
-				(resize_rows - random_jitter.size.rows + 1) / 2 : // Otherwise, random select y.
-				(int)(sfmt_genrand_real1(&sfmt[i]) * (resize_rows - random_jitter.size.rows + 1));
-			crop_y = ccv_clamp(crop_y,
-				ccv_min(0, resize_rows - random_jitter.size.rows),
-				ccv_max(0, resize_rows - random_jitter.size.rows));
-			if (random_jitter.offset.x != 0)
-				crop_x += sfmt_genrand_real1(&sfmt[i]) * random_jitter.offset.x * 2 - random_jitter.offset.x;
-			if (random_jitter.offset.y != 0)
-				crop_y += sfmt_genrand_real1(&sfmt[i]) * random_jitter.offset.y * 2 - random_jitter.offset.y;
-			// If we can fill in the whole view (not introducing any 0 padding), we can first crop and then scale down / up.
-			if (resize_cols >= random_jitter.size.cols && resize_rows >= random_jitter.size.rows)
-			{
-				const float scale_x = (float)input->cols / resize_cols;
-				const float scale_y = (float)input->rows / resize_rows;
-				const int slice_cols = (int)(random_jitter.size.cols * scale_x + 0.5);
-				const int slice_rows = (int)(random_jitter.size.rows * scale_y + 0.5);
-				assert(slice_cols <= input->cols);
-				assert(slice_rows <= input->rows);
-				const int x = ccv_clamp((int)(crop_x * scale_x + 0.5), 0, input->cols - slice_cols);
-				const int y = ccv_clamp((int)(crop_y * scale_y + 0.5), 0, input->rows - slice_rows);
-				ccv_slice(input, (ccv_matrix_t**)&sliced, 0, y, x, slice_rows, slice_cols);
-				resize_cols = random_jitter.size.cols;
-				resize_rows = random_jitter.size.rows;
-				cropped = 1;
-			} else
-				sliced = input;
-		} else
+		if (crop.cropped)
+			ccv_slice(input, (ccv_matrix_t**)&sliced, 0, crop.slice.y, crop.slice.x, crop.slice.height, crop.slice.width);
+		else
 			sliced = input;
 		ccv_dense_matrix_t* resized = 0;
 		// Resize.
@@ -359,9 +424,9 @@ static void _ccv_cnnp_random_jitter(void* const* const* const column_data, const
 		// If we haven't cropped in previous step (likely because we have some fill-ins due to the resize down too much).
 		// Do the crop now.
 		ccv_dense_matrix_t* patch = 0;
-		if (!cropped && need_crop)
+		if (!crop.cropped && crop.need_crop)
 		{
-			ccv_slice(resized, (ccv_matrix_t**)&patch, CCV_32F, crop_y, crop_x, random_jitter.size.rows, random_jitter.size.cols);
+			ccv_slice(resized, (ccv_matrix_t**)&patch, CCV_32F, crop.crop_y, crop.crop_x, random_jitter.size.rows, random_jitter.size.cols);
 			ccv_matrix_free(resized);
 		} else
 			patch = resized;
@@ -371,20 +436,27 @@ static void _ccv_cnnp_random_jitter(void* const* const* const column_data, const
 	ccfree(sfmt);
 }
 
-int ccv_cnnp_dataframe_image_random_jitter(ccv_cnnp_dataframe_t* const dataframe, const int column_idx, const int datatype, const ccv_cnnp_random_jitter_t random_jitter, const char* name)
+static ccv_cnnp_random_jitter_context_t* _ccv_cnnp_random_jitter_context_new(ccv_cnnp_dataframe_t* const dataframe, const int datatype, const int format, const ccv_cnnp_random_jitter_t random_jitter)
 {
-	assert(datatype == CCV_32F);
 	ccv_cnnp_random_jitter_context_t* const random_jitter_context = (ccv_cnnp_random_jitter_context_t*)ccmalloc(sizeof(ccv_cnnp_random_jitter_context_t));
 	if (random_jitter.seed)
 		sfmt_init_gen_rand(&random_jitter_context->sfmt, (uint32_t)random_jitter.seed);
 	else
 		sfmt_init_gen_rand(&random_jitter_context->sfmt, (uint32_t)(uintptr_t)dataframe);
 	random_jitter_context->datatype = datatype;
+	random_jitter_context->format = format;
 	random_jitter_context->random_jitter = random_jitter;
 	int i;
 	// The std in the random jitter should be inv_std.
 	for (i = 0; i < 3; i++)
 		random_jitter_context->random_jitter.normalize.std[i] = random_jitter_context->random_jitter.normalize.std[i] ? 1. / random_jitter_context->random_jitter.normalize.std[i] : 1;
+	return random_jitter_context;
+}
+
+int ccv_cnnp_dataframe_image_random_jitter(ccv_cnnp_dataframe_t* const dataframe, const int column_idx, const int datatype, const ccv_cnnp_random_jitter_t random_jitter, const char* name)
+{
+	assert(datatype == CCV_32F);
+	ccv_cnnp_random_jitter_context_t* const random_jitter_context = _ccv_cnnp_random_jitter_context_new(dataframe, datatype, CCV_TENSOR_FORMAT_NHWC, random_jitter);
 	return ccv_cnnp_dataframe_map(dataframe, _ccv_cnnp_random_jitter, 0, _ccv_cnnp_image_deinit, COLUMN_ID_LIST(column_idx), random_jitter_context, (ccv_cnnp_column_data_context_deinit_f)ccfree, name);
 }
 
@@ -496,6 +568,354 @@ CCV_WARN_UNUSED(int) ccv_cnnp_dataframe_copy_scalar(ccv_cnnp_dataframe_t* const
 	return ccv_cnnp_dataframe_map(dataframe, _ccv_cnnp_copy_scalar, 0, _ccv_cnnp_tensor_deinit, COLUMN_ID_LIST(column_idx), copy_scalar, (ccv_cnnp_column_data_context_deinit_f)ccfree, name);
 }
 
+// MARK - Apply Random Jitter to Image into Tensor
+
+// The color manipulations and the normalization are affine transforms on each pixel, except the lighting, which clamps
+// the pixel to [0, 255]. Thus, these collapse into at most two 3x3 matrices (with offsets), one before the clamp and
+// one after it.
+typedef struct {
+	int lighting; // Whether to clamp between the two transforms.
+	float m[2][9];
+	float o[2][3];
+} ccv_cnnp_image_affine_t;
+
+// m = s * m, o = s * o
+static void _ccv_cnnp_image_affine_mul(float m[9], float o[3], const float s[9])
+{
+	float r[9], t[3];
+	int i, j;
+	for (i = 0; i < 3; i++)
+	{
+		for (j = 0; j < 3; j++)
+			r[i * 3 + j] = s[i * 3] * m[j] + s[i * 3 + 1] * m[3 + j] + s[i * 3 + 2] * m[6 + j];
+		t[i] = s[i * 3] * o[0] + s[i * 3 + 1] * o[1] + s[i * 3 + 2] * o[2];
+	}
+	memcpy(m, r, sizeof(r));
+	memcpy(o, t, sizeof(t));
+}
+
+static void _ccv_cnnp_image_mean(const ccv_dense_matrix_t* const image, const ccv_rect_t rect, float mean[3])
+{
+	double sum[3] = {0, 0, 0};
+	int x, y;
+	for (y = rect.y; y < rect.y + rect.height; y++)
+	{
+		const unsigned char* const row = image->data.u8 + y * image->step + rect.x * 3;
+		unsigned int rs[3] = {0, 0, 0};
+		for (x = 0; x < rect.width; x++)
+		{
+			rs[0] += row[x * 3];
+			rs[1] += row[x * 3 + 1];
+			rs[2] += row[x * 3 + 2];
+		}
+		sum[0] += rs[0];
+		sum[1] += rs[1];
+		sum[2] += rs[2];
+	}
+	const double inv = 1.0 / ccv_max(rect.width * rect.height, 1);
+	mean[0] = sum[0] * inv;
+	mean[1] = sum[1] * inv;
+	mean[2] = sum[2] * inv;
+}
+
+// This draws the same random numbers in the same order as _ccv_cnnp_image_manip does. The contrast needs the mean of the
+// image, it is computed from the region of the original image, and carried through the transforms before it.
+static ccv_cnnp_image_affine_t _ccv_cnnp_image_manip_affine(const ccv_dense_matrix_t* const image, const ccv_rect_t slice, const ccv_cnnp_random_jitter_t random_jitter, sfmt_t* const sfmt)
+{
+	ccv_cnnp_image_affine_t affine = {
+		.m = {
+			{1, 0, 0, 0, 1, 0, 0, 0, 1},
+			{1, 0, 0, 0, 1, 0, 0, 0, 1},
+		},
+	};
+	float mean[3] = {0, 0, 0};
+	if (random_jitter.contrast != 0)
+		_ccv_cnnp_image_mean(image, slice, mean);
+	int idx[4] = {0, 1, 2, 3};
+	sfmt_genrand_shuffle(sfmt, idx, 4, sizeof(int));
+	int i, j;
+	for (i = 0; i < 4; i++)
+	{
+		float* const m = affine.m[affine.lighting];
+		float* const o = affine.o[affine.lighting];
+		switch (idx[i])
+		{
+			case 0: {
+				if (random_jitter.brightness == 0)
+					break;
+				const float ds = _ccv_cnnp_random_logexp(sfmt, random_jitter.brightness);
+				for (j = 0; j < 9; j++)
+					m[j] *= ds;
+				for (j = 0; j < 3; j++)
+					o[j] *= ds, mean[j] *= ds;
+				break;
+			}
+			case 1: {
+				if (random_jitter.saturation == 0)
+					break;
+				// The same as ccv_saturation, pixel = (pixel - gray) * ds + gray.
+				const float ds = _ccv_cnnp_random_logexp(sfmt, random_jitter.saturation);
+				const float s[9] = {
+					ds + (1 - ds) * 0.299, (1 - ds) * 0.587, (1 - ds) * 0.114,
+					(1 - ds) * 0.299, ds + (1 - ds) * 0.587, (1 - ds) * 0.114,
+					(1 - ds) * 0.299, (1 - ds) * 0.587, ds + (1 - ds) * 0.114,
+				};
+				_ccv_cnnp_image_affine_mul(m, o, s);
+				const float mean_r = mean[0], mean_g = mean[1], mean_b = mean[2];
+				for (j = 0; j < 3; j++)
+					mean[j] = s[j * 3] * mean_r + s[j * 3 + 1] * mean_g + s[j * 3 + 2] * mean_b;
+				break;
+			}
+			case 2: {
+				if (random_jitter.contrast == 0)
+					break;
+				// The same as ccv_contrast, pixel = (pixel - mean) * ds + mean.
+				const float ds = _ccv_cnnp_random_logexp(sfmt, random_jitter.contrast);
+				for (j = 0; j < 9; j++)
+					m[j] *= ds;
+				for (j = 0; j < 3; j++)
+					o[j] = o[j] * ds + mean[j] * (1 - ds);
+				break;
+			}
+			case 3: {
+				if (random_jitter.lighting == 0)
+					break;
+				float pca[3];
+				_ccv_cnnp_image_lighting_pca(pca, sfmt_genrand_real1(sfmt) * random_jitter.lighting, sfmt_genrand_real1(sfmt) * random_jitter.lighting, sfmt_genrand_real1(sfmt) * random_jitter.lighting);
+				for (j = 0; j < 3; j++)
+				{
+					o[j] += pca[j];
+					mean[j] = ccv_clamp(mean[j] + pca[j], 0, 255);
+				}
+				affine.lighting = 1; // Everything after this goes to the second transform.
+				break;
+			}
+		}
+	}
+	// Fold the normalization into the last transform.
+	float* const m = affine.m[affine.lighting];
+	float* const o = affine.o[affine.lighting];
+	for (i = 0; i < 3; i++)
+	{
+		const float inv_std = random_jitter.normalize.std[i];
+		for (j = 0; j < 3; j++)
+			m[i * 3 + j] *= inv_std;
+		o[i] = (o[i] - random_jitter.normalize.mean[i]) * inv_std;
+	}
+	return affine;
+}
+
+typedef struct {
+	int size; // The number of taps for each output pixel.
+	int start; // Output pixels in [start, end) have samples, the rest are 0 padding.
+	int end;
+	int* idx; // Offsets into the original image.
+	float* weight;
+} ccv_cnnp_image_taps_t;
+
+static int _ccv_cnnp_image_tap_size(const int resize_count, const int src_count)
+{
+	// Area sampling when scaling down, otherwise bilinear.
+	return src_count >= resize_count ? (int)ceilf((float)src_count / resize_count) + 1 : 2;
+}
+
+// The output pixels [0, count) are from the region [src_start, src_start + src_count) of the original image, resized
+// to resize_count, flipped if needed, and then cropped from offset.
+static void _ccv_cnnp_image_taps(ccv_cnnp_image_taps_t* const taps, const int count, const int offset, const int resize_count, const int src_start, const int src_count, const int flip, const int stride)
+{
+	const int size = taps->size;
+	taps->start = ccv_min(ccv_max(0, -offset), count);
+	taps->end = ccv_max(ccv_min(count, resize_count - offset), taps->start);
+	const double scale = (double)src_count / resize_count;
+	int i, j, k;
+	for (i = taps->start; i < taps->end; i++)
+	{
+		const int v = flip ? resize_count - 1 - (i + offset) : i + offset;
+		int* const idx = taps->idx + i * size;
+		float* const weight = taps->weight + i * size;
+		if (src_count >= resize_count)
+		{
+			const double a = v * scale;
+			const double b = (v + 1) * scale;
+			for (j = (int)a, k = 0; j < b && k < size; j++, k++)
+			{
+				idx[k] = (src_start + ccv_min(j, src_count - 1)) * stride;
+				weight[k] = (ccv_min(b, j + 1) - ccv_max(a, j)) / scale;
+			}
+		} else {
+			const double f = ccv_clamp((v + 0.5) * scale - 0.5, 0, src_count - 1);
+			const int x = (int)f;
+			idx[0] = (src_start + x) * stride;
+			weight[0] = 1 - (f - x);
+			idx[1] = (src_start + ccv_min(x + 1, src_count - 1)) * stride;
+			weight[1] = f - x;
+			k = 2;
+		}
+		for (; k < size; k++)
+		{
+			idx[k] = idx[0];
+			weight[k] = 0;
+		}
+	}
+}
+
+// Resample, crop, flip, manipulate colors and normalize in one pass, row by row, straight into the tensor.
+static void _ccv_cnnp_random_jitter_render(const ccv_dense_matrix_t* const input, const ccv_cnnp_random_jitter_crop_t crop, const int flip, const ccv_cnnp_image_affine_t* const affine, ccv_nnc_tensor_t* const tensor)
+{
+	const int nhwc = tensor->info.format == CCV_TENSOR_FORMAT_NHWC;
+	const int rows = nhwc ? tensor->info.dim[0] : tensor->info.dim[1];
+	const int cols = nhwc ? tensor->info.dim[1] : tensor->info.dim[2];
+	ccv_cnnp_image_taps_t xtaps = {
+		.size = _ccv_cnnp_image_tap_size(crop.resize_cols, crop.slice.width),
+	};
+	ccv_cnnp_image_taps_t ytaps = {
+		.size = _ccv_cnnp_image_tap_size(crop.resize_rows, crop.slice.height),
+	};
+	const int tap_count = cols * xtaps.size + rows * ytaps.size;
+	xtaps.idx = (int*)ccmalloc((sizeof(int) + sizeof(float)) * tap_count + sizeof(float) * cols * 3 * 2);
+	ytaps.idx = xtaps.idx + cols * xtaps.size;
+	xtaps.weight = (float*)(xtaps.idx + tap_count);
+	ytaps.weight = xtaps.weight + cols * xtaps.size;
+	float* const acc = ytaps.weight + rows * ytaps.size;
+	float* const out = acc + cols * 3;
+	_ccv_cnnp_image_taps(&xtaps, cols, crop.crop_x, crop.resize_cols, crop.slice.x, crop.slice.width, flip, 3);
+	_ccv_cnnp_image_taps(&ytaps, rows, crop.crop_y, crop.resize_rows, crop.slice.y, crop.slice.height, 0, input->step);
+	const float* const m0 = affine->m[0];
+	const float* const o0 = affine->o[0];
+	const float* const m1 = affine->m[1];
+	const float* const o1 = affine->o[1];
+	// The output pixels in NHWC are at out[x * 3 + c], in NCHW are at out[c * cols + x].
+	const int xs = nhwc ? 3 : 1;
+	const int cs = nhwc ? 1 : cols;
+	const size_t plane = (size_t)rows * cols;
+	int x, y, k, l;
+	for (y = 0; y < rows; y++)
+	{
+		memset(out, 0, sizeof(float) * cols * 3);
+		if (y >= ytaps.start && y < ytaps.end)
+		{
+			memset(acc, 0, sizeof(float) * cols * 3);
+			for (k = 0; k < ytaps.size; k++)
+			{
+				const float wy = ytaps.weight[y * ytaps.size + k];
+				if (wy == 0)
+					continue;
+				const unsigned char* const row = input->data.u8 + ytaps.idx[y * ytaps.size + k];
+				for (x = xtaps.start; x < xtaps.end; x++)
+				{
+					const int* const idx = xtaps.idx + x * xtaps.size;
+					const float* const weight = xtaps.weight + x * xtaps.size;
+					float r = 0, g = 0, b = 0;
+					for (l = 0; l < xtaps.size; l++)
+					{
+						const unsigned char* const p = row + idx[l];
+						r += p[0] * weight[l];
+						g += p[1] * weight[l];
+						b += p[2] * weight[l];
+					}
+					acc[x * 3] += r * wy;
+					acc[x * 3 + 1] += g * wy;
+					acc[x * 3 + 2] += b * wy;
+				}
+			}
+			for (x = xtaps.start; x < xtaps.end; x++)
+			{
+				const float r = acc[x * 3], g = acc[x * 3 + 1], b = acc[x * 3 + 2];
+				float v0 = m0[0] * r + m0[1] * g + m0[2] * b + o0[0];
+				float v1 = m0[3] * r + m0[4] * g + m0[5] * b + o0[1];
+				float v2 = m0[6] * r + m0[7] * g + m0[8] * b + o0[2];
+				if (affine->lighting)
+				{
+					const float c0 = ccv_clamp(v0, 0, 255), c1 = ccv_clamp(v1, 0, 255), c2 = ccv_clamp(v2, 0, 255);
+					v0 = m1[0] * c0 + m1[1] * c1 + m1[2] * c2 + o1[0];
+					v1 = m1[3] * c0 + m1[4] * c1 + m1[5] * c2 + o1[1];
+					v2 = m1[6] * c0 + m1[7] * c1 + m1[8] * c2 + o1[2];
+				}
+				out[x * xs] = v0;
+				out[x * xs + cs] = v1;
+				out[x * xs + cs * 2] = v2;
+			}
+		}
+		if (tensor->info.datatype == CCV_32F)
+		{
+			if (nhwc)
+				memcpy(tensor->data.f32 + (size_t)y * cols * 3, out, sizeof(float) * cols * 3);
+			else
+				for (k = 0; k < 3; k++)
+					memcpy(tensor->data.f32 + plane * k + (size_t)y * cols, out + cols * k, sizeof(float) * cols);
+		} else {
+			if (nhwc)
+				ccv_float_to_half_precision(out, (uint16_t*)(tensor->data.f16 + (size_t)y * cols * 3), cols * 3);
+			else
+				for (k = 0; k < 3; k++)
+					ccv_float_to_half_precision(out + cols * k, (uint16_t*)(tensor->data.f16 + plane * k + (size_t)y * cols), cols);
+		}
+	}
+	ccfree(xtaps.idx);
+}
+
+static void _ccv_cnnp_random_jitter_tensor(void* const* const* const column_data, const int column_size, const int batch_size, void** const data, void* const context, ccv_nnc_stream_context_t* const stream_context)
+{
+	sfmt_t* const sfmt = (sfmt_t*)ccmalloc(sizeof(sfmt_t) * batch_size);
+	ccv_cnnp_random_jitter_context_t* const ctx = (ccv_cnnp_random_jitter_context_t*)context;
+	int i;
+	for (i = 0; i < batch_size; i++)
+		sfmt_init_gen_rand(&sfmt[i], sfmt_genrand_uint32(&ctx->sfmt));
+	const ccv_cnnp_random_jitter_t random_jitter = ctx->random_jitter;
+	assert(random_jitter.resize.min > 0);
+	assert(random_jitter.resize.max >= random_jitter.resize.min);
+	parallel_for(i, batch_size) {
+		ccv_dense_matrix_t* const input = (ccv_dense_matrix_t*)column_data[0][i];
+		// No image, fill in 0 at the final size if there is one, the same as _ccv_cnnp_random_jitter does.
+		if (!input && (random_jitter.size.rows <= 0 || random_jitter.size.cols <= 0))
+		{
+			if (data[i])
+				ccv_nnc_tensor_free((ccv_nnc_tensor_t*)data[i]);
+			data[i] = 0;
+			continue;
+		}
+		assert(!input || CCV_GET_DATA_TYPE(input->type) == CCV_8U);
+		assert(!input || CCV_GET_CHANNEL(input->type) == CCV_C3);
+		// Draw the random numbers in the same order as _ccv_cnnp_random_jitter does.
+		const ccv_cnnp_random_jitter_crop_t crop = input ? _ccv_cnnp_random_jitter_crop(input->rows, input->cols, random_jitter, &sfmt[i]) : (ccv_cnnp_random_jitter_crop_t){};
+		const int rows = input && !crop.need_crop ? crop.resize_rows : random_jitter.size.rows;
+		const int cols = input && !crop.need_crop ? crop.resize_cols : random_jitter.size.cols;
+		ccv_nnc_tensor_param_t params = {
+			.type = CCV_TENSOR_CPU_MEMORY,
+			.format = ctx->format,
+			.datatype = ctx->datatype,
+		};
+		if (ctx->format == CCV_TENSOR_FORMAT_NHWC)
+		{
+			params.dim[0] = rows;
+			params.dim[1] = cols;
+			params.dim[2] = 3;
+		} else {
+			params.dim[0] = 3;
+			params.dim[1] = rows;
+			params.dim[2] = cols;
+		}
+		data[i] = data[i] ? ccv_nnc_tensor_resize((ccv_nnc_tensor_t*)data[i], params) : ccv_nnc_tensor_new(0, params, 0);
+		if (!input)
+		{
+			ccv_nnc_tensor_zero(data[i]);
+			continue;
+		}
+		const int flip = random_jitter.symmetric && (sfmt_genrand_uint32(&sfmt[i]) & 1) == 0;
+		const ccv_cnnp_image_affine_t affine = _ccv_cnnp_image_manip_affine(input, crop.slice, random_jitter, &sfmt[i]);
+		_ccv_cnnp_random_jitter_render(input, crop, flip, &affine, (ccv_nnc_tensor_t*)data[i]);
+	} parallel_endfor
+	ccfree(sfmt);
+}
+
+int ccv_cnnp_dataframe_image_random_jitter_tensor(ccv_cnnp_dataframe_t* const dataframe, const int column_idx, const int datatype, const int format, const ccv_cnnp_random_jitter_t random_jitter, const char* name)
+{
+	assert(datatype == CCV_32F || datatype == CCV_16F);
+	assert(format == CCV_TENSOR_FORMAT_NHWC || format == CCV_TENSOR_FORMAT_NCHW);
+	ccv_cnnp_random_jitter_context_t* const random_jitter_context = _ccv_cnnp_random_jitter_context_new(dataframe, datatype, format, random_jitter);
+	return ccv_cnnp_dataframe_map(dataframe, _ccv_cnnp_random_jitter_tensor, 0, _ccv_cnnp_tensor_deinit, COLUMN_ID_LIST(column_idx), random_jitter_context, (ccv_cnnp_column_data_context_deinit_f)ccfree, name);
+}
+
 // MARK - Matrix of Ones
 
 typedef struct {
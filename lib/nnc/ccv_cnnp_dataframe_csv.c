@@ -5,6 +5,12 @@
 #include "_ccv_cnnp_dataframe.h"
 
 #include <sys/mman.h>
+#if defined(HAVE_SSE2)
+#include <emmintrin.h>
+#endif
+#ifdef CCV_NNC_CPU_DISPATCH
+#include <immintrin.h>
+#endif
 
 // MARK - Create Dataframe from Comma-separated-values Files
 
@@ -16,12 +22,154 @@ typedef struct {
 	int quotes;
 } csv_crlf_t;
 
-#define ANY_ZEROS(v) ((v - (uint64_t)0x0101010101010101) & ((~v) & (uint64_t)0x8080808080808080))
+// Find the quotes, delimiters and line feeds in the 64 bytes starting from p, as bitmasks (in that order), bit n is for p[n].
+typedef void (*ccv_cnnp_csv_scan_f)(const char* const p, const char quote, const char delim, uint64_t masks[3]);
+
+#if !defined(HAVE_SSE2)
+static void _ccv_cnnp_csv_scan(const char* const p, const char quote, const char delim, uint64_t masks[3])
+{
+	uint64_t mq = 0, md = 0, ml = 0;
+	int i;
+	for (i = 0; i < 64; i++)
+	{
+		mq |= (uint64_t)(p[i] == quote) << i;
+		md |= (uint64_t)(p[i] == delim) << i;
+		ml |= (uint64_t)(p[i] == '\n') << i;
+	}
+	masks[0] = mq;
+	masks[1] = md;
+	masks[2] = ml;
+}
+#else
+static void _ccv_cnnp_csv_scan_sse2(const char* const p, const char quote, const char delim, uint64_t masks[3])
+{
+	const __m128i q = _mm_set1_epi8(quote);
+	const __m128i d = _mm_set1_epi8(delim);
+	const __m128i lf = _mm_set1_epi8('\n');
+	uint64_t mq = 0, md = 0, ml = 0;
+	int i;
+	for (i = 0; i < 4; i++)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i*)(p + i * 16));
+		mq |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, q)) << (i * 16);
+		md |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, d)) << (i * 16);
+		ml |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, lf)) << (i * 16);
+	}
+	masks[0] = mq;
+	masks[1] = md;
+	masks[2] = ml;
+}
+#endif
+
+#ifdef CCV_NNC_CPU_DISPATCH
+__attribute__((target("avx2"))) static void _ccv_cnnp_csv_scan_avx2(const char* const p, const char quote, const char delim, uint64_t masks[3])
+{
+	const __m256i q = _mm256_set1_epi8(quote);
+	const __m256i d = _mm256_set1_epi8(delim);
+	const __m256i lf = _mm256_set1_epi8('\n');
+	const __m256i v0 = _mm256_loadu_si256((const __m256i*)p);
+	const __m256i v1 = _mm256_loadu_si256((const __m256i*)(p + 32));
+	masks[0] = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v0, q)) | ((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, q)) << 32);
+	masks[1] = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v0, d)) | ((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, d)) << 32);
+	masks[2] = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v0, lf)) | ((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, lf)) << 32);
+}
+#endif
+
+static ccv_cnnp_csv_scan_f _ccv_cnnp_csv_scan_select(void)
+{
+#ifdef CCV_NNC_CPU_DISPATCH
+	if (ccv_nnc_cpu_features() & CCV_NNC_CPU_FEATURE_AVX2)
+		return _ccv_cnnp_csv_scan_avx2;
+#endif
+#if defined(HAVE_SSE2)
+	return _ccv_cnnp_csv_scan_sse2;
+#else
+	return _ccv_cnnp_csv_scan;
+#endif
+}
+
+static inline int _ccv_cnnp_csv_ctz(const uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(v);
+#else
+	int n = 0;
+	while (!((v >> n) & 1))
+		++n;
+	return n;
+#endif
+}
+
+static inline int _ccv_cnnp_csv_popcount(uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_popcountll(v);
+#else
+	int n = 0;
+	for (; v; v &= v - 1)
+		++n;
+	return n;
+#endif
+}
+
+// Count the line ends in [p_start, p_start + size) separately for the ones after even and odd number of quotes, because
+// we don't know whether the region starts inside a quote yet. The starter is the offset of the first one for each.
+static void _ccv_cnnp_csv_line_ends(const ccv_cnnp_csv_scan_f scan, const char* const p_start, const size_t size, const char quote, const char delim, int* const quotes, int starter[2], int count[2])
+{
+	size_t i;
+	uint64_t masks[3];
+	for (i = 0; i + 64 <= size; i += 64)
+	{
+		scan(p_start + i, quote, delim, masks);
+		const uint64_t mq = masks[0];
+		const uint64_t ml = masks[2];
+		if (!mq)
+		{
+			// No quotes, all the line ends are on the same side.
+			if (ml)
+			{
+				const int parity = *quotes & 1;
+				count[parity] += _ccv_cnnp_csv_popcount(ml);
+				if (starter[parity] == -1)
+					starter[parity] = (int)i + _ccv_cnnp_csv_ctz(ml);
+			}
+			continue;
+		}
+		uint64_t m = mq | ml;
+		while (m)
+		{
+			const int n = _ccv_cnnp_csv_ctz(m);
+			m &= m - 1;
+			if ((mq >> n) & 1)
+				++*quotes;
+			else {
+				const int parity = *quotes & 1;
+				++count[parity];
+				if (starter[parity] == -1)
+					starter[parity] = (int)i + n;
+			}
+		}
+	}
+	for (; i < size; i++)
+	{
+		if (p_start[i] == quote)
+			++*quotes;
+		else if (p_start[i] == '\n') {
+			const int parity = *quotes & 1;
+			++count[parity];
+			if (starter[parity] == -1)
+				starter[parity] = (int)i;
+		}
+	}
+}
 
 static inline void _fix_double_quote(const char* src, int count, char* dest)
 {
 	if (!src || count <= 0)
+	{
+		dest[0] = '\0';
 		return;
+	}
 	char prev_char = src[0];
 	dest[0] = src[0];
 	++dest;
@@ -189,38 +337,12 @@ ccv_cnnp_dataframe_t* ccv_cnnp_dataframe_from_csv_new(void* const input, const i
 	const int total_chunks = (file_size + chunk_size - 1) / chunk_size;
 	// Get number of rows.
 	csv_crlf_t* const crlf = cccalloc(total_chunks, sizeof(csv_crlf_t));
-#define CSV_QUOTE_BR(c, n) \
-	do { \
-		if (c##n == quote) \
-			++quotes; \
-		else if (c##n == '\n') { \
-			++count[quotes & 1]; \
-			if (starter[quotes & 1] == -1) \
-				starter[quotes & 1] = (int)(p - p_start) + n; \
-		} \
-	} while (0)
+	const ccv_cnnp_csv_scan_f scan = _ccv_cnnp_csv_scan_select();
 	parallel_for(i, aligned_chunks) {
-		const uint64_t* pd = (const uint64_t*)(data + i * chunk_size);
-		const char* const p_start = (const char*)pd;
-		const uint64_t* const pd_end = pd + chunk_size / sizeof(uint64_t);
 		int quotes = 0;
 		int starter[2] = {-1, -1};
 		int count[2] = {0, 0};
-		for (; pd < pd_end; pd++)
-		{
-			// Load 8-bytes at batch.
-			const char* const p = (const char*)pd;
-			char c0, c1, c2, c3, c4, c5, c6, c7;
-			c0 = p[0], c1 = p[1], c2 = p[2], c3 = p[3], c4 = p[4], c5 = p[5], c6 = p[6], c7 = p[7];
-			CSV_QUOTE_BR(c, 0);
-			CSV_QUOTE_BR(c, 1);
-			CSV_QUOTE_BR(c, 2);
-			CSV_QUOTE_BR(c, 3);
-			CSV_QUOTE_BR(c, 4);
-			CSV_QUOTE_BR(c, 5);
-			CSV_QUOTE_BR(c, 6);
-			CSV_QUOTE_BR(c, 7);
-		}
+		_ccv_cnnp_csv_line_ends(scan, data + i * chunk_size, chunk_size, quote, delim, &quotes, starter, count);
 		crlf[i].even = count[0];
 		crlf[i].odd = count[1];
 		crlf[i].even_starter = starter[0];
@@ -230,41 +352,16 @@ ccv_cnnp_dataframe_t* ccv_cnnp_dataframe_from_csv_new(void* const input, const i
 	if (total_chunks > aligned_chunks)
 	{
 		const int residual_size = file_size - chunk_size * aligned_chunks;
-		const uint64_t* pd = (const uint64_t*)(data + chunk_size * aligned_chunks);
-		const char* const p_start = (const char*)pd;
-		const uint64_t* const pd_end = pd + residual_size / sizeof(uint64_t);
 		int quotes = 0;
 		int starter[2] = {-1, -1};
 		int count[2] = {0, 0};
-		for (; pd < pd_end; pd++)
-		{
-			const char* const p = (const char*)pd;
-			// Load 8-bytes at batch.
-			char c0, c1, c2, c3, c4, c5, c6, c7;
-			c0 = p[0], c1 = p[1], c2 = p[2], c3 = p[3], c4 = p[4], c5 = p[5], c6 = p[6], c7 = p[7];
-			CSV_QUOTE_BR(c, 0);
-			CSV_QUOTE_BR(c, 1);
-			CSV_QUOTE_BR(c, 2);
-			CSV_QUOTE_BR(c, 3);
-			CSV_QUOTE_BR(c, 4);
-			CSV_QUOTE_BR(c, 5);
-			CSV_QUOTE_BR(c, 6);
-			CSV_QUOTE_BR(c, 7);
-		}
-		const char* const p_end = data + file_size;
-		const char* p = (const char*)pd_end;
-		for (; p < p_end; p++)
-		{
-			const char c0 = p[0];
-			CSV_QUOTE_BR(c, 0);
-		}
+		_ccv_cnnp_csv_line_ends(scan, data + chunk_size * aligned_chunks, residual_size, quote, delim, &quotes, starter, count);
 		crlf[aligned_chunks].even = count[0];
 		crlf[aligned_chunks].odd = count[1];
 		crlf[aligned_chunks].even_starter = starter[0] < 0 ? residual_size : starter[0];
 		crlf[aligned_chunks].odd_starter = starter[1] < 0 ? residual_size : starter[1];
 		crlf[aligned_chunks].quotes = quotes;
 	}
-#undef CSV_QUOTE_BR
 	int row_count = crlf[0].even;
 	int quotes = crlf[0].quotes;
 	crlf[0].odd_starter = 0;
@@ -344,10 +441,6 @@ ccv_cnnp_dataframe_t* ccv_cnnp_dataframe_from_csv_new(void* const input, const i
 	csv->include_header = !!include_header;
 	ccv_cnnp_csv_str_view_t* const sp = (ccv_cnnp_csv_str_view_t*)(csv + 1);
 	memset(sp, 0, sizeof(ccv_cnnp_csv_str_view_t) * row_count * column_count);
-	const uint64_t delim_mask = (uint64_t)0x0101010101010101 * (uint64_t)delim;
-	const uint64_t quote_mask = (uint64_t)0x0101010101010101 * (uint64_t)quote;
-	const uint64_t lf_mask = (uint64_t)0x0101010101010101 * (uint64_t)'\n';
-	const uint64_t cr_mask = (uint64_t)0x0101010101010101 * (uint64_t)'\r';
 #define CSV_QUOTE_BR(c, n) \
 	do { \
 		if (c##n == quote) \
@@ -440,43 +533,31 @@ ccv_cnnp_dataframe_t* ccv_cnnp_dataframe_from_csv_new(void* const input, const i
 		int preceding_quote = 0;
 		int double_quote = 0;
 		const char* quote_end = 0;
-		const int padding = ccv_min(0x7 - (((uintptr_t)p - 1) & 0x7), (int)(p_end - p));
-		for (j = 0; j < padding; j++, p++)
+		// Only visit the quotes, delimiters and line feeds. Any other character in between resets preceding_quote.
+		const char* last = p - 1;
+		const char* block = p;
+		uint64_t masks[3];
+		for (; block + 64 <= p_end; block += 64)
 		{
-			char c0 = p[0];
-			CSV_QUOTE_BR(c, 0);
-		}
-		const size_t cur_chunk_size = (size_t)(p_end - p);
-		const uint64_t* pd = (const uint64_t*)p;
-		const uint64_t* pd_end = pd + cur_chunk_size / sizeof(uint64_t);
-		for (; pd < pd_end; pd++)
-		{
-			const uint64_t v = *pd;
-			const uint64_t delim_v = v ^ delim_mask;
-			const uint64_t quote_v = v ^ quote_mask;
-			const uint64_t lf_v = v ^ lf_mask;
-			const uint64_t cr_v = v ^ cr_mask;
-			// If it doesn't contain any zeros, skip the logic.
-			if (!ANY_ZEROS(delim_v) && !ANY_ZEROS(quote_v) && !ANY_ZEROS(lf_v) && !ANY_ZEROS(cr_v))
-				continue;
-			// Need to check and assign the length and starting point.
-			p = (const char*)pd;
-			// Load 8-bytes at batch.
-			char c0, c1, c2, c3, c4, c5, c6, c7;
-			c0 = p[0], c1 = p[1], c2 = p[2], c3 = p[3], c4 = p[4], c5 = p[5], c6 = p[6], c7 = p[7];
-			CSV_QUOTE_BR(c, 0);
-			CSV_QUOTE_BR(c, 1);
-			CSV_QUOTE_BR(c, 2);
-			CSV_QUOTE_BR(c, 3);
-			CSV_QUOTE_BR(c, 4);
-			CSV_QUOTE_BR(c, 5);
-			CSV_QUOTE_BR(c, 6);
-			CSV_QUOTE_BR(c, 7);
+			scan(block, quote, delim, masks);
+			uint64_t m = masks[0] | masks[1] | masks[2];
+			while (m)
+			{
+				const int n = _ccv_cnnp_csv_ctz(m);
+				m &= m - 1;
+				p = block + n;
+				if (p != last + 1)
+					preceding_quote = 0;
+				const char c0 = p[0];
+				CSV_QUOTE_BR(c, 0);
+				last = p;
+			}
 		}
-		p = (const char*)pd;
-		for (; p < p_end; p++)
+		if (block != last + 1)
+			preceding_quote = 0;
+		for (p = block; p < p_end; p++)
 		{
-			char c0 = p[0];
+			const char c0 = p[0];
 			CSV_QUOTE_BR(c, 0);
 		}
 		if (chunk_row_count < row_count && chunk_column_count < column_count)
@@ -529,3 +610,169 @@ ccv_cnnp_dataframe_t* ccv_cnnp_dataframe_from_csv_new(void* const input, const i
 	ccfree(column_data);
 	return dataframe;
 }
+
+// MARK - Parse Columns of Comma-separated-values Files into Numerics
+
+typedef struct {
+	int datatype;
+	int column_size;
+	ccv_numeric_data_t values; // row_count * column_size values, one row after another.
+} ccv_cnnp_csv_numeric_t;
+
+static void _ccv_cnnp_csv_numeric_enum(const int column_idx, const int* const row_idxs, const int row_size, void** const data, void* const context, ccv_nnc_stream_context_t* const stream_context)
+{
+	ccv_cnnp_csv_numeric_t* const numeric = (ccv_cnnp_csv_numeric_t*)context;
+	const size_t row_step = (size_t)CCV_GET_DATA_TYPE_SIZE(numeric->datatype) * numeric->column_size;
+	const ccv_nnc_tensor_param_t params = {
+		.type = CCV_TENSOR_CPU_MEMORY,
+		.format = CCV_TENSOR_FORMAT_NHWC,
+		.datatype = numeric->datatype,
+		.dim = {
+			numeric->column_size,
+		},
+	};
+	int i;
+	// No copy, the tensor points to the parsed values directly.
+	for (i = 0; i < row_size; i++)
+	{
+		unsigned char* const ptr = numeric->values.u8 + row_step * row_idxs[i];
+		if (data[i])
+			((ccv_nnc_tensor_t*)data[i])->data.u8 = ptr;
+		else
+			data[i] = ccv_nnc_tensor_new(ptr, params, 0);
+	}
+}
+
+static void _ccv_cnnp_csv_numeric_data_deinit(void* const data, void* const context)
+{
+	ccv_nnc_tensor_free((ccv_nnc_tensor_t*)data);
+}
+
+static void _ccv_cnnp_csv_numeric_deinit(void* const context)
+{
+	ccv_cnnp_csv_numeric_t* const numeric = (ccv_cnnp_csv_numeric_t*)context;
+	ccfree(numeric->values.u8);
+	ccfree(numeric);
+}
+
+// Parse a plain decimal, [+-]digits[.digits][(e|E)[+-]digits], returns 0 if it is something else (or too many digits), thus, it
+// needs to go to the slower strtod. When the mantissa and the power of 10 are both exact in double, the result is exact too.
+static int _ccv_cnnp_csv_parse_decimal(const char* p, const char* const p_end, double* const value)
+{
+	int negative = 0;
+	if (p < p_end && (*p == '-' || *p == '+'))
+		negative = (*p++ == '-');
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	for (; p < p_end && *p >= '0' && *p <= '9'; p++, digits++)
+		mantissa = mantissa * 10 + (*p - '0');
+	if (p < p_end && *p == '.')
+		for (++p; p < p_end && *p >= '0' && *p <= '9'; p++, digits++, exponent--)
+			mantissa = mantissa * 10 + (*p - '0');
+	if (digits == 0 || digits > 15)
+		return 0;
+	if (p < p_end && (*p == 'e' || *p == 'E'))
+	{
+		++p;
+		int exp_negative = 0;
+		if (p < p_end && (*p == '-' || *p == '+'))
+			exp_negative = (*p++ == '-');
+		if (p == p_end || *p < '0' || *p > '9')
+			return 0;
+		int e = 0;
+		for (; p < p_end && *p >= '0' && *p <= '9' && e < 1000; p++)
+			e = e * 10 + (*p - '0');
+		exponent += exp_negative ? -e : e;
+	}
+	if (p != p_end || exponent < -22 || exponent > 22)
+		return 0;
+	static const double pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+	};
+	const double v = exponent < 0 ? (double)mantissa / pow10[-exponent] : (double)mantissa * pow10[exponent];
+	*value = negative ? -v : v;
+	return 1;
+}
+
+static void _ccv_cnnp_csv_trim(const char** const p, int* const count)
+{
+	while (*count > 0 && ((*p)[0] == ' ' || (*p)[0] == '\t'))
+		++*p, --*count;
+	while (*count > 0 && ((*p)[*count - 1] == ' ' || (*p)[*count - 1] == '\t' || (*p)[*count - 1] == '\r'))
+		--*count;
+}
+
+static float _ccv_cnnp_csv_parse_float(const char* str, int count)
+{
+	_ccv_cnnp_csv_trim(&str, &count);
+	if (count <= 0)
+		return 0;
+	double value;
+	if (_ccv_cnnp_csv_parse_decimal(str, str + count, &value))
+		return (float)value;
+	// The cell is not null-terminated, and there is no numeric needs more than 64 characters.
+	char buf[64];
+	count = ccv_min(count, (int)sizeof(buf) - 1);
+	memcpy(buf, str, count);
+	buf[count] = 0;
+	char* end = buf;
+	const float f = strtof(buf, &end);
+	return end != buf ? f : 0;
+}
+
+static int _ccv_cnnp_csv_parse_int(const char* str, int count)
+{
+	_ccv_cnnp_csv_trim(&str, &count);
+	if (count <= 0)
+		return 0;
+	char buf[64];
+	count = ccv_min(count, (int)sizeof(buf) - 1);
+	memcpy(buf, str, count);
+	buf[count] = 0;
+	char* end = buf;
+	const long value = strtol(buf, &end, 10);
+	return end != buf ? (int)value : 0;
+}
+
+int ccv_cnnp_dataframe_csv_numeric(ccv_cnnp_dataframe_t* const dataframe, const int* const column_idxs, const int column_idx_size, const int datatype, const char* name)
+{
+	assert(column_idx_size > 0);
+	assert(datatype == CCV_32F || datatype == CCV_32S);
+	const ccv_cnnp_csv_t* const csv = (const ccv_cnnp_csv_t*)ccv_cnnp_dataframe_column_context(dataframe, column_idxs[0]);
+	const int column_size = csv->column_size;
+	int i;
+	for (i = 0; i < column_idx_size; i++)
+	{
+		assert(column_idxs[i] >= 0 && column_idxs[i] < column_size);
+		assert(ccv_cnnp_dataframe_column_context(dataframe, column_idxs[i]) == csv);
+	}
+	const int row_count = ccv_cnnp_dataframe_row_count(dataframe);
+	ccv_cnnp_csv_numeric_t* const numeric = (ccv_cnnp_csv_numeric_t*)ccmalloc(sizeof(ccv_cnnp_csv_numeric_t));
+	numeric->datatype = datatype;
+	numeric->column_size = column_idx_size;
+	numeric->values.u8 = (unsigned char*)ccmalloc((size_t)CCV_GET_DATA_TYPE_SIZE(datatype) * column_idx_size * ccv_max(row_count, 1));
+	const ccv_cnnp_csv_str_view_t* const sp = (const ccv_cnnp_csv_str_view_t*)(csv + 1) + csv->include_header * column_size;
+	const char* const p_end = csv->data + csv->file_size;
+	// Parse once, all the rows in parallel.
+	parallel_for(i, row_count) {
+		int j;
+		for (j = 0; j < column_idx_size; j++)
+		{
+			const ccv_cnnp_csv_str_view_t* const csp = sp + (size_t)i * column_size + column_idxs[j];
+			const char* str = 0;
+			int count = 0;
+			if (((uint64_t*)csp)[0] != 0)
+			{
+				str = csv->data + csp->str;
+				count = csp->count == 0x7fff ? (int)ccv_min(p_end - str, 0x7fff) : csp->count;
+			}
+			if (datatype == CCV_32F)
+				numeric->values.f32[(size_t)i * column_idx_size + j] = _ccv_cnnp_csv_parse_float(str, count);
+			else
+				numeric->values.i32[(size_t)i * column_idx_size + j] = _ccv_cnnp_csv_parse_int(str, count);
+		}
+	} parallel_endfor
+	return ccv_cnnp_dataframe_add(dataframe, _ccv_cnnp_csv_numeric_enum, 0, _ccv_cnnp_csv_numeric_data_deinit, numeric, _ccv_cnnp_csv_numeric_deinit, name);
+}
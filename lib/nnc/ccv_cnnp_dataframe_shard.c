@@ -0,0 +1,404 @@
+#include "ccv_nnc.h"
+#include "ccv_nnc_easy.h"
+#include "ccv_nnc_internal.h"
+#include "ccv_internal.h"
+#include "_ccv_cnnp_dataframe.h"
+#include "3rdparty/sfmt/SFMT.h"
+
+// MARK - Sharded Record Files
+
+// A shard is a sequential container of records, followed by the index of these records:
+// | magic | version | reserved | data 0 | meta 0 | data 1 | meta 1 | ... | index | footer |
+// Each index entry is a ccv_cnnp_shard_index_t, and the footer is a ccv_cnnp_shard_footer_t. Everything is in host
+// byte order. Records are written back to back, thus, a range of records can be read with one sequential read.
+
+#define CCV_CNNP_SHARD_MAGIC "CCVSHARD"
+#define CCV_CNNP_SHARD_VERSION (1)
+#define CCV_CNNP_SHARD_HEADER_SIZE (16)
+#define CCV_CNNP_SHARD_BUFFER_SIZE (64 * 1024 * 1024)
+
+typedef struct {
+	uint64_t offset; // The offset to the data of the record, the meta follows the data.
+	uint32_t size;
+	uint32_t meta_size;
+} ccv_cnnp_shard_index_t;
+
+typedef struct {
+	uint64_t index_offset;
+	uint64_t record_count;
+	char magic[8];
+} ccv_cnnp_shard_footer_t;
+
+struct ccv_cnnp_shard_writer_s {
+	FILE* w;
+	int error;
+	uint64_t offset;
+	ccv_array_t* index;
+};
+
+ccv_cnnp_shard_writer_t* ccv_cnnp_shard_writer_new(const char* const filename)
+{
+	FILE* const w = fopen(filename, "wb");
+	if (!w)
+		return 0;
+	const uint32_t header[2] = {
+		CCV_CNNP_SHARD_VERSION, 0
+	};
+	if (fwrite(CCV_CNNP_SHARD_MAGIC, 1, 8, w) != 8 || fwrite(header, sizeof(header), 1, w) != 1)
+	{
+		fclose(w);
+		return 0;
+	}
+	ccv_cnnp_shard_writer_t* const writer = (ccv_cnnp_shard_writer_t*)ccmalloc(sizeof(ccv_cnnp_shard_writer_t));
+	writer->w = w;
+	writer->error = 0;
+	writer->offset = CCV_CNNP_SHARD_HEADER_SIZE;
+	writer->index = ccv_array_new(sizeof(ccv_cnnp_shard_index_t), 64, 0);
+	return writer;
+}
+
+int ccv_cnnp_shard_writer_add(ccv_cnnp_shard_writer_t* const writer, const void* const data, const size_t size, const void* const meta, const size_t meta_size)
+{
+	if (writer->error || size > UINT32_MAX || meta_size > UINT32_MAX)
+		return -1;
+	if ((size > 0 && fwrite(data, 1, size, writer->w) != size) ||
+		(meta_size > 0 && fwrite(meta, 1, meta_size, writer->w) != meta_size))
+	{
+		writer->error = 1;
+		return -1;
+	}
+	const ccv_cnnp_shard_index_t index = {
+		.offset = writer->offset,
+		.size = (uint32_t)size,
+		.meta_size = (uint32_t)meta_size,
+	};
+	ccv_array_push(writer->index, &index);
+	writer->offset += size + meta_size;
+	return 0;
+}
+
+int ccv_cnnp_shard_writer_free(ccv_cnnp_shard_writer_t* const writer)
+{
+	int error = writer->error;
+	if (!error)
+	{
+		ccv_cnnp_shard_footer_t footer = {
+			.index_offset = writer->offset,
+			.record_count = writer->index->rnum,
+		};
+		memcpy(footer.magic, CCV_CNNP_SHARD_MAGIC, 8);
+		if ((writer->index->rnum > 0 && fwrite(ccv_array_get(writer->index, 0), sizeof(ccv_cnnp_shard_index_t), writer->index->rnum, writer->w) != writer->index->rnum) ||
+			fwrite(&footer, sizeof(footer), 1, writer->w) != 1)
+			error = 1;
+	}
+	if (fclose(writer->w) != 0)
+		error = 1;
+	ccv_array_free(writer->index);
+	ccfree(writer);
+	return error ? -1 : 0;
+}
+
+// MARK - Create Dataframe from Sharded Record Files
+
+typedef struct {
+	int shard;
+	int first; // The first record of the chunk.
+	int count;
+	uint64_t offset; // Where the chunk starts in the shard.
+	uint64_t size;
+} ccv_cnnp_shard_chunk_t;
+
+typedef struct {
+	char* filename;
+	int chunk_start;
+	int chunk_count;
+} ccv_cnnp_shard_t;
+
+typedef struct {
+	int shard_size;
+	int record_count;
+	int chunk_size;
+	int loaded_chunk; // The chunk in the buffer, -1 if none.
+	int opened_shard; // The shard r opens, -1 if none.
+	FILE* r;
+	size_t buffer_size;
+	uint8_t* buffer;
+	sfmt_t sfmt;
+	int* order; // The record for each row.
+	int* record_chunks; // The chunk each record belongs to.
+	int* shard_order; // The order to go through the shards.
+	ccv_cnnp_shard_index_t* index; // The index of all records, shard after shard.
+	ccv_cnnp_shard_chunk_t* chunks;
+	ccv_cnnp_shard_t shards[1];
+} ccv_cnnp_shards_t;
+
+typedef struct {
+	ccv_cnnp_record_t record;
+	size_t capacity;
+} ccv_cnnp_shard_record_t;
+
+// Read the chunk into the buffer. Returns 0 if the chunk is loaded, -1 if the shard cannot be opened or is truncated
+// since the dataframe is created.
+static int _ccv_cnnp_shards_load(ccv_cnnp_shards_t* const shards, const int chunk_idx)
+{
+	const ccv_cnnp_shard_chunk_t* const chunk = shards->chunks + chunk_idx;
+	shards->loaded_chunk = -1;
+	if (chunk->shard != shards->opened_shard)
+	{
+		if (shards->r)
+			fclose(shards->r);
+		shards->r = fopen(shards->shards[chunk->shard].filename, "rb");
+		if (!shards->r)
+		{
+			shards->opened_shard = -1;
+			return -1;
+		}
+		// The chunks are large, no need to buffer these reads again.
+		setvbuf(shards->r, 0, _IONBF, 0);
+		shards->opened_shard = chunk->shard;
+	}
+	if (chunk->size > shards->buffer_size)
+	{
+		shards->buffer = (uint8_t*)ccrealloc(shards->buffer, chunk->size);
+		shards->buffer_size = chunk->size;
+	}
+	if (fseeko(shards->r, (off_t)chunk->offset, SEEK_SET) != 0 ||
+		fread(shards->buffer, 1, chunk->size, shards->r) != chunk->size)
+	{
+		// Reopen the shard next time, in case it is written again.
+		fclose(shards->r);
+		shards->r = 0;
+		shards->opened_shard = -1;
+		return -1;
+	}
+	shards->loaded_chunk = chunk_idx;
+	return 0;
+}
+
+static void _ccv_cnnp_shards_enum(const int column_idx, const int* const row_idxs, const int row_size, void** const data, void* const context, ccv_nnc_stream_context_t* const stream_context)
+{
+	ccv_cnnp_shards_t* const shards = (ccv_cnnp_shards_t*)context;
+	int i;
+	for (i = 0; i < row_size; i++)
+	{
+		const int record_idx = shards->order[row_idxs[i]];
+		const int chunk_idx = shards->record_chunks[record_idx];
+		ccv_cnnp_shard_record_t* record = (ccv_cnnp_shard_record_t*)data[i];
+		// The row is 0 if its chunk cannot be read.
+		if (chunk_idx != shards->loaded_chunk && _ccv_cnnp_shards_load(shards, chunk_idx) != 0)
+		{
+			if (record)
+				ccfree(record);
+			data[i] = 0;
+			continue;
+		}
+		const ccv_cnnp_shard_index_t* const index = shards->index + record_idx;
+		const uint8_t* const ptr = shards->buffer + (index->offset - shards->chunks[chunk_idx].offset);
+		// Copy the record out, the buffer will be replaced by the next chunk while the row may still be in use.
+		const size_t capacity = (size_t)index->size + index->meta_size + 1;
+		if (!record || record->capacity < capacity)
+		{
+			record = (ccv_cnnp_shard_record_t*)ccrealloc(record, sizeof(ccv_cnnp_shard_record_t) + capacity);
+			record->capacity = capacity;
+		}
+		uint8_t* const bytes = (uint8_t*)(record + 1);
+		memcpy(bytes, ptr, (size_t)index->size + index->meta_size);
+		bytes[index->size + index->meta_size] = 0;
+		record->record.data = bytes;
+		record->record.size = index->size;
+		record->record.meta = (char*)bytes + index->size;
+		record->record.meta_size = index->meta_size;
+		data[i] = record;
+	}
+}
+
+static void _ccv_cnnp_shards_record_deinit(void* const data, void* const context)
+{
+	ccfree(data);
+}
+
+static void _ccv_cnnp_shards_free(ccv_cnnp_shards_t* const shards)
+{
+	int i;
+	for (i = 0; i < shards->shard_size; i++)
+		if (shards->shards[i].filename)
+			ccfree(shards->shards[i].filename);
+	if (shards->r)
+		fclose(shards->r);
+	if (shards->buffer)
+		ccfree(shards->buffer);
+	if (shards->order)
+		ccfree(shards->order);
+	if (shards->record_chunks)
+		ccfree(shards->record_chunks);
+	if (shards->shard_order)
+		ccfree(shards->shard_order);
+	if (shards->index)
+		ccfree(shards->index);
+	if (shards->chunks)
+		ccfree(shards->chunks);
+	ccfree(shards);
+}
+
+static void _ccv_cnnp_shards_deinit(void* const context)
+{
+	_ccv_cnnp_shards_free((ccv_cnnp_shards_t*)context);
+}
+
+// Read the index of the shard and append to the index of all records. Returns the number of records, -1 if the
+// shard is malformed.
+static int _ccv_cnnp_shard_read_index(const char* const filename, ccv_array_t* const index)
+{
+	FILE* const r = fopen(filename, "rb");
+	if (!r)
+		return -1;
+	char magic[8];
+	uint32_t header[2];
+	ccv_cnnp_shard_footer_t footer;
+	if (fread(magic, 1, 8, r) != 8 || memcmp(magic, CCV_CNNP_SHARD_MAGIC, 8) != 0 ||
+		fread(header, sizeof(header), 1, r) != 1 || header[0] != CCV_CNNP_SHARD_VERSION ||
+		fseeko(r, 0, SEEK_END) != 0)
+	{
+		fclose(r);
+		return -1;
+	}
+	const off_t file_size = ftello(r);
+	if (file_size < (off_t)(CCV_CNNP_SHARD_HEADER_SIZE + sizeof(footer)) ||
+		fseeko(r, file_size - (off_t)sizeof(footer), SEEK_SET) != 0 ||
+		fread(&footer, sizeof(footer), 1, r) != 1 || memcmp(footer.magic, CCV_CNNP_SHARD_MAGIC, 8) != 0 ||
+		footer.record_count > INT_MAX ||
+		footer.index_offset < CCV_CNNP_SHARD_HEADER_SIZE ||
+		footer.index_offset + footer.record_count * sizeof(ccv_cnnp_shard_index_t) + sizeof(footer) != (uint64_t)file_size ||
+		fseeko(r, (off_t)footer.index_offset, SEEK_SET) != 0)
+	{
+		fclose(r);
+		return -1;
+	}
+	const int record_count = (int)footer.record_count;
+	const int rnum = index->rnum;
+	ccv_array_resize(index, rnum + record_count);
+	if (record_count > 0 && fread(ccv_array_get(index, rnum), sizeof(ccv_cnnp_shard_index_t), record_count, r) != record_count)
+	{
+		fclose(r);
+		return -1;
+	}
+	fclose(r);
+	// The records have to be back to back in order, otherwise we cannot read them sequentially.
+	uint64_t end = CCV_CNNP_SHARD_HEADER_SIZE;
+	int i;
+	for (i = 0; i < record_count; i++)
+	{
+		const ccv_cnnp_shard_index_t* const entry = (ccv_cnnp_shard_index_t*)ccv_array_get(index, rnum + i);
+		if (entry->offset < end)
+			return -1;
+		end = entry->offset + entry->size + entry->meta_size;
+	}
+	if (end > footer.index_offset)
+		return -1;
+	return record_count;
+}
+
+// Lay out the rows shard by shard, and chunk by chunk in each shard. If shuffle, the records in each chunk are shuffled.
+static void _ccv_cnnp_shards_order(ccv_cnnp_shards_t* const shards, const int shuffle)
+{
+	int i, j, k = 0;
+	for (i = 0; i < shards->shard_size; i++)
+	{
+		const ccv_cnnp_shard_t* const shard = shards->shards + shards->shard_order[i];
+		for (j = 0; j < shard->chunk_count; j++)
+		{
+			const ccv_cnnp_shard_chunk_t* const chunk = shards->chunks + shard->chunk_start + j;
+			int l;
+			for (l = 0; l < chunk->count; l++)
+				shards->order[k + l] = chunk->first + l;
+			if (shuffle)
+				sfmt_genrand_shuffle(&shards->sfmt, shards->order + k, chunk->count, sizeof(int));
+			k += chunk->count;
+		}
+	}
+	assert(k == shards->record_count);
+}
+
+ccv_cnnp_dataframe_t* ccv_cnnp_dataframe_from_shards_new(const char* const* const filenames, const int filename_size, const size_t buffer_size)
+{
+	assert(filename_size > 0);
+	ccv_cnnp_shards_t* const shards = (ccv_cnnp_shards_t*)cccalloc(1, sizeof(ccv_cnnp_shards_t) + sizeof(ccv_cnnp_shard_t) * (filename_size - 1));
+	shards->shard_size = filename_size;
+	shards->loaded_chunk = -1;
+	shards->opened_shard = -1;
+	ccv_array_t* const index = ccv_array_new(sizeof(ccv_cnnp_shard_index_t), 0, 0);
+	ccv_array_t* const chunks = ccv_array_new(sizeof(ccv_cnnp_shard_chunk_t), filename_size, 0);
+	const uint64_t chunk_limit = buffer_size > 0 ? buffer_size : CCV_CNNP_SHARD_BUFFER_SIZE;
+	int i, j;
+	for (i = 0; i < filename_size; i++)
+	{
+		const int first = index->rnum;
+		const int record_count = _ccv_cnnp_shard_read_index(filenames[i], index);
+		if (record_count < 0 || (uint64_t)first + record_count > INT_MAX)
+		{
+			ccv_array_free(index);
+			ccv_array_free(chunks);
+			_ccv_cnnp_shards_free(shards);
+			return 0;
+		}
+		shards->shards[i].filename = ccv_cnnp_column_copy_name(filenames[i]);
+		shards->shards[i].chunk_start = chunks->rnum;
+		// Group consecutive records into chunks no larger than the buffer (unless a record itself is larger).
+		for (j = 0; j < record_count; j++)
+		{
+			const ccv_cnnp_shard_index_t* const entry = (ccv_cnnp_shard_index_t*)ccv_array_get(index, first + j);
+			const uint64_t end = entry->offset + entry->size + entry->meta_size;
+			ccv_cnnp_shard_chunk_t* const last = chunks->rnum > shards->shards[i].chunk_start ? (ccv_cnnp_shard_chunk_t*)ccv_array_get(chunks, chunks->rnum - 1) : 0;
+			if (last && end - last->offset <= chunk_limit)
+			{
+				++last->count;
+				last->size = end - last->offset;
+			} else {
+				const ccv_cnnp_shard_chunk_t chunk = {
+					.shard = i,
+					.first = first + j,
+					.count = 1,
+					.offset = entry->offset,
+					.size = end - entry->offset,
+				};
+				ccv_array_push(chunks, &chunk);
+			}
+		}
+		shards->shards[i].chunk_count = chunks->rnum - shards->shards[i].chunk_start;
+	}
+	const int record_count = index->rnum;
+	shards->record_count = record_count;
+	shards->chunk_size = chunks->rnum;
+	shards->index = (ccv_cnnp_shard_index_t*)ccmalloc(sizeof(ccv_cnnp_shard_index_t) * ccv_max(record_count, 1));
+	if (record_count > 0)
+		memcpy(shards->index, ccv_array_get(index, 0), sizeof(ccv_cnnp_shard_index_t) * record_count);
+	shards->chunks = (ccv_cnnp_shard_chunk_t*)ccmalloc(sizeof(ccv_cnnp_shard_chunk_t) * ccv_max(chunks->rnum, 1));
+	if (chunks->rnum > 0)
+		memcpy(shards->chunks, ccv_array_get(chunks, 0), sizeof(ccv_cnnp_shard_chunk_t) * chunks->rnum);
+	ccv_array_free(index);
+	ccv_array_free(chunks);
+	shards->record_chunks = (int*)ccmalloc(sizeof(int) * ccv_max(record_count, 1));
+	for (i = 0; i < shards->chunk_size; i++)
+		for (j = 0; j < shards->chunks[i].count; j++)
+			shards->record_chunks[shards->chunks[i].first + j] = i;
+	shards->shard_order = (int*)ccmalloc(sizeof(int) * filename_size);
+	for (i = 0; i < filename_size; i++)
+		shards->shard_order[i] = i;
+	shards->order = (int*)ccmalloc(sizeof(int) * ccv_max(record_count, 1));
+	_ccv_cnnp_shards_order(shards, 0);
+	sfmt_init_gen_rand(&shards->sfmt, (uint32_t)(uintptr_t)shards);
+	const ccv_cnnp_column_data_t shards_column_data = {
+		.data_enum = _ccv_cnnp_shards_enum,
+		.data_deinit = _ccv_cnnp_shards_record_deinit,
+		.context = shards,
+		.context_deinit = _ccv_cnnp_shards_deinit,
+	};
+	return ccv_cnnp_dataframe_new(&shards_column_data, 1, record_count);
+}
+
+void ccv_cnnp_dataframe_shards_shuffle(ccv_cnnp_dataframe_t* const dataframe)
+{
+	ccv_cnnp_shards_t* const shards = (ccv_cnnp_shards_t*)ccv_cnnp_dataframe_column_context(dataframe, 0);
+	sfmt_genrand_shuffle(&shards->sfmt, shards->shard_order, shards->shard_size, sizeof(int));
+	_ccv_cnnp_shards_order(shards, 1);
+}
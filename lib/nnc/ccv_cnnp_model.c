@@ -321,7 +321,11 @@ static void _ccv_cnnp_cmd_update_for_execs(void* const context, const ccv_nnc_gr
 	}
 }
 
-void ccv_cnnp_model_absorb(ccv_cnnp_model_t* const model, ccv_cnnp_model_t* const init, const ccv_nnc_tensor_param_t* const inputs, const int input_size)
+static void _ccv_cnnp_model_reshapes_free(ccv_cnnp_compiled_data_t* const compiled_data);
+static void _ccv_cnnp_model_compiled_data_reinit(ccv_cnnp_model_t* const model);
+static void _ccv_cnnp_model_graph_exec_symbol_set(ccv_nnc_symbolic_graph_t* const symbolic_graph, ccv_cnnp_compiled_data_t* const compiled_data, const int parallel_count, const ccv_nnc_graph_exec_symbol_t exec_symbol, const ccv_nnc_cmd_t cmd);
+
+static void _ccv_cnnp_model_absorb(ccv_cnnp_model_t* const model, ccv_cnnp_model_t* const init, const ccv_nnc_tensor_param_t* const inputs, const int input_size)
 {
 	assert(model->graph);
 	assert(model->compiled_data);
@@ -438,7 +442,29 @@ void ccv_cnnp_model_absorb(ccv_cnnp_model_t* const model, ccv_cnnp_model_t* cons
 	const int internal_size = compiled_data->internals->rnum;
 	for (i = 0; i < internal_size; i++)
 		{ assert(((ccv_nnc_tensor_symbol_t*)ccv_array_get(compiled_data->internals, i))->d == ((ccv_nnc_tensor_symbol_t*)ccv_array_get(init->compiled_data->internals, i))->d); }
-	// Go through compiled data.
+	_ccv_cnnp_model_compiled_data_reinit(model);
+	// There are other compiled graphs, for accum and apply gradients.
+	// However, the main conclusion is, these absorb operations shouldn't impact parameters.
+	// Thus, it won't impact the shape of gradients (only outgrad). Since for outgrad, we
+	// don't allocate ourselves, it is not a concern. For normal gradients, the shape cannot
+	// be changed otherwise parameters' shape will be meaningless. The same goes to internals.
+	// That is why we don't update these compiled graphs at all this point.
+	// Free the model, we've already "absorbed" it.
+	ccv_cnnp_model_free(init);
+}
+
+void ccv_cnnp_model_absorb(ccv_cnnp_model_t* const model, ccv_cnnp_model_t* const init, const ccv_nnc_tensor_param_t* const inputs, const int input_size)
+{
+	assert(model->compiled_data);
+	// The new model may have a different configuration, the symbols absorbed before are not the same any more.
+	_ccv_cnnp_model_reshapes_free(model->compiled_data);
+	_ccv_cnnp_model_absorb(model, init, inputs, input_size);
+}
+
+// Re-initialize the tensor arena and the graph exec arena after the symbols in the model graph changed.
+static void _ccv_cnnp_model_compiled_data_reinit(ccv_cnnp_model_t* const model)
+{
+	ccv_cnnp_compiled_data_t* const compiled_data = model->compiled_data;
 	if (compiled_data->tensor_arena)
 	{
 		const int flag = ccv_nnc_tensor_arena_reinit(compiled_data->tensor_arena, model->graph);
@@ -460,14 +486,6 @@ void ccv_cnnp_model_absorb(ccv_cnnp_model_t* const model, ccv_cnnp_model_t* cons
 			// Free-up tensor arena & graph exec arena.
 			_ccv_cnnp_compiled_data_graph_free(compiled_data);
 	}
-	// There are other compiled graphs, for accum and apply gradients.
-	// However, the main conclusion is, these absorb operations shouldn't impact parameters.
-	// Thus, it won't impact the shape of gradients (only outgrad). Since for outgrad, we
-	// don't allocate ourselves, it is not a concern. For normal gradients, the shape cannot
-	// be changed otherwise parameters' shape will be meaningless. The same goes to internals.
-	// That is why we don't update these compiled graphs at all this point.
-	// Free the model, we've already "absorbed" it.
-	ccv_cnnp_model_free(init);
 }
 
 void ccv_cnnp_model_compile(ccv_cnnp_model_t* const model, const ccv_nnc_tensor_param_t* const inputs, const int input_size, const ccv_nnc_cmd_t minimizer, const ccv_nnc_cmd_t loss)
@@ -545,6 +563,233 @@ void ccv_cnnp_model_set_memory_compression(ccv_cnnp_model_t* const model, const
 		{ assert(!compiled_data->graph); }
 }
 
+void ccv_cnnp_model_set_max_inputs(ccv_cnnp_model_t* const model, const ccv_nnc_tensor_param_t* const inputs, const int input_size)
+{
+	if (model->max_inputs)
+	{
+		ccfree(model->max_inputs);
+		model->max_inputs = 0;
+	}
+	if (inputs && input_size > 0)
+	{
+		assert(input_size == model->input_size || model->input_size == 0);
+		if (model->input_size == 0)
+			model->input_size = input_size;
+		model->max_inputs = (ccv_nnc_tensor_param_t*)ccmalloc(sizeof(ccv_nnc_tensor_param_t) * input_size);
+		memcpy(model->max_inputs, inputs, sizeof(ccv_nnc_tensor_param_t) * input_size);
+	}
+	ccv_cnnp_compiled_data_t* const compiled_data = model->compiled_data;
+	// The compiled graph is not planned for the new shapes, compile again on the next run.
+	if (compiled_data && compiled_data->graph)
+		_ccv_cnnp_compiled_data_graph_free(compiled_data);
+}
+
+static int _ccv_cnnp_tensor_type_eq(const int a, const int b)
+{
+	// The device is resolved when the tensor is allocated, CCV_COMPUTE_DEVICE_ANY matches any of them.
+	return a == b || (CCV_TENSOR_GET_MEMORY(a) == CCV_TENSOR_GET_MEMORY(b) &&
+		(CCV_TENSOR_GET_DEVICE(a) == CCV_COMPUTE_DEVICE_ANY || CCV_TENSOR_GET_DEVICE(b) == CCV_COMPUTE_DEVICE_ANY));
+}
+
+static int _ccv_cnnp_tensor_param_eq(const ccv_nnc_tensor_param_t a, const ccv_nnc_tensor_param_t b)
+{
+	return _ccv_cnnp_tensor_type_eq(a.type, b.type) && a.format == b.format && a.datatype == b.datatype && memcmp(a.dim, b.dim, sizeof(a.dim)) == 0;
+}
+
+static int _ccv_cnnp_tensor_param_within(const ccv_nnc_tensor_param_t params, const ccv_nnc_tensor_param_t max_params)
+{
+	if (!_ccv_cnnp_tensor_type_eq(params.type, max_params.type) || params.format != max_params.format || params.datatype != max_params.datatype)
+		return 0;
+	const int nd = ccv_nnc_tensor_nd(params.dim);
+	if (nd != ccv_nnc_tensor_nd(max_params.dim))
+		return 0;
+	int i;
+	for (i = 0; i < nd; i++)
+		if (params.dim[i] > max_params.dim[i])
+			return 0;
+	return 1;
+}
+
+#define CCV_CNNP_MODEL_RESHAPE_CACHE_SIZE (16)
+
+typedef struct {
+	ccv_nnc_tensor_param_t params;
+	int alias;
+	int ofs[CCV_NNC_MAX_DIM_ALLOC];
+	int inc[CCV_NNC_MAX_DIM_ALLOC];
+} ccv_cnnp_model_reshape_tensor_t;
+
+// What absorbing the model at the given input shapes leaves in the model graph, to get back to it without building the
+// model again.
+typedef struct {
+	int tensor_symbol_size;
+	int exec_symbol_size;
+	ccv_nnc_tensor_param_t* inputs;
+	ccv_cnnp_model_reshape_tensor_t* tensors;
+	ccv_nnc_cmd_t* cmds;
+} ccv_cnnp_model_reshape_t;
+
+static ccv_cnnp_model_reshape_t* _ccv_cnnp_model_reshape_new(const ccv_cnnp_model_t* const model)
+{
+	ccv_nnc_symbolic_graph_t* const graph = model->graph;
+	const int tensor_symbol_size = ccv_nnc_tensor_symbol_count(graph);
+	const int exec_symbol_size = ccv_nnc_graph_exec_symbol_count(graph);
+	ccv_cnnp_model_reshape_t* const reshape = (ccv_cnnp_model_reshape_t*)ccmalloc(sizeof(ccv_cnnp_model_reshape_t) + sizeof(ccv_nnc_cmd_t) * exec_symbol_size + sizeof(ccv_cnnp_model_reshape_tensor_t) * tensor_symbol_size + sizeof(ccv_nnc_tensor_param_t) * model->input_size);
+	reshape->tensor_symbol_size = tensor_symbol_size;
+	reshape->exec_symbol_size = exec_symbol_size;
+	reshape->cmds = (ccv_nnc_cmd_t*)(reshape + 1);
+	reshape->tensors = (ccv_cnnp_model_reshape_tensor_t*)(reshape->cmds + exec_symbol_size);
+	reshape->inputs = (ccv_nnc_tensor_param_t*)(reshape->tensors + tensor_symbol_size);
+	int i;
+	for (i = 0; i < model->input_size; i++)
+		reshape->inputs[i] = model->inputs[i].d >= 0 ? ccv_nnc_tensor_symbol_params(graph, model->inputs[i]) : (ccv_nnc_tensor_param_t){};
+	for (i = 0; i < tensor_symbol_size; i++)
+	{
+		const ccv_nnc_tensor_symbol_t symbol = {
+			.d = i,
+			.graph = graph
+		};
+		reshape->tensors[i].params = ccv_nnc_tensor_symbol_params(graph, symbol);
+		reshape->tensors[i].alias = (0 == ccv_nnc_tensor_symbol_alias_params(graph, symbol, reshape->tensors[i].ofs, reshape->tensors[i].inc));
+	}
+	for (i = 0; i < exec_symbol_size; i++)
+		reshape->cmds[i] = ccv_nnc_graph_exec_symbol_cmd(graph, (ccv_nnc_graph_exec_symbol_t){
+			.d = i,
+			.graph = graph
+		});
+	return reshape;
+}
+
+static int _ccv_cnnp_model_reshape_find(const ccv_cnnp_model_t* const model, const ccv_nnc_tensor_param_t* const inputs)
+{
+	const ccv_array_t* const reshapes = model->compiled_data->reshapes;
+	if (!reshapes)
+		return -1;
+	const int tensor_symbol_size = ccv_nnc_tensor_symbol_count(model->graph);
+	const int exec_symbol_size = ccv_nnc_graph_exec_symbol_count(model->graph);
+	int i, j;
+	for (i = 0; i < reshapes->rnum; i++)
+	{
+		const ccv_cnnp_model_reshape_t* const reshape = *(ccv_cnnp_model_reshape_t**)ccv_array_get(reshapes, i);
+		if (reshape->tensor_symbol_size != tensor_symbol_size || reshape->exec_symbol_size != exec_symbol_size)
+			continue;
+		int flag = 1;
+		for (j = 0; flag && j < model->input_size; j++)
+			if (model->inputs[j].d >= 0)
+				flag = _ccv_cnnp_tensor_param_eq(reshape->inputs[j], inputs[j]);
+		if (flag)
+			return i;
+	}
+	return -1;
+}
+
+static void _ccv_cnnp_model_reshape_push(ccv_cnnp_model_t* const model)
+{
+	ccv_cnnp_compiled_data_t* const compiled_data = model->compiled_data;
+	if (!compiled_data->reshapes)
+		compiled_data->reshapes = ccv_array_new(sizeof(ccv_cnnp_model_reshape_t*), 1, 0);
+	ccv_array_t* const reshapes = compiled_data->reshapes;
+	if (reshapes->rnum >= CCV_CNNP_MODEL_RESHAPE_CACHE_SIZE)
+	{
+		// Drop the oldest one.
+		ccfree(*(ccv_cnnp_model_reshape_t**)ccv_array_get(reshapes, 0));
+		memmove(ccv_array_get(reshapes, 0), ccv_array_get(reshapes, 1), sizeof(ccv_cnnp_model_reshape_t*) * (reshapes->rnum - 1));
+		--reshapes->rnum;
+	}
+	ccv_cnnp_model_reshape_t* const reshape = _ccv_cnnp_model_reshape_new(model);
+	ccv_array_push(reshapes, &reshape);
+}
+
+static void _ccv_cnnp_model_reshape_restore(ccv_cnnp_model_t* const model, const ccv_cnnp_model_reshape_t* const reshape)
+{
+	ccv_nnc_symbolic_graph_t* const graph = model->graph;
+	int i;
+	for (i = 0; i < reshape->tensor_symbol_size; i++)
+	{
+		const ccv_nnc_tensor_symbol_t symbol = {
+			.d = i,
+			.graph = graph
+		};
+		ccv_nnc_tensor_symbol_set(graph, symbol, reshape->tensors[i].params);
+		if (reshape->tensors[i].alias)
+			ccv_nnc_tensor_symbol_alias_set(graph, symbol, reshape->tensors[i].ofs, reshape->tensors[i].inc);
+	}
+	for (i = 0; i < reshape->exec_symbol_size; i++)
+		ccv_nnc_graph_exec_symbol_set(graph, (ccv_nnc_graph_exec_symbol_t){
+			.d = i,
+			.graph = graph
+		}, reshape->cmds[i]);
+	_ccv_cnnp_model_compiled_data_reinit(model);
+}
+
+static void _ccv_cnnp_model_reshapes_free(ccv_cnnp_compiled_data_t* const compiled_data)
+{
+	if (!compiled_data->reshapes)
+		return;
+	int i;
+	for (i = 0; i < compiled_data->reshapes->rnum; i++)
+		ccfree(*(ccv_cnnp_model_reshape_t**)ccv_array_get(compiled_data->reshapes, i));
+	ccv_array_free(compiled_data->reshapes);
+	compiled_data->reshapes = 0;
+}
+
+// Reshape the model graph to the given inputs. Before the graph is compiled, it is kept at the maximum shapes, thus,
+// the tensor arena is planned for these. Afterwards, the arenas are re-initialized in place for inputs within them.
+// The model is built at each input shapes once, switching back to shapes seen before restores the symbols instead.
+static void _ccv_cnnp_model_reshape(ccv_cnnp_model_t* const model, ccv_nnc_tensor_t* const* const inputs)
+{
+	if (!model->max_inputs)
+		return;
+	ccv_cnnp_compiled_data_t* const compiled_data = model->compiled_data;
+	const int input_size = model->input_size;
+	ccv_nnc_tensor_param_t input_params[ccv_max(1, input_size)];
+	int i, within = 1;
+	for (i = 0; i < input_size; i++)
+	{
+		assert(inputs[i]);
+		input_params[i] = inputs[i]->info;
+		within = within && _ccv_cnnp_tensor_param_within(input_params[i], model->max_inputs[i]);
+	}
+	const ccv_nnc_tensor_param_t* const target = (!compiled_data->tensor_arena && within) ? model->max_inputs : input_params;
+	int flag = 0;
+	for (i = 0; !flag && i < input_size; i++)
+		if (model->inputs[i].d >= 0)
+			flag = !_ccv_cnnp_tensor_param_eq(ccv_nnc_tensor_symbol_params(model->graph, model->inputs[i]), target[i]);
+	if (!flag)
+		return;
+	// The minimizers can be set at any time (for example, to update the learning rate every step), while both the
+	// symbols restored and the model built again only carry the minimizer at that time. Keep the update nodes' commands.
+	const int parameter_size = compiled_data->update_nodes ? compiled_data->parameters->rnum : 0;
+	ccv_nnc_cmd_t* const minimizers = parameter_size > 0 ? (ccv_nnc_cmd_t*)ccmalloc(sizeof(ccv_nnc_cmd_t) * parameter_size) : 0;
+	for (i = 0; i < parameter_size; i++)
+		minimizers[i] = ccv_nnc_graph_exec_symbol_cmd(model->graph, compiled_data->update_nodes[i]);
+	const int idx = compiled_data->tensor_arena ? _ccv_cnnp_model_reshape_find(model, target) : -1;
+	if (idx >= 0)
+		_ccv_cnnp_model_reshape_restore(model, *(ccv_cnnp_model_reshape_t**)ccv_array_get(compiled_data->reshapes, idx));
+	else {
+		if (compiled_data->tensor_arena)
+		{
+			// Keep the shapes the arenas are at now as well, thus, it can get back to these without building the model.
+			ccv_nnc_tensor_param_t current_params[ccv_max(1, input_size)];
+			for (i = 0; i < input_size; i++)
+				current_params[i] = model->inputs[i].d >= 0 ? ccv_nnc_tensor_symbol_params(model->graph, model->inputs[i]) : (ccv_nnc_tensor_param_t){};
+			if (_ccv_cnnp_model_reshape_find(model, current_params) < 0)
+				_ccv_cnnp_model_reshape_push(model);
+		}
+		ccv_cnnp_model_t* const init = ccv_cnnp_model_copy(model);
+		_ccv_cnnp_model_absorb(model, init, target, input_size);
+		if (compiled_data->tensor_arena)
+			_ccv_cnnp_model_reshape_push(model);
+	}
+	if (minimizers)
+	{
+		const int parallel_count = ccv_max(model->parallel_count, 1);
+		for (i = 0; i < parameter_size; i++)
+			_ccv_cnnp_model_graph_exec_symbol_set(model->graph, compiled_data, parallel_count, compiled_data->update_nodes[i], minimizers[i]);
+		ccfree(minimizers);
+	}
+}
+
 typedef struct {
 	int parallel_count;
 	ccv_nnc_symbolic_graph_t* graph;
@@ -863,6 +1108,8 @@ static void _ccv_cnnp_model_gradient_init(ccv_cnnp_model_t* const model, const i
 	ccv_cnnp_compiled_data_t* const compiled_data = model->compiled_data;
 	assert(compiled_data->gradient_mode == CCV_CNNP_COMPILED_DATA_GRADIENT_NONE);
 	assert(gradient_mode != CCV_CNNP_COMPILED_DATA_GRADIENT_NONE);
+	// The quantized commands cannot be differentiated.
+	assert(!compiled_data->calibration.quantized);
 	const int evaluate_to_size = compiled_data->evaluate.to_size;
 	assert(evaluate_to_size > 0);
 	const int parallel_count = ccv_max(model->parallel_count, 1);
@@ -1089,6 +1336,7 @@ static void _ccv_cnnp_model_bind_tensors(const ccv_nnc_symbolic_graph_t* const g
 
 static void _ccv_cnnp_compiled_data_graph_free(ccv_cnnp_compiled_data_t* const compiled_data)
 {
+	_ccv_cnnp_model_reshapes_free(compiled_data);
 	if (compiled_data->graph)
 		ccv_nnc_graph_free(compiled_data->graph);
 	compiled_data->graph = 0;
@@ -1280,13 +1528,21 @@ void ccv_cnnp_model_fit(ccv_cnnp_model_t* const model, ccv_nnc_tensor_t* const*
 	assert(input_size == model->input_size * parallel_count);
 	assert(!fits || fit_size == output_size);
 	assert(model->graph);
-	if (!compiled_data->graph || compiled_data->graph_mode != CCV_CNNP_MODEL_GRAPH_FIT_MODE)
+	const int compile = (!compiled_data->graph || compiled_data->graph_mode != CCV_CNNP_MODEL_GRAPH_FIT_MODE);
+	if (compile)
 	{
 		_ccv_cnnp_compiled_data_graph_free(compiled_data);
 		_ccv_cnnp_compiled_data_backward_free(compiled_data);
 		_ccv_cnnp_compiled_data_apply_gradients_free(compiled_data);
+	}
+	// Reshape after the graph of the other mode is freed, thus, it is compiled for the maximum shapes, not the current ones.
+	_ccv_cnnp_model_reshape(model, inputs);
+	if (compile)
+	{
 		// Compile the symbolic graph down only when needed.
 		_ccv_cnnp_model_fit_jit(model, inputs, input_size, fits, fit_size, outputs, output_size);
+		// If compiled at the maximum shapes, re-initialize to the actual shapes.
+		_ccv_cnnp_model_reshape(model, inputs);
 	} else {
 		assert((input_size % parallel_count) == 0);
 		assert((output_size % parallel_count) == 0);
@@ -1509,7 +1765,8 @@ void ccv_cnnp_model_evaluate(ccv_cnnp_model_t* const model, const ccv_cnnp_evalu
 	assert(model->graph);
 	const int target_gradient_mode = _ccv_cnnp_is_disable_outgrad_all(params.disable_outgrad, model->input_size) ? CCV_CNNP_COMPILED_DATA_GRADIENT_TRAINABLES : CCV_CNNP_COMPILED_DATA_GRADIENT_TRAINABLES_AND_INPUTS;
 	const int mode_mismatch = (params.requires_grad && (compiled_data->graph_mode != CCV_CNNP_MODEL_GRAPH_MULTISTAGE_MODE || compiled_data->gradient_mode != target_gradient_mode || compiled_data->disable_outgrad != params.disable_outgrad));
-	if (!compiled_data->graph || mode_mismatch)
+	const int compile = (!compiled_data->graph || mode_mismatch);
+	if (compile)
 	{
 		_ccv_cnnp_compiled_data_graph_free(compiled_data);
 		if (mode_mismatch) // If mode mismatch, we need to redo the backward and apply gradient as well.
@@ -1517,10 +1774,17 @@ void ccv_cnnp_model_evaluate(ccv_cnnp_model_t* const model, const ccv_cnnp_evalu
 			_ccv_cnnp_compiled_data_backward_free(compiled_data);
 			_ccv_cnnp_compiled_data_apply_gradients_free(compiled_data);
 		}
+	}
+	// Reshape after the graph of the other mode is freed, thus, it is compiled for the maximum shapes, not the current ones.
+	_ccv_cnnp_model_reshape(model, inputs);
+	if (compile)
+	{
 		if (params.requires_grad)
 			_ccv_cnnp_model_multistage_jit_0(model, params.disable_outgrad, params.is_test, inputs, input_size, outputs, output_size);
 		else
 			_ccv_cnnp_model_multistage_no_grad_jit(model, inputs, input_size, outputs, output_size);
+		// If compiled at the maximum shapes, re-initialize to the actual shapes.
+		_ccv_cnnp_model_reshape(model, inputs);
 	} else {
 		ccv_nnc_tensor_arena_clear_bindings(compiled_data->tensor_arena);
 		assert((input_size % parallel_count) == 0);
@@ -1549,6 +1813,169 @@ void ccv_cnnp_model_evaluate(ccv_cnnp_model_t* const model, const ccv_cnnp_evalu
 	}
 }
 
+// MARK - Post-Training Quantization
+
+static int _ccv_cnnp_is_quantizable_cmd(const uint32_t cmd)
+{
+	return cmd == CCV_NNC_CONVOLUTION_FORWARD || cmd == CCV_NNC_GEMM_FORWARD ||
+		cmd == CCV_NNC_FUSED_CONVOLUTION_FORWARD || cmd == CCV_NNC_FUSED_GEMM_FORWARD;
+}
+
+void ccv_cnnp_model_calibrate(ccv_cnnp_model_t* const model, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	ccv_cnnp_compiled_data_t* const compiled_data = model->compiled_data;
+	assert(compiled_data);
+	assert(model->graph);
+	assert(ccv_max(model->parallel_count, 1) == 1);
+	assert(input_size == model->input_size);
+	assert(!compiled_data->calibration.quantized);
+	int i, j;
+	const int tensor_symbol_size = ccv_nnc_tensor_symbol_count(model->graph);
+	if (compiled_data->calibration.size < tensor_symbol_size)
+	{
+		compiled_data->calibration.ranges = (float*)ccrealloc(compiled_data->calibration.ranges, sizeof(float) * 2 * tensor_symbol_size);
+		for (i = compiled_data->calibration.size; i < tensor_symbol_size; i++)
+		{
+			compiled_data->calibration.ranges[i * 2] = FLT_MAX;
+			compiled_data->calibration.ranges[i * 2 + 1] = -FLT_MAX;
+		}
+		compiled_data->calibration.size = tensor_symbol_size;
+	}
+	if (!compiled_data->tensors_init.v)
+		ccv_cnnp_model_tensors_init(model, compiled_data);
+	ccv_array_t* const tensor_binds = ccv_array_new(sizeof(ccv_nnc_tensor_bind_t), 0, 0);
+	_ccv_cnnp_model_bind_tensors(model->graph, model->inputs, inputs, input_size, 1, tensor_binds);
+	const int parameter_size = compiled_data->parameters->rnum;
+	_ccv_cnnp_model_bind_tensors(model->graph, (ccv_nnc_tensor_symbol_t*)ccv_array_get(compiled_data->parameters, 0), compiled_data->tensors.parameters, parameter_size, 1, tensor_binds);
+	const int internal_size = compiled_data->internals->rnum;
+	_ccv_cnnp_model_remove_nocopies(model->graph, (ccv_nnc_tensor_symbol_t*)ccv_array_get(compiled_data->internals, 0), compiled_data->tensors.internals, internal_size, 1);
+	_ccv_cnnp_model_bind_tensors(model->graph, (ccv_nnc_tensor_symbol_t*)ccv_array_get(compiled_data->internals, 0), compiled_data->tensors.internals, internal_size, 1, tensor_binds);
+	// Bind the inputs of the convolution / GEMM to tensors of their own, so their values are still there after the run.
+	const int bound_size = tensor_binds->rnum;
+	ccv_array_t* const observes = ccv_array_new(sizeof(int), 0, 0);
+	const int exec_symbol_size = ccv_nnc_graph_exec_symbol_count(model->graph);
+	for (i = 0; i < exec_symbol_size; i++)
+	{
+		const ccv_nnc_graph_exec_symbol_t exec = {
+			.graph = model->graph,
+			.d = i
+		};
+		const int* exec_inputs;
+		int exec_input_size;
+		ccv_nnc_graph_exec_symbol_io(model->graph, exec, &exec_inputs, &exec_input_size, 0, 0);
+		if (exec_input_size < 2 || exec_inputs[0] < 0 || !_ccv_cnnp_is_quantizable_cmd(ccv_nnc_graph_exec_symbol_cmd(model->graph, exec).cmd))
+			continue;
+		const ccv_nnc_tensor_symbol_t symbol = {
+			.graph = model->graph,
+			.d = exec_inputs[0]
+		};
+		const ccv_nnc_tensor_param_t info = ccv_nnc_tensor_symbol_params(model->graph, symbol);
+		if (ccv_nnc_tensor_symbol_alias_to(model->graph, symbol).d != CCV_NNC_NO_TENSOR_SYMBOL || info.datatype != CCV_32F || CCV_TENSOR_GET_MEMORY(info.type) != CCV_TENSOR_CPU_MEMORY)
+			continue;
+		ccv_array_add_unique_int(observes, symbol.d);
+		// The model inputs are bound already.
+		int flag = 0;
+		for (j = 0; !flag && j < tensor_binds->rnum; j++)
+			flag = (((ccv_nnc_tensor_bind_t*)ccv_array_get(tensor_binds, j))->symbol.d == symbol.d);
+		if (flag)
+			continue;
+		const ccv_nnc_tensor_bind_t bind = {
+			.symbol = symbol,
+			.tensor = ccv_nnc_tensor_new(0, info, 0)
+		};
+		ccv_array_push(tensor_binds, &bind);
+	}
+	ccv_nnc_graph_t* graph = 0;
+	ccv_nnc_tensor_arena_t* tensor_arena = 0;
+	ccv_nnc_graph_exec_arena_t* graph_exec_arena = 0;
+	ccv_nnc_symbolic_graph_compile(model->graph, compiled_data->compile_params, (ccv_nnc_tensor_bind_t*)ccv_array_get(tensor_binds, 0), tensor_binds->rnum, 0, 0, SYMBOLIC_GRAPH_SOURCES(model->graph), compiled_data->evaluate.tos, compiled_data->evaluate.to_size, &graph, &tensor_arena, &graph_exec_arena);
+	if (_ccv_cnnp_any_to_init(compiled_data))
+	{
+		ccv_nnc_tensor_init_states_t tensor_init_states = {
+			.parallel_count = 1,
+			.graph = model->graph,
+			.compiled_data = compiled_data,
+			.tensor_arena = tensor_arena
+		};
+		ccv_cnnp_model_init_states(model, model->graph, _ccv_cnnp_init_states_for_tensors, &tensor_init_states);
+	}
+	ccv_nnc_graph_exec_update_t update = {
+		.parallel_count = 1,
+		.graph = model->graph,
+		.graph_exec_arena = graph_exec_arena,
+	};
+	ccv_cnnp_model_set_is_test(model, 1, _ccv_cnnp_cmd_update_for_execs, &update);
+	ccv_nnc_graph_run(graph, 0, TRAVERSE_FULL, 0, stream_context);
+	if (stream_context)
+		ccv_nnc_stream_context_wait(stream_context);
+	for (i = 0; i < observes->rnum; i++)
+	{
+		const int d = *(int*)ccv_array_get(observes, i);
+		const ccv_nnc_tensor_t* tensor = 0;
+		for (j = 0; !tensor && j < tensor_binds->rnum; j++)
+			if (((ccv_nnc_tensor_bind_t*)ccv_array_get(tensor_binds, j))->symbol.d == d)
+				tensor = ((ccv_nnc_tensor_bind_t*)ccv_array_get(tensor_binds, j))->tensor;
+		if (!tensor || tensor->info.datatype != CCV_32F || CCV_IS_TENSOR_VIEW(tensor))
+			continue;
+		const int count = ccv_nnc_tensor_count(tensor->info);
+		float* const range = compiled_data->calibration.ranges + d * 2;
+		for (j = 0; j < count; j++)
+		{
+			range[0] = ccv_min(range[0], tensor->data.f32[j]);
+			range[1] = ccv_max(range[1], tensor->data.f32[j]);
+		}
+	}
+	ccv_array_free(observes);
+	for (i = bound_size; i < tensor_binds->rnum; i++)
+		ccv_nnc_tensor_free((ccv_nnc_tensor_t*)((ccv_nnc_tensor_bind_t*)ccv_array_get(tensor_binds, i))->tensor);
+	ccv_array_free(tensor_binds);
+	ccv_nnc_graph_free(graph);
+	ccv_nnc_tensor_arena_free(tensor_arena);
+	ccv_nnc_graph_exec_arena_free(graph_exec_arena);
+}
+
+void ccv_cnnp_model_quantize(ccv_cnnp_model_t* const model)
+{
+	ccv_cnnp_compiled_data_t* const compiled_data = model->compiled_data;
+	assert(compiled_data);
+	assert(compiled_data->calibration.ranges);
+	assert(!compiled_data->calibration.quantized);
+	// The quantized commands are for inference only, drop the gradients and the graphs compiled so far.
+	_ccv_cnnp_compiled_data_graph_free(compiled_data);
+	if (compiled_data->gradient_mode != CCV_CNNP_COMPILED_DATA_GRADIENT_NONE)
+	{
+		_ccv_cnnp_model_rewind_graph(model);
+		_ccv_cnnp_compiled_data_gradient_free(compiled_data);
+		_ccv_cnnp_compiled_data_backward_free(compiled_data);
+		_ccv_cnnp_compiled_data_apply_gradients_free(compiled_data);
+		compiled_data->gradient_mode = CCV_CNNP_COMPILED_DATA_GRADIENT_NONE;
+	}
+	// The symbols created from now on are not rewindable.
+	ccv_nnc_tensor_symbol_new_hook(model->graph, 0, 0);
+	ccv_nnc_tensor_symbol_alias_new_hook(model->graph, 0, 0);
+	ccv_nnc_graph_exec_symbol_new_hook(model->graph, 0, 0);
+	const int size = compiled_data->calibration.size;
+	ccv_nnc_tensor_symbol_t* const symbols = (ccv_nnc_tensor_symbol_t*)ccmalloc(sizeof(ccv_nnc_tensor_symbol_t) * size + sizeof(float) * 2 * size);
+	float* const ranges = (float*)(symbols + size);
+	int i, symbol_size = 0;
+	for (i = 0; i < size; i++)
+		if (compiled_data->calibration.ranges[i * 2] <= compiled_data->calibration.ranges[i * 2 + 1])
+		{
+			symbols[symbol_size] = (ccv_nnc_tensor_symbol_t){
+				.graph = model->graph,
+				.d = i
+			};
+			ranges[symbol_size * 2] = compiled_data->calibration.ranges[i * 2];
+			ranges[symbol_size * 2 + 1] = compiled_data->calibration.ranges[i * 2 + 1];
+			++symbol_size;
+		}
+	ccv_nnc_symbolic_graph_quantize(model->graph, symbols, ranges, symbol_size, SYMBOLIC_GRAPH_SOURCES(model->graph), compiled_data->evaluate.tos, compiled_data->evaluate.to_size);
+	ccfree(symbols);
+	// The quantize commands for the model inputs are new sources.
+	ccv_nnc_graph_exec_symbol_autogen(model->graph, 0, 0, CCV_NNC_AUTOGEN_SOURCES_AND_DESTINATIONS);
+	compiled_data->calibration.quantized = 1;
+}
+
 // Compile the graph to run ccv_cnnp_model_backward after ccv_cnnp_model_evaluate with requires_grad = true (MULTISTAGE_MODE).
 // Particularly, this method compiles the accumulator graph.
 static void _ccv_cnnp_model_multistage_jit_1(ccv_cnnp_model_t* const model)
@@ -2035,6 +2462,8 @@ void ccv_cnnp_model_set_minimizer(ccv_cnnp_model_t* const model, const ccv_nnc_c
 	}
 	if (flag)
 	{
+		// The saved_aux symbols are added / removed, the shapes kept before don't match the graph any more.
+		_ccv_cnnp_model_reshapes_free(compiled_data);
 		// If saved_aux_size doesn't match, we need to remove / add new saved_aux to the graph. But first, free up apply gradients graph.
 		if (compiled_data->graph_mode == CCV_CNNP_MODEL_GRAPH_FIT_MODE)
 			_ccv_cnnp_compiled_data_graph_free(compiled_data);
@@ -2064,6 +2493,8 @@ void ccv_cnnp_model_dot(const ccv_cnnp_model_t* const model, const int flags, FI
 static void _ccv_cnnp_compiled_data_free(const ccv_cnnp_model_t* const model, ccv_cnnp_compiled_data_t* const compiled_data)
 {
 	int i;
+	if (compiled_data->async_checkpoint) // Wait for the pending checkpoint to finish, it is still writing.
+		ccv_cnnp_model_async_checkpoint_free(compiled_data);
 	const int parameter_size = compiled_data->parameters->rnum;
 	ccv_array_free(compiled_data->parameters);
 	const int internal_size = compiled_data->internals->rnum;
@@ -2106,6 +2537,8 @@ static void _ccv_cnnp_compiled_data_free(const ccv_cnnp_model_t* const model, cc
 		ccv_array_free(compiled_data->rewindables);
 	if (compiled_data->tensors_init.v)
 		ccfree(compiled_data->tensors_init.v);
+	if (compiled_data->calibration.ranges)
+		ccfree(compiled_data->calibration.ranges);
 	if (compiled_data->evaluate.tos)
 		ccfree(compiled_data->evaluate.tos);
 	compiled_data->evaluate.tos = 0;
@@ -2138,6 +2571,8 @@ void ccv_cnnp_model_free(ccv_cnnp_model_t* const model)
 		ccv_array_free(model->parameter_indices);
 	if (model->inputs)
 		ccfree(model->inputs);
+	if (model->max_inputs)
+		ccfree(model->max_inputs);
 	if (model->graph)
 		ccv_nnc_symbolic_graph_free(model->graph);
 	if (model->compiled_data)
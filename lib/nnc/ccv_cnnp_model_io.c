@@ -4,6 +4,9 @@
 #include "ccv_internal.h"
 #include "_ccv_cnnp_model.h"
 #include "3rdparty/sqlite3/sqlite3.h"
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 #ifdef HAVE_CUDA
 #include "gpu/ccv_nnc_compat.h"
 #endif
@@ -14,17 +17,17 @@
 #define SQLITE_ENFORCE assert
 #endif
 
-int ccv_cnnp_model_write(const ccv_cnnp_model_t* const model, void* const handle, const char* const name)
+// Collect the tensors to persist for the model and their names in the database.
+static int _ccv_cnnp_model_tensors_to_write(const ccv_cnnp_model_t* const model, const char* const name, ccv_nnc_tensor_t*** const tensors_out, char*** const names_out)
 {
-	sqlite3* conn = (sqlite3*)handle;
-	assert(conn);
 	ccv_cnnp_compiled_data_t* const compiled_data = model->compiled_data;
-	assert(compiled_data); // The model has to be compiled.
-	SQLITE_ENFORCE(SQLITE_OK == sqlite3_exec(conn, "BEGIN", 0, 0, 0));
 	int i, j;
 	const int parallel_count = ccv_max(model->parallel_count, 1);
 	const int parameter_size = compiled_data->parameters->rnum;
 	const int internal_size = compiled_data->internals->rnum;
+	const int tensor_size = parameter_size + internal_size * parallel_count;
+	ccv_nnc_tensor_t** const tensors = (ccv_nnc_tensor_t**)ccmalloc(sizeof(ccv_nnc_tensor_t*) * tensor_size);
+	char** const names = (char**)ccmalloc(sizeof(char*) * tensor_size);
 	char internal_name[2048 + 16];
 	for (i = 0; i < parameter_size; i++)
 	{
@@ -33,7 +36,8 @@ int ccv_cnnp_model_write(const ccv_cnnp_model_t* const model, void* const handle
 			snprintf(internal_name, 2048 + 16, "__%s__[%s]", name, id);
 		else
 			snprintf(internal_name, 2048 + 16, "%s", id);
-		ccv_nnc_tensor_write(compiled_data->tensors.parameters[i], conn, internal_name);
+		tensors[i] = compiled_data->tensors.parameters[i];
+		names[i] = strdup(internal_name);
 	}
 	for (i = 0; i < parallel_count; i++)
 		for (j = 0; j < internal_size; j++)
@@ -43,10 +47,40 @@ int ccv_cnnp_model_write(const ccv_cnnp_model_t* const model, void* const handle
 				snprintf(internal_name, 2048 + 16, "__%s__[%s(%d)]", name, id, i);
 			else
 				snprintf(internal_name, 2048 + 16, "%s(%d)", id, i);
-			ccv_nnc_tensor_write(compiled_data->tensors.internals[i * internal_size + j], conn, internal_name);
+			tensors[parameter_size + i * internal_size + j] = compiled_data->tensors.internals[i * internal_size + j];
+			names[parameter_size + i * internal_size + j] = strdup(internal_name);
 		}
-	SQLITE_ENFORCE(SQLITE_OK == sqlite3_exec(conn, "COMMIT", 0, 0, 0));
-	return CCV_IO_FINAL;
+	*tensors_out = tensors;
+	*names_out = names;
+	return tensor_size;
+}
+
+static void _ccv_cnnp_model_tensor_names_free(char** const names, const int tensor_size)
+{
+	int i;
+	for (i = 0; i < tensor_size; i++)
+		ccfree(names[i]);
+	ccfree(names);
+}
+
+static int _ccv_cnnp_model_write(const ccv_cnnp_model_t* const model, void* const handle, const char* const name, const int flags)
+{
+	sqlite3* conn = (sqlite3*)handle;
+	assert(conn);
+	ccv_cnnp_compiled_data_t* const compiled_data = model->compiled_data;
+	assert(compiled_data); // The model has to be compiled.
+	ccv_nnc_tensor_t** tensors;
+	char** names;
+	const int tensor_size = _ccv_cnnp_model_tensors_to_write(model, name, &tensors, &names);
+	const int result = ccv_nnc_tensors_write((const ccv_nnc_tensor_t* const*)tensors, (const char* const*)names, tensor_size, conn, flags);
+	ccfree(tensors);
+	_ccv_cnnp_model_tensor_names_free(names, tensor_size);
+	return result;
+}
+
+int ccv_cnnp_model_write(const ccv_cnnp_model_t* const model, void* const handle, const char* const name)
+{
+	return _ccv_cnnp_model_write(model, handle, name, 0);
 }
 
 int ccv_cnnp_model_read(void* const handle, const char* const name, const ccv_cnnp_model_t* const model_out)
@@ -93,20 +127,247 @@ int ccv_cnnp_model_read(void* const handle, const char* const name, const ccv_cn
 	return CCV_IO_FINAL;
 }
 
+int ccv_cnnp_model_mmap_write(const ccv_cnnp_model_t* const model, ccv_nnc_tensor_mmap_writer_t* const writer, const char* const name)
+{
+	assert(writer);
+	ccv_cnnp_compiled_data_t* const compiled_data = model->compiled_data;
+	assert(compiled_data); // The model has to be compiled.
+	int i, j;
+	const int parallel_count = ccv_max(model->parallel_count, 1);
+	const int parameter_size = compiled_data->parameters->rnum;
+	const int internal_size = compiled_data->internals->rnum;
+	char internal_name[2048 + 16];
+	for (i = 0; i < parameter_size; i++)
+	{
+		const char* const id = *(char**)ccv_array_get(compiled_data->ids.parameters, i);
+		if (name)
+			snprintf(internal_name, 2048 + 16, "__%s__[%s]", name, id);
+		else
+			snprintf(internal_name, 2048 + 16, "%s", id);
+		if (ccv_nnc_tensor_mmap_write(writer, compiled_data->tensors.parameters[i], internal_name) != CCV_IO_FINAL)
+			return CCV_IO_ERROR;
+	}
+	for (i = 0; i < parallel_count; i++)
+		for (j = 0; j < internal_size; j++)
+		{
+			const char* const id = *(char**)ccv_array_get(compiled_data->ids.internals, j);
+			if (name)
+				snprintf(internal_name, 2048 + 16, "__%s__[%s(%d)]", name, id, i);
+			else
+				snprintf(internal_name, 2048 + 16, "%s(%d)", id, i);
+			if (ccv_nnc_tensor_mmap_write(writer, compiled_data->tensors.internals[i * internal_size + j], internal_name) != CCV_IO_FINAL)
+				return CCV_IO_ERROR;
+		}
+	return CCV_IO_FINAL;
+}
+
+int ccv_cnnp_model_mmap_read(ccv_nnc_tensor_mmap_t* const tensor_mmap, const char* const name, const ccv_cnnp_model_t* const model_out)
+{
+	assert(tensor_mmap);
+	ccv_cnnp_compiled_data_t* const compiled_data = model_out->compiled_data;
+	assert(compiled_data); // The model has to be compiled.
+	const int tensors_init = !!compiled_data->tensors_init.v;
+	if (!tensors_init)
+		ccv_cnnp_model_tensors_init(model_out, compiled_data);
+	int i, j;
+	const int parallel_count = ccv_max(model_out->parallel_count, 1);
+	const int parameter_size = compiled_data->parameters->rnum;
+	const int internal_size = compiled_data->internals->rnum;
+	char internal_name[2048 + 16];
+	for (i = 0; i < parameter_size; i++)
+	{
+		const char* const id = *(char**)ccv_array_get(compiled_data->ids.parameters, i);
+		if (name)
+			snprintf(internal_name, 2048 + 16, "__%s__[%s]", name, id);
+		else
+			snprintf(internal_name, 2048 + 16, "%s", id);
+		const int d = ((ccv_nnc_tensor_symbol_t*)ccv_array_get(compiled_data->parameters, i))->d;
+		ccv_nnc_tensor_t* const parameter = compiled_data->tensors.parameters[i];
+		// Before the graph is compiled, parameters are not bound yet, thus, we can swap CPU ones out with
+		// tensors point directly to the mapped pages.
+		if (!compiled_data->graph && CCV_TENSOR_GET_MEMORY(parameter->info.type) == CCV_TENSOR_CPU_MEMORY)
+		{
+			ccv_nnc_tensor_t* tensor = 0;
+			if (ccv_nnc_tensor_mmap_read(tensor_mmap, internal_name, &tensor) == CCV_IO_FINAL)
+			{
+				if (CCV_TENSOR_GET_MEMORY(tensor->info.type) == CCV_TENSOR_CPU_MEMORY &&
+					tensor->info.format == parameter->info.format &&
+					tensor->info.datatype == parameter->info.datatype &&
+					memcmp(tensor->info.dim, parameter->info.dim, sizeof(tensor->info.dim)) == 0)
+				{
+					tensor->info.type = parameter->info.type;
+					ccv_nnc_tensor_free(parameter);
+					compiled_data->tensors.parameters[i] = tensor;
+					compiled_data->tensors_init.v[d >> 5] |= (1u << (d & 0x1f));
+					continue;
+				}
+				ccv_nnc_tensor_free(tensor);
+			}
+		}
+		if (ccv_nnc_tensor_mmap_read(tensor_mmap, internal_name, compiled_data->tensors.parameters + i) == CCV_IO_FINAL)
+			compiled_data->tensors_init.v[d >> 5] |= (1u << (d & 0x1f));
+	}
+	for (i = 0; i < parallel_count; i++)
+		for (j = 0; j < internal_size; j++)
+		{
+			const char* const id = *(char**)ccv_array_get(compiled_data->ids.internals, j);
+			if (name)
+				snprintf(internal_name, 2048 + 16, "__%s__[%s(%d)]", name, id, i);
+			else
+				snprintf(internal_name, 2048 + 16, "%s(%d)", id, i);
+			// Internals are small and may be updated in place (e.g. running statistics), always copy.
+			if (ccv_nnc_tensor_mmap_read(tensor_mmap, internal_name, compiled_data->tensors.internals + i * internal_size + j) == CCV_IO_FINAL)
+			{
+				const int d = ((ccv_nnc_tensor_symbol_t*)ccv_array_get(compiled_data->internals, j))->d;
+				compiled_data->tensors_init.v[d >> 5] |= (1u << (d & 0x1f));
+			}
+		}
+	return CCV_IO_FINAL;
+}
+
+// MARK - Asynchronous Checkpoint
+
+typedef struct ccv_cnnp_model_async_checkpoint_s ccv_cnnp_model_async_checkpoint_t;
+struct ccv_cnnp_model_async_checkpoint_s {
+	int running;
+	int result; // The result of the last write.
+	int flags; // The flags for ccv_nnc_tensors_write.
+	int tensor_size;
+	char* fn;
+	ccv_nnc_tensor_t** tensors; // The snapshot, the training continues to update the parameters meanwhile.
+	char** names;
+#ifdef HAVE_PTHREAD
+	pthread_t thread;
+#endif
+};
+
+static void* _ccv_cnnp_model_async_checkpoint_write(void* const context)
+{
+	ccv_cnnp_model_async_checkpoint_t* const async_checkpoint = (ccv_cnnp_model_async_checkpoint_t*)context;
+	sqlite3* conn = 0;
+	async_checkpoint->result = CCV_IO_ERROR;
+	if (SQLITE_OK == sqlite3_open(async_checkpoint->fn, &conn))
+		async_checkpoint->result = ccv_nnc_tensors_write((const ccv_nnc_tensor_t* const*)async_checkpoint->tensors, (const char* const*)async_checkpoint->names, async_checkpoint->tensor_size, conn, async_checkpoint->flags);
+	if (conn)
+		sqlite3_close(conn);
+	return 0;
+}
+
+static int _ccv_cnnp_model_async_checkpoint_wait(ccv_cnnp_model_async_checkpoint_t* const async_checkpoint)
+{
+	if (async_checkpoint->running)
+	{
+#ifdef HAVE_PTHREAD
+		pthread_join(async_checkpoint->thread, 0);
+#endif
+		async_checkpoint->running = 0;
+	}
+	return async_checkpoint->result;
+}
+
+static void _ccv_cnnp_model_async_checkpoint_release(ccv_cnnp_model_async_checkpoint_t* const async_checkpoint)
+{
+	int i;
+	for (i = 0; i < async_checkpoint->tensor_size; i++)
+		ccv_nnc_tensor_free(async_checkpoint->tensors[i]);
+	if (async_checkpoint->tensors)
+		ccfree(async_checkpoint->tensors);
+	if (async_checkpoint->names)
+		_ccv_cnnp_model_tensor_names_free(async_checkpoint->names, async_checkpoint->tensor_size);
+	async_checkpoint->tensors = 0;
+	async_checkpoint->names = 0;
+	async_checkpoint->tensor_size = 0;
+}
+
+static void _ccv_cnnp_model_async_checkpoint(ccv_cnnp_model_t* const model, const char* const fn, const int flags)
+{
+	ccv_cnnp_compiled_data_t* const compiled_data = model->compiled_data;
+	if (!compiled_data->async_checkpoint)
+		compiled_data->async_checkpoint = (ccv_cnnp_model_async_checkpoint_t*)cccalloc(1, sizeof(ccv_cnnp_model_async_checkpoint_t));
+	ccv_cnnp_model_async_checkpoint_t* const async_checkpoint = compiled_data->async_checkpoint;
+	// Only one snapshot buffer, wait for the previous write before overwriting it.
+	_ccv_cnnp_model_async_checkpoint_wait(async_checkpoint);
+	ccv_nnc_tensor_t** tensors;
+	char** names;
+	const int tensor_size = _ccv_cnnp_model_tensors_to_write(model, 0, &tensors, &names);
+	if (tensor_size != async_checkpoint->tensor_size)
+		_ccv_cnnp_model_async_checkpoint_release(async_checkpoint);
+	if (!async_checkpoint->tensors)
+	{
+		async_checkpoint->tensor_size = tensor_size;
+		async_checkpoint->tensors = (ccv_nnc_tensor_t**)cccalloc(tensor_size, sizeof(ccv_nnc_tensor_t*));
+	}
+	if (async_checkpoint->names)
+		_ccv_cnnp_model_tensor_names_free(async_checkpoint->names, tensor_size);
+	async_checkpoint->names = names;
+	int i;
+	for (i = 0; i < tensor_size; i++)
+	{
+		ccv_nnc_tensor_param_t info = tensors[i]->info;
+		info.type = CCV_TENSOR_CPU_MEMORY;
+		ccv_nnc_tensor_t* snapshot = async_checkpoint->tensors[i];
+		if (snapshot && memcmp(&snapshot->info, &info, sizeof(info)) != 0)
+		{
+			ccv_nnc_tensor_free(snapshot);
+			snapshot = 0;
+		}
+		if (!snapshot)
+			async_checkpoint->tensors[i] = snapshot = ccv_nnc_tensor_new(0, info, 0);
+		ccv_nnc_cmd_exec(CMD_DATA_TRANSFER_FORWARD(), ccv_nnc_no_hint, 0, TENSOR_LIST(tensors[i]), TENSOR_LIST(snapshot), 0);
+	}
+	ccfree(tensors);
+	if (async_checkpoint->fn)
+		ccfree(async_checkpoint->fn);
+	async_checkpoint->fn = strdup(fn);
+	async_checkpoint->flags = (flags & CCV_CNNP_MODEL_CHECKPOINT_COMPRESS) ? CCV_NNC_TENSOR_WRITE_COMPRESS : 0;
+#ifdef HAVE_PTHREAD
+	async_checkpoint->running = (pthread_create(&async_checkpoint->thread, 0, _ccv_cnnp_model_async_checkpoint_write, async_checkpoint) == 0);
+	if (!async_checkpoint->running) // Cannot start the thread, write it synchronously.
+#endif
+	_ccv_cnnp_model_async_checkpoint_write(async_checkpoint);
+}
+
+int ccv_cnnp_model_checkpoint_wait(ccv_cnnp_model_t* const model)
+{
+	ccv_cnnp_compiled_data_t* const compiled_data = model->compiled_data;
+	if (!compiled_data || !compiled_data->async_checkpoint)
+		return CCV_IO_FINAL;
+	return _ccv_cnnp_model_async_checkpoint_wait(compiled_data->async_checkpoint);
+}
+
+void ccv_cnnp_model_async_checkpoint_free(ccv_cnnp_compiled_data_t* const compiled_data)
+{
+	ccv_cnnp_model_async_checkpoint_t* const async_checkpoint = compiled_data->async_checkpoint;
+	_ccv_cnnp_model_async_checkpoint_wait(async_checkpoint);
+	_ccv_cnnp_model_async_checkpoint_release(async_checkpoint);
+	if (async_checkpoint->fn)
+		ccfree(async_checkpoint->fn);
+	ccfree(async_checkpoint);
+	compiled_data->async_checkpoint = 0;
+}
+
 void ccv_cnnp_model_checkpoint(ccv_cnnp_model_t* const model, const char* const fn, const int flags)
 {
 	ccv_cnnp_compiled_data_t* const compiled_data = model->compiled_data;
 	assert(compiled_data); // The model has to be compiled.
+	// The file may still be written from the previous asynchronous checkpoint.
+	ccv_cnnp_model_checkpoint_wait(model);
+	const int mode = flags & 0xf;
+	const int tensors_init = !!compiled_data->tensors_init.v;
+	if (tensors_init && mode != CCV_CNNP_MODEL_CHECKPOINT_READ_ONLY && (flags & CCV_CNNP_MODEL_CHECKPOINT_ASYNC))
+	{
+		_ccv_cnnp_model_async_checkpoint(model, fn, flags);
+		return;
+	}
 	sqlite3* conn = 0;
 	if (SQLITE_OK != sqlite3_open(fn, &conn))
 		return;
-	const int tensors_init = !!compiled_data->tensors_init.v;
-	if (!tensors_init || flags == CCV_CNNP_MODEL_CHECKPOINT_READ_ONLY)
+	if (!tensors_init || mode == CCV_CNNP_MODEL_CHECKPOINT_READ_ONLY)
 	{
 		ccv_cnnp_model_read(conn, 0, model);
 		sqlite3_close(conn);
 		return;
 	}
-	ccv_cnnp_model_write(model, conn, 0);
+	_ccv_cnnp_model_write(model, conn, 0, (flags & CCV_CNNP_MODEL_CHECKPOINT_COMPRESS) ? CCV_NNC_TENSOR_WRITE_COMPRESS : 0);
 	sqlite3_close(conn);
 }
@@ -27,6 +27,29 @@
  */
 void ccv_nnc_init(void);
 
+/**
+ * CPU instruction set extensions the CPU_OPT backend can dispatch to. These are detected at ccv_nnc_init().
+ */
+enum {
+	CCV_NNC_CPU_FEATURE_AVX2 = 0x1, /**< AVX2 with FMA3. */
+	CCV_NNC_CPU_FEATURE_AVX512F = 0x2, /**< AVX-512 Foundation. */
+	CCV_NNC_CPU_FEATURE_F16C = 0x4, /**< F16C, conversion between half precision and single precision floats. */
+	CCV_NNC_CPU_FEATURE_AVX512BF16 = 0x8, /**< AVX-512 BF16, dot product of bfloat16 pairs accumulated in single precision. */
+	CCV_NNC_CPU_FEATURE_AVX512VNNI = 0x10, /**< AVX-512 VNNI (with AVX-512 BW), dot product of unsigned and signed 8-bit integers accumulated in 32-bit integers. */
+};
+
+/**
+ * Get the CPU features the CPU_OPT backend currently dispatches to.
+ * @return A bitmask of CCV_NNC_CPU_FEATURE_*.
+ */
+int ccv_nnc_cpu_features(void);
+/**
+ * Restrict the CPU features the CPU_OPT backend dispatches to. Features the CPU doesn't support are ignored.
+ * Setting it to 0 makes the CPU_OPT backend use SSE2 / NEON kernels only.
+ * @param features A bitmask of CCV_NNC_CPU_FEATURE_*.
+ */
+void ccv_nnc_set_cpu_features(const int features);
+
 /** @} */
 
 /**
@@ -58,6 +81,11 @@ enum {
 	CCV_NNC_EXEC_OOM       = -3, /**< Out of memory error. */
 };
 
+/**
+ * The maximum number of element-wise commands one fused element-wise command can apply.
+ */
+#define CCV_NNC_MAX_FUSED_OPS (8)
+
 /**
  * Parameters for command.
  */
@@ -143,6 +171,19 @@ typedef struct {
 		struct {
 			float iou_threshold; /**< [nms.iou_threshold] Threshold between 0 to 1 for IoU threshold. */
 		} nms;
+		struct {
+			int count; /**< [fused.count] The number of filters for the fused convolution, same as convolution.count. */
+			uint32_t activation; /**< [fused.activation] The activation applied at last, identified by its forward command (CCV_NNC_RELU_FORWARD, CCV_NNC_SIGMOID_FORWARD or CCV_NNC_SWISH_FORWARD). 0 for none. */
+			float epsilon; /**< [fused.epsilon] The epsilon of the batch norm folded into the fused convolution. */
+			int op_count; /**< [fused.op_count] The number of element-wise commands in ops. */
+			uint32_t ops[CCV_NNC_MAX_FUSED_OPS]; /**< [fused.ops[]] The element-wise commands (by their forward command) applied in sequence. */
+		} fused;
+		struct {
+			float scale; /**< [quant.scale] The scale of the 8-bit activations, x = (q - quant.zero_point) * quant.scale. */
+			int zero_point; /**< [quant.zero_point] The 8-bit value that represents 0. */
+			int count; /**< [quant.count] The number of filters for the quantized convolution, same as convolution.count. */
+			uint32_t activation; /**< [quant.activation] The activation applied at last, same as fused.activation. 0 for none. */
+		} quant;
 		void* userdata;
 	};
 } ccv_nnc_cmd_param_t;
@@ -301,6 +342,26 @@ CCV_WARN_UNUSED(int) ccv_nnc_tensor_eq(const ccv_nnc_tensor_t* const a, const cc
  * @return CCV_IO_FINAL for success, otherwise error.
  */
 int ccv_nnc_tensor_write(const ccv_nnc_tensor_t* const tensor, void* const handle, const char* const name);
+enum {
+	/**
+	 * Compress the tensor data with a fast lossless codec (byte shuffle + deflate). It is only effective
+	 * if built with zlib, and the data is stored as is if it doesn't get smaller. Tensors are compressed
+	 * in parallel only if built with OpenMP, otherwise one after another on the calling thread.
+	 */
+	CCV_NNC_TENSOR_WRITE_COMPRESS = 0x1,
+};
+/**
+ * Write a batch of tensors to a SQLite database. Unlike calling ccv_nnc_tensor_write repeatedly, this
+ * reuses one prepared statement and writes all tensors in one transaction (unless the caller already
+ * started one).
+ * @param tensors The tensors.
+ * @param names The names to find the tensors in the database.
+ * @param tensor_size The number of tensors.
+ * @param handle The SQLite handle.
+ * @param flags CCV_NNC_TENSOR_WRITE_COMPRESS or 0.
+ * @return CCV_IO_FINAL for success, otherwise error.
+ */
+int ccv_nnc_tensors_write(const ccv_nnc_tensor_t* const* const tensors, const char* const* const names, const int tensor_size, void* const handle, const int flags);
 /**
  * Read a tensor from a SQLite database with a given name.
  * @param handle The SQLite handle.
@@ -309,6 +370,72 @@ int ccv_nnc_tensor_write(const ccv_nnc_tensor_t* const tensor, void* const handl
  * @return CCV_IO_FINAL for success, otherwise error.
  */
 int ccv_nnc_tensor_read(void* const handle, const char* const name, ccv_nnc_tensor_t** const tensor_out);
+/**
+ * Opaque pointer to a writer of the memory-mapped tensor container. Unlike the SQLite database, tensor
+ * data in this container is page aligned, thus, can be mapped into memory and used without a copy.
+ */
+typedef struct ccv_nnc_tensor_mmap_writer_s ccv_nnc_tensor_mmap_writer_t;
+/**
+ * Opaque pointer to a memory-mapped tensor container opened for read.
+ */
+typedef struct ccv_nnc_tensor_mmap_s ccv_nnc_tensor_mmap_t;
+/**
+ * Create a new memory-mapped tensor container at the given file path. Existing file will be truncated.
+ * @param fn The file path.
+ * @return The writer, 0 if the file cannot be opened.
+ */
+CCV_WARN_UNUSED(ccv_nnc_tensor_mmap_writer_t*) ccv_nnc_tensor_mmap_writer_new(const char* const fn);
+/**
+ * Write tensor to the memory-mapped tensor container with a given name. Writing the same name again
+ * will shadow the earlier one.
+ * @param writer The writer.
+ * @param tensor The tensor.
+ * @param name The name to find the tensor in the container.
+ * @return CCV_IO_FINAL for success, otherwise error.
+ */
+int ccv_nnc_tensor_mmap_write(ccv_nnc_tensor_mmap_writer_t* const writer, const ccv_nnc_tensor_t* const tensor, const char* const name);
+/**
+ * Finish writing the memory-mapped tensor container and free the writer. The container is not
+ * readable until this is called.
+ * @param writer The writer.
+ * @return CCV_IO_FINAL for success, otherwise error.
+ */
+int ccv_nnc_tensor_mmap_writer_free(ccv_nnc_tensor_mmap_writer_t* const writer);
+/**
+ * Map a memory-mapped tensor container into memory. The mapping is read-only and shared, thus,
+ * processes open the same file share the same physical memory.
+ * @param fn The file path.
+ * @return The opened container, 0 if the file cannot be opened or is not a valid container.
+ */
+CCV_WARN_UNUSED(ccv_nnc_tensor_mmap_t*) ccv_nnc_tensor_mmap_new(const char* const fn);
+/**
+ * Read a tensor from the memory-mapped tensor container with a given name. If the tensor is not
+ * supplied and it is a CPU tensor, the returned tensor points directly to the mapped pages. Such
+ * tensor is read-only, and the container has to outlive it.
+ * @param tensor_mmap The opened container.
+ * @param name The name to find the tensor in the container.
+ * @param tensor_out The pointer to hold the tensor. If you supply the tensor yourself, we will copy the data into the existing tensor.
+ * @return CCV_IO_FINAL for success, otherwise error.
+ */
+int ccv_nnc_tensor_mmap_read(ccv_nnc_tensor_mmap_t* const tensor_mmap, const char* const name, ccv_nnc_tensor_t** const tensor_out);
+/**
+ * Unmap and free the memory-mapped tensor container.
+ * @param tensor_mmap The opened container.
+ */
+void ccv_nnc_tensor_mmap_free(ccv_nnc_tensor_mmap_t* const tensor_mmap);
+/**
+ * Mark the tensor data as modified. CPU kernels may keep a packed copy of a tensor (for example, convolution weights
+ * re-laid out for SIMD) and reuse it until the tensor is written. Outputs of ccv_nnc_cmd_exec and tensors read with
+ * ccv_nnc_tensor_read are marked automatically, you only need to call this after modifying tensor data directly.
+ * @param tensor The tensor that is modified.
+ */
+void ccv_nnc_tensor_data_touch(const ccv_nnc_tensor_t* const tensor);
+/**
+ * Set the maximum size of the packed tensor data cache. The cache is disabled by default. Once enabled, a tensor's data
+ * is assumed unchanged unless it is marked with ccv_nnc_tensor_data_touch (see above).
+ * @param limit The maximum size in bytes of packed data to keep, 0 disables the cache.
+ */
+void ccv_nnc_tensor_packed_cache_set_limit(const size_t limit);
 
 /** @} */
 
@@ -396,6 +523,20 @@ CCV_WARN_UNUSED(uint32_t) ccv_nnc_cmd_find_backend(const ccv_nnc_cmd_t cmd, cons
  * @return The modified cmd that contains the updated configuration.
  */
 CCV_WARN_UNUSED(ccv_nnc_cmd_t) ccv_nnc_cmd_autotune(const ccv_nnc_cmd_t cmd, const size_t max_workspace_size, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context);
+/**
+ * Persist autotune decisions to a file (a sqlite3 database) and load the ones persisted before. Autotune decisions
+ * are memoized by the command, its parameters, the hint, the tensor shapes and data types and the host (processor
+ * model, cores and instruction sets), thus, only the first autotune for a given configuration does the measurement.
+ * Without calling this, the file named by CCV_NNC_AUTOTUNE_CACHE environment variable is used, if any.
+ * @param fn The file name, 0 to keep the decisions in memory only.
+ * @return 0 if succeeded, -1 if the file cannot be opened.
+ */
+int ccv_nnc_cmd_autotune_cache_set_file(const char* const fn);
+/**
+ * Forget the autotune decisions memoized in memory, thus, the next autotune will do the measurement again (or
+ * load from the persisted file if it is reopened).
+ */
+void ccv_nnc_cmd_autotune_cache_drain(void);
 /**
  * Check whether a given tensor input / output pattern can be computed by the given command.
  * bitmasks encode whether a given input tensor / output tensor available at a position.
@@ -472,7 +613,7 @@ CCV_WARN_UNUSED(int) ccv_nnc_cmd_enforce_inplace(const ccv_nnc_cmd_t cmd, const
 // Control flow constructs
 // Follow heavily based along CUDA's stream / event idea.
 enum {
-	CCV_STREAM_CONTEXT_CPU = 0x1, /**< A CPU based stream context (unsupported). */
+	CCV_STREAM_CONTEXT_CPU = 0x1, /**< A CPU based stream context. Graph runs on it dispatch to a shared thread pool. */
 	CCV_STREAM_CONTEXT_GPU = 0x2, /**< A GPU based stream context. */
 };
 #define CCV_STREAM_GET_CONTEXT(type) ((type) & 0x3)
@@ -557,6 +698,20 @@ void ccv_nnc_stream_context_remove_destructor_hook(ccv_nnc_stream_context_t* con
  * @param stream_context The stream context to be destroyed.
  */
 void ccv_nnc_stream_context_free(ccv_nnc_stream_context_t* const stream_context);
+/**
+ * Set the number of threads in the work-stealing thread pool backing CPU stream contexts. When a graph
+ * runs with CPU stream contexts, commands scheduled on different streams run on this pool concurrently.
+ * The pool is opt-in, by default, everything runs inline on the thread that runs the graph.
+ * This shouldn't be called while any CPU stream context has work in flight.
+ * @param thread_count The number of threads. 0 means one per online core, 1 (the default) runs everything
+ *        inline on the thread that runs the graph.
+ */
+void ccv_nnc_stream_context_set_cpu_thread_count(const int thread_count);
+/**
+ * Get the number of threads in the thread pool backing CPU stream contexts.
+ * @return The number of threads.
+ */
+CCV_WARN_UNUSED(int) ccv_nnc_stream_context_cpu_thread_count(void);
 
 /**
  * Opaque pointer to the signal object.
@@ -917,6 +1072,67 @@ void ccv_nnc_graph_exec_add_as_affected(ccv_nnc_graph_t* const graph, const ccv_
 
 /** @} */
 
+/**
+ * @defgroup level_2_profiler Profiler
+ * @{
+ */
+
+enum {
+	CCV_NNC_PROFILER_SYNC = 0x1, /**< Wait for the GPU stream after each command, thus, the recorded time covers the execution on the device rather than the dispatch. */
+};
+
+/**
+ * One command execution recorded by the profiler.
+ */
+typedef struct {
+	uint32_t cmd; /**< The command identifier. */
+	uint32_t backend; /**< The backend the command ran with. */
+	int algorithm; /**< The algorithm the command ran with. */
+	int thread_id; /**< A sequential identifier of the host thread that executed the command. */
+	int stream_type; /**< The type of the stream context, 0 if there is none. */
+	int exec_idx; /**< The index of the execution node if it runs as part of a concrete graph, -1 otherwise. */
+	const ccv_nnc_stream_context_t* stream; /**< The stream context the command executed on. */
+	const ccv_nnc_graph_t* graph; /**< The concrete graph the execution node belongs to. */
+	uint64_t start; /**< When the execution started, from ccv_nnc_cmd_mono_time. */
+	uint64_t end; /**< When the execution ended, from ccv_nnc_cmd_mono_time. */
+	size_t bytes; /**< The bytes of input and output tensors the command touched. */
+	size_t workspace_size; /**< The largest workspace the command requested from its stream context. */
+} ccv_nnc_profiler_event_t;
+
+/**
+ * Start to record every command execution (either directly from ccv_nnc_cmd_exec or as part of a graph run).
+ * Recording is per thread and doesn't contend on locks, but it is off unless started.
+ * @param flags Any of CCV_NNC_PROFILER_* flags.
+ */
+void ccv_nnc_profiler_start(const int flags);
+/**
+ * Stop recording. Events recorded so far are kept.
+ */
+void ccv_nnc_profiler_stop(void);
+/**
+ * Discard all events recorded so far. This shouldn't be called while any command is in flight.
+ */
+void ccv_nnc_profiler_reset(void);
+/**
+ * Collect events recorded so far from all threads, sorted by the time they started. This shouldn't be
+ * called while any command is in flight.
+ * @return An array of ccv_nnc_profiler_event_t, you are responsible to free it with ccv_array_free.
+ */
+CCV_WARN_UNUSED(ccv_array_t*) ccv_nnc_profiler_events(void);
+/**
+ * Export events recorded so far in Chrome trace event format (JSON), which can be opened with chrome://tracing
+ * or Perfetto.
+ * @param out The output file stream.
+ */
+void ccv_nnc_profiler_write_chrome_trace(FILE* out);
+/**
+ * Write a table that aggregates events recorded so far by command and backend, sorted by the total time spent.
+ * @param out The output file stream.
+ */
+void ccv_nnc_profiler_write_summary(FILE* out);
+
+/** @} */
+
 /** @} */
 
 /**
@@ -1018,6 +1234,16 @@ CCV_WARN_UNUSED(ccv_nnc_symbolic_graph_t*) ccv_nnc_symbolic_graph_new(void);
  * @return A tensor symbol reference.
  */
 CCV_WARN_UNUSED(ccv_nnc_tensor_symbol_t) ccv_nnc_tensor_symbol_new(ccv_nnc_symbolic_graph_t* const graph, const ccv_nnc_tensor_param_t info, const char* const name);
+/**
+ * Create a constant tensor symbol. The content of the tensor is copied into the symbolic graph, thus, the tensor
+ * can be freed afterwards. A constant tensor symbol is bound to its content when compiled, and any commands that
+ * only take constants as inputs can be evaluated ahead of time with CCV_NNC_SIMPLIFY_CONSTANT_FOLDING.
+ * @param graph The symbolic graph.
+ * @param tensor The tensor that contains the content.
+ * @param name The name of the tensor symbol, it is optional.
+ * @return A tensor symbol reference.
+ */
+CCV_WARN_UNUSED(ccv_nnc_tensor_symbol_t) ccv_nnc_tensor_symbol_constant_new(ccv_nnc_symbolic_graph_t* const graph, const ccv_nnc_tensor_t* const tensor, const char* const name);
 /**
  * Create an alias to the tensor symbol as tensor view (thus, pointing to the same memory region, but with a different header info and offset).
  * @param graph The symbolic graph.
@@ -1155,8 +1381,24 @@ typedef struct {
 	} context;
 } ccv_nnc_symbolic_graph_compile_allocator_t;
 
+enum {
+	CCV_NNC_MEMORY_PLANNER_GREEDY = 0, /**< Greedily assign tensor blocks to a few dis-continuous buffers. This is the default. */
+	CCV_NNC_MEMORY_PLANNER_PACKING = 1, /**< Pack tensor blocks into one buffer per memory type by searching their offsets. */
+};
+
+typedef struct {
+	int type; /**< The memory planner, CCV_NNC_MEMORY_PLANNER_GREEDY or CCV_NNC_MEMORY_PLANNER_PACKING. */
+	/**
+	 * For the packing planner, how many placements the exact search can try to improve over the heuristics.
+	 * 0 uses the default, negative disables the exact search. The packing planner only applies to graphs without
+	 * sub-graphs (while / case..of), other graphs use the greedy planner.
+	 */
+	int search_limit;
+} ccv_nnc_memory_planner_t;
+
 typedef struct {
 	ccv_nnc_symbolic_graph_compile_allocator_t allocator;
+	ccv_nnc_memory_planner_t memory_planner;
 } ccv_nnc_symbolic_graph_compile_param_t;
 
 /**
@@ -1247,6 +1489,38 @@ void ccv_nnc_symbolic_graph_write(const ccv_nnc_symbolic_graph_t* const graph, c
  * @param tensor_bind_size_ref The pointer to store the size of the binding array.
  */
 void ccv_nnc_symbolic_graph_read(const char* const fn, ccv_nnc_symbolic_graph_t** const graph_ref, ccv_nnc_tensor_bind_t** const tensor_binds_ref, int* const tensor_bind_size_ref);
+/**
+ * Write symbolic graph to disk along with its compilation plan (the tensor arena layout and the tensor life-time
+ * analysis). Reading it back with ccv_nnc_symbolic_graph_compile_read skips the expensive part of the compilation.
+ * Graphs with sub-graphs (while / case..of) only have the symbolic graph written and will be compiled on read.
+ * @param symbolic_graph The symbolic graph.
+ * @param compile_params A ccv_nnc_symbolic_graph_compile_param_t struct defines compilation parameters.
+ * @param tensor_binds The binding array (pair of tensor symbol and concrete tensor).
+ * @param tensor_bind_size The size of the binding array.
+ * @param outputs The output tensor symbols that we want to keep the value.
+ * @param output_size The size of the output tensor symbols array.
+ * @param sources The sources for the graph.
+ * @param source_size The size of the sources array. 0 to use default sources.
+ * @param destinations The destinations for the graph.
+ * @param destination_size The size of the destinations array. 0 to use default destinations.
+ * @param fn The file name.
+ */
+void ccv_nnc_symbolic_graph_compile_write(const ccv_nnc_symbolic_graph_t* const symbolic_graph, const ccv_nnc_symbolic_graph_compile_param_t compile_params, const ccv_nnc_tensor_bind_t* const tensor_binds, const int tensor_bind_size, const ccv_nnc_tensor_symbol_t* const outputs, const int output_size, const ccv_nnc_graph_exec_symbol_t* const sources, const int source_size, const ccv_nnc_graph_exec_symbol_t* const destinations, const int destination_size, const char* const fn);
+/**
+ * Read symbolic graph from disk and materialize the concrete graph with the written compilation plan. If the plan
+ * is missing, is written by a different version or doesn't match the symbolic graph read back, this falls back to
+ * ccv_nnc_symbolic_graph_compile. The binding tensors are owned by the caller, as with ccv_nnc_symbolic_graph_read.
+ * @param fn The file name.
+ * @param compile_params A ccv_nnc_symbolic_graph_compile_param_t struct defines compilation parameters.
+ * @param symbolic_graph_ref The pointer to store symbolic graph.
+ * @param tensor_binds_ref The pointer to store the binding array.
+ * @param tensor_bind_size_ref The pointer to store the size of the binding array.
+ * @param graph_ref The pointer to store the generated concrete graph.
+ * @param tensor_arena_ref The pointer to store ccv_nnc_tensor_arena_t.
+ * @param graph_exec_arena_ref The pointer to store ccv_nnc_graph_exec_arena_t.
+ * @return 1 if the concrete graph is materialized with the plan, 0 if it is compiled from scratch.
+ */
+int ccv_nnc_symbolic_graph_compile_read(const char* const fn, const ccv_nnc_symbolic_graph_compile_param_t compile_params, ccv_nnc_symbolic_graph_t** const symbolic_graph_ref, ccv_nnc_tensor_bind_t** const tensor_binds_ref, int* const tensor_bind_size_ref, ccv_nnc_graph_t** const graph_ref, ccv_nnc_tensor_arena_t** const tensor_arena_ref, ccv_nnc_graph_exec_arena_t** const graph_exec_arena_ref);
 
 /** @} */
 
@@ -1308,6 +1582,23 @@ int ccv_nnc_tensor_symbol_set_flags(ccv_nnc_symbolic_graph_t* const graph, const
  * @param tensor The tensor symbol reference.
  */
 CCV_WARN_UNUSED(int) ccv_nnc_tensor_symbol_flags(ccv_nnc_symbolic_graph_t* const graph, const ccv_nnc_tensor_symbol_t tensor);
+/**
+ * Make an existing tensor symbol a constant. The content of the tensor is copied into the symbolic graph. This is
+ * useful for parameters of an inference graph that won't change once the graph is loaded. A constant tensor symbol
+ * cannot be the output of any command.
+ * @param graph The symbolic graph.
+ * @param tensor The tensor symbol reference, it cannot be an alias.
+ * @param constant The tensor that contains the content.
+ * @return non-zero if cannot make it a constant.
+ */
+int ccv_nnc_tensor_symbol_set_constant(ccv_nnc_symbolic_graph_t* const graph, const ccv_nnc_tensor_symbol_t tensor, const ccv_nnc_tensor_t* const constant);
+/**
+ * Get the content of a constant tensor symbol.
+ * @param graph The symbolic graph.
+ * @param tensor The tensor symbol reference.
+ * @return The tensor that contains the content, 0 if it is not a constant.
+ */
+CCV_WARN_UNUSED(const ccv_nnc_tensor_t*) ccv_nnc_tensor_symbol_constant(const ccv_nnc_symbolic_graph_t* const graph, const ccv_nnc_tensor_symbol_t tensor);
 /**
  * Set the cmd of this exec symbol.
  * @param graph The symbolic graph.
@@ -1448,6 +1739,14 @@ void ccv_nnc_graph_exec_symbol_to(const ccv_nnc_symbolic_graph_t* const graph, c
  * @return The total allocated size in bytes.
  */
 CCV_WARN_UNUSED(uint64_t) ccv_nnc_tensor_arena_size(const ccv_nnc_tensor_arena_t* const tensor_arena);
+/**
+ * The lower bound of the size allocated on the opaque tensor arena structure. This is the peak size of the tensors
+ * that cannot share memory with each other, no memory planner can do better than this. Comparing it with
+ * ccv_nnc_tensor_arena_size tells how much memory is left on the table.
+ * @param tensor_arena The tensor arena object generated through compilation.
+ * @return The lower bound in bytes.
+ */
+CCV_WARN_UNUSED(uint64_t) ccv_nnc_tensor_arena_size_lower_bound(const ccv_nnc_tensor_arena_t* const tensor_arena);
 /**
  * Query whether a set of sources are the ancestors to a set of destination nodes.
  * @param graph The symbolic graph.
@@ -2058,10 +2357,15 @@ enum {
 	CCV_NNC_SIMPLIFY_DATA_TRANSFER_OPT,
 	/**
 	 * Combine a few smaller ops into bigger one. For now, this functionality is limited. I can only address ops
-	 * that are sequential.
+	 * that are sequential. On CPU, convolution followed by inference batch norm and / or an activation, GEMM
+	 * followed by an activation, and chains of element-wise ops are fused into one kernel.
 	 */
 	CCV_NNC_SIMPLIFY_OPS_FUSION,
-	// CCV_NNC_SIMPLIFY_CONSTANT_FOLDING, // This currently is not supported, because we don't have efficient way to express constant in symbolic graph.
+	/**
+	 * Evaluate commands that only take constant tensor symbols as inputs, and replace their outputs with constant
+	 * tensor symbols that contain the precomputed result. For now, this only evaluates commands on CPU.
+	 */
+	CCV_NNC_SIMPLIFY_CONSTANT_FOLDING,
 };
 /**
  * Simplify a graph with given list of passes, in that particular order.
@@ -2181,6 +2485,31 @@ void ccv_nnc_symbolic_graph_memory_compression(ccv_nnc_symbolic_graph_t* const g
 
 /** @} */
 
+/**
+ * @defgroup level_3_5_quantization Quantization
+ * @{
+ */
+
+/**
+ * Quantize the convolution and GEMM (including the fused ones without batch norm) to 8-bit with the observed ranges
+ * of their inputs (post-training quantization). For each input with a range, a quantize command is inserted to
+ * convert it to 8U with the scale and zero point derived from the range, and the consumers are replaced with the
+ * quantized commands, which quantize their weights per output channel. The outputs stay in 32F. The quantize
+ * command for an input of the graph is not connected to any node, thus, you need to update the sources afterwards.
+ *
+ * @param graph The symbolic graph.
+ * @param symbols The tensor symbols with observed ranges.
+ * @param ranges The observed ranges, for each symbol, the min and the max.
+ * @param symbol_size The size of the tensor symbols array.
+ * @param sources The source execution node symbols array.
+ * @param source_size The size of source node symbols array.
+ * @param destinations The destinations execution node symbols array.
+ * @param destination_size The size of destination node symbols array.
+ */
+void ccv_nnc_symbolic_graph_quantize(ccv_nnc_symbolic_graph_t* const graph, const ccv_nnc_tensor_symbol_t* const symbols, const float* const ranges, const int symbol_size, const ccv_nnc_graph_exec_symbol_t* const sources, const int source_size, const ccv_nnc_graph_exec_symbol_t* const destinations, const int destination_size);
+
+/** @} */
+
 /** @} */
 
 /**
@@ -2380,6 +2709,14 @@ void ccv_nnc_dynamic_graph_set_no_grad(ccv_nnc_dynamic_graph_t* const dynamic_gr
  * @param dynamic_graph The dynamic graph.
  */
 void ccv_nnc_dynamic_graph_gc(ccv_nnc_dynamic_graph_t* const dynamic_graph);
+/**
+ * Set the high-water mark for the CPU memory the dynamic graph retains for reuse. When freeing a
+ * tensor variable would retain more than this, the memory will be released instead. Setting it lower
+ * than what is retained now will collect the retained CPU memory. The default is 256MiB.
+ * @param dynamic_graph The dynamic graph.
+ * @param limit The maximum bytes of CPU memory to retain, 0 disables the reuse of CPU memory.
+ */
+void ccv_nnc_dynamic_graph_set_cpu_cache_limit(ccv_nnc_dynamic_graph_t* const dynamic_graph, const size_t limit);
 /**
  * Dispose a tensor variable. You cannot do any computation against this tensor variable afterwards.
  * @param graph The dynamic graph.
@@ -2618,6 +2955,20 @@ typedef struct ccv_cnnp_dataframe_iter_s ccv_cnnp_dataframe_iter_t;
  * @return The opaque iterator object.
  */
 CCV_WARN_UNUSED(ccv_cnnp_dataframe_iter_t*) ccv_cnnp_dataframe_iter_new(ccv_cnnp_dataframe_t* const dataframe, const int* const column_idxs, const int column_idx_size);
+/**
+ * Get a new asynchronous iterator of the dataframe. A background thread prepares the rows in order and keeps up to
+ * depth rows ready ahead of ccv_cnnp_dataframe_iter_next, it waits when that many rows are ready. The rows are
+ * prepared without stream context, thus, the stream context passed to ccv_cnnp_dataframe_iter_next only marks where
+ * the data is used, the data won't be reused until that stream context finishes its work. Because the enum / map
+ * functions are called from the background thread, other iterators of the same dataframe shouldn't be used, and
+ * the dataframe shouldn't be shuffled while the iterator is in the middle of the dataframe.
+ * @param dataframe The dataframe object to iterate through.
+ * @param column_idxs The columns that will be iterated.
+ * @param column_idx_size The size of columns array.
+ * @param depth How many rows to keep ready ahead.
+ * @return The opaque iterator object.
+ */
+CCV_WARN_UNUSED(ccv_cnnp_dataframe_iter_t*) ccv_cnnp_dataframe_async_iter_new(ccv_cnnp_dataframe_t* const dataframe, const int* const column_idxs, const int column_idx_size, const int depth);
 /**
  * Get the next item from the iterator.
  * @param iter The iterator to go through.
@@ -2638,7 +2989,8 @@ int ccv_cnnp_dataframe_iter_next(ccv_cnnp_dataframe_iter_t* const iter, void** c
 void ccv_cnnp_dataframe_iter_peek(ccv_cnnp_dataframe_iter_t* const iter, void** const data_ref, const int offset, const int data_ref_size, ccv_nnc_stream_context_t* const stream_context);
 /**
  * Prefetch next item on the iterator with the given stream context. You can call this method multiple times
- * to prefetch multiple items ahead of time.
+ * to prefetch multiple items ahead of time. For an asynchronous iterator, this only starts the background thread
+ * if it is not running yet.
  * @param iter The iterator to go through.
  * @param prefetch_count How much ahead we should advance for.
  * @param stream_context The stream context to extract data asynchronously.
@@ -2723,6 +3075,17 @@ CCV_WARN_UNUSED(int) ccv_cnnp_dataframe_add_aux(ccv_cnnp_dataframe_t* const data
  * @return The index of the newly derived column.
  */
 CCV_WARN_UNUSED(int) ccv_cnnp_dataframe_read_image(ccv_cnnp_dataframe_t* const dataframe, const int column_idx, const off_t structof, const char* name);
+/**
+ * Decode image off a said column. That column should contain ccv_cnnp_record_t, with the encoded image as its data,
+ * for example, the column from ccv_cnnp_dataframe_from_shards_new. The new column will contain the
+ * ccv_dense_matrix_t / ccv_nnc_tensor_t (both are toll-free bridging) of the image, or 0 if the record is 0 or
+ * cannot be decoded.
+ * @param dataframe The dataframe object that decodes the images.
+ * @param column_idx The column which contains the records.
+ * @param name The name of the new column.
+ * @return The index of the newly derived column.
+ */
+CCV_WARN_UNUSED(int) ccv_cnnp_dataframe_decode_image(ccv_cnnp_dataframe_t* const dataframe, const int column_idx, const char* name);
 /**
  * The structure to describe how to apply random jitter to the image.
  */
@@ -2754,7 +3117,8 @@ typedef struct {
 	} normalize;
 } ccv_cnnp_random_jitter_t;
 /**
- * Apply random jitter on a image to generate a new image.
+ * Apply random jitter on a image to generate a new image. If there is no image (it is 0), the new image is filled
+ * with 0 at the final size, or 0 if the final size is not set.
  * @param dataframe The dataframe object that contains the original image.
  * @param column_idx The column which contains the original image.
  * @param datatype The final datatype of the image. We only support CCV_32F right now.
@@ -2763,6 +3127,23 @@ typedef struct {
  * @return The index of the newly derived column.
  */
 CCV_WARN_UNUSED(int) ccv_cnnp_dataframe_image_random_jitter(ccv_cnnp_dataframe_t* const dataframe, const int column_idx, const int datatype, const ccv_cnnp_random_jitter_t random_jitter, const char* name);
+/**
+ * Apply random jitter on a image to generate a tensor. Unlike ccv_cnnp_dataframe_image_random_jitter, which does
+ * resize, crop, flip, color changes and normalization one after another on the whole image, this computes the
+ * output in one pass, row by row, from the decoded image and writes it in the given datatype and format. Thus,
+ * if these match the ones for ccv_cnnp_dataframe_combine_new, batching is a plain copy. It draws the same random
+ * numbers as ccv_cnnp_dataframe_image_random_jitter, but it scales up with bilinear rather than bicubic interpolation,
+ * and the mean for contrast is computed from the original image, thus, the result is close but not identical.
+ * If there is no image (it is 0), the tensor is filled with 0 at the final size, or 0 if the final size is not set.
+ * @param dataframe The dataframe object that contains the original image.
+ * @param column_idx The column which contains the original image (as 8-bit RGB).
+ * @param datatype The datatype of the tensor. We support CCV_32F and CCV_16F.
+ * @param format The format of the tensor, CCV_TENSOR_FORMAT_NHWC or CCV_TENSOR_FORMAT_NCHW.
+ * @param random_jitter The random jitter parameters to be applied to.
+ * @param name The name of the new column.
+ * @return The index of the newly derived column.
+ */
+CCV_WARN_UNUSED(int) ccv_cnnp_dataframe_image_random_jitter_tensor(ccv_cnnp_dataframe_t* const dataframe, const int column_idx, const int datatype, const int format, const ccv_cnnp_random_jitter_t random_jitter, const char* name);
 /**
  * Generate a one-hot tensor off the label from a struct.
  * @param dataframe The dataframe object that contains the label.
@@ -2889,6 +3270,72 @@ enum {
  * @return A dataframe that can represent the csv file. nullptr if failed.
  */
 CCV_WARN_UNUSED(ccv_cnnp_dataframe_t*) ccv_cnnp_dataframe_from_csv_new(void* const input, const int type, const size_t len, const char delim, const char quote, const int include_header, int* const column_size);
+/**
+ * Parse the given columns of a dataframe created by ccv_cnnp_dataframe_from_csv_new into numerics. The parsing is done
+ * once, when this is called, into one contiguous array. The derived column is a 1-d tensor of column_idx_size values
+ * for each row, pointing to that array directly, thus, you should not modify it. Empty or malformed cells are 0.
+ * @param dataframe The dataframe object created by ccv_cnnp_dataframe_from_csv_new.
+ * @param column_idxs The columns to be parsed, in the order of the values in the tensor.
+ * @param column_idx_size The number of columns.
+ * @param datatype The datatype of the tensor. We support CCV_32F and CCV_32S.
+ * @param name The name of the new column.
+ * @return The index of the newly derived column.
+ */
+CCV_WARN_UNUSED(int) ccv_cnnp_dataframe_csv_numeric(ccv_cnnp_dataframe_t* const dataframe, const int* const column_idxs, const int column_idx_size, const int datatype, const char* name);
+/**
+ * The record read from a shard. The memory is owned by the dataframe.
+ */
+typedef struct {
+	void* data; /**< The data of the record, for example, the encoded image. */
+	size_t size; /**< The size of the data. */
+	char* meta; /**< The meta of the record, for example, the label of the image. It is always null-terminated. */
+	size_t meta_size; /**< The size of the meta, excluding the null terminator. */
+} ccv_cnnp_record_t;
+/**
+ * The opaque pointer to the shard writer.
+ */
+typedef struct ccv_cnnp_shard_writer_s ccv_cnnp_shard_writer_t;
+/**
+ * Create a new shard file. A shard is a sequential container of records followed by an index of these records.
+ * @param filename The file name of the shard.
+ * @return The shard writer, 0 if the file cannot be created.
+ */
+CCV_WARN_UNUSED(ccv_cnnp_shard_writer_t*) ccv_cnnp_shard_writer_new(const char* const filename);
+/**
+ * Append a record to the shard. Both the data and the meta need to be smaller than 4GiB.
+ * @param writer The shard writer.
+ * @param data The data of the record.
+ * @param size The size of the data.
+ * @param meta The meta of the record, can be 0.
+ * @param meta_size The size of the meta.
+ * @return 0 if the record is written, -1 otherwise.
+ */
+int ccv_cnnp_shard_writer_add(ccv_cnnp_shard_writer_t* const writer, const void* const data, const size_t size, const void* const meta, const size_t meta_size);
+/**
+ * Write the index and close the shard file.
+ * @param writer The shard writer to be freed.
+ * @return 0 if the shard is written successfully, -1 otherwise.
+ */
+int ccv_cnnp_shard_writer_free(ccv_cnnp_shard_writer_t* const writer);
+/**
+ * Create a dataframe object that streams records from shard files. The only column contains ccv_cnnp_record_t.
+ * Consecutive records of a shard are grouped into chunks up to the buffer size, and each chunk is read with one
+ * sequential read when the first row of it is needed. Thus, iterate the rows in order, and use
+ * ccv_cnnp_dataframe_shards_shuffle rather than ccv_cnnp_dataframe_shuffle, which reads the records randomly.
+ * If a shard cannot be read while iterating (for example, it is removed or truncated), its rows are 0. The image
+ * decoding and random jitters carry these through as no image, and zero-filled images at the final size.
+ * @param filenames The file names of the shards.
+ * @param filename_size The number of shards.
+ * @param buffer_size The size of the read buffer, 64MiB if it is 0.
+ * @return A dataframe that can represent the shards. nullptr if any shard cannot be read.
+ */
+CCV_WARN_UNUSED(ccv_cnnp_dataframe_t*) ccv_cnnp_dataframe_from_shards_new(const char* const* const filenames, const int filename_size, const size_t buffer_size);
+/**
+ * Shuffle the dataframe created from shards. The order of the shards is shuffled, and the records are shuffled within
+ * each chunk, thus, the reads are still sequential. It shouldn't be called while iterating.
+ * @param dataframe The dataframe created with ccv_cnnp_dataframe_from_shards_new.
+ */
+void ccv_cnnp_dataframe_shards_shuffle(ccv_cnnp_dataframe_t* const dataframe);
 
 /** @} */
 
@@ -3153,6 +3600,16 @@ enum {
 	 * Only write parameters to disk.
 	 */
 	CCV_CNNP_MODEL_CHECKPOINT_WRITE_ONLY,
+	/**
+	 * Can be combined with the above. When writing, snapshot the parameters and write the snapshot to disk
+	 * on a background thread, thus, the training can continue meanwhile. There is only one snapshot buffer,
+	 * reused across checkpoints, thus, the next checkpoint will wait for the previous write to finish.
+	 */
+	CCV_CNNP_MODEL_CHECKPOINT_ASYNC = 0x10,
+	/**
+	 * Can be combined with the above. When writing, compress the parameters (see CCV_NNC_TENSOR_WRITE_COMPRESS).
+	 */
+	CCV_CNNP_MODEL_CHECKPOINT_COMPRESS = 0x20,
 };
 /**
  * This method checkpoint the given model. If the model is initialized, it will persist all parameters
@@ -3160,9 +3617,17 @@ enum {
  * disk. Under the hood, it calls ccv_cnnp_model_write / ccv_cnnp_model_read when appropriate.
  * @param model The composed model.
  * @param fn The file name.
- * @param flags Whether we perform read / write on this checkpoint, or read only / write only.
+ * @param flags Whether we perform read / write on this checkpoint, or read only / write only. Optionally
+ *        combined with CCV_CNNP_MODEL_CHECKPOINT_ASYNC and CCV_CNNP_MODEL_CHECKPOINT_COMPRESS.
  */
 void ccv_cnnp_model_checkpoint(ccv_cnnp_model_t* const model, const char* const fn, const int flags);
+/**
+ * Wait for the pending asynchronous checkpoint (CCV_CNNP_MODEL_CHECKPOINT_ASYNC) to finish writing.
+ * You need to call this before reading the checkpoint file yourself. Freeing the model waits as well.
+ * @param model The composed model.
+ * @return CCV_IO_FINAL if the last asynchronous checkpoint is written successfully, otherwise error.
+ */
+int ccv_cnnp_model_checkpoint_wait(ccv_cnnp_model_t* const model);
 /**
  * Write model's tensors to a SQLite database with a given name. Note that we specifically say
  * "model's tensors" because it doesn't persist the model's structure. Hence, you shouldn't
@@ -3184,6 +3649,26 @@ int ccv_cnnp_model_write(const ccv_cnnp_model_t* const model, void* const handle
  * @return CCV_IO_FINAL for success, otherwise error.
  */
 int ccv_cnnp_model_read(void* const handle, const char* const name, const ccv_cnnp_model_t* const model_out);
+/**
+ * Write model's tensors to a memory-mapped tensor container with a given name. See ccv_cnnp_model_write.
+ * @param model The model.
+ * @param writer The memory-mapped tensor container writer.
+ * @param name The name to find the tensors related to the model in the container.
+ * @return CCV_IO_FINAL for success, otherwise error.
+ */
+int ccv_cnnp_model_mmap_write(const ccv_cnnp_model_t* const model, ccv_nnc_tensor_mmap_writer_t* const writer, const char* const name);
+/**
+ * Read model's tensors from a memory-mapped tensor container with a given name. If the model is not
+ * jit-compiled yet (no evaluate / fit calls so far), CPU parameters will point directly to the mapped
+ * pages rather than being copied. These parameters are read-only, thus, the model can only be used
+ * for inference, and the container has to outlive the model.
+ * @param tensor_mmap The opened memory-mapped tensor container.
+ * @param name The name to find the tensors related to the model in the container.
+ * @param model_out The model which you want to restore the tensors. It should have the same
+ *                  structure as the one in write to.
+ * @return CCV_IO_FINAL for success, otherwise error.
+ */
+int ccv_cnnp_model_mmap_read(ccv_nnc_tensor_mmap_t* const tensor_mmap, const char* const name, const ccv_cnnp_model_t* const model_out);
 /**
  * Apply data parallel to the composed model. This method has to be called before we call either
  * evaluate or fit and after the model is compiled.
@@ -3198,6 +3683,33 @@ void ccv_cnnp_model_set_data_parallel(ccv_cnnp_model_t* const model, const int p
  * @param memory_compression Whether to enable the memory compression (1 - enable, 0 - disable (default))
  */
 void ccv_cnnp_model_set_memory_compression(ccv_cnnp_model_t* const model, const int memory_compression);
+/**
+ * Set the maximum shapes of the inputs the model will see. The model is compiled against these shapes, thus, any
+ * inputs within them (smaller batch size, shorter sequence length) re-initialize the compiled tensor arena and
+ * graph exec arena in place rather than recompiling the model. Inputs exceeding the maximum shapes still cause
+ * a recompilation.
+ * @param model The composed model.
+ * @param inputs The maximum tensor parameters for the model's inputs. 0 to disable.
+ * @param input_size The size of the inputs array.
+ */
+void ccv_cnnp_model_set_max_inputs(ccv_cnnp_model_t* const model, const ccv_nnc_tensor_param_t* const inputs, const int input_size);
+/**
+ * Run the model over sample inputs to collect the ranges of the inputs to the convolution and GEMM layers, for
+ * post-training quantization. This can be called multiple times, the ranges accumulate. It doesn't change the
+ * compiled graph for evaluate / fit. The model has to be compiled and not data parallel.
+ * @param model The composed model.
+ * @param inputs The sample input tensors.
+ * @param input_size The size of the input tensors array.
+ * @param stream_context The stream where the calibration can be executed upon.
+ */
+void ccv_cnnp_model_calibrate(ccv_cnnp_model_t* const model, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_stream_context_t* const stream_context);
+/**
+ * Quantize the convolution and GEMM layers of the model to 8-bit with the ranges collected by
+ * ccv_cnnp_model_calibrate. See ccv_nnc_symbolic_graph_quantize. Afterwards, the model can only be evaluated
+ * without gradients (requires_grad = 0).
+ * @param model The composed model.
+ */
+void ccv_cnnp_model_quantize(ccv_cnnp_model_t* const model);
 /**
  * Set compile parameters on the model so it compiles the graph with the said parameters.
  * @param model The composed model.
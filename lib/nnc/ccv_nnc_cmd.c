@@ -1,6 +1,7 @@
 #include "ccv_nnc.h"
 #include "ccv_nnc_internal.h"
 #include "ccv_nnc_easy.h"
+#include "_ccv_nnc_stream.h"
 #ifdef HAVE_CUDA
 #include "gpu/ccv_nnc_compat.h"
 #endif
@@ -11,6 +12,9 @@
 #include <mach/mach.h>
 #include <mach/mach_time.h>
 #endif
+#ifdef CCV_NNC_CPU_DISPATCH
+#include <cpuid.h>
+#endif
 
 typedef struct {
 	const uint32_t cmd;
@@ -27,9 +31,47 @@ typedef struct {
 // The generated code configures command and its mapping.
 #include "cmd/ccv_nnc_cmd.inc"
 
+static int cpu_features_supported = 0;
+static int cpu_features = 0;
+
+static void _ccv_nnc_cpu_features_init(void)
+{
+#ifdef CCV_NNC_CPU_DISPATCH
+	__builtin_cpu_init();
+	int features = 0;
+	// Our AVX2 kernels use FMA throughout, thus, treat them as one.
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		features |= CCV_NNC_CPU_FEATURE_AVX2;
+	if ((features & CCV_NNC_CPU_FEATURE_AVX2) && __builtin_cpu_supports("avx512f"))
+		features |= CCV_NNC_CPU_FEATURE_AVX512F;
+	unsigned int eax, ebx, ecx, edx;
+	// F16C is CPUID.1:ECX[29], only useful along with the AVX2 kernels.
+	if ((features & CCV_NNC_CPU_FEATURE_AVX2) && __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & (1u << 29)))
+		features |= CCV_NNC_CPU_FEATURE_F16C;
+	// AVX512_BF16 is CPUID.(EAX=7,ECX=1):EAX[5].
+	if ((features & CCV_NNC_CPU_FEATURE_AVX512F) && __get_cpuid_count(7, 1, &eax, &ebx, &ecx, &edx) && (eax & (1u << 5)))
+		features |= CCV_NNC_CPU_FEATURE_AVX512BF16;
+	// AVX512_VNNI is CPUID.(EAX=7,ECX=0):ECX[11], our kernels use AVX512BW for the masked loads as well.
+	if ((features & CCV_NNC_CPU_FEATURE_AVX512F) && __builtin_cpu_supports("avx512bw") && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ecx & (1u << 11)))
+		features |= CCV_NNC_CPU_FEATURE_AVX512VNNI;
+	cpu_features_supported = cpu_features = features;
+#endif
+}
+
 void ccv_nnc_init(void)
 {
 	_ccv_nnc_cmd_init();
+	_ccv_nnc_cpu_features_init();
+}
+
+int ccv_nnc_cpu_features(void)
+{
+	return cpu_features;
+}
+
+void ccv_nnc_set_cpu_features(const int features)
+{
+	cpu_features = features & cpu_features_supported;
 }
 
 const char* ccv_nnc_cmd_name(const uint32_t cmd)
@@ -369,6 +411,25 @@ ccv_nnc_cmd_t ccv_nnc_cmd_autotune(const ccv_nnc_cmd_t cmd, const size_t max_wor
 	}
 	if (flag == 0)
 		return cmd;
+	// The decision for the same configuration on the same machine never changes, check whether we made it before.
+	const uint64_t autotune_key = ccv_nnc_cmd_autotune_key(cmd, max_workspace_size, hint, flags, inputs, input_size, outputs, output_size);
+	if (ccv_nnc_cmd_autotune_cache_find(autotune_key, &tuned_cmd))
+	{
+		for (i = 0; i < CCV_NNC_BACKEND_COUNT; i++)
+			if (backend_init_map[i].backend == tuned_cmd.backend)
+			{
+				const ccv_nnc_cmd_backend_registry_t api_registry = init_map[cmd_idx].backends[i];
+				// Make sure it is still a valid choice (the persisted one can be made by a different build).
+				if (api_registry.exec &&
+					(api_registry.tensor_memory & tensor_memory) == tensor_memory &&
+					(api_registry.tensor_formats & tensor_formats) == tensor_formats &&
+					(api_registry.tensor_datatypes & tensor_datatypes) == tensor_datatypes &&
+					tuned_cmd.algorithm >= -1 && (api_registry.autotune || tuned_cmd.algorithm < ccv_max(api_registry.algorithms, 1)))
+					return tuned_cmd;
+				break;
+			}
+		tuned_cmd = cmd;
+	}
 	_ccv_nnc_cmd_set_device_id(inputs, input_size, outputs, output_size, stream_context);
 	// Allocate inputs / outputs and fill them in.
 	ccv_nnc_tensor_t** const copy_inputs = (ccv_nnc_tensor_t**)cccalloc((input_size + output_size) * 2, sizeof(ccv_nnc_tensor_t*));
@@ -421,6 +482,7 @@ ccv_nnc_cmd_t ccv_nnc_cmd_autotune(const ccv_nnc_cmd_t cmd, const size_t max_wor
 					tuned_cmd.algorithm = api_registry.autotune(tuned_cmd, max_workspace_size, hint, flags, copy_inputs, input_size, copy_outputs, output_size, stream_context);
 					// Drain the context, autotune can use excessive amount of memory. Need to drain it now.
 					ccv_nnc_stream_context_drain(stream_context);
+					best_measured = 0;
 				}
 				break;
 			}
@@ -432,6 +494,9 @@ ccv_nnc_cmd_t ccv_nnc_cmd_autotune(const ccv_nnc_cmd_t cmd, const size_t max_wor
 			if (allocated_outputs[i])
 				ccv_nnc_tensor_free(allocated_outputs[i]);
 		ccfree(copy_inputs);
+		// Only remember it if the backend's autotune picked the algorithm.
+		if (best_measured >= 0)
+			ccv_nnc_cmd_autotune_cache_insert(autotune_key, tuned_cmd);
 		return tuned_cmd;
 	}
 	// We need to have trial loop through all the data.
@@ -499,6 +564,9 @@ ccv_nnc_cmd_t ccv_nnc_cmd_autotune(const ccv_nnc_cmd_t cmd, const size_t max_wor
 		if (allocated_outputs[i])
 			ccv_nnc_tensor_free(allocated_outputs[i]);
 	ccfree(copy_inputs);
+	// Only remember it if we measured something.
+	if (best_measured >= 0)
+		ccv_nnc_cmd_autotune_cache_insert(autotune_key, tuned_cmd);
 	return tuned_cmd;
 }
 
@@ -563,19 +631,30 @@ int ccv_nnc_cmd_exec(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const i
 	// If it is no-op, return as if succeed already.
 	if (cmd.cmd == CCV_NNC_NOOP)
 		return 0;
+	int i;
+	// Anything in flight on a CPU stream has to finish before we run inline on it.
+	if (stream_context)
+		ccv_nnc_stream_cpu_sync(stream_context);
 	_ccv_nnc_cmd_set_device_id(inputs, input_size, outputs, output_size, stream_context);
+	const int profiling = ccv_nnc_profiler_is_on;
+	ccv_nnc_profiler_mark_t profiler_mark;
+	if (profiling)
+		profiler_mark = ccv_nnc_profiler_begin();
 	// If it is a custom command, just apply it directly.
 	if (cmd.cmd == CCV_NNC_CUSTOM_FORWARD || cmd.cmd == CCV_NNC_CUSTOM_BACKWARD)
 	{
 		int ret = cmd.isa->exec(cmd, hint, flags, inputs, input_size, outputs, output_size, stream_context);
+		if (profiling)
+			ccv_nnc_profiler_end(profiler_mark, cmd, cmd.backend, inputs, input_size, outputs, output_size, stream_context);
 		if (!stream_context)
 			ccv_nnc_stream_context_drain(stream_context);
+		for (i = 0; i < output_size; i++)
+			ccv_nnc_tensor_data_touch(outputs[i]);
 		return ret;
 	}
 	assert(cmd.cmd != CCV_NNC_GRAPH_FORWARD && cmd.cmd != CCV_NNC_GRAPH_BACKWARD);
 	const int cmd_idx = _ccv_nnc_cmd_ph(cmd.cmd);
 	assert(cmd_idx >= 0 && cmd_idx < sizeof(init_map) / sizeof(init_map[0]));
-	int i;
 	uint32_t backend = cmd.backend;
 	if (backend == CCV_NNC_NO_BACKEND)
 	{
@@ -597,8 +676,13 @@ int ccv_nnc_cmd_exec(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const i
 		return CCV_NNC_EXEC_NO_KERNEL;
 	// Everything is out, call the underlying implementation.
 	int ret = api_registry.exec(cmd, hint, flags, inputs, input_size, outputs, output_size, stream_context);
+	if (profiling)
+		ccv_nnc_profiler_end(profiler_mark, cmd, backend, inputs, input_size, outputs, output_size, stream_context);
 	if (!stream_context)
 		ccv_nnc_stream_context_drain(stream_context);
+	// Outputs are written, any packed data derived from them is outdated.
+	for (i = 0; i < output_size; i++)
+		ccv_nnc_tensor_data_touch(outputs[i]);
 	return ret;
 }
 
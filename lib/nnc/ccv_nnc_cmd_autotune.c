@@ -0,0 +1,253 @@
+#include "ccv_nnc.h"
+#include "ccv_nnc_easy.h"
+#include "ccv_nnc_internal.h"
+#include "ccv_internal.h"
+#include "3rdparty/khash/khash.h"
+#include "3rdparty/sqlite3/sqlite3.h"
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#ifdef NDEBUG
+#define SQLITE_ENFORCE(stmt) (void)(stmt)
+#else
+#define SQLITE_ENFORCE assert
+#endif
+
+// MARK - Autotune Decision Cache
+
+// Bump this whenever the key layout changes, thus, decisions persisted by an older version won't be picked up.
+#define CCV_NNC_AUTOTUNE_CACHE_VERSION (2)
+
+typedef struct {
+	uint32_t backend;
+	int algorithm;
+} ccv_nnc_autotune_decision_t;
+
+KHASH_MAP_INIT_INT64(autotune, ccv_nnc_autotune_decision_t)
+
+static struct {
+	int init;
+	uint64_t host; // The signature of the host this process runs on.
+	khash_t(autotune)* decisions;
+	sqlite3* conn;
+	sqlite3_stmt* insert_stmt;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_t mutex;
+#endif
+} autotune_cache = {
+#ifdef HAVE_PTHREAD
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+#endif
+};
+
+static inline void _ccv_nnc_autotune_cache_lock(void)
+{
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&autotune_cache.mutex);
+#endif
+}
+
+static inline void _ccv_nnc_autotune_cache_unlock(void)
+{
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&autotune_cache.mutex);
+#endif
+}
+
+static uint64_t _ccv_nnc_autotune_host_signature(void)
+{
+	// The decisions are only good for the same machine: the same processor and the same number of cores. The
+	// instruction sets we are allowed to use can change at runtime, thus, folded into the key when it is computed.
+	int host[16 + 1];
+	memset(host, 0, sizeof(host));
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned int eax, ebx, ecx, edx;
+	int i;
+	// The processor brand string.
+	if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) && eax >= 0x80000004)
+		for (i = 0; i < 3; i++)
+		{
+			__get_cpuid(0x80000002 + i, &eax, &ebx, &ecx, &edx);
+			host[i * 4] = eax, host[i * 4 + 1] = ebx, host[i * 4 + 2] = ecx, host[i * 4 + 3] = edx;
+		}
+#endif
+	host[16] = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	return ccv_cache_generate_signature((const char*)host, sizeof(host), CCV_EOF_SIGN);
+}
+
+static void _ccv_nnc_autotune_cache_close(void)
+{
+	if (autotune_cache.insert_stmt)
+		sqlite3_finalize(autotune_cache.insert_stmt);
+	autotune_cache.insert_stmt = 0;
+	if (autotune_cache.conn)
+		sqlite3_close(autotune_cache.conn);
+	autotune_cache.conn = 0;
+}
+
+static int _ccv_nnc_autotune_cache_open(const char* const fn)
+{
+	_ccv_nnc_autotune_cache_close();
+	if (!fn)
+		return 0;
+	sqlite3* conn = 0;
+	if (SQLITE_OK != sqlite3_open(fn, &conn))
+	{
+		if (conn)
+			sqlite3_close(conn);
+		return -1;
+	}
+	const char autotune_create_table_qs[] = "CREATE TABLE IF NOT EXISTS autotune "
+		"(key INTEGER PRIMARY KEY ASC, backend INTEGER, algorithm INTEGER)";
+	if (SQLITE_OK != sqlite3_exec(conn, autotune_create_table_qs, 0, 0, 0))
+	{
+		sqlite3_close(conn);
+		return -1;
+	}
+	const char autotune_select_qs[] = "SELECT key, backend, algorithm FROM autotune";
+	sqlite3_stmt* autotune_select_stmt = 0;
+	if (SQLITE_OK == sqlite3_prepare_v2(conn, autotune_select_qs, sizeof(autotune_select_qs), &autotune_select_stmt, 0))
+	{
+		int ret;
+		while (SQLITE_ROW == sqlite3_step(autotune_select_stmt))
+		{
+			const uint64_t key = (uint64_t)sqlite3_column_int64(autotune_select_stmt, 0);
+			khiter_t k = kh_put(autotune, autotune_cache.decisions, key, &ret);
+			kh_val(autotune_cache.decisions, k).backend = (uint32_t)sqlite3_column_int64(autotune_select_stmt, 1);
+			kh_val(autotune_cache.decisions, k).algorithm = sqlite3_column_int(autotune_select_stmt, 2);
+		}
+		sqlite3_finalize(autotune_select_stmt);
+	}
+	const char autotune_insert_qs[] = "REPLACE INTO autotune (key, backend, algorithm) VALUES ($key, $backend, $algorithm)";
+	SQLITE_ENFORCE(SQLITE_OK == sqlite3_prepare_v2(conn, autotune_insert_qs, sizeof(autotune_insert_qs), &autotune_cache.insert_stmt, 0));
+	autotune_cache.conn = conn;
+	return 0;
+}
+
+static void _ccv_nnc_autotune_cache_init(void)
+{
+	if (autotune_cache.init)
+		return;
+	autotune_cache.init = 1;
+	autotune_cache.host = _ccv_nnc_autotune_host_signature();
+	autotune_cache.decisions = kh_init(autotune);
+	// Pick up the decisions made by the previous runs.
+	const char* const fn = getenv("CCV_NNC_AUTOTUNE_CACHE");
+	if (fn && fn[0])
+		_ccv_nnc_autotune_cache_open(fn);
+}
+
+int ccv_nnc_cmd_autotune_cache_set_file(const char* const fn)
+{
+	_ccv_nnc_autotune_cache_lock();
+	_ccv_nnc_autotune_cache_init();
+	const int result = _ccv_nnc_autotune_cache_open(fn);
+	_ccv_nnc_autotune_cache_unlock();
+	return result;
+}
+
+void ccv_nnc_cmd_autotune_cache_drain(void)
+{
+	_ccv_nnc_autotune_cache_lock();
+	if (autotune_cache.decisions)
+		kh_clear(autotune, autotune_cache.decisions);
+	_ccv_nnc_autotune_cache_unlock();
+}
+
+static void _ccv_nnc_autotune_key_tensor(int* const key, const ccv_nnc_tensor_t* const tensor)
+{
+	key[0] = !!tensor;
+	if (!tensor)
+		return;
+	key[1] = tensor->info.type;
+	key[2] = tensor->info.format;
+	key[3] = tensor->info.datatype;
+	memcpy(key + 4, tensor->info.dim, sizeof(tensor->info.dim));
+	// The strides matter for the kernels as well.
+	if (CCV_IS_TENSOR_VIEW(tensor))
+		memcpy(key + 4 + CCV_NNC_MAX_DIM_ALLOC, ((ccv_nnc_tensor_view_t*)tensor)->inc, sizeof(((ccv_nnc_tensor_view_t*)tensor)->inc));
+}
+
+uint64_t ccv_nnc_cmd_autotune_key(const ccv_nnc_cmd_t cmd, const size_t max_workspace_size, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size)
+{
+	_ccv_nnc_autotune_cache_lock();
+	_ccv_nnc_autotune_cache_init();
+	_ccv_nnc_autotune_cache_unlock();
+	const int tensor_key_size = 4 + CCV_NNC_MAX_DIM_ALLOC * 2 + 1;
+	const int key_size = 5 + (sizeof(cmd.info) + sizeof(hint)) / sizeof(int) + 1 + (input_size + output_size) * tensor_key_size;
+	int* const key = (int*)cccalloc(key_size, sizeof(int));
+	key[0] = CCV_NNC_AUTOTUNE_CACHE_VERSION;
+	key[1] = cmd.cmd;
+	key[2] = flags;
+	key[3] = input_size;
+	key[4] = output_size;
+	memcpy(key + 5, &cmd.info, sizeof(cmd.info));
+	memcpy((char*)(key + 5) + sizeof(cmd.info), &hint, sizeof(hint));
+	int* tensor_key = key + 5 + (sizeof(cmd.info) + sizeof(hint)) / sizeof(int) + 1;
+	int i, j;
+	for (i = 0; i < input_size; i++, tensor_key += tensor_key_size)
+		_ccv_nnc_autotune_key_tensor(tensor_key, inputs[i]);
+	for (i = 0; i < output_size; i++, tensor_key += tensor_key_size)
+	{
+		_ccv_nnc_autotune_key_tensor(tensor_key, outputs[i]);
+		// Whether the output is in-place with one of the inputs.
+		tensor_key[tensor_key_size - 1] = -1;
+		if (outputs[i])
+			for (j = 0; j < input_size; j++)
+				if (inputs[j] && inputs[j]->data.u8 == outputs[i]->data.u8)
+				{
+					tensor_key[tensor_key_size - 1] = j;
+					break;
+				}
+	}
+	const uint64_t workspace = max_workspace_size;
+	// The instruction sets currently allowed, a decision made with AVX2 is not good once it is turned off.
+	const uint64_t cpu_features = (uint64_t)ccv_nnc_cpu_features();
+	const uint64_t sig = ccv_cache_generate_signature((const char*)key, key_size * sizeof(int), autotune_cache.host, workspace + 1, cpu_features + 1, CCV_EOF_SIGN);
+	ccfree(key);
+	return sig;
+}
+
+int ccv_nnc_cmd_autotune_cache_find(const uint64_t key, ccv_nnc_cmd_t* const tuned_cmd)
+{
+	int found = 0;
+	_ccv_nnc_autotune_cache_lock();
+	if (autotune_cache.decisions)
+	{
+		const khiter_t k = kh_get(autotune, autotune_cache.decisions, key);
+		if (k != kh_end(autotune_cache.decisions))
+		{
+			const ccv_nnc_autotune_decision_t decision = kh_val(autotune_cache.decisions, k);
+			tuned_cmd->backend = decision.backend;
+			tuned_cmd->algorithm = decision.algorithm;
+			found = 1;
+		}
+	}
+	_ccv_nnc_autotune_cache_unlock();
+	return found;
+}
+
+void ccv_nnc_cmd_autotune_cache_insert(const uint64_t key, const ccv_nnc_cmd_t tuned_cmd)
+{
+	_ccv_nnc_autotune_cache_lock();
+	_ccv_nnc_autotune_cache_init();
+	int ret;
+	khiter_t k = kh_put(autotune, autotune_cache.decisions, key, &ret);
+	kh_val(autotune_cache.decisions, k).backend = tuned_cmd.backend;
+	kh_val(autotune_cache.decisions, k).algorithm = tuned_cmd.algorithm;
+	if (autotune_cache.insert_stmt)
+	{
+		sqlite3_bind_int64(autotune_cache.insert_stmt, 1, (sqlite3_int64)key);
+		sqlite3_bind_int64(autotune_cache.insert_stmt, 2, tuned_cmd.backend);
+		sqlite3_bind_int(autotune_cache.insert_stmt, 3, tuned_cmd.algorithm);
+		sqlite3_step(autotune_cache.insert_stmt);
+		sqlite3_reset(autotune_cache.insert_stmt);
+		sqlite3_clear_bindings(autotune_cache.insert_stmt);
+	}
+	_ccv_nnc_autotune_cache_unlock();
+}
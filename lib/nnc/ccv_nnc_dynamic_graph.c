@@ -18,6 +18,8 @@ ccv_nnc_dynamic_graph_t* ccv_nnc_dynamic_graph_new(void)
 	graph->tape = ccv_nnc_symbolic_graph_new();
 	graph->freed = kh_init(dy_str);
 	graph->allocd = kh_init(dy_alloc);
+	graph->cpu_freed_size = 0;
+	graph->cpu_cache_limit = CCV_NNC_DYNAMIC_GRAPH_CPU_CACHE_LIMIT;
 	// These may not be used as frequent, init as needed.
 	graph->stateful_execs = 0;
 	graph->reuse_stateful_exec = -1;
@@ -39,8 +41,7 @@ static void _ccv_nnc_tensor_variable_free(ccv_nnc_dynamic_graph_t* const graph,
 			if (CCV_IS_TENSOR_VIEW(tensor_variable->tensor_view))
 				ccv_nnc_tensor_view_free(tensor_variable->tensor_view);
 			else {
-				if (!tensor_variable->alias_index_ref && // Return this memory to the graph.
-					CCV_TENSOR_GET_MEMORY(tensor_variable->tensor_view->info.type) == CCV_TENSOR_GPU_MEMORY)
+				if (!tensor_variable->alias_index_ref) // Return this memory to the graph.
 					ccv_nnc_dynamic_graph_xpu_free(graph, tensor_variable->tensor_view->data.ptr);
 				ccv_nnc_tensor_free((ccv_nnc_tensor_t*)tensor_variable->tensor_view);
 			}
@@ -79,8 +80,7 @@ static void _ccv_nnc_tensor_variable_graph_bind_free(ccv_nnc_dynamic_graph_t* co
 			if (CCV_IS_TENSOR_VIEW(bind->tensor_view))
 				ccv_nnc_tensor_view_free(bind->tensor_view);
 			else {
-				if (!bind->alias_ref && // Return this memory to the graph.
-					CCV_TENSOR_GET_MEMORY(bind->tensor_view->info.type) == CCV_TENSOR_GPU_MEMORY)
+				if (!bind->alias_ref) // Return this memory to the graph.
 					ccv_nnc_dynamic_graph_xpu_free(graph, bind->tensor_view->data.ptr);
 				ccv_nnc_tensor_free((ccv_nnc_tensor_t*)bind->tensor_view);
 			}
@@ -147,6 +147,7 @@ void ccv_nnc_tensor_variable_set(ccv_nnc_dynamic_graph_t* const graph, const ccv
 	if (tensor_variable->tensor_view && !CCV_NNC_IS_EXTERN_TENSOR_VIEW(tensor_variable->tensor_view))
 	{
 		assert(!CCV_IS_TENSOR_VIEW(tensor_variable->tensor_view));
+		ccv_nnc_dynamic_graph_xpu_free(graph, tensor_variable->tensor_view->data.ptr);
 		ccv_nnc_tensor_free((ccv_nnc_tensor_t*)tensor_variable->tensor_view);
 	}
 	tensor_variable->info = tensor->info;
@@ -273,8 +274,7 @@ ccv_nnc_tensor_t* ccv_nnc_tensor_from_variable_impl(ccv_nnc_dynamic_graph_t* con
 		if (ccv_nnc_is_tensor_auto(tensor_variable->info))
 			return 0;
 		void* ptr = 0;
-		if (CCV_TENSOR_GET_MEMORY(tensor_variable->info.type) == CCV_TENSOR_GPU_MEMORY)
-			ptr = ccv_nnc_dynamic_graph_xpu_alloc(graph, CCV_TENSOR_GET_DEVICE_ID(tensor_variable->info.type), stream_context, ccv_nnc_tensor_data_size(tensor_variable->info));
+		ptr = ccv_nnc_dynamic_graph_xpu_alloc(graph, tensor_variable->info.type, stream_context, ccv_nnc_tensor_data_size(tensor_variable->info));
 		tensor_variable->tensor_view = (ccv_nnc_tensor_view_t*)ccv_nnc_tensor_new(ptr, tensor_variable->info, 0);
 		assert(tensor_variable->tensor_view->data.u8);
 		return (ccv_nnc_tensor_t*)tensor_variable->tensor_view;
@@ -290,8 +290,7 @@ ccv_nnc_tensor_t* ccv_nnc_tensor_from_variable_impl(ccv_nnc_dynamic_graph_t* con
 			return 0;
 		void* ptr = 0;
 		assert(variable_to->info.type == tensor_variable->info.type);
-		if (CCV_TENSOR_GET_MEMORY(variable_to->info.type) == CCV_TENSOR_GPU_MEMORY)
-			ptr = ccv_nnc_dynamic_graph_xpu_alloc(graph, CCV_TENSOR_GET_DEVICE_ID(variable_to->info.type), stream_context, ccv_nnc_tensor_data_size(variable_to->info));
+		ptr = ccv_nnc_dynamic_graph_xpu_alloc(graph, variable_to->info.type, stream_context, ccv_nnc_tensor_data_size(variable_to->info));
 		variable_to->tensor_view = (ccv_nnc_tensor_view_t*)ccv_nnc_tensor_new(ptr, variable_to->info, 0);
 		assert(variable_to->tensor_view->data.u8);
 	}
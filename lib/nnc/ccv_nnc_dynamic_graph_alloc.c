@@ -6,6 +6,7 @@
 #include "_ccv_nnc_dynamic_graph.h"
 #ifdef HAVE_CUDA
 #include "gpu/ccv_nnc_compat.h"
+#endif
 #include <stdbool.h>
 
 static int dy_alloc_tree_cmp(const dy_alloc_metadata_t* const a_node, const dy_alloc_metadata_t* const b_node)
@@ -15,25 +16,69 @@ static int dy_alloc_tree_cmp(const dy_alloc_metadata_t* const a_node, const dy_a
 
 rb_gen(, dy_alloc_tree_, dy_alloc_tree_t, dy_alloc_metadata_t, link, dy_alloc_tree_cmp)
 
+// The pool is keyed by memory type and device, CPU memory doesn't care about which device it is on.
+static inline int _ccv_nnc_dynamic_graph_xpu_type(const int type)
+{
+	if (CCV_TENSOR_GET_MEMORY(type) == CCV_TENSOR_CPU_MEMORY)
+		return CCV_TENSOR_CPU_MEMORY;
+	return CCV_TENSOR_GET_MEMORY(type) | CCV_TENSOR_GET_DEVICE(type);
+}
+
+static void* _ccv_nnc_xpu_malloc(const int type, const size_t size)
+{
+	if (CCV_TENSOR_GET_MEMORY(type) == CCV_TENSOR_CPU_MEMORY)
+	{
+		void* ptr = 0;
+		ccmemalign(&ptr, 16, size);
+		return ptr;
+	}
+#ifdef HAVE_CUDA
+	return cumalloc(CCV_TENSOR_GET_DEVICE_ID(type), size);
+#else
+	return 0;
+#endif
+}
+
+static void _ccv_nnc_xpu_free(const int type, void* const ptr)
+{
+	if (CCV_TENSOR_GET_MEMORY(type) == CCV_TENSOR_CPU_MEMORY)
+	{
+		ccfree(ptr);
+		return;
+	}
+#ifdef HAVE_CUDA
+	cufree(CCV_TENSOR_GET_DEVICE_ID(type), ptr);
+#endif
+}
+
 static void _ccv_nnc_dynamic_graph_metadata_free(dy_alloc_metadata_t* node, void* arg)
 {
+	// If arg is provided, these are cached allocations, keep the cached CPU memory size up to date.
+	size_t* const cpu_freed_size = (size_t*)arg;
 	do {
 		dy_alloc_metadata_t* const next = node->next;
-		cufree(node->device, node->ptr);
+		if (cpu_freed_size && CCV_TENSOR_GET_MEMORY(node->type) == CCV_TENSOR_CPU_MEMORY)
+		{
+			assert(*cpu_freed_size >= node->size);
+			*cpu_freed_size -= node->size;
+		}
+		_ccv_nnc_xpu_free(node->type, node->ptr);
 		ccfree(node);
 		node = next;
 	} while (node);
 }
 
-static void _ccv_nnc_dynamic_graph_xpu_alloc_drain(khash_t(dy_dev)* const dev)
+static void _ccv_nnc_dynamic_graph_xpu_alloc_drain(ccv_nnc_dynamic_graph_t* const graph, khash_t(dy_dev)* const dev, const bool cpu_only)
 {
 	khiter_t k;
 	for (k = kh_begin(dev); k != kh_end(dev); ++k)
 	{
 		if (!kh_exist(dev, k))
 			continue;
+		if (cpu_only && kh_key(dev, k) != CCV_TENSOR_CPU_MEMORY)
+			continue;
 		dy_alloc_tree_t* const tree = &kh_val(dev, k);
-		dy_alloc_tree_destroy(tree, _ccv_nnc_dynamic_graph_metadata_free, 0);
+		dy_alloc_tree_destroy(tree, _ccv_nnc_dynamic_graph_metadata_free, &graph->cpu_freed_size);
 		kh_del(dy_dev, dev, k);
 	}
 }
@@ -46,13 +91,14 @@ static void _ccv_nnc_dynamic_graph_xpu_stream_destructor_hook(const ccv_nnc_stre
 	khiter_t i = kh_get(dy_str, freed, str);
 	assert(i != kh_end(freed));
 	khash_t(dy_dev)* const dev = kh_val(freed, i).dev;
-	_ccv_nnc_dynamic_graph_xpu_alloc_drain(dev);
+	_ccv_nnc_dynamic_graph_xpu_alloc_drain(graph, dev, false);
 	kh_destroy(dy_dev, dev);
 	kh_del(dy_str, freed, i);
 }
 
-void* ccv_nnc_dynamic_graph_xpu_alloc(ccv_nnc_dynamic_graph_t* const graph, const int device, ccv_nnc_stream_context_t* const stream, const size_t size)
+void* ccv_nnc_dynamic_graph_xpu_alloc(ccv_nnc_dynamic_graph_t* const graph, const int type, ccv_nnc_stream_context_t* const stream, const size_t size)
 {
+	const int xpu_type = _ccv_nnc_dynamic_graph_xpu_type(type);
 	khash_t(dy_str)* const freed = graph->freed;
 	const int64_t str = (int64_t)(intptr_t)stream;
 	int ret;
@@ -65,7 +111,7 @@ void* ccv_nnc_dynamic_graph_xpu_alloc(ccv_nnc_dynamic_graph_t* const graph, cons
 		// find the suitable ones.
 		khash_t(dy_dev)* const dev = kh_val(freed, i).dev;
 		assert(dev);
-		khiter_t j = kh_get(dy_dev, dev, device);
+		khiter_t j = kh_get(dy_dev, dev, xpu_type);
 		if (j != kh_end(dev))
 		{
 			dy_alloc_tree_t* const tree = &kh_val(dev, j);
@@ -93,21 +139,28 @@ void* ccv_nnc_dynamic_graph_xpu_alloc(ccv_nnc_dynamic_graph_t* const graph, cons
 	if (!node)
 	{
 		node = (dy_alloc_metadata_t*)ccmalloc(sizeof(dy_alloc_metadata_t));
-		if (graph->mp_hdr < 0)
+#ifdef HAVE_CUDA
+		if (graph->mp_hdr < 0 && xpu_type != CCV_TENSOR_CPU_MEMORY)
 			graph->mp_hdr = curegmp((cump_f)ccv_nnc_dynamic_graph_gc, graph);
-		node->ptr = cumalloc(device, size);
+#endif
+		node->ptr = _ccv_nnc_xpu_malloc(xpu_type, size);
 		if (!node->ptr) // If cannot allocate, drain the pool first and then allocate.
 		{
 			ccfree(node);
 			return 0;
 		}
-		node->device = device;
+		node->type = xpu_type;
 		node->size = size;
 		node->str = str;
 	} else {
 		assert(node->size >= size);
-		assert(node->device == device);
+		assert(node->type == xpu_type);
 		assert(node->str == str);
+		if (xpu_type == CCV_TENSOR_CPU_MEMORY)
+		{
+			assert(graph->cpu_freed_size >= node->size);
+			graph->cpu_freed_size -= node->size;
+		}
 	}
 	node->next = 0;
 	khash_t(dy_alloc)* const allocd = graph->allocd;
@@ -129,15 +182,20 @@ void ccv_nnc_dynamic_graph_xpu_free(ccv_nnc_dynamic_graph_t* const graph, void*
 	i = kh_get(dy_str, freed, node->str);
 	// If cannot find associated stream, that means this allocation associated
 	// stream has been freed. I have to do synchronous free of this pointer.
-	if (i == kh_end(freed))
+	// Similarly, if caching it will go over the high-water mark for CPU memory,
+	// free it right away.
+	if (i == kh_end(freed) ||
+		(node->type == CCV_TENSOR_CPU_MEMORY && graph->cpu_freed_size + node->size > graph->cpu_cache_limit))
 	{
-		cufree(node->device, node->ptr);
+		_ccv_nnc_xpu_free(node->type, node->ptr);
 		ccfree(node);
 		return;
 	}
+	if (node->type == CCV_TENSOR_CPU_MEMORY)
+		graph->cpu_freed_size += node->size;
 	khash_t(dy_dev)* const dev = kh_val(freed, i).dev;
 	int ret;
-	khiter_t j = kh_put(dy_dev, dev, node->device, &ret);
+	khiter_t j = kh_put(dy_dev, dev, node->type, &ret);
 	assert(ret >= 0);
 	dy_alloc_tree_t* const tree = &kh_val(dev, j);
 	if (ret != 0)
@@ -168,7 +226,7 @@ void ccv_nnc_dynamic_graph_xpu_alloc_destroy(ccv_nnc_dynamic_graph_t* const grap
 		if (!kh_exist(freed, k))
 			continue;
 		khash_t(dy_dev)* const dev = kh_val(freed, k).dev;
-		_ccv_nnc_dynamic_graph_xpu_alloc_drain(dev);
+		_ccv_nnc_dynamic_graph_xpu_alloc_drain(graph, dev, false);
 		ccv_nnc_stream_context_t* const stream = (ccv_nnc_stream_context_t*)(intptr_t)kh_key(freed, k);
 		if (stream)
 		{
@@ -178,11 +236,13 @@ void ccv_nnc_dynamic_graph_xpu_alloc_destroy(ccv_nnc_dynamic_graph_t* const grap
 		kh_destroy(dy_dev, dev);
 	}
 	kh_destroy(dy_str, freed);
+#ifdef HAVE_CUDA
 	if (graph->mp_hdr >= 0)
 		cuunregmp(graph->mp_hdr);
+#endif
 }
 
-void ccv_nnc_dynamic_graph_gc(ccv_nnc_dynamic_graph_t* const graph)
+static void _ccv_nnc_dynamic_graph_gc(ccv_nnc_dynamic_graph_t* const graph, const bool cpu_only)
 {
 	khash_t(dy_str)* const freed = graph->freed;
 	khiter_t k;
@@ -191,24 +251,19 @@ void ccv_nnc_dynamic_graph_gc(ccv_nnc_dynamic_graph_t* const graph)
 		if (!kh_exist(freed, k))
 			continue;
 		khash_t(dy_dev)* const dev = kh_val(freed, k).dev;
-		_ccv_nnc_dynamic_graph_xpu_alloc_drain(dev);
+		_ccv_nnc_dynamic_graph_xpu_alloc_drain(graph, dev, cpu_only);
 	}
 }
-#else
-void* ccv_nnc_dynamic_graph_xpu_alloc(ccv_nnc_dynamic_graph_t* const graph, const int device, ccv_nnc_stream_context_t* const stream, const size_t size)
-{
-	return 0;
-}
-
-void ccv_nnc_dynamic_graph_xpu_free(ccv_nnc_dynamic_graph_t* const graph, void* const ptr)
-{
-}
 
-void ccv_nnc_dynamic_graph_xpu_alloc_destroy(ccv_nnc_dynamic_graph_t* const graph)
+void ccv_nnc_dynamic_graph_gc(ccv_nnc_dynamic_graph_t* const graph)
 {
+	_ccv_nnc_dynamic_graph_gc(graph, false);
 }
 
-void ccv_nnc_dynamic_graph_gc(ccv_nnc_dynamic_graph_t* const dynamic_graph)
+void ccv_nnc_dynamic_graph_set_cpu_cache_limit(ccv_nnc_dynamic_graph_t* const graph, const size_t limit)
 {
+	graph->cpu_cache_limit = limit;
+	// Trim what we have if it is over the new high-water mark already.
+	if (graph->cpu_freed_size > limit)
+		_ccv_nnc_dynamic_graph_gc(graph, true);
 }
-#endif
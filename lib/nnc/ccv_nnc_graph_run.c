@@ -387,6 +387,30 @@ static ccv_nnc_stream_context_t* _ccv_nnc_graph_neighbor_context_discovery(const
 	return 0;
 }
 
+static void _ccv_nnc_graph_exec_print_outputs(ccv_nnc_tensor_t* const* const outputs, const int output_size)
+{
+	int i;
+	for (i = 0; i < output_size; i++)
+	{
+		PRINT(CCV_CLI_INFO, "|<- %d. %p (%p:%d)", i + 1, outputs[i], (outputs[i] ? outputs[i]->data.u8 : 0), (outputs[i] ? CCV_TENSOR_GET_DEVICE_ID(outputs[i]->info.type) : -1));
+		if (outputs[i] && CCV_CLI_OUTPUT_LEVEL_IS(CCV_CLI_INFO))
+			ccv_nnc_print_tensor_info(outputs[i]);
+		PRINT(CCV_CLI_INFO, "\n");
+	}
+}
+
+typedef struct {
+	int output_size;
+	ccv_nnc_tensor_t* outputs[1];
+} ccv_nnc_graph_exec_outputs_t;
+
+static void _ccv_nnc_graph_exec_print_outputs_callback(ccv_nnc_stream_context_t* const stream, void* const context)
+{
+	ccv_nnc_graph_exec_outputs_t* const exec_outputs = (ccv_nnc_graph_exec_outputs_t*)context;
+	_ccv_nnc_graph_exec_print_outputs(exec_outputs->outputs, exec_outputs->output_size);
+	ccfree(exec_outputs);
+}
+
 static co_routine_t* _ccv_nnc_graph_exec_run_task(ccv_nnc_graph_t* const graph, ccv_nnc_graph_exec_info_t* const node, const ccv_nnc_graph_exec_schedule_t* const schd, const int idx, ccv_nnc_tensor_tape_t* const tensor_tape, const int flags)
 {
 	_ccv_nnc_graph_exec_unwrap_io(graph, node);
@@ -441,15 +465,29 @@ static co_routine_t* _ccv_nnc_graph_exec_run_task(ccv_nnc_graph_t* const graph,
 			.node = schd,
 			.stream = node_stream
 		};
-		ccv_nnc_stream_context_set_neighbor_discovery(node_stream, _ccv_nnc_graph_neighbor_context_discovery, &discovery_context);
-		ccv_nnc_cmd_exec(node->cmd, node->hint, flags, inputs, node->input_size, outputs, node->output_size, node_stream);
-		for (i = 0; i < node->output_size; i++)
-		{
-			PRINT(CCV_CLI_INFO, "|<- %d. %p (%p:%d)", i + 1, outputs[i], (outputs[i] ? outputs[i]->data.u8 : 0), (outputs[i] ? CCV_TENSOR_GET_DEVICE_ID(outputs[i]->info.type) : -1));
-			if (outputs[i] && CCV_CLI_OUTPUT_LEVEL_IS(CCV_CLI_INFO))
-				ccv_nnc_print_tensor_info(outputs[i]);
-			PRINT(CCV_CLI_INFO, "\n");
+		const ccv_nnc_profiler_exec_t prev_exec = ccv_nnc_profiler_set_exec((ccv_nnc_profiler_exec_t){
+			.graph = graph,
+			.exec_idx = idx,
+		});
+		// Multiview tensors are updated in place while the graph runs, hence, only dispatch to the thread pool
+		// if there is none. Otherwise the command runs inline once its stream catches up.
+		const int queued = CCV_STREAM_GET_CONTEXT(ccv_nnc_stream_context_type(node_stream)) == CCV_STREAM_CONTEXT_CPU && !graph->tensor_wraps;
+		if (queued)
+			ccv_nnc_stream_cpu_cmd_exec(node->cmd, node->hint, flags, inputs, node->input_size, outputs, node->output_size, _ccv_nnc_graph_neighbor_context_discovery, &discovery_context, sizeof(discovery_context), node_stream);
+		else {
+			ccv_nnc_stream_context_set_neighbor_discovery(node_stream, _ccv_nnc_graph_neighbor_context_discovery, &discovery_context);
+			ccv_nnc_cmd_exec(node->cmd, node->hint, flags, inputs, node->input_size, outputs, node->output_size, node_stream);
 		}
+		ccv_nnc_profiler_set_exec(prev_exec);
+		if (queued && CCV_CLI_OUTPUT_LEVEL_IS(CCV_CLI_INFO) && node->output_size > 0)
+		{
+			// The outputs are not computed yet if the command is on the thread pool, print them once it is done.
+			ccv_nnc_graph_exec_outputs_t* const exec_outputs = (ccv_nnc_graph_exec_outputs_t*)ccmalloc(sizeof(ccv_nnc_graph_exec_outputs_t) + sizeof(ccv_nnc_tensor_t*) * (node->output_size - 1));
+			exec_outputs->output_size = node->output_size;
+			memcpy(exec_outputs->outputs, outputs, sizeof(ccv_nnc_tensor_t*) * node->output_size);
+			ccv_nnc_stream_context_add_callback(node_stream, _ccv_nnc_graph_exec_print_outputs_callback, exec_outputs);
+		} else
+			_ccv_nnc_graph_exec_print_outputs(outputs, node->output_size);
 		flag = 0;
 		for (i = 0; i < schd->stream_size; i++)
 			if (SCHEDULE_SIGNALS(*schd)[i] >= 0)
@@ -784,7 +822,12 @@ static inline void _ccv_nnc_graph_exec_run(ccv_nnc_graph_t* const graph, ccv_nnc
 				ccv_nnc_print_tensor_info(inputs[i]);
 			PRINT(CCV_CLI_INFO, "\n");
 		}
+		const ccv_nnc_profiler_exec_t prev_exec = ccv_nnc_profiler_set_exec((ccv_nnc_profiler_exec_t){
+			.graph = graph,
+			.exec_idx = idx,
+		});
 		ccv_nnc_cmd_exec(node->cmd, node->hint, flags, inputs, node->input_size, outputs, node->output_size, stream_context);
+		ccv_nnc_profiler_set_exec(prev_exec);
 		for (i = 0; i < node->output_size; i++)
 		{
 			PRINT(CCV_CLI_INFO, "|<- %d. %p (%p:%d)", i + 1, outputs[i], (outputs[i] ? outputs[i]->data.u8 : 0), (outputs[i] ? CCV_TENSOR_GET_DEVICE_ID(outputs[i]->info.type) : -1));
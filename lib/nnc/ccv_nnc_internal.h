@@ -19,6 +19,11 @@
 #define CCV_NNC_STACK_BITMASK_ALLOC (2)
 #define CCV_NNC_TENSOR_PLACEHOLDER ((ccv_nnc_tensor_t*)(intptr_t)(0x10))
 
+// On x86, kernels for newer instruction sets are compiled with target attributes and selected at runtime per ccv_nnc_cpu_features().
+#if defined(HAVE_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define CCV_NNC_CPU_DISPATCH
+#endif
+
 typedef void (*ccv_nnc_cmd_tensor_auto_f)(const ccv_nnc_cmd_param_t cmd, const ccv_nnc_tensor_param_t* const inputs, const int input_size, const ccv_nnc_hint_t hint, ccv_nnc_tensor_param_t* const outputs, const int output_size);
 typedef int (*ccv_nnc_cmd_bitmask_f)(const int input_size, const int output_size, const uint64_t* const input_bitmasks, const int input_bitmask_size, const uint64_t* const output_bitmasks, const int output_bitmask_size);
 typedef int (*ccv_nnc_cmd_inplace_f)(const int input_idx, const int input_size, const int output_idx, const int output_size);
@@ -90,6 +95,90 @@ void ccv_nnc_hint_tensor_auto_backward_from_gradient_and_inputs(const ccv_nnc_cm
 int ccv_nnc_device_ids_for_io(ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, const int tensor_type, int* const device_ids, const int max_device_id_size);
 void ccv_nnc_print_tensor_info(const ccv_nnc_tensor_t* const tensor);
 
+// Tags for the packed data layout, these need to be unique across kernels.
+enum {
+	CCV_NNC_TENSOR_PACKED_CONV_X4W = 1, /**< Convolution weights with 4 output channels interleaved. */
+	CCV_NNC_TENSOR_PACKED_CONV_GWTG = 2, /**< Convolution weights transformed for 4x4 3x3 Winograd, G.w.T(G). */
+	CCV_NNC_TENSOR_PACKED_CONV_X8W = 3, /**< Convolution weights with 8 output channels interleaved. */
+	CCV_NNC_TENSOR_PACKED_QUANTIZED_W = 4, /**< Weights quantized to 8-bit per output channel, with their scales and row sums. */
+};
+
+typedef void (*ccv_nnc_tensor_pack_f)(const ccv_nnc_tensor_t* const tensor, void* const packed, void* const context);
+/**
+ * Retain the packed data derived from a tensor. If there is one in the cache for the given tensor / tag and the tensor
+ * is not modified since, it will be returned directly. Otherwise, the pack function will be called to fill in the data.
+ * @param tensor The tensor to be packed.
+ * @param tag The identifier for the packing layout.
+ * @param size The size of the packed data.
+ * @param pack The function to pack the tensor.
+ * @param context The context to be passed to the pack function.
+ * @return The packed data, 0 if the cache is disabled, you should pack into your own buffer then.
+ */
+CCV_WARN_UNUSED(void*) ccv_nnc_tensor_packed_retain(const ccv_nnc_tensor_t* const tensor, const uint32_t tag, const size_t size, ccv_nnc_tensor_pack_f pack, void* const context);
+/**
+ * Release the packed data retained with ccv_nnc_tensor_packed_retain.
+ * @param packed The packed data.
+ */
+void ccv_nnc_tensor_packed_release(void* const packed);
+
+/**
+ * Compute the key of an autotune decision, from the command, its parameters, the hint, the shapes and types of
+ * the tensors and the host this process runs on.
+ * @return The 64-bit key.
+ */
+CCV_WARN_UNUSED(uint64_t) ccv_nnc_cmd_autotune_key(const ccv_nnc_cmd_t cmd, const size_t max_workspace_size, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size);
+/**
+ * Find an autotune decision made before, fill in the backend and the algorithm.
+ * @param key The key from ccv_nnc_cmd_autotune_key.
+ * @param tuned_cmd The command to fill in.
+ * @return 1 if found, 0 otherwise.
+ */
+int ccv_nnc_cmd_autotune_cache_find(const uint64_t key, ccv_nnc_cmd_t* const tuned_cmd);
+/**
+ * Remember an autotune decision, and persist it if there is a cache file.
+ * @param key The key from ccv_nnc_cmd_autotune_key.
+ * @param tuned_cmd The tuned command.
+ */
+void ccv_nnc_cmd_autotune_cache_insert(const uint64_t key, const ccv_nnc_cmd_t tuned_cmd);
+
+/**
+ * Whether the profiler is recording, this is checked before anything else such that it costs nothing when off.
+ */
+extern int ccv_nnc_profiler_is_on;
+/**
+ * The execution node a command runs for, so it can be attributed to the graph.
+ */
+typedef struct {
+	const ccv_nnc_graph_t* graph;
+	int exec_idx;
+} ccv_nnc_profiler_exec_t;
+/**
+ * Mark the execution node the current thread runs commands for.
+ * @param exec The graph and the index of the execution node, or { 0, -1 } if none.
+ * @return The previous one, to be restored once done.
+ */
+ccv_nnc_profiler_exec_t ccv_nnc_profiler_set_exec(const ccv_nnc_profiler_exec_t exec);
+/**
+ * Get the execution node the current thread runs commands for.
+ */
+CCV_WARN_UNUSED(ccv_nnc_profiler_exec_t) ccv_nnc_profiler_get_exec(void);
+typedef struct {
+	uint64_t start;
+	size_t workspace_size;
+} ccv_nnc_profiler_mark_t;
+/**
+ * Mark the start of a command execution.
+ */
+CCV_WARN_UNUSED(ccv_nnc_profiler_mark_t) ccv_nnc_profiler_begin(void);
+/**
+ * Record a command execution started with ccv_nnc_profiler_begin.
+ */
+void ccv_nnc_profiler_end(const ccv_nnc_profiler_mark_t mark, const ccv_nnc_cmd_t cmd, const uint32_t backend, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context);
+/**
+ * Note the workspace requested by the command executing on the current thread.
+ */
+void ccv_nnc_profiler_note_workspace(const size_t workspace_size);
+
 static inline off_t ccv_nnc_tensor_view_offset(const int datatype, const int inc[CCV_NNC_MAX_DIM_ALLOC], const int ofs[CCV_NNC_MAX_DIM_ALLOC])
 {
 	int i;
@@ -0,0 +1,334 @@
+#include "ccv_nnc.h"
+#include "ccv_nnc_easy.h"
+#include "ccv_nnc_internal.h"
+#include "ccv_internal.h"
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#ifdef __MACH__
+#include <mach/mach_time.h>
+#endif
+
+// MARK - Recording
+
+int ccv_nnc_profiler_is_on = 0;
+
+// Each thread records into its own buffer, the buffers are only linked together (under the lock) when a thread
+// records its first event. Thus, recording itself never contends. For the same reason, reset doesn't touch the
+// buffers, it only bumps the generation, each thread clears its own buffer the next time it records, and the
+// buffers from an older generation are considered empty. When a thread exits, its events are moved to the shared
+// events and its buffer is freed, thus, threads started over and over (for example, one per epoch) don't pile up.
+typedef struct ccv_nnc_profiler_buffer_s {
+	int thread_id;
+	int generation;
+	ccv_array_t* events;
+	struct ccv_nnc_profiler_buffer_s* next;
+} ccv_nnc_profiler_buffer_t;
+
+static struct {
+	int flags;
+	int thread_count;
+	int generation;
+	ccv_nnc_profiler_buffer_t* buffers;
+	int exited_generation;
+	ccv_array_t* exited_events; // The events of the threads exited.
+#ifdef HAVE_PTHREAD
+	pthread_mutex_t mutex;
+	pthread_once_t once;
+	pthread_key_t key;
+#endif
+} profiler = {
+#ifdef HAVE_PTHREAD
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.once = PTHREAD_ONCE_INIT,
+#endif
+};
+
+static __thread ccv_nnc_profiler_buffer_t* profiler_buffer = 0;
+static __thread ccv_nnc_profiler_exec_t profiler_exec = {
+	.graph = 0,
+	.exec_idx = -1,
+};
+static __thread size_t profiler_workspace_size = 0;
+
+static inline void _ccv_nnc_profiler_lock(void)
+{
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&profiler.mutex);
+#endif
+}
+
+static inline void _ccv_nnc_profiler_unlock(void)
+{
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&profiler.mutex);
+#endif
+}
+
+#ifdef HAVE_PTHREAD
+static void _ccv_nnc_profiler_buffer_exit(void* const context)
+{
+	ccv_nnc_profiler_buffer_t* const buffer = (ccv_nnc_profiler_buffer_t*)context;
+	_ccv_nnc_profiler_lock();
+	ccv_nnc_profiler_buffer_t** next = &profiler.buffers;
+	while (*next != buffer)
+		next = &(*next)->next;
+	*next = buffer->next;
+	const int generation = __atomic_load_n(&profiler.generation, __ATOMIC_ACQUIRE);
+	if (buffer->generation == generation && buffer->events->rnum > 0)
+	{
+		if (!profiler.exited_events)
+			profiler.exited_events = ccv_array_new(sizeof(ccv_nnc_profiler_event_t), buffer->events->rnum, 0);
+		else if (profiler.exited_generation != generation)
+			ccv_array_clear(profiler.exited_events);
+		profiler.exited_generation = generation;
+		ccv_array_resize(profiler.exited_events, profiler.exited_events->rnum + buffer->events->rnum);
+		memcpy(ccv_array_get(profiler.exited_events, profiler.exited_events->rnum - buffer->events->rnum), ccv_array_get(buffer->events, 0), sizeof(ccv_nnc_profiler_event_t) * buffer->events->rnum);
+	}
+	_ccv_nnc_profiler_unlock();
+	ccv_array_free(buffer->events);
+	ccfree(buffer);
+}
+
+static void _ccv_nnc_profiler_key_new(void)
+{
+	pthread_key_create(&profiler.key, _ccv_nnc_profiler_buffer_exit);
+}
+#endif
+
+static ccv_nnc_profiler_buffer_t* _ccv_nnc_profiler_buffer(void)
+{
+	const int generation = __atomic_load_n(&profiler.generation, __ATOMIC_ACQUIRE);
+	if (profiler_buffer)
+	{
+		if (__atomic_load_n(&profiler_buffer->generation, __ATOMIC_RELAXED) != generation)
+		{
+			ccv_array_clear(profiler_buffer->events);
+			__atomic_store_n(&profiler_buffer->generation, generation, __ATOMIC_RELEASE);
+		}
+		return profiler_buffer;
+	}
+	ccv_nnc_profiler_buffer_t* const buffer = (ccv_nnc_profiler_buffer_t*)ccmalloc(sizeof(ccv_nnc_profiler_buffer_t));
+	buffer->events = ccv_array_new(sizeof(ccv_nnc_profiler_event_t), 64, 0);
+	buffer->generation = generation;
+	_ccv_nnc_profiler_lock();
+	buffer->thread_id = profiler.thread_count++;
+	buffer->next = profiler.buffers;
+	profiler.buffers = buffer;
+	_ccv_nnc_profiler_unlock();
+#ifdef HAVE_PTHREAD
+	pthread_once(&profiler.once, _ccv_nnc_profiler_key_new);
+	pthread_setspecific(profiler.key, buffer);
+#endif
+	profiler_buffer = buffer;
+	return buffer;
+}
+
+void ccv_nnc_profiler_start(const int flags)
+{
+	profiler.flags = flags;
+	ccv_nnc_profiler_is_on = 1;
+}
+
+void ccv_nnc_profiler_stop(void)
+{
+	ccv_nnc_profiler_is_on = 0;
+}
+
+void ccv_nnc_profiler_reset(void)
+{
+	_ccv_nnc_profiler_lock();
+	__atomic_add_fetch(&profiler.generation, 1, __ATOMIC_RELEASE);
+	if (profiler.exited_events)
+		ccv_array_clear(profiler.exited_events);
+	_ccv_nnc_profiler_unlock();
+}
+
+ccv_nnc_profiler_exec_t ccv_nnc_profiler_set_exec(const ccv_nnc_profiler_exec_t exec)
+{
+	const ccv_nnc_profiler_exec_t prev = profiler_exec;
+	profiler_exec = exec;
+	return prev;
+}
+
+ccv_nnc_profiler_exec_t ccv_nnc_profiler_get_exec(void)
+{
+	return profiler_exec;
+}
+
+ccv_nnc_profiler_mark_t ccv_nnc_profiler_begin(void)
+{
+	// Commands can execute other commands, keep what the outer one requested so far.
+	const ccv_nnc_profiler_mark_t mark = {
+		.start = ccv_nnc_cmd_mono_time(),
+		.workspace_size = profiler_workspace_size,
+	};
+	profiler_workspace_size = 0;
+	return mark;
+}
+
+void ccv_nnc_profiler_note_workspace(const size_t workspace_size)
+{
+	if (workspace_size > profiler_workspace_size)
+		profiler_workspace_size = workspace_size;
+}
+
+static size_t _ccv_nnc_profiler_bytes(ccv_nnc_tensor_t* const* const tensors, const int tensor_size)
+{
+	size_t bytes = 0;
+	int i;
+	for (i = 0; i < tensor_size; i++)
+		if (tensors[i] && !CCV_IS_TENSOR_MULTIVIEW(tensors[i]))
+			bytes += ccv_nnc_tensor_data_size(tensors[i]->info);
+	return bytes;
+}
+
+void ccv_nnc_profiler_end(const ccv_nnc_profiler_mark_t mark, const ccv_nnc_cmd_t cmd, const uint32_t backend, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	// Only GPU streams are asynchronous to the host, on CPU the command is done by now (waiting on a CPU
+	// stream from within one of its own tasks would never return).
+	if ((profiler.flags & CCV_NNC_PROFILER_SYNC) && stream_context && CCV_STREAM_GET_CONTEXT(ccv_nnc_stream_context_type(stream_context)) == CCV_STREAM_CONTEXT_GPU)
+		ccv_nnc_stream_context_wait(stream_context);
+	const uint64_t end = ccv_nnc_cmd_mono_time();
+	const size_t workspace_size = profiler_workspace_size;
+	profiler_workspace_size = ccv_max(mark.workspace_size, workspace_size);
+	ccv_nnc_profiler_buffer_t* const buffer = _ccv_nnc_profiler_buffer();
+	const ccv_nnc_profiler_event_t event = {
+		.cmd = cmd.cmd,
+		.backend = backend,
+		.algorithm = cmd.algorithm,
+		.thread_id = buffer->thread_id,
+		.stream_type = stream_context ? ccv_nnc_stream_context_type(stream_context) : 0,
+		.exec_idx = profiler_exec.exec_idx,
+		.stream = stream_context,
+		.graph = profiler_exec.graph,
+		.start = mark.start,
+		.end = end,
+		.bytes = _ccv_nnc_profiler_bytes(inputs, input_size) + _ccv_nnc_profiler_bytes(outputs, output_size),
+		.workspace_size = workspace_size,
+	};
+	ccv_array_push(buffer->events, &event);
+}
+
+// MARK - Reporting
+
+// Convert the difference of ccv_nnc_cmd_mono_time to microseconds.
+static double _ccv_nnc_profiler_us(const uint64_t elapsed)
+{
+#ifdef __MACH__
+	mach_timebase_info_data_t timebase;
+	mach_timebase_info(&timebase);
+	return (double)elapsed * timebase.numer / timebase.denom * 1e-3;
+#else
+	return elapsed * 1e-3;
+#endif
+}
+
+#define less_than(i1, i2, aux) ((i1).start < (i2).start || ((i1).start == (i2).start && (i1).thread_id < (i2).thread_id))
+static CCV_IMPLEMENT_QSORT(_ccv_nnc_profiler_sort_by_start, ccv_nnc_profiler_event_t, less_than)
+#undef less_than
+
+ccv_array_t* ccv_nnc_profiler_events(void)
+{
+	ccv_array_t* const events = ccv_array_new(sizeof(ccv_nnc_profiler_event_t), 0, 0);
+	_ccv_nnc_profiler_lock();
+	const int generation = __atomic_load_n(&profiler.generation, __ATOMIC_ACQUIRE);
+	ccv_nnc_profiler_buffer_t* buffer;
+	int i;
+	for (buffer = profiler.buffers; buffer; buffer = buffer->next)
+		if (__atomic_load_n(&buffer->generation, __ATOMIC_ACQUIRE) == generation)
+			for (i = 0; i < buffer->events->rnum; i++)
+				ccv_array_push(events, ccv_array_get(buffer->events, i));
+	if (profiler.exited_events && profiler.exited_generation == generation)
+		for (i = 0; i < profiler.exited_events->rnum; i++)
+			ccv_array_push(events, ccv_array_get(profiler.exited_events, i));
+	_ccv_nnc_profiler_unlock();
+	if (events->rnum > 1)
+		_ccv_nnc_profiler_sort_by_start((ccv_nnc_profiler_event_t*)ccv_array_get(events, 0), events->rnum, 0);
+	return events;
+}
+
+void ccv_nnc_profiler_write_chrome_trace(FILE* out)
+{
+	ccv_array_t* const events = ccv_nnc_profiler_events();
+	// Timestamps are in microseconds, relative to the first event.
+	const uint64_t origin = events->rnum > 0 ? ((ccv_nnc_profiler_event_t*)ccv_array_get(events, 0))->start : 0;
+	fputs("{\"traceEvents\":[", out);
+	int i;
+	for (i = 0; i < events->rnum; i++)
+	{
+		const ccv_nnc_profiler_event_t* const event = (ccv_nnc_profiler_event_t*)ccv_array_get(events, i);
+		const char* const backend_name = ccv_nnc_cmd_backend_name(event->backend);
+		fprintf(out, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"backend\":\"%s\",\"algorithm\":%d,\"bytes\":%zu,\"workspace\":%zu,\"stream\":\"%p\",\"stream_type\":%d,\"graph\":\"%p\",\"exec\":%d}}",
+			i > 0 ? "," : "", ccv_nnc_cmd_name(event->cmd), backend_name, event->thread_id,
+			_ccv_nnc_profiler_us(event->start - origin), _ccv_nnc_profiler_us(event->end - event->start),
+			backend_name, event->algorithm, event->bytes, event->workspace_size, event->stream, event->stream_type, event->graph, event->exec_idx);
+	}
+	fputs("\n],\"displayTimeUnit\":\"ns\"}\n", out);
+	ccv_array_free(events);
+}
+
+typedef struct {
+	uint32_t cmd;
+	uint32_t backend;
+	int count;
+	uint64_t total;
+	uint64_t min;
+	uint64_t max;
+	size_t bytes;
+	size_t workspace_size;
+} ccv_nnc_profiler_summary_t;
+
+#define less_than(i1, i2, aux) ((i1).cmd < (i2).cmd || ((i1).cmd == (i2).cmd && (i1).backend < (i2).backend))
+static CCV_IMPLEMENT_QSORT(_ccv_nnc_profiler_sort_by_cmd, ccv_nnc_profiler_event_t, less_than)
+#undef less_than
+
+#define more_than(i1, i2, aux) ((i1).total > (i2).total)
+static CCV_IMPLEMENT_QSORT(_ccv_nnc_profiler_sort_by_total, ccv_nnc_profiler_summary_t, more_than)
+#undef more_than
+
+void ccv_nnc_profiler_write_summary(FILE* out)
+{
+	ccv_array_t* const events = ccv_nnc_profiler_events();
+	ccv_array_t* const summaries = ccv_array_new(sizeof(ccv_nnc_profiler_summary_t), 0, 0);
+	uint64_t total = 0;
+	int i;
+	if (events->rnum > 1)
+		_ccv_nnc_profiler_sort_by_cmd((ccv_nnc_profiler_event_t*)ccv_array_get(events, 0), events->rnum, 0);
+	ccv_nnc_profiler_summary_t* summary = 0;
+	for (i = 0; i < events->rnum; i++)
+	{
+		const ccv_nnc_profiler_event_t* const event = (ccv_nnc_profiler_event_t*)ccv_array_get(events, i);
+		const uint64_t elapsed = event->end - event->start;
+		total += elapsed;
+		if (!summary || summary->cmd != event->cmd || summary->backend != event->backend)
+		{
+			const ccv_nnc_profiler_summary_t new_summary = {
+				.cmd = event->cmd,
+				.backend = event->backend,
+				.min = elapsed,
+			};
+			ccv_array_push(summaries, &new_summary);
+			summary = (ccv_nnc_profiler_summary_t*)ccv_array_get(summaries, summaries->rnum - 1);
+		}
+		++summary->count;
+		summary->total += elapsed;
+		summary->min = ccv_min(summary->min, elapsed);
+		summary->max = ccv_max(summary->max, elapsed);
+		summary->bytes += event->bytes;
+		summary->workspace_size = ccv_max(summary->workspace_size, event->workspace_size);
+	}
+	if (summaries->rnum > 1)
+		_ccv_nnc_profiler_sort_by_total((ccv_nnc_profiler_summary_t*)ccv_array_get(summaries, 0), summaries->rnum, 0);
+	fprintf(out, "%-40s %-32s %8s %12s %12s %12s %12s %7s %14s %12s\n", "command", "backend", "count", "total(ms)", "mean(us)", "min(us)", "max(us)", "time%", "bytes", "workspace");
+	for (i = 0; i < summaries->rnum; i++)
+	{
+		summary = (ccv_nnc_profiler_summary_t*)ccv_array_get(summaries, i);
+		fprintf(out, "%-40s %-32s %8d %12.3f %12.3f %12.3f %12.3f %7.2f %14zu %12zu\n",
+			ccv_nnc_cmd_name(summary->cmd), ccv_nnc_cmd_backend_name(summary->backend), summary->count,
+			_ccv_nnc_profiler_us(summary->total) * 1e-3, _ccv_nnc_profiler_us(summary->total) / summary->count, _ccv_nnc_profiler_us(summary->min), _ccv_nnc_profiler_us(summary->max),
+			total > 0 ? summary->total * 100.0 / total : 0, summary->bytes, summary->workspace_size);
+	}
+	ccv_array_free(summaries);
+	ccv_array_free(events);
+}
@@ -6,14 +6,43 @@
 #include "gpu/ccv_nnc_compat.h"
 #endif
 #include "_ccv_nnc_stream.h"
+#include <unistd.h>
+
+typedef void (*ccv_nnc_stream_cpu_job_f)(ccv_nnc_stream_context_t* const stream, void* const context);
+
+typedef struct ccv_nnc_stream_cpu_job_s {
+	ccv_nnc_stream_cpu_job_f fn; // If it is 0, this job waits the emitter to reach seq.
+	void* context;
+	ccv_nnc_stream_context_t* emitter;
+	uint64_t seq;
+	struct ccv_nnc_stream_cpu_job_s* next;
+} ccv_nnc_stream_cpu_job_t;
 
 typedef struct {
 	ccv_nnc_stream_context_t super;
-	// Left for implementation yet, the CPU support for stream context.
 	size_t workspace_size;
 	void* workspace;
+	// The jobs submitted to this stream. They run on the thread pool in order, one at a time.
+	pthread_mutex_t mutex;
+	pthread_cond_t notify;
+	int scheduled; // Whether this stream is on the thread pool (or parked on a wait), until its jobs drained.
+	uint64_t enqueued;
+	uint64_t completed;
+	ccv_nnc_stream_cpu_job_t* head;
+	ccv_nnc_stream_cpu_job_t* tail;
+	ccv_array_t* waiters; // Other streams parked until this one completed to a given job.
 } ccv_nnc_stream_cpu_t;
 
+typedef struct {
+	ccv_nnc_stream_cpu_t* stream;
+	uint64_t seq;
+} ccv_nnc_stream_cpu_waiter_t;
+
+typedef struct {
+	ccv_nnc_stream_signal_t super;
+	uint64_t seq; // The number of jobs enqueued on the emitter when the signal emitted.
+} ccv_nnc_stream_signal_cpu_t;
+
 typedef struct {
 	ccv_nnc_stream_context_destructor_f destructor_hook;
 	void* context;
@@ -31,6 +60,8 @@ ccv_nnc_stream_context_t* ccv_nnc_stream_context_new(const int type)
 	if (CCV_STREAM_GET_CONTEXT(type) == CCV_STREAM_CONTEXT_GPU)
 		return ccv_nnc_init_stream_context((ccv_nnc_stream_context_t*)stream_cpu);
 #endif
+	pthread_mutex_init(&stream_cpu->mutex, 0);
+	pthread_cond_init(&stream_cpu->notify, 0);
 	return (ccv_nnc_stream_context_t*)stream_cpu;
 }
 
@@ -39,6 +70,386 @@ CCV_WARN_UNUSED(int) ccv_nnc_stream_context_type(const ccv_nnc_stream_context_t*
 	return stream_context->type;
 }
 
+// MARK - CPU Thread Pool
+
+// The CPU streams run their jobs on a work-stealing thread pool. Each worker has its own deque, it pushes / pops
+// at the bottom (hence, a stream made ready by the job just finished on this worker likely runs here with a warm
+// cache), other workers steal from the top when they run out of work.
+
+typedef void (*ccv_nnc_thread_pool_task_f)(void* const context);
+
+typedef struct {
+	ccv_nnc_thread_pool_task_f fn;
+	void* context;
+} ccv_nnc_thread_pool_task_t;
+
+typedef struct {
+	pthread_mutex_t mutex;
+	int idx;
+	int size; // Always a power of 2.
+	int top;
+	int bottom;
+	ccv_nnc_thread_pool_task_t* tasks;
+	pthread_t thread;
+} ccv_nnc_thread_pool_worker_t;
+
+static struct {
+	int thread_count; // 0 means one per online core, 1 runs inline.
+	int worker_size; // Number of workers running, 0 if the pool is not started.
+	int stop;
+	int pending; // Number of tasks on any deque.
+	int sleeping;
+	unsigned int inject;
+	ccv_nnc_thread_pool_worker_t* workers;
+	pthread_mutex_t mutex;
+	pthread_cond_t wakeup;
+} thread_pool = {
+	.thread_count = 1,
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.wakeup = PTHREAD_COND_INITIALIZER,
+};
+
+static __thread ccv_nnc_thread_pool_worker_t* thread_pool_worker = 0;
+
+static int _ccv_nnc_thread_pool_thread_count(void)
+{
+	if (thread_pool.thread_count > 0)
+		return thread_pool.thread_count;
+	const int thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	return thread_count > 0 ? thread_count : 1;
+}
+
+static void _ccv_nnc_thread_pool_push(ccv_nnc_thread_pool_worker_t* const worker, const ccv_nnc_thread_pool_task_t task)
+{
+	pthread_mutex_lock(&worker->mutex);
+	if (worker->bottom - worker->top >= worker->size)
+	{
+		const int size = worker->size * 2;
+		ccv_nnc_thread_pool_task_t* const tasks = (ccv_nnc_thread_pool_task_t*)ccmalloc(sizeof(ccv_nnc_thread_pool_task_t) * size);
+		int i;
+		for (i = worker->top; i < worker->bottom; i++)
+			tasks[i & (size - 1)] = worker->tasks[i & (worker->size - 1)];
+		ccfree(worker->tasks);
+		worker->tasks = tasks;
+		worker->size = size;
+	}
+	worker->tasks[worker->bottom & (worker->size - 1)] = task;
+	++worker->bottom;
+	__atomic_add_fetch(&thread_pool.pending, 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&worker->mutex);
+}
+
+static int _ccv_nnc_thread_pool_take(ccv_nnc_thread_pool_worker_t* const worker, const int steal, ccv_nnc_thread_pool_task_t* const task)
+{
+	int flag = 0;
+	pthread_mutex_lock(&worker->mutex);
+	if (worker->bottom > worker->top)
+	{
+		if (steal)
+			*task = worker->tasks[(worker->top++) & (worker->size - 1)];
+		else
+			*task = worker->tasks[(--worker->bottom) & (worker->size - 1)];
+		__atomic_sub_fetch(&thread_pool.pending, 1, __ATOMIC_SEQ_CST);
+		flag = 1;
+	}
+	pthread_mutex_unlock(&worker->mutex);
+	return flag;
+}
+
+static void* _ccv_nnc_thread_pool_main(void* userdata)
+{
+	ccv_nnc_thread_pool_worker_t* const worker = (ccv_nnc_thread_pool_worker_t*)userdata;
+	thread_pool_worker = worker;
+	const int worker_size = thread_pool.worker_size;
+	ccv_nnc_thread_pool_task_t task;
+	for (;;)
+	{
+		int i, flag = _ccv_nnc_thread_pool_take(worker, 0, &task);
+		for (i = 1; !flag && i < worker_size; i++)
+			flag = _ccv_nnc_thread_pool_take(thread_pool.workers + (worker->idx + i) % worker_size, 1, &task);
+		if (flag)
+		{
+			task.fn(task.context);
+			continue;
+		}
+		pthread_mutex_lock(&thread_pool.mutex);
+		while (!thread_pool.stop && __atomic_load_n(&thread_pool.pending, __ATOMIC_SEQ_CST) == 0)
+		{
+			++thread_pool.sleeping;
+			pthread_cond_wait(&thread_pool.wakeup, &thread_pool.mutex);
+			--thread_pool.sleeping;
+		}
+		// Only quit when there is nothing left, a running task may submit more.
+		const int stop = thread_pool.stop && __atomic_load_n(&thread_pool.pending, __ATOMIC_SEQ_CST) == 0;
+		pthread_mutex_unlock(&thread_pool.mutex);
+		if (stop)
+			break;
+	}
+	thread_pool_worker = 0;
+	return 0;
+}
+
+static void _ccv_nnc_thread_pool_start(void)
+{
+	pthread_mutex_lock(&thread_pool.mutex);
+	if (thread_pool.worker_size > 0)
+	{
+		pthread_mutex_unlock(&thread_pool.mutex);
+		return;
+	}
+	const int worker_size = _ccv_nnc_thread_pool_thread_count();
+	ccv_nnc_thread_pool_worker_t* const workers = (ccv_nnc_thread_pool_worker_t*)cccalloc(worker_size, sizeof(ccv_nnc_thread_pool_worker_t));
+	int i;
+	for (i = 0; i < worker_size; i++)
+	{
+		pthread_mutex_init(&workers[i].mutex, 0);
+		workers[i].idx = i;
+		workers[i].size = 16;
+		workers[i].tasks = (ccv_nnc_thread_pool_task_t*)ccmalloc(sizeof(ccv_nnc_thread_pool_task_t) * workers[i].size);
+	}
+	thread_pool.workers = workers;
+	thread_pool.stop = 0;
+	__atomic_store_n(&thread_pool.worker_size, worker_size, __ATOMIC_RELEASE);
+	for (i = 0; i < worker_size; i++)
+		pthread_create(&workers[i].thread, 0, _ccv_nnc_thread_pool_main, workers + i);
+	pthread_mutex_unlock(&thread_pool.mutex);
+}
+
+static void _ccv_nnc_thread_pool_submit(const ccv_nnc_thread_pool_task_f fn, void* const context)
+{
+	if (!__atomic_load_n(&thread_pool.worker_size, __ATOMIC_ACQUIRE))
+		_ccv_nnc_thread_pool_start();
+	ccv_nnc_thread_pool_worker_t* worker = thread_pool_worker;
+	// From outside of the pool, spread the tasks to the workers round-robin.
+	if (!worker)
+		worker = thread_pool.workers + __atomic_fetch_add(&thread_pool.inject, 1, __ATOMIC_RELAXED) % thread_pool.worker_size;
+	const ccv_nnc_thread_pool_task_t task = {
+		.fn = fn,
+		.context = context,
+	};
+	_ccv_nnc_thread_pool_push(worker, task);
+	pthread_mutex_lock(&thread_pool.mutex);
+	if (thread_pool.sleeping > 0)
+		pthread_cond_signal(&thread_pool.wakeup);
+	pthread_mutex_unlock(&thread_pool.mutex);
+}
+
+void ccv_nnc_stream_context_set_cpu_thread_count(const int thread_count)
+{
+	pthread_mutex_lock(&thread_pool.mutex);
+	const int worker_size = thread_pool.worker_size;
+	ccv_nnc_thread_pool_worker_t* const workers = thread_pool.workers;
+	thread_pool.stop = 1;
+	pthread_cond_broadcast(&thread_pool.wakeup);
+	pthread_mutex_unlock(&thread_pool.mutex);
+	int i;
+	for (i = 0; i < worker_size; i++)
+		pthread_join(workers[i].thread, 0);
+	for (i = 0; i < worker_size; i++)
+	{
+		pthread_mutex_destroy(&workers[i].mutex);
+		ccfree(workers[i].tasks);
+	}
+	if (workers)
+		ccfree(workers);
+	pthread_mutex_lock(&thread_pool.mutex);
+	// The workers will be started with the new count next time a job submitted.
+	thread_pool.workers = 0;
+	__atomic_store_n(&thread_pool.worker_size, 0, __ATOMIC_RELEASE);
+	thread_pool.stop = 0;
+	thread_pool.thread_count = ccv_max(thread_count, 0);
+	pthread_mutex_unlock(&thread_pool.mutex);
+}
+
+int ccv_nnc_stream_context_cpu_thread_count(void)
+{
+	return _ccv_nnc_thread_pool_thread_count();
+}
+
+// MARK - CPU Stream
+
+static __thread ccv_nnc_stream_cpu_t* stream_cpu_running = 0;
+
+static void _ccv_nnc_stream_cpu_run(void* const context);
+
+static int _ccv_nnc_stream_cpu_enqueue(ccv_nnc_stream_cpu_t* const stream_cpu, const ccv_nnc_stream_cpu_job_f fn, void* const context, ccv_nnc_stream_context_t* const emitter, const uint64_t seq, const int only_if_scheduled)
+{
+	pthread_mutex_lock(&stream_cpu->mutex);
+	if (only_if_scheduled && !stream_cpu->scheduled)
+	{
+		pthread_mutex_unlock(&stream_cpu->mutex);
+		return 0;
+	}
+	ccv_nnc_stream_cpu_job_t* const job = (ccv_nnc_stream_cpu_job_t*)ccmalloc(sizeof(ccv_nnc_stream_cpu_job_t));
+	job->fn = fn;
+	job->context = context;
+	job->emitter = emitter;
+	job->seq = seq;
+	job->next = 0;
+	if (stream_cpu->tail)
+		stream_cpu->tail->next = job;
+	else
+		stream_cpu->head = job;
+	stream_cpu->tail = job;
+	++stream_cpu->enqueued;
+	const int schedule = !stream_cpu->scheduled;
+	stream_cpu->scheduled = 1;
+	pthread_mutex_unlock(&stream_cpu->mutex);
+	if (schedule)
+		_ccv_nnc_thread_pool_submit(_ccv_nnc_stream_cpu_run, stream_cpu);
+	return 1;
+}
+
+static void _ccv_nnc_stream_cpu_run(void* const context)
+{
+	ccv_nnc_stream_cpu_t* const stream_cpu = (ccv_nnc_stream_cpu_t*)context;
+	pthread_mutex_lock(&stream_cpu->mutex);
+	for (;;)
+	{
+		ccv_nnc_stream_cpu_job_t* const job = stream_cpu->head;
+		if (!job)
+		{
+			stream_cpu->scheduled = 0;
+			pthread_cond_broadcast(&stream_cpu->notify);
+			pthread_mutex_unlock(&stream_cpu->mutex);
+			return;
+		}
+		pthread_mutex_unlock(&stream_cpu->mutex);
+		if (job->fn)
+		{
+			stream_cpu_running = stream_cpu;
+			job->fn((ccv_nnc_stream_context_t*)stream_cpu, job->context);
+			stream_cpu_running = 0;
+		} else {
+			ccv_nnc_stream_cpu_t* const emitter = (ccv_nnc_stream_cpu_t*)job->emitter;
+			pthread_mutex_lock(&emitter->mutex);
+			if (emitter->completed < job->seq)
+			{
+				// Park this stream, the emitter will put it back to the thread pool once it gets there.
+				const ccv_nnc_stream_cpu_waiter_t waiter = {
+					.stream = stream_cpu,
+					.seq = job->seq,
+				};
+				if (!emitter->waiters)
+					emitter->waiters = ccv_array_new(sizeof(ccv_nnc_stream_cpu_waiter_t), 1, 0);
+				ccv_array_push(emitter->waiters, &waiter);
+				pthread_mutex_unlock(&emitter->mutex);
+				return;
+			}
+			pthread_mutex_unlock(&emitter->mutex);
+		}
+		pthread_mutex_lock(&stream_cpu->mutex);
+		stream_cpu->head = job->next;
+		if (!stream_cpu->head)
+			stream_cpu->tail = 0;
+		++stream_cpu->completed;
+		ccfree(job);
+		if (stream_cpu->waiters)
+		{
+			int i;
+			for (i = 0; i < stream_cpu->waiters->rnum;)
+			{
+				ccv_nnc_stream_cpu_waiter_t* const waiter = (ccv_nnc_stream_cpu_waiter_t*)ccv_array_get(stream_cpu->waiters, i);
+				if (waiter->seq <= stream_cpu->completed)
+				{
+					_ccv_nnc_thread_pool_submit(_ccv_nnc_stream_cpu_run, waiter->stream);
+					*waiter = *(ccv_nnc_stream_cpu_waiter_t*)ccv_array_get(stream_cpu->waiters, stream_cpu->waiters->rnum - 1);
+					--stream_cpu->waiters->rnum;
+				} else
+					++i;
+			}
+		}
+	}
+}
+
+static void _ccv_nnc_stream_cpu_wait(ccv_nnc_stream_cpu_t* const stream_cpu)
+{
+	if (stream_cpu_running == stream_cpu) // Cannot wait for ourselves.
+		return;
+	pthread_mutex_lock(&stream_cpu->mutex);
+	while (stream_cpu->scheduled)
+		pthread_cond_wait(&stream_cpu->notify, &stream_cpu->mutex);
+	pthread_mutex_unlock(&stream_cpu->mutex);
+}
+
+static int _ccv_nnc_stream_cpu_is_busy(ccv_nnc_stream_cpu_t* const stream_cpu)
+{
+	if (stream_cpu_running == stream_cpu)
+		return 0;
+	pthread_mutex_lock(&stream_cpu->mutex);
+	const int scheduled = stream_cpu->scheduled;
+	pthread_mutex_unlock(&stream_cpu->mutex);
+	return scheduled;
+}
+
+typedef struct {
+	ccv_nnc_cmd_t cmd;
+	ccv_nnc_hint_t hint;
+	int flags;
+	int input_size;
+	int output_size;
+	ccv_nnc_tensor_t** inputs;
+	ccv_nnc_tensor_t** outputs;
+	ccv_nnc_profiler_exec_t exec; // The execution node it runs for, carried over to the pool thread.
+	ccv_nnc_stream_context_neighbor_discovery_f discovery;
+	void* discovery_context; // Copied along with the command, the caller's one may be gone by the time it runs.
+} ccv_nnc_stream_cpu_cmd_t;
+
+static void _ccv_nnc_stream_cpu_cmd_exec(ccv_nnc_stream_context_t* const stream, void* const context)
+{
+	ccv_nnc_stream_cpu_cmd_t* const cmd = (ccv_nnc_stream_cpu_cmd_t*)context;
+	const ccv_nnc_profiler_exec_t prev_exec = ccv_nnc_profiler_set_exec(cmd->exec);
+	// Only one job of a stream runs at a time, it is safe to swap the neighbor discovery for the duration.
+	const ccv_nnc_stream_context_neighbor_discovery_f prev_discovery = stream->neighbor_discovery;
+	void* const prev_discovery_context = stream->neighbor_discovery_context;
+	if (cmd->discovery)
+		ccv_nnc_stream_context_set_neighbor_discovery(stream, cmd->discovery, cmd->discovery_context);
+	ccv_nnc_cmd_exec(cmd->cmd, cmd->hint, cmd->flags, cmd->inputs, cmd->input_size, cmd->outputs, cmd->output_size, stream);
+	if (cmd->discovery)
+		ccv_nnc_stream_context_set_neighbor_discovery(stream, prev_discovery, prev_discovery_context);
+	ccv_nnc_profiler_set_exec(prev_exec);
+	ccfree(cmd);
+}
+
+void ccv_nnc_stream_cpu_cmd_exec(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, const ccv_nnc_stream_context_neighbor_discovery_f discovery, const void* const discovery_context, const size_t discovery_context_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(CCV_STREAM_GET_CONTEXT(stream_context->type) == CCV_STREAM_CONTEXT_CPU);
+	if (_ccv_nnc_thread_pool_thread_count() <= 1)
+	{
+		if (discovery)
+			ccv_nnc_stream_context_set_neighbor_discovery(stream_context, discovery, (void*)discovery_context);
+		ccv_nnc_cmd_exec(cmd, hint, flags, inputs, input_size, outputs, output_size, stream_context);
+		return;
+	}
+	ccv_nnc_stream_cpu_cmd_t* const stream_cmd = (ccv_nnc_stream_cpu_cmd_t*)ccmalloc(sizeof(ccv_nnc_stream_cpu_cmd_t) + sizeof(ccv_nnc_tensor_t*) * (input_size + output_size) + discovery_context_size);
+	stream_cmd->cmd = cmd;
+	stream_cmd->hint = hint;
+	stream_cmd->flags = flags;
+	stream_cmd->input_size = input_size;
+	stream_cmd->output_size = output_size;
+	stream_cmd->inputs = (ccv_nnc_tensor_t**)(stream_cmd + 1);
+	stream_cmd->outputs = stream_cmd->inputs + input_size;
+	stream_cmd->exec = ccv_nnc_profiler_get_exec();
+	stream_cmd->discovery = discovery;
+	stream_cmd->discovery_context = 0;
+	if (input_size > 0)
+		memcpy(stream_cmd->inputs, inputs, sizeof(ccv_nnc_tensor_t*) * input_size);
+	if (output_size > 0)
+		memcpy(stream_cmd->outputs, outputs, sizeof(ccv_nnc_tensor_t*) * output_size);
+	if (discovery_context_size > 0)
+	{
+		stream_cmd->discovery_context = stream_cmd->outputs + output_size;
+		memcpy(stream_cmd->discovery_context, discovery_context, discovery_context_size);
+	}
+	_ccv_nnc_stream_cpu_enqueue((ccv_nnc_stream_cpu_t*)stream_context, _ccv_nnc_stream_cpu_cmd_exec, stream_cmd, 0, 0, 0);
+}
+
+void ccv_nnc_stream_cpu_sync(ccv_nnc_stream_context_t* const stream_context)
+{
+	if (CCV_STREAM_GET_CONTEXT(stream_context->type) == CCV_STREAM_CONTEXT_CPU)
+		_ccv_nnc_stream_cpu_wait((ccv_nnc_stream_cpu_t*)stream_context);
+}
+
 #ifndef HAVE_CUDA
 static __thread ccv_nnc_stream_cpu_t ccv_nnc_per_thread_stream_cpu = {
 	.super = {
@@ -49,6 +460,8 @@ static __thread ccv_nnc_stream_cpu_t ccv_nnc_per_thread_stream_cpu = {
 
 void* ccv_nnc_stream_context_get_workspace(ccv_nnc_stream_context_t* const stream_context, const size_t workspace_size, const int mem)
 {
+	if (ccv_nnc_profiler_is_on)
+		ccv_nnc_profiler_note_workspace(workspace_size);
 #ifdef HAVE_CUDA
 	return ccv_nnc_stream_compat_get_workspace(stream_context, workspace_size, mem);
 #else
@@ -88,12 +501,14 @@ void ccv_nnc_stream_context_add_callback(ccv_nnc_stream_context_t* const stream_
 {
 #ifdef HAVE_CUDA
 	if (CCV_STREAM_GET_CONTEXT(stream_context->type) == CCV_STREAM_CONTEXT_GPU)
+	{
 		ccv_nnc_stream_compat_add_callback(stream_context, callback, callback_context);
-	else
-		callback(stream_context, callback_context);
-#else
-	callback(stream_context, callback_context);
+		return;
+	}
 #endif
+	// If there are jobs in flight, call it after them. Otherwise, the stream is already at that point.
+	if (!_ccv_nnc_stream_cpu_enqueue((ccv_nnc_stream_cpu_t*)stream_context, callback, callback_context, 0, 0, 1))
+		callback(stream_context, callback_context);
 }
 
 int ccv_nnc_stream_context_try_wait(const ccv_nnc_stream_context_t* const stream_context)
@@ -104,6 +519,8 @@ int ccv_nnc_stream_context_try_wait(const ccv_nnc_stream_context_t* const stream
 	if (CCV_STREAM_GET_CONTEXT(stream_context->type) == CCV_STREAM_CONTEXT_GPU)
 		ccv_nnc_synchronize_stream_context(stream_context);
 #endif
+	if (CCV_STREAM_GET_CONTEXT(stream_context->type) == CCV_STREAM_CONTEXT_CPU && _ccv_nnc_stream_cpu_is_busy((ccv_nnc_stream_cpu_t*)stream_context))
+		return -1;
 	co_scheduler_t* const scheduler = stream_context->scheduler;
 	return scheduler ? -1 : 0;
 }
@@ -120,6 +537,8 @@ void ccv_nnc_stream_context_wait(const ccv_nnc_stream_context_t* const stream_co
 			pthread_cond_wait(&scheduler->notify, &scheduler->mutex);
 		pthread_mutex_unlock(&scheduler->mutex);
 	}
+	if (CCV_STREAM_GET_CONTEXT(stream_context->type) == CCV_STREAM_CONTEXT_CPU)
+		_ccv_nnc_stream_cpu_wait((ccv_nnc_stream_cpu_t*)stream_context);
 #ifdef HAVE_CUDA
 	if (CCV_STREAM_GET_CONTEXT(stream_context->type) == CCV_STREAM_CONTEXT_GPU)
 		ccv_nnc_synchronize_stream_context(stream_context);
@@ -175,6 +594,8 @@ void ccv_nnc_stream_context_remove_destructor_hook(ccv_nnc_stream_context_t* con
 
 void ccv_nnc_stream_context_free(ccv_nnc_stream_context_t* const stream_context)
 {
+	if (CCV_STREAM_GET_CONTEXT(stream_context->type) == CCV_STREAM_CONTEXT_CPU)
+		_ccv_nnc_stream_cpu_wait((ccv_nnc_stream_cpu_t*)stream_context);
 	if (stream_context->destructor_hooks)
 	{
 		int i;
@@ -194,6 +615,10 @@ void ccv_nnc_stream_context_free(ccv_nnc_stream_context_t* const stream_context)
 	ccv_nnc_stream_cpu_t* stream_cpu = (ccv_nnc_stream_cpu_t*)stream_context;
 	if (stream_cpu->workspace)
 		ccfree(stream_cpu->workspace);
+	if (stream_cpu->waiters)
+		ccv_array_free(stream_cpu->waiters);
+	pthread_mutex_destroy(&stream_cpu->mutex);
+	pthread_cond_destroy(&stream_cpu->notify);
 #ifdef HAVE_CUDA
 	}
 #endif
@@ -220,9 +645,10 @@ ccv_nnc_stream_context_t* ccv_nnc_stream_context_find_neighbor(ccv_nnc_stream_co
 
 ccv_nnc_stream_signal_t* ccv_nnc_stream_signal_new(const int type)
 {
-	ccv_nnc_stream_signal_t* const signal = (ccv_nnc_stream_signal_t*)ccmalloc(sizeof(ccv_nnc_stream_signal_t));
+	ccv_nnc_stream_signal_t* const signal = (ccv_nnc_stream_signal_t*)ccmalloc(sizeof(ccv_nnc_stream_signal_cpu_t));
 	signal->type = type;
 	signal->emit_context = 0;
+	((ccv_nnc_stream_signal_cpu_t*)signal)->seq = 0;
 #ifdef HAVE_CUDA
 	if (CCV_STREAM_GET_CONTEXT(type) == CCV_STREAM_CONTEXT_GPU)
 		return ccv_nnc_init_stream_signal(signal);
@@ -242,6 +668,13 @@ void ccv_nnc_stream_context_emit_signal(ccv_nnc_stream_context_t* const stream,
 	if (CCV_STREAM_GET_CONTEXT(signal->type) == CCV_STREAM_CONTEXT_GPU)
 		ccv_nnc_stream_compat_emit_signal(stream, signal);
 #endif
+	if (CCV_STREAM_GET_CONTEXT(signal->type) == CCV_STREAM_CONTEXT_CPU && CCV_STREAM_GET_CONTEXT(stream->type) == CCV_STREAM_CONTEXT_CPU)
+	{
+		ccv_nnc_stream_cpu_t* const stream_cpu = (ccv_nnc_stream_cpu_t*)stream;
+		pthread_mutex_lock(&stream_cpu->mutex);
+		((ccv_nnc_stream_signal_cpu_t*)signal)->seq = stream_cpu->enqueued;
+		pthread_mutex_unlock(&stream_cpu->mutex);
+	}
 }
 
 ccv_nnc_stream_context_t* ccv_nnc_stream_signal_get_emitter(const ccv_nnc_stream_signal_t* const signal)
@@ -255,6 +688,16 @@ void ccv_nnc_stream_context_wait_signal(const ccv_nnc_stream_context_t* const st
 	if (CCV_STREAM_GET_CONTEXT(signal->type) == CCV_STREAM_CONTEXT_GPU)
 		ccv_nnc_stream_compat_wait_signal(stream, signal);
 #endif
+	ccv_nnc_stream_cpu_t* const emitter = (ccv_nnc_stream_cpu_t*)signal->emit_context;
+	if (CCV_STREAM_GET_CONTEXT(signal->type) != CCV_STREAM_CONTEXT_CPU || CCV_STREAM_GET_CONTEXT(stream->type) != CCV_STREAM_CONTEXT_CPU ||
+		!emitter || (const ccv_nnc_stream_context_t*)emitter == stream || CCV_STREAM_GET_CONTEXT(emitter->super.type) != CCV_STREAM_CONTEXT_CPU)
+		return;
+	const uint64_t seq = ((const ccv_nnc_stream_signal_cpu_t*)signal)->seq;
+	pthread_mutex_lock(&emitter->mutex);
+	const int done = emitter->completed >= seq;
+	pthread_mutex_unlock(&emitter->mutex);
+	if (!done)
+		_ccv_nnc_stream_cpu_enqueue((ccv_nnc_stream_cpu_t*)stream, 0, 0, (ccv_nnc_stream_context_t*)emitter, seq, 0);
 }
 
 void ccv_nnc_stream_signal_free(ccv_nnc_stream_signal_t* const signal)
@@ -283,6 +726,17 @@ co_scheduler_t* ccv_nnc_stream_context_get_scheduler(ccv_nnc_stream_context_t* c
 	return scheduler;
 }
 
+static void _co_stream_cpu_resume(ccv_nnc_stream_context_t* const stream, void* const userdata)
+{
+	co_routine_t* const task = (co_routine_t*)userdata;
+	co_scheduler_t* const scheduler = task->scheduler;
+	pthread_mutex_lock(&scheduler->mutex);
+	_co_prepend_task(scheduler, task);
+	--scheduler->stream_await_count;
+	pthread_cond_signal(&scheduler->wait);
+	pthread_mutex_unlock(&scheduler->mutex);
+}
+
 int _co_stream_await(co_routine_t* const self, ccv_nnc_stream_context_t* const stream)
 {
 	if (!stream)
@@ -291,7 +745,16 @@ int _co_stream_await(co_routine_t* const self, ccv_nnc_stream_context_t* const s
 	if (CCV_STREAM_GET_CONTEXT(stream->type) == CCV_STREAM_CONTEXT_GPU)
 		return co_stream_compat_await(self, stream);
 #endif
-	return 1;
+	ccv_nnc_stream_cpu_t* const stream_cpu = (ccv_nnc_stream_cpu_t*)stream;
+	// If the stream is completed, no need to wait.
+	if (!_ccv_nnc_stream_cpu_is_busy(stream_cpu))
+		return 1;
+	co_scheduler_t* const scheduler = self->scheduler;
+	pthread_mutex_lock(&scheduler->mutex);
+	++scheduler->stream_await_count;
+	_ccv_nnc_stream_cpu_enqueue(stream_cpu, _co_stream_cpu_resume, self, 0, 0, 0);
+	pthread_mutex_unlock(&scheduler->mutex);
+	return 0;
 }
 
 // MARK - Signal Container
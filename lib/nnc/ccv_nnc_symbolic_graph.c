@@ -51,6 +51,8 @@ ccv_nnc_symbolic_graph_t* ccv_nnc_symbolic_graph_dup(const ccv_nnc_symbolic_grap
 			symbol_info->s_ref->rnum = s_ref->rnum;
 			memcpy(ccv_array_get(symbol_info->s_ref, 0), ccv_array_get(s_ref, 0), sizeof(int) * s_ref->rnum);
 		}
+		if (symbol_info->constant)
+			symbol_info->constant = ccv_nnc_tensor_constant_copy(symbol_info->constant->info, symbol_info->constant);
 	}
 	new_graph->exec_symbol_info = ccv_array_new(sizeof(ccv_nnc_graph_exec_symbol_info_t), graph->exec_symbol_info->rnum, 0);
 	new_graph->exec_symbol_info->rnum = graph->exec_symbol_info->rnum;
@@ -192,6 +194,31 @@ ccv_nnc_tensor_symbol_t ccv_nnc_tensor_symbol_new(ccv_nnc_symbolic_graph_t* cons
 	return symbol;
 }
 
+ccv_nnc_tensor_t* ccv_nnc_tensor_constant_copy(const ccv_nnc_tensor_param_t info, const ccv_nnc_tensor_t* const tensor)
+{
+	assert(info.datatype == tensor->info.datatype);
+	assert(ccv_nnc_tensor_count(info) == ccv_nnc_tensor_count(tensor->info));
+	ccv_nnc_tensor_t* const constant = ccv_nnc_tensor_new(0, info, 0);
+	// Copy directly if we can, the data transfer command on CPU only supports 32F.
+	if (!CCV_IS_TENSOR_VIEW(tensor) && CCV_TENSOR_GET_MEMORY(info.type) == CCV_TENSOR_CPU_MEMORY && CCV_TENSOR_GET_MEMORY(tensor->info.type) == CCV_TENSOR_CPU_MEMORY)
+		memcpy(constant->data.u8, tensor->data.u8, ccv_nnc_tensor_count(info) * CCV_GET_DATA_TYPE_SIZE(info.datatype));
+	else
+		ccv_nnc_cmd_exec(CMD_DATA_TRANSFER_FORWARD(), ccv_nnc_no_hint, 0, TENSOR_LIST((ccv_nnc_tensor_t*)tensor), TENSOR_LIST(constant), 0);
+	return constant;
+}
+
+ccv_nnc_tensor_symbol_t ccv_nnc_tensor_symbol_constant_new(ccv_nnc_symbolic_graph_t* const graph, const ccv_nnc_tensor_t* const tensor, const char* const name)
+{
+	ccv_nnc_tensor_param_t info = tensor->info;
+	// Tensors created with ccv_nnc_tensor_new may use the trailing dimension for toll-free bridging, clear it out.
+	const int nd = ccv_nnc_tensor_nd(info.dim);
+	memset(info.dim + nd, 0, sizeof(info.dim) - sizeof(info.dim[0]) * nd);
+	const ccv_nnc_tensor_symbol_t symbol = ccv_nnc_tensor_symbol_new(graph, info, name);
+	ccv_nnc_tensor_symbol_info_t* const symbol_info = (ccv_nnc_tensor_symbol_info_t*)ccv_array_get(graph->tensor_symbol_info, symbol.d);
+	symbol_info->constant = ccv_nnc_tensor_constant_copy(info, tensor);
+	return symbol;
+}
+
 void* ccv_nnc_tensor_symbol_new_hook(ccv_nnc_symbolic_graph_t* const graph, ccv_nnc_tensor_symbol_new_hook_f hook, void* context)
 {
 	void* const prev = graph->hooks.tensor_symbol_new.context;
@@ -776,6 +803,35 @@ int ccv_nnc_tensor_symbol_flags(ccv_nnc_symbolic_graph_t* const graph, const ccv
 	return symbol_info->flags;
 }
 
+int ccv_nnc_tensor_symbol_set_constant(ccv_nnc_symbolic_graph_t* const graph, const ccv_nnc_tensor_symbol_t tensor, const ccv_nnc_tensor_t* const constant)
+{
+	assert(graph == tensor.graph);
+	assert(tensor.d < graph->tensor_symbol_info->rnum);
+	ccv_nnc_tensor_symbol_info_t* const symbol_info = (ccv_nnc_tensor_symbol_info_t*)ccv_array_get(graph->tensor_symbol_info, tensor.d);
+	if (symbol_info->alias_ref || symbol_info->assign_ref || symbol_info->p_ref)
+		return -1;
+	if (ccv_nnc_is_tensor_auto(symbol_info->info))
+	{
+		symbol_info->info = constant->info;
+		const int nd = ccv_nnc_tensor_nd(symbol_info->info.dim);
+		memset(symbol_info->info.dim + nd, 0, sizeof(symbol_info->info.dim) - sizeof(symbol_info->info.dim[0]) * nd);
+	}
+	if (symbol_info->info.datatype != constant->info.datatype || ccv_nnc_tensor_count(symbol_info->info) != ccv_nnc_tensor_count(constant->info))
+		return -1;
+	if (symbol_info->constant)
+		ccv_nnc_tensor_free(symbol_info->constant);
+	symbol_info->constant = ccv_nnc_tensor_constant_copy(symbol_info->info, constant);
+	return 0;
+}
+
+const ccv_nnc_tensor_t* ccv_nnc_tensor_symbol_constant(const ccv_nnc_symbolic_graph_t* const graph, const ccv_nnc_tensor_symbol_t tensor)
+{
+	assert(graph == tensor.graph);
+	assert(tensor.d < graph->tensor_symbol_info->rnum);
+	const ccv_nnc_tensor_symbol_info_t* const symbol_info = (ccv_nnc_tensor_symbol_info_t*)ccv_array_get(graph->tensor_symbol_info, tensor.d);
+	return symbol_info->constant;
+}
+
 void ccv_nnc_tensor_symbol_free(ccv_nnc_symbolic_graph_t* const graph, ccv_nnc_tensor_symbol_t tensor)
 {
 	assert(graph == tensor.graph);
@@ -791,6 +847,11 @@ void ccv_nnc_tensor_symbol_free(ccv_nnc_symbolic_graph_t* const graph, ccv_nnc_t
 		ccfree(symbol_info->name);
 		symbol_info->name = 0;
 	}
+	if (symbol_info->constant)
+	{
+		ccv_nnc_tensor_free(symbol_info->constant);
+		symbol_info->constant = 0;
+	}
 	symbol_info->flags |= CCV_NNC_TENSOR_SYMBOL_DEAD;
 	int i;
 	for (i = graph->tensor_symbol_info->rnum - 1; i >= 0; i--)
@@ -1821,6 +1882,8 @@ void ccv_nnc_symbolic_graph_free(ccv_nnc_symbolic_graph_t* const graph)
 			ccfree(symbol_info->name);
 		if (symbol_info->s_ref)
 			ccv_array_free(symbol_info->s_ref);
+		if (symbol_info->constant)
+			ccv_nnc_tensor_free(symbol_info->constant);
 	}
 	if (graph->sub_graphs)
 	{
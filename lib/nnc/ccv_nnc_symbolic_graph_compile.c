@@ -7,6 +7,13 @@
 #endif
 #include "_ccv_nnc_graph.h"
 #include "_ccv_nnc_symbolic_graph.h"
+#include "3rdparty/sqlite3/sqlite3.h"
+
+#ifdef NDEBUG
+#define SQLITE_ENFORCE(stmt) (void)(stmt)
+#else
+#define SQLITE_ENFORCE assert
+#endif
 
 // MARK - Level-3 API
 
@@ -138,6 +145,7 @@ typedef struct {
 	int vt_block_size;
 	int buffer_size;
 	int block_size;
+	uint64_t size_lower_bound; // The peak size of the tensor blocks that cannot share memory, no planner can do better.
 	int* vt_blocks; // A reference to the block, because blocks only contains available block (thus, doesn't consider alias etc.). -1 means no block pointed to. Starts at 0.
 	struct {
 		int type; // The type from tensor blocks.
@@ -185,7 +193,227 @@ typedef struct {
 	ccv_array_t* itf;
 } ccv_nnc_tensor_block_adjacent_t;
 
-static ccv_nnc_tensor_alloc_prep_t* _ccv_nnc_tensor_alloc_prep_new(const ccv_sparse_matrix_t* const exec_dep, const ccv_nnc_tensor_block_t* const tensor_blocks, const int tensor_block_size)
+// The position of each exec in the topological order from the visit, -1 if it is not visited. Returns the number of
+// execs visited.
+static int _ccv_nnc_exec_pos_from_visit(ccv_nnc_graph_visit_t* const visit, const ccv_nnc_graph_exec_symbol_info_t* const exec_symbol_info, const int exec_symbol_info_size, int* const exec_pos)
+{
+	int i, pos_size = 0;
+	for (i = 0; i < exec_symbol_info_size; i++)
+		exec_pos[i] = -1;
+	ccv_nnc_graph_visit_for(visit, exec_symbol_info, node, idx) {
+		exec_pos[idx] = pos_size++;
+	} ccv_nnc_graph_visit_endfor
+	return pos_size;
+}
+
+// The first and the last position the tensor block is alive at in the topological order. If the head (tail) is empty
+// or not visited, it is alive from the beginning (to the end), the same way it interferes with everything.
+static void _ccv_nnc_tensor_block_live_range(const int* const exec_pos, const int exec_size, const int pos_size, const ccv_nnc_tensor_block_t* const tensor_block, int* const start_ref, int* const end_ref)
+{
+	int i;
+	int start = pos_size - 1;
+	if (!tensor_block->head || !tensor_block->head->rnum)
+		start = 0;
+	for (i = 0; tensor_block->head && i < tensor_block->head->rnum; i++)
+	{
+		const int idx = *(int*)ccv_array_get(tensor_block->head, i);
+		const int pos = idx >= 0 && idx < exec_size ? exec_pos[idx] : -1;
+		start = pos >= 0 ? ccv_min(start, pos) : 0;
+	}
+	int end = 0;
+	if (!tensor_block->tail || !tensor_block->tail->rnum)
+		end = pos_size - 1;
+	for (i = 0; tensor_block->tail && i < tensor_block->tail->rnum; i++)
+	{
+		const int idx = *(int*)ccv_array_get(tensor_block->tail, i);
+		const int pos = idx >= 0 && idx < exec_size ? exec_pos[idx] : -1;
+		end = pos >= 0 ? ccv_max(end, pos) : pos_size - 1;
+	}
+	*start_ref = start;
+	*end_ref = ccv_max(start, end);
+}
+
+typedef struct {
+	int pos;
+	int64_t size; // Positive when the tensor block becomes alive, negative when it is dead.
+} ccv_nnc_tensor_live_event_t;
+
+#define less_than(e1, e2, aux) ((e1).pos < (e2).pos || ((e1).pos == (e2).pos && (e1).size < (e2).size))
+static CCV_IMPLEMENT_QSORT(_ccv_nnc_tensor_live_event_sort_by_pos, ccv_nnc_tensor_live_event_t, less_than)
+#undef less_than
+
+static int _ccv_nnc_tensor_block_itf_has(const ccv_array_t* const itf, const int x)
+{
+	if (!itf)
+		return 0;
+	// The interference lists are pushed in ascending order, binary search it.
+	int low = 0, high = itf->rnum - 1;
+	while (low <= high)
+	{
+		const int mid = (low + high) / 2;
+		const int y = *(int*)ccv_array_get(itf, mid);
+		if (y == x)
+			return 1;
+		if (y < x)
+			low = mid + 1;
+		else
+			high = mid - 1;
+	}
+	return 0;
+}
+
+// Whether two primary tensor blocks (with their companions) interfere.
+static int _ccv_nnc_tensor_block_companions_interfere(const ccv_nnc_tensor_block_t* const tensor_blocks, ccv_array_t* const* const itf, const int a, const int b)
+{
+	const int as[2] = { a, tensor_blocks[a].companion_ref - 1 };
+	const int bs[2] = { b, tensor_blocks[b].companion_ref - 1 };
+	int i, j;
+	for (i = 0; i < 2; i++)
+		for (j = 0; j < 2; j++)
+			if (as[i] >= 0 && bs[j] >= 0 && _ccv_nnc_tensor_block_itf_has(itf[as[i]], bs[j]))
+				return 1;
+	return 0;
+}
+
+// The number of the biggest tensor blocks to start a clique from.
+#define CCV_NNC_LOWER_BOUND_CLIQUE_SEEDS (16)
+
+// Tensor blocks that pairwise interfere cannot share memory, thus, the total size of any such clique is a lower bound of
+// the memory needed for any planner. Two kinds of cliques are checked: the tensor blocks alive at the same position of
+// the topological order (they cannot be ordered by the exec dependencies), and the ones greedily grown from the biggest
+// tensor blocks with the interference lists (itf, one per tensor block, in ascending order). Companions share the
+// allocation of the bigger one. If type is 0, sums up the lower bounds of all types.
+static uint64_t _ccv_nnc_tensor_blocks_size_lower_bound(const int* const exec_pos, const int exec_size, const int pos_size, const ccv_nnc_tensor_block_t* const tensor_blocks, const int tensor_block_size, ccv_array_t* const* const itf, const int type)
+{
+	int i, j, k;
+	if (!type)
+	{
+		// Each type is allocated separately, go through them one by one.
+		uint64_t lower_bound = 0;
+		ccv_array_t* const types = ccv_array_new(sizeof(int), 0, 0);
+		for (i = 0; i < tensor_block_size; i++)
+			if (TENSOR_EXPECT_COMPUTABLE(tensor_blocks[i]))
+				ccv_array_add_unique_int(types, tensor_blocks[i].type);
+		for (i = 0; i < types->rnum; i++)
+			lower_bound += _ccv_nnc_tensor_blocks_size_lower_bound(exec_pos, exec_size, pos_size, tensor_blocks, tensor_block_size, itf, *(int*)ccv_array_get(types, i));
+		ccv_array_free(types);
+		return lower_bound;
+	}
+	ccv_nnc_tensor_opt_t* const opts = (ccv_nnc_tensor_opt_t*)ccmalloc(sizeof(ccv_nnc_tensor_opt_t) * tensor_block_size + sizeof(ccv_nnc_tensor_live_event_t) * tensor_block_size * 4 + sizeof(int) * tensor_block_size);
+	ccv_nnc_tensor_live_event_t* const events = (ccv_nnc_tensor_live_event_t*)(opts + tensor_block_size);
+	int* const clique = (int*)(events + tensor_block_size * 4);
+	int opt_size = 0, event_size = 0;
+	for (i = 0; i < tensor_block_size; i++)
+		if (TENSOR_EXPECT_COMPUTABLE(tensor_blocks[i]) && IS_PRIMARY_COMPANION(i, tensor_blocks[i]) && tensor_blocks[i].type == type)
+		{
+			int start, end;
+			_ccv_nnc_tensor_block_live_range(exec_pos, exec_size, pos_size, tensor_blocks + i, &start, &end);
+			uint64_t size = tensor_blocks[i].size;
+			if (tensor_blocks[i].companion_ref)
+			{
+				const int companion_ref = tensor_blocks[i].companion_ref - 1;
+				int companion_start, companion_end;
+				_ccv_nnc_tensor_block_live_range(exec_pos, exec_size, pos_size, tensor_blocks + companion_ref, &companion_start, &companion_end);
+				size = ccv_max(size, tensor_blocks[companion_ref].size);
+				if (companion_start > end + 1 || start > companion_end + 1)
+				{
+					events[event_size].pos = companion_start;
+					events[event_size].size = (int64_t)size;
+					events[event_size + 1].pos = companion_end + 1;
+					events[event_size + 1].size = -(int64_t)size;
+					event_size += 2;
+				} else
+					start = ccv_min(start, companion_start), end = ccv_max(end, companion_end);
+			}
+			events[event_size].pos = start;
+			events[event_size].size = (int64_t)size;
+			events[event_size + 1].pos = end + 1;
+			events[event_size + 1].size = -(int64_t)size;
+			event_size += 2;
+			opts[opt_size].index = i;
+			opts[opt_size].size = size;
+			opts[opt_size].oc = 0;
+			opts[opt_size].type = type;
+			++opt_size;
+		}
+	_ccv_nnc_tensor_live_event_sort_by_pos(events, event_size, 0);
+	int64_t live = 0, peak = 0;
+	for (i = 0; i < event_size; i++)
+	{
+		live += events[i].size;
+		peak = ccv_max(peak, live);
+	}
+	uint64_t lower_bound = peak;
+	if (itf)
+	{
+		_ccv_nnc_tensor_opt_sort_by_size_and_oc(opts, opt_size, 0);
+		for (i = 0; i < ccv_min(opt_size, CCV_NNC_LOWER_BOUND_CLIQUE_SEEDS); i++)
+		{
+			int clique_size = 1;
+			clique[0] = opts[i].index;
+			uint64_t clique_total = opts[i].size;
+			for (j = 0; j < opt_size; j++)
+				if (j != i)
+				{
+					for (k = 0; k < clique_size; k++)
+						if (!_ccv_nnc_tensor_block_companions_interfere(tensor_blocks, itf, opts[j].index, clique[k]))
+							break;
+					if (k == clique_size)
+						clique[clique_size++] = opts[j].index, clique_total += opts[j].size;
+				}
+			lower_bound = ccv_max(lower_bound, clique_total);
+		}
+	}
+	ccfree(opts);
+	return lower_bound;
+}
+
+// Lay out the alloc_prep from the assignments, assigned starts at 1 and is the buffer the tensor block goes to.
+static ccv_nnc_tensor_alloc_prep_t* _ccv_nnc_tensor_alloc_prep_from_assignment(const ccv_nnc_tensor_block_t* const tensor_blocks, const int tensor_block_size, const int available_tensor_size, ccv_array_t** const alloc_dep, const int* const assigned, const uint64_t* const allocated_offset, const uint64_t* const allocated_size, const int num_assigned)
+{
+	int i, j;
+	ccv_nnc_tensor_alloc_prep_t* alloc_prep = (ccv_nnc_tensor_alloc_prep_t*)ccmalloc(sizeof(ccv_nnc_tensor_alloc_prep_t) + sizeof(alloc_prep->blocks[0]) * available_tensor_size + sizeof(alloc_prep->buffers[0]) * num_assigned + sizeof(int) * tensor_block_size);
+	alloc_prep->alloc_dep = alloc_dep;
+	alloc_prep->vt_block_size = tensor_block_size;
+	alloc_prep->buffer_size = num_assigned;
+	alloc_prep->block_size = available_tensor_size;
+	alloc_prep->size_lower_bound = 0;
+	alloc_prep->blocks = (void*)(alloc_prep + 1); // From the biggest structs to smaller ones.
+	alloc_prep->buffers = (void*)(alloc_prep->blocks + available_tensor_size);
+	alloc_prep->vt_blocks = (int*)(alloc_prep->buffers + num_assigned);
+	memset(alloc_prep->buffers, 0, sizeof(alloc_prep->buffers[0]) * num_assigned);
+	for (i = 0; i < num_assigned; i++)
+		alloc_prep->buffers[i].size = allocated_size[i];
+	j = 0;
+	// Assigning out the tensors (in case of sharing tensors / in-place ops).
+	for (i = 0; i < tensor_block_size; i++)
+		if (!TENSOR_EXPECT_UNASSIGNED(tensor_blocks[i]))
+		{
+			alloc_prep->blocks[j].block_ref = i;
+			if (!TENSOR_EXPECT_ALIAS(tensor_blocks[i]))
+			{
+				alloc_prep->vt_blocks[i] = j;
+				// Also, set its allocations.
+				assert(assigned[i] > 0);
+				const int buffer_ref = alloc_prep->blocks[j].buffer_ref = assigned[i] - 1;
+				alloc_prep->blocks[j].offset = allocated_offset[i];
+				if (!alloc_prep->buffers[buffer_ref].type)
+					alloc_prep->buffers[buffer_ref].type = tensor_blocks[i].type;
+				alloc_prep->buffers[buffer_ref].pin_mem = alloc_prep->buffers[buffer_ref].pin_mem || tensor_blocks[i].pin_mem;
+				alloc_prep->buffers[buffer_ref].flags |= TENSOR_READ_WRITE(tensor_blocks[i]);
+				assert(allocated_offset[i] + tensor_blocks[i].size <= alloc_prep->buffers[buffer_ref].size);
+			} else {
+				alloc_prep->vt_blocks[i] = -1;
+				alloc_prep->blocks[j].buffer_ref = -1;
+				alloc_prep->blocks[j].offset = 0;
+			}
+			++j;
+		} else
+			alloc_prep->vt_blocks[i] = -1;
+	return alloc_prep;
+}
+
+static ccv_nnc_tensor_alloc_prep_t* _ccv_nnc_tensor_alloc_prep_new(const ccv_sparse_matrix_t* const exec_dep, const int* const exec_pos, const int exec_size, const int pos_size, const ccv_nnc_tensor_block_t* const tensor_blocks, const int tensor_block_size)
 {
 	// Compute how many dis-continuous buffers are needed.
 	// We prefer to have several dis-continuous buffers instead of one big buffer because
@@ -535,48 +763,19 @@ static ccv_nnc_tensor_alloc_prep_t* _ccv_nnc_tensor_alloc_prep_new(const ccv_spa
 	CCV_SPARSE_FOREACH(alloc, for_block);
 #undef for_block
 	ccv_matrix_free(alloc);
+	// Reuse the interference lists for the lower bound.
+	ccv_array_t** const itf = (ccv_array_t**)ccmalloc(sizeof(ccv_array_t*) * tensor_block_size);
+	for (i = 0; i < tensor_block_size; i++)
+		itf[i] = adj[i].itf;
+	const uint64_t size_lower_bound = _ccv_nnc_tensor_blocks_size_lower_bound(exec_pos, exec_size, pos_size, tensor_blocks, tensor_block_size, itf, 0);
+	ccfree(itf);
 	for (i = 0; i < tensor_block_size; i++)
 		if (adj[i].itf)
 			ccv_array_free(adj[i].itf);
 	ccfree(adj);
-	ccv_nnc_tensor_alloc_prep_t* alloc_prep = (ccv_nnc_tensor_alloc_prep_t*)ccmalloc(sizeof(ccv_nnc_tensor_alloc_prep_t) + sizeof(alloc_prep->blocks[0]) * available_tensor_size + sizeof(alloc_prep->buffers[0]) * num_assigned + sizeof(int) * tensor_block_size);
-	alloc_prep->alloc_dep = alloc_dep;
-	alloc_prep->vt_block_size = tensor_block_size;
-	alloc_prep->buffer_size = num_assigned;
-	alloc_prep->block_size = available_tensor_size;
-	alloc_prep->blocks = (void*)(alloc_prep + 1); // From the biggest structs to smaller ones.
-	alloc_prep->buffers = (void*)(alloc_prep->blocks + available_tensor_size);
-	alloc_prep->vt_blocks = (int*)(alloc_prep->buffers + num_assigned);
-	memset(alloc_prep->buffers, 0, sizeof(alloc_prep->buffers[0]) * num_assigned);
-	for (i = 0; i < num_assigned; i++)
-		alloc_prep->buffers[i].size = allocated_size[i];
+	ccv_nnc_tensor_alloc_prep_t* const alloc_prep = _ccv_nnc_tensor_alloc_prep_from_assignment(tensor_blocks, tensor_block_size, available_tensor_size, alloc_dep, assigned, allocated_offset, allocated_size, num_assigned);
+	alloc_prep->size_lower_bound = size_lower_bound;
 	ccfree(allocated_size);
-	j = 0;
-	// Assigning out the tensors (in case of sharing tensors / in-place ops).
-	for (i = 0; i < tensor_block_size; i++)
-		if (!TENSOR_EXPECT_UNASSIGNED(tensor_blocks[i]))
-		{
-			alloc_prep->blocks[j].block_ref = i;
-			if (!TENSOR_EXPECT_ALIAS(tensor_blocks[i]))
-			{
-				alloc_prep->vt_blocks[i] = j;
-				// Also, set its allocations.
-				assert(assigned[i] > 0);
-				const int buffer_ref = alloc_prep->blocks[j].buffer_ref = assigned[i] - 1;
-				alloc_prep->blocks[j].offset = allocated_offset[i];
-				if (!alloc_prep->buffers[buffer_ref].type)
-					alloc_prep->buffers[buffer_ref].type = tensor_blocks[i].type;
-				alloc_prep->buffers[buffer_ref].pin_mem = alloc_prep->buffers[buffer_ref].pin_mem || tensor_blocks[i].pin_mem;
-				alloc_prep->buffers[buffer_ref].flags |= TENSOR_READ_WRITE(tensor_blocks[i]);
-				assert(allocated_offset[i] + tensor_blocks[i].size <= alloc_prep->buffers[buffer_ref].size);
-			} else {
-				alloc_prep->vt_blocks[i] = -1;
-				alloc_prep->blocks[j].buffer_ref = -1;
-				alloc_prep->blocks[j].offset = 0;
-			}
-			++j;
-		} else
-			alloc_prep->vt_blocks[i] = -1;
 	ccfree(allocated_offset);
 	ccfree(assigned);
 	return alloc_prep;
@@ -595,6 +794,365 @@ static void _ccv_nnc_tensor_alloc_prep_free(ccv_nnc_tensor_alloc_prep_t* alloc_p
 	ccfree(alloc_prep);
 }
 
+// MARK - Packing Memory Planner
+
+// The default number of placements the exact search can try.
+#define CCV_NNC_MEMORY_PLANNER_SEARCH_LIMIT (100000)
+
+typedef struct {
+	int index; // The primary tensor block.
+	int companion; // The companion tensor block, -1 if there is none. It shares the offset with the primary one.
+	int type;
+	int start; // The live range in the topological order, for the ordering heuristics.
+	int end;
+	uint64_t size;
+	ccv_array_t* itf; // The items of the same type that interfere with this one.
+} ccv_nnc_tensor_pack_item_t;
+
+typedef struct {
+	uint64_t start;
+	uint64_t end;
+} ccv_nnc_tensor_pack_range_t;
+
+#define less_than(r1, r2, aux) ((r1).start < (r2).start)
+static CCV_IMPLEMENT_QSORT(_ccv_nnc_tensor_pack_range_sort_by_start, ccv_nnc_tensor_pack_range_t, less_than)
+#undef less_than
+
+typedef struct {
+	int id;
+	uint64_t key[2];
+} ccv_nnc_tensor_pack_order_t;
+
+#define more_than(o1, o2, aux) ((o1).key[0] > (o2).key[0] || ((o1).key[0] == (o2).key[0] && ((o1).key[1] > (o2).key[1] || ((o1).key[1] == (o2).key[1] && (o1).id < (o2).id))))
+static CCV_IMPLEMENT_QSORT(_ccv_nnc_tensor_pack_order_sort_by_key, ccv_nnc_tensor_pack_order_t, more_than)
+#undef more_than
+
+// Find the offset for item u such that it doesn't overlap any placed item it interferes with. Without best fit, this is
+// the lowest such offset. With best fit, this is the start of the tightest gap it fits, the space between the last
+// placed item and the top of the buffer counts as a gap as well.
+static uint64_t _ccv_nnc_tensor_pack_offset(const ccv_nnc_tensor_pack_item_t* const items, const int u, const uint64_t* const offsets, const uint8_t* const placed, const int best_fit, const uint64_t top, ccv_nnc_tensor_pack_range_t* const ranges)
+{
+	int i, range_size = 0;
+	const ccv_array_t* const itf = items[u].itf;
+	for (i = 0; itf && i < itf->rnum; i++)
+	{
+		const int v = *(int*)ccv_array_get(itf, i);
+		if (placed[v])
+		{
+			ranges[range_size].start = offsets[v];
+			ranges[range_size].end = offsets[v] + items[v].size;
+			++range_size;
+		}
+	}
+	_ccv_nnc_tensor_pack_range_sort_by_start(ranges, range_size, 0);
+	const uint64_t size = items[u].size;
+	uint64_t offset = 0, best_offset = 0, best_gap = 0;
+	int found = 0;
+	for (i = 0; i < range_size; i++)
+	{
+		if (ranges[i].start >= offset + size)
+		{
+			if (!best_fit)
+				return offset;
+			const uint64_t gap = ranges[i].start - offset;
+			if (!found || gap < best_gap)
+				best_offset = offset, best_gap = gap, found = 1;
+		}
+		offset = ccv_max(offset, ranges[i].end);
+	}
+	if (!best_fit || (top >= offset + size && (!found || top - offset < best_gap)))
+		return offset;
+	return found ? best_offset : offset;
+}
+
+// Order the items with one of the heuristics.
+static void _ccv_nnc_tensor_pack_order(const ccv_nnc_tensor_pack_item_t* const items, const int* const ids, const int id_size, const int heuristic, const int pos_size, ccv_nnc_tensor_pack_order_t* const orders)
+{
+	int i;
+	for (i = 0; i < id_size; i++)
+	{
+		const ccv_nnc_tensor_pack_item_t* const item = items + ids[i];
+		const uint64_t lifetime = item->end - item->start + 1;
+		orders[i].id = ids[i];
+		switch (heuristic)
+		{
+			case 0: // The biggest first.
+				orders[i].key[0] = item->size;
+				orders[i].key[1] = lifetime;
+				break;
+			case 1: // The one occupies the most memory over time first.
+				orders[i].key[0] = item->size * lifetime;
+				orders[i].key[1] = item->size;
+				break;
+			case 2: // The most constrained first.
+				orders[i].key[0] = item->itf ? item->itf->rnum : 0;
+				orders[i].key[1] = item->size;
+				break;
+			default: // The earliest first, as the linear scan does.
+				orders[i].key[0] = pos_size - item->start;
+				orders[i].key[1] = item->size;
+				break;
+		}
+	}
+	_ccv_nnc_tensor_pack_order_sort_by_key(orders, id_size, 0);
+}
+
+typedef struct {
+	const ccv_nnc_tensor_pack_item_t* items;
+	const int* ids; // The items to place, in the order to branch on.
+	int id_size;
+	uint64_t* offsets;
+	uint8_t* placed;
+	ccv_nnc_tensor_pack_range_t* ranges;
+	uint64_t* best_offsets;
+	uint64_t best;
+	uint64_t lower_bound;
+	int budget;
+} ccv_nnc_tensor_pack_search_t;
+
+// Branch and bound on which item to place next, at its lowest offset. Any packing can have its items moved down to the
+// lowest offsets one by one in the order of their offsets without growing, thus, only the orders with non-decreasing
+// offsets need to be searched (ties are broken by the id, items at the same offset don't interfere).
+static void _ccv_nnc_tensor_pack_search(ccv_nnc_tensor_pack_search_t* const search, const int depth, const uint64_t top, const uint64_t last_offset, const int last_id)
+{
+	int i;
+	const int* const ids = search->ids;
+	if (depth == search->id_size)
+	{
+		search->best = top;
+		for (i = 0; i < search->id_size; i++)
+			search->best_offsets[ids[i]] = search->offsets[ids[i]];
+		return;
+	}
+	const ccv_nnc_tensor_pack_item_t* const items = search->items;
+	// Placing more items can only push the lowest offset up, if any item cannot fit under the best already, give up.
+	for (i = 0; i < search->id_size; i++)
+		if (!search->placed[ids[i]] && _ccv_nnc_tensor_pack_offset(items, ids[i], search->offsets, search->placed, 0, 0, search->ranges) + items[ids[i]].size >= search->best)
+			return;
+	search->budget -= search->id_size - depth;
+	for (i = 0; i < search->id_size && search->budget > 0 && search->best > search->lower_bound; i++)
+	{
+		const int u = ids[i];
+		if (search->placed[u])
+			continue;
+		const uint64_t offset = _ccv_nnc_tensor_pack_offset(items, u, search->offsets, search->placed, 0, 0, search->ranges);
+		if (offset < last_offset || (offset == last_offset && u < last_id))
+			continue;
+		if (offset + items[u].size >= search->best)
+			continue;
+		search->offsets[u] = offset;
+		search->placed[u] = 1;
+		_ccv_nnc_tensor_pack_search(search, depth + 1, ccv_max(top, offset + items[u].size), offset, u);
+		search->placed[u] = 0;
+	}
+}
+
+// Instead of assigning tensor blocks to a few buffers, pack them into one buffer per type. This is the offset packing
+// problem (dynamic storage allocation). Start from the greedy planner's result (as if its buffers of one type are laid
+// out back to back), try best fit with a few orderings, and then search exactly from the best of them within the limit.
+static ccv_nnc_tensor_alloc_prep_t* _ccv_nnc_tensor_alloc_prep_pack_new(const ccv_sparse_matrix_t* const exec_dep, const int* const exec_pos, const int exec_size, const int pos_size, const ccv_nnc_tensor_block_t* const tensor_blocks, const int tensor_block_size, const int search_limit)
+{
+	int i, j, k;
+	int available_tensor_size = 0, item_size = 0;
+	for (i = 0; i < tensor_block_size; i++)
+		if (!TENSOR_EXPECT_UNASSIGNED(tensor_blocks[i]))
+		{
+			++available_tensor_size;
+			if (!TENSOR_EXPECT_ALIAS(tensor_blocks[i]) && IS_PRIMARY_COMPANION(i, tensor_blocks[i]))
+				++item_size;
+		}
+	ccv_nnc_tensor_alloc_prep_t* const greedy_alloc_prep = _ccv_nnc_tensor_alloc_prep_new(exec_dep, exec_pos, exec_size, pos_size, tensor_blocks, tensor_block_size);
+	// The interference between tensor blocks of the same type, in ascending order.
+	ccv_array_t** const itf = (ccv_array_t**)cccalloc(tensor_block_size, sizeof(ccv_array_t*));
+	for (i = 0; i < tensor_block_size; i++)
+		if (TENSOR_EXPECT_COMPUTABLE(tensor_blocks[i]))
+			for (j = i + 1; j < tensor_block_size; j++)
+				if (TENSOR_EXPECT_COMPUTABLE(tensor_blocks[j]) && tensor_blocks[i].type == tensor_blocks[j].type &&
+					!_ccv_nnc_tensor_block_head_after_tail(exec_dep, tensor_blocks[i], tensor_blocks[j]) &&
+					!_ccv_nnc_tensor_block_head_after_tail(exec_dep, tensor_blocks[j], tensor_blocks[i]))
+				{
+					if (!itf[i])
+						itf[i] = ccv_array_new(sizeof(int), 1, 0);
+					ccv_array_push(itf[i], &j);
+					if (!itf[j])
+						itf[j] = ccv_array_new(sizeof(int), 1, 0);
+					ccv_array_push(itf[j], &i);
+				}
+	ccv_nnc_tensor_pack_item_t* const items = (ccv_nnc_tensor_pack_item_t*)cccalloc(item_size, sizeof(ccv_nnc_tensor_pack_item_t));
+	int* const item_ref = (int*)ccmalloc(sizeof(int) * (tensor_block_size + item_size));
+	int* const marks = item_ref + tensor_block_size;
+	for (i = 0; i < tensor_block_size; i++)
+		item_ref[i] = -1;
+	for (i = 0, j = 0; i < tensor_block_size; i++)
+		if (TENSOR_EXPECT_COMPUTABLE(tensor_blocks[i]) && IS_PRIMARY_COMPANION(i, tensor_blocks[i]))
+		{
+			items[j].index = i;
+			items[j].companion = tensor_blocks[i].companion_ref - 1;
+			items[j].type = tensor_blocks[i].type;
+			items[j].size = tensor_blocks[i].size;
+			_ccv_nnc_tensor_block_live_range(exec_pos, exec_size, pos_size, tensor_blocks + i, &items[j].start, &items[j].end);
+			item_ref[i] = j;
+			if (items[j].companion >= 0)
+			{
+				const int companion = items[j].companion;
+				assert(tensor_blocks[companion].type == items[j].type);
+				int start, end;
+				_ccv_nnc_tensor_block_live_range(exec_pos, exec_size, pos_size, tensor_blocks + companion, &start, &end);
+				items[j].start = ccv_min(items[j].start, start);
+				items[j].end = ccv_max(items[j].end, end);
+				items[j].size = ccv_max(items[j].size, tensor_blocks[companion].size);
+				item_ref[companion] = j;
+			}
+			marks[j] = -1;
+			++j;
+		}
+	assert(j == item_size);
+	// Two items interfere if any of their tensor blocks interfere.
+	for (i = 0; i < item_size; i++)
+	{
+		const int members[2] = { items[i].index, items[i].companion };
+		for (j = 0; j < 2; j++)
+			for (k = 0; members[j] >= 0 && itf[members[j]] && k < itf[members[j]]->rnum; k++)
+			{
+				const int v = item_ref[*(int*)ccv_array_get(itf[members[j]], k)];
+				if (v < 0 || v == i || marks[v] == i)
+					continue;
+				marks[v] = i;
+				if (!items[i].itf)
+					items[i].itf = ccv_array_new(sizeof(int), 1, 0);
+				ccv_array_push(items[i].itf, &v);
+			}
+	}
+	uint64_t* const offsets = (uint64_t*)cccalloc(item_size * 2 + greedy_alloc_prep->buffer_size, sizeof(uint64_t));
+	uint64_t* const best_offsets = offsets + item_size;
+	uint64_t* const greedy_bases = best_offsets + item_size;
+	uint8_t* const placed = (uint8_t*)cccalloc(item_size, sizeof(uint8_t));
+	ccv_nnc_tensor_pack_range_t* const ranges = (ccv_nnc_tensor_pack_range_t*)ccmalloc(sizeof(ccv_nnc_tensor_pack_range_t) * item_size);
+	ccv_nnc_tensor_pack_order_t* const orders = (ccv_nnc_tensor_pack_order_t*)ccmalloc(sizeof(ccv_nnc_tensor_pack_order_t) * item_size);
+	int* const ids = (int*)ccmalloc(sizeof(int) * item_size);
+	int* const assigned = (int*)cccalloc(tensor_block_size, sizeof(int));
+	uint64_t* const allocated_offset = (uint64_t*)cccalloc(tensor_block_size, sizeof(uint64_t));
+	uint64_t* const allocated_size = (uint64_t*)cccalloc(item_size, sizeof(uint64_t));
+	int num_assigned = 0;
+	uint64_t size_lower_bound = 0;
+	// Deal with one type at a time, each type gets its own buffer.
+	for (i = 0; i < item_size; i++)
+	{
+		if (assigned[items[i].index])
+			continue;
+		const int type = items[i].type;
+		int id_size = 0;
+		for (j = i; j < item_size; j++)
+			if (items[j].type == type)
+				ids[id_size++] = j;
+		// The greedy planner's buffers of this type, back to back.
+		uint64_t best = 0;
+		for (j = 0; j < greedy_alloc_prep->buffer_size; j++)
+			if (greedy_alloc_prep->buffers[j].type == type)
+				greedy_bases[j] = best, best += greedy_alloc_prep->buffers[j].size;
+		for (j = 0; j < id_size; j++)
+		{
+			const int block = greedy_alloc_prep->vt_blocks[items[ids[j]].index];
+			assert(block >= 0);
+			best_offsets[ids[j]] = greedy_bases[greedy_alloc_prep->blocks[block].buffer_ref] + greedy_alloc_prep->blocks[block].offset;
+		}
+		const uint64_t greedy_size = best;
+		for (k = 0; k < 4; k++)
+		{
+			_ccv_nnc_tensor_pack_order(items, ids, id_size, k, pos_size, orders);
+			for (j = 0; j < id_size; j++)
+				placed[ids[j]] = 0;
+			uint64_t top = 0;
+			for (j = 0; j < id_size; j++)
+			{
+				const int u = orders[j].id;
+				offsets[u] = _ccv_nnc_tensor_pack_offset(items, u, offsets, placed, 1, top, ranges);
+				placed[u] = 1;
+				top = ccv_max(top, offsets[u] + items[u].size);
+			}
+			if (top < best)
+			{
+				best = top;
+				for (j = 0; j < id_size; j++)
+					best_offsets[ids[j]] = offsets[ids[j]];
+			}
+		}
+		const uint64_t lower_bound = _ccv_nnc_tensor_blocks_size_lower_bound(exec_pos, exec_size, pos_size, tensor_blocks, tensor_block_size, itf, type);
+		if (search_limit >= 0 && best > lower_bound)
+		{
+			// Branch on the biggest items first.
+			_ccv_nnc_tensor_pack_order(items, ids, id_size, 0, pos_size, orders);
+			for (j = 0; j < id_size; j++)
+				ids[j] = orders[j].id, placed[ids[j]] = 0;
+			ccv_nnc_tensor_pack_search_t search = {
+				.items = items,
+				.ids = ids,
+				.id_size = id_size,
+				.offsets = offsets,
+				.placed = placed,
+				.ranges = ranges,
+				.best_offsets = best_offsets,
+				.best = best,
+				.lower_bound = lower_bound,
+				.budget = search_limit > 0 ? search_limit : CCV_NNC_MEMORY_PLANNER_SEARCH_LIMIT,
+			};
+			_ccv_nnc_tensor_pack_search(&search, 0, 0, 0, -1);
+			best = search.best;
+		}
+		PRINT(CCV_CLI_VERBOSE, "Packed %d tensor blocks of type %d into %llu bytes (greedy %llu bytes), the lower bound is %llu bytes\n", id_size, type, (unsigned long long)best, (unsigned long long)greedy_size, (unsigned long long)lower_bound);
+		size_lower_bound += lower_bound;
+		allocated_size[num_assigned] = best;
+		++num_assigned;
+		for (j = 0; j < id_size; j++)
+		{
+			const ccv_nnc_tensor_pack_item_t* const item = items + ids[j];
+			assigned[item->index] = num_assigned;
+			allocated_offset[item->index] = best_offsets[ids[j]];
+			if (item->companion >= 0)
+			{
+				assigned[item->companion] = num_assigned;
+				allocated_offset[item->companion] = best_offsets[ids[j]];
+			}
+		}
+	}
+	_ccv_nnc_tensor_alloc_prep_free(greedy_alloc_prep);
+	// The allocation dependencies are the tensor blocks that occupied the same memory region earlier.
+	ccv_array_t** const alloc_dep = (ccv_array_t**)cccalloc(tensor_block_size, sizeof(ccv_array_t*));
+	for (i = 0; i < tensor_block_size; i++)
+		if (item_ref[i] >= 0 && tensor_blocks[i].size > 0)
+			for (j = 0; j < tensor_block_size; j++)
+				if (j != i && item_ref[j] >= 0 && tensor_blocks[j].size > 0 &&
+					assigned[i] == assigned[j] &&
+					allocated_offset[j] < allocated_offset[i] + tensor_blocks[i].size &&
+					allocated_offset[i] < allocated_offset[j] + tensor_blocks[j].size &&
+					_ccv_nnc_tensor_block_head_after_tail(exec_dep, tensor_blocks[i], tensor_blocks[j]) > 0)
+				{
+					if (!alloc_dep[i])
+						alloc_dep[i] = ccv_array_new(sizeof(int), 1, 0);
+					ccv_array_push(alloc_dep[i], &j);
+				}
+	ccv_nnc_tensor_alloc_prep_t* const alloc_prep = _ccv_nnc_tensor_alloc_prep_from_assignment(tensor_blocks, tensor_block_size, available_tensor_size, alloc_dep, assigned, allocated_offset, allocated_size, num_assigned);
+	alloc_prep->size_lower_bound = size_lower_bound;
+	for (i = 0; i < tensor_block_size; i++)
+		if (itf[i])
+			ccv_array_free(itf[i]);
+	ccfree(itf);
+	for (i = 0; i < item_size; i++)
+		if (items[i].itf)
+			ccv_array_free(items[i].itf);
+	ccfree(items);
+	ccfree(item_ref);
+	ccfree(offsets);
+	ccfree(placed);
+	ccfree(ranges);
+	ccfree(orders);
+	ccfree(ids);
+	ccfree(assigned);
+	ccfree(allocated_offset);
+	ccfree(allocated_size);
+	return alloc_prep;
+}
+
 // Simple allocator from ccv_array_t.
 static int _ccv_nnc_tensor_metadata_pos_new(ccv_array_t* const tensor_metadata, const size_t size)
 {
@@ -1033,8 +1591,10 @@ static ccv_nnc_tensor_arena_t* _ccv_nnc_tensor_arena_new(ccv_nnc_symbolic_graph_
 	tensor_arena->vt_alias_r_refs = 0;
 	tensor_arena->vt_sizes = 0;
 	tensor_arena->sub_arena_size = graph_prep->sub_prep_size;
+	tensor_arena->size_lower_bound = alloc_prep->size_lower_bound;
 	tensor_arena->tensor_metadata = ccv_array_new(16 /* align to 16 bytes */, 0, 0);
 	tensor_arena->m_tensor_idx = ccv_array_new(sizeof(int), 0, 0);
+	tensor_arena->constants = 0;
 	tensor_arena->allocator.context.free = allocator.context.free;
 	tensor_arena->allocator.isa = allocator.isa;
 	// Copy alias_ref info back to the tensor arena.
@@ -2932,7 +3492,7 @@ static ccv_array_t* _ccv_nnc_dup_breakpoints_with_p_node_inputs(ccv_nnc_symbolic
 }
 
 // Plan out how we allocate tensor (should I do optimizations on graph here or not at all?).
-static ccv_nnc_symbolic_graph_prep_t* _ccv_nnc_symbolic_graph_prep_new(const ccv_nnc_symbolic_graph_t* const symbolic_graph, const ccv_nnc_tensor_bind_t* const tensor_binds, const int tensor_bind_size, const ccv_nnc_tensor_symbol_t* const outputs, const int output_size, const ccv_nnc_graph_exec_symbol_t* const sources, const int source_size, const ccv_nnc_graph_exec_symbol_t* const destinations, const int destination_size, const ccv_nnc_tensor_symbol_info_t* const p_tensor_symbol_info, const int p_tensor_symbol_info_size, const ccv_nnc_graph_exec_symbol_info_t* const p_exec_symbol_info, const int p_exec_symbol_info_size)
+static ccv_nnc_symbolic_graph_prep_t* _ccv_nnc_symbolic_graph_prep_new(const ccv_nnc_symbolic_graph_t* const symbolic_graph, const ccv_nnc_tensor_bind_t* const tensor_binds, const int tensor_bind_size, const ccv_nnc_tensor_symbol_t* const outputs, const int output_size, const ccv_nnc_graph_exec_symbol_t* const sources, const int source_size, const ccv_nnc_graph_exec_symbol_t* const destinations, const int destination_size, const ccv_nnc_tensor_symbol_info_t* const p_tensor_symbol_info, const int p_tensor_symbol_info_size, const ccv_nnc_graph_exec_symbol_info_t* const p_exec_symbol_info, const int p_exec_symbol_info_size, const ccv_nnc_memory_planner_t memory_planner)
 {
 	assert(source_size > 0);
 	assert(destination_size > 0);
@@ -3011,7 +3571,7 @@ static ccv_nnc_symbolic_graph_prep_t* _ccv_nnc_symbolic_graph_prep_new(const ccv
 			assert(symbolic_graph->sub_graphs);
 			ccv_nnc_symbolic_graph_t* const sub_graph = *(ccv_nnc_symbolic_graph_t**)ccv_array_get(symbolic_graph->sub_graphs, CCV_NNC_GRAPH_REF(node)[p] - 1);
 			ccv_array_t* const dup_breakpoints = _ccv_nnc_dup_breakpoints_with_p_node_inputs(sub_graph, node);
-			ccv_nnc_symbolic_graph_prep_t* const sub_prep = _ccv_nnc_symbolic_graph_prep_new(sub_graph, tensor_binds, tensor_bind_size, 0, 0, (ccv_nnc_graph_exec_symbol_t*)ccv_array_get(sub_graph->sources, 0), sub_graph->sources->rnum, (ccv_nnc_graph_exec_symbol_t*)ccv_array_get(sub_graph->destinations, 0), sub_graph->destinations->rnum, tensor_symbol_info, symbolic_graph->tensor_symbol_info->rnum, exec_symbol_info, symbolic_graph->exec_symbol_info->rnum);
+			ccv_nnc_symbolic_graph_prep_t* const sub_prep = _ccv_nnc_symbolic_graph_prep_new(sub_graph, tensor_binds, tensor_bind_size, 0, 0, (ccv_nnc_graph_exec_symbol_t*)ccv_array_get(sub_graph->sources, 0), sub_graph->sources->rnum, (ccv_nnc_graph_exec_symbol_t*)ccv_array_get(sub_graph->destinations, 0), sub_graph->destinations->rnum, tensor_symbol_info, symbolic_graph->tensor_symbol_info->rnum, exec_symbol_info, symbolic_graph->exec_symbol_info->rnum, memory_planner);
 			sub_prep->dup_breakpoints = dup_breakpoints;
 			sub_prep->p = prep;
 			sub_preps[CCV_NNC_GRAPH_REF(node)[p] - 1] = sub_prep;
@@ -3394,7 +3954,15 @@ static ccv_nnc_symbolic_graph_prep_t* _ccv_nnc_symbolic_graph_prep_new(const ccv
 	ccfree(tensor_fold);
 	// It is time to guess what's the best tensor placement and create the opaque tensor arena. The alloc_dep will return
 	// the allocation dependencies, thus, which tensor is reused to the existing tensor.
-	ccv_nnc_tensor_alloc_prep_t* alloc_prep = _ccv_nnc_tensor_alloc_prep_new(exec_dep, tensor_blocks, tensor_block_size);
+	int* const exec_pos = (int*)ccmalloc(sizeof(int) * symbolic_graph->exec_symbol_info->rnum);
+	const int pos_size = _ccv_nnc_exec_pos_from_visit(visit, exec_symbol_info, symbolic_graph->exec_symbol_info->rnum, exec_pos);
+	ccv_nnc_tensor_alloc_prep_t* alloc_prep;
+	// The buffers of sub-graphs are laid out together with the parent graph's, only pack a flat graph.
+	if (memory_planner.type == CCV_NNC_MEMORY_PLANNER_PACKING && !p_exec_symbol_info && !sub_preps)
+		alloc_prep = _ccv_nnc_tensor_alloc_prep_pack_new(exec_dep, exec_pos, symbolic_graph->exec_symbol_info->rnum, pos_size, tensor_blocks, tensor_block_size, memory_planner.search_limit);
+	else
+		alloc_prep = _ccv_nnc_tensor_alloc_prep_new(exec_dep, exec_pos, symbolic_graph->exec_symbol_info->rnum, pos_size, tensor_blocks, tensor_block_size);
+	ccfree(exec_pos);
 	ccv_matrix_free(exec_dep);
 	prep->while_count_tensor = 0;
 	prep->dup_breakpoints = 0;
@@ -3824,21 +4392,61 @@ static void _ccv_nnc_symbolic_graph_prep_dup_breakpoints_free(ccv_nnc_symbolic_g
 
 const ccv_nnc_symbolic_graph_compile_param_t ccv_nnc_default_compile_params = {};
 
-void ccv_nnc_symbolic_graph_compile(const ccv_nnc_symbolic_graph_t* const symbolic_graph, const ccv_nnc_symbolic_graph_compile_param_t compile_params, const ccv_nnc_tensor_bind_t* const tensor_binds, const int tensor_bind_size, const ccv_nnc_tensor_symbol_t* const outputs, const int output_size, const ccv_nnc_graph_exec_symbol_t* const sources, const int source_size, const ccv_nnc_graph_exec_symbol_t* const destinations, const int destination_size, ccv_nnc_graph_t** const graph_ref, ccv_nnc_tensor_arena_t** const tensor_arena_ref, ccv_nnc_graph_exec_arena_t** const graph_exec_arena_ref)
+static ccv_nnc_tensor_bind_t* _ccv_nnc_tensor_binds_with_constants(const ccv_nnc_symbolic_graph_t* const symbolic_graph, const ccv_nnc_tensor_bind_t* const tensor_binds, const int tensor_bind_size, int* const bind_size_ref)
 {
-	assert(graph_ref);
-	assert(tensor_arena_ref);
-	assert(graph_exec_arena_ref);
-	int i;
-	// Cannot bind the multi-view.
-	for (i = 0; i < tensor_bind_size; i++)
+	int i, j;
+	int constant_size = 0;
+	const ccv_nnc_tensor_symbol_info_t* const tensor_symbol_info = (ccv_nnc_tensor_symbol_info_t*)ccv_array_get(symbolic_graph->tensor_symbol_info, 0);
+	for (i = 0; i < symbolic_graph->tensor_symbol_info->rnum; i++)
+		if (tensor_symbol_info[i].constant && !CCV_NNC_TENSOR_SYMBOL_IS_DEAD(tensor_symbol_info[i].flags))
+			++constant_size;
+	*bind_size_ref = tensor_bind_size;
+	if (!constant_size)
+		return (ccv_nnc_tensor_bind_t*)tensor_binds;
+	ccv_nnc_tensor_bind_t* const binds = (ccv_nnc_tensor_bind_t*)ccmalloc(sizeof(ccv_nnc_tensor_bind_t) * (tensor_bind_size + constant_size));
+	if (tensor_bind_size > 0)
+		memcpy(binds, tensor_binds, sizeof(ccv_nnc_tensor_bind_t) * tensor_bind_size);
+	int bind_size = tensor_bind_size;
+	for (i = 0; i < symbolic_graph->tensor_symbol_info->rnum; i++)
+		if (tensor_symbol_info[i].constant && !CCV_NNC_TENSOR_SYMBOL_IS_DEAD(tensor_symbol_info[i].flags))
+		{
+			// If it is bound explicitly, respect that.
+			for (j = 0; j < tensor_bind_size; j++)
+				if (tensor_binds[j].symbol.graph == symbolic_graph && tensor_binds[j].symbol.d == i)
+					break;
+			if (j < tensor_bind_size)
+				continue;
+			// Bind to a copy such that the symbolic graph can be freed before the concrete graph.
+			binds[bind_size].symbol = (ccv_nnc_tensor_symbol_t){
+				.d = i,
+				.graph = symbolic_graph,
+			};
+			binds[bind_size].tensor = ccv_nnc_tensor_constant_copy(tensor_symbol_info[i].info, tensor_symbol_info[i].constant);
+			++bind_size;
+		}
+	if (bind_size == tensor_bind_size)
 	{
-		assert(tensor_binds[i].tensor);
-		assert(!CCV_IS_TENSOR_MULTIVIEW(tensor_binds[i].tensor));
+		ccfree(binds);
+		return (ccv_nnc_tensor_bind_t*)tensor_binds;
 	}
-	ccv_nnc_symbolic_graph_prep_t* graph_prep = _ccv_nnc_symbolic_graph_prep_new(symbolic_graph, tensor_binds, tensor_bind_size, outputs, output_size, sources, source_size, destinations, destination_size, 0, 0, 0, 0);
+	*bind_size_ref = bind_size;
+	return binds;
+}
+
+static void _ccv_nnc_symbolic_graph_compile_with_prep(const ccv_nnc_symbolic_graph_t* const symbolic_graph, ccv_nnc_symbolic_graph_prep_t* const graph_prep, const ccv_nnc_symbolic_graph_compile_param_t compile_params, const ccv_nnc_tensor_bind_t* const tensor_binds, const int tensor_bind_size, ccv_nnc_tensor_bind_t* const all_binds, const int all_bind_size, const ccv_nnc_graph_exec_symbol_t* const sources, const int source_size, const ccv_nnc_graph_exec_symbol_t* const destinations, const int destination_size, ccv_nnc_graph_t** const graph_ref, ccv_nnc_tensor_arena_t** const tensor_arena_ref, ccv_nnc_graph_exec_arena_t** const graph_exec_arena_ref)
+{
+	int i;
 	_ccv_nnc_symbolic_graph_prep_while_count_tensor(graph_prep);
-	ccv_nnc_tensor_arena_t* tensor_arena = _ccv_nnc_tensor_arena_new(graph_prep, compile_params.allocator, 0, tensor_binds, tensor_bind_size);
+	ccv_nnc_tensor_arena_t* tensor_arena = _ccv_nnc_tensor_arena_new(graph_prep, compile_params.allocator, 0, all_binds, all_bind_size);
+	PRINT(CCV_CLI_VERBOSE, "Tensor arena %p allocated %llu bytes, the lower bound is %llu bytes\n", tensor_arena, (unsigned long long)ccv_nnc_tensor_arena_size(tensor_arena), (unsigned long long)tensor_arena->size_lower_bound);
+	if (all_binds != tensor_binds)
+	{
+		// The arena owns the copies of constants from now on.
+		tensor_arena->constants = ccv_array_new(sizeof(ccv_nnc_tensor_t*), all_bind_size - tensor_bind_size, 0);
+		for (i = tensor_bind_size; i < all_bind_size; i++)
+			ccv_array_push(tensor_arena->constants, &all_binds[i].tensor);
+		ccfree(all_binds);
+	}
 	_ccv_nnc_tensor_arena_fixup_pair_ref_and_tape_var(tensor_arena, graph_prep, tensor_arena);
 	*tensor_arena_ref = tensor_arena;
 	// The above handled tensor allocation, now we need to materialize the graph from symbolic to real.
@@ -3853,6 +4461,24 @@ void ccv_nnc_symbolic_graph_compile(const ccv_nnc_symbolic_graph_t* const symbol
 	_ccv_nnc_symbolic_graph_prep_free(graph_prep);
 }
 
+void ccv_nnc_symbolic_graph_compile(const ccv_nnc_symbolic_graph_t* const symbolic_graph, const ccv_nnc_symbolic_graph_compile_param_t compile_params, const ccv_nnc_tensor_bind_t* const tensor_binds, const int tensor_bind_size, const ccv_nnc_tensor_symbol_t* const outputs, const int output_size, const ccv_nnc_graph_exec_symbol_t* const sources, const int source_size, const ccv_nnc_graph_exec_symbol_t* const destinations, const int destination_size, ccv_nnc_graph_t** const graph_ref, ccv_nnc_tensor_arena_t** const tensor_arena_ref, ccv_nnc_graph_exec_arena_t** const graph_exec_arena_ref)
+{
+	assert(graph_ref);
+	assert(tensor_arena_ref);
+	assert(graph_exec_arena_ref);
+	int i;
+	// Cannot bind the multi-view.
+	for (i = 0; i < tensor_bind_size; i++)
+	{
+		assert(tensor_binds[i].tensor);
+		assert(!CCV_IS_TENSOR_MULTIVIEW(tensor_binds[i].tensor));
+	}
+	int all_bind_size = 0;
+	ccv_nnc_tensor_bind_t* const all_binds = _ccv_nnc_tensor_binds_with_constants(symbolic_graph, tensor_binds, tensor_bind_size, &all_bind_size);
+	ccv_nnc_symbolic_graph_prep_t* graph_prep = _ccv_nnc_symbolic_graph_prep_new(symbolic_graph, all_binds, all_bind_size, outputs, output_size, sources, source_size, destinations, destination_size, 0, 0, 0, 0, compile_params.memory_planner);
+	_ccv_nnc_symbolic_graph_compile_with_prep(symbolic_graph, graph_prep, compile_params, tensor_binds, tensor_bind_size, all_binds, all_bind_size, sources, source_size, destinations, destination_size, graph_ref, tensor_arena_ref, graph_exec_arena_ref);
+}
+
 static void _ccv_nnc_tensor_arena_free(ccv_nnc_tensor_arena_t* const tensor_arena)
 {
 	// Buffers are inherited from above, no need to dealloc.
@@ -3860,6 +4486,10 @@ static void _ccv_nnc_tensor_arena_free(ccv_nnc_tensor_arena_t* const tensor_aren
 	for (i = 0; i < tensor_arena->sub_arena_size; i++)
 		if (tensor_arena->sub_arenas[i])
 			_ccv_nnc_tensor_arena_free(tensor_arena->sub_arenas[i]);
+	// Tensors (and their memory) in the arena are about to be reused, any packed data derived from them is outdated.
+	for (i = 0; i < tensor_arena->vt_tensor_size; i++)
+		if (tensor_arena->vt_tensors[i] && !CCV_IS_TENSOR_MULTIVIEW(tensor_arena->vt_tensors[i]))
+			ccv_nnc_tensor_data_touch(tensor_arena->vt_tensors[i]);
 	for (i = 0; i < tensor_arena->m_tensor_idx->rnum; i++)
 	{
 		ccv_nnc_tensor_multiview_t* const mv = (ccv_nnc_tensor_multiview_t*)_ccv_nnc_tensor_metadata_get(tensor_arena->tensor_metadata, *(int*)ccv_array_get(tensor_arena->m_tensor_idx, i));
@@ -3965,6 +4595,11 @@ uint64_t ccv_nnc_tensor_arena_size(const ccv_nnc_tensor_arena_t* const tensor_ar
 	return total_size;
 }
 
+uint64_t ccv_nnc_tensor_arena_size_lower_bound(const ccv_nnc_tensor_arena_t* const tensor_arena)
+{
+	return tensor_arena->size_lower_bound;
+}
+
 static void _ccv_nnc_multiview_update_params(ccv_nnc_tensor_multiview_t* const mv, const ccv_nnc_tensor_param_t params)
 {
 	int i;
@@ -4046,6 +4681,8 @@ void ccv_nnc_graph_exec_reinit(ccv_nnc_graph_exec_arena_t* const graph_exec_aren
 			continue;
 		const ccv_nnc_graph_exec_symbol_info_t* const symbol_info = (ccv_nnc_graph_exec_symbol_info_t*)ccv_array_get(symbolic_graph->exec_symbol_info, i);
 		ccv_nnc_graph_exec_set(graph, graph_exec, symbol_info->cmd);
+		// The hint may be different for the new shapes.
+		ccv_nnc_graph_exec_set_hint(graph, graph_exec, symbol_info->hint);
 	}
 }
 
@@ -4076,6 +4713,12 @@ void ccv_nnc_tensor_arena_free(ccv_nnc_tensor_arena_t* const tensor_arena)
 		ccfree(tensor_arena->buffers[i].ptr);
 #endif
 	}
+	if (tensor_arena->constants)
+	{
+		for (i = 0; i < tensor_arena->constants->rnum; i++)
+			ccv_nnc_tensor_free(*(ccv_nnc_tensor_t**)ccv_array_get(tensor_arena->constants, i));
+		ccv_array_free(tensor_arena->constants);
+	}
 	_ccv_nnc_tensor_arena_free(tensor_arena);
 }
 
@@ -4087,3 +4730,422 @@ void ccv_nnc_graph_exec_arena_free(ccv_nnc_graph_exec_arena_t* const graph_exec_
 			ccv_nnc_graph_exec_arena_free(graph_exec_arena->sub_arenas[i]);
 	ccfree(graph_exec_arena);
 }
+
+// MARK - Compiled Graph Snapshot
+
+// Bump this whenever the layout of the compilation plan changes, thus, a plan written by an older version is ignored.
+#define CCV_NNC_COMPILE_PLAN_VERSION (3)
+
+static void _ccv_nnc_bind_int_array(sqlite3_stmt* const stmt, const int idx, const ccv_array_t* const array)
+{
+	if (array && array->rnum > 0)
+		sqlite3_bind_blob(stmt, idx, ccv_array_get(array, 0), sizeof(int) * array->rnum, 0);
+}
+
+static ccv_array_t* _ccv_nnc_column_int_array(sqlite3_stmt* const stmt, const int idx)
+{
+	const int* const data = (const int*)sqlite3_column_blob(stmt, idx);
+	const int count = sqlite3_column_bytes(stmt, idx) / sizeof(int);
+	if (!data || count == 0)
+		return 0;
+	ccv_array_t* const array = ccv_array_new(sizeof(int), count, 0);
+	int i;
+	for (i = 0; i < count; i++)
+		ccv_array_push(array, data + i);
+	return array;
+}
+
+static uint64_t _ccv_nnc_symbolic_graph_fingerprint(const ccv_nnc_symbolic_graph_t* const symbolic_graph)
+{
+	// The plan is only valid for the graph it is made from, hash what the tensor blocks and their life-time depend on.
+	int i;
+	uint64_t sig = ccv_cache_generate_signature((const char*)&symbolic_graph->tensor_symbol_info->rnum, sizeof(int), (uint64_t)CCV_NNC_COMPILE_PLAN_VERSION, CCV_EOF_SIGN);
+	for (i = 0; i < symbolic_graph->tensor_symbol_info->rnum; i++)
+	{
+		const ccv_nnc_tensor_symbol_info_t* const symbol_info = (ccv_nnc_tensor_symbol_info_t*)ccv_array_get(symbolic_graph->tensor_symbol_info, i);
+		const int refs[] = {
+			symbol_info->alias_ref, symbol_info->assign_ref, symbol_info->bypass_ref, symbol_info->flags
+		};
+		sig = ccv_cache_generate_signature((const char*)refs, sizeof(refs), sig, CCV_EOF_SIGN);
+		sig = ccv_cache_generate_signature((const char*)&symbol_info->info, sizeof(symbol_info->info), sig, CCV_EOF_SIGN);
+		sig = ccv_cache_generate_signature((const char*)symbol_info->ofs, sizeof(symbol_info->ofs), sig, CCV_EOF_SIGN);
+		sig = ccv_cache_generate_signature((const char*)symbol_info->inc, sizeof(symbol_info->inc), sig, CCV_EOF_SIGN);
+	}
+	for (i = 0; i < symbolic_graph->exec_symbol_info->rnum; i++)
+	{
+		const ccv_nnc_graph_exec_symbol_info_t* const symbol_info = (ccv_nnc_graph_exec_symbol_info_t*)ccv_array_get(symbolic_graph->exec_symbol_info, i);
+		const int cmd[] = {
+			symbol_info->cmd.cmd, symbol_info->cmd.backend, symbol_info->cmd.algorithm, symbol_info->flags, symbol_info->input_size, symbol_info->output_size
+		};
+		sig = ccv_cache_generate_signature((const char*)cmd, sizeof(cmd), sig, CCV_EOF_SIGN);
+		sig = ccv_cache_generate_signature((const char*)&symbol_info->cmd.info, sizeof(symbol_info->cmd.info), sig, CCV_EOF_SIGN);
+		sig = ccv_cache_generate_signature((const char*)&symbol_info->hint, sizeof(symbol_info->hint), sig, CCV_EOF_SIGN);
+		if (symbol_info->input_size > 0)
+			sig = ccv_cache_generate_signature((const char*)symbol_info->inputs, sizeof(int) * symbol_info->input_size, sig, CCV_EOF_SIGN);
+		if (symbol_info->output_size > 0)
+			sig = ccv_cache_generate_signature((const char*)symbol_info->outputs, sizeof(int) * symbol_info->output_size, sig, CCV_EOF_SIGN);
+		if (symbol_info->outgoings && symbol_info->outgoings->rnum > 0)
+			sig = ccv_cache_generate_signature((const char*)ccv_array_get(symbol_info->outgoings, 0), sizeof(int) * symbol_info->outgoings->rnum, sig, CCV_EOF_SIGN);
+	}
+	return sig;
+}
+
+static void _ccv_nnc_symbolic_graph_prep_write(const ccv_nnc_symbolic_graph_prep_t* const graph_prep, sqlite3* const conn, sqlite3_stmt* const plan_insert_stmt)
+{
+	const ccv_nnc_tensor_alloc_prep_t* const alloc_prep = graph_prep->alloc_prep;
+	int i;
+	sqlite3_bind_int(plan_insert_stmt, 5, graph_prep->tensor_block_size);
+	// The buffers and the blocks are the tensor arena layout, flatten them to plain integers.
+	int* const buffer_infos = (int*)ccmalloc(sizeof(int) * (alloc_prep->buffer_size * 3 + alloc_prep->block_size * 2 + 1));
+	uint64_t* const buffer_sizes = (uint64_t*)ccmalloc(sizeof(uint64_t) * (alloc_prep->buffer_size + alloc_prep->block_size + 1));
+	for (i = 0; i < alloc_prep->buffer_size; i++)
+	{
+		buffer_infos[i * 3] = alloc_prep->buffers[i].type;
+		buffer_infos[i * 3 + 1] = alloc_prep->buffers[i].pin_mem;
+		buffer_infos[i * 3 + 2] = alloc_prep->buffers[i].flags;
+		buffer_sizes[i] = alloc_prep->buffers[i].size;
+	}
+	int* const block_infos = buffer_infos + alloc_prep->buffer_size * 3;
+	uint64_t* const block_offsets = buffer_sizes + alloc_prep->buffer_size;
+	for (i = 0; i < alloc_prep->block_size; i++)
+	{
+		block_infos[i * 2] = alloc_prep->blocks[i].buffer_ref;
+		block_infos[i * 2 + 1] = alloc_prep->blocks[i].block_ref;
+		block_offsets[i] = alloc_prep->blocks[i].offset;
+	}
+	sqlite3_bind_blob(plan_insert_stmt, 6, buffer_infos, sizeof(int) * alloc_prep->buffer_size * 3, 0);
+	sqlite3_bind_blob(plan_insert_stmt, 7, buffer_sizes, sizeof(uint64_t) * alloc_prep->buffer_size, 0);
+	sqlite3_bind_blob(plan_insert_stmt, 8, block_infos, sizeof(int) * alloc_prep->block_size * 2, 0);
+	sqlite3_bind_blob(plan_insert_stmt, 9, block_offsets, sizeof(uint64_t) * alloc_prep->block_size, 0);
+	sqlite3_bind_blob(plan_insert_stmt, 10, alloc_prep->vt_blocks, sizeof(int) * alloc_prep->vt_block_size, 0);
+	sqlite3_bind_int64(plan_insert_stmt, 11, (sqlite3_int64)alloc_prep->size_lower_bound);
+	sqlite3_step(plan_insert_stmt);
+	ccfree(buffer_infos);
+	ccfree(buffer_sizes);
+	const char tensor_block_insert_qs[] =
+		"REPLACE INTO compile_tensor_block "
+		"(id, flags, type, pin_mem, ref, bypass_ref, companion_ref, unfoldable_except_ref, size, p_refs, "
+		"head, tail, alloc_dep) VALUES ($id, $flags, $type, $pin_mem, $ref, $bypass_ref, $companion_ref, "
+		"$unfoldable_except_ref, $size, $p_refs, $head, $tail, $alloc_dep)";
+	sqlite3_stmt* tensor_block_insert_stmt = 0;
+	SQLITE_ENFORCE(SQLITE_OK == sqlite3_prepare_v2(conn, tensor_block_insert_qs, sizeof(tensor_block_insert_qs), &tensor_block_insert_stmt, 0));
+	const ccv_nnc_tensor_block_t* const tensor_blocks = graph_prep->tensor_blocks;
+	for (i = 0; i < graph_prep->tensor_block_size; i++)
+	{
+		sqlite3_bind_int(tensor_block_insert_stmt, 1, i);
+		sqlite3_bind_int(tensor_block_insert_stmt, 2, tensor_blocks[i].flags);
+		sqlite3_bind_int(tensor_block_insert_stmt, 3, tensor_blocks[i].type);
+		sqlite3_bind_int(tensor_block_insert_stmt, 4, tensor_blocks[i].pin_mem);
+		sqlite3_bind_int(tensor_block_insert_stmt, 5, tensor_blocks[i].ref);
+		sqlite3_bind_int(tensor_block_insert_stmt, 6, tensor_blocks[i].bypass_ref);
+		sqlite3_bind_int(tensor_block_insert_stmt, 7, tensor_blocks[i].companion_ref);
+		sqlite3_bind_int(tensor_block_insert_stmt, 8, tensor_blocks[i].unfoldable_except_ref);
+		sqlite3_bind_int64(tensor_block_insert_stmt, 9, (sqlite_int64)tensor_blocks[i].size);
+		sqlite3_bind_blob(tensor_block_insert_stmt, 10, tensor_blocks[i].p_refs, sizeof(tensor_blocks[i].p_refs), 0);
+		_ccv_nnc_bind_int_array(tensor_block_insert_stmt, 11, tensor_blocks[i].head);
+		_ccv_nnc_bind_int_array(tensor_block_insert_stmt, 12, tensor_blocks[i].tail);
+		_ccv_nnc_bind_int_array(tensor_block_insert_stmt, 13, alloc_prep->alloc_dep[i]);
+		sqlite3_step(tensor_block_insert_stmt);
+		sqlite3_reset(tensor_block_insert_stmt);
+		sqlite3_clear_bindings(tensor_block_insert_stmt);
+	}
+	sqlite3_finalize(tensor_block_insert_stmt);
+}
+
+void ccv_nnc_symbolic_graph_compile_write(const ccv_nnc_symbolic_graph_t* const symbolic_graph, const ccv_nnc_symbolic_graph_compile_param_t compile_params, const ccv_nnc_tensor_bind_t* const tensor_binds, const int tensor_bind_size, const ccv_nnc_tensor_symbol_t* const outputs, const int output_size, const ccv_nnc_graph_exec_symbol_t* sources, int source_size, const ccv_nnc_graph_exec_symbol_t* destinations, int destination_size, const char* const fn)
+{
+	int i;
+	if (!source_size)
+	{
+		sources = ccv_nnc_symbolic_graph_sources(symbolic_graph);
+		source_size = ccv_nnc_symbolic_graph_source_size(symbolic_graph);
+	}
+	if (!destination_size)
+	{
+		destinations = ccv_nnc_symbolic_graph_destinations(symbolic_graph);
+		destination_size = ccv_nnc_symbolic_graph_destination_size(symbolic_graph);
+	}
+	for (i = 0; i < tensor_bind_size; i++)
+	{
+		assert(tensor_binds[i].tensor);
+		assert(!CCV_IS_TENSOR_MULTIVIEW(tensor_binds[i].tensor));
+	}
+	ccv_nnc_symbolic_graph_write(symbolic_graph, tensor_binds, tensor_bind_size, fn);
+	sqlite3* conn = 0;
+	if (SQLITE_OK != sqlite3_open(fn, &conn))
+		return;
+	SQLITE_ENFORCE(SQLITE_OK == sqlite3_exec(conn, "BEGIN", 0, 0, 0));
+	const char plan_create_table_qs[] = "CREATE TABLE IF NOT EXISTS compile_plan "
+		"(id INTEGER PRIMARY KEY, version INTEGER, outputs BLOB, sources BLOB, destinations BLOB, "
+		"tensor_block_size INTEGER, buffer_infos BLOB, buffer_sizes BLOB, block_infos BLOB, block_offsets BLOB, "
+		"vt_blocks BLOB, size_lower_bound INTEGER, fingerprint INTEGER)";
+	// ccv_nnc_symbolic_graph_write above already removed the plan written before.
+	SQLITE_ENFORCE(SQLITE_OK == sqlite3_exec(conn, plan_create_table_qs, 0, 0, 0));
+	const char tensor_block_create_table_qs[] = "CREATE TABLE IF NOT EXISTS compile_tensor_block "
+		"(id INTEGER PRIMARY KEY, flags INTEGER, type INTEGER, pin_mem INTEGER, ref INTEGER, bypass_ref INTEGER, "
+		"companion_ref INTEGER, unfoldable_except_ref INTEGER, size INTEGER, p_refs BLOB, head BLOB, tail BLOB, "
+		"alloc_dep BLOB)";
+	SQLITE_ENFORCE(SQLITE_OK == sqlite3_exec(conn, tensor_block_create_table_qs, 0, 0, 0));
+	const char plan_insert_qs[] =
+		"REPLACE INTO compile_plan "
+		"(id, version, outputs, sources, destinations, tensor_block_size, buffer_infos, buffer_sizes, "
+		"block_infos, block_offsets, vt_blocks, size_lower_bound, fingerprint) VALUES (0, $version, $outputs, "
+		"$sources, $destinations, $tensor_block_size, $buffer_infos, $buffer_sizes, $block_infos, $block_offsets, "
+		"$vt_blocks, $size_lower_bound, $fingerprint)";
+	sqlite3_stmt* plan_insert_stmt = 0;
+	SQLITE_ENFORCE(SQLITE_OK == sqlite3_prepare_v2(conn, plan_insert_qs, sizeof(plan_insert_qs), &plan_insert_stmt, 0));
+	sqlite3_bind_int(plan_insert_stmt, 1, CCV_NNC_COMPILE_PLAN_VERSION);
+	sqlite3_bind_int64(plan_insert_stmt, 12, (sqlite3_int64)_ccv_nnc_symbolic_graph_fingerprint(symbolic_graph));
+	int* const ds = (int*)ccmalloc(sizeof(int) * (output_size + source_size + destination_size + 1));
+	for (i = 0; i < output_size; i++)
+	{
+		assert(outputs[i].graph == symbolic_graph);
+		ds[i] = outputs[i].d;
+	}
+	for (i = 0; i < source_size; i++)
+	{
+		assert(sources[i].graph == symbolic_graph);
+		ds[output_size + i] = sources[i].d;
+	}
+	for (i = 0; i < destination_size; i++)
+	{
+		assert(destinations[i].graph == symbolic_graph);
+		ds[output_size + source_size + i] = destinations[i].d;
+	}
+	sqlite3_bind_blob(plan_insert_stmt, 2, ds, sizeof(int) * output_size, 0);
+	sqlite3_bind_blob(plan_insert_stmt, 3, ds + output_size, sizeof(int) * source_size, 0);
+	sqlite3_bind_blob(plan_insert_stmt, 4, ds + output_size + source_size, sizeof(int) * destination_size, 0);
+	// Sub-graphs are compiled recursively with their own plans, only the flat graph has its plan written. Otherwise the
+	// graph will be compiled after read.
+	if (!symbolic_graph->sub_graphs || symbolic_graph->sub_graphs->rnum == 0)
+	{
+		int all_bind_size = 0;
+		ccv_nnc_tensor_bind_t* const all_binds = _ccv_nnc_tensor_binds_with_constants(symbolic_graph, tensor_binds, tensor_bind_size, &all_bind_size);
+		ccv_nnc_symbolic_graph_prep_t* const graph_prep = _ccv_nnc_symbolic_graph_prep_new(symbolic_graph, all_binds, all_bind_size, outputs, output_size, sources, source_size, destinations, destination_size, 0, 0, 0, 0, compile_params.memory_planner);
+		_ccv_nnc_symbolic_graph_prep_write(graph_prep, conn, plan_insert_stmt);
+		ccv_nnc_graph_free(graph_prep->graph);
+		_ccv_nnc_symbolic_graph_prep_free(graph_prep);
+		if (all_binds != tensor_binds)
+		{
+			for (i = tensor_bind_size; i < all_bind_size; i++)
+				ccv_nnc_tensor_free((ccv_nnc_tensor_t*)all_binds[i].tensor);
+			ccfree(all_binds);
+		}
+	} else
+		sqlite3_step(plan_insert_stmt);
+	ccfree(ds);
+	sqlite3_finalize(plan_insert_stmt);
+	SQLITE_ENFORCE(SQLITE_OK == sqlite3_exec(conn, "COMMIT", 0, 0, 0));
+	sqlite3_close(conn);
+}
+
+static ccv_nnc_symbolic_graph_prep_t* _ccv_nnc_symbolic_graph_prep_read(const ccv_nnc_symbolic_graph_t* const symbolic_graph, sqlite3* const conn, sqlite3_stmt* const plan_select_stmt, const ccv_nnc_graph_exec_symbol_t* const sources, const int source_size, const ccv_nnc_graph_exec_symbol_t* const destinations, const int destination_size)
+{
+	const int tensor_block_size = sqlite3_column_int(plan_select_stmt, 5);
+	// Only the flat graph has its plan, and it has one tensor block per tensor symbol.
+	if (tensor_block_size != symbolic_graph->tensor_symbol_info->rnum ||
+		(symbolic_graph->sub_graphs && symbolic_graph->sub_graphs->rnum > 0))
+		return 0;
+	const int buffer_size = sqlite3_column_bytes(plan_select_stmt, 6) / (sizeof(int) * 3);
+	const int block_size = sqlite3_column_bytes(plan_select_stmt, 8) / (sizeof(int) * 2);
+	if (sqlite3_column_bytes(plan_select_stmt, 7) != sizeof(uint64_t) * buffer_size ||
+		sqlite3_column_bytes(plan_select_stmt, 9) != sizeof(uint64_t) * block_size ||
+		sqlite3_column_bytes(plan_select_stmt, 10) != sizeof(int) * tensor_block_size)
+		return 0;
+	int i;
+	ccv_nnc_tensor_block_t* const tensor_blocks = (ccv_nnc_tensor_block_t*)cccalloc(tensor_block_size, sizeof(ccv_nnc_tensor_block_t));
+	ccv_array_t** const alloc_dep = (ccv_array_t**)cccalloc(tensor_block_size, sizeof(ccv_array_t*));
+	const char tensor_block_select_qs[] =
+		"SELECT id, flags, type, pin_mem, ref, bypass_ref, companion_ref, unfoldable_except_ref, size, p_refs, "
+		"head, tail, alloc_dep FROM compile_tensor_block ORDER BY id";
+	sqlite3_stmt* tensor_block_select_stmt = 0;
+	SQLITE_ENFORCE(SQLITE_OK == sqlite3_prepare_v2(conn, tensor_block_select_qs, sizeof(tensor_block_select_qs), &tensor_block_select_stmt, 0));
+	int count = 0;
+	while (SQLITE_ROW == sqlite3_step(tensor_block_select_stmt))
+	{
+		const int id = sqlite3_column_int(tensor_block_select_stmt, 0);
+		if (id < 0 || id >= tensor_block_size)
+			continue;
+		tensor_blocks[id].flags = sqlite3_column_int(tensor_block_select_stmt, 1);
+		tensor_blocks[id].type = sqlite3_column_int(tensor_block_select_stmt, 2);
+		tensor_blocks[id].pin_mem = sqlite3_column_int(tensor_block_select_stmt, 3);
+		tensor_blocks[id].ref = sqlite3_column_int(tensor_block_select_stmt, 4);
+		tensor_blocks[id].bypass_ref = sqlite3_column_int(tensor_block_select_stmt, 5);
+		tensor_blocks[id].companion_ref = sqlite3_column_int(tensor_block_select_stmt, 6);
+		tensor_blocks[id].unfoldable_except_ref = sqlite3_column_int(tensor_block_select_stmt, 7);
+		tensor_blocks[id].size = (uint64_t)sqlite3_column_int64(tensor_block_select_stmt, 8);
+		const void* const p_refs = sqlite3_column_blob(tensor_block_select_stmt, 9);
+		if (p_refs)
+			memcpy(tensor_blocks[id].p_refs, p_refs, ccv_min(sizeof(tensor_blocks[id].p_refs), sqlite3_column_bytes(tensor_block_select_stmt, 9)));
+		tensor_blocks[id].head = _ccv_nnc_column_int_array(tensor_block_select_stmt, 10);
+		tensor_blocks[id].tail = _ccv_nnc_column_int_array(tensor_block_select_stmt, 11);
+		alloc_dep[id] = _ccv_nnc_column_int_array(tensor_block_select_stmt, 12);
+		++count;
+	}
+	sqlite3_finalize(tensor_block_select_stmt);
+	ccv_nnc_tensor_alloc_prep_t* const alloc_prep = (ccv_nnc_tensor_alloc_prep_t*)ccmalloc(sizeof(ccv_nnc_tensor_alloc_prep_t) + sizeof(alloc_prep->blocks[0]) * block_size + sizeof(alloc_prep->buffers[0]) * buffer_size + sizeof(int) * tensor_block_size);
+	alloc_prep->alloc_dep = alloc_dep;
+	alloc_prep->vt_block_size = tensor_block_size;
+	alloc_prep->buffer_size = buffer_size;
+	alloc_prep->block_size = block_size;
+	alloc_prep->blocks = (void*)(alloc_prep + 1);
+	alloc_prep->buffers = (void*)(alloc_prep->blocks + block_size);
+	alloc_prep->vt_blocks = (int*)(alloc_prep->buffers + buffer_size);
+	memset(alloc_prep->buffers, 0, sizeof(alloc_prep->buffers[0]) * buffer_size);
+	const int* const buffer_infos = (const int*)sqlite3_column_blob(plan_select_stmt, 6);
+	const uint64_t* const buffer_sizes = (const uint64_t*)sqlite3_column_blob(plan_select_stmt, 7);
+	for (i = 0; i < buffer_size; i++)
+	{
+		alloc_prep->buffers[i].type = buffer_infos[i * 3];
+		alloc_prep->buffers[i].pin_mem = buffer_infos[i * 3 + 1];
+		alloc_prep->buffers[i].flags = buffer_infos[i * 3 + 2];
+		alloc_prep->buffers[i].size = buffer_sizes[i];
+	}
+	const int* const block_infos = (const int*)sqlite3_column_blob(plan_select_stmt, 8);
+	const uint64_t* const block_offsets = (const uint64_t*)sqlite3_column_blob(plan_select_stmt, 9);
+	for (i = 0; i < block_size; i++)
+	{
+		alloc_prep->blocks[i].buffer_ref = block_infos[i * 2];
+		alloc_prep->blocks[i].block_ref = block_infos[i * 2 + 1];
+		alloc_prep->blocks[i].offset = block_offsets[i];
+	}
+	memcpy(alloc_prep->vt_blocks, sqlite3_column_blob(plan_select_stmt, 10), sizeof(int) * tensor_block_size);
+	alloc_prep->size_lower_bound = (uint64_t)sqlite3_column_int64(plan_select_stmt, 11);
+	// Everything the tensor arena takes from the plan has to be in bounds, otherwise it is not a plan we wrote.
+	int valid = (count == tensor_block_size);
+	for (i = 0; valid && i < block_size; i++)
+	{
+		const int buffer_ref = alloc_prep->blocks[i].buffer_ref;
+		const int block_ref = alloc_prep->blocks[i].block_ref;
+		valid = buffer_ref >= 0 && buffer_ref < buffer_size && block_ref >= 0 && block_ref < tensor_block_size &&
+			alloc_prep->blocks[i].offset <= alloc_prep->buffers[buffer_ref].size &&
+			tensor_blocks[block_ref].size <= alloc_prep->buffers[buffer_ref].size - alloc_prep->blocks[i].offset;
+	}
+	for (i = 0; valid && i < tensor_block_size; i++)
+		valid = alloc_prep->vt_blocks[i] >= -1 && alloc_prep->vt_blocks[i] < block_size;
+	if (!valid)
+	{
+		_ccv_nnc_tensor_blocks_free(tensor_blocks, tensor_block_size);
+		_ccv_nnc_tensor_alloc_prep_free(alloc_prep);
+		return 0;
+	}
+	// The symbol inference and the visit are linear, the expensive part (the exec dependencies, the tensor life-time and
+	// the memory layout) is from the plan.
+	ccv_nnc_tensor_symbol_info_t* const tensor_symbol_info = (ccv_nnc_tensor_symbol_info_t*)ccmalloc(sizeof(ccv_nnc_tensor_symbol_info_t) * symbolic_graph->tensor_symbol_info->rnum);
+	ccv_nnc_graph_exec_symbol_info_t* const exec_symbol_info = (ccv_nnc_graph_exec_symbol_info_t*)ccmalloc(sizeof(ccv_nnc_graph_exec_symbol_info_t) * symbolic_graph->exec_symbol_info->rnum);
+	ccv_nnc_graph_visit_t* const visit = ccv_nnc_graph_visit_new(symbolic_graph, (ccv_nnc_graph_exec_symbol_info_t*)ccv_array_get(symbolic_graph->exec_symbol_info, 0), symbolic_graph->exec_symbol_info->rnum, sources, source_size, destinations, destination_size, 0);
+	ccv_nnc_symbolic_graph_symbol_infer(symbolic_graph, visit, sources, source_size, destinations, destination_size, 0, 0, tensor_symbol_info, exec_symbol_info);
+	ccv_nnc_symbolic_graph_prep_t* const prep = (ccv_nnc_symbolic_graph_prep_t*)ccmalloc(sizeof(ccv_nnc_symbolic_graph_prep_t));
+	prep->graph = ccv_nnc_graph_new();
+	prep->flags = 0;
+	prep->while_count_tensor = 0;
+	prep->dup_breakpoints = 0;
+	prep->p = 0;
+	prep->symbolic_graph = symbolic_graph;
+	prep->p_idx = symbolic_graph->p_idx;
+	prep->exec_idx = symbolic_graph->exec_idx;
+	prep->sub_prep_size = 0;
+	prep->sub_preps = 0;
+	prep->exec_symbol_info_size = symbolic_graph->exec_symbol_info->rnum;
+	prep->exec_symbol_info = exec_symbol_info;
+	prep->tensor_symbol_info_size = symbolic_graph->tensor_symbol_info->rnum;
+	prep->tensor_symbol_info = tensor_symbol_info;
+	prep->unroll_count = 0;
+	prep->dup_tensor_block_ref = 0;
+	prep->tensor_block_size = tensor_block_size;
+	prep->tensor_blocks = tensor_blocks;
+	prep->exec_flags = (ccv_nnc_graph_exec_flag_t*)cccalloc(symbolic_graph->exec_symbol_info->rnum, sizeof(ccv_nnc_graph_exec_flag_t));
+	prep->visit = visit;
+	prep->alloc_prep = alloc_prep;
+	return prep;
+}
+
+static ccv_nnc_graph_exec_symbol_t* _ccv_nnc_column_exec_symbols(sqlite3_stmt* const stmt, const int idx, const ccv_nnc_symbolic_graph_t* const graph, int* const size_ref)
+{
+	const int* const ds = (const int*)sqlite3_column_blob(stmt, idx);
+	const int size = *size_ref = ds ? sqlite3_column_bytes(stmt, idx) / sizeof(int) : 0;
+	ccv_nnc_graph_exec_symbol_t* const symbols = (ccv_nnc_graph_exec_symbol_t*)ccmalloc(sizeof(ccv_nnc_graph_exec_symbol_t) * ccv_max(size, 1));
+	int i;
+	for (i = 0; i < size; i++)
+		symbols[i] = (ccv_nnc_graph_exec_symbol_t){
+			.d = ds[i],
+			.graph = graph
+		};
+	return symbols;
+}
+
+int ccv_nnc_symbolic_graph_compile_read(const char* const fn, const ccv_nnc_symbolic_graph_compile_param_t compile_params, ccv_nnc_symbolic_graph_t** const symbolic_graph_ref, ccv_nnc_tensor_bind_t** const tensor_binds_ref, int* const tensor_bind_size_ref, ccv_nnc_graph_t** const graph_ref, ccv_nnc_tensor_arena_t** const tensor_arena_ref, ccv_nnc_graph_exec_arena_t** const graph_exec_arena_ref)
+{
+	assert(symbolic_graph_ref);
+	assert(tensor_binds_ref);
+	assert(tensor_bind_size_ref);
+	assert(graph_ref);
+	assert(tensor_arena_ref);
+	assert(graph_exec_arena_ref);
+	*symbolic_graph_ref = 0;
+	*tensor_binds_ref = 0;
+	*tensor_bind_size_ref = 0;
+	*graph_ref = 0;
+	*tensor_arena_ref = 0;
+	*graph_exec_arena_ref = 0;
+	ccv_nnc_symbolic_graph_read(fn, symbolic_graph_ref, tensor_binds_ref, tensor_bind_size_ref);
+	const ccv_nnc_symbolic_graph_t* const symbolic_graph = *symbolic_graph_ref;
+	if (!symbolic_graph)
+		return 0;
+	const ccv_nnc_tensor_bind_t* const tensor_binds = *tensor_binds_ref;
+	const int tensor_bind_size = *tensor_bind_size_ref;
+	sqlite3* conn = 0;
+	if (SQLITE_OK != sqlite3_open(fn, &conn))
+		return 0;
+	const char plan_select_qs[] =
+		"SELECT version, outputs, sources, destinations, id, tensor_block_size, buffer_infos, buffer_sizes, "
+		"block_infos, block_offsets, vt_blocks, size_lower_bound, fingerprint FROM compile_plan WHERE id=0";
+	sqlite3_stmt* plan_select_stmt = 0;
+	if (SQLITE_OK != sqlite3_prepare_v2(conn, plan_select_qs, sizeof(plan_select_qs), &plan_select_stmt, 0))
+	{
+		// Only the symbolic graph is written, compile it with its default sources and destinations.
+		sqlite3_close(conn);
+		ccv_nnc_symbolic_graph_compile(symbolic_graph, compile_params, tensor_binds, tensor_bind_size, 0, 0, ccv_nnc_symbolic_graph_sources(symbolic_graph), ccv_nnc_symbolic_graph_source_size(symbolic_graph), ccv_nnc_symbolic_graph_destinations(symbolic_graph), ccv_nnc_symbolic_graph_destination_size(symbolic_graph), graph_ref, tensor_arena_ref, graph_exec_arena_ref);
+		return 0;
+	}
+	int i;
+	int output_size = 0, source_size = 0, destination_size = 0;
+	ccv_nnc_tensor_symbol_t* outputs = 0;
+	ccv_nnc_graph_exec_symbol_t* sources = 0;
+	ccv_nnc_graph_exec_symbol_t* destinations = 0;
+	ccv_nnc_symbolic_graph_prep_t* graph_prep = 0;
+	if (SQLITE_ROW == sqlite3_step(plan_select_stmt))
+	{
+		const int* const output_ds = (const int*)sqlite3_column_blob(plan_select_stmt, 1);
+		output_size = output_ds ? sqlite3_column_bytes(plan_select_stmt, 1) / sizeof(int) : 0;
+		outputs = (ccv_nnc_tensor_symbol_t*)ccmalloc(sizeof(ccv_nnc_tensor_symbol_t) * ccv_max(output_size, 1));
+		for (i = 0; i < output_size; i++)
+			outputs[i] = (ccv_nnc_tensor_symbol_t){
+				.d = output_ds[i],
+				.graph = symbolic_graph
+			};
+		sources = _ccv_nnc_column_exec_symbols(plan_select_stmt, 2, symbolic_graph, &source_size);
+		destinations = _ccv_nnc_column_exec_symbols(plan_select_stmt, 3, symbolic_graph, &destination_size);
+		if (sqlite3_column_int(plan_select_stmt, 0) == CCV_NNC_COMPILE_PLAN_VERSION && sqlite3_column_type(plan_select_stmt, 5) != SQLITE_NULL &&
+			(uint64_t)sqlite3_column_int64(plan_select_stmt, 12) == _ccv_nnc_symbolic_graph_fingerprint(symbolic_graph))
+			graph_prep = _ccv_nnc_symbolic_graph_prep_read(symbolic_graph, conn, plan_select_stmt, sources, source_size, destinations, destination_size);
+	}
+	sqlite3_finalize(plan_select_stmt);
+	sqlite3_close(conn);
+	if (!sources)
+		ccv_nnc_symbolic_graph_compile(symbolic_graph, compile_params, tensor_binds, tensor_bind_size, 0, 0, ccv_nnc_symbolic_graph_sources(symbolic_graph), ccv_nnc_symbolic_graph_source_size(symbolic_graph), ccv_nnc_symbolic_graph_destinations(symbolic_graph), ccv_nnc_symbolic_graph_destination_size(symbolic_graph), graph_ref, tensor_arena_ref, graph_exec_arena_ref);
+	else if (!graph_prep) // The plan is stale or not available, compile from scratch.
+		ccv_nnc_symbolic_graph_compile(symbolic_graph, compile_params, tensor_binds, tensor_bind_size, outputs, output_size, sources, source_size, destinations, destination_size, graph_ref, tensor_arena_ref, graph_exec_arena_ref);
+	else {
+		int all_bind_size = 0;
+		ccv_nnc_tensor_bind_t* const all_binds = _ccv_nnc_tensor_binds_with_constants(symbolic_graph, tensor_binds, tensor_bind_size, &all_bind_size);
+		_ccv_nnc_symbolic_graph_compile_with_prep(symbolic_graph, graph_prep, compile_params, tensor_binds, tensor_bind_size, all_binds, all_bind_size, sources, source_size, destinations, destination_size, graph_ref, tensor_arena_ref, graph_exec_arena_ref);
+	}
+	if (outputs)
+		ccfree(outputs);
+	if (sources)
+		ccfree(sources);
+	if (destinations)
+		ccfree(destinations);
+	return !!graph_prep;
+}
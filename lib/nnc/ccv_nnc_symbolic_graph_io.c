@@ -183,6 +183,10 @@ void ccv_nnc_symbolic_graph_write(const ccv_nnc_symbolic_graph_t* const graph, c
 	if (SQLITE_OK != sqlite3_open(fn, &conn))
 		return;
 	SQLITE_ENFORCE(SQLITE_OK == sqlite3_exec(conn, "BEGIN", 0, 0, 0));
+	// A compilation plan written before is for the graph it overwrites, ccv_nnc_symbolic_graph_compile_write writes
+	// a new one afterwards if needed.
+	SQLITE_ENFORCE(SQLITE_OK == sqlite3_exec(conn, "DROP TABLE IF EXISTS compile_plan", 0, 0, 0));
+	SQLITE_ENFORCE(SQLITE_OK == sqlite3_exec(conn, "DROP TABLE IF EXISTS compile_tensor_block", 0, 0, 0));
 	const char tensor_symbol_create_table_qs[] = "CREATE TABLE IF NOT EXISTS tensor_symbol "
 		"(id INTEGER, graph INTEGER, assign_ref INTEGER, r_assign_ref INTEGER, "
 		"bypass_ref INTEGER, r_bypass_ref INTEGER, p_ref INTEGER, alias_ref INTEGER, pair_ref INTEGER, "
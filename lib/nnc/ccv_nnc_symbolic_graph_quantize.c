@@ -0,0 +1,176 @@
+#include "ccv_nnc.h"
+#include "ccv_nnc_easy.h"
+#include "ccv_nnc_internal.h"
+#include "ccv_internal.h"
+#include "_ccv_nnc_symbolic_graph.h"
+
+// MARK - Level-3.5 API
+
+static int _ccv_nnc_quantize_is_plain_tensor(const ccv_nnc_tensor_symbol_info_t* const tensor_symbol_info, const int d)
+{
+	if (d < 0)
+		return 0;
+	const ccv_nnc_tensor_symbol_info_t* const info = tensor_symbol_info + d;
+	return !info->alias_ref && !info->assign_ref && !info->r_assign_ref &&
+		!info->bypass_ref && !info->r_bypass_ref && !info->p_ref && !info->s_ref &&
+		CCV_TENSOR_GET_MEMORY(info->info.type) == CCV_TENSOR_CPU_MEMORY && info->info.datatype == CCV_32F;
+}
+
+// Returns the quantized command for the given node, or a no-op if it cannot be quantized.
+static ccv_nnc_cmd_t _ccv_nnc_quantize_cmd(const ccv_nnc_tensor_symbol_info_t* const tensor_symbol_info, const ccv_nnc_graph_exec_symbol_info_t* const node, const float scale, const int zero_point)
+{
+	const ccv_nnc_cmd_t noop = ccv_nnc_cmd(CCV_NNC_NOOP, 0, ccv_nnc_cmd_auto, 0);
+	if (node->input_size < 2 || node->input_size > 3 || node->output_size != 1)
+		return noop;
+	int i;
+	for (i = 0; i < node->input_size; i++)
+		if ((i < 2 || node->inputs[i] >= 0) && !_ccv_nnc_quantize_is_plain_tensor(tensor_symbol_info, node->inputs[i]))
+			return noop;
+	if (!_ccv_nnc_quantize_is_plain_tensor(tensor_symbol_info, node->outputs[0]))
+		return noop;
+	const ccv_nnc_cmd_param_t info = node->cmd.info;
+	const int w_nd = ccv_nnc_tensor_nd(tensor_symbol_info[node->inputs[1]].info.dim);
+	ccv_nnc_cmd_param_t params = {
+		.size = info.size,
+		.quant = {
+			.scale = scale,
+			.zero_point = zero_point,
+		},
+	};
+	switch (node->cmd.cmd)
+	{
+		case CCV_NNC_CONVOLUTION_FORWARD:
+		case CCV_NNC_FUSED_CONVOLUTION_FORWARD:
+			if (node->cmd.cmd == CCV_NNC_CONVOLUTION_FORWARD && info.convolution.groups > 1)
+				return noop;
+			if (tensor_symbol_info[node->inputs[0]].info.format != CCV_TENSOR_FORMAT_NHWC || w_nd != CCV_NNC_MAX_DIM + 2)
+				return noop;
+			params.quant.count = node->cmd.cmd == CCV_NNC_CONVOLUTION_FORWARD ? info.convolution.count : info.fused.count;
+			params.quant.activation = node->cmd.cmd == CCV_NNC_CONVOLUTION_FORWARD ? 0 : info.fused.activation;
+			return ccv_nnc_cmd(CCV_NNC_QUANTIZED_CONVOLUTION_FORWARD, 0, params, 0);
+		case CCV_NNC_GEMM_FORWARD:
+			// Only b = a * w^T + bias, that is what the quantized kernel computes.
+			if (info.blas.transpose_a[0] != info.blas.transpose_a[1] ||
+				!((info.blas.transpose_b[0] == 0 && info.blas.transpose_b[1] == 1) || (info.blas.transpose_b[0] == 1 && info.blas.transpose_b[1] == 0)))
+				return noop;
+			// Fall through.
+		case CCV_NNC_FUSED_GEMM_FORWARD:
+			if (ccv_nnc_tensor_nd(tensor_symbol_info[node->inputs[0]].info.dim) > 2 || w_nd != 2 ||
+				(node->input_size > 2 && node->inputs[2] >= 0 && ccv_nnc_tensor_nd(tensor_symbol_info[node->inputs[2]].info.dim) > 1))
+				return noop;
+			params.size.dim[0] = params.size.dim[1] = params.size.dim[2] = 1;
+			params.quant.activation = node->cmd.cmd == CCV_NNC_GEMM_FORWARD ? 0 : info.fused.activation;
+			return ccv_nnc_cmd(CCV_NNC_QUANTIZED_GEMM_FORWARD, 0, params, 0);
+	}
+	return noop;
+}
+
+typedef struct {
+	int exec;
+	int input;
+	ccv_nnc_cmd_t cmd;
+} ccv_nnc_quantize_rewrite_t;
+
+void ccv_nnc_symbolic_graph_quantize(ccv_nnc_symbolic_graph_t* const graph, const ccv_nnc_tensor_symbol_t* const symbols, const float* const ranges, const int symbol_size, const ccv_nnc_graph_exec_symbol_t* const sources, const int source_size, const ccv_nnc_graph_exec_symbol_t* const destinations, const int destination_size)
+{
+	// Similar to memory compression, the exec_symbol_info and tensor_symbol_info cannot be accessed once I start to mutate
+	// the graph. Therefore, collect the rewrites first and do the mutation at the last step.
+	ccv_nnc_graph_exec_symbol_info_t* const exec_symbol_info = (ccv_nnc_graph_exec_symbol_info_t*)ccv_array_get(graph->exec_symbol_info, 0);
+	ccv_nnc_tensor_symbol_info_t* const tensor_symbol_info = (ccv_nnc_tensor_symbol_info_t*)ccv_array_get(graph->tensor_symbol_info, 0);
+	ccv_nnc_graph_visit_t* const visit = ccv_nnc_graph_visit_new(graph, exec_symbol_info, graph->exec_symbol_info->rnum, sources, source_size, destinations, destination_size, 0);
+	ccv_nnc_symbolic_graph_symbol_infer(graph, visit, sources, source_size, destinations, destination_size, 0, 0, tensor_symbol_info, exec_symbol_info);
+	const int tensor_symbol_info_size = graph->tensor_symbol_info->rnum;
+	// For each tensor, the index into the ranges, its producer, the quantized tensor and the exec quantizes it.
+	int* const range_idx = (int*)ccmalloc(sizeof(int) * tensor_symbol_info_size * 4);
+	int* const producers = range_idx + tensor_symbol_info_size;
+	int* const quantized = producers + tensor_symbol_info_size;
+	int* const quantize_execs = quantized + tensor_symbol_info_size;
+	int i;
+	for (i = 0; i < tensor_symbol_info_size * 4; i++)
+		range_idx[i] = -1;
+	for (i = 0; i < symbol_size; i++)
+	{
+		assert(symbols[i].graph == graph);
+		if (symbols[i].d >= 0 && symbols[i].d < tensor_symbol_info_size)
+			range_idx[symbols[i].d] = i;
+	}
+	ccv_array_t* const rewrites = ccv_array_new(sizeof(ccv_nnc_quantize_rewrite_t), 0, 0);
+	ccv_nnc_graph_visit_for(visit, exec_symbol_info, node, idx) {
+		for (i = 0; i < node->output_size; i++)
+			if (node->outputs[i] >= 0)
+				producers[node->outputs[i]] = idx;
+		if (node->input_size < 1 || node->inputs[0] < 0 || range_idx[node->inputs[0]] < 0)
+			continue;
+		const int d = node->inputs[0];
+		// The range always includes 0 such that 0 can be represented exactly (the zero padding, ReLU etc.).
+		const float min = ccv_min(ranges[range_idx[d] * 2], 0);
+		const float max = ccv_max(ranges[range_idx[d] * 2 + 1], 0);
+		const float scale = max > min ? (max - min) / 255 : 1;
+		const int zero_point = ccv_clamp((int)lrintf(-min / scale), 0, 255);
+		const ccv_nnc_cmd_t cmd = _ccv_nnc_quantize_cmd(tensor_symbol_info, node, scale, zero_point);
+		if (cmd.cmd == CCV_NNC_NOOP)
+			continue;
+		const ccv_nnc_quantize_rewrite_t rewrite = {
+			.exec = idx,
+			.input = d,
+			.cmd = cmd,
+		};
+		ccv_array_push(rewrites, &rewrite);
+	} ccv_nnc_graph_visit_endfor
+	ccv_nnc_graph_visit_free(visit);
+	// Do the graph mutation now, one quantize command for each input, shared by all its consumers.
+	for (i = 0; i < rewrites->rnum; i++)
+	{
+		const ccv_nnc_quantize_rewrite_t* const rewrite = (ccv_nnc_quantize_rewrite_t*)ccv_array_get(rewrites, i);
+		const int d = rewrite->input;
+		const ccv_nnc_tensor_symbol_t input = {
+			.graph = graph,
+			.d = d
+		};
+		if (quantized[d] < 0)
+		{
+			ccv_nnc_tensor_param_t info = ccv_nnc_tensor_symbol_params(graph, input);
+			info.datatype = CCV_8U;
+			const ccv_nnc_tensor_symbol_t q = ccv_nnc_tensor_symbol_new(graph, info, 0);
+			const ccv_nnc_graph_exec_symbol_t quantize = ccv_nnc_graph_exec_symbol_new(graph, CMD_QUANTIZE_FORWARD(rewrite->cmd.info.quant.scale, rewrite->cmd.info.quant.zero_point), TENSOR_SYMBOL_LIST(input), TENSOR_SYMBOL_LIST(q), 0);
+			if (producers[d] >= 0)
+				ccv_nnc_graph_exec_symbol_concat(graph, (ccv_nnc_graph_exec_symbol_t){
+					.graph = graph,
+					.d = producers[d]
+				}, quantize);
+			quantized[d] = q.d;
+			quantize_execs[d] = quantize.d;
+		}
+		const ccv_nnc_graph_exec_symbol_t exec = {
+			.graph = graph,
+			.d = rewrite->exec
+		};
+		ccv_nnc_graph_exec_symbol_concat(graph, (ccv_nnc_graph_exec_symbol_t){
+			.graph = graph,
+			.d = quantize_execs[d]
+		}, exec);
+		const int* inputs;
+		int input_size;
+		const int* outputs;
+		int output_size;
+		ccv_nnc_graph_exec_symbol_io(graph, exec, &inputs, &input_size, &outputs, &output_size);
+		assert(input_size <= 3 && output_size == 1);
+		ccv_nnc_tensor_symbol_t new_inputs[3];
+		int j;
+		for (j = 0; j < input_size; j++)
+			new_inputs[j] = (ccv_nnc_tensor_symbol_t){
+				.graph = inputs[j] >= 0 ? graph : 0,
+				.d = inputs[j]
+			};
+		new_inputs[0].d = quantized[d];
+		const ccv_nnc_tensor_symbol_t output = {
+			.graph = graph,
+			.d = outputs[0]
+		};
+		// Set the command first, the backend is selected when setting the io.
+		ccv_nnc_graph_exec_symbol_set(graph, exec, rewrite->cmd);
+		ccv_nnc_graph_exec_symbol_set_io(graph, exec, new_inputs, input_size, &output, 1);
+	}
+	ccv_array_free(rewrites);
+	ccfree(range_idx);
+}
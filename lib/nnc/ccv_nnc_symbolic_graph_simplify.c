@@ -647,6 +647,411 @@ static int _ccv_nnc_find_ops_for_fusion(const ccv_nnc_ops_fusion_t* const fusion
 	return 0;
 }
 
+// Below fuses a compute-heavy command with the cheap commands following it, such that the intermediate tensors never hit
+// the memory: convolution (+ batch norm in test mode) + activation, GEMM + activation, and chains of element-wise
+// commands. This only applies to CPU tensors, where the fused kernels are implemented.
+
+typedef struct {
+	int* consumers; // The exec that consumes a tensor, -1 if none, -2 if there are more than one.
+	int* order; // The position of an exec in the visit, -1 if it is not visited.
+	uint32_t* aliased; // Mark a tensor is aliased by some other tensors.
+	uint32_t* visited; // Scratch space for the reachability test.
+	ccv_array_t* stack;
+} ccv_nnc_kernel_fusion_t;
+
+static int _ccv_nnc_kernel_fusion_is_activation(const uint32_t cmd)
+{
+	return cmd == CCV_NNC_RELU_FORWARD || cmd == CCV_NNC_SIGMOID_FORWARD || cmd == CCV_NNC_SWISH_FORWARD;
+}
+
+static int _ccv_nnc_kernel_fusion_is_fusible_exec(const ccv_nnc_symbolic_graph_simplify_t* const simplify, const int idx)
+{
+	if (idx < 0 || (simplify->exec_dead[idx >> 5] & (1u << (idx & 0x1f))))
+		return 0;
+	const ccv_nnc_graph_exec_symbol_info_t* const node = simplify->exec_symbol_info + idx;
+	return !CCV_NNC_GRAPH_EXEC_IS_DEAD(node->flags) && !node->pair_ref && !node->graph_ref_size &&
+		!(node->flags & (CCV_NNC_GRAPH_EXEC_P_WHILE | CCV_NNC_GRAPH_EXEC_CASE_OF));
+}
+
+// Whether the tensor can be read / written by a fused kernel directly (a dense 32-bit float tensor on CPU).
+static int _ccv_nnc_kernel_fusion_is_plain_tensor(const ccv_nnc_symbolic_graph_simplify_t* const simplify, const ccv_nnc_kernel_fusion_t* const fusion, const int d)
+{
+	if (d < 0)
+		return 0;
+	const ccv_nnc_tensor_symbol_info_t* const tensor_symbol_info = simplify->tensor_symbol_info + d;
+	return !tensor_symbol_info->alias_ref && !tensor_symbol_info->assign_ref && !tensor_symbol_info->r_assign_ref &&
+		!tensor_symbol_info->bypass_ref && !tensor_symbol_info->r_bypass_ref && !tensor_symbol_info->p_ref &&
+		!tensor_symbol_info->s_ref && CCV_TENSOR_GET_MEMORY(tensor_symbol_info->info.type) == CCV_TENSOR_CPU_MEMORY &&
+		tensor_symbol_info->info.datatype == CCV_32F;
+}
+
+// Whether the tensor only exists to pass the value from one command to the next, thus, can be elided.
+static int _ccv_nnc_kernel_fusion_is_intermediate(const ccv_nnc_symbolic_graph_simplify_t* const simplify, const ccv_nnc_kernel_fusion_t* const fusion, const ccv_nnc_tensor_symbol_t* const outputs, const int output_size, const int d)
+{
+	if (!_ccv_nnc_kernel_fusion_is_plain_tensor(simplify, fusion, d) || fusion->consumers[d] < 0)
+		return 0;
+	const ccv_nnc_tensor_symbol_info_t* const tensor_symbol_info = simplify->tensor_symbol_info + d;
+	if (tensor_symbol_info->pair_ref || (tensor_symbol_info->flags & ~CCV_NNC_TENSOR_SYMBOL_DEAD) ||
+		(fusion->aliased[d >> 5] & (1u << (d & 0x1f))))
+		return 0;
+	int i;
+	for (i = 0; i < output_size; i++)
+		if (outputs[i].d == d && outputs[i].graph == simplify->graph)
+			return 0;
+	return 1;
+}
+
+// Whether the tensor is not used by any exec and is not an output, thus, the exec doesn't need to compute it.
+static int _ccv_nnc_kernel_fusion_is_unused(const ccv_nnc_symbolic_graph_simplify_t* const simplify, const ccv_nnc_kernel_fusion_t* const fusion, const ccv_nnc_tensor_symbol_t* const outputs, const int output_size, const int d)
+{
+	if (d < 0)
+		return 1;
+	const ccv_nnc_tensor_symbol_info_t* const tensor_symbol_info = simplify->tensor_symbol_info + d;
+	if (fusion->consumers[d] != -1 || tensor_symbol_info->alias_ref || tensor_symbol_info->assign_ref ||
+		tensor_symbol_info->r_assign_ref || tensor_symbol_info->bypass_ref || tensor_symbol_info->r_bypass_ref ||
+		tensor_symbol_info->p_ref || tensor_symbol_info->s_ref || tensor_symbol_info->pair_ref ||
+		(fusion->aliased[d >> 5] & (1u << (d & 0x1f))))
+		return 0;
+	int i;
+	for (i = 0; i < output_size; i++)
+		if (outputs[i].d == d && outputs[i].graph == simplify->graph)
+			return 0;
+	return 1;
+}
+
+// Whether the exec "to" can be reached from the exec "from" following the edges.
+static int _ccv_nnc_kernel_fusion_is_reachable(const ccv_nnc_symbolic_graph_simplify_t* const simplify, ccv_nnc_kernel_fusion_t* const fusion, const int from, const int to)
+{
+	if (fusion->order[from] >= 0 && fusion->order[to] >= 0 && fusion->order[to] < fusion->order[from])
+		return 0; // Anything reachable comes after in the topological order.
+	memset(fusion->visited, 0, sizeof(uint32_t) * ((simplify->exec_symbol_info_size + 31) >> 5));
+	ccv_array_clear(fusion->stack);
+	ccv_array_push(fusion->stack, &from);
+	fusion->visited[from >> 5] |= (1u << (from & 0x1f));
+	int i;
+	while (fusion->stack->rnum > 0)
+	{
+		const int idx = *(int*)ccv_array_get(fusion->stack, fusion->stack->rnum - 1);
+		--fusion->stack->rnum;
+		if (idx == to)
+			return 1;
+		// The edges may be added by this pass, therefore, look at the actual graph.
+		const ccv_array_t* const outgoings = ((ccv_nnc_graph_exec_symbol_info_t*)ccv_array_get(simplify->graph->exec_symbol_info, idx))->outgoings;
+		if (outgoings)
+			for (i = 0; i < outgoings->rnum; i++)
+			{
+				const int d = *(int*)ccv_array_get(outgoings, i);
+				if (!(fusion->visited[d >> 5] & (1u << (d & 0x1f))))
+				{
+					fusion->visited[d >> 5] |= (1u << (d & 0x1f));
+					ccv_array_push(fusion->stack, &d);
+				}
+			}
+	}
+	return 0;
+}
+
+// Rewrite the first exec of the fused ones to the fused command, mark the others and the tensors in-between dead.
+static void _ccv_nnc_kernel_fusion_rewrite(ccv_nnc_symbolic_graph_simplify_t* const simplify, ccv_nnc_kernel_fusion_t* const fusion, const ccv_nnc_cmd_t cmd, const int* const fusing_execs, const int fusing_exec_size, const int* const inputs, const int input_size, const int output)
+{
+	const int idx = fusing_execs[0];
+	ccv_nnc_graph_exec_symbol_info_t* const node = simplify->exec_symbol_info + idx;
+	int i, j;
+	for (i = 0; i < fusing_exec_size; i++)
+	{
+		const ccv_nnc_graph_exec_symbol_info_t* const fusing_node = simplify->exec_symbol_info + fusing_execs[i];
+		if (i > 0)
+			for (j = 0; j < fusing_node->input_size; j++)
+			{
+				const int d = fusing_node->inputs[j];
+				// Produced outside of the fused execs, now the first exec needs to wait for it.
+				if (d >= 0 && simplify->output_execs[d] >= 0 && simplify->output_execs[d] != fusing_execs[i - 1])
+					ccv_nnc_graph_exec_symbol_concat(simplify->graph, (ccv_nnc_graph_exec_symbol_t){
+						.d = simplify->output_execs[d],
+						.graph = simplify->graph,
+					}, (ccv_nnc_graph_exec_symbol_t){
+						.d = idx,
+						.graph = simplify->graph,
+					});
+			}
+		// The intermediate results (and the unused ones) are not needed any more.
+		for (j = 0; j < fusing_node->output_size; j++)
+		{
+			const int d = fusing_node->outputs[j];
+			if (d >= 0 && d != output)
+				simplify->tensor_dead[d >> 5] |= (1u << (d & 0x1f));
+		}
+		if (i > 0)
+			simplify->exec_dead[fusing_execs[i] >> 5] |= (1u << (fusing_execs[i] & 0x1f));
+	}
+	for (i = 0; i < input_size; i++)
+		if (inputs[i] >= 0 && fusion->consumers[inputs[i]] >= 0)
+			fusion->consumers[inputs[i]] = idx;
+	simplify->output_execs[output] = idx;
+	// Modify the first node. I need to look back to the actual graph to update it.
+	ccv_nnc_graph_exec_symbol_info_t* const actual_node = (ccv_nnc_graph_exec_symbol_info_t*)ccv_array_get(simplify->graph->exec_symbol_info, idx);
+	actual_node->cmd = node->cmd = cmd;
+	if (node->input_size + node->output_size < input_size + 1)
+		actual_node->inputs = node->inputs = node->inputs ? ccrealloc(node->inputs, sizeof(int) * (input_size + 1)) : ccmalloc(sizeof(int) * (input_size + 1));
+	actual_node->outputs = node->outputs = node->inputs + input_size;
+	actual_node->input_size = node->input_size = input_size;
+	actual_node->output_size = node->output_size = 1;
+	memcpy(node->inputs, inputs, sizeof(int) * input_size);
+	node->outputs[0] = output;
+}
+
+// Check the extra inputs of the fused execs are not computed after the first exec (through the edges).
+static int _ccv_nnc_kernel_fusion_can_reorder(const ccv_nnc_symbolic_graph_simplify_t* const simplify, ccv_nnc_kernel_fusion_t* const fusion, const int* const fusing_execs, const int fusing_exec_size)
+{
+	int i, j;
+	for (i = 1; i < fusing_exec_size; i++)
+	{
+		const ccv_nnc_graph_exec_symbol_info_t* const fusing_node = simplify->exec_symbol_info + fusing_execs[i];
+		for (j = 0; j < fusing_node->input_size; j++)
+		{
+			const int d = fusing_node->inputs[j];
+			if (d >= 0 && simplify->output_execs[d] >= 0 && simplify->output_execs[d] != fusing_execs[i - 1] &&
+				_ccv_nnc_kernel_fusion_is_reachable(simplify, fusion, fusing_execs[0], simplify->output_execs[d]))
+				return 0;
+		}
+	}
+	return 1;
+}
+
+static int _ccv_nnc_kernel_fusion_conv(ccv_nnc_symbolic_graph_simplify_t* const simplify, ccv_nnc_kernel_fusion_t* const fusion, const ccv_nnc_tensor_symbol_t* const outputs, const int output_size, const int idx)
+{
+	const ccv_nnc_graph_exec_symbol_info_t* const node = simplify->exec_symbol_info + idx;
+	if (node->cmd.info.convolution.groups != 1 || node->input_size < 2 || node->output_size != 1)
+		return 0;
+	int i;
+	for (i = 0; i < ccv_min(node->input_size, 3); i++)
+		if ((i < 2 || node->inputs[i] >= 0) && !_ccv_nnc_kernel_fusion_is_plain_tensor(simplify, fusion, node->inputs[i]))
+			return 0;
+	if (simplify->tensor_symbol_info[node->inputs[0]].info.format != CCV_TENSOR_FORMAT_NHWC)
+		return 0;
+	int fusing_execs[3] = { idx };
+	int fusing_exec_size = 1;
+	int inputs[7] = { node->inputs[0], node->inputs[1], node->input_size > 2 ? node->inputs[2] : CCV_NNC_NO_TENSOR_SYMBOL, CCV_NNC_NO_TENSOR_SYMBOL, CCV_NNC_NO_TENSOR_SYMBOL, CCV_NNC_NO_TENSOR_SYMBOL, CCV_NNC_NO_TENSOR_SYMBOL };
+	int input_size = inputs[2] >= 0 ? 3 : 2;
+	float epsilon = 0;
+	uint32_t activation = 0;
+	int output = node->outputs[0];
+	if (!_ccv_nnc_kernel_fusion_is_intermediate(simplify, fusion, outputs, output_size, output))
+		return 0;
+	int next = fusion->consumers[output];
+	const ccv_nnc_graph_exec_symbol_info_t* next_node = simplify->exec_symbol_info + next;
+	// Batch norm in test mode, which is a per channel scale and shift.
+	if (_ccv_nnc_kernel_fusion_is_fusible_exec(simplify, next) && next_node->cmd.cmd == CCV_NNC_BATCH_NORM_FORWARD &&
+		next_node->cmd.info.bnorm.is_test && next_node->input_size == 5 && next_node->inputs[0] == output)
+	{
+		const int nd = ccv_nnc_tensor_nd(simplify->tensor_symbol_info[output].info.dim);
+		int flag = (next_node->cmd.info.bnorm.count == nd - 1);
+		for (i = 0; flag && i < nd - 1; i++)
+			flag = (next_node->cmd.info.bnorm.axis[i] == i);
+		for (i = 1; flag && i < 5; i++)
+			flag = _ccv_nnc_kernel_fusion_is_plain_tensor(simplify, fusion, next_node->inputs[i]);
+		for (i = 1; flag && i < next_node->output_size; i++)
+			flag = _ccv_nnc_kernel_fusion_is_unused(simplify, fusion, outputs, output_size, next_node->outputs[i]);
+		if (flag && _ccv_nnc_kernel_fusion_is_plain_tensor(simplify, fusion, next_node->outputs[0]))
+		{
+			for (i = 1; i < 5; i++)
+				inputs[i + 2] = next_node->inputs[i];
+			input_size = 7;
+			epsilon = next_node->cmd.info.bnorm.epsilon;
+			fusing_execs[fusing_exec_size++] = next;
+			output = next_node->outputs[0];
+			next = _ccv_nnc_kernel_fusion_is_intermediate(simplify, fusion, outputs, output_size, output) ? fusion->consumers[output] : -1;
+			next_node = next >= 0 ? simplify->exec_symbol_info + next : 0;
+		}
+	}
+	if (_ccv_nnc_kernel_fusion_is_fusible_exec(simplify, next) && _ccv_nnc_kernel_fusion_is_activation(next_node->cmd.cmd) &&
+		next_node->input_size == 1 && next_node->output_size == 1 && next_node->inputs[0] == output &&
+		_ccv_nnc_kernel_fusion_is_plain_tensor(simplify, fusion, next_node->outputs[0]))
+	{
+		activation = next_node->cmd.cmd;
+		fusing_execs[fusing_exec_size++] = next;
+		output = next_node->outputs[0];
+	}
+	if (fusing_exec_size < 2 || !_ccv_nnc_kernel_fusion_can_reorder(simplify, fusion, fusing_execs, fusing_exec_size))
+		return 0;
+	ccv_nnc_cmd_param_t params = {
+		.size = node->cmd.info.size,
+	};
+	params.fused.count = node->cmd.info.convolution.count;
+	params.fused.activation = activation;
+	params.fused.epsilon = epsilon;
+	_ccv_nnc_kernel_fusion_rewrite(simplify, fusion, ccv_nnc_cmd(CCV_NNC_FUSED_CONVOLUTION_FORWARD, 0, params, 0), fusing_execs, fusing_exec_size, inputs, input_size, output);
+	return 1;
+}
+
+static int _ccv_nnc_kernel_fusion_gemm(ccv_nnc_symbolic_graph_simplify_t* const simplify, ccv_nnc_kernel_fusion_t* const fusion, const ccv_nnc_tensor_symbol_t* const outputs, const int output_size, const int idx)
+{
+	const ccv_nnc_graph_exec_symbol_info_t* const node = simplify->exec_symbol_info + idx;
+	if (node->input_size < 2 || node->input_size > 3 || node->output_size != 1)
+		return 0;
+	// Only b = a * w^T + bias, that is what the fused kernel computes.
+	const ccv_nnc_cmd_param_t info = node->cmd.info;
+	if (info.blas.transpose_a[0] != info.blas.transpose_a[1] ||
+		!((info.blas.transpose_b[0] == 0 && info.blas.transpose_b[1] == 1) || (info.blas.transpose_b[0] == 1 && info.blas.transpose_b[1] == 0)))
+		return 0;
+	int i;
+	for (i = 0; i < node->input_size; i++)
+		if ((i < 2 || node->inputs[i] >= 0) && !_ccv_nnc_kernel_fusion_is_plain_tensor(simplify, fusion, node->inputs[i]))
+			return 0;
+	if (ccv_nnc_tensor_nd(simplify->tensor_symbol_info[node->inputs[0]].info.dim) > 2 ||
+		ccv_nnc_tensor_nd(simplify->tensor_symbol_info[node->inputs[1]].info.dim) != 2 ||
+		(node->input_size > 2 && node->inputs[2] >= 0 && ccv_nnc_tensor_nd(simplify->tensor_symbol_info[node->inputs[2]].info.dim) > 1))
+		return 0;
+	const int output = node->outputs[0];
+	if (!_ccv_nnc_kernel_fusion_is_intermediate(simplify, fusion, outputs, output_size, output))
+		return 0;
+	const int next = fusion->consumers[output];
+	const ccv_nnc_graph_exec_symbol_info_t* const next_node = simplify->exec_symbol_info + next;
+	if (!_ccv_nnc_kernel_fusion_is_fusible_exec(simplify, next) || !_ccv_nnc_kernel_fusion_is_activation(next_node->cmd.cmd) ||
+		next_node->input_size != 1 || next_node->output_size != 1 || next_node->inputs[0] != output ||
+		!_ccv_nnc_kernel_fusion_is_plain_tensor(simplify, fusion, next_node->outputs[0]))
+		return 0;
+	const int fusing_execs[2] = { idx, next };
+	const int inputs[3] = { node->inputs[0], node->inputs[1], node->input_size > 2 ? node->inputs[2] : CCV_NNC_NO_TENSOR_SYMBOL };
+	_ccv_nnc_kernel_fusion_rewrite(simplify, fusion, CMD_FUSED_GEMM_FORWARD(next_node->cmd.cmd), fusing_execs, 2, inputs, inputs[2] >= 0 ? 3 : 2, next_node->outputs[0]);
+	return 1;
+}
+
+static int _ccv_nnc_kernel_fusion_ew_op(const ccv_nnc_symbolic_graph_simplify_t* const simplify, const ccv_nnc_kernel_fusion_t* const fusion, const int idx, const int v, const int count)
+{
+	if (!_ccv_nnc_kernel_fusion_is_fusible_exec(simplify, idx))
+		return 0;
+	const ccv_nnc_graph_exec_symbol_info_t* const node = simplify->exec_symbol_info + idx;
+	if (node->output_size != 1 || !_ccv_nnc_kernel_fusion_is_plain_tensor(simplify, fusion, node->outputs[0]) ||
+		ccv_nnc_tensor_count(simplify->tensor_symbol_info[node->outputs[0]].info) != count)
+		return 0;
+	int i;
+	switch (node->cmd.cmd)
+	{
+		case CCV_NNC_EWSUM_FORWARD:
+		case CCV_NNC_EWPROD_FORWARD:
+			if (node->input_size != 2 || (node->inputs[0] != v && node->inputs[1] != v))
+				return 0;
+			for (i = 0; i < 2; i++)
+				if (!_ccv_nnc_kernel_fusion_is_plain_tensor(simplify, fusion, node->inputs[i]) ||
+					ccv_nnc_tensor_count(simplify->tensor_symbol_info[node->inputs[i]].info) != count)
+					return 0;
+			return 2;
+		case CCV_NNC_EWEXP_FORWARD:
+		case CCV_NNC_EWLOG_FORWARD:
+		case CCV_NNC_EWSQRT_FORWARD:
+		case CCV_NNC_RELU_FORWARD:
+		case CCV_NNC_SIGMOID_FORWARD:
+		case CCV_NNC_SWISH_FORWARD:
+			if (node->input_size != 1 || node->inputs[0] != v)
+				return 0;
+			return 1;
+	}
+	return 0;
+}
+
+static int _ccv_nnc_kernel_fusion_ew(ccv_nnc_symbolic_graph_simplify_t* const simplify, ccv_nnc_kernel_fusion_t* const fusion, const ccv_nnc_tensor_symbol_t* const outputs, const int output_size, const int idx)
+{
+	const ccv_nnc_graph_exec_symbol_info_t* const node = simplify->exec_symbol_info + idx;
+	if (node->input_size < 1 || node->inputs[0] < 0 || node->output_size != 1 || node->outputs[0] < 0)
+		return 0;
+	const int count = ccv_nnc_tensor_count(simplify->tensor_symbol_info[node->outputs[0]].info);
+	if (!_ccv_nnc_kernel_fusion_is_plain_tensor(simplify, fusion, node->inputs[0]) || !_ccv_nnc_kernel_fusion_ew_op(simplify, fusion, idx, node->inputs[0], count))
+		return 0;
+	int fusing_execs[CCV_NNC_MAX_FUSED_OPS];
+	int inputs[CCV_NNC_MAX_FUSED_OPS + 1];
+	ccv_nnc_cmd_param_t params = {
+		.size = {
+			.dim = { 1, 1, 1 }
+		},
+	};
+	int input_size = 0;
+	int v = CCV_NNC_NO_TENSOR_SYMBOL;
+	int next = idx;
+	do {
+		const ccv_nnc_graph_exec_symbol_info_t* const next_node = simplify->exec_symbol_info + next;
+		if (v < 0) // The first one.
+		{
+			inputs[input_size++] = next_node->inputs[0];
+			if (next_node->input_size == 2)
+				inputs[input_size++] = next_node->inputs[1];
+		} else if (next_node->input_size == 2) // The value passed along is one of the operands, these are commutative.
+			inputs[input_size++] = next_node->inputs[0] == v ? next_node->inputs[1] : next_node->inputs[0];
+		fusing_execs[params.fused.op_count] = next;
+		params.fused.ops[params.fused.op_count++] = next_node->cmd.cmd;
+		v = next_node->outputs[0];
+		next = _ccv_nnc_kernel_fusion_is_intermediate(simplify, fusion, outputs, output_size, v) ? fusion->consumers[v] : -1;
+	} while (params.fused.op_count < CCV_NNC_MAX_FUSED_OPS && next >= 0 && _ccv_nnc_kernel_fusion_ew_op(simplify, fusion, next, v, count));
+	if (params.fused.op_count < 2 || !_ccv_nnc_kernel_fusion_can_reorder(simplify, fusion, fusing_execs, params.fused.op_count))
+		return 0;
+	_ccv_nnc_kernel_fusion_rewrite(simplify, fusion, ccv_nnc_cmd(CCV_NNC_FUSED_EW_FORWARD, 0, params, 0), fusing_execs, params.fused.op_count, inputs, input_size, v);
+	return 1;
+}
+
+static void _ccv_nnc_symbolic_graph_kernel_fusion(ccv_nnc_symbolic_graph_simplify_t* const simplify, const ccv_nnc_tensor_symbol_t* const outputs, const int output_size)
+{
+	ccv_nnc_kernel_fusion_t fusion;
+	fusion.consumers = (int*)ccmalloc(sizeof(int) * (simplify->tensor_symbol_info_size + simplify->exec_symbol_info_size));
+	fusion.order = fusion.consumers + simplify->tensor_symbol_info_size;
+	fusion.aliased = (uint32_t*)cccalloc(((simplify->tensor_symbol_info_size + 31) >> 5) + ((simplify->exec_symbol_info_size + 31) >> 5), sizeof(uint32_t));
+	fusion.visited = fusion.aliased + ((simplify->tensor_symbol_info_size + 31) >> 5);
+	fusion.stack = ccv_array_new(sizeof(int), 0, 0);
+	int i, j;
+	for (i = 0; i < simplify->tensor_symbol_info_size; i++)
+	{
+		fusion.consumers[i] = -1;
+		if (simplify->tensor_symbol_info[i].alias_ref)
+		{
+			const int d = simplify->tensor_symbol_info[i].alias_ref - 1;
+			fusion.aliased[d >> 5] |= (1u << (d & 0x1f));
+		}
+	}
+	for (i = 0; i < simplify->exec_symbol_info_size; i++)
+	{
+		fusion.order[i] = -1;
+		if (CCV_NNC_GRAPH_EXEC_IS_DEAD(simplify->exec_symbol_info[i].flags) || (simplify->exec_dead[i >> 5] & (1u << (i & 0x1f))))
+			continue;
+		const ccv_nnc_graph_exec_symbol_info_t* const node = simplify->exec_symbol_info + i;
+		for (j = 0; j < node->input_size; j++)
+		{
+			const int d = node->inputs[j];
+			if (d >= 0)
+				fusion.consumers[d] = fusion.consumers[d] == -1 ? i : -2;
+		}
+		if (node->flags & CCV_NNC_GRAPH_EXEC_P_WHILE)
+			for (j = 0; j < node->p_while.input_size; j++)
+			{
+				const int d = node->p_while.inputs[j];
+				if (d >= 0)
+					fusion.consumers[d] = -2;
+			}
+	}
+	_ccv_nnc_symbolic_graph_simplify_update_output_execs(simplify);
+	int order = 0;
+	ccv_nnc_graph_visit_for(simplify->visit, simplify->exec_symbol_info, node, idx) {
+		fusion.order[idx] = order++;
+	} ccv_nnc_graph_visit_endfor
+	ccv_nnc_graph_visit_for(simplify->visit, simplify->exec_symbol_info, node, idx) {
+		if (!_ccv_nnc_kernel_fusion_is_fusible_exec(simplify, idx))
+			continue;
+		switch (node->cmd.cmd)
+		{
+			case CCV_NNC_CONVOLUTION_FORWARD:
+				_ccv_nnc_kernel_fusion_conv(simplify, &fusion, outputs, output_size, idx);
+				break;
+			case CCV_NNC_GEMM_FORWARD:
+				_ccv_nnc_kernel_fusion_gemm(simplify, &fusion, outputs, output_size, idx);
+				break;
+			default:
+				_ccv_nnc_kernel_fusion_ew(simplify, &fusion, outputs, output_size, idx);
+				break;
+		}
+	} ccv_nnc_graph_visit_endfor
+	ccv_array_free(fusion.stack);
+	ccfree(fusion.aliased);
+	ccfree(fusion.consumers);
+}
+
 static void _ccv_nnc_symbolic_graph_ops_fusion(ccv_nnc_symbolic_graph_simplify_t* const simplify, const ccv_nnc_tensor_symbol_t* const outputs, const int output_size)
 {
 	uint32_t* const exec_dead = simplify->exec_dead;
@@ -708,6 +1113,7 @@ static void _ccv_nnc_symbolic_graph_ops_fusion(ccv_nnc_symbolic_graph_simplify_t
 			}
 		}
 	} ccv_nnc_graph_visit_endfor
+	_ccv_nnc_symbolic_graph_kernel_fusion(simplify, outputs, output_size);
 }
 
 static void _ccv_nnc_symbolic_graph_pruning_undead_exec(ccv_nnc_symbolic_graph_simplify_t* const simplify, const int exec_idx, uint32_t* const tensor_visited, ccv_array_t* const next)
@@ -947,6 +1353,163 @@ static void _ccv_nnc_symbolic_graph_pruning(ccv_nnc_symbolic_graph_simplify_t* c
 	ccfree(r_alias_refs);
 }
 
+static int _ccv_nnc_constant_folding_is_plain(const ccv_nnc_tensor_symbol_info_t* const tensor_info)
+{
+	if (tensor_info->alias_ref || tensor_info->assign_ref || tensor_info->r_assign_ref || tensor_info->bypass_ref || tensor_info->r_bypass_ref || tensor_info->p_ref || tensor_info->s_ref || tensor_info->pair_ref)
+		return 0;
+	if (tensor_info->flags & (CCV_NNC_TENSOR_SYMBOL_INIT_ZEROS | CCV_NNC_TENSOR_SYMBOL_INIT_ONES | CCV_NNC_TENSOR_SYMBOL_TAPE_VAR))
+		return 0;
+	// We can only evaluate on CPU for now.
+	return CCV_TENSOR_GET_MEMORY(tensor_info->info.type) == CCV_TENSOR_CPU_MEMORY && !ccv_nnc_is_tensor_auto(tensor_info->info);
+}
+
+static int _ccv_nnc_constant_folding_is_foldable(const ccv_nnc_symbolic_graph_simplify_t* const simplify, const uint32_t* const aliased_or_written, const int idx)
+{
+	const ccv_nnc_graph_exec_symbol_info_t* const node = simplify->exec_symbol_info + idx;
+	if (CCV_NNC_GRAPH_EXEC_IS_DEAD(node->flags) || node->pair_ref || node->graph_ref_size || (node->flags & (CCV_NNC_GRAPH_EXEC_CASE_OF | CCV_NNC_GRAPH_EXEC_P_WHILE)))
+		return 0;
+	// These either have side effects or are not deterministic.
+	switch (node->cmd.cmd)
+	{
+		case CCV_NNC_NOOP:
+		case CCV_NNC_CUSTOM_FORWARD:
+		case CCV_NNC_CUSTOM_BACKWARD:
+		case CCV_NNC_GRAPH_FORWARD:
+		case CCV_NNC_GRAPH_BACKWARD:
+		case CCV_NNC_RANDOM_UNIFORM_FORWARD:
+		case CCV_NNC_RANDOM_UNIFORM_BACKWARD:
+		case CCV_NNC_DROPOUT_FORWARD:
+		case CCV_NNC_DROPOUT_BACKWARD:
+			return 0;
+	}
+	int i, flag = 0;
+	for (i = 0; i < node->input_size; i++)
+	{
+		const int d = node->inputs[i];
+		if (d < 0)
+			continue;
+		// A constant that is written to, or aliased (thus, can be written to through the alias) cannot be used.
+		if (!simplify->tensor_symbol_info[d].constant || (aliased_or_written[d >> 5] & (1u << (d & 0x1f))))
+			return 0;
+		flag = 1;
+	}
+	if (!flag)
+		return 0;
+	flag = 0;
+	for (i = 0; i < node->output_size; i++)
+	{
+		const int d = node->outputs[i];
+		if (d < 0)
+			continue;
+		if (simplify->tensor_symbol_info[d].constant || !_ccv_nnc_constant_folding_is_plain(simplify->tensor_symbol_info + d) || (aliased_or_written[d >> 5] & (1u << (d & 0x1f))))
+			return 0;
+		flag = 1;
+	}
+	return flag;
+}
+
+static void _ccv_nnc_symbolic_graph_constant_folding(ccv_nnc_symbolic_graph_simplify_t* const simplify, const ccv_nnc_tensor_symbol_t* const outputs, const int output_size)
+{
+	const int tensor_symbol_info_size = simplify->tensor_symbol_info_size;
+	// The first half marks the tensors that cannot be constants (aliased, written to if it is a constant already,
+	// or written more than once), the second half marks the tensors that are written by any exec.
+	uint32_t* const aliased_or_written = (uint32_t*)cccalloc(((tensor_symbol_info_size + 31) >> 5) * 2, sizeof(uint32_t));
+	uint32_t* const written = aliased_or_written + ((tensor_symbol_info_size + 31) >> 5);
+	int i, j;
+	for (i = 0; i < tensor_symbol_info_size; i++)
+		if (simplify->tensor_symbol_info[i].alias_ref && !CCV_NNC_TENSOR_SYMBOL_IS_DEAD(simplify->tensor_symbol_info[i].flags))
+		{
+			const int d = simplify->tensor_symbol_info[i].alias_ref - 1;
+			aliased_or_written[d >> 5] |= (1u << (d & 0x1f));
+		}
+	int max_input_size = 0, max_output_size = 0;
+	for (i = 0; i < simplify->exec_symbol_info_size; i++)
+	{
+		const ccv_nnc_graph_exec_symbol_info_t* const node = simplify->exec_symbol_info + i;
+		if (CCV_NNC_GRAPH_EXEC_IS_DEAD(node->flags))
+			continue;
+		max_input_size = ccv_max(max_input_size, node->input_size);
+		max_output_size = ccv_max(max_output_size, node->output_size);
+		for (j = 0; j < node->output_size; j++)
+			if (node->outputs[j] >= 0)
+			{
+				const int d = node->outputs[j];
+				// A constant is always read-only.
+				if (simplify->tensor_symbol_info[d].constant || (written[d >> 5] & (1u << (d & 0x1f))))
+					aliased_or_written[d >> 5] |= (1u << (d & 0x1f));
+				written[d >> 5] |= (1u << (d & 0x1f));
+			}
+	}
+	ccv_nnc_tensor_t** const tensors = (ccv_nnc_tensor_t**)ccmalloc(sizeof(ccv_nnc_tensor_t*) * (max_input_size + max_output_size));
+	ccv_nnc_tensor_t** const input_tensors = tensors;
+	ccv_nnc_tensor_t** const output_tensors = tensors + max_input_size;
+	int folded = 0;
+	// Visit in topological order, thus, a chain of commands on constants can be folded in one pass.
+	ccv_nnc_graph_visit_for(simplify->visit, simplify->exec_symbol_info, node, idx) {
+		if (simplify->exec_dead[idx >> 5] & (1u << (idx & 0x1f)))
+			continue;
+		if (!_ccv_nnc_constant_folding_is_foldable(simplify, aliased_or_written, idx))
+			continue;
+		for (i = 0; i < node->input_size; i++)
+			input_tensors[i] = node->inputs[i] >= 0 ? simplify->tensor_symbol_info[node->inputs[i]].constant : 0;
+		for (i = 0; i < node->output_size; i++)
+			output_tensors[i] = node->outputs[i] >= 0 ? ccv_nnc_tensor_new(0, simplify->tensor_symbol_info[node->outputs[i]].info, 0) : 0;
+		if (ccv_nnc_cmd_exec(node->cmd, node->hint, 0, input_tensors, node->input_size, output_tensors, node->output_size, 0) != CCV_NNC_EXEC_SUCCESS)
+		{
+			for (i = 0; i < node->output_size; i++)
+				if (output_tensors[i])
+					ccv_nnc_tensor_free(output_tensors[i]);
+			continue;
+		}
+		// The outputs are constants now, the exec is no longer needed.
+		for (i = 0; i < node->output_size; i++)
+			if (node->outputs[i] >= 0)
+			{
+				const int d = node->outputs[i];
+				ccv_nnc_tensor_symbol_info_t* const tensor_info = (ccv_nnc_tensor_symbol_info_t*)ccv_array_get(simplify->graph->tensor_symbol_info, d);
+				tensor_info->info = simplify->tensor_symbol_info[d].info;
+				tensor_info->constant = simplify->tensor_symbol_info[d].constant = output_tensors[i];
+			}
+		simplify->exec_dead[idx >> 5] |= (1u << (idx & 0x1f));
+		folded = 1;
+	} ccv_nnc_graph_visit_endfor
+	ccfree(tensors);
+	if (folded)
+	{
+		// Constants that are not used by any commands or as outputs are no longer needed.
+		memset(written, 0, sizeof(uint32_t) * ((tensor_symbol_info_size + 31) >> 5));
+		uint32_t* const used = written;
+		for (i = 0; i < simplify->exec_symbol_info_size; i++)
+		{
+			const ccv_nnc_graph_exec_symbol_info_t* const node = simplify->exec_symbol_info + i;
+			if (CCV_NNC_GRAPH_EXEC_IS_DEAD(node->flags) || (simplify->exec_dead[i >> 5] & (1u << (i & 0x1f))))
+				continue;
+			for (j = 0; j < node->input_size; j++)
+				if (node->inputs[j] >= 0)
+					used[node->inputs[j] >> 5] |= (1u << (node->inputs[j] & 0x1f));
+			for (j = 0; j < node->output_size; j++)
+				if (node->outputs[j] >= 0)
+					used[node->outputs[j] >> 5] |= (1u << (node->outputs[j] & 0x1f));
+			if (node->flags & CCV_NNC_GRAPH_EXEC_P_WHILE)
+				for (j = 0; j < node->p_while.input_size; j++)
+				{
+					const int d = node->p_while.inputs[j];
+					if (d >= 0)
+						used[d >> 5] |= (1u << (d & 0x1f));
+				}
+		}
+		for (i = 0; i < output_size; i++)
+			if (outputs[i].d >= 0)
+				used[outputs[i].d >> 5] |= (1u << (outputs[i].d & 0x1f));
+		for (i = 0; i < tensor_symbol_info_size; i++)
+			if (simplify->tensor_symbol_info[i].constant && !(used[i >> 5] & (1u << (i & 0x1f))) &&
+				!(aliased_or_written[i >> 5] & (1u << (i & 0x1f))) && !simplify->tensor_symbol_info[i].s_ref)
+				simplify->tensor_dead[i >> 5] |= (1u << (i & 0x1f));
+		_ccv_nnc_symbolic_graph_simplify_update_output_execs(simplify);
+	}
+	ccfree(aliased_or_written);
+}
+
 void ccv_nnc_symbolic_graph_simplify(ccv_nnc_symbolic_graph_t* const graph, const int* const passes, const int pass_size, const ccv_nnc_tensor_symbol_t* const outputs, const int output_size, const ccv_nnc_graph_exec_symbol_t* const sources, const int source_size, const ccv_nnc_graph_exec_symbol_t* const destinations, const int destination_size)
 {
 	ccv_nnc_symbolic_graph_simplify_t* const simplify = _ccv_nnc_symbolic_graph_simplify_new(graph, sources, source_size, destinations, destination_size);
@@ -966,6 +1529,9 @@ void ccv_nnc_symbolic_graph_simplify(ccv_nnc_symbolic_graph_t* const graph, cons
 			case CCV_NNC_SIMPLIFY_OPS_FUSION:
 				_ccv_nnc_symbolic_graph_ops_fusion(simplify, outputs, output_size);
 				break;
+			case CCV_NNC_SIMPLIFY_CONSTANT_FOLDING:
+				_ccv_nnc_symbolic_graph_constant_folding(simplify, outputs, output_size);
+				break;
 		}
 	_ccv_nnc_symbolic_graph_simplify_apply(simplify);
 	_ccv_nnc_symbolic_graph_simplify_free(simplify);
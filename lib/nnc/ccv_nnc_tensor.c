@@ -79,6 +79,7 @@ ccv_nnc_tensor_t* ccv_nnc_tensor_resize(ccv_nnc_tensor_t* const tensor, const cc
 	assert(CCV_TENSOR_GET_DEVICE(params.type) == CCV_TENSOR_GET_DEVICE(tensor->info.type));
 	const size_t size = ccv_nnc_tensor_data_size(params);
 	const int tfb = (CCV_TENSOR_GET_MEMORY(params.type) == CCV_TENSOR_CPU_MEMORY && params.format == CCV_TENSOR_FORMAT_NHWC && params.dim[2] > 0 && params.dim[2] <= CCV_MAX_CHANNEL && params.dim[0] > 0 && params.dim[1] > 0 && params.dim[3] == 0);
+	ccv_nnc_tensor_data_touch(tensor);
 	tensor->info = params;
 #ifdef HAVE_CUDA
 	const int pinned_mem = (tensor->type & CCV_PINNED_MEM);
@@ -174,6 +175,7 @@ int ccv_nnc_tensor_pin_memory(ccv_nnc_tensor_t* const tensor)
 
 void ccv_nnc_tensor_free(ccv_nnc_tensor_t* const tensor)
 {
+	ccv_nnc_tensor_data_touch(tensor);
 #ifdef HAVE_CUDA
 	if (CCV_TENSOR_GET_MEMORY(tensor->info.type) == CCV_TENSOR_GPU_MEMORY &&
 		!(tensor->type & CCV_NO_DATA_ALLOC)) // If this is GPU memory and it is allocated, free.
@@ -4,6 +4,14 @@
 #include "ccv_internal.h"
 #include "_ccv_nnc_symbolic_graph.h"
 #include "3rdparty/sqlite3/sqlite3.h"
+#include "3rdparty/khash/khash.h"
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #ifdef HAVE_CUDA
 #include "gpu/ccv_nnc_compat.h"
 #endif
@@ -16,10 +24,71 @@
 
 // MARK - Level-1 API
 
-int ccv_nnc_tensor_write(const ccv_nnc_tensor_t* const tensor, void* const handle, const char* const name)
+// The codec identifier is stored in the upper 32-bit of the type column, thus, tensors written without compression
+// are bit-compatible with the ones written before.
+#define CCV_NNC_TENSOR_CODEC_NONE (0)
+#define CCV_NNC_TENSOR_CODEC_SHUFFLE_DEFLATE (1)
+
+static void* _ccv_nnc_tensor_encode(const void* const data, const size_t data_size, const int element_size, size_t* const encoded_size)
+{
+#ifdef HAVE_ZLIB
+	// Shuffle bytes by their position in an element first, bytes such as exponents are much more alike than
+	// the elements themselves, then deflate with the fastest setting.
+	uint8_t* const shuffled = (uint8_t*)ccmalloc(data_size);
+	const size_t count = data_size / element_size;
+	const uint8_t* const u8 = (const uint8_t*)data;
+	size_t i;
+	int j;
+	for (j = 0; j < element_size; j++)
+		for (i = 0; i < count; i++)
+			shuffled[j * count + i] = u8[i * element_size + j];
+	memcpy(shuffled + count * element_size, u8 + count * element_size, data_size - count * element_size);
+	uLongf size = compressBound(data_size);
+	void* const encoded = ccmalloc(size);
+	const int status = compress2((Bytef*)encoded, &size, shuffled, data_size, Z_BEST_SPEED);
+	ccfree(shuffled);
+	// Not worth it if it doesn't save anything.
+	if (status != Z_OK || size >= data_size)
+	{
+		ccfree(encoded);
+		return 0;
+	}
+	*encoded_size = size;
+	return encoded;
+#else
+	return 0;
+#endif
+}
+
+static int _ccv_nnc_tensor_decode(const int codec, const void* const encoded, const size_t encoded_size, const int element_size, void* const data, const size_t data_size)
+{
+#ifdef HAVE_ZLIB
+	if (codec != CCV_NNC_TENSOR_CODEC_SHUFFLE_DEFLATE)
+		return -1;
+	uint8_t* const shuffled = (uint8_t*)ccmalloc(data_size);
+	uLongf size = data_size;
+	if (uncompress(shuffled, &size, (const Bytef*)encoded, encoded_size) != Z_OK || size != data_size)
+	{
+		ccfree(shuffled);
+		return -1;
+	}
+	const size_t count = data_size / element_size;
+	uint8_t* const u8 = (uint8_t*)data;
+	size_t i;
+	int j;
+	for (j = 0; j < element_size; j++)
+		for (i = 0; i < count; i++)
+			u8[i * element_size + j] = shuffled[j * count + i];
+	memcpy(u8 + count * element_size, shuffled + count * element_size, data_size - count * element_size);
+	ccfree(shuffled);
+	return 0;
+#else
+	return -1;
+#endif
+}
+
+int ccv_nnc_tensors_write(const ccv_nnc_tensor_t* const* const tensors, const char* const* const names, const int tensor_size, void* const handle, const int flags)
 {
-	assert(!CCV_IS_TENSOR_VIEW(tensor));
-	assert(name);
 	sqlite3* conn = (sqlite3*)handle;
 	if (!conn)
 		return CCV_IO_ERROR;
@@ -33,61 +102,84 @@ int ccv_nnc_tensor_write(const ccv_nnc_tensor_t* const tensor, void* const handl
 		"$name, $type, $format, $datatype, $dim, $data)";
 	sqlite3_stmt* tensor_insert_stmt = 0;
 	SQLITE_ENFORCE(SQLITE_OK == sqlite3_prepare_v2(conn, tensor_insert_qs, sizeof(tensor_insert_qs), &tensor_insert_stmt, 0));
-	sqlite3_bind_text(tensor_insert_stmt, 1, name, -1, 0);
-	sqlite3_bind_int(tensor_insert_stmt, 2, tensor->info.type);
-	sqlite3_bind_int(tensor_insert_stmt, 3, tensor->info.format);
-	sqlite3_bind_int(tensor_insert_stmt, 4, tensor->info.datatype);
-	sqlite3_bind_blob(tensor_insert_stmt, 5, tensor->info.dim, sizeof(tensor->info.dim), 0);
-	const size_t data_size = ccv_nnc_tensor_data_size(tensor->info);
-	void* workspace = 0;
-#ifdef HAVE_CUDA
-	if (CCV_TENSOR_GET_MEMORY(tensor->info.type) == CCV_TENSOR_GPU_MEMORY)
+	int i;
+	// Get the data to the host first.
+	const void** const data = (const void**)cccalloc(tensor_size * 2, sizeof(void*));
+	void** const workspaces = (void**)(data + tensor_size);
+	for (i = 0; i < tensor_size; i++)
 	{
-		workspace = ccmalloc(data_size);
-		cumemcpy(workspace, CCV_TENSOR_CPU_MEMORY, tensor->data.u8, tensor->info.type, data_size);
-		sqlite3_bind_blob(tensor_insert_stmt, 6, workspace, data_size, 0);
-	} else
-		sqlite3_bind_blob(tensor_insert_stmt, 6, tensor->data.u8, data_size, 0);
-#else
-	sqlite3_bind_blob(tensor_insert_stmt, 6, tensor->data.u8, data_size, 0);
+		const ccv_nnc_tensor_t* const tensor = tensors[i];
+		assert(!CCV_IS_TENSOR_VIEW(tensor));
+		assert(names[i]);
+		data[i] = tensor->data.u8;
+#ifdef HAVE_CUDA
+		if (CCV_TENSOR_GET_MEMORY(tensor->info.type) == CCV_TENSOR_GPU_MEMORY)
+		{
+			const size_t data_size = ccv_nnc_tensor_data_size(tensor->info);
+			workspaces[i] = ccmalloc(data_size);
+			cumemcpy(workspaces[i], CCV_TENSOR_CPU_MEMORY, tensor->data.u8, tensor->info.type, data_size);
+			data[i] = workspaces[i];
+		}
 #endif
-	sqlite3_step(tensor_insert_stmt);
-	sqlite3_reset(tensor_insert_stmt);
-	sqlite3_clear_bindings(tensor_insert_stmt);
+	}
+	void** encoded = 0;
+	size_t* encoded_sizes = 0;
+	if (flags & CCV_NNC_TENSOR_WRITE_COMPRESS)
+	{
+		encoded = (void**)cccalloc(tensor_size, sizeof(void*) + sizeof(size_t));
+		encoded_sizes = (size_t*)(encoded + tensor_size);
+		// This only runs in parallel with OpenMP (USE_OPENMP), otherwise it is a plain loop.
+		parallel_for(i, tensor_size) {
+			const ccv_nnc_tensor_t* const tensor = tensors[i];
+			encoded[i] = _ccv_nnc_tensor_encode(data[i], ccv_nnc_tensor_data_size(tensor->info), CCV_GET_DATA_TYPE_SIZE(tensor->info.datatype), encoded_sizes + i);
+		} parallel_endfor
+	}
+	// Batch all of them in one transaction unless the caller already started one.
+	const int autocommit = sqlite3_get_autocommit(conn);
+	if (autocommit)
+		SQLITE_ENFORCE(SQLITE_OK == sqlite3_exec(conn, "BEGIN", 0, 0, 0));
+	int result = CCV_IO_FINAL;
+	for (i = 0; i < tensor_size; i++)
+	{
+		const ccv_nnc_tensor_t* const tensor = tensors[i];
+		const int codec = encoded && encoded[i] ? CCV_NNC_TENSOR_CODEC_SHUFFLE_DEFLATE : CCV_NNC_TENSOR_CODEC_NONE;
+		sqlite3_bind_text(tensor_insert_stmt, 1, names[i], -1, 0);
+		sqlite3_bind_int64(tensor_insert_stmt, 2, ((sqlite3_int64)codec << 32) | (uint32_t)tensor->info.type);
+		sqlite3_bind_int(tensor_insert_stmt, 3, tensor->info.format);
+		sqlite3_bind_int(tensor_insert_stmt, 4, tensor->info.datatype);
+		sqlite3_bind_blob(tensor_insert_stmt, 5, tensor->info.dim, sizeof(tensor->info.dim), 0);
+		if (codec == CCV_NNC_TENSOR_CODEC_NONE)
+			sqlite3_bind_blob(tensor_insert_stmt, 6, data[i], ccv_nnc_tensor_data_size(tensor->info), 0);
+		else
+			sqlite3_bind_blob(tensor_insert_stmt, 6, encoded[i], encoded_sizes[i], 0);
+		if (SQLITE_DONE != sqlite3_step(tensor_insert_stmt))
+			result = CCV_IO_ERROR;
+		sqlite3_reset(tensor_insert_stmt);
+		sqlite3_clear_bindings(tensor_insert_stmt);
+	}
+	if (autocommit)
+		SQLITE_ENFORCE(SQLITE_OK == sqlite3_exec(conn, "COMMIT", 0, 0, 0));
 	sqlite3_finalize(tensor_insert_stmt);
-	if (workspace)
-		free(workspace);
-	return CCV_IO_FINAL;
+	for (i = 0; i < tensor_size; i++)
+	{
+		if (workspaces[i])
+			ccfree(workspaces[i]);
+		if (encoded && encoded[i])
+			ccfree(encoded[i]);
+	}
+	ccfree(data);
+	if (encoded)
+		ccfree(encoded);
+	return result;
 }
 
-int ccv_nnc_tensor_read(void* const handle, const char* const name, ccv_nnc_tensor_t** const tensor_out)
+int ccv_nnc_tensor_write(const ccv_nnc_tensor_t* const tensor, void* const handle, const char* const name)
+{
+	return ccv_nnc_tensors_write(&tensor, &name, 1, handle, 0);
+}
+
+static void _ccv_nnc_tensor_read_data(ccv_nnc_tensor_t* const tensor, const int datatype, const void* const data, const size_t data_size)
 {
-	assert(name);
-	sqlite3* conn = (sqlite3*)handle;
-	if (!conn)
-		return CCV_IO_ERROR;
-	const char tensor_select_qs[] =
-		"SELECT data, type, format, datatype, dim FROM tensors WHERE name=$name";
-	sqlite3_stmt* tensor_select_stmt = 0;
-	if (SQLITE_OK != sqlite3_prepare_v2(conn, tensor_select_qs, sizeof(tensor_select_qs), &tensor_select_stmt, 0))
-		return CCV_IO_ERROR;
-	sqlite3_bind_text(tensor_select_stmt, 1, name, -1, 0);
-	if (SQLITE_ROW != sqlite3_step(tensor_select_stmt))
-		return CCV_IO_ERROR;
-	ccv_nnc_tensor_t* tensor = *tensor_out;
-	int datatype = 0;
-	if (!tensor) // If the tensor is not provided, we need to create one.
-	{
-		ccv_nnc_tensor_param_t info;
-		info.type = sqlite3_column_int(tensor_select_stmt, 1);
-		info.format = sqlite3_column_int(tensor_select_stmt, 2);
-		datatype = info.datatype = sqlite3_column_int(tensor_select_stmt, 3);
-		const void* const dim = sqlite3_column_blob(tensor_select_stmt, 4);
-		memcpy(info.dim, dim, ccv_min(sizeof(info.dim), sqlite3_column_bytes(tensor_select_stmt, 4)));
-		*tensor_out = tensor = ccv_nnc_tensor_new(0, info, 0);
-	} else
-		datatype = sqlite3_column_int(tensor_select_stmt, 3);
-	const void* const data = sqlite3_column_blob(tensor_select_stmt, 0);
 	if (datatype != tensor->info.datatype)
 	{
 		// Only ever works for 16F to 32F or 32F to 16F transparently.
@@ -96,41 +188,311 @@ int ccv_nnc_tensor_read(void* const handle, const char* const name, ccv_nnc_tens
 #ifdef HAVE_CUDA
 		if (CCV_TENSOR_GET_MEMORY(tensor->info.type) == CCV_TENSOR_GPU_MEMORY)
 		{
-			size_t data_size = ccv_nnc_tensor_data_size(tensor->info);
-			void* const workspace = ccmalloc(data_size);
+			const size_t tensor_data_size = ccv_nnc_tensor_data_size(tensor->info);
+			void* const workspace = ccmalloc(tensor_data_size);
 			if (datatype == CCV_16F && tensor->info.datatype == CCV_32F)
-				ccv_half_precision_to_float((uint16_t*)data, (float*)workspace, ccv_min(tensor_count, sqlite3_column_bytes(tensor_select_stmt, 0) / sizeof(uint16_t)));
+				ccv_half_precision_to_float((uint16_t*)data, (float*)workspace, ccv_min(tensor_count, data_size / sizeof(uint16_t)));
 			else
-				ccv_float_to_half_precision((float*)data, (uint16_t*)workspace, ccv_min(tensor_count, sqlite3_column_bytes(tensor_select_stmt, 0) / sizeof(float)));
+				ccv_float_to_half_precision((float*)data, (uint16_t*)workspace, ccv_min(tensor_count, data_size / sizeof(float)));
 			if (CCV_TENSOR_GET_MEMORY(tensor->info.type) == CCV_TENSOR_GPU_MEMORY)
-				cumemcpy(tensor->data.u8, tensor->info.type, workspace, CCV_TENSOR_CPU_MEMORY, data_size);
+				cumemcpy(tensor->data.u8, tensor->info.type, workspace, CCV_TENSOR_CPU_MEMORY, tensor_data_size);
 			ccfree(workspace);
 		} else {
 			if (datatype == CCV_16F && tensor->info.datatype == CCV_32F)
-				ccv_half_precision_to_float((uint16_t*)data, tensor->data.f32, ccv_min(tensor_count, sqlite3_column_bytes(tensor_select_stmt, 0) / sizeof(uint16_t)));
+				ccv_half_precision_to_float((uint16_t*)data, tensor->data.f32, ccv_min(tensor_count, data_size / sizeof(uint16_t)));
 			else
-				ccv_float_to_half_precision((float*)data, (uint16_t*)tensor->data.f16, ccv_min(tensor_count, sqlite3_column_bytes(tensor_select_stmt, 0) / sizeof(float)));
+				ccv_float_to_half_precision((float*)data, (uint16_t*)tensor->data.f16, ccv_min(tensor_count, data_size / sizeof(float)));
 		}
 #else
 		if (datatype == CCV_16F && tensor->info.datatype == CCV_32F)
-			ccv_half_precision_to_float((uint16_t*)data, tensor->data.f32, ccv_min(tensor_count, sqlite3_column_bytes(tensor_select_stmt, 0) / sizeof(uint16_t)));
+			ccv_half_precision_to_float((uint16_t*)data, tensor->data.f32, ccv_min(tensor_count, data_size / sizeof(uint16_t)));
 		else
-			ccv_float_to_half_precision((float*)data, (uint16_t*)tensor->data.f16, ccv_min(tensor_count, sqlite3_column_bytes(tensor_select_stmt, 0) / sizeof(float)));
+			ccv_float_to_half_precision((float*)data, (uint16_t*)tensor->data.f16, ccv_min(tensor_count, data_size / sizeof(float)));
 #endif
 	} else {
-		size_t data_size = ccv_nnc_tensor_data_size(tensor->info);
+		const size_t tensor_data_size = ccv_nnc_tensor_data_size(tensor->info);
 #ifdef HAVE_CUDA
 		if (CCV_TENSOR_GET_MEMORY(tensor->info.type) == CCV_TENSOR_GPU_MEMORY)
-			cumemcpy(tensor->data.u8, tensor->info.type, data, CCV_TENSOR_CPU_MEMORY, ccv_min(data_size, sqlite3_column_bytes(tensor_select_stmt, 0)));
+			cumemcpy(tensor->data.u8, tensor->info.type, data, CCV_TENSOR_CPU_MEMORY, ccv_min(tensor_data_size, data_size));
 		else
-			memcpy(tensor->data.u8, data, ccv_min(data_size, sqlite3_column_bytes(tensor_select_stmt, 0)));
+			memcpy(tensor->data.u8, data, ccv_min(tensor_data_size, data_size));
 #else
-		memcpy(tensor->data.u8, data, ccv_min(data_size, sqlite3_column_bytes(tensor_select_stmt, 0)));
+		memcpy(tensor->data.u8, data, ccv_min(tensor_data_size, data_size));
 #endif
 	}
 	tensor->type &= ~CCV_GARBAGE; // If it is marked as garbage, remove that mark now.
+	ccv_nnc_tensor_data_touch(tensor);
+}
+
+int ccv_nnc_tensor_read(void* const handle, const char* const name, ccv_nnc_tensor_t** const tensor_out)
+{
+	assert(name);
+	sqlite3* conn = (sqlite3*)handle;
+	if (!conn)
+		return CCV_IO_ERROR;
+	const char tensor_select_qs[] =
+		"SELECT data, type, format, datatype, dim FROM tensors WHERE name=$name";
+	sqlite3_stmt* tensor_select_stmt = 0;
+	if (SQLITE_OK != sqlite3_prepare_v2(conn, tensor_select_qs, sizeof(tensor_select_qs), &tensor_select_stmt, 0))
+		return CCV_IO_ERROR;
+	sqlite3_bind_text(tensor_select_stmt, 1, name, -1, 0);
+	if (SQLITE_ROW != sqlite3_step(tensor_select_stmt))
+		return CCV_IO_ERROR;
+	const sqlite3_int64 type = sqlite3_column_int64(tensor_select_stmt, 1);
+	const int codec = (int)(type >> 32);
+	ccv_nnc_tensor_param_t info;
+	memset(&info, 0, sizeof(info));
+	info.type = (int)(type & 0xffffffff);
+	info.format = sqlite3_column_int(tensor_select_stmt, 2);
+	info.datatype = sqlite3_column_int(tensor_select_stmt, 3);
+	const void* const dim = sqlite3_column_blob(tensor_select_stmt, 4);
+	memcpy(info.dim, dim, ccv_min(sizeof(info.dim), sqlite3_column_bytes(tensor_select_stmt, 4)));
+	const void* data = sqlite3_column_blob(tensor_select_stmt, 0);
+	size_t data_size = sqlite3_column_bytes(tensor_select_stmt, 0);
+	void* decoded = 0;
+	if (codec != CCV_NNC_TENSOR_CODEC_NONE)
+	{
+		data_size = ccv_nnc_tensor_data_size(info);
+		decoded = ccmalloc(data_size);
+		if (_ccv_nnc_tensor_decode(codec, data, sqlite3_column_bytes(tensor_select_stmt, 0), CCV_GET_DATA_TYPE_SIZE(info.datatype), decoded, data_size) != 0)
+		{
+			ccfree(decoded);
+			sqlite3_finalize(tensor_select_stmt);
+			return CCV_IO_ERROR;
+		}
+		data = decoded;
+	}
+	ccv_nnc_tensor_t* tensor = *tensor_out;
+	if (!tensor) // If the tensor is not provided, we need to create one.
+		*tensor_out = tensor = ccv_nnc_tensor_new(0, info, 0);
+	_ccv_nnc_tensor_read_data(tensor, info.datatype, data, data_size);
+	if (decoded)
+		ccfree(decoded);
 	sqlite3_reset(tensor_select_stmt);
 	sqlite3_clear_bindings(tensor_select_stmt);
 	sqlite3_finalize(tensor_select_stmt);
 	return CCV_IO_FINAL;
 }
+
+// MARK - Memory-mapped Tensor Container
+
+// The container is laid out as: a header in the first page, followed by the tensor data, each started at a page
+// boundary, and lastly the index, one entry per tensor followed by its name. Because the data is page aligned, the
+// whole file can be mapped once and CPU tensors can point directly to the mapped pages.
+
+#define CCV_NNC_TENSOR_MMAP_VERSION (1)
+
+static const char ccv_nnc_tensor_mmap_magic[8] = { 'C', 'C', 'V', 'N', 'N', 'C', 'M', 'M' };
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t alignment; // The page size when the container is written, all tensor data are aligned to this.
+	uint32_t max_dim; // CCV_NNC_MAX_DIM_ALLOC when the container is written.
+	uint32_t count; // Number of entries in the index.
+	uint64_t index_offset;
+	uint64_t index_size;
+} ccv_nnc_tensor_mmap_header_t;
+
+typedef struct {
+	uint64_t offset;
+	uint64_t size;
+	int32_t type;
+	int32_t format;
+	int32_t datatype;
+	int32_t dim[CCV_NNC_MAX_DIM_ALLOC];
+	uint32_t name_size; // The name follows the entry, including the terminating NUL, padded to 8 bytes.
+} ccv_nnc_tensor_mmap_entry_t;
+
+struct ccv_nnc_tensor_mmap_writer_s {
+	FILE* w;
+	uint32_t alignment;
+	uint32_t count;
+	uint64_t offset; // The end of the data written so far.
+	size_t index_size;
+	size_t index_capacity;
+	uint8_t* index;
+};
+
+KHASH_MAP_INIT_STR(tensor_mmap, const ccv_nnc_tensor_mmap_entry_t*)
+
+struct ccv_nnc_tensor_mmap_s {
+	uint8_t* data;
+	size_t size;
+	khash_t(tensor_mmap)* entries;
+};
+
+ccv_nnc_tensor_mmap_writer_t* ccv_nnc_tensor_mmap_writer_new(const char* const fn)
+{
+	FILE* const w = fopen(fn, "wb");
+	if (!w)
+		return 0;
+	ccv_nnc_tensor_mmap_writer_t* const writer = (ccv_nnc_tensor_mmap_writer_t*)cccalloc(1, sizeof(ccv_nnc_tensor_mmap_writer_t));
+	writer->w = w;
+	const long page_size = sysconf(_SC_PAGESIZE);
+	writer->alignment = page_size > 0 ? (uint32_t)page_size : 4096;
+	// The header takes the first page, it is written when the writer is freed.
+	writer->offset = writer->alignment;
+	return writer;
+}
+
+int ccv_nnc_tensor_mmap_write(ccv_nnc_tensor_mmap_writer_t* const writer, const ccv_nnc_tensor_t* const tensor, const char* const name)
+{
+	assert(!CCV_IS_TENSOR_VIEW(tensor));
+	assert(name);
+	if (!writer)
+		return CCV_IO_ERROR;
+	const size_t data_size = ccv_nnc_tensor_data_size(tensor->info);
+	const void* data = tensor->data.u8;
+	void* workspace = 0;
+#ifdef HAVE_CUDA
+	if (CCV_TENSOR_GET_MEMORY(tensor->info.type) == CCV_TENSOR_GPU_MEMORY)
+	{
+		workspace = ccmalloc(data_size);
+		cumemcpy(workspace, CCV_TENSOR_CPU_MEMORY, tensor->data.u8, tensor->info.type, data_size);
+		data = workspace;
+	}
+#endif
+	const uint64_t offset = (writer->offset + writer->alignment - 1) / writer->alignment * writer->alignment;
+	// Skip to the page boundary, the gap will read as zeros.
+	const int ok = (fseeko(writer->w, (off_t)offset, SEEK_SET) == 0 && fwrite(data, 1, data_size, writer->w) == data_size);
+	if (workspace)
+		ccfree(workspace);
+	if (!ok)
+		return CCV_IO_ERROR;
+	writer->offset = offset + data_size;
+	const size_t name_size = strlen(name) + 1;
+	const size_t entry_size = sizeof(ccv_nnc_tensor_mmap_entry_t) + ((name_size + 7) & -8);
+	if (writer->index_size + entry_size > writer->index_capacity)
+	{
+		writer->index_capacity = ccv_max(writer->index_capacity * 2, writer->index_size + entry_size);
+		writer->index = (uint8_t*)ccrealloc(writer->index, writer->index_capacity);
+	}
+	ccv_nnc_tensor_mmap_entry_t* const entry = (ccv_nnc_tensor_mmap_entry_t*)(writer->index + writer->index_size);
+	memset(entry, 0, entry_size);
+	entry->offset = offset;
+	entry->size = data_size;
+	entry->type = tensor->info.type;
+	entry->format = tensor->info.format;
+	entry->datatype = tensor->info.datatype;
+	memcpy(entry->dim, tensor->info.dim, sizeof(entry->dim));
+	entry->name_size = (uint32_t)name_size;
+	memcpy(entry + 1, name, name_size);
+	writer->index_size += entry_size;
+	++writer->count;
+	return CCV_IO_FINAL;
+}
+
+int ccv_nnc_tensor_mmap_writer_free(ccv_nnc_tensor_mmap_writer_t* const writer)
+{
+	ccv_nnc_tensor_mmap_header_t header = {
+		.version = CCV_NNC_TENSOR_MMAP_VERSION,
+		.alignment = writer->alignment,
+		.max_dim = CCV_NNC_MAX_DIM_ALLOC,
+		.count = writer->count,
+		.index_offset = (writer->offset + 7) & -8,
+		.index_size = writer->index_size,
+	};
+	memcpy(header.magic, ccv_nnc_tensor_mmap_magic, sizeof(header.magic));
+	int ok = (fseeko(writer->w, (off_t)header.index_offset, SEEK_SET) == 0 && fwrite(writer->index, 1, writer->index_size, writer->w) == writer->index_size);
+	ok = ok && fseeko(writer->w, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, writer->w) == 1;
+	ok = (fclose(writer->w) == 0) && ok;
+	if (writer->index)
+		ccfree(writer->index);
+	ccfree(writer);
+	return ok ? CCV_IO_FINAL : CCV_IO_ERROR;
+}
+
+ccv_nnc_tensor_mmap_t* ccv_nnc_tensor_mmap_new(const char* const fn)
+{
+	const int fd = open(fn, O_RDONLY);
+	if (fd < 0)
+		return 0;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(ccv_nnc_tensor_mmap_header_t))
+	{
+		close(fd);
+		return 0;
+	}
+	const size_t size = (size_t)st.st_size;
+	// Read-only and shared, thus, processes that map the same file share the same physical pages.
+	uint8_t* const data = (uint8_t*)mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); // The mapping keeps its own reference to the file.
+	if (data == MAP_FAILED)
+		return 0;
+	const ccv_nnc_tensor_mmap_header_t* const header = (const ccv_nnc_tensor_mmap_header_t*)data;
+	if (memcmp(header->magic, ccv_nnc_tensor_mmap_magic, sizeof(header->magic)) != 0 ||
+		header->version != CCV_NNC_TENSOR_MMAP_VERSION || header->max_dim != CCV_NNC_MAX_DIM_ALLOC ||
+		header->index_offset > size || header->index_size > size - header->index_offset)
+	{
+		munmap(data, size);
+		return 0;
+	}
+	ccv_nnc_tensor_mmap_t* const tensor_mmap = (ccv_nnc_tensor_mmap_t*)ccmalloc(sizeof(ccv_nnc_tensor_mmap_t));
+	tensor_mmap->data = data;
+	tensor_mmap->size = size;
+	tensor_mmap->entries = kh_init(tensor_mmap);
+	const uint8_t* index = data + header->index_offset;
+	const uint8_t* const index_end = index + header->index_size;
+	uint32_t i;
+	for (i = 0; i < header->count; i++)
+	{
+		const ccv_nnc_tensor_mmap_entry_t* const entry = (const ccv_nnc_tensor_mmap_entry_t*)index;
+		if (index_end - index < (ptrdiff_t)sizeof(ccv_nnc_tensor_mmap_entry_t))
+			break;
+		const size_t entry_size = sizeof(ccv_nnc_tensor_mmap_entry_t) + ((entry->name_size + 7) & -8);
+		const char* const name = (const char*)(entry + 1);
+		if (entry->name_size == 0 || (size_t)(index_end - index) < entry_size || name[entry->name_size - 1] != 0 ||
+			entry->offset > size || entry->size > size - entry->offset)
+			break;
+		int ret;
+		// Later entries with the same name replace the earlier ones.
+		const khiter_t k = kh_put(tensor_mmap, tensor_mmap->entries, name, &ret);
+		kh_val(tensor_mmap->entries, k) = entry;
+		index += entry_size;
+	}
+	if (i < header->count) // The index is corrupted.
+	{
+		ccv_nnc_tensor_mmap_free(tensor_mmap);
+		return 0;
+	}
+	return tensor_mmap;
+}
+
+int ccv_nnc_tensor_mmap_read(ccv_nnc_tensor_mmap_t* const tensor_mmap, const char* const name, ccv_nnc_tensor_t** const tensor_out)
+{
+	assert(name);
+	if (!tensor_mmap)
+		return CCV_IO_ERROR;
+	const khiter_t k = kh_get(tensor_mmap, tensor_mmap->entries, name);
+	if (k == kh_end(tensor_mmap->entries))
+		return CCV_IO_ERROR;
+	const ccv_nnc_tensor_mmap_entry_t* const entry = kh_val(tensor_mmap->entries, k);
+	const void* const data = tensor_mmap->data + entry->offset;
+	ccv_nnc_tensor_t* tensor = *tensor_out;
+	if (!tensor) // If the tensor is not provided, we need to create one.
+	{
+		ccv_nnc_tensor_param_t info;
+		info.type = entry->type;
+		info.format = entry->format;
+		info.datatype = entry->datatype;
+		memcpy(info.dim, entry->dim, sizeof(info.dim));
+		if (CCV_TENSOR_GET_MEMORY(info.type) == CCV_TENSOR_CPU_MEMORY && ccv_nnc_tensor_data_size(info) <= entry->size)
+		{
+			// Bind to the mapped pages directly, no copy.
+			*tensor_out = tensor = ccv_nnc_tensor_new(data, info, 0);
+			ccv_nnc_tensor_data_touch(tensor);
+			return CCV_IO_FINAL;
+		}
+		*tensor_out = tensor = ccv_nnc_tensor_new(0, info, 0);
+	}
+	_ccv_nnc_tensor_read_data(tensor, entry->datatype, data, entry->size);
+	return CCV_IO_FINAL;
+}
+
+void ccv_nnc_tensor_mmap_free(ccv_nnc_tensor_mmap_t* const tensor_mmap)
+{
+	kh_destroy(tensor_mmap, tensor_mmap->entries);
+	munmap(tensor_mmap->data, tensor_mmap->size);
+	ccfree(tensor_mmap);
+}
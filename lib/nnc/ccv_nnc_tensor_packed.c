@@ -0,0 +1,251 @@
+#include "ccv_nnc.h"
+#include "ccv_nnc_easy.h"
+#include "ccv_nnc_internal.h"
+#include "ccv_internal.h"
+#include "3rdparty/khash/khash.h"
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+// MARK - Packed Tensor Data Cache
+
+typedef struct ccv_nnc_tensor_packed_s {
+	const ccv_nnc_tensor_t* tensor; // The identity of the tensor, this is never dereferenced.
+	void* data; // The data pointer of the tensor at the time we packed.
+	ccv_nnc_tensor_param_t info; // The tensor parameters at the time we packed.
+	uint32_t tag;
+	int refcount;
+	int dead;
+	size_t size;
+	struct ccv_nnc_tensor_packed_s* next; // Next packed data for the same tensor.
+	struct ccv_nnc_tensor_packed_s* lru_prev;
+	struct ccv_nnc_tensor_packed_s* lru_next;
+	uint8_t packed[0] __attribute__ ((__aligned__(64)));
+} ccv_nnc_tensor_packed_t;
+
+typedef struct {
+	uint64_t version; // Data version of the tensor, bumped whenever the tensor is written.
+	int pending; // Number of packing in-flight for this tensor.
+	ccv_nnc_tensor_packed_t* head;
+} ccv_nnc_tensor_packed_list_t;
+
+KHASH_MAP_INIT_INT64(packed, ccv_nnc_tensor_packed_list_t)
+
+static struct {
+	size_t limit;
+	size_t size;
+	khash_t(packed)* tensors;
+	ccv_nnc_tensor_packed_t* lru_head; // Most recently used.
+	ccv_nnc_tensor_packed_t* lru_tail; // Least recently used.
+#ifdef HAVE_PTHREAD
+	pthread_mutex_t mutex;
+#endif
+} packed_cache = {
+#ifdef HAVE_PTHREAD
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+#endif
+};
+
+static inline void _ccv_nnc_packed_cache_lock(void)
+{
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&packed_cache.mutex);
+#endif
+}
+
+static inline void _ccv_nnc_packed_cache_unlock(void)
+{
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&packed_cache.mutex);
+#endif
+}
+
+static void _ccv_nnc_packed_lru_remove(ccv_nnc_tensor_packed_t* const packed)
+{
+	if (packed->lru_prev)
+		packed->lru_prev->lru_next = packed->lru_next;
+	else
+		packed_cache.lru_head = packed->lru_next;
+	if (packed->lru_next)
+		packed->lru_next->lru_prev = packed->lru_prev;
+	else
+		packed_cache.lru_tail = packed->lru_prev;
+	packed->lru_prev = packed->lru_next = 0;
+}
+
+static void _ccv_nnc_packed_lru_push(ccv_nnc_tensor_packed_t* const packed)
+{
+	packed->lru_prev = 0;
+	packed->lru_next = packed_cache.lru_head;
+	if (packed_cache.lru_head)
+		packed_cache.lru_head->lru_prev = packed;
+	packed_cache.lru_head = packed;
+	if (!packed_cache.lru_tail)
+		packed_cache.lru_tail = packed;
+}
+
+// Unlink the packed data from the cache, it will be freed once no one holds a reference to it any more.
+static void _ccv_nnc_packed_evict(ccv_nnc_tensor_packed_list_t* const list, ccv_nnc_tensor_packed_t* const packed)
+{
+	ccv_nnc_tensor_packed_t* prev = 0;
+	ccv_nnc_tensor_packed_t* node = list->head;
+	for (; node && node != packed; node = node->next)
+		prev = node;
+	assert(node == packed);
+	if (prev)
+		prev->next = packed->next;
+	else
+		list->head = packed->next;
+	_ccv_nnc_packed_lru_remove(packed);
+	packed_cache.size -= packed->size;
+	packed->dead = 1;
+	if (packed->refcount == 0)
+		ccfree(packed);
+}
+
+static void _ccv_nnc_packed_shrink(const size_t limit)
+{
+	ccv_nnc_tensor_packed_t* packed = packed_cache.lru_tail;
+	while (packed && packed_cache.size > limit)
+	{
+		ccv_nnc_tensor_packed_t* const prev = packed->lru_prev;
+		if (packed->refcount == 0)
+		{
+			const khiter_t k = kh_get(packed, packed_cache.tensors, (uint64_t)(uintptr_t)packed->tensor);
+			assert(k != kh_end(packed_cache.tensors));
+			ccv_nnc_tensor_packed_list_t* const list = &kh_val(packed_cache.tensors, k);
+			_ccv_nnc_packed_evict(list, packed);
+			if (!list->head && !list->pending)
+				kh_del(packed, packed_cache.tensors, k);
+		}
+		packed = prev;
+	}
+}
+
+void ccv_nnc_tensor_packed_cache_set_limit(const size_t limit)
+{
+	_ccv_nnc_packed_cache_lock();
+	packed_cache.limit = limit;
+	if (!packed_cache.tensors)
+		packed_cache.tensors = kh_init(packed);
+	_ccv_nnc_packed_shrink(limit);
+	_ccv_nnc_packed_cache_unlock();
+}
+
+void ccv_nnc_tensor_data_touch(const ccv_nnc_tensor_t* const tensor)
+{
+	// Fast path, the cache is not enabled, therefore, no version to track.
+	if (!packed_cache.limit || !tensor)
+		return;
+	// If this is a view, touch the tensor it views into as well.
+	if (CCV_IS_TENSOR_VIEW(tensor) && tensor->alias_ref)
+		ccv_nnc_tensor_data_touch((const ccv_nnc_tensor_t*)tensor->alias_ref);
+	_ccv_nnc_packed_cache_lock();
+	const khiter_t k = kh_get(packed, packed_cache.tensors, (uint64_t)(uintptr_t)tensor);
+	if (k != kh_end(packed_cache.tensors))
+	{
+		ccv_nnc_tensor_packed_list_t* const list = &kh_val(packed_cache.tensors, k);
+		++list->version;
+		while (list->head)
+			_ccv_nnc_packed_evict(list, list->head);
+		// If it is in the middle of packing, keep the version around such that the packed data won't be cached.
+		if (!list->pending)
+			kh_del(packed, packed_cache.tensors, k);
+	}
+	_ccv_nnc_packed_cache_unlock();
+}
+
+void* ccv_nnc_tensor_packed_retain(const ccv_nnc_tensor_t* const tensor, const uint32_t tag, const size_t size, ccv_nnc_tensor_pack_f pack, void* const context)
+{
+	assert(!CCV_IS_TENSOR_VIEW(tensor));
+	if (!packed_cache.limit || size > packed_cache.limit)
+		return 0;
+	_ccv_nnc_packed_cache_lock();
+	int ret;
+	khiter_t k = kh_put(packed, packed_cache.tensors, (uint64_t)(uintptr_t)tensor, &ret);
+	ccv_nnc_tensor_packed_list_t* list = &kh_val(packed_cache.tensors, k);
+	if (ret != 0)
+	{
+		list->version = 0;
+		list->pending = 0;
+		list->head = 0;
+	}
+	ccv_nnc_tensor_packed_t* packed;
+	for (packed = list->head; packed; packed = packed->next)
+		if (packed->tag == tag && packed->size == size && packed->data == tensor->data.ptr && memcmp(&packed->info, &tensor->info, sizeof(ccv_nnc_tensor_param_t)) == 0)
+		{
+			++packed->refcount;
+			_ccv_nnc_packed_lru_remove(packed);
+			_ccv_nnc_packed_lru_push(packed);
+			_ccv_nnc_packed_cache_unlock();
+			return packed->packed;
+		}
+	const uint64_t version = list->version;
+	++list->pending;
+	_ccv_nnc_packed_cache_unlock();
+	// Pack outside of the lock, this can be expensive.
+	ccmemalign((void**)&packed, 64, sizeof(ccv_nnc_tensor_packed_t) + size);
+	if (packed)
+	{
+		packed->tensor = tensor;
+		packed->data = tensor->data.ptr;
+		packed->info = tensor->info;
+		packed->tag = tag;
+		packed->refcount = 1;
+		packed->dead = 0;
+		packed->size = size;
+		packed->next = 0;
+		packed->lru_prev = packed->lru_next = 0;
+		pack(tensor, packed->packed, context);
+	}
+	_ccv_nnc_packed_cache_lock();
+	// Because pending > 0, the list cannot be removed in between.
+	k = kh_get(packed, packed_cache.tensors, (uint64_t)(uintptr_t)tensor);
+	assert(k != kh_end(packed_cache.tensors));
+	list = &kh_val(packed_cache.tensors, k);
+	--list->pending;
+	if (!packed)
+	{
+		if (!list->head && !list->pending)
+			kh_del(packed, packed_cache.tensors, k);
+		_ccv_nnc_packed_cache_unlock();
+		return 0;
+	}
+	if (list->version != version) // The data changed while we packed, return it without caching.
+	{
+		packed->dead = 1;
+		if (!list->head && !list->pending)
+			kh_del(packed, packed_cache.tensors, k);
+	} else {
+		// Remove packed data with the same tag, these are outdated.
+		ccv_nnc_tensor_packed_t* node = list->head;
+		while (node)
+		{
+			ccv_nnc_tensor_packed_t* const next = node->next;
+			if (node->tag == tag)
+				_ccv_nnc_packed_evict(list, node);
+			node = next;
+		}
+		packed->next = list->head;
+		list->head = packed;
+		_ccv_nnc_packed_lru_push(packed);
+		packed_cache.size += size;
+		_ccv_nnc_packed_shrink(packed_cache.limit);
+	}
+	_ccv_nnc_packed_cache_unlock();
+	return packed->packed;
+}
+
+void ccv_nnc_tensor_packed_release(void* const data)
+{
+	ccv_nnc_tensor_packed_t* const packed = (ccv_nnc_tensor_packed_t*)((uint8_t*)data - offsetof(ccv_nnc_tensor_packed_t, packed));
+	_ccv_nnc_packed_cache_lock();
+	assert(packed->refcount > 0);
+	--packed->refcount;
+	const int dead = packed->dead && packed->refcount == 0;
+	if (!dead && packed->refcount == 0 && packed_cache.size > packed_cache.limit)
+		_ccv_nnc_packed_shrink(packed_cache.limit);
+	_ccv_nnc_packed_cache_unlock();
+	if (dead)
+		ccfree(packed);
+}
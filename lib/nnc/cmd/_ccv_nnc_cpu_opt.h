@@ -0,0 +1,360 @@
+#ifndef GUARD_ccv_nnc_cpu_opt_h
+#define GUARD_ccv_nnc_cpu_opt_h
+
+#include "ccv.h"
+#include "nnc/ccv_nnc.h"
+#include "nnc/ccv_nnc_internal.h"
+#if defined(HAVE_SSE2)
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#elif defined(HAVE_NEON)
+#include <arm_neon.h>
+#endif
+#ifdef CCV_NNC_CPU_DISPATCH
+#include <immintrin.h>
+#endif
+
+// Number of elements each task handles for element-wise loops, small tensors therefore run on one thread.
+#define CCV_NNC_CPU_OPT_EW_BLOCK (8192)
+
+/**
+ * Fold the 4-d tensor dimensions into outer x mid x inner, where rdim is the dimensions after reduction (1 for
+ * reduced axes). If mid_kept is 1, the mid part contains all the kept axes and outer / inner are reduced. If
+ * mid_kept is 0, the mid part contains all the reduced axes and outer / inner are kept.
+ * Returns 0 if the axes cannot be folded this way.
+ */
+static inline int _ccv_nnc_cpu_opt_fold_dim(const int adim[CCV_NNC_MAX_DIM_ALLOC], const int rdim[CCV_NNC_MAX_DIM_ALLOC], const int mid_kept, int* const outer, int* const mid, int* const inner)
+{
+	int x;
+	int stage = 0;
+	*outer = *mid = *inner = 1;
+	for (x = 0; x < CCV_NNC_MAX_DIM + 2; x++)
+	{
+		if (adim[x] == 1)
+			continue;
+		const int kept = (rdim[x] == adim[x]);
+		if (!kept && rdim[x] != 1)
+			return 0;
+		if (kept == mid_kept)
+		{
+			if (stage == 2)
+				return 0;
+			stage = 1;
+			*mid *= adim[x];
+		} else if (stage == 0)
+			*outer *= adim[x];
+		else {
+			stage = 2;
+			*inner *= adim[x];
+		}
+	}
+	return 1;
+}
+
+/**
+ * The activation a fused command applies to its result before storing it, identified by the forward command of the
+ * activation (0 for none). Used as the epilogue of the convolution / GEMM kernels.
+ */
+static inline float _ccv_nnc_cpu_opt_act(const float v, const uint32_t activation)
+{
+	switch (activation)
+	{
+		case CCV_NNC_RELU_FORWARD:
+			return ccv_max(v, 0);
+		case CCV_NNC_SIGMOID_FORWARD:
+			return 1. / (1. + expf(-v));
+		case CCV_NNC_SWISH_FORWARD:
+			return v / (1. + expf(-v));
+	}
+	return v;
+}
+
+#if defined(HAVE_SSE2)
+// Polynomial approximation of expf (from Cephes), within a few ulps of expf for the clamped range.
+static inline __m128 _ccv_nnc_exp_ps_sse2(__m128 x)
+{
+	x = _mm_min_ps(x, _mm_set1_ps(88.3762626647949f));
+	x = _mm_max_ps(x, _mm_set1_ps(-88.3762626647949f));
+	// exp(x) = exp(g + n * log(2)), n = floor(x / log(2) + 0.5).
+	__m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)), _mm_set1_ps(0.5f));
+	const __m128 tx = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+	fx = _mm_sub_ps(tx, _mm_and_ps(_mm_cmpgt_ps(tx, fx), _mm_set1_ps(1)));
+	x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(0.693359375f)));
+	x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(-2.12194440e-4f)));
+	const __m128 z = _mm_mul_ps(x, x);
+	__m128 y = _mm_set1_ps(1.9875691500e-4f);
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507e-3f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073e-3f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894e-2f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459e-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201e-1f));
+	y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, z), x), _mm_set1_ps(1));
+	// Build 2^n from the exponent bits.
+	const __m128i n = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(fx), _mm_set1_epi32(127)), 23);
+	return _mm_mul_ps(y, _mm_castsi128_ps(n));
+}
+
+static inline float _ccv_nnc_hsum_ps_sse2(const __m128 v)
+{
+	const __m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+	return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+}
+
+static inline float _ccv_nnc_hmax_ps_sse2(const __m128 v)
+{
+	const __m128 s = _mm_max_ps(v, _mm_movehl_ps(v, v));
+	return _mm_cvtss_f32(_mm_max_ss(s, _mm_shuffle_ps(s, s, 1)));
+}
+
+static inline __m128 _ccv_nnc_act_ps_sse2(const __m128 v, const uint32_t activation)
+{
+	const __m128 one4 = _mm_set1_ps(1);
+	switch (activation)
+	{
+		case CCV_NNC_RELU_FORWARD:
+			return _mm_max_ps(v, _mm_setzero_ps());
+		case CCV_NNC_SIGMOID_FORWARD:
+			return _mm_div_ps(one4, _mm_add_ps(one4, _ccv_nnc_exp_ps_sse2(_mm_sub_ps(_mm_setzero_ps(), v))));
+		case CCV_NNC_SWISH_FORWARD:
+			return _mm_div_ps(v, _mm_add_ps(one4, _ccv_nnc_exp_ps_sse2(_mm_sub_ps(_mm_setzero_ps(), v))));
+	}
+	return v;
+}
+#elif defined(HAVE_NEON)
+// Polynomial approximation of expf (from Cephes), within a few ulps of expf for the clamped range.
+static inline float32x4_t _ccv_nnc_exp_ps_neon(float32x4_t x)
+{
+	x = vminq_f32(x, vdupq_n_f32(88.3762626647949f));
+	x = vmaxq_f32(x, vdupq_n_f32(-88.3762626647949f));
+	// exp(x) = exp(g + n * log(2)), n = floor(x / log(2) + 0.5).
+	float32x4_t fx = vmlaq_f32(vdupq_n_f32(0.5f), x, vdupq_n_f32(1.44269504088896341f));
+	const float32x4_t tx = vcvtq_f32_s32(vcvtq_s32_f32(fx));
+	const uint32x4_t mask = vandq_u32(vcgtq_f32(tx, fx), vreinterpretq_u32_f32(vdupq_n_f32(1)));
+	fx = vsubq_f32(tx, vreinterpretq_f32_u32(mask));
+	x = vmlsq_f32(x, fx, vdupq_n_f32(0.693359375f));
+	x = vmlsq_f32(x, fx, vdupq_n_f32(-2.12194440e-4f));
+	const float32x4_t z = vmulq_f32(x, x);
+	float32x4_t y = vdupq_n_f32(1.9875691500e-4f);
+	y = vmlaq_f32(vdupq_n_f32(1.3981999507e-3f), y, x);
+	y = vmlaq_f32(vdupq_n_f32(8.3334519073e-3f), y, x);
+	y = vmlaq_f32(vdupq_n_f32(4.1665795894e-2f), y, x);
+	y = vmlaq_f32(vdupq_n_f32(1.6666665459e-1f), y, x);
+	y = vmlaq_f32(vdupq_n_f32(5.0000001201e-1f), y, x);
+	y = vaddq_f32(vmlaq_f32(x, y, z), vdupq_n_f32(1));
+	// Build 2^n from the exponent bits.
+	const int32x4_t n = vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(fx), vdupq_n_s32(127)), 23);
+	return vmulq_f32(y, vreinterpretq_f32_s32(n));
+}
+
+// Reciprocal with two Newton-Raphson steps, close enough to the division for our purpose.
+static inline float32x4_t _ccv_nnc_recip_ps_neon(const float32x4_t x)
+{
+	float32x4_t r = vrecpeq_f32(x);
+	r = vmulq_f32(vrecpsq_f32(x, r), r);
+	return vmulq_f32(vrecpsq_f32(x, r), r);
+}
+
+static inline float _ccv_nnc_hsum_ps_neon(const float32x4_t v)
+{
+	const float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+	return vget_lane_f32(vpadd_f32(s, s), 0);
+}
+
+static inline float _ccv_nnc_hmax_ps_neon(const float32x4_t v)
+{
+	const float32x2_t s = vmax_f32(vget_low_f32(v), vget_high_f32(v));
+	return vget_lane_f32(vpmax_f32(s, s), 0);
+}
+
+static inline float32x4_t _ccv_nnc_act_ps_neon(const float32x4_t v, const uint32_t activation)
+{
+	const float32x4_t one4 = vdupq_n_f32(1);
+	switch (activation)
+	{
+		case CCV_NNC_RELU_FORWARD:
+			return vmaxq_f32(v, vdupq_n_f32(0));
+		case CCV_NNC_SIGMOID_FORWARD:
+			return _ccv_nnc_recip_ps_neon(vaddq_f32(one4, _ccv_nnc_exp_ps_neon(vnegq_f32(v))));
+		case CCV_NNC_SWISH_FORWARD:
+			return vmulq_f32(v, _ccv_nnc_recip_ps_neon(vaddq_f32(one4, _ccv_nnc_exp_ps_neon(vnegq_f32(v)))));
+	}
+	return v;
+}
+#endif
+
+#if defined(HAVE_SSE2) && defined(CCV_NNC_CPU_DISPATCH)
+// ReLU stays in 256-bit registers, the others go through the SSE2 exp on both halves.
+__attribute__((target("avx2,fma"))) static inline __m256 _ccv_nnc_act_ps_avx2(const __m256 v, const uint32_t activation)
+{
+	if (!activation)
+		return v;
+	if (activation == CCV_NNC_RELU_FORWARD)
+		return _mm256_max_ps(v, _mm256_setzero_ps());
+	const __m128 lo = _ccv_nnc_act_ps_sse2(_mm256_castps256_ps128(v), activation);
+	const __m128 hi = _ccv_nnc_act_ps_sse2(_mm256_extractf128_ps(v, 1), activation);
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+}
+#endif
+
+/**
+ * Apply the activation in-place to a contiguous range, for kernels that cannot apply it before the store.
+ */
+static inline void _ccv_nnc_cpu_opt_act_block(float* const bp, const int start, const int end, const uint32_t activation)
+{
+	if (!activation)
+		return;
+	int x = start;
+#if defined(HAVE_SSE2)
+	for (; x < end - 3; x += 4)
+		_mm_storeu_ps(bp + x, _ccv_nnc_act_ps_sse2(_mm_loadu_ps(bp + x), activation));
+#elif defined(HAVE_NEON)
+	for (; x < end - 3; x += 4)
+		vst1q_f32(bp + x, _ccv_nnc_act_ps_neon(vld1q_f32(bp + x), activation));
+#endif
+	for (; x < end; x++)
+		bp[x] = _ccv_nnc_cpu_opt_act(bp[x], activation);
+}
+
+/**
+ * Convert n elements of 32F, 16F or 16BF to 32F.
+ */
+static inline void _ccv_nnc_cpu_opt_to_f32(const void* const src, const int datatype, float* const dst, const int n)
+{
+	switch (datatype)
+	{
+		case CCV_16F:
+			ccv_half_precision_to_float((uint16_t*)src, dst, n);
+			break;
+		case CCV_16BF:
+			ccv_bfloat_to_float((uint16_t*)src, dst, n);
+			break;
+		default:
+			assert(datatype == CCV_32F);
+			memcpy(dst, src, sizeof(float) * n);
+	}
+}
+
+/**
+ * Convert n elements of 32F to 32F, 16F or 16BF.
+ */
+static inline void _ccv_nnc_cpu_opt_from_f32(const float* const src, void* const dst, const int datatype, const int n)
+{
+	switch (datatype)
+	{
+		case CCV_16F:
+			ccv_float_to_half_precision((float*)src, (uint16_t*)dst, n);
+			break;
+		case CCV_16BF:
+			ccv_float_to_bfloat((float*)src, (uint16_t*)dst, n);
+			break;
+		default:
+			assert(datatype == CCV_32F);
+			memcpy(dst, src, sizeof(float) * n);
+	}
+}
+
+// Dot product with either side in 32F, 16F or 16BF, accumulated in 32F. Converts a block at a time.
+static inline float _ccv_nnc_cpu_opt_dot_ref(const void* const a, const int a_datatype, const void* const w, const int w_datatype, const int n)
+{
+	float af[32];
+	float wf[32];
+	const int a_size = CCV_GET_DATA_TYPE_SIZE(a_datatype);
+	const int w_size = CCV_GET_DATA_TYPE_SIZE(w_datatype);
+	float sum = 0;
+	int i, j;
+	for (i = 0; i < n; i += 32)
+	{
+		const int len = ccv_min(32, n - i);
+		_ccv_nnc_cpu_opt_to_f32((const char*)a + i * a_size, a_datatype, af, len);
+		_ccv_nnc_cpu_opt_to_f32((const char*)w + i * w_size, w_datatype, wf, len);
+		for (j = 0; j < len; j++)
+			sum += af[j] * wf[j];
+	}
+	return sum;
+}
+
+#if defined(CCV_NNC_CPU_DISPATCH) && ((defined(__clang__) && __clang_major__ >= 9) || (!defined(__clang__) && __GNUC__ >= 10))
+#define CCV_NNC_CPU_DISPATCH_AVX512BF16
+#endif
+
+#if defined(CCV_NNC_CPU_DISPATCH) && ((defined(__clang__) && __clang_major__ >= 6) || (!defined(__clang__) && __GNUC__ >= 8))
+#define CCV_NNC_CPU_DISPATCH_AVX512VNNI
+#endif
+
+#ifdef CCV_NNC_CPU_DISPATCH
+// 16F widens with F16C, 16BF is the upper half of 32F thus only needs a shift.
+#define _ccv_nnc_load8_32f_avx2(p, k) _mm256_loadu_ps((const float*)(p) + (k))
+#define _ccv_nnc_load8_16f_avx2(p, k) _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)((const uint16_t*)(p) + (k))))
+#define _ccv_nnc_load8_16bf_avx2(p, k) _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)((const uint16_t*)(p) + (k)))), 16))
+
+__attribute__((target("avx2,fma,f16c"))) static inline float _ccv_nnc_cpu_opt_dot_avx2(const void* const a, const int a_datatype, const void* const w, const int w_datatype, const int n)
+{
+	__m256 v80 = _mm256_setzero_ps();
+	__m256 v81 = _mm256_setzero_ps();
+	int k = 0;
+#define dot_for(aload, wload) \
+	for (; k < n - 15; k += 16) \
+	{ \
+		v80 = _mm256_fmadd_ps(aload(a, k), wload(w, k), v80); \
+		v81 = _mm256_fmadd_ps(aload(a, k + 8), wload(w, k + 8), v81); \
+	} \
+	for (; k < n - 7; k += 8) \
+		v80 = _mm256_fmadd_ps(aload(a, k), wload(w, k), v80);
+	if (w_datatype == CCV_16F && a_datatype == CCV_16F) {
+		dot_for(_ccv_nnc_load8_16f_avx2, _ccv_nnc_load8_16f_avx2);
+	} else if (w_datatype == CCV_16F && a_datatype == CCV_32F) {
+		dot_for(_ccv_nnc_load8_32f_avx2, _ccv_nnc_load8_16f_avx2);
+	} else if (w_datatype == CCV_16BF && a_datatype == CCV_16BF) {
+		dot_for(_ccv_nnc_load8_16bf_avx2, _ccv_nnc_load8_16bf_avx2);
+	} else if (w_datatype == CCV_16BF && a_datatype == CCV_32F) {
+		dot_for(_ccv_nnc_load8_32f_avx2, _ccv_nnc_load8_16bf_avx2);
+	}
+#undef dot_for
+	v80 = _mm256_add_ps(v80, v81);
+	float sum = _ccv_nnc_hsum_ps_sse2(_mm_add_ps(_mm256_castps256_ps128(v80), _mm256_extractf128_ps(v80, 1)));
+	if (k < n)
+		sum += _ccv_nnc_cpu_opt_dot_ref((const char*)a + k * CCV_GET_DATA_TYPE_SIZE(a_datatype), a_datatype, (const char*)w + k * CCV_GET_DATA_TYPE_SIZE(w_datatype), w_datatype, n - k);
+	return sum;
+}
+#endif
+
+#ifdef CCV_NNC_CPU_DISPATCH_AVX512BF16
+// Multiplies bfloat16 pairs and accumulates in 32F in one instruction.
+__attribute__((target("avx512f,avx512bf16"))) static inline float _ccv_nnc_cpu_opt_dot_16bf_avx512bf16(const uint16_t* const a, const uint16_t* const w, const int n)
+{
+	__m512 v160 = _mm512_setzero_ps();
+	__m512 v161 = _mm512_setzero_ps();
+	int k = 0;
+	for (; k < n - 63; k += 64)
+	{
+		v160 = _mm512_dpbf16_ps(v160, (__m512bh)_mm512_loadu_si512(a + k), (__m512bh)_mm512_loadu_si512(w + k));
+		v161 = _mm512_dpbf16_ps(v161, (__m512bh)_mm512_loadu_si512(a + k + 32), (__m512bh)_mm512_loadu_si512(w + k + 32));
+	}
+	for (; k < n - 31; k += 32)
+		v160 = _mm512_dpbf16_ps(v160, (__m512bh)_mm512_loadu_si512(a + k), (__m512bh)_mm512_loadu_si512(w + k));
+	float sum = _mm512_reduce_add_ps(_mm512_add_ps(v160, v161));
+	if (k < n)
+		sum += _ccv_nnc_cpu_opt_dot_ref(a + k, CCV_16BF, w + k, CCV_16BF, n - k);
+	return sum;
+}
+#endif
+
+/**
+ * Dot product of n elements for the half precision kernels. The weights w are 16F or 16BF, the activations a are
+ * either 32F or of the same datatype as the weights. The features are from ccv_nnc_cpu_features().
+ */
+static inline float _ccv_nnc_cpu_opt_dot(const int features, const void* const a, const int a_datatype, const void* const w, const int w_datatype, const int n)
+{
+#ifdef CCV_NNC_CPU_DISPATCH_AVX512BF16
+	if (a_datatype == CCV_16BF && w_datatype == CCV_16BF && (features & CCV_NNC_CPU_FEATURE_AVX512BF16))
+		return _ccv_nnc_cpu_opt_dot_16bf_avx512bf16((const uint16_t*)a, (const uint16_t*)w, n);
+#endif
+#ifdef CCV_NNC_CPU_DISPATCH
+	if ((features & (CCV_NNC_CPU_FEATURE_AVX2 | CCV_NNC_CPU_FEATURE_F16C)) == (CCV_NNC_CPU_FEATURE_AVX2 | CCV_NNC_CPU_FEATURE_F16C) &&
+		(a_datatype == w_datatype || a_datatype == CCV_32F))
+		return _ccv_nnc_cpu_opt_dot_avx2(a, a_datatype, w, w_datatype, n);
+#endif
+	return _ccv_nnc_cpu_opt_dot_ref(a, a_datatype, w, w_datatype, n);
+}
+
+#endif
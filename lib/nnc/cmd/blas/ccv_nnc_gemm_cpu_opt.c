@@ -43,6 +43,9 @@ static int _ccv_nnc_gemm_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint
 	assert(!bias || bdim[0] == bias->info.dim[0]);
 	assert(bdim[0] == w->info.dim[0]);
 	assert(adim[0] == w->info.dim[1]);
+	// Reduced precision tensors only go through the direct path, system GEMM is FP32 only.
+	if (a->info.datatype != CCV_32F || w->info.datatype != CCV_32F || b->info.datatype != CCV_32F || (bias && bias->info.datatype != CCV_32F))
+		return cmd.algorithm == CCV_NNC_CMD_OPT_GEMM_ALGO_SYSTEM ? CCV_NNC_EXEC_INVALID : _ccv_nnc_gemm_forw_cpu_opt(a, w, bias, b);
 	switch (cmd.algorithm)
 	{
 		case CCV_NNC_CMD_OPT_GEMM_ALGO_DIRECT:
@@ -131,7 +134,7 @@ static int _ccv_nnc_gemm_back(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint
 REGISTER_COMMAND_BACKEND(CCV_NNC_GEMM_FORWARD, CCV_NNC_BACKEND_CPU_OPT)(ccv_nnc_cmd_backend_registry_t* const registry)
 {
 	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW;
-	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_datatypes = CCV_32F | CCV_16F | CCV_16BF;
 	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
 	registry->algorithms = CCV_NNC_CMD_OPT_GEMM_ALGO_COUNT;
 	registry->exec = _ccv_nnc_gemm_forw;
@@ -8,6 +8,9 @@
 #elif defined(HAVE_NEON)
 #include <arm_neon.h>
 #endif
+#ifdef CCV_NNC_CPU_DISPATCH
+#include <immintrin.h>
+#endif
 #ifdef USE_OPENMP
 #include <omp.h>
 #endif
@@ -15,6 +18,7 @@
 #include <dispatch/dispatch.h>
 #endif
 #include "../_ccv_nnc_gemm_cpu_opt.h"
+#include "../../_ccv_nnc_cpu_opt.h"
 
 #ifdef HAVE_SSE2
 static int _ccv_nnc_gemm_forw_sse2(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_view_t* const w, const ccv_nnc_tensor_view_t* const bias, ccv_nnc_tensor_view_t* const b)
@@ -183,6 +187,152 @@ static int _ccv_nnc_gemm_back_sse2(const ccv_nnc_tensor_view_t* const g, const c
 }
 #endif
 
+#ifdef CCV_NNC_CPU_DISPATCH
+// The parallel_for body may be outlined into a function (or a block) without the target attribute,
+// therefore, only call into the target functions from within parallel_for.
+__attribute__((target("avx2,fma"))) static float _ccv_nnc_gemm_dot_avx2(const float* const ap, const float* const wp, const int adim)
+{
+	__m256 v80 = _mm256_setzero_ps();
+	__m256 v81 = _mm256_setzero_ps();
+	int k;
+	for (k = 0; k < adim - 15; k += 16)
+	{
+		v80 = _mm256_fmadd_ps(_mm256_loadu_ps(wp + k), _mm256_loadu_ps(ap + k), v80);
+		v81 = _mm256_fmadd_ps(_mm256_loadu_ps(wp + k + 8), _mm256_loadu_ps(ap + k + 8), v81);
+	}
+	if (k < adim)
+		v80 = _mm256_fmadd_ps(_mm256_loadu_ps(wp + k), _mm256_loadu_ps(ap + k), v80);
+	v80 = _mm256_add_ps(v80, v81);
+	__m128 v40 = _mm_add_ps(_mm256_castps256_ps128(v80), _mm256_extractf128_ps(v80, 1));
+	v40 = _mm_add_ps(v40, _mm_movehl_ps(v40, v40));
+	v40 = _mm_add_ss(v40, _mm_movehdup_ps(v40));
+	return _mm_cvtss_f32(v40);
+}
+
+__attribute__((target("avx512f"))) static float _ccv_nnc_gemm_dot_avx512(const float* const ap, const float* const wp, const int adim)
+{
+	__m512 v160 = _mm512_setzero_ps();
+	__m512 v161 = _mm512_setzero_ps();
+	int k;
+	for (k = 0; k < adim - 31; k += 32)
+	{
+		v160 = _mm512_fmadd_ps(_mm512_loadu_ps(wp + k), _mm512_loadu_ps(ap + k), v160);
+		v161 = _mm512_fmadd_ps(_mm512_loadu_ps(wp + k + 16), _mm512_loadu_ps(ap + k + 16), v161);
+	}
+	if (k < adim)
+		v160 = _mm512_fmadd_ps(_mm512_loadu_ps(wp + k), _mm512_loadu_ps(ap + k), v160);
+	return _mm512_reduce_add_ps(_mm512_add_ps(v160, v161));
+}
+
+static int _ccv_nnc_gemm_forw_avx2(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_view_t* const w, const ccv_nnc_tensor_view_t* const bias, ccv_nnc_tensor_view_t* const b, const int avx512)
+{
+	const int a_nd = ccv_nnc_tensor_nd(a->info.dim);
+	const int* adim = (a_nd == 1) ? a->info.dim : a->info.dim + 1;
+	const int b_nd = ccv_nnc_tensor_nd(b->info.dim);
+	const int* bdim = (b_nd == 1) ? b->info.dim : b->info.dim + 1;
+	const int batch_size = a_nd == 1 ? 1 : ccv_max(1, a->info.dim[0]);
+	assert(batch_size == (b_nd == 1) ? 1 : ccv_max(1, b->info.dim[0]));
+	const int a_batch_inc = CCV_IS_TENSOR_VIEW(a) ? (a_nd == 1 ? a->inc[0] : a->inc[1]) : adim[0];
+	const int b_batch_inc = CCV_IS_TENSOR_VIEW(b) ? (b_nd == 1 ? b->inc[0] : b->inc[1]) : bdim[0];
+	const int* winc = CCV_IS_TENSOR_VIEW(w) ? w->inc : w->info.dim;
+	int i;
+	for (i = 0; i < batch_size; i++)
+	{
+		const float* const ap = a->data.f32 + i * a_batch_inc;
+		float* const bp = b->data.f32 + i * b_batch_inc;
+		parallel_for(j, bdim[0]) {
+			const float* const wp = w->data.f32 + j * winc[1];
+			const float v = avx512 ? _ccv_nnc_gemm_dot_avx512(ap, wp, adim[0]) : _ccv_nnc_gemm_dot_avx2(ap, wp, adim[0]);
+			bp[j] = bias ? v + bias->data.f32[j] : v;
+		} parallel_endfor
+	}
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+__attribute__((target("avx2,fma"))) static void _ccv_nnc_gemm_axpy_avx2(float* const dwp, const float* const ap, const float g, const int adim)
+{
+	const __m256 g8 = _mm256_set1_ps(g);
+	int k;
+	for (k = 0; k < adim; k += 8)
+		_mm256_storeu_ps(dwp + k, _mm256_fmadd_ps(_mm256_loadu_ps(ap + k), g8, _mm256_loadu_ps(dwp + k)));
+}
+
+__attribute__((target("avx2,fma"))) static void _ccv_nnc_gemm_gemv_t8_avx2(float* const hp, const float* const wp, const int winc, const float* const gp, const int gdim)
+{
+	__m256 v80 = _mm256_setzero_ps();
+	__m256 v81 = _mm256_setzero_ps();
+	__m256 v82 = _mm256_setzero_ps();
+	__m256 v83 = _mm256_setzero_ps();
+	int k;
+	for (k = 0; k < gdim; k += 4)
+	{
+		v80 = _mm256_fmadd_ps(_mm256_broadcast_ss(gp + k), _mm256_loadu_ps(wp + k * winc), v80);
+		v81 = _mm256_fmadd_ps(_mm256_broadcast_ss(gp + k + 1), _mm256_loadu_ps(wp + (k + 1) * winc), v81);
+		v82 = _mm256_fmadd_ps(_mm256_broadcast_ss(gp + k + 2), _mm256_loadu_ps(wp + (k + 2) * winc), v82);
+		v83 = _mm256_fmadd_ps(_mm256_broadcast_ss(gp + k + 3), _mm256_loadu_ps(wp + (k + 3) * winc), v83);
+	}
+	_mm256_storeu_ps(hp, _mm256_add_ps(_mm256_add_ps(v80, v81), _mm256_add_ps(v82, v83)));
+}
+
+static int _ccv_nnc_gemm_back_avx2(const ccv_nnc_tensor_view_t* const g, const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_view_t* const w, ccv_nnc_tensor_view_t* const dw, ccv_nnc_tensor_view_t* const bias, ccv_nnc_tensor_view_t* const h, const int flags)
+{
+	const int* dwinc = CCV_IS_TENSOR_VIEW(dw) ? dw->inc : dw->info.dim;
+	if (!(flags & CCV_NNC_ACCUMULATE_OUTPUT)) // reset the gradients to 0
+	{
+		memset(dw->data.u8, 0, sizeof(float) * dwinc[1] * dw->info.dim[0]);
+		if (bias)
+			memset(bias->data.u8, 0, sizeof(float) * bias->info.dim[0]);
+	}
+	const int a_nd = ccv_nnc_tensor_nd(a->info.dim);
+	const int* adim = (a_nd == 1) ? a->info.dim : a->info.dim + 1;
+	const int g_nd = ccv_nnc_tensor_nd(g->info.dim);
+	const int* gdim = (g_nd == 1) ? g->info.dim : g->info.dim + 1;
+	const int batch_size = a_nd == 1 ? 1 : ccv_max(1, a->info.dim[0]);
+	int i, j;
+	const int g_batch_inc = CCV_IS_TENSOR_VIEW(g) ? ((g_nd == 1) ? g->inc[0] : g->inc[1]) : gdim[0];
+	if (bias)
+	{
+		float* const bp = bias->data.f32;
+		assert(bias->info.dim[0] == gdim[0]);
+		for (i = 0; i < batch_size; i++)
+		{
+			const float* const gp = g->data.f32 + i * g_batch_inc;
+			for (j = 0; j < gdim[0]; j++)
+				bp[j] += gp[j];
+		}
+	}
+	assert(gdim[0] == dw->info.dim[0]);
+	assert(adim[0] == dw->info.dim[1]);
+	const int a_batch_inc = CCV_IS_TENSOR_VIEW(a) ? ((a_nd == 1) ? a->inc[0] : a->inc[1]) : adim[0];
+	for (i = 0; i < batch_size; i++)
+	{
+		const float* const gp = g->data.f32 + i * g_batch_inc;
+		const float* const ap = a->data.f32 + i * a_batch_inc;
+		parallel_for(j, gdim[0]) {
+			_ccv_nnc_gemm_axpy_avx2(dw->data.f32 + j * dwinc[1], ap, gp[j], adim[0]);
+		} parallel_endfor
+	}
+	if (h && w)
+	{
+		const int h_nd = ccv_nnc_tensor_nd(h->info.dim);
+		const int* hdim = (h_nd == 1) ? h->info.dim : h->info.dim + 1;
+		assert(hdim[0] == adim[0]);
+		const int h_batch_inc = CCV_IS_TENSOR_VIEW(h) ? ((h_nd == 1) ? h->inc[0] : h->inc[1]) : hdim[0];
+		const int* winc = CCV_IS_TENSOR_VIEW(w) ? w->inc : w->info.dim;
+		for (i = 0; i < batch_size; i++)
+		{
+			const float* const gp = g->data.f32 + i * g_batch_inc;
+			float* const hp = h->data.f32 + i * h_batch_inc;
+			parallel_for(y, hdim[0] / 8) {
+				const int j = y * 8;
+				_ccv_nnc_gemm_gemv_t8_avx2(hp + j, w->data.f32 + j, winc[1], gp, gdim[0]);
+			} parallel_endfor
+		}
+	}
+	return CCV_NNC_EXEC_SUCCESS;
+}
+#endif
+
 #ifdef HAVE_NEON
 static int _ccv_nnc_gemm_forw_neon(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_view_t* const w, const ccv_nnc_tensor_view_t* const bias, ccv_nnc_tensor_view_t* const b)
 {
@@ -341,13 +491,65 @@ static int _ccv_nnc_gemm_back_neon(const ccv_nnc_tensor_view_t* const g, const c
 }
 #endif
 
+// Weights (and optionally activations / bias / output) stored in FP16 / BF16, accumulate in FP32.
+static int _ccv_nnc_gemm_forw_half(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_view_t* const w, const ccv_nnc_tensor_view_t* const bias, ccv_nnc_tensor_view_t* const b)
+{
+	const int a_datatype = a->info.datatype;
+	const int w_datatype = w->info.datatype;
+	const int b_datatype = b->info.datatype;
+	if ((w_datatype != CCV_16F && w_datatype != CCV_16BF) ||
+		(a_datatype != CCV_32F && a_datatype != w_datatype) ||
+		(b_datatype != CCV_32F && b_datatype != w_datatype) ||
+		(bias && bias->info.datatype != CCV_32F && bias->info.datatype != w_datatype))
+		return CCV_NNC_EXEC_INVALID;
+	const int a_nd = ccv_nnc_tensor_nd(a->info.dim);
+	const int* adim = (a_nd == 1) ? a->info.dim : a->info.dim + 1;
+	const int b_nd = ccv_nnc_tensor_nd(b->info.dim);
+	const int* bdim = (b_nd == 1) ? b->info.dim : b->info.dim + 1;
+	const int batch_size = a_nd == 1 ? 1 : ccv_max(1, a->info.dim[0]);
+	assert(batch_size == (b_nd == 1) ? 1 : ccv_max(1, b->info.dim[0]));
+	const int a_batch_inc = CCV_IS_TENSOR_VIEW(a) ? (a_nd == 1 ? a->inc[0] : a->inc[1]) : adim[0];
+	const int b_batch_inc = CCV_IS_TENSOR_VIEW(b) ? (b_nd == 1 ? b->inc[0] : b->inc[1]) : bdim[0];
+	const int* winc = CCV_IS_TENSOR_VIEW(w) ? w->inc : w->info.dim;
+	const size_t a_size = CCV_GET_DATA_TYPE_SIZE(a_datatype);
+	const size_t w_size = CCV_GET_DATA_TYPE_SIZE(w_datatype);
+	const size_t b_size = CCV_GET_DATA_TYPE_SIZE(b_datatype);
+	const int bias_datatype = bias ? bias->info.datatype : CCV_32F;
+	const size_t bias_size = CCV_GET_DATA_TYPE_SIZE(bias_datatype);
+	const int cpu_features = ccv_nnc_cpu_features();
+	int i;
+	for (i = 0; i < batch_size; i++)
+	{
+		const unsigned char* const ap = a->data.u8 + i * a_batch_inc * a_size;
+		unsigned char* const bp = b->data.u8 + i * b_batch_inc * b_size;
+		parallel_for(j, bdim[0]) {
+			float v = _ccv_nnc_cpu_opt_dot(cpu_features, ap, a_datatype, w->data.u8 + j * winc[1] * w_size, w_datatype, adim[0]);
+			if (bias)
+			{
+				float bv;
+				_ccv_nnc_cpu_opt_to_f32(bias->data.u8 + j * bias_size, bias_datatype, &bv, 1);
+				v += bv;
+			}
+			_ccv_nnc_cpu_opt_from_f32(&v, bp + j * b_size, b_datatype, 1);
+		} parallel_endfor
+	}
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
 int _ccv_nnc_gemm_forw_cpu_opt(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_view_t* const w, const ccv_nnc_tensor_view_t* const bias, ccv_nnc_tensor_view_t* const b)
 {
+	if (a->info.datatype != CCV_32F || w->info.datatype != CCV_32F || b->info.datatype != CCV_32F || (bias && bias->info.datatype != CCV_32F))
+		return _ccv_nnc_gemm_forw_half(a, w, bias, b);
 #if defined(HAVE_SSE2) || defined(HAVE_NEON)
 	const int a_nd = ccv_nnc_tensor_nd(a->info.dim);
 	const int adim = (a_nd == 1) ? a->info.dim[0] : a->info.dim[1];
 #endif
 #if defined(HAVE_SSE2)
+#ifdef CCV_NNC_CPU_DISPATCH
+	const int cpu_features = ccv_nnc_cpu_features();
+	if (adim % 8 == 0 && (cpu_features & CCV_NNC_CPU_FEATURE_AVX2))
+		return _ccv_nnc_gemm_forw_avx2(a, w, bias, b, adim % 16 == 0 && (cpu_features & CCV_NNC_CPU_FEATURE_AVX512F));
+#endif
 	if (adim % 8 == 0)
 		return _ccv_nnc_gemm_forw_sse2(a, w, bias, b);
 #elif defined(HAVE_NEON)
@@ -368,6 +570,10 @@ int _ccv_nnc_gemm_back_cpu_opt(const ccv_nnc_tensor_view_t* const g, const ccv_n
 	const int hdim = h ? ((h_nd == 1) ? h->info.dim[0] : h->info.dim[1]) : 0;
 #endif
 #if defined(HAVE_SSE2)
+#ifdef CCV_NNC_CPU_DISPATCH
+	if (gdim % 4 == 0 && adim % 8 == 0 && (!h || hdim % 8 == 0) && (ccv_nnc_cpu_features() & CCV_NNC_CPU_FEATURE_AVX2))
+		return _ccv_nnc_gemm_back_avx2(g, a, w, dw, bias, h, flags);
+#endif
 	if (gdim % 4 == 0 && adim % 4 == 0 && (!h || hdim % 4 == 0))
 		return _ccv_nnc_gemm_back_sse2(g, a, w, dw, bias, h, flags);
 #elif defined(HAVE_NEON)
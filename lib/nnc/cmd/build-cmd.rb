@@ -154,7 +154,7 @@ def parse_find_backend filename, which_command, find_backend
 end
 
 # Find source code in subdirs.
-Dir.glob("{#{ARGV.join(',')}}/**/*.{c,cu}").each do |fn|
+Dir.glob("{#{ARGV.join(',')}}/**/*.{c,cu}").sort.each do |fn|
 	File.open(fn, 'r') do |f|
 		command_parser = MacroParser.new 'REGISTER_COMMAND'
 		find_backend_parser = MacroParser.new 'FIND_BACKEND'
@@ -209,9 +209,38 @@ Dir.glob("{#{ARGV.join(',')}}/**/*.{c,cu}").each do |fn|
 	end
 end
 
-def config_mk command_backends, command_configs, command_files
+# Keep whatever order the previously generated files have, new entries are appended. Otherwise the command and the
+# backend order depends on the order the file system returns, and the generated files reshuffle on every new command.
+def known_order filename, pattern
+	known = {}
+	return known unless File.exist? filename
+	File.read(filename).scan(pattern).flatten.each do |name|
+		known[name] = known.count unless known.has_key? name
+	end
+	known
+end
+
+def keep_order list, known
+	list.each_with_index.sort_by { |item, i| [known.fetch(yield(item), known.count), i] }.map(&:first)
+end
+
+def command_name command
+	command.sub(/_(FORWARD|BACKWARD)$/, '')
+end
+
+known_srcs = known_order 'config.mk', /\S+\.cu?\b/
+known_commands = known_order 'ccv_nnc_cmd.h', /^\t(CCV_NNC_\w+)_(?:FORWARD|BACKWARD) = 0x/
+known_backends = known_order 'ccv_nnc_backend.h', /^\t(CCV_NNC_BACKEND_\w+) = 0x/
+known_macros = known_order 'ccv_nnc_cmd_easy.h', /^#define (\w+)/
+
+$command_backends = keep_order($command_backends, known_commands) { |command_backend| command_name command_backend.command }
+$command_easy_macros = keep_order($command_easy_macros, known_macros) { |command_macro| command_macro[:macro][/^#define (\w+)/, 1] }
+
+def config_mk command_backends, command_configs, command_files, known_srcs
 	cmd_srcs = command_backends.reject(&:cuda?).map(&:filename).uniq + command_configs.reject(&:cuda?).map(&:filename).uniq + command_files.reject(&:cuda?).map(&:filename).uniq
 	cuda_cmd_srcs = command_backends.select(&:cuda?).map(&:filename).uniq + command_configs.select(&:cuda?).map(&:filename).uniq + command_files.select(&:cuda?).map(&:filename).uniq
+	cmd_srcs = keep_order(cmd_srcs, known_srcs) { |fn| fn }
+	cuda_cmd_srcs = keep_order(cuda_cmd_srcs, known_srcs) { |fn| fn }
 	config_mk = ERB.new File.read('config.mk.erb')
 	config_mk.result binding
 end
@@ -259,7 +288,7 @@ def ccv_nnc_cmd_inc command_backends, command_map, backend_map, command_chd, bac
 end
 
 File.open('config.mk', 'w+') do |f|
-	f.write config_mk($command_backends, $command_configs, $command_files)
+	f.write config_mk($command_backends, $command_configs, $command_files, known_srcs)
 end
 
 commands = $command_backends.map(&:command).uniq.map do |command|
@@ -270,7 +299,7 @@ commands = $command_backends.map(&:command).uniq.map do |command|
 	end
 end.uniq
 
-backends = $command_backends.map(&:backend).uniq
+backends = keep_order($command_backends.map(&:backend).uniq, known_backends) { |backend| backend }
 
 command_map = {}
 commands.each do |command|
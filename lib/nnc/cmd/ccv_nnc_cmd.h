@@ -98,6 +98,18 @@ enum {
 	CCV_NNC_BATCH_NORM_BACKWARD = 0x5419819d,
 	CCV_NNC_LAYER_NORM_FORWARD = 0xbed3c264,
 	CCV_NNC_LAYER_NORM_BACKWARD = 0xbed3c265,
-	CCV_NNC_COUNT = 93,
+	CCV_NNC_FUSED_CONVOLUTION_FORWARD = 0x822da19a,
+	CCV_NNC_FUSED_CONVOLUTION_BACKWARD = 0x822da19b,
+	CCV_NNC_FUSED_GEMM_FORWARD = 0x74e5b606,
+	CCV_NNC_FUSED_GEMM_BACKWARD = 0x74e5b607,
+	CCV_NNC_FUSED_EW_FORWARD = 0x84a66132,
+	CCV_NNC_FUSED_EW_BACKWARD = 0x84a66133,
+	CCV_NNC_QUANTIZE_FORWARD = 0xb49048e,
+	CCV_NNC_QUANTIZE_BACKWARD = 0xb49048f,
+	CCV_NNC_QUANTIZED_CONVOLUTION_FORWARD = 0xf2fd890,
+	CCV_NNC_QUANTIZED_CONVOLUTION_BACKWARD = 0xf2fd891,
+	CCV_NNC_QUANTIZED_GEMM_FORWARD = 0xd48323c,
+	CCV_NNC_QUANTIZED_GEMM_BACKWARD = 0xd48323d,
+	CCV_NNC_COUNT = 105,
 };
 /** @} */
@@ -216,5 +216,25 @@
 #define CMD_LAYER_NORM_FORWARD(_epsilon, ...) ccv_nnc_cmd(CCV_NNC_LAYER_NORM_FORWARD, 0, ((ccv_nnc_cmd_param_t){.size={.dim={1,1,1}},.lnorm={.epsilon=_epsilon,.count=LIST_COUNT(__VA_ARGS__),.axis={__VA_ARGS__}}}), 0)
 // CCV_NNC_LAYER_NORM_BACKWARD
 #define CMD_LAYER_NORM_BACKWARD(_epsilon, ...) ccv_nnc_cmd(CCV_NNC_LAYER_NORM_BACKWARD, 0, ((ccv_nnc_cmd_param_t){.size={.dim={1,1,1}},.lnorm={.epsilon=_epsilon,.count=LIST_COUNT(__VA_ARGS__),.axis={__VA_ARGS__}}}), 0)
+// CCV_NNC_FUSED_CONVOLUTION_FORWARD
+#define CMD_FUSED_CONVOLUTION_FORWARD(_activation, _epsilon, _count, ...) ccv_nnc_cmd(CCV_NNC_FUSED_CONVOLUTION_FORWARD, 0, ((ccv_nnc_cmd_param_t){.size={.dim={__VA_ARGS__}},.fused={.count=_count,.activation=_activation,.epsilon=_epsilon}}), 0)
+// CCV_NNC_FUSED_CONVOLUTION_BACKWARD
+#define CMD_FUSED_CONVOLUTION_BACKWARD(_activation, _epsilon, _count, ...) ccv_nnc_cmd(CCV_NNC_FUSED_CONVOLUTION_BACKWARD, 0, ((ccv_nnc_cmd_param_t){.size={.dim={__VA_ARGS__}},.fused={.count=_count,.activation=_activation,.epsilon=_epsilon}}), 0)
+// CCV_NNC_FUSED_GEMM_FORWARD
+#define CMD_FUSED_GEMM_FORWARD(_activation) ccv_nnc_cmd(CCV_NNC_FUSED_GEMM_FORWARD, 0, ((ccv_nnc_cmd_param_t){.size={.dim={1,1,1}},.fused={.activation=_activation}}), 0)
+// CCV_NNC_FUSED_GEMM_BACKWARD
+#define CMD_FUSED_GEMM_BACKWARD(_activation) ccv_nnc_cmd(CCV_NNC_FUSED_GEMM_BACKWARD, 0, ((ccv_nnc_cmd_param_t){.size={.dim={1,1,1}},.fused={.activation=_activation}}), 0)
+// CCV_NNC_FUSED_EW_FORWARD
+#define CMD_FUSED_EW_FORWARD(...) ccv_nnc_cmd(CCV_NNC_FUSED_EW_FORWARD, 0, ((ccv_nnc_cmd_param_t){.size={.dim={1,1,1}},.fused={.op_count=sizeof((uint32_t[]){__VA_ARGS__}) / sizeof(uint32_t),.ops={__VA_ARGS__}}}), 0)
+// CCV_NNC_FUSED_EW_BACKWARD
+#define CMD_FUSED_EW_BACKWARD(...) ccv_nnc_cmd(CCV_NNC_FUSED_EW_BACKWARD, 0, ((ccv_nnc_cmd_param_t){.size={.dim={1,1,1}},.fused={.op_count=sizeof((uint32_t[]){__VA_ARGS__}) / sizeof(uint32_t),.ops={__VA_ARGS__}}}), 0)
+// CCV_NNC_QUANTIZE_FORWARD
+#define CMD_QUANTIZE_FORWARD(_scale, _zero_point) ccv_nnc_cmd(CCV_NNC_QUANTIZE_FORWARD, 0, ((ccv_nnc_cmd_param_t){.size={.dim={1,1,1}},.quant={.scale=_scale,.zero_point=_zero_point}}), 0)
+// CCV_NNC_QUANTIZE_BACKWARD
+#define CMD_QUANTIZE_BACKWARD(_scale, _zero_point) ccv_nnc_cmd(CCV_NNC_QUANTIZE_BACKWARD, 0, ((ccv_nnc_cmd_param_t){.size={.dim={1,1,1}},.quant={.scale=_scale,.zero_point=_zero_point}}), 0)
+// CCV_NNC_QUANTIZED_CONVOLUTION_FORWARD
+#define CMD_QUANTIZED_CONVOLUTION_FORWARD(_scale, _zero_point, _activation, _count, ...) ccv_nnc_cmd(CCV_NNC_QUANTIZED_CONVOLUTION_FORWARD, 0, ((ccv_nnc_cmd_param_t){.size={.dim={__VA_ARGS__}},.quant={.scale=_scale,.zero_point=_zero_point,.count=_count,.activation=_activation}}), 0)
+// CCV_NNC_QUANTIZED_GEMM_FORWARD
+#define CMD_QUANTIZED_GEMM_FORWARD(_scale, _zero_point, _activation) ccv_nnc_cmd(CCV_NNC_QUANTIZED_GEMM_FORWARD, 0, ((ccv_nnc_cmd_param_t){.size={.dim={1,1,1}},.quant={.scale=_scale,.zero_point=_zero_point,.activation=_activation}}), 0)
 
 /** @} */
@@ -44,19 +44,22 @@ static int _ccv_nnc_conv_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint
 			break;
 		assert(w->info.dim[i] == cmd.info.size.dim[i - 1]);
 	}
+	// Reduced precision tensors only have the direct convolution kernel.
+	if (a->info.datatype != CCV_32F || w->info.datatype != CCV_32F || b->info.datatype != CCV_32F || (bias && bias->info.datatype != CCV_32F))
+		return (cmd.algorithm == CCV_NNC_CMD_OPT_CONV_ALGO_DC || cmd.algorithm == -1) ? _ccv_nnc_conv_forw_cpu_opt(a, w, bias, hint, b, 0) : CCV_NNC_EXEC_INVALID;
 	switch (cmd.algorithm)
 	{
 		case CCV_NNC_CMD_OPT_CONV_ALGO_DC:
-			return _ccv_nnc_conv_forw_cpu_opt(a, w, bias, hint, b);
+			return _ccv_nnc_conv_forw_cpu_opt(a, w, bias, hint, b, 0);
 		case CCV_NNC_CMD_OPT_CONV_ALGO_GEMM:
 			if (w->info.dim[1] == 1 && w->info.dim[2] == 1 && hint.stride.dim[0] <= 1 && hint.stride.dim[1] <= 1 &&
 				hint.border.begin[0] == 0 && hint.border.begin[1] == 0 && hint.border.end[0] == 0 && hint.border.end[1] == 0 &&
 				!CCV_IS_TENSOR_VIEW(a) && !CCV_IS_TENSOR_VIEW(b) && !CCV_IS_TENSOR_VIEW(w) && (!bias || !CCV_IS_TENSOR_VIEW(bias)))
-				return _ccv_nnc_conv_forw_gemm_cpu_opt(a, w, bias, hint, b);
+				return _ccv_nnc_conv_forw_gemm_cpu_opt(a, w, bias, hint, b, 0);
 			return CCV_NNC_EXEC_INVALID;
 		case CCV_NNC_CMD_OPT_CONV_ALGO_WINOGRAD:
 			if (w->info.dim[1] == 3 && w->info.dim[2] == 3 && hint.stride.dim[0] <= 1 && hint.stride.dim[1] <= 1)
-				return _ccv_nnc_conv_forw_4x4_3x3_winograd_cpu_opt(a, w, bias, hint, b, stream_context);
+				return _ccv_nnc_conv_forw_4x4_3x3_winograd_cpu_opt(a, w, bias, hint, b, 0, stream_context);
 			return CCV_NNC_EXEC_INVALID;
 		case CCV_NNC_CMD_OPT_CONV_ALGO_FFT:
 			return CCV_NNC_EXEC_INVALID; // Placeholder, for fft.
@@ -66,20 +69,20 @@ static int _ccv_nnc_conv_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint
 	}
 	// If the size is 3x3, and no stride, choose Winograd kernel
 	if (w->info.dim[1] == 3 && w->info.dim[2] == 3 && hint.stride.dim[0] <= 1 && hint.stride.dim[1] <= 1)
-		return _ccv_nnc_conv_forw_4x4_3x3_winograd_cpu_opt(a, w, bias, hint, b, stream_context);
+		return _ccv_nnc_conv_forw_4x4_3x3_winograd_cpu_opt(a, w, bias, hint, b, 0, stream_context);
 	// If the size is 1x1, and no stride, and not a tensor view object, no padding, choose GEMM kernel
 	if (w->info.dim[1] == 1 && w->info.dim[2] == 1 && hint.stride.dim[0] <= 1 && hint.stride.dim[1] <= 1 &&
 		hint.border.begin[0] == 0 && hint.border.begin[1] == 0 && hint.border.end[0] == 0 && hint.border.end[1] == 0 &&
 		!CCV_IS_TENSOR_VIEW(a) && !CCV_IS_TENSOR_VIEW(b) && !CCV_IS_TENSOR_VIEW(w) && (!bias || !CCV_IS_TENSOR_VIEW(bias)))
-		return _ccv_nnc_conv_forw_gemm_cpu_opt(a, w, bias, hint, b);
+		return _ccv_nnc_conv_forw_gemm_cpu_opt(a, w, bias, hint, b, 0);
 	// Otherwise, use direct convolution kernel
-	return _ccv_nnc_conv_forw_cpu_opt(a, w, bias, hint, b);
+	return _ccv_nnc_conv_forw_cpu_opt(a, w, bias, hint, b, 0);
 }
 
 REGISTER_COMMAND_BACKEND(CCV_NNC_CONVOLUTION_FORWARD, CCV_NNC_BACKEND_CPU_OPT)(ccv_nnc_cmd_backend_registry_t* const registry)
 {
 	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC;
-	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_datatypes = CCV_32F | CCV_16F | CCV_16BF;
 	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
 	registry->algorithms = CCV_NNC_CMD_OPT_CONV_ALGO_COUNT;
 	registry->exec = _ccv_nnc_conv_forw;
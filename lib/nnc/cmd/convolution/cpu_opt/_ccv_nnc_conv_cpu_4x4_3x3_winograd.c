@@ -8,6 +8,9 @@
 #elif defined(HAVE_NEON)
 #include <arm_neon.h>
 #endif
+#ifdef CCV_NNC_CPU_DISPATCH
+#include <immintrin.h>
+#endif
 #ifdef USE_OPENMP
 #include <omp.h>
 #endif
@@ -15,6 +18,7 @@
 #include <dispatch/dispatch.h>
 #endif
 #include "../_ccv_nnc_conv_cpu_opt.h"
+#include "../../_ccv_nnc_cpu_opt.h"
 
 #define set_n_m_dim(i, x, wd, ad) \
 	do { \
@@ -123,7 +127,7 @@ inline static void _ccv_nnc_winograd_4x4_3x3_gwtg_ref(const float* const w, cons
 	}
 }
 
-static int _ccv_nnc_conv_forw_4x4_3x3_winograd_ref(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_t* const w, const ccv_nnc_tensor_t* const bias, const ccv_nnc_hint_t hint, ccv_nnc_tensor_view_t* const b, ccv_nnc_stream_context_t* const stream_context)
+static int _ccv_nnc_conv_forw_4x4_3x3_winograd_ref(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_t* const w, const ccv_nnc_tensor_t* const bias, const ccv_nnc_hint_t hint, ccv_nnc_tensor_view_t* const b, const uint32_t activation, ccv_nnc_stream_context_t* const stream_context)
 {
 	const int a_nd = ccv_nnc_tensor_nd(a->info.dim);
 	assert(a_nd == CCV_NNC_MAX_DIM + 1 || a_nd == CCV_NNC_MAX_DIM + 2);
@@ -338,7 +342,7 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_ref(const ccv_nnc_tensor_view_t*
 							d[dy * 6 + 1] - d[dy * 6 + 2] + 8 * (d[dy * 6 + 3] - d[dy * 6 + 4]) + d[dy * 6 + 5] + biasval[k],
 						};
 						unroll_for(dx, z[1], 4) {
-							bpz[dx * binc[2]] = r[dx];
+							bpz[dx * binc[2]] = _ccv_nnc_cpu_opt_act(r[dx], activation);
 						} unroll_endfor
 						bpz += binc[1] * binc[2];
 					} unroll_endfor
@@ -519,7 +523,7 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_ref(const ccv_nnc_tensor_view_t*
 							d[dy * 6 + 1] - d[dy * 6 + 2] + 8 * (d[dy * 6 + 3] - d[dy * 6 + 4]) + d[dy * 6 + 5],
 						};
 						unroll_for(dx, z[1], 4) {
-							bpz[dx * binc[2]] = r[dx];
+							bpz[dx * binc[2]] = _ccv_nnc_cpu_opt_act(r[dx], activation);
 						} unroll_endfor
 						bpz += binc[1] * binc[2];
 					} unroll_endfor
@@ -624,7 +628,94 @@ inline static void _ccv_nnc_winograd_4x4_3x3_gwtg_sse2(const float* const w, con
 	} parallel_endfor
 }
 
-static int _ccv_nnc_conv_forw_4x4_3x3_winograd_sse2(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_t* const w, const ccv_nnc_tensor_t* const bias, const ccv_nnc_hint_t hint, ccv_nnc_tensor_view_t* const b, ccv_nnc_stream_context_t* const stream_context)
+static void _ccv_nnc_winograd_4x4_3x3_gwtg_sse2_pack(const ccv_nnc_tensor_t* const w, void* const gwtg, void* const context)
+{
+	const int dimCx4 = (w->info.dim[3] + 3) & -4;
+	memset(gwtg, 0, sizeof(float) * 36 * dimCx4 * w->info.dim[0]);
+	_ccv_nnc_winograd_4x4_3x3_gwtg_sse2(w->data.f32, w->info.dim, (float*)gwtg);
+}
+
+static void _ccv_nnc_winograd_4x4_3x3_gemm_sse2(const float* g, const float* wpz, float* const q, const int dimCx4)
+{
+	int j, c;
+	for (j = 0; j < 36; j++)
+	{
+		__m128 v40 = _mm_setzero_ps();
+		__m128 v41 = _mm_setzero_ps();
+		__m128 v42 = _mm_setzero_ps();
+		__m128 v43 = _mm_setzero_ps();
+		for (c = 0; c < dimCx4; c += 4)
+		{
+			__m128 g4 = _mm_load_ps(g);
+			__m128 w40 = _mm_load_ps(wpz);
+			__m128 w41 = _mm_load_ps(wpz + 4);
+			__m128 w42 = _mm_load_ps(wpz + 8);
+			__m128 w43 = _mm_load_ps(wpz + 12);
+			__m128 g40 = _mm_shuffle_ps(g4, g4, 0x00);
+			__m128 g41 = _mm_shuffle_ps(g4, g4, 0x55);
+			__m128 g42 = _mm_shuffle_ps(g4, g4, 0xAA);
+			__m128 g43 = _mm_shuffle_ps(g4, g4, 0xFF);
+			v40 = _mm_add_ps(_mm_mul_ps(w40, g40), v40);
+			v41 = _mm_add_ps(_mm_mul_ps(w41, g41), v41);
+			v42 = _mm_add_ps(_mm_mul_ps(w42, g42), v42);
+			v43 = _mm_add_ps(_mm_mul_ps(w43, g43), v43);
+			g += 4;
+			wpz += 16;
+		}
+		v40 = _mm_add_ps(v40, v41);
+		v42 = _mm_add_ps(v42, v43);
+		_mm_store_ps(q + j * 4, _mm_add_ps(v40, v42));
+	}
+}
+
+#ifdef CCV_NNC_CPU_DISPATCH
+// Two input channels at a time, one per 128-bit lane.
+__attribute__((target("avx2,fma"))) static void _ccv_nnc_winograd_4x4_3x3_gemm_avx2(const float* g, const float* wpz, float* const q, const int dimCx4)
+{
+	const __m256i lo = _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1);
+	const __m256i hi = _mm256_setr_epi32(2, 2, 2, 2, 3, 3, 3, 3);
+	int j, c;
+	for (j = 0; j < 36; j++)
+	{
+		__m256 v80 = _mm256_setzero_ps();
+		__m256 v81 = _mm256_setzero_ps();
+		for (c = 0; c < dimCx4; c += 4)
+		{
+			__m256 g8 = _mm256_broadcast_ps((const __m128*)g);
+			v80 = _mm256_fmadd_ps(_mm256_loadu_ps(wpz), _mm256_permutevar_ps(g8, lo), v80);
+			v81 = _mm256_fmadd_ps(_mm256_loadu_ps(wpz + 8), _mm256_permutevar_ps(g8, hi), v81);
+			g += 4;
+			wpz += 16;
+		}
+		v80 = _mm256_add_ps(v80, v81);
+		_mm_store_ps(q + j * 4, _mm_add_ps(_mm256_castps256_ps128(v80), _mm256_extractf128_ps(v80, 1)));
+	}
+}
+
+// Four input channels at a time, one per 128-bit lane.
+__attribute__((target("avx512f"))) static void _ccv_nnc_winograd_4x4_3x3_gemm_avx512(const float* g, const float* wpz, float* const q, const int dimCx4)
+{
+	const __m512i idx = _mm512_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3);
+	int j, c;
+	for (j = 0; j < 36; j++)
+	{
+		__m512 v160 = _mm512_setzero_ps();
+		for (c = 0; c < dimCx4; c += 4)
+		{
+			__m512 g16 = _mm512_permutexvar_ps(idx, _mm512_castps128_ps512(_mm_load_ps(g)));
+			v160 = _mm512_fmadd_ps(_mm512_loadu_ps(wpz), g16, v160);
+			g += 4;
+			wpz += 16;
+		}
+		__m256 v80 = _mm256_add_ps(_mm512_castps512_ps256(v160), _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v160), 1)));
+		_mm_store_ps(q + j * 4, _mm_add_ps(_mm256_castps256_ps128(v80), _mm256_extractf128_ps(v80, 1)));
+	}
+}
+#endif
+
+typedef void (*_ccv_nnc_winograd_4x4_3x3_gemm_f)(const float* g, const float* wpz, float* const q, const int dimCx4);
+
+static int _ccv_nnc_conv_forw_4x4_3x3_winograd_sse2(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_t* const w, const ccv_nnc_tensor_t* const bias, const ccv_nnc_hint_t hint, ccv_nnc_tensor_view_t* const b, const uint32_t activation, ccv_nnc_stream_context_t* const stream_context)
 {
 	const int a_nd = ccv_nnc_tensor_nd(a->info.dim);
 	assert(a_nd == CCV_NNC_MAX_DIM + 1 || a_nd == CCV_NNC_MAX_DIM + 2);
@@ -641,28 +732,45 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_sse2(const ccv_nnc_tensor_view_t*
 	assert(w->info.dim[2] == 3);
 	const int jump_dim = (bdim[0] + 3) / 4;
 	const int dimCx4 = (adim[2] + 3) & -4;
-	// allocating workspace memory for kernel reshaping and input reshaping.
+	// Reuse the transformed weights if the weights haven't changed since.
+	const size_t gwtg_size = sizeof(float) * 36 * dimCx4 * w->info.dim[0];
+	float* const packed_gwtg = (float*)ccv_nnc_tensor_packed_retain(w, CCV_NNC_TENSOR_PACKED_CONV_GWTG, gwtg_size, _ccv_nnc_winograd_4x4_3x3_gwtg_sse2_pack, 0);
+	// allocating workspace memory for kernel reshaping (if not packed already) and input reshaping.
+	const size_t gwtg_workspace_size = packed_gwtg ? 0 : gwtg_size;
 	float* workmem = 0;
 #if FOR_IS_PARALLEL
 	// If we do parallel for, we need to allocate input reshaping for each block.
-	workmem = ccv_nnc_stream_context_get_workspace(stream_context, sizeof(float) * (36 * dimCx4 * jump_dim + 36 * dimCx4 * w->info.dim[0]), CCV_TENSOR_CPU_MEMORY);
+	workmem = ccv_nnc_stream_context_get_workspace(stream_context, sizeof(float) * 36 * dimCx4 * jump_dim + gwtg_workspace_size, CCV_TENSOR_CPU_MEMORY);
 #else
 	// Otherwise, just one block.
-	workmem = ccv_nnc_stream_context_get_workspace(stream_context, sizeof(float) * (36 * dimCx4 + 36 * dimCx4 * w->info.dim[0]), CCV_TENSOR_CPU_MEMORY);
+	workmem = ccv_nnc_stream_context_get_workspace(stream_context, sizeof(float) * 36 * dimCx4 + gwtg_workspace_size, CCV_TENSOR_CPU_MEMORY);
 #endif
 	if (!workmem)
+	{
+		if (packed_gwtg)
+			ccv_nnc_tensor_packed_release(packed_gwtg);
 		return CCV_NNC_EXEC_OOM;
+	}
 	// Convert w to a 6x6 matrix, by computing G.w.T(G) // T for transpose.
-	float* const gwtg = workmem;
-	float* const btdb = workmem + 36 * dimCx4 * w->info.dim[0];
-	memset(gwtg, 0, sizeof(float) * 36 * dimCx4 * w->info.dim[0]);
-	_ccv_nnc_winograd_4x4_3x3_gwtg_sse2(w->data.f32, w->info.dim, gwtg);
+	float* const gwtg = packed_gwtg ? packed_gwtg : workmem;
+	float* const btdb = packed_gwtg ? workmem : workmem + 36 * dimCx4 * w->info.dim[0];
+	if (!packed_gwtg)
+		_ccv_nnc_winograd_4x4_3x3_gwtg_sse2_pack(w, gwtg, 0);
 	// kernel weight for one dim.
 	// Workaround issues of dispatch_apply (cannot reference to on-stack array)
 	const int tile_dim_s[CCV_NNC_MAX_DIM_ALLOC] = {
 		w->info.dim[0], 6, 6, w->info.dim[3]
 	};
 	const int* const tile_dim = tile_dim_s;
+	// The products in the transformed domain dominate, pick the widest kernel available for them.
+	_ccv_nnc_winograd_4x4_3x3_gemm_f gemm = _ccv_nnc_winograd_4x4_3x3_gemm_sse2;
+#ifdef CCV_NNC_CPU_DISPATCH
+	const int cpu_features = ccv_nnc_cpu_features();
+	if (cpu_features & CCV_NNC_CPU_FEATURE_AVX512F)
+		gemm = _ccv_nnc_winograd_4x4_3x3_gemm_avx512;
+	else if (cpu_features & CCV_NNC_CPU_FEATURE_AVX2)
+		gemm = _ccv_nnc_winograd_4x4_3x3_gemm_avx2;
+#endif
 	if (bias)
 	{
 		const float* const biasval = bias->data.f32;
@@ -790,34 +898,8 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_sse2(const ccv_nnc_tensor_view_t*
 #else
 					g = btdb;
 #endif
-					for (j = 0; j < 36; j++)
-					{
-						__m128 v40 = _mm_setzero_ps();
-						__m128 v41 = _mm_setzero_ps();
-						__m128 v42 = _mm_setzero_ps();
-						__m128 v43 = _mm_setzero_ps();
-						for (c = 0; c < adim[2]; c += 4)
-						{
-							__m128 g4 = _mm_load_ps(g);
-							__m128 w40 = _mm_load_ps(wpz);
-							__m128 w41 = _mm_load_ps(wpz + 4);
-							__m128 w42 = _mm_load_ps(wpz + 8);
-							__m128 w43 = _mm_load_ps(wpz + 12);
-							__m128 g40 = _mm_shuffle_ps(g4, g4, 0x00);
-							__m128 g41 = _mm_shuffle_ps(g4, g4, 0x55);
-							__m128 g42 = _mm_shuffle_ps(g4, g4, 0xAA);
-							__m128 g43 = _mm_shuffle_ps(g4, g4, 0xFF);
-							v40 = _mm_add_ps(_mm_mul_ps(w40, g40), v40);
-							v41 = _mm_add_ps(_mm_mul_ps(w41, g41), v41);
-							v42 = _mm_add_ps(_mm_mul_ps(w42, g42), v42);
-							v43 = _mm_add_ps(_mm_mul_ps(w43, g43), v43);
-							g += 4;
-							wpz += 16;
-						}
-						v40 = _mm_add_ps(v40, v41);
-						v42 = _mm_add_ps(v42, v43);
-						_mm_store_ps(q + j * 4, _mm_add_ps(v40, v42));
-					}
+					gemm(g, wpz, q, dimCx4);
+					wpz += 36 * dimCx4 * 4;
 					float d[24 * 4] __attribute__ ((__aligned__(16)));
 					unroll_for(j, 6) {
 						const float* const qz = q + j * 4;
@@ -861,7 +943,7 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_sse2(const ccv_nnc_tensor_view_t*
 								__m128 ds1x2 = _mm_add_ps(d1, d2);
 								__m128 ds3x4 = _mm_add_ps(d3, d4);
 								ds1x2 = _mm_add_ps(ds1x2, bias4);
-								_mm_stream_ps(bpz, _mm_add_ps(ds1x2, _mm_add_ps(d0, ds3x4)));
+								_mm_stream_ps(bpz, _ccv_nnc_act_ps_sse2(_mm_add_ps(ds1x2, _mm_add_ps(d0, ds3x4)), activation));
 								bpz += binc[1] * binc[2];
 							} unroll_endfor
 							break;
@@ -876,12 +958,12 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_sse2(const ccv_nnc_tensor_view_t*
 								__m128 ds1x2 = _mm_add_ps(d1, d2);
 								__m128 ds3x4 = _mm_add_ps(d3, d4);
 								ds1x2 = _mm_add_ps(ds1x2, bias4);
-								_mm_stream_ps(bpz, _mm_add_ps(ds1x2, _mm_add_ps(d0, ds3x4)));
+								_mm_stream_ps(bpz, _ccv_nnc_act_ps_sse2(_mm_add_ps(ds1x2, _mm_add_ps(d0, ds3x4)), activation));
 								__m128 dn1x2 = _mm_sub_ps(d1, d2);
 								__m128 dn3x4 = _mm_sub_ps(d3, d4);
 								dn3x4 = _mm_add_ps(dn3x4, dn3x4);
 								dn1x2 = _mm_add_ps(dn1x2, bias4);
-								_mm_stream_ps(bpz + binc[2], _mm_add_ps(dn1x2, dn3x4));
+								_mm_stream_ps(bpz + binc[2], _ccv_nnc_act_ps_sse2(_mm_add_ps(dn1x2, dn3x4), activation));
 								bpz += binc[1] * binc[2];
 							} unroll_endfor
 							break;
@@ -896,15 +978,15 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_sse2(const ccv_nnc_tensor_view_t*
 								__m128 ds1x2 = _mm_add_ps(d1, d2);
 								__m128 ds3x4 = _mm_add_ps(d3, d4);
 								ds1x2 = _mm_add_ps(ds1x2, bias4);
-								_mm_stream_ps(bpz, _mm_add_ps(ds1x2, _mm_add_ps(d0, ds3x4)));
+								_mm_stream_ps(bpz, _ccv_nnc_act_ps_sse2(_mm_add_ps(ds1x2, _mm_add_ps(d0, ds3x4)), activation));
 								__m128 dn1x2 = _mm_sub_ps(d1, d2);
 								__m128 dn3x4 = _mm_sub_ps(d3, d4);
 								dn3x4 = _mm_add_ps(dn3x4, dn3x4);
 								dn1x2 = _mm_add_ps(dn1x2, bias4);
-								_mm_stream_ps(bpz + binc[2], _mm_add_ps(dn1x2, dn3x4));
+								_mm_stream_ps(bpz + binc[2], _ccv_nnc_act_ps_sse2(_mm_add_ps(dn1x2, dn3x4), activation));
 								ds3x4 = _mm_add_ps(ds3x4, ds3x4);
 								ds3x4 = _mm_add_ps(ds3x4, ds3x4);
-								_mm_stream_ps(bpz + 2 * binc[2], _mm_add_ps(ds1x2, ds3x4));
+								_mm_stream_ps(bpz + 2 * binc[2], _ccv_nnc_act_ps_sse2(_mm_add_ps(ds1x2, ds3x4), activation));
 								bpz += binc[1] * binc[2];
 							} unroll_endfor
 							break;
@@ -919,19 +1001,19 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_sse2(const ccv_nnc_tensor_view_t*
 								__m128 ds1x2 = _mm_add_ps(d1, d2);
 								__m128 ds3x4 = _mm_add_ps(d3, d4);
 								ds1x2 = _mm_add_ps(ds1x2, bias4);
-								_mm_stream_ps(bpz, _mm_add_ps(ds1x2, _mm_add_ps(d0, ds3x4)));
+								_mm_stream_ps(bpz, _ccv_nnc_act_ps_sse2(_mm_add_ps(ds1x2, _mm_add_ps(d0, ds3x4)), activation));
 								__m128 dn1x2 = _mm_sub_ps(d1, d2);
 								__m128 dn3x4 = _mm_sub_ps(d3, d4);
 								dn3x4 = _mm_add_ps(dn3x4, dn3x4);
 								dn1x2 = _mm_add_ps(dn1x2, bias4);
-								_mm_stream_ps(bpz + binc[2], _mm_add_ps(dn1x2, dn3x4));
+								_mm_stream_ps(bpz + binc[2], _ccv_nnc_act_ps_sse2(_mm_add_ps(dn1x2, dn3x4), activation));
 								ds3x4 = _mm_add_ps(ds3x4, ds3x4);
 								ds3x4 = _mm_add_ps(ds3x4, ds3x4);
-								_mm_stream_ps(bpz + 2 * binc[2], _mm_add_ps(ds1x2, ds3x4));
+								_mm_stream_ps(bpz + 2 * binc[2], _ccv_nnc_act_ps_sse2(_mm_add_ps(ds1x2, ds3x4), activation));
 								__m128 d5 = _mm_load_ps(dz + 20);
 								dn3x4 = _mm_add_ps(dn3x4, dn3x4);
 								dn3x4 = _mm_add_ps(dn3x4, dn3x4);
-								_mm_stream_ps(bpz + 3 * binc[2], _mm_add_ps(_mm_add_ps(dn1x2, d5), dn3x4));
+								_mm_stream_ps(bpz + 3 * binc[2], _ccv_nnc_act_ps_sse2(_mm_add_ps(_mm_add_ps(dn1x2, d5), dn3x4), activation));
 								bpz += binc[1] * binc[2];
 							} unroll_endfor
 							break;
@@ -1064,34 +1146,8 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_sse2(const ccv_nnc_tensor_view_t*
 #else
 					g = btdb;
 #endif
-					for (j = 0; j < 36; j++)
-					{
-						__m128 v40 = _mm_setzero_ps();
-						__m128 v41 = _mm_setzero_ps();
-						__m128 v42 = _mm_setzero_ps();
-						__m128 v43 = _mm_setzero_ps();
-						for (c = 0; c < adim[2]; c += 4)
-						{
-							__m128 g4 = _mm_load_ps(g);
-							__m128 w40 = _mm_load_ps(wpz);
-							__m128 w41 = _mm_load_ps(wpz + 4);
-							__m128 w42 = _mm_load_ps(wpz + 8);
-							__m128 w43 = _mm_load_ps(wpz + 12);
-							__m128 g40 = _mm_shuffle_ps(g4, g4, 0x00);
-							__m128 g41 = _mm_shuffle_ps(g4, g4, 0x55);
-							__m128 g42 = _mm_shuffle_ps(g4, g4, 0xAA);
-							__m128 g43 = _mm_shuffle_ps(g4, g4, 0xFF);
-							v40 = _mm_add_ps(_mm_mul_ps(w40, g40), v40);
-							v41 = _mm_add_ps(_mm_mul_ps(w41, g41), v41);
-							v42 = _mm_add_ps(_mm_mul_ps(w42, g42), v42);
-							v43 = _mm_add_ps(_mm_mul_ps(w43, g43), v43);
-							g += 4;
-							wpz += 16;
-						}
-						v40 = _mm_add_ps(v40, v41);
-						v42 = _mm_add_ps(v42, v43);
-						_mm_store_ps(q + j * 4, _mm_add_ps(v40, v42));
-					}
+					gemm(g, wpz, q, dimCx4);
+					wpz += 36 * dimCx4 * 4;
 					float d[24 * 4] __attribute__ ((__aligned__(16)));
 					unroll_for(j, 6) {
 						const float* const qz = q + j * 4;
@@ -1133,7 +1189,7 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_sse2(const ccv_nnc_tensor_view_t*
 								__m128 d4 = _mm_load_ps(dz + 16);
 								__m128 ds1x2 = _mm_add_ps(d1, d2);
 								__m128 ds3x4 = _mm_add_ps(d3, d4);
-								_mm_stream_ps(bpz, _mm_add_ps(ds1x2, _mm_add_ps(d0, ds3x4)));
+								_mm_stream_ps(bpz, _ccv_nnc_act_ps_sse2(_mm_add_ps(ds1x2, _mm_add_ps(d0, ds3x4)), activation));
 								bpz += binc[1] * binc[2];
 							} unroll_endfor
 							break;
@@ -1147,11 +1203,11 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_sse2(const ccv_nnc_tensor_view_t*
 								__m128 d4 = _mm_load_ps(dz + 16);
 								__m128 ds1x2 = _mm_add_ps(d1, d2);
 								__m128 ds3x4 = _mm_add_ps(d3, d4);
-								_mm_stream_ps(bpz, _mm_add_ps(ds1x2, _mm_add_ps(d0, ds3x4)));
+								_mm_stream_ps(bpz, _ccv_nnc_act_ps_sse2(_mm_add_ps(ds1x2, _mm_add_ps(d0, ds3x4)), activation));
 								__m128 dn1x2 = _mm_sub_ps(d1, d2);
 								__m128 dn3x4 = _mm_sub_ps(d3, d4);
 								dn3x4 = _mm_add_ps(dn3x4, dn3x4);
-								_mm_stream_ps(bpz + binc[2], _mm_add_ps(dn1x2, dn3x4));
+								_mm_stream_ps(bpz + binc[2], _ccv_nnc_act_ps_sse2(_mm_add_ps(dn1x2, dn3x4), activation));
 								bpz += binc[1] * binc[2];
 							} unroll_endfor
 							break;
@@ -1165,14 +1221,14 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_sse2(const ccv_nnc_tensor_view_t*
 								__m128 d4 = _mm_load_ps(dz + 16);
 								__m128 ds1x2 = _mm_add_ps(d1, d2);
 								__m128 ds3x4 = _mm_add_ps(d3, d4);
-								_mm_stream_ps(bpz, _mm_add_ps(ds1x2, _mm_add_ps(d0, ds3x4)));
+								_mm_stream_ps(bpz, _ccv_nnc_act_ps_sse2(_mm_add_ps(ds1x2, _mm_add_ps(d0, ds3x4)), activation));
 								__m128 dn1x2 = _mm_sub_ps(d1, d2);
 								__m128 dn3x4 = _mm_sub_ps(d3, d4);
 								dn3x4 = _mm_add_ps(dn3x4, dn3x4);
-								_mm_stream_ps(bpz + binc[2], _mm_add_ps(dn1x2, dn3x4));
+								_mm_stream_ps(bpz + binc[2], _ccv_nnc_act_ps_sse2(_mm_add_ps(dn1x2, dn3x4), activation));
 								ds3x4 = _mm_add_ps(ds3x4, ds3x4);
 								ds3x4 = _mm_add_ps(ds3x4, ds3x4);
-								_mm_stream_ps(bpz + 2 * binc[2], _mm_add_ps(ds1x2, ds3x4));
+								_mm_stream_ps(bpz + 2 * binc[2], _ccv_nnc_act_ps_sse2(_mm_add_ps(ds1x2, ds3x4), activation));
 								bpz += binc[1] * binc[2];
 							} unroll_endfor
 							break;
@@ -1186,18 +1242,18 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_sse2(const ccv_nnc_tensor_view_t*
 								__m128 d4 = _mm_load_ps(dz + 16);
 								__m128 ds1x2 = _mm_add_ps(d1, d2);
 								__m128 ds3x4 = _mm_add_ps(d3, d4);
-								_mm_stream_ps(bpz, _mm_add_ps(ds1x2, _mm_add_ps(d0, ds3x4)));
+								_mm_stream_ps(bpz, _ccv_nnc_act_ps_sse2(_mm_add_ps(ds1x2, _mm_add_ps(d0, ds3x4)), activation));
 								__m128 dn1x2 = _mm_sub_ps(d1, d2);
 								__m128 dn3x4 = _mm_sub_ps(d3, d4);
 								dn3x4 = _mm_add_ps(dn3x4, dn3x4);
-								_mm_stream_ps(bpz + binc[2], _mm_add_ps(dn1x2, dn3x4));
+								_mm_stream_ps(bpz + binc[2], _ccv_nnc_act_ps_sse2(_mm_add_ps(dn1x2, dn3x4), activation));
 								ds3x4 = _mm_add_ps(ds3x4, ds3x4);
 								ds3x4 = _mm_add_ps(ds3x4, ds3x4);
-								_mm_stream_ps(bpz + 2 * binc[2], _mm_add_ps(ds1x2, ds3x4));
+								_mm_stream_ps(bpz + 2 * binc[2], _ccv_nnc_act_ps_sse2(_mm_add_ps(ds1x2, ds3x4), activation));
 								__m128 d5 = _mm_load_ps(dz + 20);
 								dn3x4 = _mm_add_ps(dn3x4, dn3x4);
 								dn3x4 = _mm_add_ps(dn3x4, dn3x4);
-								_mm_stream_ps(bpz + 3 * binc[2], _mm_add_ps(_mm_add_ps(dn1x2, d5), dn3x4));
+								_mm_stream_ps(bpz + 3 * binc[2], _ccv_nnc_act_ps_sse2(_mm_add_ps(_mm_add_ps(dn1x2, d5), dn3x4), activation));
 								bpz += binc[1] * binc[2];
 							} unroll_endfor
 							break;
@@ -1206,6 +1262,8 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_sse2(const ccv_nnc_tensor_view_t*
 			}
 		} parallel_endfor
 	}
+	if (packed_gwtg)
+		ccv_nnc_tensor_packed_release(packed_gwtg);
 	return CCV_NNC_EXEC_SUCCESS;
 }
 #endif
@@ -1304,7 +1362,14 @@ inline static void _ccv_nnc_winograd_4x4_3x3_gwtg_neon(const float* const w, con
 	} parallel_endfor
 }
 
-static int _ccv_nnc_conv_forw_4x4_3x3_winograd_neon(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_t* const w, const ccv_nnc_tensor_t* const bias, const ccv_nnc_hint_t hint, ccv_nnc_tensor_view_t* const b, ccv_nnc_stream_context_t* const stream_context)
+static void _ccv_nnc_winograd_4x4_3x3_gwtg_neon_pack(const ccv_nnc_tensor_t* const w, void* const gwtg, void* const context)
+{
+	const int dimCx4 = (w->info.dim[3] + 3) & -4;
+	memset(gwtg, 0, sizeof(float) * 36 * dimCx4 * w->info.dim[0]);
+	_ccv_nnc_winograd_4x4_3x3_gwtg_neon(w->data.f32, w->info.dim, (float*)gwtg);
+}
+
+static int _ccv_nnc_conv_forw_4x4_3x3_winograd_neon(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_t* const w, const ccv_nnc_tensor_t* const bias, const ccv_nnc_hint_t hint, ccv_nnc_tensor_view_t* const b, const uint32_t activation, ccv_nnc_stream_context_t* const stream_context)
 {
 	const int a_nd = ccv_nnc_tensor_nd(a->info.dim);
 	assert(a_nd == CCV_NNC_MAX_DIM + 1 || a_nd == CCV_NNC_MAX_DIM + 2);
@@ -1321,22 +1386,30 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_neon(const ccv_nnc_tensor_view_t*
 	assert(w->info.dim[2] == 3);
 	const int jump_dim = (bdim[0] + 3) / 4;
 	const int dimCx4 = (adim[2] + 3) & -4;
-	// allocating workspace memory for kernel reshaping and input reshaping.
+	// Reuse the transformed weights if the weights haven't changed since.
+	const size_t gwtg_size = sizeof(float) * 36 * dimCx4 * w->info.dim[0];
+	float* const packed_gwtg = (float*)ccv_nnc_tensor_packed_retain(w, CCV_NNC_TENSOR_PACKED_CONV_GWTG, gwtg_size, _ccv_nnc_winograd_4x4_3x3_gwtg_neon_pack, 0);
+	// allocating workspace memory for kernel reshaping (if not packed already) and input reshaping.
+	const size_t gwtg_workspace_size = packed_gwtg ? 0 : gwtg_size;
 	float* workmem = 0;
 #if FOR_IS_PARALLEL
 	// If we do parallel for, we need to allocate input reshaping for each block.
-	workmem = (float*)ccv_nnc_stream_context_get_workspace(stream_context, sizeof(float) * (36 * dimCx4 * jump_dim + 36 * dimCx4 * w->info.dim[0]), CCV_TENSOR_CPU_MEMORY);
+	workmem = (float*)ccv_nnc_stream_context_get_workspace(stream_context, sizeof(float) * 36 * dimCx4 * jump_dim + gwtg_workspace_size, CCV_TENSOR_CPU_MEMORY);
 #else
 	// Otherwise, just one block.
-	workmem = (float*)ccv_nnc_stream_context_get_workspace(stream_context, sizeof(float) * (36 * dimCx4 + 36 * dimCx4 * w->info.dim[0]), CCV_TENSOR_CPU_MEMORY);
+	workmem = (float*)ccv_nnc_stream_context_get_workspace(stream_context, sizeof(float) * 36 * dimCx4 + gwtg_workspace_size, CCV_TENSOR_CPU_MEMORY);
 #endif
 	if (!workmem)
+	{
+		if (packed_gwtg)
+			ccv_nnc_tensor_packed_release(packed_gwtg);
 		return CCV_NNC_EXEC_OOM;
+	}
 	// Convert w to a 6x6 matrix, by computing G.w.T(G) // T for transpose.
-	float* const gwtg = workmem;
-	float* const btdb = workmem + 36 * dimCx4 * w->info.dim[0];
-	memset(gwtg, 0, sizeof(float) * 36 * dimCx4 * w->info.dim[0]);
-	_ccv_nnc_winograd_4x4_3x3_gwtg_neon(w->data.f32, w->info.dim, gwtg);
+	float* const gwtg = packed_gwtg ? packed_gwtg : workmem;
+	float* const btdb = packed_gwtg ? workmem : workmem + 36 * dimCx4 * w->info.dim[0];
+	if (!packed_gwtg)
+		_ccv_nnc_winograd_4x4_3x3_gwtg_neon_pack(w, gwtg, 0);
 	// kernel weight for one dim.
 	// Workaround issues of dispatch_apply (cannot reference to on-stack array)
 	const int tile_dim_s[CCV_NNC_MAX_DIM_ALLOC] = {
@@ -1541,7 +1614,7 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_neon(const ccv_nnc_tensor_view_t*
 								float32x4_t ds1x2 = vaddq_f32(d1, d2);
 								float32x4_t ds3x4 = vaddq_f32(d3, d4);
 								ds1x2 = vaddq_f32(ds1x2, bias4);
-								vst1q_f32(bpz, vaddq_f32(ds1x2, vaddq_f32(d0, ds3x4)));
+								vst1q_f32(bpz, _ccv_nnc_act_ps_neon(vaddq_f32(ds1x2, vaddq_f32(d0, ds3x4)), activation));
 								bpz += binc[1] * binc[2];
 							} unroll_endfor
 							break;
@@ -1556,12 +1629,12 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_neon(const ccv_nnc_tensor_view_t*
 								float32x4_t ds1x2 = vaddq_f32(d1, d2);
 								float32x4_t ds3x4 = vaddq_f32(d3, d4);
 								ds1x2 = vaddq_f32(ds1x2, bias4);
-								vst1q_f32(bpz, vaddq_f32(ds1x2, vaddq_f32(d0, ds3x4)));
+								vst1q_f32(bpz, _ccv_nnc_act_ps_neon(vaddq_f32(ds1x2, vaddq_f32(d0, ds3x4)), activation));
 								float32x4_t dn1x2 = vsubq_f32(d1, d2);
 								float32x4_t dn3x4 = vsubq_f32(d3, d4);
 								dn3x4 = vaddq_f32(dn3x4, dn3x4);
 								dn1x2 = vaddq_f32(dn1x2, bias4);
-								vst1q_f32(bpz + binc[2], vaddq_f32(dn1x2, dn3x4));
+								vst1q_f32(bpz + binc[2], _ccv_nnc_act_ps_neon(vaddq_f32(dn1x2, dn3x4), activation));
 								bpz += binc[1] * binc[2];
 							} unroll_endfor
 							break;
@@ -1576,15 +1649,15 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_neon(const ccv_nnc_tensor_view_t*
 								float32x4_t ds1x2 = vaddq_f32(d1, d2);
 								float32x4_t ds3x4 = vaddq_f32(d3, d4);
 								ds1x2 = vaddq_f32(ds1x2, bias4);
-								vst1q_f32(bpz, vaddq_f32(ds1x2, vaddq_f32(d0, ds3x4)));
+								vst1q_f32(bpz, _ccv_nnc_act_ps_neon(vaddq_f32(ds1x2, vaddq_f32(d0, ds3x4)), activation));
 								float32x4_t dn1x2 = vsubq_f32(d1, d2);
 								float32x4_t dn3x4 = vsubq_f32(d3, d4);
 								dn3x4 = vaddq_f32(dn3x4, dn3x4);
 								dn1x2 = vaddq_f32(dn1x2, bias4);
-								vst1q_f32(bpz + binc[2], vaddq_f32(dn1x2, dn3x4));
+								vst1q_f32(bpz + binc[2], _ccv_nnc_act_ps_neon(vaddq_f32(dn1x2, dn3x4), activation));
 								ds3x4 = vaddq_f32(ds3x4, ds3x4);
 								ds3x4 = vaddq_f32(ds3x4, ds3x4);
-								vst1q_f32(bpz + 2 * binc[2], vaddq_f32(ds1x2, ds3x4));
+								vst1q_f32(bpz + 2 * binc[2], _ccv_nnc_act_ps_neon(vaddq_f32(ds1x2, ds3x4), activation));
 								bpz += binc[1] * binc[2];
 							} unroll_endfor
 							break;
@@ -1599,19 +1672,19 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_neon(const ccv_nnc_tensor_view_t*
 								float32x4_t ds1x2 = vaddq_f32(d1, d2);
 								float32x4_t ds3x4 = vaddq_f32(d3, d4);
 								ds1x2 = vaddq_f32(ds1x2, bias4);
-								vst1q_f32(bpz, vaddq_f32(ds1x2, vaddq_f32(d0, ds3x4)));
+								vst1q_f32(bpz, _ccv_nnc_act_ps_neon(vaddq_f32(ds1x2, vaddq_f32(d0, ds3x4)), activation));
 								float32x4_t dn1x2 = vsubq_f32(d1, d2);
 								float32x4_t dn3x4 = vsubq_f32(d3, d4);
 								dn3x4 = vaddq_f32(dn3x4, dn3x4);
 								dn1x2 = vaddq_f32(dn1x2, bias4);
-								vst1q_f32(bpz + binc[2], vaddq_f32(dn1x2, dn3x4));
+								vst1q_f32(bpz + binc[2], _ccv_nnc_act_ps_neon(vaddq_f32(dn1x2, dn3x4), activation));
 								ds3x4 = vaddq_f32(ds3x4, ds3x4);
 								ds3x4 = vaddq_f32(ds3x4, ds3x4);
-								vst1q_f32(bpz + 2 * binc[2], vaddq_f32(ds1x2, ds3x4));
+								vst1q_f32(bpz + 2 * binc[2], _ccv_nnc_act_ps_neon(vaddq_f32(ds1x2, ds3x4), activation));
 								float32x4_t d5 = vld1q_f32(dz + 20);
 								dn3x4 = vaddq_f32(dn3x4, dn3x4);
 								dn3x4 = vaddq_f32(dn3x4, dn3x4);
-								vst1q_f32(bpz + 3 * binc[2], vaddq_f32(vaddq_f32(dn1x2, d5), dn3x4));
+								vst1q_f32(bpz + 3 * binc[2], _ccv_nnc_act_ps_neon(vaddq_f32(vaddq_f32(dn1x2, d5), dn3x4), activation));
 								bpz += binc[1] * binc[2];
 							} unroll_endfor
 							break;
@@ -1813,7 +1886,7 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_neon(const ccv_nnc_tensor_view_t*
 								float32x4_t d4 = vld1q_f32(dz + 16);
 								float32x4_t ds1x2 = vaddq_f32(d1, d2);
 								float32x4_t ds3x4 = vaddq_f32(d3, d4);
-								vst1q_f32(bpz, vaddq_f32(ds1x2, vaddq_f32(d0, ds3x4)));
+								vst1q_f32(bpz, _ccv_nnc_act_ps_neon(vaddq_f32(ds1x2, vaddq_f32(d0, ds3x4)), activation));
 								bpz += binc[1] * binc[2];
 							} unroll_endfor
 							break;
@@ -1827,11 +1900,11 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_neon(const ccv_nnc_tensor_view_t*
 								float32x4_t d4 = vld1q_f32(dz + 16);
 								float32x4_t ds1x2 = vaddq_f32(d1, d2);
 								float32x4_t ds3x4 = vaddq_f32(d3, d4);
-								vst1q_f32(bpz, vaddq_f32(ds1x2, vaddq_f32(d0, ds3x4)));
+								vst1q_f32(bpz, _ccv_nnc_act_ps_neon(vaddq_f32(ds1x2, vaddq_f32(d0, ds3x4)), activation));
 								float32x4_t dn1x2 = vsubq_f32(d1, d2);
 								float32x4_t dn3x4 = vsubq_f32(d3, d4);
 								dn3x4 = vaddq_f32(dn3x4, dn3x4);
-								vst1q_f32(bpz + binc[2], vaddq_f32(dn1x2, dn3x4));
+								vst1q_f32(bpz + binc[2], _ccv_nnc_act_ps_neon(vaddq_f32(dn1x2, dn3x4), activation));
 								bpz += binc[1] * binc[2];
 							} unroll_endfor
 							break;
@@ -1845,14 +1918,14 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_neon(const ccv_nnc_tensor_view_t*
 								float32x4_t d4 = vld1q_f32(dz + 16);
 								float32x4_t ds1x2 = vaddq_f32(d1, d2);
 								float32x4_t ds3x4 = vaddq_f32(d3, d4);
-								vst1q_f32(bpz, vaddq_f32(ds1x2, vaddq_f32(d0, ds3x4)));
+								vst1q_f32(bpz, _ccv_nnc_act_ps_neon(vaddq_f32(ds1x2, vaddq_f32(d0, ds3x4)), activation));
 								float32x4_t dn1x2 = vsubq_f32(d1, d2);
 								float32x4_t dn3x4 = vsubq_f32(d3, d4);
 								dn3x4 = vaddq_f32(dn3x4, dn3x4);
-								vst1q_f32(bpz + binc[2], vaddq_f32(dn1x2, dn3x4));
+								vst1q_f32(bpz + binc[2], _ccv_nnc_act_ps_neon(vaddq_f32(dn1x2, dn3x4), activation));
 								ds3x4 = vaddq_f32(ds3x4, ds3x4);
 								ds3x4 = vaddq_f32(ds3x4, ds3x4);
-								vst1q_f32(bpz + 2 * binc[2], vaddq_f32(ds1x2, ds3x4));
+								vst1q_f32(bpz + 2 * binc[2], _ccv_nnc_act_ps_neon(vaddq_f32(ds1x2, ds3x4), activation));
 								bpz += binc[1] * binc[2];
 							} unroll_endfor
 							break;
@@ -1866,18 +1939,18 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_neon(const ccv_nnc_tensor_view_t*
 								float32x4_t d4 = vld1q_f32(dz + 16);
 								float32x4_t ds1x2 = vaddq_f32(d1, d2);
 								float32x4_t ds3x4 = vaddq_f32(d3, d4);
-								vst1q_f32(bpz, vaddq_f32(ds1x2, vaddq_f32(d0, ds3x4)));
+								vst1q_f32(bpz, _ccv_nnc_act_ps_neon(vaddq_f32(ds1x2, vaddq_f32(d0, ds3x4)), activation));
 								float32x4_t dn1x2 = vsubq_f32(d1, d2);
 								float32x4_t dn3x4 = vsubq_f32(d3, d4);
 								dn3x4 = vaddq_f32(dn3x4, dn3x4);
-								vst1q_f32(bpz + binc[2], vaddq_f32(dn1x2, dn3x4));
+								vst1q_f32(bpz + binc[2], _ccv_nnc_act_ps_neon(vaddq_f32(dn1x2, dn3x4), activation));
 								ds3x4 = vaddq_f32(ds3x4, ds3x4);
 								ds3x4 = vaddq_f32(ds3x4, ds3x4);
-								vst1q_f32(bpz + 2 * binc[2], vaddq_f32(ds1x2, ds3x4));
+								vst1q_f32(bpz + 2 * binc[2], _ccv_nnc_act_ps_neon(vaddq_f32(ds1x2, ds3x4), activation));
 								float32x4_t d5 = vld1q_f32(dz + 20);
 								dn3x4 = vaddq_f32(dn3x4, dn3x4);
 								dn3x4 = vaddq_f32(dn3x4, dn3x4);
-								vst1q_f32(bpz + 3 * binc[2], vaddq_f32(vaddq_f32(dn1x2, d5), dn3x4));
+								vst1q_f32(bpz + 3 * binc[2], _ccv_nnc_act_ps_neon(vaddq_f32(vaddq_f32(dn1x2, d5), dn3x4), activation));
 								bpz += binc[1] * binc[2];
 							} unroll_endfor
 							break;
@@ -1886,18 +1959,20 @@ static int _ccv_nnc_conv_forw_4x4_3x3_winograd_neon(const ccv_nnc_tensor_view_t*
 			}
 		} parallel_endfor
 	}
+	if (packed_gwtg)
+		ccv_nnc_tensor_packed_release(packed_gwtg);
 	return CCV_NNC_EXEC_SUCCESS;
 }
 #endif
 
-int _ccv_nnc_conv_forw_4x4_3x3_winograd_cpu_opt(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_t* const w, const ccv_nnc_tensor_t* const bias, const ccv_nnc_hint_t hint, ccv_nnc_tensor_view_t* const b, ccv_nnc_stream_context_t* const stream_context)
+int _ccv_nnc_conv_forw_4x4_3x3_winograd_cpu_opt(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_t* const w, const ccv_nnc_tensor_t* const bias, const ccv_nnc_hint_t hint, ccv_nnc_tensor_view_t* const b, const uint32_t activation, ccv_nnc_stream_context_t* const stream_context)
 {
 #if defined(HAVE_SSE2)
 	if (w->info.dim[0] % 4 == 0)
-		return _ccv_nnc_conv_forw_4x4_3x3_winograd_sse2(a, w, bias, hint, b, stream_context);
+		return _ccv_nnc_conv_forw_4x4_3x3_winograd_sse2(a, w, bias, hint, b, activation, stream_context);
 #elif defined(HAVE_NEON)
 	if (w->info.dim[0] % 4 == 0)
-		return _ccv_nnc_conv_forw_4x4_3x3_winograd_neon(a, w, bias, hint, b, stream_context);
+		return _ccv_nnc_conv_forw_4x4_3x3_winograd_neon(a, w, bias, hint, b, activation, stream_context);
 #endif
-	return _ccv_nnc_conv_forw_4x4_3x3_winograd_ref(a, w, bias, hint, b, stream_context);
+	return _ccv_nnc_conv_forw_4x4_3x3_winograd_ref(a, w, bias, hint, b, activation, stream_context);
 }
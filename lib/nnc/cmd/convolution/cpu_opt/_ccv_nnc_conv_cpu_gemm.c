@@ -3,9 +3,80 @@
 #include "nnc/ccv_nnc.h"
 #include "nnc/ccv_nnc_easy.h"
 #include "nnc/ccv_nnc_internal.h"
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+#ifdef USE_DISPATCH
+#include <dispatch/dispatch.h>
+#endif
+#ifdef CCV_NNC_CPU_DISPATCH
+#include <immintrin.h>
+#endif
 #include "../_ccv_nnc_conv_cpu_opt.h"
+#include "../../_ccv_nnc_cpu_opt.h"
 
-int _ccv_nnc_conv_forw_gemm_cpu_opt(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_t* const w, const ccv_nnc_tensor_t* const bias, const ccv_nnc_hint_t hint, ccv_nnc_tensor_view_t* const b)
+#if !(defined HAVE_CBLAS || defined HAVE_ACCELERATE_FRAMEWORK) && defined(CCV_NNC_CPU_DISPATCH)
+__attribute__((target("avx2,fma"))) static inline float _ccv_nnc_hadd_avx2(const __m256 v8)
+{
+	__m128 v4 = _mm_add_ps(_mm256_castps256_ps128(v8), _mm256_extractf128_ps(v8, 1));
+	v4 = _mm_add_ps(v4, _mm_movehl_ps(v4, v4));
+	v4 = _mm_add_ss(v4, _mm_movehdup_ps(v4));
+	return _mm_cvtss_f32(v4);
+}
+
+// One row of b = a * w^T (+ bias), 4 output channels at a time such that the loads of a are shared.
+__attribute__((target("avx2,fma"))) static void _ccv_nnc_conv_gemm_row_avx2(const float* const ap, const float* const w, const float* const bias, float* const bp, const int ch, const int count)
+{
+	int k, c;
+	for (k = 0; k < count - 3; k += 4)
+	{
+		const float* const w0 = w + k * ch;
+		const float* const w1 = w0 + ch;
+		const float* const w2 = w1 + ch;
+		const float* const w3 = w2 + ch;
+		__m256 v80 = _mm256_setzero_ps();
+		__m256 v81 = _mm256_setzero_ps();
+		__m256 v82 = _mm256_setzero_ps();
+		__m256 v83 = _mm256_setzero_ps();
+		for (c = 0; c < ch - 7; c += 8)
+		{
+			const __m256 a8 = _mm256_loadu_ps(ap + c);
+			v80 = _mm256_fmadd_ps(a8, _mm256_loadu_ps(w0 + c), v80);
+			v81 = _mm256_fmadd_ps(a8, _mm256_loadu_ps(w1 + c), v81);
+			v82 = _mm256_fmadd_ps(a8, _mm256_loadu_ps(w2 + c), v82);
+			v83 = _mm256_fmadd_ps(a8, _mm256_loadu_ps(w3 + c), v83);
+		}
+		float v0 = _ccv_nnc_hadd_avx2(v80);
+		float v1 = _ccv_nnc_hadd_avx2(v81);
+		float v2 = _ccv_nnc_hadd_avx2(v82);
+		float v3 = _ccv_nnc_hadd_avx2(v83);
+		for (; c < ch; c++)
+		{
+			v0 += ap[c] * w0[c];
+			v1 += ap[c] * w1[c];
+			v2 += ap[c] * w2[c];
+			v3 += ap[c] * w3[c];
+		}
+		bp[k] = bias ? v0 + bias[k] : v0;
+		bp[k + 1] = bias ? v1 + bias[k + 1] : v1;
+		bp[k + 2] = bias ? v2 + bias[k + 2] : v2;
+		bp[k + 3] = bias ? v3 + bias[k + 3] : v3;
+	}
+	for (; k < count; k++)
+	{
+		const float* const w0 = w + k * ch;
+		__m256 v80 = _mm256_setzero_ps();
+		for (c = 0; c < ch - 7; c += 8)
+			v80 = _mm256_fmadd_ps(_mm256_loadu_ps(ap + c), _mm256_loadu_ps(w0 + c), v80);
+		float v0 = _ccv_nnc_hadd_avx2(v80);
+		for (; c < ch; c++)
+			v0 += ap[c] * w0[c];
+		bp[k] = bias ? v0 + bias[k] : v0;
+	}
+}
+#endif
+
+int _ccv_nnc_conv_forw_gemm_cpu_opt(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_t* const w, const ccv_nnc_tensor_t* const bias, const ccv_nnc_hint_t hint, ccv_nnc_tensor_view_t* const b, const uint32_t activation)
 {
 	assert(!CCV_IS_TENSOR_VIEW(a));
 	assert(!CCV_IS_TENSOR_VIEW(w));
@@ -22,6 +93,22 @@ int _ccv_nnc_conv_forw_gemm_cpu_opt(const ccv_nnc_tensor_view_t* const a, const
 	assert(adim[0] == bdim[0]);
 	assert(adim[1] == bdim[1]);
 	assert(hint.stride.dim[0] <= 1 && hint.stride.dim[1] <= 1);
+#if !(defined HAVE_CBLAS || defined HAVE_ACCELERATE_FRAMEWORK)
+	// Without a BLAS library, ccv_gemm is not available.
+#ifdef CCV_NNC_CPU_DISPATCH
+	if (ccv_nnc_cpu_features() & CCV_NNC_CPU_FEATURE_AVX2)
+	{
+		const float* const biasp = bias ? bias->data.f32 : 0;
+		parallel_for(i, adim[0] * adim[1]) {
+			_ccv_nnc_conv_gemm_row_avx2(a->data.f32 + i * adim[2], w->data.f32, biasp, b->data.f32 + i * bdim[2], adim[2], bdim[2]);
+			// The row is still in L1, apply the activation before moving on.
+			_ccv_nnc_cpu_opt_act_block(b->data.f32 + i * bdim[2], 0, bdim[2], activation);
+		} parallel_endfor
+		return CCV_NNC_EXEC_SUCCESS;
+	}
+#endif
+	return _ccv_nnc_conv_forw_cpu_opt(a, w, bias, hint, b, activation);
+#endif
 	ccv_dense_matrix_t am = ccv_dense_matrix(adim[0] * adim[1], adim[2], CCV_32F | CCV_C1, a->data.u8, 0);
 	ccv_dense_matrix_t bm = ccv_dense_matrix(bdim[0] * bdim[1], bdim[2], CCV_32F | CCV_C1, b->data.u8, 0);
 	// copy bias into each row.
@@ -35,5 +122,12 @@ int _ccv_nnc_conv_forw_gemm_cpu_opt(const ccv_nnc_tensor_view_t* const a, const
 		ccv_gemm(&am, &wm, 1, dbm, 1, CCV_B_TRANSPOSE, (ccv_matrix_t**)&dbm, 0); // supply b as matrix C is allowed
 	else
 		ccv_gemm(&am, &wm, 1, 0, 0, CCV_B_TRANSPOSE, (ccv_matrix_t**)&dbm, 0); // supply b as matrix C is allowed
+	if (activation)
+	{
+		// The system GEMM doesn't have an epilogue, apply the activation row by row afterwards.
+		parallel_for(i, bm.rows) {
+			_ccv_nnc_cpu_opt_act_block(bm.data.f32 + i * bdim[2], 0, bdim[2], activation);
+		} parallel_endfor
+	}
 	return CCV_NNC_EXEC_SUCCESS;
 }
@@ -8,6 +8,9 @@
 #elif defined(HAVE_NEON)
 #include <arm_neon.h>
 #endif
+#ifdef CCV_NNC_CPU_DISPATCH
+#include <immintrin.h>
+#endif
 #ifdef USE_OPENMP
 #include <omp.h>
 #endif
@@ -15,6 +18,7 @@
 #include <dispatch/dispatch.h>
 #endif
 #include "../_ccv_nnc_conv_cpu_opt.h"
+#include "../../_ccv_nnc_cpu_opt.h"
 
 #ifdef HAVE_SSE2
 inline static void _ccv_nnc_x4w_sse2(const float* const w, const int* const dim, float* x4w)
@@ -47,7 +51,12 @@ inline static void _ccv_nnc_x4w_sse2(const float* const w, const int* const dim,
 	} parallel_endfor
 }
 
-static int _ccv_nnc_conv_forw_sse2(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_t* const w, const ccv_nnc_tensor_t* const bias, const ccv_nnc_hint_t hint, ccv_nnc_tensor_view_t* const b)
+static void _ccv_nnc_x4w_sse2_pack(const ccv_nnc_tensor_t* const w, void* const x4w, void* const context)
+{
+	_ccv_nnc_x4w_sse2(w->data.f32, w->info.dim, (float*)x4w);
+}
+
+static int _ccv_nnc_conv_forw_sse2(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_t* const w, const ccv_nnc_tensor_t* const bias, const ccv_nnc_hint_t hint, ccv_nnc_tensor_view_t* const b, const uint32_t activation)
 {
 	const int a_nd = ccv_nnc_tensor_nd(a->info.dim);
 	assert(a_nd == CCV_NNC_MAX_DIM + 1 || a_nd == CCV_NNC_MAX_DIM + 2);
@@ -58,11 +67,17 @@ static int _ccv_nnc_conv_forw_sse2(const ccv_nnc_tensor_view_t* const a, const c
 	const int* ainc = CCV_IS_TENSOR_VIEW(a) ? ((a_nd == CCV_NNC_MAX_DIM + 1) ? a->inc : a->inc + 1) : adim;
 	const int* binc = CCV_IS_TENSOR_VIEW(b) ? ((b_nd == CCV_NNC_MAX_DIM + 1) ? b->inc : b->inc + 1) : bdim;
 	assert(w->info.dim[0] % 4 == 0);
-	float* x4w = 0;
-	ccmemalign((void **)&x4w, 16, sizeof(float) * w->info.dim[3] * w->info.dim[2] * w->info.dim[1] * w->info.dim[0]);
+	const size_t x4w_size = sizeof(float) * w->info.dim[3] * w->info.dim[2] * w->info.dim[1] * w->info.dim[0];
+	// Reuse the packed weights if the weights haven't changed since.
+	float* const packed_x4w = (float*)ccv_nnc_tensor_packed_retain(w, CCV_NNC_TENSOR_PACKED_CONV_X4W, x4w_size, _ccv_nnc_x4w_sse2_pack, 0);
+	float* x4w = packed_x4w;
 	if (!x4w)
-		return CCV_NNC_EXEC_OOM;
-	_ccv_nnc_x4w_sse2(w->data.f32, w->info.dim, x4w);
+	{
+		ccmemalign((void **)&x4w, 16, x4w_size);
+		if (!x4w)
+			return CCV_NNC_EXEC_OOM;
+		_ccv_nnc_x4w_sse2(w->data.f32, w->info.dim, x4w);
+	}
 	int jump_dim = w->info.dim[0] / 4;
 	// Do naive tail partition unroll
 #define main_for(tail_block) \
@@ -125,7 +140,7 @@ static int _ccv_nnc_conv_forw_sse2(const ccv_nnc_tensor_view_t* const a, const c
 					apz += ainc[1] * ainc[2]; \
 				} \
 				__m128 v4 = _mm_add_ps(_mm_add_ps(v40, v41), _mm_add_ps(v42, v43)); \
-				_mm_stream_ps(bp + i[1] * binc[2], v4); \
+				_mm_stream_ps(bp + i[1] * binc[2], _ccv_nnc_act_ps_sse2(v4, activation)); \
 			} \
 			bp += binc[1] * binc[2]; \
 			ap += ainc[1] * ainc[2] * (ccv_max((i[0] + 1) * hint.stride.dim[0] - hint.border.begin[0], 0) - ccv_max(i[0] * hint.stride.dim[0] - hint.border.begin[0], 0)); \
@@ -169,7 +184,117 @@ static int _ccv_nnc_conv_forw_sse2(const ccv_nnc_tensor_view_t* const a, const c
 #undef tail_block
 	}
 #undef main_for
-	ccfree(x4w);
+	if (packed_x4w)
+		ccv_nnc_tensor_packed_release(packed_x4w);
+	else
+		ccfree(x4w);
+	return CCV_NNC_EXEC_SUCCESS;
+}
+#endif
+
+#ifdef CCV_NNC_CPU_DISPATCH
+inline static void _ccv_nnc_x8w_avx2(const float* const w, const int* const dim, float* x8w)
+{
+	int jump_dim = dim[0] / 8;
+	parallel_for(k, jump_dim) {
+		int i, j, l;
+		float* x8wz = x8w + k * dim[3] * dim[2] * dim[1] * 8;
+		const float* wz = w + (k * 8) * dim[3] * dim[2] * dim[1];
+		for (i = 0; i < dim[2] * dim[1]; i++)
+		{
+			for (j = 0; j < dim[3]; j++)
+				for (l = 0; l < 8; l++)
+					x8wz[j * 8 + l] = wz[l * dim[3] * dim[2] * dim[1] + j];
+			x8wz += dim[3] * 8;
+			wz += dim[3];
+		}
+	} parallel_endfor
+}
+
+static void _ccv_nnc_x8w_avx2_pack(const ccv_nnc_tensor_t* const w, void* const x8w, void* const context)
+{
+	_ccv_nnc_x8w_avx2(w->data.f32, w->info.dim, (float*)x8w);
+}
+
+// Compute 8 output channels for the whole output, the weights are interleaved by 8 such that one load covers all of them.
+__attribute__((target("avx2,fma"))) static void _ccv_nnc_conv_forw_x8_avx2(const float* ap, const int* const adim, const int* const ainc, const float* const x8wp, const int* const wdim, const float* const biasp, const ccv_nnc_hint_t hint, float* bp, const int* const bdim, const int* const binc, const uint32_t activation)
+{
+	const __m256 bias8 = biasp ? _mm256_loadu_ps(biasp) : _mm256_setzero_ps();
+	int c;
+	int i[CCV_NNC_MAX_DIM];
+	int n[CCV_NNC_MAX_DIM];
+	int m[CCV_NNC_MAX_DIM];
+	int j[CCV_NNC_MAX_DIM];
+	for (i[0] = 0; i[0] < bdim[0]; i[0]++)
+	{
+		SET_BORDER_OFFSET_SIZE_FOR(0, i, hint, wdim + 1, adim, n, m);
+		const float* wpu = x8wp + n[0] * wdim[2] * wdim[3] * 8;
+		for (i[1] = 0; i[1] < bdim[1]; i[1]++)
+		{
+			SET_BORDER_OFFSET_SIZE_FOR(1, i, hint, wdim + 1, adim, n, m);
+			__m256 v80 = bias8;
+			__m256 v81 = _mm256_setzero_ps();
+			__m256 v82 = _mm256_setzero_ps();
+			__m256 v83 = _mm256_setzero_ps();
+			const float* wpz = wpu + n[1] * wdim[3] * 8;
+			const float* apz = ap + ccv_max(i[1] * hint.stride.dim[1] - hint.border.begin[1], 0) * ainc[2];
+			for (j[0] = 0; j[0] < m[0]; j[0]++)
+			{
+				for (j[1] = 0; j[1] < m[1]; j[1]++)
+				{
+					const float* const apzu = apz + j[1] * ainc[2];
+					const float* const wpzu = wpz + j[1] * wdim[3] * 8;
+					for (c = 0; c < adim[2] - 3; c += 4)
+					{
+						v80 = _mm256_fmadd_ps(_mm256_loadu_ps(wpzu + c * 8), _mm256_broadcast_ss(apzu + c), v80);
+						v81 = _mm256_fmadd_ps(_mm256_loadu_ps(wpzu + c * 8 + 8), _mm256_broadcast_ss(apzu + c + 1), v81);
+						v82 = _mm256_fmadd_ps(_mm256_loadu_ps(wpzu + c * 8 + 16), _mm256_broadcast_ss(apzu + c + 2), v82);
+						v83 = _mm256_fmadd_ps(_mm256_loadu_ps(wpzu + c * 8 + 24), _mm256_broadcast_ss(apzu + c + 3), v83);
+					}
+					for (; c < adim[2]; c++)
+						v80 = _mm256_fmadd_ps(_mm256_loadu_ps(wpzu + c * 8), _mm256_broadcast_ss(apzu + c), v80);
+				}
+				wpz += wdim[2] * wdim[3] * 8;
+				apz += ainc[1] * ainc[2];
+			}
+			_mm256_storeu_ps(bp + i[1] * binc[2], _ccv_nnc_act_ps_avx2(_mm256_add_ps(_mm256_add_ps(v80, v81), _mm256_add_ps(v82, v83)), activation));
+		}
+		bp += binc[1] * binc[2];
+		ap += ainc[1] * ainc[2] * (ccv_max((i[0] + 1) * hint.stride.dim[0] - hint.border.begin[0], 0) - ccv_max(i[0] * hint.stride.dim[0] - hint.border.begin[0], 0));
+	}
+}
+
+static int _ccv_nnc_conv_forw_avx2(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_t* const w, const ccv_nnc_tensor_t* const bias, const ccv_nnc_hint_t hint, ccv_nnc_tensor_view_t* const b, const uint32_t activation)
+{
+	const int a_nd = ccv_nnc_tensor_nd(a->info.dim);
+	assert(a_nd == CCV_NNC_MAX_DIM + 1 || a_nd == CCV_NNC_MAX_DIM + 2);
+	const int* adim = (a_nd == CCV_NNC_MAX_DIM + 1) ? a->info.dim : a->info.dim + 1;
+	const int b_nd = ccv_nnc_tensor_nd(b->info.dim);
+	assert(b_nd == CCV_NNC_MAX_DIM + 1 || b_nd == CCV_NNC_MAX_DIM + 2);
+	const int* bdim = (b_nd == CCV_NNC_MAX_DIM + 1) ? b->info.dim : b->info.dim + 1;
+	const int* ainc = CCV_IS_TENSOR_VIEW(a) ? ((a_nd == CCV_NNC_MAX_DIM + 1) ? a->inc : a->inc + 1) : adim;
+	const int* binc = CCV_IS_TENSOR_VIEW(b) ? ((b_nd == CCV_NNC_MAX_DIM + 1) ? b->inc : b->inc + 1) : bdim;
+	assert(w->info.dim[0] % 8 == 0);
+	const size_t x8w_size = sizeof(float) * w->info.dim[3] * w->info.dim[2] * w->info.dim[1] * w->info.dim[0];
+	// Reuse the packed weights if the weights haven't changed since.
+	float* const packed_x8w = (float*)ccv_nnc_tensor_packed_retain(w, CCV_NNC_TENSOR_PACKED_CONV_X8W, x8w_size, _ccv_nnc_x8w_avx2_pack, 0);
+	float* x8w = packed_x8w;
+	if (!x8w)
+	{
+		ccmemalign((void **)&x8w, 32, x8w_size);
+		if (!x8w)
+			return CCV_NNC_EXEC_OOM;
+		_ccv_nnc_x8w_avx2(w->data.f32, w->info.dim, x8w);
+	}
+	int jump_dim = w->info.dim[0] / 8;
+	parallel_for(k, jump_dim) {
+		const float* const x8wp = x8w + k * 8 * w->info.dim[1] * w->info.dim[2] * w->info.dim[3];
+		_ccv_nnc_conv_forw_x8_avx2(a->data.f32, adim, ainc, x8wp, w->info.dim, bias ? bias->data.f32 + k * 8 : 0, hint, b->data.f32 + k * 8, bdim, binc, activation);
+	} parallel_endfor
+	if (packed_x8w)
+		ccv_nnc_tensor_packed_release(packed_x8w);
+	else
+		ccfree(x8w);
 	return CCV_NNC_EXEC_SUCCESS;
 }
 #endif
@@ -205,7 +330,12 @@ inline static void _ccv_nnc_x4w_neon(const float* const w, const int* const dim,
 	} parallel_endfor
 }
 
-static int _ccv_nnc_conv_forw_neon(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_t* const w, const ccv_nnc_tensor_t* const bias, const ccv_nnc_hint_t hint, ccv_nnc_tensor_view_t* const b)
+static void _ccv_nnc_x4w_neon_pack(const ccv_nnc_tensor_t* const w, void* const x4w, void* const context)
+{
+	_ccv_nnc_x4w_neon(w->data.f32, w->info.dim, (float*)x4w);
+}
+
+static int _ccv_nnc_conv_forw_neon(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_t* const w, const ccv_nnc_tensor_t* const bias, const ccv_nnc_hint_t hint, ccv_nnc_tensor_view_t* const b, const uint32_t activation)
 {
 	const int a_nd = ccv_nnc_tensor_nd(a->info.dim);
 	assert(a_nd == CCV_NNC_MAX_DIM + 1 || a_nd == CCV_NNC_MAX_DIM + 2);
@@ -216,11 +346,17 @@ static int _ccv_nnc_conv_forw_neon(const ccv_nnc_tensor_view_t* const a, const c
 	const int* ainc = CCV_IS_TENSOR_VIEW(a) ? ((a_nd == CCV_NNC_MAX_DIM + 1) ? a->inc : a->inc + 1) : adim;
 	const int* binc = CCV_IS_TENSOR_VIEW(b) ? ((b_nd == CCV_NNC_MAX_DIM + 1) ? b->inc : b->inc + 1) : bdim;
 	assert(w->info.dim[0] % 4 == 0);
-	float* x4w = 0;
-	ccmemalign((void **)&x4w, 16, sizeof(float) * w->info.dim[3] * w->info.dim[2] * w->info.dim[1] * w->info.dim[0]);
+	const size_t x4w_size = sizeof(float) * w->info.dim[3] * w->info.dim[2] * w->info.dim[1] * w->info.dim[0];
+	// Reuse the packed weights if the weights haven't changed since.
+	float* const packed_x4w = (float*)ccv_nnc_tensor_packed_retain(w, CCV_NNC_TENSOR_PACKED_CONV_X4W, x4w_size, _ccv_nnc_x4w_neon_pack, 0);
+	float* x4w = packed_x4w;
 	if (!x4w)
-		return CCV_NNC_EXEC_OOM;
-	_ccv_nnc_x4w_neon(w->data.f32, w->info.dim, x4w);
+	{
+		ccmemalign((void **)&x4w, 16, x4w_size);
+		if (!x4w)
+			return CCV_NNC_EXEC_OOM;
+		_ccv_nnc_x4w_neon(w->data.f32, w->info.dim, x4w);
+	}
 	int jump_dim = w->info.dim[0] / 4;
 #define main_for(tail_block) \
 	parallel_for(k, jump_dim) { \
@@ -283,7 +419,7 @@ static int _ccv_nnc_conv_forw_neon(const ccv_nnc_tensor_view_t* const a, const c
 				} \
 				v40 = vaddq_f32(v40, v41); \
 				v42 = vaddq_f32(v42, v43); \
-				vst1q_f32(bp + i[1] * binc[2], vaddq_f32(v40, v42)); \
+				vst1q_f32(bp + i[1] * binc[2], _ccv_nnc_act_ps_neon(vaddq_f32(v40, v42), activation)); \
 			} \
 			bp += binc[1] * binc[2]; \
 			ap += ainc[1] * ainc[2] * (ccv_max((i[0] + 1) * hint.stride.dim[0] - hint.border.begin[0], 0) - ccv_max(i[0] * hint.stride.dim[0] - hint.border.begin[0], 0)); \
@@ -329,19 +465,106 @@ static int _ccv_nnc_conv_forw_neon(const ccv_nnc_tensor_view_t* const a, const c
 #undef tail_block
 	}
 #undef main_for
-	ccfree(x4w);
+	if (packed_x4w)
+		ccv_nnc_tensor_packed_release(packed_x4w);
+	else
+		ccfree(x4w);
 	return CCV_NNC_EXEC_SUCCESS;
 }
 #endif
 
-int _ccv_nnc_conv_forw_cpu_opt(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_t* const w, const ccv_nnc_tensor_t* const bias, const ccv_nnc_hint_t hint, ccv_nnc_tensor_view_t* const b)
+// Weights (and optionally activations / bias / output) stored in FP16 / BF16, accumulate in FP32. Each output pixel
+// is a sum of dot products along the contiguous kernel rows, the dot product picks F16C / AVX512-BF16 if available.
+static int _ccv_nnc_conv_forw_half(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_t* const w, const ccv_nnc_tensor_t* const bias, const ccv_nnc_hint_t hint, ccv_nnc_tensor_view_t* const b, const uint32_t activation)
+{
+	const int a_datatype = a->info.datatype;
+	const int w_datatype = w->info.datatype;
+	const int b_datatype = b->info.datatype;
+	if ((w_datatype != CCV_16F && w_datatype != CCV_16BF) ||
+		(a_datatype != CCV_32F && a_datatype != w_datatype) ||
+		(b_datatype != CCV_32F && b_datatype != w_datatype) ||
+		(bias && bias->info.datatype != CCV_32F && bias->info.datatype != w_datatype))
+		return CCV_NNC_EXEC_INVALID;
+	const int a_nd = ccv_nnc_tensor_nd(a->info.dim);
+	assert(a_nd == CCV_NNC_MAX_DIM + 1 || a_nd == CCV_NNC_MAX_DIM + 2);
+	const int* adim = (a_nd == CCV_NNC_MAX_DIM + 1) ? a->info.dim : a->info.dim + 1;
+	const int b_nd = ccv_nnc_tensor_nd(b->info.dim);
+	assert(b_nd == CCV_NNC_MAX_DIM + 1 || b_nd == CCV_NNC_MAX_DIM + 2);
+	const int* bdim = (b_nd == CCV_NNC_MAX_DIM + 1) ? b->info.dim : b->info.dim + 1;
+	const int* ainc = CCV_IS_TENSOR_VIEW(a) ? ((a_nd == CCV_NNC_MAX_DIM + 1) ? a->inc : a->inc + 1) : adim;
+	const int* binc = CCV_IS_TENSOR_VIEW(b) ? ((b_nd == CCV_NNC_MAX_DIM + 1) ? b->inc : b->inc + 1) : bdim;
+	const int batch_size = (a_nd == CCV_NNC_MAX_DIM + 2) ? ccv_max(1, a->info.dim[0]) : 1;
+	assert(batch_size == ((b_nd == CCV_NNC_MAX_DIM + 2) ? ccv_max(1, b->info.dim[0]) : 1));
+	const size_t a_size = CCV_GET_DATA_TYPE_SIZE(a_datatype);
+	const size_t w_size = CCV_GET_DATA_TYPE_SIZE(w_datatype);
+	const size_t b_size = CCV_GET_DATA_TYPE_SIZE(b_datatype);
+	const int* const wdim = w->info.dim;
+	const int count = wdim[0];
+	const int channels = adim[CCV_NNC_MAX_DIM];
+	// If the channels are contiguous in a, one kernel row (m[1] * channels) is contiguous in both a and w.
+	const int contiguous = (ainc[CCV_NNC_MAX_DIM] == channels);
+	float* biasf = 0;
+	if (bias)
+	{
+		biasf = (float*)ccmalloc(sizeof(float) * count);
+		if (!biasf)
+			return CCV_NNC_EXEC_OOM;
+		_ccv_nnc_cpu_opt_to_f32(bias->data.u8, bias->info.datatype, biasf, count);
+	}
+	const int cpu_features = ccv_nnc_cpu_features();
+	parallel_for(idx, batch_size * bdim[0]) {
+		int i[CCV_NNC_MAX_DIM];
+		int n[CCV_NNC_MAX_DIM];
+		int m[CCV_NNC_MAX_DIM];
+		int j0, j1, k;
+		const int bi = idx / bdim[0];
+		i[0] = idx % bdim[0];
+		SET_BORDER_OFFSET_SIZE_FOR(0, i, hint, wdim + 1, adim, n, m);
+		const unsigned char* const ap = a->data.u8 + ((size_t)bi * ainc[0] * ainc[1] * ainc[2] + (size_t)ccv_max(i[0] * hint.stride.dim[0] - hint.border.begin[0], 0) * ainc[1] * ainc[2]) * a_size;
+		unsigned char* const bp = b->data.u8 + ((size_t)bi * binc[0] * binc[1] * binc[2] + (size_t)i[0] * binc[1] * binc[2]) * b_size;
+		for (i[1] = 0; i[1] < bdim[1]; i[1]++)
+		{
+			SET_BORDER_OFFSET_SIZE_FOR(1, i, hint, wdim + 1, adim, n, m);
+			const unsigned char* const apz = ap + (size_t)ccv_max(i[1] * hint.stride.dim[1] - hint.border.begin[1], 0) * ainc[2] * a_size;
+			for (k = 0; k < count; k++)
+			{
+				float v = biasf ? biasf[k] : 0;
+				const unsigned char* wpz = w->data.u8 + ((size_t)(k * wdim[1] + n[0]) * wdim[2] + n[1]) * channels * w_size;
+				const unsigned char* apzu = apz;
+				for (j0 = 0; j0 < m[0]; j0++)
+				{
+					if (contiguous)
+						v += _ccv_nnc_cpu_opt_dot(cpu_features, apzu, a_datatype, wpz, w_datatype, m[1] * channels);
+					else
+						for (j1 = 0; j1 < m[1]; j1++)
+							v += _ccv_nnc_cpu_opt_dot(cpu_features, apzu + (size_t)j1 * ainc[2] * a_size, a_datatype, wpz + (size_t)j1 * channels * w_size, w_datatype, channels);
+					wpz += (size_t)wdim[2] * channels * w_size;
+					apzu += (size_t)ainc[1] * ainc[2] * a_size;
+				}
+				v = _ccv_nnc_cpu_opt_act(v, activation);
+				_ccv_nnc_cpu_opt_from_f32(&v, bp + ((size_t)i[1] * binc[2] + k) * b_size, b_datatype, 1);
+			}
+		}
+	} parallel_endfor
+	if (biasf)
+		ccfree(biasf);
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+int _ccv_nnc_conv_forw_cpu_opt(const ccv_nnc_tensor_view_t* const a, const ccv_nnc_tensor_t* const w, const ccv_nnc_tensor_t* const bias, const ccv_nnc_hint_t hint, ccv_nnc_tensor_view_t* const b, const uint32_t activation)
 {
+	if (a->info.datatype != CCV_32F || w->info.datatype != CCV_32F || b->info.datatype != CCV_32F || (bias && bias->info.datatype != CCV_32F))
+		return _ccv_nnc_conv_forw_half(a, w, bias, hint, b, activation);
 #if defined(HAVE_SSE2)
+#ifdef CCV_NNC_CPU_DISPATCH
+	if (w->info.dim[0] % 8 == 0 && (ccv_nnc_cpu_features() & CCV_NNC_CPU_FEATURE_AVX2))
+		return _ccv_nnc_conv_forw_avx2(a, w, bias, hint, b, activation);
+#endif
 	if (w->info.dim[0] % 4 == 0)
-		return _ccv_nnc_conv_forw_sse2(a, w, bias, hint, b);
+		return _ccv_nnc_conv_forw_sse2(a, w, bias, hint, b, activation);
 #elif defined(HAVE_NEON)
 	if (w->info.dim[0] % 4 == 0)
-		return _ccv_nnc_conv_forw_neon(a, w, bias, hint, b);
+		return _ccv_nnc_conv_forw_neon(a, w, bias, hint, b, activation);
 #endif
 	return CCV_NNC_EXEC_INVALID;
 }
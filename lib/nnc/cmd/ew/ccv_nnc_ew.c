@@ -68,7 +68,7 @@ static int _ccv_nnc_ewsum_back_bitmask(const int input_size, const int output_si
 }
 
 REGISTER_COMMAND(CCV_NNC_EWSUM_FORWARD)(ccv_nnc_cmd_registry_t* const registry)
-	FIND_BACKEND(ccv_nnc_ew_cpu_ref.c, gpu/ccv_nnc_ew_gpu_cudnn.cu)
+	FIND_BACKEND(ccv_nnc_ew_cpu_ref.c, ccv_nnc_ew_cpu_opt.c, gpu/ccv_nnc_ew_gpu_cudnn.cu)
 {
 	registry->bitmask = _ccv_nnc_ewsum_forw_bitmask;
 	registry->tensor_auto = ccv_nnc_hint_tensor_auto_forward_from_inputs;
@@ -165,7 +165,7 @@ static int _ccv_nnc_ewprod_back_bitmask(const int input_size, const int output_s
 }
 
 REGISTER_COMMAND(CCV_NNC_EWPROD_FORWARD)(ccv_nnc_cmd_registry_t* const registry)
-	FIND_BACKEND(ccv_nnc_ew_cpu_ref.c)
+	FIND_BACKEND(ccv_nnc_ew_cpu_ref.c, ccv_nnc_ew_cpu_opt.c)
 {
 	registry->bitmask = _ccv_nnc_ewprod_forw_bitmask;
 	registry->tensor_auto = ccv_nnc_hint_tensor_auto_forward_from_inputs;
@@ -245,7 +245,7 @@ static int _ccv_nnc_ewexp_back_bitmask(const int input_size, const int output_si
 }
 
 REGISTER_COMMAND(CCV_NNC_EWEXP_FORWARD)(ccv_nnc_cmd_registry_t* const registry)
-	FIND_BACKEND(ccv_nnc_ew_cpu_ref.c)
+	FIND_BACKEND(ccv_nnc_ew_cpu_ref.c, ccv_nnc_ew_cpu_opt.c)
 {
 	registry->bitmask = _ccv_nnc_ewexp_forw_bitmask;
 	registry->tensor_auto = ccv_nnc_hint_tensor_auto_forward_from_inputs;
@@ -0,0 +1,176 @@
+#include "ccv.h"
+#include "ccv_internal.h"
+#include "nnc/ccv_nnc.h"
+#include "nnc/ccv_nnc_easy.h"
+#include "nnc/ccv_nnc_internal.h"
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+#ifdef USE_DISPATCH
+#include <dispatch/dispatch.h>
+#endif
+
+// Shared methods.
+#include "../_ccv_nnc_cpu_ref.h"
+#include "../_ccv_nnc_cpu_opt.h"
+
+static int _ccv_nnc_ew_is_contiguous(ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const b)
+{
+	int i;
+	if (CCV_IS_TENSOR_VIEW(b))
+		return 0;
+	for (i = 0; i < input_size; i++)
+		if (!inputs[i] || CCV_IS_TENSOR_VIEW(inputs[i]) || ccv_nnc_tensor_count(inputs[i]->info) != ccv_nnc_tensor_count(b->info))
+			return 0;
+	return 1;
+}
+
+static void _ccv_nnc_ewsum_block(ccv_nnc_tensor_t* const* const inputs, const int input_size, float* const cp, const int start, const int end)
+{
+	int x = start, z;
+#if defined(HAVE_SSE2)
+	for (; x < end - 3; x += 4)
+	{
+		__m128 v = _mm_loadu_ps(inputs[0]->data.f32 + x);
+		for (z = 1; z < input_size; z++)
+			v = _mm_add_ps(v, _mm_loadu_ps(inputs[z]->data.f32 + x));
+		_mm_storeu_ps(cp + x, v);
+	}
+#elif defined(HAVE_NEON)
+	for (; x < end - 3; x += 4)
+	{
+		float32x4_t v = vld1q_f32(inputs[0]->data.f32 + x);
+		for (z = 1; z < input_size; z++)
+			v = vaddq_f32(v, vld1q_f32(inputs[z]->data.f32 + x));
+		vst1q_f32(cp + x, v);
+	}
+#endif
+	for (; x < end; x++)
+	{
+		float v = inputs[0]->data.f32[x];
+		for (z = 1; z < input_size; z++)
+			v += inputs[z]->data.f32[x];
+		cp[x] = v;
+	}
+}
+
+static int _ccv_nnc_ewsum_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(output_size == 1);
+	ccv_nnc_tensor_t* const c = outputs[0];
+	if (!_ccv_nnc_ew_is_contiguous(inputs, input_size, c))
+	{
+		_ccv_nnc_ewsum_forw_cpu_ref((ccv_nnc_tensor_view_t**)inputs, input_size, (ccv_nnc_tensor_view_t**)outputs, output_size);
+		return CCV_NNC_EXEC_SUCCESS;
+	}
+	// Every element of the inputs is read before the same element of the output is written, thus, in-place is fine.
+	const int count = ccv_nnc_tensor_count(c->info);
+	const int block_count = (count + CCV_NNC_CPU_OPT_EW_BLOCK - 1) / CCV_NNC_CPU_OPT_EW_BLOCK;
+	parallel_for(i, block_count) {
+		_ccv_nnc_ewsum_block(inputs, input_size, c->data.f32, i * CCV_NNC_CPU_OPT_EW_BLOCK, ccv_min((i + 1) * CCV_NNC_CPU_OPT_EW_BLOCK, count));
+	} parallel_endfor
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+static void _ccv_nnc_ewprod_block(ccv_nnc_tensor_t* const* const inputs, const int input_size, float* const cp, const int start, const int end)
+{
+	int x = start, z;
+#if defined(HAVE_SSE2)
+	for (; x < end - 3; x += 4)
+	{
+		__m128 v = _mm_loadu_ps(inputs[0]->data.f32 + x);
+		for (z = 1; z < input_size; z++)
+			v = _mm_mul_ps(v, _mm_loadu_ps(inputs[z]->data.f32 + x));
+		_mm_storeu_ps(cp + x, v);
+	}
+#elif defined(HAVE_NEON)
+	for (; x < end - 3; x += 4)
+	{
+		float32x4_t v = vld1q_f32(inputs[0]->data.f32 + x);
+		for (z = 1; z < input_size; z++)
+			v = vmulq_f32(v, vld1q_f32(inputs[z]->data.f32 + x));
+		vst1q_f32(cp + x, v);
+	}
+#endif
+	for (; x < end; x++)
+	{
+		float v = inputs[0]->data.f32[x];
+		for (z = 1; z < input_size; z++)
+			v *= inputs[z]->data.f32[x];
+		cp[x] = v;
+	}
+}
+
+static int _ccv_nnc_ewprod_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(output_size == 1);
+	ccv_nnc_tensor_t* const c = outputs[0];
+	if (!_ccv_nnc_ew_is_contiguous(inputs, input_size, c))
+	{
+		_ccv_nnc_ewprod_forw_cpu_ref((ccv_nnc_tensor_view_t**)inputs, input_size, (ccv_nnc_tensor_view_t**)outputs, output_size);
+		return CCV_NNC_EXEC_SUCCESS;
+	}
+	const int count = ccv_nnc_tensor_count(c->info);
+	const int block_count = (count + CCV_NNC_CPU_OPT_EW_BLOCK - 1) / CCV_NNC_CPU_OPT_EW_BLOCK;
+	parallel_for(i, block_count) {
+		_ccv_nnc_ewprod_block(inputs, input_size, c->data.f32, i * CCV_NNC_CPU_OPT_EW_BLOCK, ccv_min((i + 1) * CCV_NNC_CPU_OPT_EW_BLOCK, count));
+	} parallel_endfor
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+static void _ccv_nnc_ewexp_block(const float* const ap, float* const bp, const int start, const int end)
+{
+	int x = start;
+#if defined(HAVE_SSE2)
+	for (; x < end - 3; x += 4)
+		_mm_storeu_ps(bp + x, _ccv_nnc_exp_ps_sse2(_mm_loadu_ps(ap + x)));
+#elif defined(HAVE_NEON)
+	for (; x < end - 3; x += 4)
+		vst1q_f32(bp + x, _ccv_nnc_exp_ps_neon(vld1q_f32(ap + x)));
+#endif
+	for (; x < end; x++)
+		bp[x] = expf(ap[x]);
+}
+
+static int _ccv_nnc_ewexp_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size == 1);
+	assert(output_size == 1);
+	ccv_nnc_tensor_t* const a = inputs[0];
+	ccv_nnc_tensor_t* const b = outputs[0];
+	if (!_ccv_nnc_ew_is_contiguous(inputs, 1, b))
+		return CCV_NNC_EXEC_INVALID;
+	const int count = ccv_nnc_tensor_count(b->info);
+	const int block_count = (count + CCV_NNC_CPU_OPT_EW_BLOCK - 1) / CCV_NNC_CPU_OPT_EW_BLOCK;
+	parallel_for(i, block_count) {
+		_ccv_nnc_ewexp_block(a->data.f32, b->data.f32, i * CCV_NNC_CPU_OPT_EW_BLOCK, ccv_min((i + 1) * CCV_NNC_CPU_OPT_EW_BLOCK, count));
+	} parallel_endfor
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_EWSUM_FORWARD, CCV_NNC_BACKEND_CPU_OPT)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW | CCV_TENSOR_FORMAT_CHWN;
+	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_ewsum_forw;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_EWPROD_FORWARD, CCV_NNC_BACKEND_CPU_OPT)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW | CCV_TENSOR_FORMAT_CHWN;
+	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_ewprod_forw;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_EWEXP_FORWARD, CCV_NNC_BACKEND_CPU_OPT)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW | CCV_TENSOR_FORMAT_CHWN;
+	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_ewexp_forw;
+}
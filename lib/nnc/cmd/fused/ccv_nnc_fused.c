@@ -0,0 +1,160 @@
+#include "ccv.h"
+#include "nnc/ccv_nnc.h"
+#include "nnc/ccv_nnc_easy.h"
+#include "nnc/ccv_nnc_internal.h"
+
+static int _ccv_nnc_fused_conv_forw_bitmask(const int input_size, const int output_size, const uint64_t* const input_bitmasks, const int input_bitmask_size, const uint64_t* const output_bitmasks, const int output_bitmask_size)
+{
+	if (input_size == 3 && (input_bitmasks[0] & 7u) == ((1u << 0) | (1u << 1) | (1u << 2)) && output_bitmasks[0] == 1u)
+		return 1;
+	// Ignore bias.
+	if (input_size == 2 && (input_bitmasks[0] & 3u) == ((1u << 0) | (1u << 1)) && output_bitmasks[0] == 1u)
+		return 1;
+	// 7 inputs (x, w, bias, scale, bias, mean, var), the batch norm folded in, the convolution bias can be ignored.
+	if (input_size == 7 && (input_bitmasks[0] & 123u) == ((1u << 0) | (1u << 1) | (1u << 3) | (1u << 4) | (1u << 5) | (1u << 6)) && output_bitmasks[0] == 1u)
+		return 1;
+	return 0;
+}
+
+static int _ccv_nnc_fused_back_bitmask(const int input_size, const int output_size, const uint64_t* const input_bitmasks, const int input_bitmask_size, const uint64_t* const output_bitmasks, const int output_bitmask_size)
+{
+	// Inputs (gradient, x, w, [bias], y), all of them are required because swish needs to recompute its input.
+	if (input_size != 4 && input_size != 5)
+		return 0;
+	const uint64_t input_mask = (1u << input_size) - 1;
+	if ((input_bitmasks[0] & input_mask) != input_mask)
+		return 0;
+	// Outputs ([propagated error], dw, [dbias]), gradient w.r.t. w is always computed.
+	if ((output_bitmasks[0] & 2u) == 2u && (output_bitmasks[0] & ~((1u << output_size) - 1)) == 0)
+		return 1;
+	return 0;
+}
+
+static void _ccv_nnc_fused_conv_tensor_auto_forw(const ccv_nnc_cmd_param_t cmd, const ccv_nnc_tensor_param_t* inputs, const int input_size, const ccv_nnc_hint_t hint, ccv_nnc_tensor_param_t* outputs, const int output_size)
+{
+	assert(output_size == 1);
+	outputs[0].type = inputs[0].type;
+	outputs[0].format = inputs[0].format;
+	outputs[0].datatype = inputs[0].datatype;
+	// Get the channel output from the weight matrix.
+	const int count = ccv_nnc_tensor_get_n(inputs[1]);
+	assert(count == cmd.fused.count);
+	ccv_nnc_tensor_set_c(outputs, ccv_nnc_tensor_nd(inputs[0].dim), count);
+	ccv_nnc_tensor_set_n(outputs, ccv_nnc_tensor_get_n(inputs[0]));
+	ccv_nnc_hint_tensor_forward(cmd, inputs[0], hint, outputs);
+}
+
+REGISTER_COMMAND(CCV_NNC_FUSED_CONVOLUTION_FORWARD)(ccv_nnc_cmd_registry_t* const registry)
+	FIND_BACKEND(ccv_nnc_fused_cpu_ref.c, ccv_nnc_fused_cpu_opt.c)
+{
+	registry->bitmask = _ccv_nnc_fused_conv_forw_bitmask;
+	registry->tensor_auto = _ccv_nnc_fused_conv_tensor_auto_forw;
+}
+
+REGISTER_COMMAND(CCV_NNC_FUSED_CONVOLUTION_BACKWARD)(ccv_nnc_cmd_registry_t* const registry)
+	FIND_BACKEND(ccv_nnc_fused_cpu_ref.c)
+{
+	registry->bitmask = _ccv_nnc_fused_back_bitmask;
+	registry->tensor_auto = ccv_nnc_hint_tensor_auto_backward_from_inputs;
+}
+
+//@REGISTER_EASY_COMMAND_MACRO(CCV_NNC_FUSED_CONVOLUTION_FORWARD)
+#define CMD_FUSED_CONVOLUTION_FORWARD(_activation, _epsilon, _count, ...) ccv_nnc_cmd(CCV_NNC_FUSED_CONVOLUTION_FORWARD, 0, ((ccv_nnc_cmd_param_t){.size={.dim={__VA_ARGS__}},.fused={.count=_count,.activation=_activation,.epsilon=_epsilon}}), 0)
+//@REGISTER_EASY_COMMAND_MACRO(CCV_NNC_FUSED_CONVOLUTION_BACKWARD)
+#define CMD_FUSED_CONVOLUTION_BACKWARD(_activation, _epsilon, _count, ...) ccv_nnc_cmd(CCV_NNC_FUSED_CONVOLUTION_BACKWARD, 0, ((ccv_nnc_cmd_param_t){.size={.dim={__VA_ARGS__}},.fused={.count=_count,.activation=_activation,.epsilon=_epsilon}}), 0)
+
+static int _ccv_nnc_fused_gemm_forw_bitmask(const int input_size, const int output_size, const uint64_t* const input_bitmasks, const int input_bitmask_size, const uint64_t* const output_bitmasks, const int output_bitmask_size)
+{
+	if (input_size == 3 && (input_bitmasks[0] & 7u) == ((1u << 0) | (1u << 1) | (1u << 2)) && output_bitmasks[0] == 1u)
+		return 1;
+	// No bias is OK.
+	if (input_size == 2 && (input_bitmasks[0] & 3u) == ((1u << 0) | (1u << 1)) && output_bitmasks[0] == 1u)
+		return 1;
+	return 0;
+}
+
+static void _ccv_nnc_fused_gemm_tensor_auto_forw(const ccv_nnc_cmd_param_t cmd, const ccv_nnc_tensor_param_t* const inputs, const int input_size, const ccv_nnc_hint_t hint, ccv_nnc_tensor_param_t* const outputs, const int output_size)
+{
+	assert(output_size == 1);
+	// The fused GEMM is always b = a * w^T + bias, with w in the shape of [count, a's column].
+	const int a_nd = ccv_nnc_tensor_nd(inputs[0].dim);
+	outputs[0].type = inputs[0].type;
+	outputs[0].format = inputs[0].format;
+	outputs[0].datatype = inputs[0].datatype;
+	if (a_nd == 1)
+		outputs[0].dim[0] = inputs[1].dim[0];
+	else {
+		assert(a_nd == 2);
+		outputs[0].dim[0] = inputs[0].dim[0];
+		outputs[0].dim[1] = inputs[1].dim[0];
+	}
+}
+
+REGISTER_COMMAND(CCV_NNC_FUSED_GEMM_FORWARD)(ccv_nnc_cmd_registry_t* const registry)
+	FIND_BACKEND(ccv_nnc_fused_cpu_ref.c, ccv_nnc_fused_cpu_opt.c)
+{
+	registry->bitmask = _ccv_nnc_fused_gemm_forw_bitmask;
+	registry->tensor_auto = _ccv_nnc_fused_gemm_tensor_auto_forw;
+}
+
+REGISTER_COMMAND(CCV_NNC_FUSED_GEMM_BACKWARD)(ccv_nnc_cmd_registry_t* const registry)
+	FIND_BACKEND(ccv_nnc_fused_cpu_ref.c)
+{
+	registry->bitmask = _ccv_nnc_fused_back_bitmask;
+	registry->tensor_auto = ccv_nnc_hint_tensor_auto_backward_from_inputs;
+}
+
+//@REGISTER_EASY_COMMAND_MACRO(CCV_NNC_FUSED_GEMM_FORWARD)
+#define CMD_FUSED_GEMM_FORWARD(_activation) ccv_nnc_cmd(CCV_NNC_FUSED_GEMM_FORWARD, 0, ((ccv_nnc_cmd_param_t){.size={.dim={1,1,1}},.fused={.activation=_activation}}), 0)
+//@REGISTER_EASY_COMMAND_MACRO(CCV_NNC_FUSED_GEMM_BACKWARD)
+#define CMD_FUSED_GEMM_BACKWARD(_activation) ccv_nnc_cmd(CCV_NNC_FUSED_GEMM_BACKWARD, 0, ((ccv_nnc_cmd_param_t){.size={.dim={1,1,1}},.fused={.activation=_activation}}), 0)
+
+static int _ccv_nnc_arbitary_inplace(const int input_idx, const int input_size, const int output_idx, const int output_size)
+{
+	return 1;
+}
+
+static int _ccv_nnc_fused_ew_forw_bitmask(const int input_size, const int output_size, const uint64_t* const input_bitmasks, const int input_bitmask_size, const uint64_t* const output_bitmasks, const int output_bitmask_size)
+{
+	// Every input is consumed by one command in the sequence.
+	if (input_size >= 1 && input_size <= 64 && output_size == 1 && output_bitmasks[0] == 1u)
+	{
+		const uint64_t input_mask = input_size == 64 ? ~(uint64_t)0 : ((uint64_t)1 << input_size) - 1;
+		return (input_bitmasks[0] & input_mask) == input_mask;
+	}
+	return 0;
+}
+
+static int _ccv_nnc_fused_ew_back_bitmask(const int input_size, const int output_size, const uint64_t* const input_bitmasks, const int input_bitmask_size, const uint64_t* const output_bitmasks, const int output_bitmask_size)
+{
+	// Inputs (gradient, inputs of the forward command, [y]), the forward values are recomputed from the inputs.
+	if (output_size < 1 || output_size > 62 || input_size < output_size + 1)
+		return 0;
+	const uint64_t input_mask = ((uint64_t)1 << (output_size + 1)) - 1;
+	if ((input_bitmasks[0] & input_mask) != input_mask)
+		return 0;
+	// Any of the gradients w.r.t. the inputs.
+	if (output_bitmasks[0] != 0 && (output_bitmasks[0] & ~(((uint64_t)1 << output_size) - 1)) == 0)
+		return 1;
+	return 0;
+}
+
+REGISTER_COMMAND(CCV_NNC_FUSED_EW_FORWARD)(ccv_nnc_cmd_registry_t* const registry)
+	FIND_BACKEND(ccv_nnc_fused_cpu_ref.c, ccv_nnc_fused_cpu_opt.c)
+{
+	registry->bitmask = _ccv_nnc_fused_ew_forw_bitmask;
+	registry->tensor_auto = ccv_nnc_hint_tensor_auto_forward_from_inputs;
+	registry->allow_inplace = _ccv_nnc_arbitary_inplace;
+}
+
+REGISTER_COMMAND(CCV_NNC_FUSED_EW_BACKWARD)(ccv_nnc_cmd_registry_t* const registry)
+	FIND_BACKEND(ccv_nnc_fused_cpu_ref.c)
+{
+	registry->bitmask = _ccv_nnc_fused_ew_back_bitmask;
+	registry->tensor_auto = ccv_nnc_hint_tensor_auto_backward_from_inputs;
+}
+
+//@REGISTER_EASY_COMMAND_MACRO(CCV_NNC_FUSED_EW_FORWARD)
+#define CMD_FUSED_EW_FORWARD(...) ccv_nnc_cmd(CCV_NNC_FUSED_EW_FORWARD, 0, ((ccv_nnc_cmd_param_t){.size={.dim={1,1,1}},.fused={.op_count=sizeof((uint32_t[]){__VA_ARGS__}) / sizeof(uint32_t),.ops={__VA_ARGS__}}}), 0)
+//@REGISTER_EASY_COMMAND_MACRO(CCV_NNC_FUSED_EW_BACKWARD)
+#define CMD_FUSED_EW_BACKWARD(...) ccv_nnc_cmd(CCV_NNC_FUSED_EW_BACKWARD, 0, ((ccv_nnc_cmd_param_t){.size={.dim={1,1,1}},.fused={.op_count=sizeof((uint32_t[]){__VA_ARGS__}) / sizeof(uint32_t),.ops={__VA_ARGS__}}}), 0)
@@ -0,0 +1,297 @@
+#include "ccv.h"
+#include "ccv_internal.h"
+#include "nnc/ccv_nnc.h"
+#include "nnc/ccv_nnc_easy.h"
+#include "nnc/ccv_nnc_internal.h"
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+#ifdef USE_DISPATCH
+#include <dispatch/dispatch.h>
+#endif
+
+#include "../_ccv_nnc_cpu_opt.h"
+#include "../convolution/_ccv_nnc_conv_cpu_opt.h"
+#include "../blas/_ccv_nnc_gemm_cpu_opt.h"
+
+static int _ccv_nnc_fused_conv_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size == 2 || input_size == 3 || input_size == 7);
+	assert(output_size == 1);
+	const ccv_nnc_tensor_view_t* a = (ccv_nnc_tensor_view_t*)inputs[0];
+	const ccv_nnc_tensor_t* w = inputs[1];
+	const ccv_nnc_tensor_t* bias = input_size > 2 ? inputs[2] : 0;
+	ccv_nnc_tensor_view_t* b = (ccv_nnc_tensor_view_t*)outputs[0];
+	if (CCV_IS_TENSOR_VIEW(w) || (bias && CCV_IS_TENSOR_VIEW(bias)))
+		return CCV_NNC_EXEC_INVALID;
+	const int count = cmd.info.fused.count;
+	const int a_nd = ccv_nnc_tensor_nd(a->info.dim);
+	assert(a_nd == CCV_NNC_MAX_DIM + 1 || a_nd == CCV_NNC_MAX_DIM + 2);
+	const int* adim = (a_nd == CCV_NNC_MAX_DIM + 1) ? a->info.dim : a->info.dim + 1;
+	const int b_nd = ccv_nnc_tensor_nd(b->info.dim);
+	assert(b_nd == CCV_NNC_MAX_DIM + 1 || b_nd == CCV_NNC_MAX_DIM + 2);
+	const int* bdim = (b_nd == CCV_NNC_MAX_DIM + 1) ? b->info.dim : b->info.dim + 1;
+	assert(w->info.dim[CCV_NNC_MAX_DIM + 1] == adim[CCV_NNC_MAX_DIM]);
+	assert(bdim[CCV_NNC_MAX_DIM] == count);
+	assert(w->info.dim[0] == count);
+	int i;
+	for (i = 1; i < CCV_NNC_MAX_DIM_ALLOC; i++)
+	{
+		if (w->info.dim[i] == 0 || cmd.info.size.dim[i - 1] == 0)
+			break;
+		assert(w->info.dim[i] == cmd.info.size.dim[i - 1]);
+	}
+	ccv_nnc_tensor_t* fw = 0;
+	ccv_nnc_tensor_t* fbias = 0;
+	if (input_size == 7)
+	{
+		// Fold the batch norm into the weights and the bias, such that the kernel computes it for free:
+		// w' = w * scale / (sqrt(var) + epsilon), bias' = (bias - mean) * scale / (sqrt(var) + epsilon) + beta
+		const ccv_nnc_tensor_t* const scale = inputs[3];
+		const ccv_nnc_tensor_t* const beta = inputs[4];
+		const ccv_nnc_tensor_t* const mean = inputs[5];
+		const ccv_nnc_tensor_t* const var = inputs[6];
+		if (CCV_IS_TENSOR_VIEW(scale) || CCV_IS_TENSOR_VIEW(beta) || CCV_IS_TENSOR_VIEW(mean) || CCV_IS_TENSOR_VIEW(var))
+			return CCV_NNC_EXEC_INVALID;
+		assert(ccv_nnc_tensor_count(scale->info) == count);
+		assert(ccv_nnc_tensor_count(beta->info) == count);
+		assert(ccv_nnc_tensor_count(mean->info) == count);
+		assert(ccv_nnc_tensor_count(var->info) == count);
+		fw = ccv_nnc_tensor_new(0, w->info, 0);
+		fbias = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, count), 0);
+		const int wcount = ccv_nnc_tensor_count(w->info) / count;
+		const float epsilon = cmd.info.fused.epsilon;
+		parallel_for(k, count) {
+			const float s = scale->data.f32[k] / (sqrtf(var->data.f32[k]) + epsilon);
+			const float* const wp = w->data.f32 + k * wcount;
+			float* const fwp = fw->data.f32 + k * wcount;
+			int j;
+			for (j = 0; j < wcount; j++)
+				fwp[j] = wp[j] * s;
+			fbias->data.f32[k] = ((bias ? bias->data.f32[k] : 0) - mean->data.f32[k]) * s + beta->data.f32[k];
+		} parallel_endfor
+		w = fw;
+		bias = fbias;
+	}
+	const uint32_t activation = cmd.info.fused.activation;
+	int status;
+	// Same choice as the convolution, the activation is applied by the kernels before the result is stored.
+	if (w->info.dim[1] == 3 && w->info.dim[2] == 3 && hint.stride.dim[0] <= 1 && hint.stride.dim[1] <= 1)
+		status = _ccv_nnc_conv_forw_4x4_3x3_winograd_cpu_opt(a, w, bias, hint, b, activation, stream_context);
+	else if (w->info.dim[1] == 1 && w->info.dim[2] == 1 && hint.stride.dim[0] <= 1 && hint.stride.dim[1] <= 1 &&
+		hint.border.begin[0] == 0 && hint.border.begin[1] == 0 && hint.border.end[0] == 0 && hint.border.end[1] == 0 &&
+		!CCV_IS_TENSOR_VIEW(a) && !CCV_IS_TENSOR_VIEW(b))
+		status = _ccv_nnc_conv_forw_gemm_cpu_opt(a, w, bias, hint, b, activation);
+	else
+		status = _ccv_nnc_conv_forw_cpu_opt(a, w, bias, hint, b, activation);
+	if (fw)
+		ccv_nnc_tensor_free(fw);
+	if (fbias)
+		ccv_nnc_tensor_free(fbias);
+	return status;
+}
+
+// Compute this many output elements at a time, thus, the activation is applied while they are still in cache.
+#define CCV_NNC_FUSED_GEMM_BLOCK (16384)
+
+static int _ccv_nnc_fused_gemm_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size == 2 || input_size == 3);
+	assert(output_size == 1);
+	const ccv_nnc_tensor_t* const a = inputs[0];
+	const ccv_nnc_tensor_t* const w = inputs[1];
+	const ccv_nnc_tensor_t* const bias = input_size > 2 ? inputs[2] : 0;
+	ccv_nnc_tensor_t* const b = outputs[0];
+	if (CCV_IS_TENSOR_VIEW(a) || CCV_IS_TENSOR_VIEW(w) || (bias && CCV_IS_TENSOR_VIEW(bias)) || CCV_IS_TENSOR_VIEW(b))
+		return CCV_NNC_EXEC_INVALID;
+	const int a_nd = ccv_nnc_tensor_nd(a->info.dim);
+	const int b_nd = ccv_nnc_tensor_nd(b->info.dim);
+	if (a_nd > 2 || b_nd > 2 || ccv_nnc_tensor_nd(w->info.dim) != 2 || (bias && ccv_nnc_tensor_nd(bias->info.dim) > 1))
+		return CCV_NNC_EXEC_INVALID;
+	const int batch_size = a_nd == 1 ? 1 : ccv_max(1, a->info.dim[0]);
+	const int acol = w->info.dim[1];
+	const int bcol = w->info.dim[0];
+	assert(ccv_nnc_tensor_count(a->info) == batch_size * acol);
+	assert(ccv_nnc_tensor_count(b->info) == batch_size * bcol);
+	assert(!bias || bias->info.dim[0] == bcol);
+	const uint32_t activation = cmd.info.fused.activation;
+	const int rows = ccv_max(1, CCV_NNC_FUSED_GEMM_BLOCK / bcol);
+	int i;
+	for (i = 0; i < batch_size; i += rows)
+	{
+		const int block_rows = ccv_min(rows, batch_size - i);
+		ccv_nnc_tensor_param_t a_params = a->info;
+		memset(a_params.dim, 0, sizeof(a_params.dim));
+		a_params.dim[0] = block_rows;
+		a_params.dim[1] = acol;
+		ccv_nnc_tensor_param_t b_params = b->info;
+		memset(b_params.dim, 0, sizeof(b_params.dim));
+		b_params.dim[0] = block_rows;
+		b_params.dim[1] = bcol;
+		ccv_nnc_tensor_t ab = ccv_nnc_tensor(a->data.f32 + i * acol, a_params, 0);
+		ccv_nnc_tensor_t bb = ccv_nnc_tensor(b->data.f32 + i * bcol, b_params, 0);
+		int status;
+#if (defined HAVE_CBLAS || defined HAVE_ACCELERATE_FRAMEWORK)
+		status = _ccv_nnc_gemm_forw_cpu_sys((ccv_nnc_tensor_view_t*)&ab, (const ccv_nnc_tensor_view_t*)w, (const ccv_nnc_tensor_view_t*)bias, (ccv_nnc_tensor_view_t*)&bb);
+#else
+		status = _ccv_nnc_gemm_forw_cpu_opt((ccv_nnc_tensor_view_t*)&ab, (const ccv_nnc_tensor_view_t*)w, (const ccv_nnc_tensor_view_t*)bias, (ccv_nnc_tensor_view_t*)&bb);
+#endif
+		if (status != CCV_NNC_EXEC_SUCCESS)
+			return status;
+		_ccv_nnc_cpu_opt_act_block(bb.data.f32, 0, block_rows * bcol, activation);
+	}
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+static void _ccv_nnc_fused_ew_block(const ccv_nnc_cmd_param_t params, ccv_nnc_tensor_t* const* const inputs, float* const bp, const int start, const int end)
+{
+	const int op_count = params.fused.op_count;
+	int x = start, k;
+#if defined(HAVE_SSE2)
+	for (; x < end - 3; x += 4)
+	{
+		__m128 v = _mm_loadu_ps(inputs[0]->data.f32 + x);
+		int next = 1;
+		for (k = 0; k < op_count; k++)
+			switch (params.fused.ops[k])
+			{
+				case CCV_NNC_EWSUM_FORWARD:
+					v = _mm_add_ps(v, _mm_loadu_ps(inputs[next++]->data.f32 + x));
+					break;
+				case CCV_NNC_EWPROD_FORWARD:
+					v = _mm_mul_ps(v, _mm_loadu_ps(inputs[next++]->data.f32 + x));
+					break;
+				case CCV_NNC_EWEXP_FORWARD:
+					v = _ccv_nnc_exp_ps_sse2(v);
+					break;
+				case CCV_NNC_EWSQRT_FORWARD:
+					v = _mm_sqrt_ps(v);
+					break;
+				case CCV_NNC_EWLOG_FORWARD: {
+					float f[4];
+					_mm_storeu_ps(f, v);
+					v = _mm_set_ps(logf(f[3]), logf(f[2]), logf(f[1]), logf(f[0]));
+					break;
+				}
+				default:
+					v = _ccv_nnc_act_ps_sse2(v, params.fused.ops[k]);
+					break;
+			}
+		_mm_storeu_ps(bp + x, v);
+	}
+#elif defined(HAVE_NEON)
+	for (; x < end - 3; x += 4)
+	{
+		float32x4_t v = vld1q_f32(inputs[0]->data.f32 + x);
+		int next = 1;
+		for (k = 0; k < op_count; k++)
+			switch (params.fused.ops[k])
+			{
+				case CCV_NNC_EWSUM_FORWARD:
+					v = vaddq_f32(v, vld1q_f32(inputs[next++]->data.f32 + x));
+					break;
+				case CCV_NNC_EWPROD_FORWARD:
+					v = vmulq_f32(v, vld1q_f32(inputs[next++]->data.f32 + x));
+					break;
+				case CCV_NNC_EWEXP_FORWARD:
+					v = _ccv_nnc_exp_ps_neon(v);
+					break;
+				case CCV_NNC_EWSQRT_FORWARD:
+				case CCV_NNC_EWLOG_FORWARD: {
+					float f[4];
+					int j;
+					vst1q_f32(f, v);
+					for (j = 0; j < 4; j++)
+						f[j] = params.fused.ops[k] == CCV_NNC_EWSQRT_FORWARD ? sqrtf(f[j]) : logf(f[j]);
+					v = vld1q_f32(f);
+					break;
+				}
+				default:
+					v = _ccv_nnc_act_ps_neon(v, params.fused.ops[k]);
+					break;
+			}
+		vst1q_f32(bp + x, v);
+	}
+#endif
+	for (; x < end; x++)
+	{
+		float v = inputs[0]->data.f32[x];
+		int next = 1;
+		for (k = 0; k < op_count; k++)
+			switch (params.fused.ops[k])
+			{
+				case CCV_NNC_EWSUM_FORWARD:
+					v += inputs[next++]->data.f32[x];
+					break;
+				case CCV_NNC_EWPROD_FORWARD:
+					v *= inputs[next++]->data.f32[x];
+					break;
+				case CCV_NNC_EWEXP_FORWARD:
+					v = expf(v);
+					break;
+				case CCV_NNC_EWSQRT_FORWARD:
+					v = sqrtf(v);
+					break;
+				case CCV_NNC_EWLOG_FORWARD:
+					v = logf(v);
+					break;
+				default:
+					v = _ccv_nnc_cpu_opt_act(v, params.fused.ops[k]);
+					break;
+			}
+		bp[x] = v;
+	}
+}
+
+static int _ccv_nnc_fused_ew_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(output_size == 1);
+	const int op_count = cmd.info.fused.op_count;
+	assert(op_count > 0 && op_count <= CCV_NNC_MAX_FUSED_OPS);
+	ccv_nnc_tensor_t* const b = outputs[0];
+	if (CCV_IS_TENSOR_VIEW(b))
+		return CCV_NNC_EXEC_INVALID;
+	const int count = ccv_nnc_tensor_count(b->info);
+	int i, binary_count = 0;
+	for (i = 0; i < input_size; i++)
+		if (!inputs[i] || CCV_IS_TENSOR_VIEW(inputs[i]) || ccv_nnc_tensor_count(inputs[i]->info) != count)
+			return CCV_NNC_EXEC_INVALID;
+	for (i = 0; i < op_count; i++)
+		if (cmd.info.fused.ops[i] == CCV_NNC_EWSUM_FORWARD || cmd.info.fused.ops[i] == CCV_NNC_EWPROD_FORWARD)
+			++binary_count;
+	assert(input_size == binary_count + 1);
+	// The whole sequence is computed in registers, every element is loaded once from each input and stored once.
+	// An element of the output is written after every input element of the same index is read, thus, in-place is fine.
+	const int block_count = (count + CCV_NNC_CPU_OPT_EW_BLOCK - 1) / CCV_NNC_CPU_OPT_EW_BLOCK;
+	parallel_for(i, block_count) {
+		_ccv_nnc_fused_ew_block(cmd.info, inputs, b->data.f32, i * CCV_NNC_CPU_OPT_EW_BLOCK, ccv_min((i + 1) * CCV_NNC_CPU_OPT_EW_BLOCK, count));
+	} parallel_endfor
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_FUSED_CONVOLUTION_FORWARD, CCV_NNC_BACKEND_CPU_OPT)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC;
+	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_fused_conv_forw;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_FUSED_GEMM_FORWARD, CCV_NNC_BACKEND_CPU_OPT)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW;
+	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_fused_gemm_forw;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_FUSED_EW_FORWARD, CCV_NNC_BACKEND_CPU_OPT)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW | CCV_TENSOR_FORMAT_CHWN;
+	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_fused_ew_forw;
+}
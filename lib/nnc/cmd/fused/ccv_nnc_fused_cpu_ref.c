@@ -0,0 +1,391 @@
+#include "ccv.h"
+#include "ccv_internal.h"
+#include "nnc/ccv_nnc.h"
+#include "nnc/ccv_nnc_easy.h"
+#include "nnc/ccv_nnc_internal.h"
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+#ifdef USE_DISPATCH
+#include <dispatch/dispatch.h>
+#endif
+
+// The reference implementation computes the fused commands the way they were before fusion, to be the ground truth of
+// the fused kernels in CPU_OPT.
+
+static float _ccv_nnc_fused_act(const float v, const uint32_t activation)
+{
+	switch (activation)
+	{
+		case CCV_NNC_RELU_FORWARD:
+			return ccv_max(v, 0);
+		case CCV_NNC_SIGMOID_FORWARD:
+			return 1. / (1. + exp(-v));
+		case CCV_NNC_SWISH_FORWARD:
+			return v / (1. + exp(-v));
+	}
+	return v;
+}
+
+// Derivative of the activation, x is the input of the activation and y is the output.
+static float _ccv_nnc_fused_act_back(const float x, const float y, const uint32_t activation)
+{
+	switch (activation)
+	{
+		case CCV_NNC_RELU_FORWARD:
+			return y > 0 ? 1 : 0;
+		case CCV_NNC_SIGMOID_FORWARD:
+			return y * (1 - y);
+		case CCV_NNC_SWISH_FORWARD: {
+			const float s = 1. / (1. + exp(-x));
+			return x * (s - s * s) + s;
+		}
+	}
+	return 1;
+}
+
+static void _ccv_nnc_fused_act_forw(ccv_nnc_tensor_t* const b, const uint32_t activation)
+{
+	if (!activation)
+		return;
+	const int count = ccv_nnc_tensor_count(b->info);
+	int i;
+	for (i = 0; i < count; i++)
+		b->data.f32[i] = _ccv_nnc_fused_act(b->data.f32[i], activation);
+}
+
+// Compute the gradient w.r.t. the input of the activation, z is the input of the activation, only needed for swish.
+static ccv_nnc_tensor_t* _ccv_nnc_fused_act_back_new(const ccv_nnc_tensor_t* const g, const ccv_nnc_tensor_t* const z, const ccv_nnc_tensor_t* const y, const uint32_t activation)
+{
+	ccv_nnc_tensor_t* const h = ccv_nnc_tensor_new(0, g->info, 0);
+	const int count = ccv_nnc_tensor_count(g->info);
+	int i;
+	for (i = 0; i < count; i++)
+		h->data.f32[i] = g->data.f32[i] * _ccv_nnc_fused_act_back(z ? z->data.f32[i] : 0, y->data.f32[i], activation);
+	return h;
+}
+
+static ccv_nnc_cmd_t _ccv_nnc_fused_conv_cmd(const uint32_t cmd, const ccv_nnc_cmd_param_t fused)
+{
+	ccv_nnc_cmd_param_t params = {
+		.size = fused.size,
+		.convolution = {
+			.count = fused.fused.count,
+			.groups = 1,
+		},
+	};
+	ccv_nnc_cmd_t conv = ccv_nnc_cmd(cmd, 0, params, 0);
+	conv.backend = CCV_NNC_BACKEND_CPU_REF;
+	return conv;
+}
+
+static int _ccv_nnc_fused_conv_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size == 2 || input_size == 3 || input_size == 7);
+	assert(output_size == 1);
+	ccv_nnc_tensor_t* const b = outputs[0];
+	if (CCV_IS_TENSOR_VIEW(b))
+		return CCV_NNC_EXEC_INVALID;
+	const int status = ccv_nnc_cmd_exec(_ccv_nnc_fused_conv_cmd(CCV_NNC_CONVOLUTION_FORWARD, cmd.info), hint, flags, inputs, ccv_min(input_size, 3), outputs, 1, stream_context);
+	if (status != CCV_NNC_EXEC_SUCCESS)
+		return status;
+	if (input_size == 7)
+	{
+		// Batch norm in test mode, per output channel.
+		const ccv_nnc_tensor_t* const scale = inputs[3];
+		const ccv_nnc_tensor_t* const bias = inputs[4];
+		const ccv_nnc_tensor_t* const mean = inputs[5];
+		const ccv_nnc_tensor_t* const var = inputs[6];
+		const int count = cmd.info.fused.count;
+		assert(ccv_nnc_tensor_count(scale->info) == count);
+		assert(ccv_nnc_tensor_count(bias->info) == count);
+		assert(ccv_nnc_tensor_count(mean->info) == count);
+		assert(ccv_nnc_tensor_count(var->info) == count);
+		const int rows = ccv_nnc_tensor_count(b->info) / count;
+		int i, j;
+		for (i = 0; i < rows; i++)
+		{
+			float* const bp = b->data.f32 + i * count;
+			for (j = 0; j < count; j++)
+			{
+				const float w = scale->data.f32[j] / (sqrtf(var->data.f32[j]) + cmd.info.fused.epsilon);
+				bp[j] = bp[j] * w + (bias->data.f32[j] - mean->data.f32[j] * w);
+			}
+		}
+	}
+	_ccv_nnc_fused_act_forw(b, cmd.info.fused.activation);
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+static int _ccv_nnc_fused_conv_back(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	// inputs: gradient, x, w, [bias], y
+	// outputs: [propagated error], dw, [dbias]
+	// There is no backward for the folded batch norm, it is only folded in test mode.
+	if (input_size != 4 && input_size != 5)
+		return CCV_NNC_EXEC_INVALID;
+	const uint32_t activation = cmd.info.fused.activation;
+	ccv_nnc_tensor_t* const g = inputs[0];
+	ccv_nnc_tensor_t* const y = inputs[input_size - 1];
+	ccv_nnc_tensor_t* h = g;
+	if (activation)
+	{
+		if (CCV_IS_TENSOR_VIEW(g) || CCV_IS_TENSOR_VIEW(y))
+			return CCV_NNC_EXEC_INVALID;
+		ccv_nnc_tensor_t* z = 0;
+		if (activation == CCV_NNC_SWISH_FORWARD)
+		{
+			// Swish cannot be inverted, recompute its input.
+			z = ccv_nnc_tensor_new(0, y->info, 0);
+			const int status = ccv_nnc_cmd_exec(_ccv_nnc_fused_conv_cmd(CCV_NNC_CONVOLUTION_FORWARD, cmd.info), hint, flags, inputs + 1, input_size - 2, &z, 1, stream_context);
+			if (status != CCV_NNC_EXEC_SUCCESS)
+			{
+				ccv_nnc_tensor_free(z);
+				return status;
+			}
+		}
+		h = _ccv_nnc_fused_act_back_new(g, z, y, activation);
+		if (z)
+			ccv_nnc_tensor_free(z);
+	}
+	ccv_nnc_tensor_t* const back_inputs[] = { h, inputs[1], inputs[2] };
+	const int status = ccv_nnc_cmd_exec(_ccv_nnc_fused_conv_cmd(CCV_NNC_CONVOLUTION_BACKWARD, cmd.info), hint, flags, back_inputs, 3, outputs, output_size, stream_context);
+	if (h != g)
+		ccv_nnc_tensor_free(h);
+	return status;
+}
+
+static ccv_nnc_cmd_t _ccv_nnc_fused_gemm_cmd(const uint32_t cmd)
+{
+	ccv_nnc_cmd_t gemm = ccv_nnc_cmd(cmd, 0, CMD_GEMM(NO_TRANSPOSE, TRANSPOSE(0, 1)), 0);
+	gemm.backend = CCV_NNC_BACKEND_CPU_REF;
+	return gemm;
+}
+
+static int _ccv_nnc_fused_gemm_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size == 2 || input_size == 3);
+	assert(output_size == 1);
+	ccv_nnc_tensor_t* const b = outputs[0];
+	if (CCV_IS_TENSOR_VIEW(b))
+		return CCV_NNC_EXEC_INVALID;
+	const int status = ccv_nnc_cmd_exec(_ccv_nnc_fused_gemm_cmd(CCV_NNC_GEMM_FORWARD), hint, flags, inputs, input_size, outputs, 1, stream_context);
+	if (status != CCV_NNC_EXEC_SUCCESS)
+		return status;
+	_ccv_nnc_fused_act_forw(b, cmd.info.fused.activation);
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+static int _ccv_nnc_fused_gemm_back(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	// inputs: gradient, a, w, [bias], y
+	// outputs: [propagated error], dw, [dbias]
+	assert(input_size == 4 || input_size == 5);
+	const uint32_t activation = cmd.info.fused.activation;
+	ccv_nnc_tensor_t* const g = inputs[0];
+	ccv_nnc_tensor_t* const y = inputs[input_size - 1];
+	ccv_nnc_tensor_t* h = g;
+	if (activation)
+	{
+		if (CCV_IS_TENSOR_VIEW(g) || CCV_IS_TENSOR_VIEW(y))
+			return CCV_NNC_EXEC_INVALID;
+		ccv_nnc_tensor_t* z = 0;
+		if (activation == CCV_NNC_SWISH_FORWARD)
+		{
+			z = ccv_nnc_tensor_new(0, y->info, 0);
+			const int status = ccv_nnc_cmd_exec(_ccv_nnc_fused_gemm_cmd(CCV_NNC_GEMM_FORWARD), hint, flags, inputs + 1, input_size - 2, &z, 1, stream_context);
+			if (status != CCV_NNC_EXEC_SUCCESS)
+			{
+				ccv_nnc_tensor_free(z);
+				return status;
+			}
+		}
+		h = _ccv_nnc_fused_act_back_new(g, z, y, activation);
+		if (z)
+			ccv_nnc_tensor_free(z);
+	}
+	ccv_nnc_tensor_t* const back_inputs[] = { h, inputs[1], inputs[2] };
+	// The GEMM backward is the bulk of the work, let it pick the best backend.
+	ccv_nnc_cmd_t gemm_back = _ccv_nnc_fused_gemm_cmd(CCV_NNC_GEMM_BACKWARD);
+	gemm_back.backend = CCV_NNC_NO_BACKEND;
+	const int status = ccv_nnc_cmd_exec(gemm_back, hint, flags, back_inputs, 3, outputs, output_size, stream_context);
+	if (h != g)
+		ccv_nnc_tensor_free(h);
+	return status;
+}
+
+static int _ccv_nnc_fused_ew_is_binary(const uint32_t op)
+{
+	return op == CCV_NNC_EWSUM_FORWARD || op == CCV_NNC_EWPROD_FORWARD;
+}
+
+static float _ccv_nnc_fused_ew_op(const uint32_t op, const float v, const float u)
+{
+	switch (op)
+	{
+		case CCV_NNC_EWSUM_FORWARD:
+			return v + u;
+		case CCV_NNC_EWPROD_FORWARD:
+			return v * u;
+		case CCV_NNC_EWEXP_FORWARD:
+			return exp(v);
+		case CCV_NNC_EWLOG_FORWARD:
+			return log(v);
+		case CCV_NNC_EWSQRT_FORWARD:
+			return sqrt(v);
+	}
+	return _ccv_nnc_fused_act(v, op);
+}
+
+static int _ccv_nnc_fused_ew_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(output_size == 1);
+	const int op_count = cmd.info.fused.op_count;
+	assert(op_count > 0 && op_count <= CCV_NNC_MAX_FUSED_OPS);
+	ccv_nnc_tensor_t* const b = outputs[0];
+	const int count = ccv_nnc_tensor_count(b->info);
+	int i, k;
+	for (i = 0; i < input_size; i++)
+		if (CCV_IS_TENSOR_VIEW(inputs[i]) || ccv_nnc_tensor_count(inputs[i]->info) != count)
+			return CCV_NNC_EXEC_INVALID;
+	if (CCV_IS_TENSOR_VIEW(b))
+		return CCV_NNC_EXEC_INVALID;
+	for (i = 0; i < count; i++)
+	{
+		float v = inputs[0]->data.f32[i];
+		int next = 1;
+		for (k = 0; k < op_count; k++)
+		{
+			const uint32_t op = cmd.info.fused.ops[k];
+			if (_ccv_nnc_fused_ew_is_binary(op))
+			{
+				assert(next < input_size);
+				v = _ccv_nnc_fused_ew_op(op, v, inputs[next++]->data.f32[i]);
+			} else
+				v = _ccv_nnc_fused_ew_op(op, v, 0);
+		}
+		b->data.f32[i] = v;
+	}
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+static int _ccv_nnc_fused_ew_back(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	// inputs: gradient, inputs of the forward command, [y]
+	// outputs: gradients w.r.t. the inputs of the forward command.
+	const int op_count = cmd.info.fused.op_count;
+	assert(op_count > 0 && op_count <= CCV_NNC_MAX_FUSED_OPS);
+	assert(input_size >= output_size + 1);
+	const ccv_nnc_tensor_t* const g = inputs[0];
+	const int count = ccv_nnc_tensor_count(g->info);
+	int i, k;
+	for (i = 0; i < output_size + 1; i++)
+		if (CCV_IS_TENSOR_VIEW(inputs[i]) || ccv_nnc_tensor_count(inputs[i]->info) != count)
+			return CCV_NNC_EXEC_INVALID;
+	for (i = 0; i < output_size; i++)
+		if (outputs[i] && (CCV_IS_TENSOR_VIEW(outputs[i]) || ccv_nnc_tensor_count(outputs[i]->info) != count))
+			return CCV_NNC_EXEC_INVALID;
+	for (i = 0; i < count; i++)
+	{
+		// Recompute the value before each command, then go backward.
+		float v[CCV_NNC_MAX_FUSED_OPS];
+		float u[CCV_NNC_MAX_FUSED_OPS];
+		float x = inputs[1]->data.f32[i];
+		int next = 1;
+		for (k = 0; k < op_count; k++)
+		{
+			const uint32_t op = cmd.info.fused.ops[k];
+			v[k] = x;
+			u[k] = _ccv_nnc_fused_ew_is_binary(op) ? inputs[1 + next++]->data.f32[i] : 0;
+			x = _ccv_nnc_fused_ew_op(op, v[k], u[k]);
+		}
+		float dv = g->data.f32[i];
+		for (k = op_count - 1; k >= 0; k--)
+		{
+			const uint32_t op = cmd.info.fused.ops[k];
+			switch (op)
+			{
+				case CCV_NNC_EWSUM_FORWARD:
+					--next;
+					if (next < output_size && outputs[next])
+						outputs[next]->data.f32[i] = dv;
+					break;
+				case CCV_NNC_EWPROD_FORWARD:
+					--next;
+					if (next < output_size && outputs[next])
+						outputs[next]->data.f32[i] = dv * v[k];
+					dv *= u[k];
+					break;
+				case CCV_NNC_EWEXP_FORWARD:
+					dv *= exp(v[k]);
+					break;
+				case CCV_NNC_EWLOG_FORWARD:
+					dv /= v[k];
+					break;
+				case CCV_NNC_EWSQRT_FORWARD:
+					dv *= 0.5 / sqrt(v[k]);
+					break;
+				default:
+					dv *= _ccv_nnc_fused_act_back(v[k], _ccv_nnc_fused_act(v[k], op), op);
+					break;
+			}
+		}
+		if (outputs[0])
+			outputs[0]->data.f32[i] = dv;
+	}
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_FUSED_CONVOLUTION_FORWARD, CCV_NNC_BACKEND_CPU_REF)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC;
+	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_fused_conv_forw;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_FUSED_CONVOLUTION_BACKWARD, CCV_NNC_BACKEND_CPU_REF)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC;
+	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_fused_conv_back;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_FUSED_GEMM_FORWARD, CCV_NNC_BACKEND_CPU_REF)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW;
+	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_fused_gemm_forw;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_FUSED_GEMM_BACKWARD, CCV_NNC_BACKEND_CPU_REF)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW;
+	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_fused_gemm_back;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_FUSED_EW_FORWARD, CCV_NNC_BACKEND_CPU_REF)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW | CCV_TENSOR_FORMAT_CHWN;
+	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_fused_ew_forw;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_FUSED_EW_BACKWARD, CCV_NNC_BACKEND_CPU_REF)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW | CCV_TENSOR_FORMAT_CHWN;
+	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_fused_ew_back;
+}
@@ -0,0 +1,287 @@
+#include "ccv.h"
+#include "ccv_internal.h"
+#include "nnc/ccv_nnc.h"
+#include "nnc/ccv_nnc_easy.h"
+#include "nnc/ccv_nnc_internal.h"
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+#ifdef USE_DISPATCH
+#include <dispatch/dispatch.h>
+#endif
+
+#include "../_ccv_nnc_cpu_opt.h"
+
+// Maximum number of partial sums when the channel is the last (contiguous) axis.
+#define CCV_NNC_BATCH_NORM_PARTS (16)
+
+// Sum of the rows (if mean is 0) or sum of the squared deviation of the rows, where each row has ch channels.
+static void _ccv_nnc_batch_norm_sum_rows(const float* const ap, const float* const mean, float* const sum, const int row_start, const int row_end, const int ch)
+{
+	int x, y;
+	for (x = 0; x < ch; x++)
+		sum[x] = 0;
+	for (y = row_start; y < row_end; y++)
+	{
+		const float* const apy = ap + y * ch;
+		x = 0;
+#if defined(HAVE_SSE2)
+		if (mean)
+			for (; x < ch - 3; x += 4)
+			{
+				const __m128 w = _mm_sub_ps(_mm_loadu_ps(apy + x), _mm_loadu_ps(mean + x));
+				_mm_storeu_ps(sum + x, _mm_add_ps(_mm_loadu_ps(sum + x), _mm_mul_ps(w, w)));
+			}
+		else
+			for (; x < ch - 3; x += 4)
+				_mm_storeu_ps(sum + x, _mm_add_ps(_mm_loadu_ps(sum + x), _mm_loadu_ps(apy + x)));
+#elif defined(HAVE_NEON)
+		if (mean)
+			for (; x < ch - 3; x += 4)
+			{
+				const float32x4_t w = vsubq_f32(vld1q_f32(apy + x), vld1q_f32(mean + x));
+				vst1q_f32(sum + x, vmlaq_f32(vld1q_f32(sum + x), w, w));
+			}
+		else
+			for (; x < ch - 3; x += 4)
+				vst1q_f32(sum + x, vaddq_f32(vld1q_f32(sum + x), vld1q_f32(apy + x)));
+#endif
+		if (mean)
+			for (; x < ch; x++)
+			{
+				const float w = apy[x] - mean[x];
+				sum[x] += w * w;
+			}
+		else
+			for (; x < ch; x++)
+				sum[x] += apy[x];
+	}
+}
+
+// Sum of the row (if mean is 0) or sum of the squared deviation of the row.
+static float _ccv_nnc_batch_norm_sum_row(const float* const ap, const int count, const int has_mean, const float mean)
+{
+	int x = 0;
+	float sum = 0;
+#if defined(HAVE_SSE2)
+	__m128 sum4 = _mm_setzero_ps();
+	if (has_mean)
+	{
+		const __m128 mean4 = _mm_set1_ps(mean);
+		for (; x < count - 3; x += 4)
+		{
+			const __m128 w = _mm_sub_ps(_mm_loadu_ps(ap + x), mean4);
+			sum4 = _mm_add_ps(sum4, _mm_mul_ps(w, w));
+		}
+	} else
+		for (; x < count - 3; x += 4)
+			sum4 = _mm_add_ps(sum4, _mm_loadu_ps(ap + x));
+	sum = _ccv_nnc_hsum_ps_sse2(sum4);
+#elif defined(HAVE_NEON)
+	float32x4_t sum4 = vdupq_n_f32(0);
+	if (has_mean)
+	{
+		const float32x4_t mean4 = vdupq_n_f32(mean);
+		for (; x < count - 3; x += 4)
+		{
+			const float32x4_t w = vsubq_f32(vld1q_f32(ap + x), mean4);
+			sum4 = vmlaq_f32(sum4, w, w);
+		}
+	} else
+		for (; x < count - 3; x += 4)
+			sum4 = vaddq_f32(sum4, vld1q_f32(ap + x));
+	sum = _ccv_nnc_hsum_ps_neon(sum4);
+#endif
+	if (has_mean)
+		for (; x < count; x++)
+		{
+			const float w = ap[x] - mean;
+			sum += w * w;
+		}
+	else
+		for (; x < count; x++)
+			sum += ap[x];
+	return sum;
+}
+
+static void _ccv_nnc_batch_norm_stats(const float* const ap, const int outer, const int ch, const int inner, float* const meanp, float* const varp, float* const partp, const int parts, const float inv_batch_size)
+{
+	int i, j;
+	if (inner == 1)
+	{
+		// Channel is the contiguous axis, reduce the rows in parts and then combine the partial sums.
+		parallel_for(p, parts) {
+			_ccv_nnc_batch_norm_sum_rows(ap, 0, partp + p * ch, (int)((int64_t)outer * p / parts), (int)((int64_t)outer * (p + 1) / parts), ch);
+		} parallel_endfor
+		for (j = 0; j < ch; j++)
+		{
+			float sum = 0;
+			for (i = 0; i < parts; i++)
+				sum += partp[i * ch + j];
+			meanp[j] = sum * inv_batch_size;
+		}
+		parallel_for(p, parts) {
+			_ccv_nnc_batch_norm_sum_rows(ap, meanp, partp + p * ch, (int)((int64_t)outer * p / parts), (int)((int64_t)outer * (p + 1) / parts), ch);
+		} parallel_endfor
+		for (j = 0; j < ch; j++)
+		{
+			float sum = 0;
+			for (i = 0; i < parts; i++)
+				sum += partp[i * ch + j];
+			varp[j] = sum * inv_batch_size;
+		}
+	} else {
+		// Each channel is a set of contiguous rows, reduce each channel on its own.
+		parallel_for(c, ch) {
+			int k;
+			float sum = 0;
+			for (k = 0; k < outer; k++)
+				sum += _ccv_nnc_batch_norm_sum_row(ap + (k * ch + c) * inner, inner, 0, 0);
+			const float mean = meanp[c] = sum * inv_batch_size;
+			sum = 0;
+			for (k = 0; k < outer; k++)
+				sum += _ccv_nnc_batch_norm_sum_row(ap + (k * ch + c) * inner, inner, 1, mean);
+			varp[c] = sum * inv_batch_size;
+		} parallel_endfor
+	}
+}
+
+static void _ccv_nnc_batch_norm_apply_rows(const float* const ap, float* const bp, const float* const nscalep, const float* const nbiasp, const int row_start, const int row_end, const int ch)
+{
+	int x, y;
+	for (y = row_start; y < row_end; y++)
+	{
+		const float* const apy = ap + y * ch;
+		float* const bpy = bp + y * ch;
+		x = 0;
+#if defined(HAVE_SSE2)
+		for (; x < ch - 3; x += 4)
+			_mm_storeu_ps(bpy + x, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(apy + x), _mm_loadu_ps(nscalep + x)), _mm_loadu_ps(nbiasp + x)));
+#elif defined(HAVE_NEON)
+		for (; x < ch - 3; x += 4)
+			vst1q_f32(bpy + x, vmlaq_f32(vld1q_f32(nbiasp + x), vld1q_f32(apy + x), vld1q_f32(nscalep + x)));
+#endif
+		for (; x < ch; x++)
+			bpy[x] = apy[x] * nscalep[x] + nbiasp[x];
+	}
+}
+
+static void _ccv_nnc_batch_norm_apply_row(const float* const ap, float* const bp, const float nscale, const float nbias, const int count)
+{
+	int x = 0;
+#if defined(HAVE_SSE2)
+	const __m128 nscale4 = _mm_set1_ps(nscale);
+	const __m128 nbias4 = _mm_set1_ps(nbias);
+	for (; x < count - 3; x += 4)
+		_mm_storeu_ps(bp + x, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(ap + x), nscale4), nbias4));
+#elif defined(HAVE_NEON)
+	const float32x4_t nscale4 = vdupq_n_f32(nscale);
+	const float32x4_t nbias4 = vdupq_n_f32(nbias);
+	for (; x < count - 3; x += 4)
+		vst1q_f32(bp + x, vmlaq_f32(nbias4, vld1q_f32(ap + x), nscale4));
+#endif
+	for (; x < count; x++)
+		bp[x] = ap[x] * nscale + nbias;
+}
+
+static int _ccv_nnc_batch_norm_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size == 5);
+	ccv_nnc_tensor_view_t* const a = (ccv_nnc_tensor_view_t*)inputs[0];
+	ccv_nnc_tensor_view_t* const scale = (ccv_nnc_tensor_view_t*)inputs[1];
+	ccv_nnc_tensor_view_t* const bias = (ccv_nnc_tensor_view_t*)inputs[2];
+	ccv_nnc_tensor_view_t* const mean = (ccv_nnc_tensor_view_t*)inputs[3];
+	ccv_nnc_tensor_view_t* const var = (ccv_nnc_tensor_view_t*)inputs[4];
+	ccv_nnc_tensor_view_t* const b = (ccv_nnc_tensor_view_t*)outputs[0];
+	// The pre-computed scale / bias has to live somewhere.
+	if (flags & CCV_NNC_ZERO_MEMORY_ALLOC)
+		return CCV_NNC_EXEC_INVALID;
+	if (a->info.dim[CCV_NNC_MAX_DIM + 2] != 0 || CCV_IS_TENSOR_VIEW(a) || CCV_IS_TENSOR_VIEW(scale) || CCV_IS_TENSOR_VIEW(bias) || CCV_IS_TENSOR_VIEW(mean) || CCV_IS_TENSOR_VIEW(var) || CCV_IS_TENSOR_VIEW(b))
+		return CCV_NNC_EXEC_INVALID;
+	if (!cmd.info.bnorm.is_test && (CCV_IS_TENSOR_VIEW(outputs[3]) || CCV_IS_TENSOR_VIEW(outputs[4])))
+		return CCV_NNC_EXEC_INVALID;
+	int adim[CCV_NNC_MAX_DIM_ALLOC];
+	int rdim[CCV_NNC_MAX_DIM_ALLOC];
+	ccv_nnc_tensor_view_get_dim(a, adim);
+	ccv_nnc_tensor_view_get_dim(scale, rdim);
+	assert(ccv_nnc_tensor_view_check_dim(bias, rdim));
+	assert(ccv_nnc_tensor_view_check_dim(mean, rdim));
+	assert(ccv_nnc_tensor_view_check_dim(var, rdim));
+	assert(ccv_nnc_tensor_view_check_dim(b, adim));
+	int outer, ch, inner;
+	// Reduced axes, followed by kept axes (channels), followed by reduced axes.
+	if (!_ccv_nnc_cpu_opt_fold_dim(adim, rdim, 1, &outer, &ch, &inner))
+		return CCV_NNC_EXEC_INVALID;
+	const float epsilon = cmd.info.bnorm.epsilon;
+	const int parts = inner == 1 ? ccv_min(outer, CCV_NNC_BATCH_NORM_PARTS) : 0;
+	float* const nscalep = (float*)ccv_nnc_stream_context_get_workspace(stream_context, sizeof(float) * ch * (2 + parts), CCV_TENSOR_CPU_MEMORY);
+	if (!nscalep)
+		return CCV_NNC_EXEC_OOM;
+	float* const nbiasp = nscalep + ch;
+	const float* const scalep = scale->data.f32;
+	const float* const biasp = bias->data.f32;
+	int x;
+	if (!cmd.info.bnorm.is_test)
+	{
+		assert(output_size == 5);
+		// Both are inplace.
+		assert(inputs[3]->data.f32 == outputs[1]->data.f32);
+		assert(inputs[4]->data.f32 == outputs[2]->data.f32);
+		ccv_nnc_tensor_view_t* const saved_mean = (ccv_nnc_tensor_view_t*)outputs[3];
+		ccv_nnc_tensor_view_t* const saved_inv_std = (ccv_nnc_tensor_view_t*)outputs[4];
+		assert(ccv_nnc_tensor_view_check_dim(saved_mean, rdim));
+		assert(ccv_nnc_tensor_view_check_dim(saved_inv_std, rdim));
+		float* const saved_meanp = saved_mean->data.f32;
+		float* const saved_inv_stdp = saved_inv_std->data.f32;
+		const float inv_batch_size = 1. / (outer * inner);
+		// Compute the batch variance into saved_inv_std first.
+		_ccv_nnc_batch_norm_stats(a->data.f32, outer, ch, inner, saved_meanp, saved_inv_stdp, nbiasp + ch, parts, inv_batch_size);
+		const float momentum = cmd.info.bnorm.momentum;
+		float* const meanp = mean->data.f32;
+		float* const varp = var->data.f32;
+		for (x = 0; x < ch; x++)
+		{
+			meanp[x] = momentum * meanp[x] + (1 - momentum) * saved_meanp[x];
+			varp[x] = momentum * varp[x] + (1 - momentum) * saved_inv_stdp[x];
+			saved_inv_stdp[x] = 1. / sqrtf(saved_inv_stdp[x] + epsilon);
+			// y = (x - mean) * inv_std * scale + bias = x * nscale + nbias
+			const float w = saved_inv_stdp[x] * scalep[x];
+			nscalep[x] = w;
+			nbiasp[x] = biasp[x] - saved_meanp[x] * w;
+		}
+	} else {
+		assert(output_size >= 1);
+		const float* const meanp = mean->data.f32;
+		const float* const varp = var->data.f32;
+		for (x = 0; x < ch; x++)
+		{
+			const float w = scalep[x] / (sqrtf(varp[x]) + epsilon);
+			nscalep[x] = w;
+			nbiasp[x] = biasp[x] - meanp[x] * w;
+		}
+	}
+	const float* const ap = a->data.f32;
+	float* const bp = b->data.f32;
+	if (inner == 1)
+	{
+		const int rows_per_block = ccv_max(1, CCV_NNC_CPU_OPT_EW_BLOCK / ch);
+		parallel_for(i, (outer + rows_per_block - 1) / rows_per_block) {
+			_ccv_nnc_batch_norm_apply_rows(ap, bp, nscalep, nbiasp, i * rows_per_block, ccv_min((i + 1) * rows_per_block, outer), ch);
+		} parallel_endfor
+	} else {
+		parallel_for(i, outer * ch) {
+			const int c = i % ch;
+			_ccv_nnc_batch_norm_apply_row(ap + i * inner, bp + i * inner, nscalep[c], nbiasp[c], inner);
+		} parallel_endfor
+	}
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_BATCH_NORM_FORWARD, CCV_NNC_BACKEND_CPU_OPT)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW | CCV_TENSOR_FORMAT_CHWN;
+	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_batch_norm_forw;
+}
@@ -0,0 +1,126 @@
+#include "ccv.h"
+#include "ccv_internal.h"
+#include "nnc/ccv_nnc.h"
+#include "nnc/ccv_nnc_easy.h"
+#include "nnc/ccv_nnc_internal.h"
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+#ifdef USE_DISPATCH
+#include <dispatch/dispatch.h>
+#endif
+
+#include "../_ccv_nnc_cpu_opt.h"
+
+static void _ccv_nnc_layer_norm_forw_row(const float* const ap, const float* const scalep, const float* const biasp, float* const bp, const int n, const float epsilon, float* const meanp, float* const inv_stdp)
+{
+	int x = 0;
+	float sum = 0;
+#if defined(HAVE_SSE2)
+	__m128 sum4 = _mm_setzero_ps();
+	for (; x < n - 3; x += 4)
+		sum4 = _mm_add_ps(sum4, _mm_loadu_ps(ap + x));
+	sum = _ccv_nnc_hsum_ps_sse2(sum4);
+#elif defined(HAVE_NEON)
+	float32x4_t sum4 = vdupq_n_f32(0);
+	for (; x < n - 3; x += 4)
+		sum4 = vaddq_f32(sum4, vld1q_f32(ap + x));
+	sum = _ccv_nnc_hsum_ps_neon(sum4);
+#endif
+	for (; x < n; x++)
+		sum += ap[x];
+	const float inv_n = 1. / n;
+	const float mean = sum * inv_n;
+	float var = 0;
+	x = 0;
+#if defined(HAVE_SSE2)
+	const __m128 mean4 = _mm_set1_ps(mean);
+	__m128 var4 = _mm_setzero_ps();
+	for (; x < n - 3; x += 4)
+	{
+		const __m128 w = _mm_sub_ps(_mm_loadu_ps(ap + x), mean4);
+		var4 = _mm_add_ps(var4, _mm_mul_ps(w, w));
+	}
+	var = _ccv_nnc_hsum_ps_sse2(var4);
+#elif defined(HAVE_NEON)
+	const float32x4_t mean4 = vdupq_n_f32(mean);
+	float32x4_t var4 = vdupq_n_f32(0);
+	for (; x < n - 3; x += 4)
+	{
+		const float32x4_t w = vsubq_f32(vld1q_f32(ap + x), mean4);
+		var4 = vmlaq_f32(var4, w, w);
+	}
+	var = _ccv_nnc_hsum_ps_neon(var4);
+#endif
+	for (; x < n; x++)
+	{
+		const float w = ap[x] - mean;
+		var += w * w;
+	}
+	// The epsilon is used a little bit differently from batch norm, it is outside of the sqrt in this case.
+	const float inv_std = 1. / (sqrtf(var * inv_n) + epsilon);
+	*meanp = mean;
+	*inv_stdp = inv_std;
+	x = 0;
+#if defined(HAVE_SSE2)
+	const __m128 inv_std4 = _mm_set1_ps(inv_std);
+	for (; x < n - 3; x += 4)
+	{
+		const __m128 w = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(ap + x), mean4), inv_std4);
+		_mm_storeu_ps(bp + x, _mm_add_ps(_mm_mul_ps(w, _mm_loadu_ps(scalep + x)), _mm_loadu_ps(biasp + x)));
+	}
+#elif defined(HAVE_NEON)
+	const float32x4_t inv_std4 = vdupq_n_f32(inv_std);
+	for (; x < n - 3; x += 4)
+	{
+		const float32x4_t w = vmulq_f32(vsubq_f32(vld1q_f32(ap + x), mean4), inv_std4);
+		vst1q_f32(bp + x, vmlaq_f32(vld1q_f32(biasp + x), w, vld1q_f32(scalep + x)));
+	}
+#endif
+	for (; x < n; x++)
+		bp[x] = (ap[x] - mean) * inv_std * scalep[x] + biasp[x];
+}
+
+static int _ccv_nnc_layer_norm_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size == 3);
+	ccv_nnc_tensor_view_t* const a = (ccv_nnc_tensor_view_t*)inputs[0];
+	ccv_nnc_tensor_view_t* const scale = (ccv_nnc_tensor_view_t*)inputs[1];
+	ccv_nnc_tensor_view_t* const bias = (ccv_nnc_tensor_view_t*)inputs[2];
+	ccv_nnc_tensor_view_t* const b = (ccv_nnc_tensor_view_t*)outputs[0];
+	ccv_nnc_tensor_view_t* const saved_mean = (ccv_nnc_tensor_view_t*)outputs[1];
+	ccv_nnc_tensor_view_t* const saved_inv_std = (ccv_nnc_tensor_view_t*)outputs[2];
+	if (a->info.dim[CCV_NNC_MAX_DIM + 2] != 0 || CCV_IS_TENSOR_VIEW(a) || CCV_IS_TENSOR_VIEW(scale) || CCV_IS_TENSOR_VIEW(bias) || CCV_IS_TENSOR_VIEW(b) || CCV_IS_TENSOR_VIEW(saved_mean) || CCV_IS_TENSOR_VIEW(saved_inv_std))
+		return CCV_NNC_EXEC_INVALID;
+	int adim[CCV_NNC_MAX_DIM_ALLOC];
+	int rdim[CCV_NNC_MAX_DIM_ALLOC];
+	ccv_nnc_tensor_view_get_dim(a, adim);
+	ccv_nnc_tensor_view_get_dim(saved_mean, rdim);
+	assert(ccv_nnc_tensor_view_check_dim(saved_inv_std, rdim));
+	assert(ccv_nnc_tensor_view_check_dim(b, adim));
+	int outer, n, inner;
+	// Only the normalized axes being the trailing axes is supported.
+	if (!_ccv_nnc_cpu_opt_fold_dim(adim, rdim, 0, &outer, &n, &inner) || inner != 1)
+		return CCV_NNC_EXEC_INVALID;
+	// Scale and bias have to be per element of the normalized axes.
+	int sdim[CCV_NNC_MAX_DIM_ALLOC];
+	int x;
+	for (x = 0; x < CCV_NNC_MAX_DIM + 2; x++)
+		sdim[x] = rdim[x] == 1 ? adim[x] : 1;
+	if (!ccv_nnc_tensor_view_check_dim(scale, sdim) || !ccv_nnc_tensor_view_check_dim(bias, sdim))
+		return CCV_NNC_EXEC_INVALID;
+	const float epsilon = cmd.info.lnorm.epsilon;
+	parallel_for(i, outer) {
+		_ccv_nnc_layer_norm_forw_row(a->data.f32 + i * n, scale->data.f32, bias->data.f32, b->data.f32 + i * n, n, epsilon, saved_mean->data.f32 + i, saved_inv_std->data.f32 + i);
+	} parallel_endfor
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_LAYER_NORM_FORWARD, CCV_NNC_BACKEND_CPU_OPT)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW | CCV_TENSOR_FORMAT_CHWN;
+	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_layer_norm_forw;
+}
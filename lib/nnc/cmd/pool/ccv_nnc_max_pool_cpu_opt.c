@@ -0,0 +1,98 @@
+#include "ccv.h"
+#include "ccv_internal.h"
+#include "nnc/ccv_nnc.h"
+#include "nnc/ccv_nnc_easy.h"
+#include "nnc/ccv_nnc_internal.h"
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+#ifdef USE_DISPATCH
+#include <dispatch/dispatch.h>
+#endif
+
+#include "../_ccv_nnc_cpu_opt.h"
+
+static void _ccv_nnc_max_pool_forw_row(const float* const ap, const int* const adim, float* const bp, const int* const bdim, const int* const dim, const ccv_nnc_hint_t hint, const int y)
+{
+	int i[CCV_NNC_MAX_DIM];
+	int n[CCV_NNC_MAX_DIM];
+	int m[CCV_NNC_MAX_DIM];
+	int j[CCV_NNC_MAX_DIM];
+	int c;
+	const int ch = adim[CCV_NNC_MAX_DIM];
+	const int astride = adim[CCV_NNC_MAX_DIM - 1] * ch;
+	i[0] = y;
+	SET_BORDER_OFFSET_SIZE_FOR(0, i, hint, dim, adim, n, m);
+	const float* const apy = ap + ccv_max(y * hint.stride.dim[0] - hint.border.begin[0], 0) * astride;
+	float* const bpy = bp + y * bdim[CCV_NNC_MAX_DIM - 1] * ch;
+	for (i[1] = 0; i[1] < bdim[1]; i[1]++)
+	{
+		SET_BORDER_OFFSET_SIZE_FOR(1, i, hint, dim, adim, n, m);
+		const float* const apz = apy + ccv_max(i[1] * hint.stride.dim[1] - hint.border.begin[1], 0) * ch;
+		float* const bpz = bpy + i[1] * ch;
+		c = 0;
+#if defined(HAVE_SSE2)
+		for (; c < ch - 3; c += 4)
+		{
+			__m128 v = _mm_loadu_ps(apz + c);
+			for (j[0] = 0; j[0] < m[0]; j[0]++)
+				for (j[1] = 0; j[1] < m[1]; j[1]++)
+					v = _mm_max_ps(v, _mm_loadu_ps(apz + j[0] * astride + j[1] * ch + c));
+			_mm_storeu_ps(bpz + c, v);
+		}
+#elif defined(HAVE_NEON)
+		for (; c < ch - 3; c += 4)
+		{
+			float32x4_t v = vld1q_f32(apz + c);
+			for (j[0] = 0; j[0] < m[0]; j[0]++)
+				for (j[1] = 0; j[1] < m[1]; j[1]++)
+					v = vmaxq_f32(v, vld1q_f32(apz + j[0] * astride + j[1] * ch + c));
+			vst1q_f32(bpz + c, v);
+		}
+#endif
+		for (; c < ch; c++)
+		{
+			float v = apz[c];
+			for (j[0] = 0; j[0] < m[0]; j[0]++)
+				for (j[1] = 0; j[1] < m[1]; j[1]++)
+					if (apz[j[0] * astride + j[1] * ch + c] > v)
+						v = apz[j[0] * astride + j[1] * ch + c];
+			bpz[c] = v;
+		}
+	}
+}
+
+static int _ccv_nnc_max_pool_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size == 1);
+	const ccv_nnc_tensor_t* a = inputs[0];
+	assert(output_size == 1);
+	ccv_nnc_tensor_t* b = outputs[0];
+	if (CCV_IS_TENSOR_VIEW(a) || CCV_IS_TENSOR_VIEW(b))
+		return CCV_NNC_EXEC_INVALID;
+	const int *dim = cmd.info.size.dim;
+	const int a_nd = ccv_nnc_tensor_nd(a->info.dim);
+	assert(a_nd == CCV_NNC_MAX_DIM + 1 || a_nd == CCV_NNC_MAX_DIM + 2);
+	const int* adim = (a_nd == CCV_NNC_MAX_DIM + 1) ? a->info.dim : a->info.dim + 1;
+	const int b_nd = ccv_nnc_tensor_nd(b->info.dim);
+	assert(b_nd == CCV_NNC_MAX_DIM + 1 || b_nd == CCV_NNC_MAX_DIM + 2);
+	const int* bdim = (b_nd == CCV_NNC_MAX_DIM + 1) ? b->info.dim : b->info.dim + 1;
+	assert(adim[CCV_NNC_MAX_DIM] == bdim[CCV_NNC_MAX_DIM]);
+	const int batch_size = (a_nd == CCV_NNC_MAX_DIM + 2) ? a->info.dim[0] : 1;
+	const int a_batch_inc = adim[0] * adim[1] * adim[CCV_NNC_MAX_DIM];
+	const int b_batch_inc = bdim[0] * bdim[1] * bdim[CCV_NNC_MAX_DIM];
+	parallel_for(i, batch_size * bdim[0]) {
+		const int n = i / bdim[0];
+		_ccv_nnc_max_pool_forw_row(a->data.f32 + n * a_batch_inc, adim, b->data.f32 + n * b_batch_inc, bdim, dim, hint, i % bdim[0]);
+	} parallel_endfor
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_MAX_POOL_FORWARD, CCV_NNC_BACKEND_CPU_OPT)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC;
+	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_max_pool_forw;
+}
@@ -0,0 +1,95 @@
+#ifndef GUARD_ccv_nnc_quant_h
+#define GUARD_ccv_nnc_quant_h
+
+#include "ccv.h"
+#include "nnc/ccv_nnc.h"
+
+/**
+ * Quantize one value to 8U, x * inv_scale is rounded to the nearest even, which is what _mm_cvtps_epi32 does under the
+ * default rounding mode, thus the reference and the optimized kernels agree.
+ */
+static inline uint8_t _ccv_nnc_quantize_u8(const float x, const float inv_scale, const int zero_point)
+{
+	const float v = ccv_clamp(x * inv_scale, -65536.f, 65536.f);
+	const int q = (int)lrintf(v) + zero_point;
+	return (uint8_t)ccv_clamp(q, 0, 255);
+}
+
+/**
+ * The weights quantized to signed 8-bit symmetrically per output channel (w = q * scale[k], q in [-127, 127]). The sum
+ * has the prefix sums along the kernel width of q summed over channels ([count, kh, kw + 1]), so the zero point of the
+ * activations can be corrected for any window clipped by the border.
+ */
+typedef struct {
+	int count;
+	int kh;
+	int kw;
+	int channels;
+	int8_t* w;
+	float* scale;
+	int32_t* sum;
+} ccv_nnc_quantized_w_t;
+
+// The weights are [count, kh, kw, channels] for convolution and [count, channels] for GEMM.
+static inline ccv_nnc_quantized_w_t _ccv_nnc_quantized_w(const ccv_nnc_tensor_t* const w, void* const packed)
+{
+	ccv_nnc_quantized_w_t qw = {
+		.count = w->info.dim[0],
+		.kh = 1,
+		.kw = 1,
+	};
+	const int w_nd = ccv_nnc_tensor_nd(w->info.dim);
+	if (w_nd == 2)
+		qw.channels = w->info.dim[1];
+	else {
+		assert(w_nd == CCV_NNC_MAX_DIM + 2);
+		qw.kh = w->info.dim[1];
+		qw.kw = w->info.dim[2];
+		qw.channels = w->info.dim[3];
+	}
+	const size_t w_size = ((size_t)qw.count * qw.kh * qw.kw * qw.channels + 15) & -16;
+	qw.w = (int8_t*)packed;
+	qw.scale = packed ? (float*)((uint8_t*)packed + w_size) : 0;
+	qw.sum = packed ? (int32_t*)(qw.scale + qw.count) : 0;
+	return qw;
+}
+
+static inline size_t _ccv_nnc_quantized_w_size(const ccv_nnc_quantized_w_t qw)
+{
+	return (((size_t)qw.count * qw.kh * qw.kw * qw.channels + 15) & -16) + sizeof(float) * qw.count + sizeof(int32_t) * qw.count * qw.kh * (qw.kw + 1);
+}
+
+// Conforms to ccv_nnc_tensor_pack_f.
+static inline void _ccv_nnc_quantized_w_pack(const ccv_nnc_tensor_t* const w, void* const packed, void* const context)
+{
+	assert(w->info.datatype == CCV_32F);
+	const ccv_nnc_quantized_w_t qw = _ccv_nnc_quantized_w(w, packed);
+	const int size = qw.kh * qw.kw * qw.channels;
+	int i, j, k, x;
+	for (k = 0; k < qw.count; k++)
+	{
+		const float* const wp = w->data.f32 + (size_t)k * size;
+		float max = 0;
+		for (i = 0; i < size; i++)
+			max = ccv_max(max, fabsf(wp[i]));
+		qw.scale[k] = max > 0 ? max / 127 : 1;
+		const float inv_scale = max > 0 ? 127 / max : 0;
+		int8_t* const qwp = qw.w + (size_t)k * size;
+		for (i = 0; i < size; i++)
+			qwp[i] = (int8_t)ccv_clamp((int)lrintf(wp[i] * inv_scale), -127, 127);
+		for (i = 0; i < qw.kh; i++)
+		{
+			int32_t* const sum = qw.sum + ((size_t)k * qw.kh + i) * (qw.kw + 1);
+			sum[0] = 0;
+			for (j = 0; j < qw.kw; j++)
+			{
+				int32_t v = 0;
+				for (x = 0; x < qw.channels; x++)
+					v += qwp[(i * qw.kw + j) * qw.channels + x];
+				sum[j + 1] = sum[j] + v;
+			}
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,126 @@
+#include "ccv.h"
+#include "nnc/ccv_nnc.h"
+#include "nnc/ccv_nnc_easy.h"
+#include "nnc/ccv_nnc_internal.h"
+
+static int _ccv_nnc_quantize_bitmask(const int input_size, const int output_size, const uint64_t* const input_bitmasks, const int input_bitmask_size, const uint64_t* const output_bitmasks, const int output_bitmask_size)
+{
+	if (input_size == 1 && (input_bitmasks[0] & 1u) == 1u && output_bitmasks[0] == 1u)
+		return 1;
+	return 0;
+}
+
+static void _ccv_nnc_quantize_tensor_auto_forw(const ccv_nnc_cmd_param_t cmd, const ccv_nnc_tensor_param_t* const inputs, const int input_size, const ccv_nnc_hint_t hint, ccv_nnc_tensor_param_t* const outputs, const int output_size)
+{
+	assert(output_size == 1);
+	outputs[0] = inputs[0];
+	outputs[0].datatype = CCV_8U;
+}
+
+static void _ccv_nnc_quantize_tensor_auto_back(const ccv_nnc_cmd_param_t cmd, const ccv_nnc_tensor_param_t* const inputs, const int input_size, const ccv_nnc_hint_t hint, ccv_nnc_tensor_param_t* const outputs, const int output_size)
+{
+	assert(output_size == 1);
+	outputs[0] = inputs[0];
+	outputs[0].datatype = CCV_32F;
+}
+
+// The forward command quantizes 32F to 8U, the backward command dequantizes 8U back to 32F, similar to the compression commands.
+REGISTER_COMMAND(CCV_NNC_QUANTIZE_FORWARD)(ccv_nnc_cmd_registry_t* const registry)
+	FIND_BACKEND(ccv_nnc_quant_cpu_ref.c, ccv_nnc_quant_cpu_opt.c)
+{
+	registry->bitmask = _ccv_nnc_quantize_bitmask;
+	registry->tensor_auto = _ccv_nnc_quantize_tensor_auto_forw;
+}
+
+REGISTER_COMMAND(CCV_NNC_QUANTIZE_BACKWARD)(ccv_nnc_cmd_registry_t* const registry)
+	FIND_BACKEND(ccv_nnc_quant_cpu_ref.c, ccv_nnc_quant_cpu_opt.c)
+{
+	registry->bitmask = _ccv_nnc_quantize_bitmask;
+	registry->tensor_auto = _ccv_nnc_quantize_tensor_auto_back;
+}
+
+//@REGISTER_EASY_COMMAND_MACRO(CCV_NNC_QUANTIZE_FORWARD)
+#define CMD_QUANTIZE_FORWARD(_scale, _zero_point) ccv_nnc_cmd(CCV_NNC_QUANTIZE_FORWARD, 0, ((ccv_nnc_cmd_param_t){.size={.dim={1,1,1}},.quant={.scale=_scale,.zero_point=_zero_point}}), 0)
+//@REGISTER_EASY_COMMAND_MACRO(CCV_NNC_QUANTIZE_BACKWARD)
+#define CMD_QUANTIZE_BACKWARD(_scale, _zero_point) ccv_nnc_cmd(CCV_NNC_QUANTIZE_BACKWARD, 0, ((ccv_nnc_cmd_param_t){.size={.dim={1,1,1}},.quant={.scale=_scale,.zero_point=_zero_point}}), 0)
+
+static int _ccv_nnc_quantized_forw_bitmask(const int input_size, const int output_size, const uint64_t* const input_bitmasks, const int input_bitmask_size, const uint64_t* const output_bitmasks, const int output_bitmask_size)
+{
+	if (input_size == 3 && (input_bitmasks[0] & 7u) == ((1u << 0) | (1u << 1) | (1u << 2)) && output_bitmasks[0] == 1u)
+		return 1;
+	// No bias is OK.
+	if (input_size == 2 && (input_bitmasks[0] & 3u) == ((1u << 0) | (1u << 1)) && output_bitmasks[0] == 1u)
+		return 1;
+	return 0;
+}
+
+static int _ccv_nnc_quantized_back_bitmask(const int input_size, const int output_size, const uint64_t* const input_bitmasks, const int input_bitmask_size, const uint64_t* const output_bitmasks, const int output_bitmask_size)
+{
+	// The quantized commands are for inference only.
+	return 0;
+}
+
+static void _ccv_nnc_quantized_conv_tensor_auto_forw(const ccv_nnc_cmd_param_t cmd, const ccv_nnc_tensor_param_t* const inputs, const int input_size, const ccv_nnc_hint_t hint, ccv_nnc_tensor_param_t* const outputs, const int output_size)
+{
+	assert(output_size == 1);
+	outputs[0].type = inputs[0].type;
+	outputs[0].format = inputs[0].format;
+	outputs[0].datatype = CCV_32F;
+	// Get the channel output from the weight matrix.
+	const int count = ccv_nnc_tensor_get_n(inputs[1]);
+	assert(count == cmd.quant.count);
+	ccv_nnc_tensor_set_c(outputs, ccv_nnc_tensor_nd(inputs[0].dim), count);
+	ccv_nnc_tensor_set_n(outputs, ccv_nnc_tensor_get_n(inputs[0]));
+	ccv_nnc_hint_tensor_forward(cmd, inputs[0], hint, outputs);
+}
+
+// The input a is in 8U (quantized with quant.scale / quant.zero_point), the weights and the bias are in 32F, and the
+// weights are quantized per output channel by the backend. The output is in 32F.
+REGISTER_COMMAND(CCV_NNC_QUANTIZED_CONVOLUTION_FORWARD)(ccv_nnc_cmd_registry_t* const registry)
+	FIND_BACKEND(ccv_nnc_quant_cpu_ref.c, ccv_nnc_quant_cpu_opt.c)
+{
+	registry->bitmask = _ccv_nnc_quantized_forw_bitmask;
+	registry->tensor_auto = _ccv_nnc_quantized_conv_tensor_auto_forw;
+}
+
+REGISTER_COMMAND(CCV_NNC_QUANTIZED_CONVOLUTION_BACKWARD)(ccv_nnc_cmd_registry_t* const registry)
+{
+	registry->bitmask = _ccv_nnc_quantized_back_bitmask;
+	registry->tensor_auto = ccv_nnc_hint_tensor_auto_backward_from_inputs;
+}
+
+//@REGISTER_EASY_COMMAND_MACRO(CCV_NNC_QUANTIZED_CONVOLUTION_FORWARD)
+#define CMD_QUANTIZED_CONVOLUTION_FORWARD(_scale, _zero_point, _activation, _count, ...) ccv_nnc_cmd(CCV_NNC_QUANTIZED_CONVOLUTION_FORWARD, 0, ((ccv_nnc_cmd_param_t){.size={.dim={__VA_ARGS__}},.quant={.scale=_scale,.zero_point=_zero_point,.count=_count,.activation=_activation}}), 0)
+
+static void _ccv_nnc_quantized_gemm_tensor_auto_forw(const ccv_nnc_cmd_param_t cmd, const ccv_nnc_tensor_param_t* const inputs, const int input_size, const ccv_nnc_hint_t hint, ccv_nnc_tensor_param_t* const outputs, const int output_size)
+{
+	assert(output_size == 1);
+	// The quantized GEMM is always b = a * w^T + bias, with w in the shape of [count, a's column].
+	const int a_nd = ccv_nnc_tensor_nd(inputs[0].dim);
+	outputs[0].type = inputs[0].type;
+	outputs[0].format = inputs[0].format;
+	outputs[0].datatype = CCV_32F;
+	if (a_nd == 1)
+		outputs[0].dim[0] = inputs[1].dim[0];
+	else {
+		assert(a_nd == 2);
+		outputs[0].dim[0] = inputs[0].dim[0];
+		outputs[0].dim[1] = inputs[1].dim[0];
+	}
+}
+
+REGISTER_COMMAND(CCV_NNC_QUANTIZED_GEMM_FORWARD)(ccv_nnc_cmd_registry_t* const registry)
+	FIND_BACKEND(ccv_nnc_quant_cpu_ref.c, ccv_nnc_quant_cpu_opt.c)
+{
+	registry->bitmask = _ccv_nnc_quantized_forw_bitmask;
+	registry->tensor_auto = _ccv_nnc_quantized_gemm_tensor_auto_forw;
+}
+
+REGISTER_COMMAND(CCV_NNC_QUANTIZED_GEMM_BACKWARD)(ccv_nnc_cmd_registry_t* const registry)
+{
+	registry->bitmask = _ccv_nnc_quantized_back_bitmask;
+	registry->tensor_auto = ccv_nnc_hint_tensor_auto_backward_from_inputs;
+}
+
+//@REGISTER_EASY_COMMAND_MACRO(CCV_NNC_QUANTIZED_GEMM_FORWARD)
+#define CMD_QUANTIZED_GEMM_FORWARD(_scale, _zero_point, _activation) ccv_nnc_cmd(CCV_NNC_QUANTIZED_GEMM_FORWARD, 0, ((ccv_nnc_cmd_param_t){.size={.dim={1,1,1}},.quant={.scale=_scale,.zero_point=_zero_point,.activation=_activation}}), 0)
@@ -0,0 +1,368 @@
+#include "ccv.h"
+#include "ccv_internal.h"
+#include "nnc/ccv_nnc.h"
+#include "nnc/ccv_nnc_easy.h"
+#include "nnc/ccv_nnc_internal.h"
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+#ifdef USE_DISPATCH
+#include <dispatch/dispatch.h>
+#endif
+
+#include "../_ccv_nnc_cpu_opt.h"
+#include "_ccv_nnc_quant.h"
+
+// MARK - Quantize / Dequantize
+
+static int _ccv_nnc_quantize_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size == 1);
+	assert(output_size == 1);
+	const ccv_nnc_tensor_t* const a = inputs[0];
+	ccv_nnc_tensor_t* const b = outputs[0];
+	if (CCV_IS_TENSOR_VIEW(a) || CCV_IS_TENSOR_VIEW(b) || a->info.datatype != CCV_32F || b->info.datatype != CCV_8U)
+		return CCV_NNC_EXEC_INVALID;
+	const int count = ccv_nnc_tensor_count(a->info);
+	assert(count == ccv_nnc_tensor_count(b->info));
+	assert(cmd.info.quant.scale > 0);
+	const float inv_scale = 1. / cmd.info.quant.scale;
+	const int zero_point = cmd.info.quant.zero_point;
+	parallel_for(i, (count + CCV_NNC_CPU_OPT_EW_BLOCK - 1) / CCV_NNC_CPU_OPT_EW_BLOCK) {
+		const int start = i * CCV_NNC_CPU_OPT_EW_BLOCK;
+		const int end = ccv_min(start + CCV_NNC_CPU_OPT_EW_BLOCK, count);
+		const float* const ap = a->data.f32;
+		uint8_t* const bp = b->data.u8;
+		int x = start;
+#if defined(HAVE_SSE2)
+		// Rounds to the nearest even, and the saturated packs clamp to [0, 255].
+		const __m128 inv = _mm_set1_ps(inv_scale);
+		const __m128 lim = _mm_set1_ps(65536);
+		const __m128i zp = _mm_set1_epi32(zero_point);
+		for (; x < end - 15; x += 16)
+		{
+			__m128i q0 = _mm_add_epi32(_mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(ap + x), inv), lim), _mm_sub_ps(_mm_setzero_ps(), lim))), zp);
+			__m128i q1 = _mm_add_epi32(_mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(ap + x + 4), inv), lim), _mm_sub_ps(_mm_setzero_ps(), lim))), zp);
+			__m128i q2 = _mm_add_epi32(_mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(ap + x + 8), inv), lim), _mm_sub_ps(_mm_setzero_ps(), lim))), zp);
+			__m128i q3 = _mm_add_epi32(_mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(_mm_mul_ps(_mm_loadu_ps(ap + x + 12), inv), lim), _mm_sub_ps(_mm_setzero_ps(), lim))), zp);
+			_mm_storeu_si128((__m128i*)(bp + x), _mm_packus_epi16(_mm_packs_epi32(q0, q1), _mm_packs_epi32(q2, q3)));
+		}
+#endif
+		for (; x < end; x++)
+			bp[x] = _ccv_nnc_quantize_u8(ap[x], inv_scale, zero_point);
+	} parallel_endfor
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+static int _ccv_nnc_quantize_back(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size >= 1);
+	assert(output_size == 1);
+	const ccv_nnc_tensor_t* const a = inputs[0];
+	ccv_nnc_tensor_t* const b = outputs[0];
+	if (CCV_IS_TENSOR_VIEW(a) || CCV_IS_TENSOR_VIEW(b) || a->info.datatype != CCV_8U || b->info.datatype != CCV_32F)
+		return CCV_NNC_EXEC_INVALID;
+	const int count = ccv_nnc_tensor_count(a->info);
+	assert(count == ccv_nnc_tensor_count(b->info));
+	const float scale = cmd.info.quant.scale;
+	const int zero_point = cmd.info.quant.zero_point;
+	parallel_for(i, (count + CCV_NNC_CPU_OPT_EW_BLOCK - 1) / CCV_NNC_CPU_OPT_EW_BLOCK) {
+		const int start = i * CCV_NNC_CPU_OPT_EW_BLOCK;
+		const int end = ccv_min(start + CCV_NNC_CPU_OPT_EW_BLOCK, count);
+		const uint8_t* const ap = a->data.u8;
+		float* const bp = b->data.f32;
+		int x = start;
+#if defined(HAVE_SSE2)
+		const __m128 s = _mm_set1_ps(scale);
+		const __m128i zp = _mm_set1_epi16(zero_point);
+		const __m128i z = _mm_setzero_si128();
+		for (; x < end - 15; x += 16)
+		{
+			const __m128i q = _mm_loadu_si128((const __m128i*)(ap + x));
+			const __m128i q0 = _mm_sub_epi16(_mm_unpacklo_epi8(q, z), zp);
+			const __m128i q1 = _mm_sub_epi16(_mm_unpackhi_epi8(q, z), zp);
+			_mm_storeu_ps(bp + x, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(q0, q0), 16)), s));
+			_mm_storeu_ps(bp + x + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(q0, q0), 16)), s));
+			_mm_storeu_ps(bp + x + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(q1, q1), 16)), s));
+			_mm_storeu_ps(bp + x + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(q1, q1), 16)), s));
+		}
+#endif
+		for (; x < end; x++)
+			bp[x] = (ap[x] - zero_point) * scale;
+	} parallel_endfor
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+// MARK - Dot product of unsigned 8-bit activations and signed 8-bit weights
+
+static inline int32_t _ccv_nnc_quantized_dot_ref(const uint8_t* const a, const int8_t* const w, const int n)
+{
+	int32_t sum = 0;
+	int i;
+	for (i = 0; i < n; i++)
+		sum += a[i] * w[i];
+	return sum;
+}
+
+#ifdef CCV_NNC_CPU_DISPATCH
+// Widens to 16-bit and uses pmaddwd, pmaddubsw would saturate the sum of two 255 * 127 products in 16-bit.
+__attribute__((target("avx2"))) static int32_t _ccv_nnc_quantized_dot_avx2(const uint8_t* const a, const int8_t* const w, const int n)
+{
+	__m256i v0 = _mm256_setzero_si256();
+	__m256i v1 = _mm256_setzero_si256();
+	int k = 0;
+	for (; k < n - 31; k += 32)
+	{
+		v0 = _mm256_add_epi32(v0, _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(a + k))), _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(w + k)))));
+		v1 = _mm256_add_epi32(v1, _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(a + k + 16))), _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(w + k + 16)))));
+	}
+	for (; k < n - 15; k += 16)
+		v0 = _mm256_add_epi32(v0, _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(a + k))), _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(w + k)))));
+	v0 = _mm256_add_epi32(v0, v1);
+	__m128i s = _mm_add_epi32(_mm256_castsi256_si128(v0), _mm256_extracti128_si256(v0, 1));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+	int32_t sum = _mm_cvtsi128_si32(s);
+	if (k < n)
+		sum += _ccv_nnc_quantized_dot_ref(a + k, w + k, n - k);
+	return sum;
+}
+#endif
+
+#ifdef CCV_NNC_CPU_DISPATCH_AVX512VNNI
+// vpdpbusd multiplies 4 unsigned / signed byte pairs and accumulates in 32-bit without the intermediate saturation.
+__attribute__((target("avx512f,avx512bw,avx512vnni"))) static int32_t _ccv_nnc_quantized_dot_avx512vnni(const uint8_t* const a, const int8_t* const w, const int n)
+{
+	__m512i v0 = _mm512_setzero_si512();
+	__m512i v1 = _mm512_setzero_si512();
+	int k = 0;
+	for (; k < n - 127; k += 128)
+	{
+		v0 = _mm512_dpbusd_epi32(v0, _mm512_loadu_si512(a + k), _mm512_loadu_si512(w + k));
+		v1 = _mm512_dpbusd_epi32(v1, _mm512_loadu_si512(a + k + 64), _mm512_loadu_si512(w + k + 64));
+	}
+	for (; k < n - 63; k += 64)
+		v0 = _mm512_dpbusd_epi32(v0, _mm512_loadu_si512(a + k), _mm512_loadu_si512(w + k));
+	if (k < n)
+	{
+		const __mmask64 mask = (__mmask64)(~(uint64_t)0 >> (64 - (n - k)));
+		v1 = _mm512_dpbusd_epi32(v1, _mm512_maskz_loadu_epi8(mask, a + k), _mm512_maskz_loadu_epi8(mask, w + k));
+	}
+	return _mm512_reduce_add_epi32(_mm512_add_epi32(v0, v1));
+}
+#endif
+
+static inline int32_t _ccv_nnc_quantized_dot(const int features, const uint8_t* const a, const int8_t* const w, const int n)
+{
+#ifdef CCV_NNC_CPU_DISPATCH_AVX512VNNI
+	if (features & CCV_NNC_CPU_FEATURE_AVX512VNNI)
+		return _ccv_nnc_quantized_dot_avx512vnni(a, w, n);
+#endif
+#ifdef CCV_NNC_CPU_DISPATCH
+	if (features & CCV_NNC_CPU_FEATURE_AVX2)
+		return _ccv_nnc_quantized_dot_avx2(a, w, n);
+#endif
+	return _ccv_nnc_quantized_dot_ref(a, w, n);
+}
+
+// MARK - Quantized Convolution / GEMM
+
+// The activations are unsigned with a zero point while the weights are signed, therefore, sum((a - zp) * w) is computed
+// as dot(a, w) - zp * sum(w), where sum(w) comes from the prefix sums of the packed weights for the window in bounds.
+static void* _ccv_nnc_quantized_w_retain(const ccv_nnc_tensor_t* const w, ccv_nnc_quantized_w_t* const qw, int* const is_packed)
+{
+	*qw = _ccv_nnc_quantized_w(w, 0);
+	const size_t packed_size = _ccv_nnc_quantized_w_size(*qw);
+	// Reuse the quantized weights if the weights haven't changed since.
+	void* packed = ccv_nnc_tensor_packed_retain(w, CCV_NNC_TENSOR_PACKED_QUANTIZED_W, packed_size, _ccv_nnc_quantized_w_pack, 0);
+	*is_packed = !!packed;
+	if (!packed)
+	{
+		packed = ccmalloc(packed_size);
+		if (!packed)
+			return 0;
+		_ccv_nnc_quantized_w_pack(w, packed, 0);
+	}
+	*qw = _ccv_nnc_quantized_w(w, packed);
+	return packed;
+}
+
+static void _ccv_nnc_quantized_w_release(void* const packed, const int is_packed)
+{
+	if (is_packed)
+		ccv_nnc_tensor_packed_release(packed);
+	else
+		ccfree(packed);
+}
+
+static int _ccv_nnc_quantized_conv_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size >= 2);
+	const ccv_nnc_tensor_view_t* a = (ccv_nnc_tensor_view_t*)inputs[0];
+	const ccv_nnc_tensor_t* w = inputs[1];
+	assert(!CCV_IS_TENSOR_VIEW(w));
+	const ccv_nnc_tensor_t* bias = input_size > 2 ? inputs[2] : 0;
+	assert(!bias || !CCV_IS_TENSOR_VIEW(bias));
+	assert(output_size == 1);
+	ccv_nnc_tensor_view_t* b = (ccv_nnc_tensor_view_t*)outputs[0];
+	if (a->info.datatype != CCV_8U || w->info.datatype != CCV_32F || b->info.datatype != CCV_32F || (bias && bias->info.datatype != CCV_32F))
+		return CCV_NNC_EXEC_INVALID;
+	const int a_nd = ccv_nnc_tensor_nd(a->info.dim);
+	assert(a_nd == CCV_NNC_MAX_DIM + 1 || a_nd == CCV_NNC_MAX_DIM + 2);
+	const int* adim = (a_nd == CCV_NNC_MAX_DIM + 1) ? a->info.dim : a->info.dim + 1;
+	const int b_nd = ccv_nnc_tensor_nd(b->info.dim);
+	assert(b_nd == CCV_NNC_MAX_DIM + 1 || b_nd == CCV_NNC_MAX_DIM + 2);
+	const int* bdim = (b_nd == CCV_NNC_MAX_DIM + 1) ? b->info.dim : b->info.dim + 1;
+	const int* ainc = CCV_IS_TENSOR_VIEW(a) ? ((a_nd == CCV_NNC_MAX_DIM + 1) ? a->inc : a->inc + 1) : adim;
+	const int* binc = CCV_IS_TENSOR_VIEW(b) ? ((b_nd == CCV_NNC_MAX_DIM + 1) ? b->inc : b->inc + 1) : bdim;
+	const int batch_size = (a_nd == CCV_NNC_MAX_DIM + 2) ? ccv_max(1, a->info.dim[0]) : 1;
+	assert(batch_size == ((b_nd == CCV_NNC_MAX_DIM + 2) ? ccv_max(1, b->info.dim[0]) : 1));
+	const int* const wdim = w->info.dim;
+	const int count = wdim[0];
+	const int channels = adim[CCV_NNC_MAX_DIM];
+	assert(count == cmd.info.quant.count);
+	assert(wdim[CCV_NNC_MAX_DIM + 1] == channels);
+	ccv_nnc_quantized_w_t qw;
+	int is_packed;
+	void* const packed = _ccv_nnc_quantized_w_retain(w, &qw, &is_packed);
+	if (!packed)
+		return CCV_NNC_EXEC_OOM;
+	// If the channels are contiguous in a, one kernel row (m[1] * channels) is contiguous in both a and w.
+	const int contiguous = (ainc[CCV_NNC_MAX_DIM] == channels);
+	const float a_scale = cmd.info.quant.scale;
+	const int zero_point = cmd.info.quant.zero_point;
+	const uint32_t activation = cmd.info.quant.activation;
+	const int cpu_features = ccv_nnc_cpu_features();
+	parallel_for(idx, batch_size * bdim[0]) {
+		int i[CCV_NNC_MAX_DIM];
+		int n[CCV_NNC_MAX_DIM];
+		int m[CCV_NNC_MAX_DIM];
+		int j0, j1, k;
+		const int bi = idx / bdim[0];
+		i[0] = idx % bdim[0];
+		SET_BORDER_OFFSET_SIZE_FOR(0, i, hint, wdim + 1, adim, n, m);
+		const uint8_t* const ap = a->data.u8 + (size_t)bi * ainc[0] * ainc[1] * ainc[2] + (size_t)ccv_max(i[0] * hint.stride.dim[0] - hint.border.begin[0], 0) * ainc[1] * ainc[2];
+		float* const bp = b->data.f32 + (size_t)bi * binc[0] * binc[1] * binc[2] + (size_t)i[0] * binc[1] * binc[2];
+		for (i[1] = 0; i[1] < bdim[1]; i[1]++)
+		{
+			SET_BORDER_OFFSET_SIZE_FOR(1, i, hint, wdim + 1, adim, n, m);
+			const uint8_t* const apz = ap + (size_t)ccv_max(i[1] * hint.stride.dim[1] - hint.border.begin[1], 0) * ainc[2];
+			for (k = 0; k < count; k++)
+			{
+				int32_t v = 0;
+				int32_t wsum = 0;
+				const int8_t* wpz = qw.w + ((size_t)(k * qw.kh + n[0]) * qw.kw + n[1]) * channels;
+				const int32_t* sum = qw.sum + (size_t)(k * qw.kh + n[0]) * (qw.kw + 1);
+				const uint8_t* apzu = apz;
+				for (j0 = 0; j0 < m[0]; j0++)
+				{
+					if (contiguous)
+						v += _ccv_nnc_quantized_dot(cpu_features, apzu, wpz, m[1] * channels);
+					else
+						for (j1 = 0; j1 < m[1]; j1++)
+							v += _ccv_nnc_quantized_dot(cpu_features, apzu + (size_t)j1 * ainc[2], wpz + (size_t)j1 * channels, channels);
+					wsum += sum[n[1] + m[1]] - sum[n[1]];
+					wpz += (size_t)qw.kw * channels;
+					sum += qw.kw + 1;
+					apzu += (size_t)ainc[1] * ainc[2];
+				}
+				const float scale = a_scale * qw.scale[k];
+				bp[(size_t)i[1] * binc[2] + k] = _ccv_nnc_cpu_opt_act((v - zero_point * wsum) * scale + (bias ? bias->data.f32[k] : 0), activation);
+			}
+		}
+	} parallel_endfor
+	_ccv_nnc_quantized_w_release(packed, is_packed);
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+static int _ccv_nnc_quantized_gemm_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size >= 2);
+	const ccv_nnc_tensor_view_t* a = (ccv_nnc_tensor_view_t*)inputs[0];
+	const ccv_nnc_tensor_t* w = inputs[1];
+	assert(!CCV_IS_TENSOR_VIEW(w));
+	const ccv_nnc_tensor_t* bias = input_size > 2 ? inputs[2] : 0;
+	assert(!bias || !CCV_IS_TENSOR_VIEW(bias));
+	assert(output_size == 1);
+	ccv_nnc_tensor_view_t* b = (ccv_nnc_tensor_view_t*)outputs[0];
+	if (a->info.datatype != CCV_8U || w->info.datatype != CCV_32F || b->info.datatype != CCV_32F || (bias && bias->info.datatype != CCV_32F))
+		return CCV_NNC_EXEC_INVALID;
+	const int a_nd = ccv_nnc_tensor_nd(a->info.dim);
+	assert(a_nd == 1 || a_nd == 2);
+	assert(ccv_nnc_tensor_nd(w->info.dim) == 2);
+	const int rows = a_nd == 1 ? 1 : a->info.dim[0];
+	const int channels = a->info.dim[a_nd - 1];
+	const int count = w->info.dim[0];
+	assert(w->info.dim[1] == channels);
+	const int a_rinc = (a_nd == 2 && CCV_IS_TENSOR_VIEW(a)) ? a->inc[1] : channels;
+	const int b_nd = ccv_nnc_tensor_nd(b->info.dim);
+	assert(b->info.dim[b_nd - 1] == count);
+	const int b_rinc = (b_nd == 2 && CCV_IS_TENSOR_VIEW(b)) ? b->inc[1] : count;
+	ccv_nnc_quantized_w_t qw;
+	int is_packed;
+	void* const packed = _ccv_nnc_quantized_w_retain(w, &qw, &is_packed);
+	if (!packed)
+		return CCV_NNC_EXEC_OOM;
+	const float a_scale = cmd.info.quant.scale;
+	const int zero_point = cmd.info.quant.zero_point;
+	const uint32_t activation = cmd.info.quant.activation;
+	const int cpu_features = ccv_nnc_cpu_features();
+	// With a single row (inference with batch size 1), split on the output channels instead.
+	const int row_parallel = rows > 1;
+	parallel_for(x, row_parallel ? rows : count) {
+		const int i_start = row_parallel ? x : 0;
+		const int i_end = row_parallel ? x + 1 : rows;
+		const int k_start = row_parallel ? 0 : x;
+		const int k_end = row_parallel ? count : x + 1;
+		int i, k;
+		for (i = i_start; i < i_end; i++)
+		{
+			const uint8_t* const ap = a->data.u8 + (size_t)i * a_rinc;
+			float* const bp = b->data.f32 + (size_t)i * b_rinc;
+			for (k = k_start; k < k_end; k++)
+			{
+				// For GEMM, kh = kw = 1, the sum is [0, sum(w)].
+				const int32_t v = _ccv_nnc_quantized_dot(cpu_features, ap, qw.w + (size_t)k * channels, channels) - zero_point * qw.sum[k * 2 + 1];
+				bp[k] = _ccv_nnc_cpu_opt_act(v * (a_scale * qw.scale[k]) + (bias ? bias->data.f32[k] : 0), activation);
+			}
+		}
+	} parallel_endfor
+	_ccv_nnc_quantized_w_release(packed, is_packed);
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_QUANTIZE_FORWARD, CCV_NNC_BACKEND_CPU_OPT)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW | CCV_TENSOR_FORMAT_CHWN;
+	registry->tensor_datatypes = CCV_32F | CCV_8U;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_quantize_forw;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_QUANTIZE_BACKWARD, CCV_NNC_BACKEND_CPU_OPT)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW | CCV_TENSOR_FORMAT_CHWN;
+	registry->tensor_datatypes = CCV_32F | CCV_8U;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_quantize_back;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_QUANTIZED_CONVOLUTION_FORWARD, CCV_NNC_BACKEND_CPU_OPT)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC;
+	registry->tensor_datatypes = CCV_32F | CCV_8U;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_quantized_conv_forw;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_QUANTIZED_GEMM_FORWARD, CCV_NNC_BACKEND_CPU_OPT)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW;
+	registry->tensor_datatypes = CCV_32F | CCV_8U;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_quantized_gemm_forw;
+}
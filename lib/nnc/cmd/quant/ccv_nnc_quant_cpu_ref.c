@@ -0,0 +1,227 @@
+#include "ccv.h"
+#include "ccv_internal.h"
+#include "nnc/ccv_nnc.h"
+#include "nnc/ccv_nnc_easy.h"
+#include "nnc/ccv_nnc_internal.h"
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+#ifdef USE_DISPATCH
+#include <dispatch/dispatch.h>
+#endif
+
+#include "_ccv_nnc_quant.h"
+
+// The reference implementation accumulates (q - zero_point) * w for each pair in 32-bit integers, which is the ground
+// truth of the CPU_OPT kernels that correct the zero point after the dot product instead.
+
+static float _ccv_nnc_quant_act(const float v, const uint32_t activation)
+{
+	switch (activation)
+	{
+		case CCV_NNC_RELU_FORWARD:
+			return ccv_max(v, 0);
+		case CCV_NNC_SIGMOID_FORWARD:
+			return 1. / (1. + expf(-v));
+		case CCV_NNC_SWISH_FORWARD:
+			return v / (1. + expf(-v));
+	}
+	return v;
+}
+
+static int _ccv_nnc_quantize_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size == 1);
+	assert(output_size == 1);
+	const ccv_nnc_tensor_t* const a = inputs[0];
+	ccv_nnc_tensor_t* const b = outputs[0];
+	assert(!CCV_IS_TENSOR_VIEW(a));
+	assert(!CCV_IS_TENSOR_VIEW(b));
+	assert(a->info.datatype == CCV_32F && b->info.datatype == CCV_8U);
+	const int count = ccv_nnc_tensor_count(a->info);
+	assert(count == ccv_nnc_tensor_count(b->info));
+	assert(cmd.info.quant.scale > 0);
+	const float inv_scale = 1. / cmd.info.quant.scale;
+	const int zero_point = cmd.info.quant.zero_point;
+	int i;
+	for (i = 0; i < count; i++)
+		b->data.u8[i] = _ccv_nnc_quantize_u8(a->data.f32[i], inv_scale, zero_point);
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+static int _ccv_nnc_quantize_back(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size >= 1);
+	assert(output_size == 1);
+	const ccv_nnc_tensor_t* const a = inputs[0];
+	ccv_nnc_tensor_t* const b = outputs[0];
+	assert(!CCV_IS_TENSOR_VIEW(a));
+	assert(!CCV_IS_TENSOR_VIEW(b));
+	assert(a->info.datatype == CCV_8U && b->info.datatype == CCV_32F);
+	const int count = ccv_nnc_tensor_count(a->info);
+	assert(count == ccv_nnc_tensor_count(b->info));
+	const float scale = cmd.info.quant.scale;
+	const int zero_point = cmd.info.quant.zero_point;
+	int i;
+	for (i = 0; i < count; i++)
+		b->data.f32[i] = (a->data.u8[i] - zero_point) * scale;
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+static int _ccv_nnc_quantized_conv_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size >= 2);
+	const ccv_nnc_tensor_view_t* a = (ccv_nnc_tensor_view_t*)inputs[0];
+	const ccv_nnc_tensor_t* w = inputs[1];
+	assert(!CCV_IS_TENSOR_VIEW(w));
+	const ccv_nnc_tensor_t* bias = input_size > 2 ? inputs[2] : 0;
+	assert(!bias || !CCV_IS_TENSOR_VIEW(bias));
+	assert(output_size == 1);
+	ccv_nnc_tensor_view_t* b = (ccv_nnc_tensor_view_t*)outputs[0];
+	assert(a->info.datatype == CCV_8U && w->info.datatype == CCV_32F && b->info.datatype == CCV_32F);
+	const int a_nd = ccv_nnc_tensor_nd(a->info.dim);
+	assert(a_nd == CCV_NNC_MAX_DIM + 1 || a_nd == CCV_NNC_MAX_DIM + 2);
+	const int* adim = (a_nd == CCV_NNC_MAX_DIM + 1) ? a->info.dim : a->info.dim + 1;
+	const int b_nd = ccv_nnc_tensor_nd(b->info.dim);
+	assert(b_nd == CCV_NNC_MAX_DIM + 1 || b_nd == CCV_NNC_MAX_DIM + 2);
+	const int* bdim = (b_nd == CCV_NNC_MAX_DIM + 1) ? b->info.dim : b->info.dim + 1;
+	const int count = cmd.info.quant.count;
+	assert(w->info.dim[0] == count);
+	assert(bdim[CCV_NNC_MAX_DIM] == count);
+	assert(w->info.dim[CCV_NNC_MAX_DIM + 1] == adim[CCV_NNC_MAX_DIM]);
+	assert(!bias || bias->info.dim[0] == count);
+	const int* ainc = CCV_IS_TENSOR_VIEW(a) ? ((a_nd == CCV_NNC_MAX_DIM + 1) ? a->inc : a->inc + 1) : adim;
+	const int* binc = CCV_IS_TENSOR_VIEW(b) ? ((b_nd == CCV_NNC_MAX_DIM + 1) ? b->inc : b->inc + 1) : bdim;
+	const int batch_size = (a_nd == CCV_NNC_MAX_DIM + 2) ? ccv_max(1, a->info.dim[0]) : 1;
+	assert(batch_size == ((b_nd == CCV_NNC_MAX_DIM + 2) ? ccv_max(1, b->info.dim[0]) : 1));
+	ccv_nnc_quantized_w_t qw = _ccv_nnc_quantized_w(w, 0);
+	void* const packed = ccmalloc(_ccv_nnc_quantized_w_size(qw));
+	_ccv_nnc_quantized_w_pack(w, packed, 0);
+	qw = _ccv_nnc_quantized_w(w, packed);
+	const int channel_size = qw.channels;
+	const float a_scale = cmd.info.quant.scale;
+	const int zero_point = cmd.info.quant.zero_point;
+	const uint32_t activation = cmd.info.quant.activation;
+	parallel_for(k, count) {
+		int c, bi;
+		const int8_t* const wp = qw.w + (size_t)k * qw.kh * qw.kw * channel_size;
+		const float biasval = bias ? bias->data.f32[k] : 0;
+		const float scale = a_scale * qw.scale[k];
+		int i[CCV_NNC_MAX_DIM];
+		int n[CCV_NNC_MAX_DIM];
+		int m[CCV_NNC_MAX_DIM];
+		int j[CCV_NNC_MAX_DIM];
+		for (bi = 0; bi < batch_size; bi++)
+		{
+			const uint8_t* const ap = a->data.u8 + (size_t)bi * ainc[0] * ainc[1] * ainc[2];
+			float* const bp = b->data.f32 + (size_t)bi * binc[0] * binc[1] * binc[2] + k;
+			for (i[0] = 0; i[0] < bdim[0]; i[0]++)
+			{
+				SET_BORDER_OFFSET_SIZE_FOR(0, i, hint, w->info.dim + 1, adim, n, m);
+				const int8_t* const wpu = wp + n[0] * qw.kw * channel_size;
+				const uint8_t* const apu = ap + (size_t)ccv_max(i[0] * hint.stride.dim[0] - hint.border.begin[0], 0) * ainc[1] * ainc[2];
+				for (i[1] = 0; i[1] < bdim[1]; i[1]++)
+				{
+					SET_BORDER_OFFSET_SIZE_FOR(1, i, hint, w->info.dim + 1, adim, n, m);
+					int32_t p = 0;
+					const int8_t* wpz = wpu + n[1] * channel_size;
+					const uint8_t* apz = apu + ccv_max(i[1] * hint.stride.dim[1] - hint.border.begin[1], 0) * ainc[2];
+					for (j[0] = 0; j[0] < m[0]; j[0]++)
+					{
+						for (j[1] = 0; j[1] < m[1]; j[1]++)
+							for (c = 0; c < channel_size; c++)
+								p += (apz[j[1] * ainc[2] + c] - zero_point) * wpz[j[1] * channel_size + c];
+						wpz += qw.kw * channel_size;
+						apz += ainc[1] * ainc[2];
+					}
+					bp[((size_t)i[0] * binc[1] + i[1]) * binc[2]] = _ccv_nnc_quant_act(p * scale + biasval, activation);
+				}
+			}
+		}
+	} parallel_endfor
+	ccfree(packed);
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+static int _ccv_nnc_quantized_gemm_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size >= 2);
+	const ccv_nnc_tensor_view_t* a = (ccv_nnc_tensor_view_t*)inputs[0];
+	const ccv_nnc_tensor_t* w = inputs[1];
+	assert(!CCV_IS_TENSOR_VIEW(w));
+	const ccv_nnc_tensor_t* bias = input_size > 2 ? inputs[2] : 0;
+	assert(!bias || !CCV_IS_TENSOR_VIEW(bias));
+	assert(output_size == 1);
+	ccv_nnc_tensor_view_t* b = (ccv_nnc_tensor_view_t*)outputs[0];
+	assert(a->info.datatype == CCV_8U && w->info.datatype == CCV_32F && b->info.datatype == CCV_32F);
+	const int a_nd = ccv_nnc_tensor_nd(a->info.dim);
+	assert(a_nd == 1 || a_nd == 2);
+	assert(ccv_nnc_tensor_nd(w->info.dim) == 2);
+	const int rows = a_nd == 1 ? 1 : a->info.dim[0];
+	const int channels = a->info.dim[a_nd - 1];
+	const int count = w->info.dim[0];
+	assert(w->info.dim[1] == channels);
+	assert(!bias || bias->info.dim[0] == count);
+	const int a_rinc = (a_nd == 2 && CCV_IS_TENSOR_VIEW(a)) ? a->inc[1] : channels;
+	const int b_nd = ccv_nnc_tensor_nd(b->info.dim);
+	assert(b->info.dim[b_nd - 1] == count);
+	const int b_rinc = (b_nd == 2 && CCV_IS_TENSOR_VIEW(b)) ? b->inc[1] : count;
+	ccv_nnc_quantized_w_t qw = _ccv_nnc_quantized_w(w, 0);
+	void* const packed = ccmalloc(_ccv_nnc_quantized_w_size(qw));
+	_ccv_nnc_quantized_w_pack(w, packed, 0);
+	qw = _ccv_nnc_quantized_w(w, packed);
+	const float a_scale = cmd.info.quant.scale;
+	const int zero_point = cmd.info.quant.zero_point;
+	const uint32_t activation = cmd.info.quant.activation;
+	parallel_for(i, rows) {
+		int j, k;
+		const uint8_t* const ap = a->data.u8 + (size_t)i * a_rinc;
+		float* const bp = b->data.f32 + (size_t)i * b_rinc;
+		for (k = 0; k < count; k++)
+		{
+			const int8_t* const wp = qw.w + (size_t)k * channels;
+			int32_t p = 0;
+			for (j = 0; j < channels; j++)
+				p += (ap[j] - zero_point) * wp[j];
+			bp[k] = _ccv_nnc_quant_act(p * (a_scale * qw.scale[k]) + (bias ? bias->data.f32[k] : 0), activation);
+		}
+	} parallel_endfor
+	ccfree(packed);
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_QUANTIZE_FORWARD, CCV_NNC_BACKEND_CPU_REF)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW | CCV_TENSOR_FORMAT_CHWN;
+	registry->tensor_datatypes = CCV_32F | CCV_8U;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_quantize_forw;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_QUANTIZE_BACKWARD, CCV_NNC_BACKEND_CPU_REF)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW | CCV_TENSOR_FORMAT_CHWN;
+	registry->tensor_datatypes = CCV_32F | CCV_8U;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_quantize_back;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_QUANTIZED_CONVOLUTION_FORWARD, CCV_NNC_BACKEND_CPU_REF)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC;
+	registry->tensor_datatypes = CCV_32F | CCV_8U;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_quantized_conv_forw;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_QUANTIZED_GEMM_FORWARD, CCV_NNC_BACKEND_CPU_REF)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW;
+	registry->tensor_datatypes = CCV_32F | CCV_8U;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_quantized_gemm_forw;
+}
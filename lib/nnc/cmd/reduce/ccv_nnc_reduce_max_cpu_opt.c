@@ -0,0 +1,100 @@
+#include "ccv.h"
+#include "ccv_internal.h"
+#include "nnc/ccv_nnc.h"
+#include "nnc/ccv_nnc_easy.h"
+#include "nnc/ccv_nnc_internal.h"
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+#ifdef USE_DISPATCH
+#include <dispatch/dispatch.h>
+#endif
+
+#include "../_ccv_nnc_cpu_opt.h"
+
+// Number of kept inner elements each task handles.
+#define CCV_NNC_REDUCE_INNER_BLOCK (256)
+
+static void _ccv_nnc_reduce_max_slice(const float* const ap, float* const bp, const int mid, const int inner, const int start, const int end)
+{
+	int j, x;
+	if (inner == 1)
+	{
+		// Reduce along the contiguous axis.
+		float v = ap[0];
+		x = 1;
+#if defined(HAVE_SSE2)
+		if (mid >= 4)
+		{
+			__m128 v4 = _mm_loadu_ps(ap);
+			for (x = 4; x < mid - 3; x += 4)
+				v4 = _mm_max_ps(v4, _mm_loadu_ps(ap + x));
+			v = _ccv_nnc_hmax_ps_sse2(v4);
+		}
+#elif defined(HAVE_NEON)
+		if (mid >= 4)
+		{
+			float32x4_t v4 = vld1q_f32(ap);
+			for (x = 4; x < mid - 3; x += 4)
+				v4 = vmaxq_f32(v4, vld1q_f32(ap + x));
+			v = _ccv_nnc_hmax_ps_neon(v4);
+		}
+#endif
+		for (; x < mid; x++)
+			if (ap[x] > v)
+				v = ap[x];
+		bp[0] = v;
+		return;
+	}
+	for (x = start; x < end; x++)
+		bp[x] = ap[x];
+	for (j = 1; j < mid; j++)
+	{
+		const float* const apj = ap + j * inner;
+		x = start;
+#if defined(HAVE_SSE2)
+		for (; x < end - 3; x += 4)
+			_mm_storeu_ps(bp + x, _mm_max_ps(_mm_loadu_ps(bp + x), _mm_loadu_ps(apj + x)));
+#elif defined(HAVE_NEON)
+		for (; x < end - 3; x += 4)
+			vst1q_f32(bp + x, vmaxq_f32(vld1q_f32(bp + x), vld1q_f32(apj + x)));
+#endif
+		for (; x < end; x++)
+			if (apj[x] > bp[x])
+				bp[x] = apj[x];
+	}
+}
+
+static int _ccv_nnc_reduce_max_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size == 1);
+	ccv_nnc_tensor_view_t* const a = (ccv_nnc_tensor_view_t*)inputs[0];
+	ccv_nnc_tensor_view_t* const b = (ccv_nnc_tensor_view_t*)outputs[0];
+	if (a->info.dim[CCV_NNC_MAX_DIM + 2] != 0 || b->info.dim[CCV_NNC_MAX_DIM + 2] != 0)
+		return CCV_NNC_EXEC_INVALID;
+	int adim[CCV_NNC_MAX_DIM_ALLOC];
+	int bdim[CCV_NNC_MAX_DIM_ALLOC];
+	ccv_nnc_tensor_view_get_dim(a, adim);
+	ccv_nnc_tensor_view_get_dim(b, bdim);
+	assert(ccv_nnc_tensor_view_check_broadcast_dim(b, adim));
+	int outer, mid, inner;
+	// Only the layout of kept axes, followed by reduced axes, followed by kept axes, can be done in one pass.
+	if (CCV_IS_TENSOR_VIEW(a) || CCV_IS_TENSOR_VIEW(b) || !_ccv_nnc_cpu_opt_fold_dim(adim, bdim, 0, &outer, &mid, &inner))
+		return CCV_NNC_EXEC_INVALID;
+	const int inner_block_count = (inner + CCV_NNC_REDUCE_INNER_BLOCK - 1) / CCV_NNC_REDUCE_INNER_BLOCK;
+	parallel_for(i, outer * inner_block_count) {
+		const int o = i / inner_block_count;
+		const int s = (i % inner_block_count) * CCV_NNC_REDUCE_INNER_BLOCK;
+		_ccv_nnc_reduce_max_slice(a->data.f32 + o * mid * inner, b->data.f32 + o * inner, mid, inner, s, ccv_min(s + CCV_NNC_REDUCE_INNER_BLOCK, inner));
+	} parallel_endfor
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_REDUCE_MAX_FORWARD, CCV_NNC_BACKEND_CPU_OPT)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW | CCV_TENSOR_FORMAT_CHWN;
+	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_reduce_max_forw;
+}
@@ -0,0 +1,99 @@
+#include "ccv.h"
+#include "ccv_internal.h"
+#include "nnc/ccv_nnc.h"
+#include "nnc/ccv_nnc_easy.h"
+#include "nnc/ccv_nnc_internal.h"
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+#ifdef USE_DISPATCH
+#include <dispatch/dispatch.h>
+#endif
+
+#include "../_ccv_nnc_cpu_opt.h"
+
+static void _ccv_nnc_relu_forw_block(const float* const ap, float* const bp, const int start, const int end)
+{
+	int x = start;
+#if defined(HAVE_SSE2)
+	const __m128 z4 = _mm_setzero_ps();
+	for (; x < end - 3; x += 4)
+		_mm_storeu_ps(bp + x, _mm_max_ps(_mm_loadu_ps(ap + x), z4));
+#elif defined(HAVE_NEON)
+	const float32x4_t z4 = vdupq_n_f32(0);
+	for (; x < end - 3; x += 4)
+		vst1q_f32(bp + x, vmaxq_f32(vld1q_f32(ap + x), z4));
+#endif
+	for (; x < end; x++)
+		bp[x] = ccv_max(ap[x], 0);
+}
+
+static int _ccv_nnc_relu_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size == 1);
+	const ccv_nnc_tensor_t* a = inputs[0];
+	assert(output_size == 1);
+	ccv_nnc_tensor_t* b = outputs[0];
+	if (CCV_IS_TENSOR_VIEW(a) || CCV_IS_TENSOR_VIEW(b))
+		return CCV_NNC_EXEC_INVALID;
+	const int count = ccv_nnc_tensor_count(a->info);
+	assert(count == ccv_nnc_tensor_count(b->info));
+	const int block_count = (count + CCV_NNC_CPU_OPT_EW_BLOCK - 1) / CCV_NNC_CPU_OPT_EW_BLOCK;
+	parallel_for(i, block_count) {
+		_ccv_nnc_relu_forw_block(a->data.f32, b->data.f32, i * CCV_NNC_CPU_OPT_EW_BLOCK, ccv_min((i + 1) * CCV_NNC_CPU_OPT_EW_BLOCK, count));
+	} parallel_endfor
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+static void _ccv_nnc_relu_back_block(const float* const gp, const float* const bp, float* const hp, const int start, const int end)
+{
+	int x = start;
+#if defined(HAVE_SSE2)
+	const __m128 z4 = _mm_setzero_ps();
+	for (; x < end - 3; x += 4)
+		_mm_storeu_ps(hp + x, _mm_and_ps(_mm_cmpgt_ps(_mm_loadu_ps(bp + x), z4), _mm_loadu_ps(gp + x)));
+#elif defined(HAVE_NEON)
+	const float32x4_t z4 = vdupq_n_f32(0);
+	for (; x < end - 3; x += 4)
+		vst1q_f32(hp + x, vreinterpretq_f32_u32(vandq_u32(vcgtq_f32(vld1q_f32(bp + x), z4), vreinterpretq_u32_f32(vld1q_f32(gp + x)))));
+#endif
+	for (; x < end; x++)
+		hp[x] = (bp[x] > 0) ? gp[x] : 0;
+}
+
+static int _ccv_nnc_relu_back(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size == 3);
+	const ccv_nnc_tensor_t* g = inputs[0]; // gradient
+	const ccv_nnc_tensor_t* b = inputs[2];
+	assert(output_size == 1);
+	ccv_nnc_tensor_t* h = outputs[0];
+	if (CCV_IS_TENSOR_VIEW(g) || CCV_IS_TENSOR_VIEW(b) || CCV_IS_TENSOR_VIEW(h))
+		return CCV_NNC_EXEC_INVALID;
+	const int count = ccv_nnc_tensor_count(g->info);
+	assert(count == ccv_nnc_tensor_count(b->info));
+	assert(count == ccv_nnc_tensor_count(h->info));
+	const int block_count = (count + CCV_NNC_CPU_OPT_EW_BLOCK - 1) / CCV_NNC_CPU_OPT_EW_BLOCK;
+	parallel_for(i, block_count) {
+		_ccv_nnc_relu_back_block(g->data.f32, b->data.f32, h->data.f32, i * CCV_NNC_CPU_OPT_EW_BLOCK, ccv_min((i + 1) * CCV_NNC_CPU_OPT_EW_BLOCK, count));
+	} parallel_endfor
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_RELU_FORWARD, CCV_NNC_BACKEND_CPU_OPT)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW | CCV_TENSOR_FORMAT_CHWN;
+	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_relu_forw;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_RELU_BACKWARD, CCV_NNC_BACKEND_CPU_OPT)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW | CCV_TENSOR_FORMAT_CHWN;
+	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_relu_back;
+}
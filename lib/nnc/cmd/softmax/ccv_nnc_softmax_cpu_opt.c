@@ -0,0 +1,168 @@
+#include "ccv.h"
+#include "ccv_internal.h"
+#include "nnc/ccv_nnc.h"
+#include "nnc/ccv_nnc_easy.h"
+#include "nnc/ccv_nnc_internal.h"
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+#ifdef USE_DISPATCH
+#include <dispatch/dispatch.h>
+#endif
+
+#include "../_ccv_nnc_cpu_opt.h"
+
+static void _ccv_nnc_softmax_forw_row(const float* const ap, float* const bp, const int count)
+{
+	int j = 0;
+	float maxval = ap[0];
+	float sumval = 0;
+#if defined(HAVE_SSE2)
+	if (count >= 4)
+	{
+		__m128 max4 = _mm_loadu_ps(ap);
+		for (j = 4; j < count - 3; j += 4)
+			max4 = _mm_max_ps(max4, _mm_loadu_ps(ap + j));
+		maxval = _ccv_nnc_hmax_ps_sse2(max4);
+	}
+	for (; j < count; j++)
+		if (ap[j] > maxval)
+			maxval = ap[j];
+	const __m128 maxval4 = _mm_set1_ps(maxval);
+	__m128 sum4 = _mm_setzero_ps();
+	for (j = 0; j < count - 3; j += 4)
+	{
+		const __m128 b4 = _ccv_nnc_exp_ps_sse2(_mm_sub_ps(_mm_loadu_ps(ap + j), maxval4));
+		sum4 = _mm_add_ps(sum4, b4);
+		_mm_storeu_ps(bp + j, b4);
+	}
+	sumval = _ccv_nnc_hsum_ps_sse2(sum4);
+#elif defined(HAVE_NEON)
+	if (count >= 4)
+	{
+		float32x4_t max4 = vld1q_f32(ap);
+		for (j = 4; j < count - 3; j += 4)
+			max4 = vmaxq_f32(max4, vld1q_f32(ap + j));
+		maxval = _ccv_nnc_hmax_ps_neon(max4);
+	}
+	for (; j < count; j++)
+		if (ap[j] > maxval)
+			maxval = ap[j];
+	const float32x4_t maxval4 = vdupq_n_f32(maxval);
+	float32x4_t sum4 = vdupq_n_f32(0);
+	for (j = 0; j < count - 3; j += 4)
+	{
+		const float32x4_t b4 = _ccv_nnc_exp_ps_neon(vsubq_f32(vld1q_f32(ap + j), maxval4));
+		sum4 = vaddq_f32(sum4, b4);
+		vst1q_f32(bp + j, b4);
+	}
+	sumval = _ccv_nnc_hsum_ps_neon(sum4);
+#else
+	for (j = 1; j < count; j++)
+		if (ap[j] > maxval)
+			maxval = ap[j];
+	j = 0;
+#endif
+	for (; j < count; j++)
+		sumval += (bp[j] = expf(ap[j] - maxval));
+	const float inv_sum = 1.0 / sumval;
+	j = 0;
+#if defined(HAVE_SSE2)
+	const __m128 inv_sum4 = _mm_set1_ps(inv_sum);
+	for (; j < count - 3; j += 4)
+		_mm_storeu_ps(bp + j, _mm_mul_ps(_mm_loadu_ps(bp + j), inv_sum4));
+#elif defined(HAVE_NEON)
+	const float32x4_t inv_sum4 = vdupq_n_f32(inv_sum);
+	for (; j < count - 3; j += 4)
+		vst1q_f32(bp + j, vmulq_f32(vld1q_f32(bp + j), inv_sum4));
+#endif
+	for (; j < count; j++)
+		bp[j] *= inv_sum;
+}
+
+static int _ccv_nnc_softmax_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size == 1);
+	const ccv_nnc_tensor_t* a = inputs[0];
+	assert(output_size == 1);
+	ccv_nnc_tensor_t* b = outputs[0];
+	if (CCV_IS_TENSOR_VIEW(a) || CCV_IS_TENSOR_VIEW(b))
+		return CCV_NNC_EXEC_INVALID;
+	const int axis_count = ccv_nnc_tensor_nd(a->info.dim);
+	const int batch_size = axis_count < 2 ? 1 : a->info.dim[0];
+	const int count = ccv_nnc_tensor_count(a->info) / batch_size;
+	assert(ccv_nnc_tensor_count(b->info) == count * batch_size);
+	parallel_for(i, batch_size) {
+		_ccv_nnc_softmax_forw_row(a->data.f32 + i * count, b->data.f32 + i * count, count);
+	} parallel_endfor
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+static void _ccv_nnc_softmax_back_row(const float* const gp, const float* const bp, float* const hp, const int count)
+{
+	int j = 0;
+	float sumval = 0;
+#if defined(HAVE_SSE2)
+	__m128 sum4 = _mm_setzero_ps();
+	for (; j < count - 3; j += 4)
+		sum4 = _mm_add_ps(sum4, _mm_mul_ps(_mm_loadu_ps(gp + j), _mm_loadu_ps(bp + j)));
+	sumval = _ccv_nnc_hsum_ps_sse2(sum4);
+#elif defined(HAVE_NEON)
+	float32x4_t sum4 = vdupq_n_f32(0);
+	for (; j < count - 3; j += 4)
+		sum4 = vmlaq_f32(sum4, vld1q_f32(gp + j), vld1q_f32(bp + j));
+	sumval = _ccv_nnc_hsum_ps_neon(sum4);
+#endif
+	for (; j < count; j++)
+		sumval += gp[j] * bp[j];
+	j = 0;
+#if defined(HAVE_SSE2)
+	const __m128 sumval4 = _mm_set1_ps(sumval);
+	for (; j < count - 3; j += 4)
+		_mm_storeu_ps(hp + j, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(gp + j), sumval4), _mm_loadu_ps(bp + j)));
+#elif defined(HAVE_NEON)
+	const float32x4_t sumval4 = vdupq_n_f32(sumval);
+	for (; j < count - 3; j += 4)
+		vst1q_f32(hp + j, vmulq_f32(vsubq_f32(vld1q_f32(gp + j), sumval4), vld1q_f32(bp + j)));
+#endif
+	for (; j < count; j++)
+		hp[j] = (gp[j] - sumval) * bp[j];
+}
+
+static int _ccv_nnc_softmax_back(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size == 3);
+	assert(output_size == 1);
+	const ccv_nnc_tensor_t* g = inputs[0];
+	const ccv_nnc_tensor_t* b = inputs[2];
+	ccv_nnc_tensor_t* h = outputs[0];
+	if (CCV_IS_TENSOR_VIEW(g) || CCV_IS_TENSOR_VIEW(b) || CCV_IS_TENSOR_VIEW(h))
+		return CCV_NNC_EXEC_INVALID;
+	const int axis_count = ccv_nnc_tensor_nd(g->info.dim);
+	const int batch_size = axis_count < 2 ? 1 : g->info.dim[0];
+	const int count = ccv_nnc_tensor_count(g->info) / batch_size;
+	assert(ccv_nnc_tensor_count(b->info) == count * batch_size);
+	assert(ccv_nnc_tensor_count(h->info) == count * batch_size);
+	parallel_for(i, batch_size) {
+		_ccv_nnc_softmax_back_row(g->data.f32 + i * count, b->data.f32 + i * count, h->data.f32 + i * count, count);
+	} parallel_endfor
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_SOFTMAX_FORWARD, CCV_NNC_BACKEND_CPU_OPT)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW;
+	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_softmax_forw;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_SOFTMAX_BACKWARD, CCV_NNC_BACKEND_CPU_OPT)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW;
+	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_softmax_back;
+}
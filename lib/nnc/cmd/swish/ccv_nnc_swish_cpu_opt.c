@@ -0,0 +1,121 @@
+#include "ccv.h"
+#include "ccv_internal.h"
+#include "nnc/ccv_nnc.h"
+#include "nnc/ccv_nnc_easy.h"
+#include "nnc/ccv_nnc_internal.h"
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+#ifdef USE_DISPATCH
+#include <dispatch/dispatch.h>
+#endif
+
+#include "../_ccv_nnc_cpu_opt.h"
+
+static void _ccv_nnc_swish_forw_block(const float* const ap, float* const bp, const int start, const int end)
+{
+	int x = start;
+#if defined(HAVE_SSE2)
+	const __m128 one4 = _mm_set1_ps(1);
+	const __m128 z4 = _mm_setzero_ps();
+	for (; x < end - 3; x += 4)
+	{
+		const __m128 a4 = _mm_loadu_ps(ap + x);
+		_mm_storeu_ps(bp + x, _mm_div_ps(a4, _mm_add_ps(one4, _ccv_nnc_exp_ps_sse2(_mm_sub_ps(z4, a4)))));
+	}
+#elif defined(HAVE_NEON)
+	const float32x4_t one4 = vdupq_n_f32(1);
+	for (; x < end - 3; x += 4)
+	{
+		const float32x4_t a4 = vld1q_f32(ap + x);
+		vst1q_f32(bp + x, vmulq_f32(a4, _ccv_nnc_recip_ps_neon(vaddq_f32(one4, _ccv_nnc_exp_ps_neon(vnegq_f32(a4))))));
+	}
+#endif
+	for (; x < end; x++)
+		bp[x] = ap[x] / (1. + expf(-ap[x]));
+}
+
+static int _ccv_nnc_swish_forw(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size == 1);
+	const ccv_nnc_tensor_t* a = inputs[0];
+	assert(output_size == 1);
+	ccv_nnc_tensor_t* b = outputs[0];
+	if (CCV_IS_TENSOR_VIEW(a) || CCV_IS_TENSOR_VIEW(b))
+		return CCV_NNC_EXEC_INVALID;
+	const int count = ccv_nnc_tensor_count(a->info);
+	assert(count == ccv_nnc_tensor_count(b->info));
+	const int block_count = (count + CCV_NNC_CPU_OPT_EW_BLOCK - 1) / CCV_NNC_CPU_OPT_EW_BLOCK;
+	parallel_for(i, block_count) {
+		_ccv_nnc_swish_forw_block(a->data.f32, b->data.f32, i * CCV_NNC_CPU_OPT_EW_BLOCK, ccv_min((i + 1) * CCV_NNC_CPU_OPT_EW_BLOCK, count));
+	} parallel_endfor
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+static void _ccv_nnc_swish_back_block(const float* const gp, const float* const ap, float* const hp, const int start, const int end)
+{
+	int x = start;
+	// See the reference implementation, the derivative is x * (y - y^2) + y where y = sigmoid(x).
+#if defined(HAVE_SSE2)
+	const __m128 one4 = _mm_set1_ps(1);
+	const __m128 z4 = _mm_setzero_ps();
+	for (; x < end - 3; x += 4)
+	{
+		const __m128 a4 = _mm_loadu_ps(ap + x);
+		const __m128 y4 = _mm_div_ps(one4, _mm_add_ps(one4, _ccv_nnc_exp_ps_sse2(_mm_sub_ps(z4, a4))));
+		const __m128 d4 = _mm_add_ps(_mm_mul_ps(a4, _mm_sub_ps(y4, _mm_mul_ps(y4, y4))), y4);
+		_mm_storeu_ps(hp + x, _mm_mul_ps(_mm_loadu_ps(gp + x), d4));
+	}
+#elif defined(HAVE_NEON)
+	const float32x4_t one4 = vdupq_n_f32(1);
+	for (; x < end - 3; x += 4)
+	{
+		const float32x4_t a4 = vld1q_f32(ap + x);
+		const float32x4_t y4 = _ccv_nnc_recip_ps_neon(vaddq_f32(one4, _ccv_nnc_exp_ps_neon(vnegq_f32(a4))));
+		const float32x4_t d4 = vmlaq_f32(y4, a4, vsubq_f32(y4, vmulq_f32(y4, y4)));
+		vst1q_f32(hp + x, vmulq_f32(vld1q_f32(gp + x), d4));
+	}
+#endif
+	for (; x < end; x++)
+	{
+		const float y = 1. / (1. + expf(-ap[x]));
+		hp[x] = gp[x] * (ap[x] * (y - y * y) + y);
+	}
+}
+
+static int _ccv_nnc_swish_back(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	assert(input_size == 3);
+	const ccv_nnc_tensor_t* g = inputs[0]; // gradient
+	const ccv_nnc_tensor_t* a = inputs[1];
+	assert(output_size == 1);
+	ccv_nnc_tensor_t* h = outputs[0];
+	if (CCV_IS_TENSOR_VIEW(g) || CCV_IS_TENSOR_VIEW(a) || CCV_IS_TENSOR_VIEW(h))
+		return CCV_NNC_EXEC_INVALID;
+	const int count = ccv_nnc_tensor_count(g->info);
+	assert(count == ccv_nnc_tensor_count(a->info));
+	assert(count == ccv_nnc_tensor_count(h->info));
+	const int block_count = (count + CCV_NNC_CPU_OPT_EW_BLOCK - 1) / CCV_NNC_CPU_OPT_EW_BLOCK;
+	parallel_for(i, block_count) {
+		_ccv_nnc_swish_back_block(g->data.f32, a->data.f32, h->data.f32, i * CCV_NNC_CPU_OPT_EW_BLOCK, ccv_min((i + 1) * CCV_NNC_CPU_OPT_EW_BLOCK, count));
+	} parallel_endfor
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_SWISH_FORWARD, CCV_NNC_BACKEND_CPU_OPT)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW | CCV_TENSOR_FORMAT_CHWN;
+	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_swish_forw;
+}
+
+REGISTER_COMMAND_BACKEND(CCV_NNC_SWISH_BACKWARD, CCV_NNC_BACKEND_CPU_OPT)(ccv_nnc_cmd_backend_registry_t* const registry)
+{
+	registry->tensor_formats = CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_NCHW | CCV_TENSOR_FORMAT_CHWN;
+	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
+	registry->algorithms = 1;
+	registry->exec = _ccv_nnc_swish_back;
+}
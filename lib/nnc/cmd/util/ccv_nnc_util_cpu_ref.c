@@ -13,12 +13,13 @@
 
 void _ccv_nnc_tensor_transfer_cpu_ref(const ccv_nnc_tensor_view_t* const a, ccv_nnc_tensor_view_t* const b)
 {
-	// Assuming this is float 32.
 	assert(a->info.datatype == b->info.datatype);
+	// The transfer is a plain copy, only the element size matters.
+	const size_t data_size = CCV_GET_DATA_TYPE_SIZE(a->info.datatype);
 	if (!CCV_IS_TENSOR_VIEW(a) && !CCV_IS_TENSOR_VIEW(b))
 	{
 		// Super optimal case, just do memcpy.
-		memcpy(b->data.u8, a->data.u8, ccv_nnc_tensor_count(a->info) * CCV_GET_DATA_TYPE_SIZE(a->info.datatype));
+		memcpy(b->data.u8, a->data.u8, ccv_nnc_tensor_count(a->info) * data_size);
 		return;
 	}
 	int dim[CCV_NNC_MAX_DIM_ALLOC];
@@ -30,8 +31,8 @@ void _ccv_nnc_tensor_transfer_cpu_ref(const ccv_nnc_tensor_view_t* const a, ccv_
 	ccv_nnc_tensor_view_get_inc(b, binc);
 	assert(CCV_NNC_MAX_DIM == 2); // Need to change this logic for CCV_NNC_MAX_DIM == other number.
 	int i[CCV_NNC_MAX_DIM + 2];
-	float* ap = a->data.f32;
-	float* bp = b->data.f32;
+	unsigned char* ap = a->data.u8;
+	unsigned char* bp = b->data.u8;
 	if (ainc[3] == dim[3] && binc[3] == dim[3])
 	{
 		// Special casing if the ainc[3] is the same as dim[3] (do memcpy for the last two dim)
@@ -39,12 +40,12 @@ void _ccv_nnc_tensor_transfer_cpu_ref(const ccv_nnc_tensor_view_t* const a, ccv_
 		{
 			for (i[1] = 0; i[1] < dim[1]; i[1]++)
 			{
-				memcpy(bp, ap, dim[2] * dim[3] * sizeof(float));
-				ap += ainc[2] * ainc[3];
-				bp += binc[2] * binc[3];
+				memcpy(bp, ap, dim[2] * dim[3] * data_size);
+				ap += ainc[2] * ainc[3] * data_size;
+				bp += binc[2] * binc[3] * data_size;
 			}
-			ap += (ainc[1] - dim[1]) * ainc[2] * ainc[3];
-			bp += (binc[1] - dim[1]) * binc[2] * binc[3];
+			ap += ((ainc[1] - dim[1]) * ainc[2] * ainc[3]) * data_size;
+			bp += ((binc[1] - dim[1]) * binc[2] * binc[3]) * data_size;
 		}
 		return;
 	}
@@ -55,15 +56,15 @@ void _ccv_nnc_tensor_transfer_cpu_ref(const ccv_nnc_tensor_view_t* const a, ccv_
 		{
 			for (i[2] = 0; i[2] < dim[2]; i[2]++)
 			{
-				memcpy(bp, ap, dim[3] * sizeof(float));
-				ap += ainc[3];
-				bp += binc[3];
+				memcpy(bp, ap, dim[3] * data_size);
+				ap += ainc[3] * data_size;
+				bp += binc[3] * data_size;
 			}
-			ap += (ainc[2] - dim[2]) * ainc[3];
-			bp += (binc[2] - dim[2]) * binc[3];
+			ap += ((ainc[2] - dim[2]) * ainc[3]) * data_size;
+			bp += ((binc[2] - dim[2]) * binc[3]) * data_size;
 		}
-		ap += (ainc[1] - dim[1]) * ainc[2] * ainc[3];
-		bp += (binc[1] - dim[1]) * binc[2] * binc[3];
+		ap += ((ainc[1] - dim[1]) * ainc[2] * ainc[3]) * data_size;
+		bp += ((binc[1] - dim[1]) * binc[2] * binc[3]) * data_size;
 	}
 }
 
@@ -135,7 +136,7 @@ static int _ccv_nnc_data_transfer(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t
 REGISTER_COMMAND_BACKEND(CCV_NNC_DATA_TRANSFER_FORWARD, CCV_NNC_BACKEND_CPU_REF)(ccv_nnc_cmd_backend_registry_t* const registry)
 {
 	registry->tensor_formats = CCV_TENSOR_FORMAT_NCHW | CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_CHWN;
-	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_datatypes = CCV_32F | CCV_32S | CCV_16F | CCV_16BF | CCV_8U;
 	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
 	registry->algorithms = 1;
 	registry->exec = _ccv_nnc_data_transfer;
@@ -144,7 +145,7 @@ REGISTER_COMMAND_BACKEND(CCV_NNC_DATA_TRANSFER_FORWARD, CCV_NNC_BACKEND_CPU_REF)
 REGISTER_COMMAND_BACKEND(CCV_NNC_DATA_TRANSFER_BACKWARD, CCV_NNC_BACKEND_CPU_REF)(ccv_nnc_cmd_backend_registry_t* const registry)
 {
 	registry->tensor_formats = CCV_TENSOR_FORMAT_NCHW | CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_CHWN;
-	registry->tensor_datatypes = CCV_32F;
+	registry->tensor_datatypes = CCV_32F | CCV_32S | CCV_16F | CCV_16BF | CCV_8U;
 	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
 	registry->algorithms = 1;
 	registry->exec = _ccv_nnc_data_transfer;
@@ -442,6 +443,18 @@ static int _ccv_nnc_datatype_conversion(const ccv_nnc_cmd_t cmd, const ccv_nnc_h
 			const int tensor_count = ccv_nnc_tensor_count(a->info);
 			assert(tensor_count == ccv_nnc_tensor_count(b->info));
 			ccv_half_precision_to_float((uint16_t*)a->data.f16, b->data.f32, tensor_count);
+		} else if (a->info.datatype == CCV_32F && b->info.datatype == CCV_16BF) {
+			assert(!CCV_IS_TENSOR_VIEW(a));
+			assert(!CCV_IS_TENSOR_VIEW(b));
+			const size_t tensor_count = ccv_nnc_tensor_count(a->info);
+			assert(tensor_count == ccv_nnc_tensor_count(b->info));
+			ccv_float_to_bfloat(a->data.f32, (uint16_t*)b->data.u8, tensor_count);
+		} else if (a->info.datatype == CCV_16BF && b->info.datatype == CCV_32F) {
+			assert(!CCV_IS_TENSOR_VIEW(a));
+			assert(!CCV_IS_TENSOR_VIEW(b));
+			const size_t tensor_count = ccv_nnc_tensor_count(a->info);
+			assert(tensor_count == ccv_nnc_tensor_count(b->info));
+			ccv_bfloat_to_float((uint16_t*)a->data.u8, b->data.f32, tensor_count);
 		}
 	}
 	return CCV_NNC_EXEC_SUCCESS;
@@ -450,7 +463,7 @@ static int _ccv_nnc_datatype_conversion(const ccv_nnc_cmd_t cmd, const ccv_nnc_h
 REGISTER_COMMAND_BACKEND(CCV_NNC_DATATYPE_CONVERSION_FORWARD, CCV_NNC_BACKEND_CPU_REF)(ccv_nnc_cmd_backend_registry_t* const registry)
 {
 	registry->tensor_formats = CCV_TENSOR_FORMAT_NCHW | CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_CHWN;
-	registry->tensor_datatypes = CCV_32F | CCV_16F;
+	registry->tensor_datatypes = CCV_32F | CCV_16F | CCV_16BF;
 	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
 	registry->algorithms = 1;
 	registry->exec = _ccv_nnc_datatype_conversion;
@@ -459,7 +472,7 @@ REGISTER_COMMAND_BACKEND(CCV_NNC_DATATYPE_CONVERSION_FORWARD, CCV_NNC_BACKEND_CP
 REGISTER_COMMAND_BACKEND(CCV_NNC_DATATYPE_CONVERSION_BACKWARD, CCV_NNC_BACKEND_CPU_REF)(ccv_nnc_cmd_backend_registry_t* const registry)
 {
 	registry->tensor_formats = CCV_TENSOR_FORMAT_NCHW | CCV_TENSOR_FORMAT_NHWC | CCV_TENSOR_FORMAT_CHWN;
-	registry->tensor_datatypes = CCV_32F | CCV_16F;
+	registry->tensor_datatypes = CCV_32F | CCV_16F | CCV_16BF;
 	registry->tensor_memory = CCV_TENSOR_CPU_MEMORY;
 	registry->algorithms = 1;
 	registry->exec = _ccv_nnc_datatype_conversion;
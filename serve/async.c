@@ -1,62 +1,142 @@
 #include <stdlib.h>
 #include <assert.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/time.h>
 #include <ev.h>
-#include <dispatch/dispatch.h>
+#include "async.h"
 
+// a bounded multi-producer multi-consumer queue: each cell carries a sequence number which tells whether it is
+// ready to be written (sequence == position) or ready to be read (sequence == position + 1), producers and the
+// consumer claim positions with compare-and-swap, thus, no lock is taken on either side.
 typedef struct {
+	atomic_size_t sequence;
 	void *context;
 	void (*cb)(void*);
 } main_async_t;
 
-static dispatch_semaphore_t async_queue_semaphore;
-static int queue_position = 0;
-static int queue_pending = 0;
-static int queue_length = 10;
+#define MAIN_ASYNC_QUEUE_LENGTH (4096) // has to be power of 2
+
 static main_async_t* async_queue;
+static _Alignas(64) atomic_size_t enqueue_position;
+static _Alignas(64) atomic_size_t dequeue_position;
+static _Alignas(64) atomic_int max_depth;
+static atomic_uint_fast64_t enqueue_count;
+static atomic_uint_fast64_t enqueue_full;
+static atomic_uint_fast64_t total_latency;
+static atomic_uint_fast64_t max_latency;
 static ev_async main_async;
 
+static uint64_t main_async_get_current_time(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static int main_async_try_enqueue(void* context, void (*cb)(void*))
+{
+	size_t position = atomic_load_explicit(&enqueue_position, memory_order_relaxed);
+	for (;;)
+	{
+		main_async_t* cell = async_queue + (position & (MAIN_ASYNC_QUEUE_LENGTH - 1));
+		size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)position;
+		if (diff == 0)
+		{
+			if (atomic_compare_exchange_weak_explicit(&enqueue_position, &position, position + 1, memory_order_relaxed, memory_order_relaxed))
+			{
+				cell->context = context;
+				cell->cb = cb;
+				atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+				return 1;
+			}
+			// otherwise position is reloaded by the failed compare-and-swap
+		} else if (diff < 0)
+			return 0; // the cell hasn't been consumed yet, the queue is full
+		else
+			position = atomic_load_explicit(&enqueue_position, memory_order_relaxed);
+	}
+}
+
+static int main_async_try_dequeue(main_async_t* async)
+{
+	size_t position = atomic_load_explicit(&dequeue_position, memory_order_relaxed);
+	for (;;)
+	{
+		main_async_t* cell = async_queue + (position & (MAIN_ASYNC_QUEUE_LENGTH - 1));
+		size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)(position + 1);
+		if (diff == 0)
+		{
+			if (atomic_compare_exchange_weak_explicit(&dequeue_position, &position, position + 1, memory_order_relaxed, memory_order_relaxed))
+			{
+				async->context = cell->context;
+				async->cb = cell->cb;
+				// mark the cell as writable for the producer that comes around the ring next time
+				atomic_store_explicit(&cell->sequence, position + MAIN_ASYNC_QUEUE_LENGTH, memory_order_release);
+				return 1;
+			}
+		} else if (diff < 0)
+			return 0; // empty
+		else
+			position = atomic_load_explicit(&dequeue_position, memory_order_relaxed);
+	}
+}
+
 void main_async_f(void* context, void (*cb)(void*))
 {
 	assert(cb);
-	dispatch_semaphore_wait(async_queue_semaphore, DISPATCH_TIME_FOREVER);
-	++queue_pending;
-	if (queue_pending > queue_length)
+	uint64_t start = main_async_get_current_time();
+	if (!main_async_try_enqueue(context, cb))
 	{
-		queue_length = (queue_length * 3 + 1) / 2;
-		async_queue = (main_async_t*)realloc(async_queue, sizeof(main_async_t) * queue_length);
-		// when expand the queue, the order of our circular buffer is not maintained
-		// thus, have to reset the queue_postion here
-		queue_position = queue_pending - 1;
+		atomic_fetch_add_explicit(&enqueue_full, 1, memory_order_relaxed);
+		// backpressure, wake up the main thread to drain and wait for a cell to free up
+		do {
+			ev_async_send(EV_DEFAULT_ &main_async);
+			sched_yield();
+		} while (!main_async_try_enqueue(context, cb));
 	}
-	async_queue[queue_position].context = context;
-	async_queue[queue_position].cb = cb;
-	queue_position = (queue_position + 1) % queue_length;
-	dispatch_semaphore_signal(async_queue_semaphore);
 	ev_async_send(EV_DEFAULT_ &main_async);
+	int depth = (int)(atomic_load_explicit(&enqueue_position, memory_order_relaxed) - atomic_load_explicit(&dequeue_position, memory_order_relaxed));
+	int deepest = atomic_load_explicit(&max_depth, memory_order_relaxed);
+	while (depth > deepest && !atomic_compare_exchange_weak_explicit(&max_depth, &deepest, depth, memory_order_relaxed, memory_order_relaxed));
+	uint64_t latency = main_async_get_current_time() - start;
+	atomic_fetch_add_explicit(&enqueue_count, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&total_latency, latency, memory_order_relaxed);
+	uint_fast64_t longest = atomic_load_explicit(&max_latency, memory_order_relaxed);
+	while (latency > longest && !atomic_compare_exchange_weak_explicit(&max_latency, &longest, latency, memory_order_relaxed, memory_order_relaxed));
 }
 
 static void main_async_drain(EV_P_ ev_async* w, int revents)
 {
-	dispatch_semaphore_wait(async_queue_semaphore, DISPATCH_TIME_FOREVER);
-	while (queue_pending > 0)
-	{
-		main_async_t async;
-		queue_position = (queue_position + queue_length - 1) % queue_length;
-		--queue_pending;
-		async = async_queue[queue_position];
-		dispatch_semaphore_signal(async_queue_semaphore);
-		// call the async block outside the lock
+	main_async_t async;
+	// only run what is in the queue now, callbacks queued meanwhile will trigger another drain
+	size_t count = atomic_load_explicit(&enqueue_position, memory_order_acquire) - atomic_load_explicit(&dequeue_position, memory_order_relaxed);
+	while (count-- > 0 && main_async_try_dequeue(&async))
 		async.cb(async.context);
-		// continue the lock so we can get correct queue_pending
-		dispatch_semaphore_wait(async_queue_semaphore, DISPATCH_TIME_FOREVER);
-	}
-	dispatch_semaphore_signal(async_queue_semaphore);
+}
+
+void main_async_stats(main_async_stats_t* stats)
+{
+	size_t dequeued = atomic_load_explicit(&dequeue_position, memory_order_relaxed);
+	stats->depth = (int)(atomic_load_explicit(&enqueue_position, memory_order_relaxed) - dequeued);
+	stats->max_depth = atomic_load_explicit(&max_depth, memory_order_relaxed);
+	stats->capacity = MAIN_ASYNC_QUEUE_LENGTH;
+	stats->count = atomic_load_explicit(&enqueue_count, memory_order_relaxed);
+	stats->full = atomic_load_explicit(&enqueue_full, memory_order_relaxed);
+	stats->total_latency = atomic_load_explicit(&total_latency, memory_order_relaxed);
+	stats->max_latency = atomic_load_explicit(&max_latency, memory_order_relaxed);
 }
 
 void main_async_init(void)
 {
-	async_queue_semaphore = dispatch_semaphore_create(1);
-	async_queue = (main_async_t*)malloc(sizeof(main_async_t) * queue_length);
+	int i;
+	async_queue = (main_async_t*)malloc(sizeof(main_async_t) * MAIN_ASYNC_QUEUE_LENGTH);
+	for (i = 0; i < MAIN_ASYNC_QUEUE_LENGTH; i++)
+		atomic_init(&async_queue[i].sequence, i);
+	atomic_init(&enqueue_position, 0);
+	atomic_init(&dequeue_position, 0);
 	ev_async_init(&main_async, main_async_drain);
 }
 
@@ -67,6 +147,5 @@ void main_async_start(EV_P)
 
 void main_async_destroy(void)
 {
-	dispatch_release(async_queue_semaphore);
 	free(async_queue);
 }
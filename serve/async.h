@@ -1,8 +1,21 @@
 #ifndef _GUARD_async_h_
 #define _GUARD_async_h_
 
-// it tries to maintain a FIFO order, but it may not be the case sometimes
+#include <stdint.h>
+
+typedef struct {
+	int depth; // callbacks that are queued but not run on main thread yet
+	int max_depth; // the deepest the queue has been
+	int capacity; // the queue is bounded, a producer waits when it is full
+	uint64_t count; // callbacks enqueued so far
+	uint64_t full; // times a producer found the queue full and had to wait
+	uint64_t total_latency; // time (in microseconds) producers spent in main_async_f in total
+	uint64_t max_latency; // the longest time (in microseconds) a producer spent in main_async_f
+} main_async_stats_t;
+
+// it maintains FIFO order, it blocks the caller when the queue is full, thus, cannot be called on the main thread
 void main_async_f(void* context, void (*cb)(void*));
+void main_async_stats(main_async_stats_t* stats);
 void main_async_init(void);
 void main_async_start(EV_P);
 void main_async_destroy(void);
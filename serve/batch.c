@@ -0,0 +1,167 @@
+#include "batch.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/time.h>
+#include <dispatch/dispatch.h>
+
+typedef struct {
+	void* job;
+	uint64_t arrival;
+	dispatch_semaphore_t done;
+} batch_job_t;
+
+struct batch_s {
+	batch_param_t param;
+	batch_execute_f execute;
+	void* context;
+	dispatch_queue_t queue;
+	dispatch_semaphore_t lock;
+	int timer_scheduled;
+	int pending;
+	int length;
+	batch_job_t** jobs;
+	// scratch space for batch_flush, it only runs on the serial queue, thus, no contention
+	batch_job_t** taken;
+	void** execute_jobs;
+	batch_stats_t stats;
+};
+
+static uint64_t batch_get_current_time(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+batch_param_t batch_param_from_env(int max_size, int max_delay)
+{
+	batch_param_t param = {
+		.max_size = max_size,
+		.max_delay = max_delay,
+	};
+	const char* env = getenv("CCV_SERVE_BATCH_MAX_SIZE");
+	if (env && atoi(env) > 0)
+		param.max_size = atoi(env);
+	env = getenv("CCV_SERVE_BATCH_MAX_DELAY");
+	if (env && atoi(env) >= 0)
+		param.max_delay = atoi(env);
+	return param;
+}
+
+static void batch_flush(void* context);
+
+static void batch_schedule_timer(batch_t* batch, uint64_t now)
+{
+	// lock is held by the caller
+	uint64_t deadline = batch->jobs[0]->arrival + batch->param.max_delay;
+	batch->timer_scheduled = 1;
+	dispatch_after_f(dispatch_time(DISPATCH_TIME_NOW, deadline > now ? (int64_t)(deadline - now) * 1000 : 0), batch->queue, batch, batch_flush);
+}
+
+static void batch_flush(void* context)
+{
+	// this runs on the batch's serial queue, from either the timer or the submit that fills a batch
+	batch_t* batch = (batch_t*)context;
+	int i;
+	void** const jobs = batch->execute_jobs;
+	batch_job_t** const taken = batch->taken;
+	dispatch_semaphore_wait(batch->lock, DISPATCH_TIME_FOREVER);
+	batch->timer_scheduled = 0;
+	while (batch->pending > 0)
+	{
+		uint64_t now = batch_get_current_time();
+		if (batch->pending < batch->param.max_size && now < batch->jobs[0]->arrival + batch->param.max_delay)
+		{
+			// not full and the oldest one can still wait, check back when its time is up
+			batch_schedule_timer(batch, now);
+			break;
+		}
+		int count = batch->pending < batch->param.max_size ? batch->pending : batch->param.max_size;
+		memcpy(taken, batch->jobs, sizeof(batch_job_t*) * count);
+		batch->pending -= count;
+		memmove(batch->jobs, batch->jobs + count, sizeof(batch_job_t*) * batch->pending);
+		batch->stats.requests += count;
+		++batch->stats.batches;
+		dispatch_semaphore_signal(batch->lock);
+		// call the execute outside the lock such that more requests can queue up in the meantime
+		for (i = 0; i < count; i++)
+			jobs[i] = taken[i]->job;
+		batch->execute(batch->context, jobs, count);
+		for (i = 0; i < count; i++)
+			dispatch_semaphore_signal(taken[i]->done);
+		dispatch_semaphore_wait(batch->lock, DISPATCH_TIME_FOREVER);
+	}
+	dispatch_semaphore_signal(batch->lock);
+}
+
+batch_t* batch_new(batch_param_t param, batch_execute_f execute, void* context)
+{
+	assert(param.max_size > 0);
+	assert(param.max_delay >= 0);
+	batch_t* batch = (batch_t*)malloc(sizeof(batch_t));
+	batch->param = param;
+	batch->execute = execute;
+	batch->context = context;
+	batch->queue = dispatch_queue_create("com.libccv.serve.batch", 0);
+	batch->lock = dispatch_semaphore_create(1);
+	batch->timer_scheduled = 0;
+	batch->pending = 0;
+	batch->length = param.max_size;
+	batch->jobs = (batch_job_t**)malloc(sizeof(batch_job_t*) * batch->length);
+	batch->taken = (batch_job_t**)malloc(sizeof(batch_job_t*) * param.max_size);
+	batch->execute_jobs = (void**)malloc(sizeof(void*) * param.max_size);
+	memset(&batch->stats, 0, sizeof(batch->stats));
+	return batch;
+}
+
+void batch_submit(batch_t* batch, void* job)
+{
+	batch_job_t batch_job = {
+		.job = job,
+		.arrival = batch_get_current_time(),
+		.done = dispatch_semaphore_create(0),
+	};
+	dispatch_semaphore_wait(batch->lock, DISPATCH_TIME_FOREVER);
+	if (batch->pending >= batch->length)
+	{
+		batch->length = (batch->length * 3 + 1) / 2;
+		batch->jobs = (batch_job_t**)realloc(batch->jobs, sizeof(batch_job_t*) * batch->length);
+	}
+	batch->jobs[batch->pending++] = &batch_job;
+	if (batch->pending > batch->stats.max_pending)
+		batch->stats.max_pending = batch->pending;
+	if (batch->pending % batch->param.max_size == 0)
+		dispatch_async_f(batch->queue, batch, batch_flush); // a batch is full, no need to wait
+	else if (!batch->timer_scheduled)
+		batch_schedule_timer(batch, batch_job.arrival);
+	dispatch_semaphore_signal(batch->lock);
+	dispatch_semaphore_wait(batch_job.done, DISPATCH_TIME_FOREVER);
+	dispatch_release(batch_job.done);
+}
+
+void batch_stats(batch_t* batch, batch_stats_t* stats)
+{
+	dispatch_semaphore_wait(batch->lock, DISPATCH_TIME_FOREVER);
+	*stats = batch->stats;
+	stats->pending = batch->pending;
+	dispatch_semaphore_signal(batch->lock);
+}
+
+static void batch_drain(void* context)
+{
+	// nothing, only to wait for whatever is already on the queue
+}
+
+void batch_free(batch_t* batch)
+{
+	// drain whatever is scheduled on the queue, no request should be submitted at this point
+	dispatch_sync_f(batch->queue, 0, batch_drain);
+	assert(batch->pending == 0);
+	dispatch_release(batch->queue);
+	dispatch_release(batch->lock);
+	free(batch->jobs);
+	free(batch->taken);
+	free(batch->execute_jobs);
+	free(batch);
+}
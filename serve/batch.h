@@ -0,0 +1,31 @@
+#ifndef _GUARD_batch_h_
+#define _GUARD_batch_h_
+
+#include <stdint.h>
+
+typedef struct {
+	int max_size; // the maximum number of requests in one batched call
+	int max_delay; // the maximum time (in microseconds) a request waits for others to join its batch
+} batch_param_t;
+
+typedef struct {
+	int pending; // requests that are waiting to be executed right now
+	int max_pending; // the deepest the queue has been
+	uint64_t requests; // requests executed so far
+	uint64_t batches; // batched calls made so far
+} batch_stats_t;
+
+typedef struct batch_s batch_t;
+
+// the execute callback runs on the batch's own serial queue, thus, one batch at a time for a given model
+typedef void (*batch_execute_f)(void* context, void** jobs, int count);
+
+// reads CCV_SERVE_BATCH_MAX_SIZE and CCV_SERVE_BATCH_MAX_DELAY (in microseconds) from environment, otherwise use the defaults
+batch_param_t batch_param_from_env(int max_size, int max_delay);
+batch_t* batch_new(batch_param_t param, batch_execute_f execute, void* context);
+// it blocks until the job is executed, thus, has to be called off the main thread
+void batch_submit(batch_t* batch, void* job);
+void batch_stats(batch_t* batch, batch_stats_t* stats);
+void batch_free(batch_t* batch);
+
+#endif
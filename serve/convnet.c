@@ -1,4 +1,5 @@
 #include "uri.h"
+#include "batch.h"
 #include "ccv.h"
 #include <stdlib.h>
 #include <stdio.h>
@@ -28,8 +29,10 @@ static const param_dispatch_t param_map[] = {
 };
 
 typedef struct {
+	const char* name;
 	ccv_convnet_t* convnet;
 	ccv_array_t* words;
+	batch_t* batch; // concurrent classify requests for this model are grouped into one ccv_convnet_classify call
 } convnet_and_words_t;
 
 typedef struct {
@@ -37,6 +40,15 @@ typedef struct {
 	convnet_and_words_t image_net[2];
 } convnet_context_t;
 
+typedef struct {
+	ccv_dense_matrix_t* input;
+	int top;
+	ccv_array_t* rank;
+} convnet_classify_job_t;
+
+// the stats endpoint doesn't have its own context, it reads the batches off this one
+static convnet_context_t* convnet_classify_context = 0;
+
 typedef struct {
 	param_parser_t param_parser;
 	convnet_context_t* context;
@@ -92,9 +104,34 @@ static ccv_array_t* uri_convnet_words_read(char* filename)
 	return 0;
 }
 
+static void uri_convnet_classify_batch(void* context, void** jobs, int count)
+{
+	ccv_convnet_t* convnet = ((convnet_and_words_t*)context)->convnet;
+	ccv_dense_matrix_t** inputs = (ccv_dense_matrix_t**)alloca(sizeof(ccv_dense_matrix_t*) * count);
+	ccv_array_t** ranks = (ccv_array_t**)alloca(sizeof(ccv_array_t*) * count);
+	int i, tops = 0;
+	for (i = 0; i < count; i++)
+	{
+		convnet_classify_job_t* job = (convnet_classify_job_t*)jobs[i];
+		inputs[i] = job->input;
+		tops = ccv_max(tops, job->top);
+	}
+	ccv_convnet_classify(convnet, inputs, 1, ranks, tops, count);
+	for (i = 0; i < count; i++)
+	{
+		convnet_classify_job_t* job = (convnet_classify_job_t*)jobs[i];
+		// ranks are sorted by confidence, thus, only need to drop the tail for requests asked for fewer
+		if (ranks[i]->rnum > job->top)
+			ranks[i]->rnum = job->top;
+		job->rank = ranks[i];
+	}
+}
+
 void* uri_convnet_classify_init(void)
 {
 	convnet_context_t* context = (convnet_context_t*)malloc(sizeof(convnet_context_t));
+	context->image_net[0].name = "image-net-2012";
+	context->image_net[1].name = "image-net-2012-vgg-d";
 	context->image_net[0].convnet = ccv_convnet_read(0, "../samples/image-net-2012.sqlite3");
 	assert(context->image_net[0].convnet);
 	context->image_net[0].words = uri_convnet_words_read("../samples/image-net-2012.words");
@@ -102,12 +139,17 @@ void* uri_convnet_classify_init(void)
 	context->image_net[1].words = uri_convnet_words_read("../samples/image-net-2012.words");
 	assert(context->image_net[1].words);
 	context->image_net[1].convnet = ccv_convnet_read(0, "../samples/image-net-2012-vgg-d.sqlite3");
+	batch_param_t param = batch_param_from_env(16, 5000);
+	int i;
+	for (i = 0; i < 2; i++)
+		context->image_net[i].batch = context->image_net[i].convnet ? batch_new(param, uri_convnet_classify_batch, &context->image_net[i]) : 0;
 	assert(param_parser_map_alphabet(param_map, sizeof(param_map) / sizeof(param_dispatch_t)) == 0);
 	context->desc = param_parser_map_http_body(param_map, sizeof(param_map) / sizeof(param_dispatch_t),
 		"[{"
 			"\"word\":\"string\","
 			"\"confidence\":\"number\""
 		"}]");
+	convnet_classify_context = context;
 	return context;
 }
 
@@ -115,8 +157,11 @@ void uri_convnet_classify_destroy(void* context)
 {
 	convnet_context_t* convnet_context = (convnet_context_t*)context;
 	int i, j;
+	convnet_classify_context = 0;
 	for (i = 0; i < 2; i++)
 	{
+		if (convnet_context->image_net[i].batch)
+			batch_free(convnet_context->image_net[i].batch);
 		ccv_convnet_free(convnet_context->image_net[i].convnet);
 		for (j = 0; j < convnet_context->image_net[i].words->rnum; j++)
 		{
@@ -192,7 +237,7 @@ int uri_convnet_classify(const void* context, const void* parsed, ebb_buf* buf)
 		return -1;
 	}
 	ccv_dense_matrix_t* image = 0;
-	ccv_read(parser->source.data, &image, CCV_IO_ANY_STREAM | CCV_IO_RGB_COLOR, parser->source.written);
+	ccv_read_scaled(parser->source.data, &image, CCV_IO_ANY_STREAM | CCV_IO_RGB_COLOR, parser->source.written, ccv_max(convnet->input.height, convnet->input.width), 0);
 	free(parser->source.data);
 	if (image == 0)
 	{
@@ -202,8 +247,13 @@ int uri_convnet_classify(const void* context, const void* parsed, ebb_buf* buf)
 	ccv_dense_matrix_t* input = 0;
 	ccv_convnet_input_formation(convnet->input, image, &input);
 	ccv_matrix_free(image);
-	ccv_array_t* rank = 0;
-	ccv_convnet_classify(convnet, &input, 1, &rank, parser->top, 1);
+	convnet_classify_job_t job = {
+		.input = input,
+		.top = parser->top,
+		.rank = 0,
+	};
+	batch_submit(parser->convnet_and_words->batch, &job);
+	ccv_array_t* rank = job.rank;
 	// print out
 	buf->len = 192 + rank->rnum * 30 + 2;
 	char* data = (char*)malloc(buf->len);
@@ -247,3 +297,49 @@ int uri_convnet_classify(const void* context, const void* parsed, ebb_buf* buf)
 	free(parser);
 	return 0;
 }
+
+int uri_convnet_classify_stats(const void* context, const void* parsed, ebb_buf* buf)
+{
+	if (!convnet_classify_context)
+		return -1;
+	buf->len = 192 + 2;
+	char* data = (char*)malloc(buf->len);
+	data[0] = '{';
+	buf->written = 1;
+	int i;
+	for (i = 0; i < 2; i++)
+	{
+		char cell[1024];
+		convnet_and_words_t* convnet_and_words = convnet_classify_context->image_net + i;
+		batch_stats_t stats = {0};
+		if (convnet_and_words->batch)
+			batch_stats(convnet_and_words->batch, &stats);
+		snprintf(cell, 1024, "\"%s\":{\"pending\":%d,\"max_pending\":%d,\"requests\":%llu,\"batches\":%llu}", convnet_and_words->name, stats.pending, stats.max_pending, (unsigned long long)stats.requests, (unsigned long long)stats.batches);
+		size_t len = strnlen(cell, 1024);
+		while (buf->written + len + 1 >= buf->len)
+		{
+			buf->len = (buf->len * 3 + 1) / 2;
+			data = (char*)realloc(data, buf->len);
+		}
+		memcpy(data + buf->written, cell, len);
+		buf->written += len + 1;
+		data[buf->written - 1] = (i == 1) ? '}' : ',';
+	}
+	// copy the http header
+	char http_header[192];
+	snprintf(http_header, 192, ebb_http_header, buf->written + 1);
+	size_t len = strnlen(http_header, 192);
+	if (buf->written + len + 1 >= buf->len)
+	{
+		buf->len = buf->written + len + 1;
+		data = (char*)realloc(data, buf->len);
+	}
+	memmove(data + len, data, buf->written);
+	memcpy(data, http_header, len);
+	buf->written += len + 1;
+	data[buf->written - 1] = '\n';
+	buf->data = data;
+	buf->len = buf->written;
+	buf->on_release = uri_ebb_buf_free;
+	return 0;
+}
@@ -234,7 +234,7 @@ int uri_swt_detect_words(const void* context, const void* parsed, ebb_buf* buf)
 		return -1;
 	}
 	ccv_dense_matrix_t* image = 0;
-	ccv_read(parser->source.data, &image, CCV_IO_ANY_STREAM | CCV_IO_GRAY, parser->source.written);
+	ccv_read_scaled(parser->source.data, &image, CCV_IO_ANY_STREAM | CCV_IO_GRAY, parser->source.written, 0, parser->params.max_dimension);
 	free(parser->source.data);
 	if (image == 0)
 	{
@@ -1,4 +1,5 @@
 #include "uri.h"
+#include "async.h"
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -24,6 +25,15 @@ static uri_dispatch_t uri_map[] = {
 		.delete = 0,
 		.destroy = uri_root_destroy,
 	},
+	{
+		.uri = "/async.stats",
+		.init = 0,
+		.parse = 0,
+		.get = uri_async_stats,
+		.post = 0,
+		.delete = 0,
+		.destroy = 0,
+	},
 	{
 		.uri = "/bbf/detect.objects",
 		.init = uri_bbf_detect_objects_init,
@@ -42,6 +52,15 @@ static uri_dispatch_t uri_map[] = {
 		.delete = 0,
 		.destroy = uri_convnet_classify_destroy,
 	},
+	{
+		.uri = "/convnet/classify.stats",
+		.init = 0,
+		.parse = 0,
+		.get = uri_convnet_classify_stats,
+		.post = 0,
+		.delete = 0,
+		.destroy = 0,
+	},
 	{
 		.uri = "/dpm/detect.objects",
 		.init = uri_dpm_detect_objects_init,
@@ -186,3 +205,20 @@ void uri_root_destroy(void* context)
 {
 	free(context);
 }
+
+int uri_async_stats(const void* context, const void* parsed, ebb_buf* buf)
+{
+	main_async_stats_t stats;
+	main_async_stats(&stats);
+	char body[512];
+	snprintf(body, 512, "{\"depth\":%d,\"max_depth\":%d,\"capacity\":%d,\"count\":%llu,\"full\":%llu,\"average_latency\":%llu,\"max_latency\":%llu}\n", stats.depth, stats.max_depth, stats.capacity, (unsigned long long)stats.count, (unsigned long long)stats.full, (unsigned long long)(stats.count > 0 ? stats.total_latency / stats.count : 0), (unsigned long long)stats.max_latency);
+	size_t body_len = strnlen(body, 512);
+	char* data = (char*)malloc(192 + body_len);
+	snprintf(data, 192, ebb_http_header, body_len);
+	size_t len = strnlen(data, 192);
+	memcpy(data + len, body, body_len);
+	buf->data = data;
+	buf->len = buf->written = len + body_len;
+	buf->on_release = uri_ebb_buf_free;
+	return 0;
+}
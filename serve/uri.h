@@ -210,6 +210,8 @@ void* uri_root_init(void);
 void uri_root_destroy(void* context);
 int uri_root_discovery(const void* context, const void* parsed, ebb_buf* buf);
 
+int uri_async_stats(const void* context, const void* parsed, ebb_buf* buf);
+
 void* uri_bbf_detect_objects_init(void);
 void uri_bbf_detect_objects_destroy(void* context);
 void* uri_bbf_detect_objects_parse(const void* context, void* parsed, int resource_id, const char* buf, size_t len, uri_parse_state_t state, int header_index);
@@ -258,5 +260,6 @@ void uri_convnet_classify_destroy(void* context);
 void* uri_convnet_classify_parse(const void* context, void* parsed, int resource_id, const char* buf, size_t len, uri_parse_state_t state, int header_index);
 int uri_convnet_classify_intro(const void* context, const void* parsed, ebb_buf* buf);
 int uri_convnet_classify(const void* context, const void* parsed, ebb_buf* buf);
+int uri_convnet_classify_stats(const void* context, const void* parsed, ebb_buf* buf);
 
 #endif
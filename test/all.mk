@@ -4,7 +4,7 @@ export LSAN_OPTIONS=suppressions=known-leaks.txt
 LDFLAGS := -L"../lib" -lccv $(LDFLAGS)
 CFLAGS := -O3 -Wall -I"../lib" -I"." $(CFLAGS)
 
-SRCS := unit/util.tests.c unit/basic.tests.c unit/memory.tests.c unit/transform.tests.c unit/image_processing.tests.c unit/3rdparty.tests.c unit/algebra.tests.c unit/io.tests.c unit/nnc/gradient.tests.c unit/nnc/upsample.tests.c unit/nnc/tensor.bind.tests.c unit/nnc/backward.tests.c unit/nnc/graph.tests.c unit/nnc/case_of.backward.tests.c unit/nnc/while.backward.tests.c unit/nnc/autograd.vector.tests.c unit/nnc/dropout.tests.c unit/nnc/custom.tests.c unit/nnc/reduce.tests.c unit/nnc/tfb.tests.c unit/nnc/batch.norm.tests.c unit/nnc/crossentropy.tests.c unit/nnc/cnnp.core.tests.c unit/nnc/symbolic.graph.tests.c unit/nnc/case_of.tests.c unit/nnc/compression.tests.c unit/nnc/transform.tests.c unit/nnc/dataframe.tests.c unit/nnc/gemm.tests.c unit/nnc/roi_align.tests.c unit/nnc/swish.tests.c unit/nnc/index.tests.c unit/nnc/minimize.tests.c unit/nnc/symbolic.graph.compile.tests.c unit/nnc/autograd.tests.c unit/nnc/tensor.tests.c unit/nnc/rand.tests.c unit/nnc/while.tests.c unit/nnc/nms.tests.c unit/nnc/graph.io.tests.c unit/nnc/simplify.tests.c unit/nnc/numa.tests.c unit/nnc/tape.tests.c unit/nnc/dynamic.graph.tests.c unit/nnc/layer.norm.tests.c unit/nnc/parallel.tests.c unit/nnc/winograd.tests.c unit/nnc/dataframe.addons.tests.c unit/nnc/broadcast.tests.c unit/nnc/smooth_l1.tests.c unit/nnc/forward.tests.c unit/output.tests.c unit/convnet.tests.c unit/numeric.tests.c regression/defects.l0.1.tests.c int/nnc/cublas.tests.c int/nnc/symbolic.graph.vgg.d.tests.c int/nnc/imdb.tests.c int/nnc/graph.vgg.d.tests.c int/nnc/compression.tests.c int/nnc/cudnn.tests.c int/nnc/index.tests.c int/nnc/dense.net.tests.c int/nnc/cifar.tests.c int/nnc/nccl.tests.c int/nnc/schedule.tests.c int/nnc/dynamic.graph.tests.c int/nnc/parallel.tests.c
+SRCS := unit/util.tests.c unit/basic.tests.c unit/memory.tests.c unit/transform.tests.c unit/image_processing.tests.c unit/3rdparty.tests.c unit/algebra.tests.c unit/io.tests.c unit/nnc/gradient.tests.c unit/nnc/upsample.tests.c unit/nnc/tensor.bind.tests.c unit/nnc/backward.tests.c unit/nnc/graph.tests.c unit/nnc/case_of.backward.tests.c unit/nnc/while.backward.tests.c unit/nnc/autograd.vector.tests.c unit/nnc/dropout.tests.c unit/nnc/custom.tests.c unit/nnc/reduce.tests.c unit/nnc/tfb.tests.c unit/nnc/batch.norm.tests.c unit/nnc/crossentropy.tests.c unit/nnc/cnnp.core.tests.c unit/nnc/symbolic.graph.tests.c unit/nnc/case_of.tests.c unit/nnc/compression.tests.c unit/nnc/transform.tests.c unit/nnc/dataframe.tests.c unit/nnc/gemm.tests.c unit/nnc/roi_align.tests.c unit/nnc/swish.tests.c unit/nnc/index.tests.c unit/nnc/minimize.tests.c unit/nnc/symbolic.graph.compile.tests.c unit/nnc/autograd.tests.c unit/nnc/tensor.tests.c unit/nnc/rand.tests.c unit/nnc/while.tests.c unit/nnc/nms.tests.c unit/nnc/graph.io.tests.c unit/nnc/simplify.tests.c unit/nnc/numa.tests.c unit/nnc/tape.tests.c unit/nnc/dynamic.graph.tests.c unit/nnc/layer.norm.tests.c unit/nnc/parallel.tests.c unit/nnc/winograd.tests.c unit/nnc/dataframe.addons.tests.c unit/nnc/broadcast.tests.c unit/nnc/smooth_l1.tests.c unit/nnc/forward.tests.c unit/output.tests.c unit/convnet.tests.c unit/dpm.tests.c unit/numeric.tests.c regression/defects.l0.1.tests.c int/nnc/cublas.tests.c int/nnc/symbolic.graph.vgg.d.tests.c int/nnc/imdb.tests.c int/nnc/graph.vgg.d.tests.c int/nnc/compression.tests.c int/nnc/cudnn.tests.c int/nnc/index.tests.c int/nnc/dense.net.tests.c int/nnc/cifar.tests.c int/nnc/nccl.tests.c int/nnc/schedule.tests.c int/nnc/dynamic.graph.tests.c int/nnc/parallel.tests.c
 
 SRC_OBJS := $(patsubst %.c,%.o,$(SRCS))
 
@@ -175,6 +175,9 @@ unit/output.tests.o: unit/output.tests.c
 unit/convnet.tests.o: unit/convnet.tests.c
 	$(CC) $< -D COVERAGE_TESTS -D CASE_DISABLE_MAIN -D CASE_TEST_DIR='"unit"' -o $@ -c $(CFLAGS)
 
+unit/dpm.tests.o: unit/dpm.tests.c
+	$(CC) $< -D COVERAGE_TESTS -D CASE_DISABLE_MAIN -D CASE_TEST_DIR='"unit"' -o $@ -c $(CFLAGS)
+
 unit/numeric.tests.o: unit/numeric.tests.c
 	$(CC) $< -D COVERAGE_TESTS -D CASE_DISABLE_MAIN -D CASE_TEST_DIR='"unit"' -o $@ -c $(CFLAGS)
 
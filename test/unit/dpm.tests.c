@@ -0,0 +1,48 @@
+#include "ccv.h"
+#include "case.h"
+#include "ccv_case.h"
+
+TEST_CASE("dpm detects pedestrians the same as the serial implementation")
+{
+	ccv_dense_matrix_t* image = 0;
+	ccv_read("../../samples/pedestrian.png", &image, CCV_IO_ANY_FILE);
+	REQUIRE(image, "should read the sample image");
+	// The sample is too small for the model, upscale it 4 times such that there are detections from several levels.
+	ccv_dense_matrix_t* upscaled = 0;
+	ccv_resample(image, &upscaled, 0, image->rows * 4, image->cols * 4, CCV_INTER_CUBIC);
+	ccv_matrix_free(image);
+	ccv_dpm_mixture_model_t* model = ccv_dpm_read_mixture_model("../../samples/pedestrian.m");
+	REQUIRE(model, "should read the pedestrian model");
+	ccv_array_t* seq = ccv_dpm_detect_objects(upscaled, &model, 1, ccv_dpm_default_params);
+	// Computed by the serial implementation, with ccv_filter for the root and part responses.
+	static const ccv_rect_t rects[] = {
+		{ 229, 273, 43, 129 },
+		{ 236, 401, 44, 132 },
+		{ 188, 423, 38, 114 },
+		{ 183, 356, 42, 127 },
+		{ 160, 380, 43, 130 },
+		{ 186, 447, 41, 123 },
+		{ 90, 501, 45, 136 },
+		{ 26, 56, 48, 145 },
+	};
+	static const float confidences[] = {
+		1.675249, 1.227188, 0.958562, 1.127150, 0.957339, 0.608325, 0.660567, 0.804288,
+	};
+	REQUIRE_EQ(seq->rnum, sizeof(rects) / sizeof(rects[0]), "should have the same number of detections");
+	int i;
+	for (i = 0; i < seq->rnum; i++)
+	{
+		const ccv_root_comp_t* const comp = (ccv_root_comp_t*)ccv_array_get(seq, i);
+		REQUIRE_EQ(comp->rect.x, rects[i].x, "detection %d should be at the same x", i);
+		REQUIRE_EQ(comp->rect.y, rects[i].y, "detection %d should be at the same y", i);
+		REQUIRE_EQ(comp->rect.width, rects[i].width, "detection %d should have the same width", i);
+		REQUIRE_EQ(comp->rect.height, rects[i].height, "detection %d should have the same height", i);
+		REQUIRE_EQ_WITH_TOLERANCE(comp->classification.confidence, confidences[i], 1e-4, "detection %d should have the same confidence", i);
+		REQUIRE_EQ(comp->pnum, 8, "detection %d should have all the parts", i);
+	}
+	ccv_array_free(seq);
+	ccv_matrix_free(upscaled);
+	ccv_dpm_mixture_model_free(model);
+}
+
+#include "case_main.h"
@@ -372,4 +372,27 @@ TEST_CASE("read PNG from memory")
 	ccv_matrix_free(x);
 }
 
+TEST_CASE("read JPEG with downscale in DCT domain")
+{
+	ccv_dense_matrix_t* x = 0;
+	ccv_read("../../samples/cmyk-jpeg-format.jpg", &x, CCV_IO_ANY_FILE | CCV_IO_RGB_COLOR);
+	int shorter = ccv_min(x->rows, x->cols);
+	int longer = ccv_max(x->rows, x->cols);
+	ccv_dense_matrix_t* y = 0;
+	ccv_read_scaled("../../samples/cmyk-jpeg-format.jpg", &y, CCV_IO_ANY_FILE | CCV_IO_RGB_COLOR, 0, (shorter + 3) / 4, 0);
+	REQUIRE_EQ((x->rows + 3) / 4, y->rows, "should decode at 1/4 scale");
+	REQUIRE_EQ((x->cols + 3) / 4, y->cols, "should decode at 1/4 scale");
+	ccv_matrix_free(y);
+	y = 0;
+	ccv_read_scaled("../../samples/cmyk-jpeg-format.jpg", &y, CCV_IO_ANY_FILE | CCV_IO_RGB_COLOR, 0, 0, (longer + 3) / 4 + 1);
+	REQUIRE_EQ((x->rows + 1) / 2, y->rows, "1/4 scale is too small for the longer side, should decode at 1/2 scale");
+	REQUIRE_EQ((x->cols + 1) / 2, y->cols, "1/4 scale is too small for the longer side, should decode at 1/2 scale");
+	ccv_matrix_free(y);
+	y = 0;
+	ccv_read_scaled("../../samples/cmyk-jpeg-format.jpg", &y, CCV_IO_ANY_FILE | CCV_IO_RGB_COLOR, 0, 0, 0);
+	REQUIRE_MATRIX_EQ(x, y, "without size requirement, should decode at full resolution");
+	ccv_matrix_free(y);
+	ccv_matrix_free(x);
+}
+
 #include "case_main.h"
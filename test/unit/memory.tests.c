@@ -1,6 +1,7 @@
 #include "ccv.h"
 #include "ccv_internal.h"
 #include "case.h"
+#include <pthread.h>
 
 uint64_t uniqid()
 {
@@ -173,4 +174,96 @@ TEST_CASE("multi-type garbage collector 92\% hit rate")
 	ccv_disable_cache();
 }
 
+static void* shared_cache_lookup(void* context)
+{
+	int i;
+	int* hit = (int*)context;
+	for (i = N - 1; i > N * 6 / 100; i--)
+	{
+		uint64_t sig = ccv_cache_generate_signature((const char*)&i, 4, CCV_EOF_SIGN);
+		ccv_dense_matrix_t* dmt = ccv_dense_matrix_new(1, 1, CCV_32S | CCV_C1, 0, sig);
+		if (i == dmt->data.i32[0])
+			++hit[0];
+		++hit[1];
+		ccv_matrix_free_immediately(dmt);
+	}
+	return 0;
+}
+
+TEST_CASE("shared garbage collector reuses across threads")
+{
+	int i;
+	const size_t up = ccv_compute_dense_matrix_size(1, 1, CCV_32S | CCV_C1) * N * 45 / 100;
+	ccv_enable_shared_cache(up);
+	for (i = 0; i < N; i++)
+	{
+		ccv_dense_matrix_t* dmt = ccv_dense_matrix_new(1, 1, CCV_32S | CCV_C1, 0, 0);
+		dmt->data.i32[0] = i;
+		dmt->sig = ccv_cache_generate_signature((const char*)&i, 4, CCV_EOF_SIGN);
+		dmt->type |= CCV_REUSABLE;
+		ccv_matrix_free(dmt);
+	}
+	ccv_cache_stats_t stats;
+	ccv_shared_cache_stats(&stats);
+	REQUIRE(stats.size <= up, "the cache (%zu) should stay within the budget (%zu)", stats.size, up);
+	REQUIRE(stats.eviction > 0, "should evict to stay within the budget");
+	// computed on this thread, looked up on another
+	int hit[2] = {0};
+	pthread_t thread;
+	pthread_create(&thread, 0, shared_cache_lookup, hit);
+	pthread_join(thread, 0);
+	REQUIRE((double)hit[0] / (double)hit[1] > 0.40, "the cache hit (%lf) on the other thread should be greater than 40%%", (double)hit[0] / (double)hit[1]);
+	ccv_shared_cache_stats(&stats);
+	REQUIRE_EQ(hit[0], (int)stats.hit, "the hit count should match");
+	REQUIRE_EQ(hit[1] - hit[0], (int)stats.miss, "the miss count should match");
+	ccv_disable_shared_cache();
+}
+
+TEST_CASE("shared garbage collector evicts from other shards when the budget is full")
+{
+	int i;
+	const size_t up = ccv_compute_dense_matrix_size(1, 1, CCV_32S | CCV_C1) * 64;
+	ccv_enable_shared_cache(up);
+	// the top bits of the signature pick the shard, fill the budget with the first shard only
+	for (i = 0; i < 128; i++)
+	{
+		ccv_dense_matrix_t* dmt = ccv_dense_matrix_new(1, 1, CCV_32S | CCV_C1, 0, 0);
+		dmt->data.i32[0] = i;
+		dmt->sig = (uint64_t)(i + 1);
+		dmt->type |= CCV_REUSABLE;
+		ccv_matrix_free(dmt);
+	}
+	ccv_cache_stats_t stats;
+	ccv_shared_cache_stats(&stats);
+	REQUIRE(stats.size <= up && stats.size + ccv_compute_dense_matrix_size(1, 1, CCV_32S | CCV_C1) > up, "the first shard (%zu) should fill the budget (%zu)", stats.size, up);
+	// these land in an empty shard
+	for (i = 0; i < 8; i++)
+	{
+		ccv_dense_matrix_t* dmt = ccv_dense_matrix_new(1, 1, CCV_32S | CCV_C1, 0, 0);
+		dmt->data.i32[0] = -i;
+		dmt->sig = (5ull << 60) | (uint64_t)(i + 1);
+		dmt->type |= CCV_REUSABLE;
+		ccv_matrix_free(dmt);
+	}
+	ccv_shared_cache_stats(&stats);
+	REQUIRE(stats.size <= up, "the cache (%zu) should stay within the budget (%zu)", stats.size, up);
+	int hit = 0;
+	for (i = 0; i < 8; i++)
+	{
+		ccv_dense_matrix_t* dmt = ccv_dense_matrix_new(1, 1, CCV_32S | CCV_C1, 0, (5ull << 60) | (uint64_t)(i + 1));
+		if ((dmt->type & CCV_GARBAGE) && dmt->data.i32[0] == -i)
+			++hit;
+		ccv_matrix_free_immediately(dmt);
+	}
+	REQUIRE_EQ(hit, 8, "all objects put into the empty shard should be cached");
+	// the oldest ones in the first shard made the room
+	ccv_dense_matrix_t* dmt = ccv_dense_matrix_new(1, 1, CCV_32S | CCV_C1, 0, 1);
+	REQUIRE(!(dmt->type & CCV_GARBAGE), "the least recently used object should be evicted");
+	ccv_matrix_free_immediately(dmt);
+	dmt = ccv_dense_matrix_new(1, 1, CCV_32S | CCV_C1, 0, 128);
+	REQUIRE((dmt->type & CCV_GARBAGE) && dmt->data.i32[0] == 127, "the most recently used object should stay");
+	ccv_matrix_free_immediately(dmt);
+	ccv_disable_shared_cache();
+}
+
 #include "case_main.h"
@@ -455,4 +455,64 @@ TEST_CASE("compare aggregated mean / var from batch norm with late binded tensor
 	ccv_nnc_tensor_free(bvar_tensor);
 }
 
+TEST_CASE("batch norm with CPU_OPT against CPU_REF")
+{
+	const ccv_nnc_tensor_param_t xparams[] = {
+		CPU_TENSOR_NHWC(32F, 8, 5, 5, 19),
+		CPU_TENSOR_NCHW(32F, 8, 19, 5, 5),
+	};
+	const ccv_nnc_tensor_param_t rparams[] = {
+		CPU_TENSOR_NHWC(32F, 19),
+		CPU_TENSOR_NCHW(32F, 1, 19, 1, 1),
+	};
+	const ccv_nnc_cmd_param_t training[] = {
+		CMD_BATCH_NORM_FORWARD(1e-4, 0, 0.9, 0, 1, 2).info,
+		CMD_BATCH_NORM_FORWARD(1e-4, 0, 0.9, 0, 2, 3).info,
+	};
+	dsfmt_t dsfmt;
+	dsfmt_init_gen_rand(&dsfmt, 0);
+	int i, j, k;
+	for (k = 0; k < 2; k++)
+	{
+		ccv_nnc_tensor_t* const x = ccv_nnc_tensor_new(0, xparams[k], 0);
+		ccv_nnc_tensor_t* const ref = ccv_nnc_tensor_new(0, xparams[k], 0);
+		ccv_nnc_tensor_t* const opt = ccv_nnc_tensor_new(0, xparams[k], 0);
+		const int count = ccv_nnc_tensor_count(xparams[k]);
+		for (i = 0; i < count; i++)
+			x->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) * 2;
+		ccv_nnc_tensor_t* r[10];
+		for (i = 0; i < 10; i++)
+			r[i] = ccv_nnc_tensor_new(0, rparams[k], 0);
+		// scale, bias, mean / var and saved mean / inv std for CPU_REF (2, 3, 6, 7) and CPU_OPT (4, 5, 8, 9).
+		for (i = 0; i < 19; i++)
+		{
+			r[0]->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) + 0.5;
+			r[1]->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) + 4;
+			r[2]->data.f32[i] = r[4]->data.f32[i] = dsfmt_genrand_open_close(&dsfmt);
+			r[3]->data.f32[i] = r[5]->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) + 1;
+		}
+		ccv_nnc_cmd_t cmd = ccv_nnc_cmd(CCV_NNC_BATCH_NORM_FORWARD, 0, training[k], 0);
+		cmd.backend = CCV_NNC_BACKEND_CPU_REF;
+		ccv_nnc_cmd_exec(cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(x, r[0], r[1], r[2], r[3]), TENSOR_LIST(ref, r[2], r[3], r[6], r[7]), 0);
+		cmd.backend = CCV_NNC_BACKEND_CPU_OPT;
+		ccv_nnc_cmd_exec(cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(x, r[0], r[1], r[4], r[5]), TENSOR_LIST(opt, r[4], r[5], r[8], r[9]), 0);
+		REQUIRE_TENSOR_EQ(ref, opt, "batch norm from CPU_OPT should match CPU_REF");
+		REQUIRE_TENSOR_EQ(r[2], r[4], "updated mean should match");
+		REQUIRE_TENSOR_EQ(r[3], r[5], "updated var should match");
+		for (j = 0; j < 19; j++)
+			r[4]->data.f32[j] = r[2]->data.f32[j], r[5]->data.f32[j] = r[3]->data.f32[j];
+		cmd.info.bnorm.is_test = 1;
+		cmd.backend = CCV_NNC_BACKEND_CPU_REF;
+		ccv_nnc_cmd_exec(cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(x, r[0], r[1], r[2], r[3]), TENSOR_LIST(ref), 0);
+		cmd.backend = CCV_NNC_BACKEND_CPU_OPT;
+		ccv_nnc_cmd_exec(cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(x, r[0], r[1], r[4], r[5]), TENSOR_LIST(opt), 0);
+		REQUIRE_TENSOR_EQ(ref, opt, "batch norm inference from CPU_OPT should match CPU_REF");
+		for (i = 0; i < 10; i++)
+			ccv_nnc_tensor_free(r[i]);
+		ccv_nnc_tensor_free(x);
+		ccv_nnc_tensor_free(ref);
+		ccv_nnc_tensor_free(opt);
+	}
+}
+
 #include "case_main.h"
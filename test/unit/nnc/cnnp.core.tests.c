@@ -4,6 +4,7 @@
 #include <ccv.h>
 #include <nnc/ccv_nnc.h>
 #include <nnc/ccv_nnc_easy.h>
+#include <nnc/_ccv_cnnp_model.h>
 #include "3rdparty/dsfmt/dSFMT.h"
 
 TEST_SETUP()
@@ -97,6 +98,85 @@ TEST_CASE("compile simple cifar-10 model")
 	ccv_nnc_tensor_free(output_tensor);
 }
 
+TEST_CASE("checkpoint model asynchronously with compression")
+{
+	ccv_cnnp_model_t* const sequential = simple_cifar_10();
+	const ccv_nnc_tensor_param_t input = CPU_TENSOR_NHWC(32F, 1, 31, 31, 3);
+	ccv_cnnp_model_compile(sequential, &input, 1, CMD_SGD_FORWARD(1, 0.001, 1, 0.99, 0.9, 0), CMD_CATEGORICAL_CROSSENTROPY_FORWARD());
+	ccv_nnc_tensor_t* const input_tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 31, 31, 3), 0);
+	dsfmt_t dsfmt;
+	int i;
+	dsfmt_init_gen_rand(&dsfmt, 1);
+	for (i = 0; i < 31 * 31 * 3; i++)
+		input_tensor->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) * 2 - 1;
+	ccv_nnc_tensor_t* const output_tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 10), 0);
+	ccv_cnnp_model_evaluate(sequential, (ccv_cnnp_evaluate_param_t){
+		.is_test = 1
+	}, TENSOR_LIST(input_tensor), TENSOR_LIST(output_tensor), 0, 0);
+	remove("/tmp/async_simple_cifar_10_model.checkpoint");
+	ccv_cnnp_model_checkpoint(sequential, "/tmp/async_simple_cifar_10_model.checkpoint", CCV_CNNP_MODEL_CHECKPOINT_WRITE_ONLY | CCV_CNNP_MODEL_CHECKPOINT_ASYNC | CCV_CNNP_MODEL_CHECKPOINT_COMPRESS);
+	// Keep training while the checkpoint is written, this shouldn't change what is persisted.
+	ccv_nnc_tensor_t* const fit_tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1), 0);
+	fit_tensor->data.f32[0] = 1;
+	ccv_nnc_tensor_t* const fit_output_tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 10), 0);
+	for (i = 0; i < 10; i++)
+		ccv_cnnp_model_fit(sequential, TENSOR_LIST(input_tensor), TENSOR_LIST(fit_tensor), TENSOR_LIST(fit_output_tensor), 0, 0);
+	REQUIRE_EQ(ccv_cnnp_model_checkpoint_wait(sequential), CCV_IO_FINAL, "the checkpoint should be written");
+	ccv_cnnp_model_free(sequential);
+	ccv_cnnp_model_t* const sequential2 = simple_cifar_10();
+	ccv_cnnp_model_compile(sequential2, &input, 1, CMD_SGD_FORWARD(1, 0.001, 1, 0.99, 0.9, 0), CMD_CATEGORICAL_CROSSENTROPY_FORWARD());
+	ccv_cnnp_model_checkpoint(sequential2, "/tmp/async_simple_cifar_10_model.checkpoint", 0);
+	remove("/tmp/async_simple_cifar_10_model.checkpoint");
+	ccv_nnc_tensor_t* const output_tensor2 = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 10), 0);
+	ccv_cnnp_model_evaluate(sequential2, (ccv_cnnp_evaluate_param_t){
+		.is_test = 1
+	}, TENSOR_LIST(input_tensor), TENSOR_LIST(output_tensor2), 0, 0);
+	REQUIRE_TENSOR_EQ(output_tensor2, output_tensor, "the model should be restored to where the checkpoint was taken");
+	ccv_cnnp_model_free(sequential2);
+	ccv_nnc_tensor_free(input_tensor);
+	ccv_nnc_tensor_free(output_tensor);
+	ccv_nnc_tensor_free(output_tensor2);
+	ccv_nnc_tensor_free(fit_tensor);
+	ccv_nnc_tensor_free(fit_output_tensor);
+}
+
+TEST_CASE("read model parameters from memory-mapped container")
+{
+	ccv_cnnp_model_t* const sequential = simple_cifar_10();
+	const ccv_nnc_tensor_param_t input = CPU_TENSOR_NHWC(32F, 1, 31, 31, 3);
+	ccv_cnnp_model_compile(sequential, &input, 1, CMD_NOOP(), CMD_NOOP());
+	ccv_nnc_tensor_t* const input_tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 31, 31, 3), 0);
+	dsfmt_t dsfmt;
+	int i;
+	dsfmt_init_gen_rand(&dsfmt, 1);
+	for (i = 0; i < 31 * 31 * 3; i++)
+		input_tensor->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) * 2 - 1;
+	ccv_nnc_tensor_t* const output_tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 10), 0);
+	ccv_cnnp_model_evaluate(sequential, (ccv_cnnp_evaluate_param_t){
+		.is_test = 1
+	}, TENSOR_LIST(input_tensor), TENSOR_LIST(output_tensor), 0, 0);
+	ccv_nnc_tensor_mmap_writer_t* const writer = ccv_nnc_tensor_mmap_writer_new("/tmp/simple_cifar_10_model.mmap");
+	REQUIRE_EQ(ccv_cnnp_model_mmap_write(sequential, writer, 0), CCV_IO_FINAL, "should write the model");
+	REQUIRE_EQ(ccv_nnc_tensor_mmap_writer_free(writer), CCV_IO_FINAL, "should finish the container");
+	ccv_cnnp_model_free(sequential);
+	ccv_cnnp_model_t* const sequential2 = simple_cifar_10();
+	ccv_cnnp_model_compile(sequential2, &input, 1, CMD_NOOP(), CMD_NOOP());
+	ccv_nnc_tensor_mmap_t* const tensor_mmap = ccv_nnc_tensor_mmap_new("/tmp/simple_cifar_10_model.mmap");
+	REQUIRE(tensor_mmap, "should be able to map the container");
+	REQUIRE_EQ(ccv_cnnp_model_mmap_read(tensor_mmap, 0, sequential2), CCV_IO_FINAL, "should read the model");
+	ccv_nnc_tensor_t* const output_tensor2 = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 10), 0);
+	ccv_cnnp_model_evaluate(sequential2, (ccv_cnnp_evaluate_param_t){
+		.is_test = 1
+	}, TENSOR_LIST(input_tensor), TENSOR_LIST(output_tensor2), 0, 0);
+	REQUIRE_TENSOR_EQ(output_tensor2, output_tensor, "the model read from the container should produce the same result");
+	ccv_cnnp_model_free(sequential2);
+	ccv_nnc_tensor_mmap_free(tensor_mmap);
+	remove("/tmp/simple_cifar_10_model.mmap");
+	ccv_nnc_tensor_free(input_tensor);
+	ccv_nnc_tensor_free(output_tensor);
+	ccv_nnc_tensor_free(output_tensor2);
+}
+
 static int _ccv_cnnp_model_notified = 0;
 
 static void _ccv_cnnp_model_hook(const ccv_cnnp_model_t* const model, const int tag, void* const payload, void* const context)
@@ -979,6 +1059,173 @@ TEST_CASE("a compiled model absorbs a new model with slightly different configur
 	ccv_cnnp_model_free(multi_layer);
 }
 
+TEST_CASE("a model compiled for the maximum shapes runs smaller inputs")
+{
+	ccv_cnnp_model_t* const multi_layer = ccv_cnnp_sequential_new(MODEL_LIST(
+		ccv_cnnp_dense(2, 0, 0),
+		ccv_cnnp_dense(2, 0, 0),
+		ccv_cnnp_dense(1, 0, 0)
+	), "multi_layer");
+	const ccv_nnc_tensor_param_t max_x = CPU_TENSOR_NHWC(32F, 4, 2);
+	ccv_cnnp_model_set_max_inputs(multi_layer, TENSOR_PARAM_LIST(max_x));
+	const ccv_nnc_tensor_param_t x = CPU_TENSOR_NHWC(32F, 2, 2);
+	ccv_cnnp_model_compile(multi_layer, TENSOR_PARAM_LIST(x), CMD_SGD_FORWARD(0, 0.01, 1, 0.01, 0, 0), CMD_NOOP());
+	ccv_nnc_tensor_t* const x_tensor = ccv_nnc_tensor_new(0, x, 0);
+	dsfmt_t dsfmt;
+	int i;
+	dsfmt_init_gen_rand(&dsfmt, 1);
+	for (i = 0; i < 4; i++)
+		x_tensor->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) * 2 - 1;
+	ccv_nnc_tensor_t* const y_tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 2, 1), 0);
+	ccv_cnnp_model_evaluate(multi_layer, (ccv_cnnp_evaluate_param_t){
+		.requires_grad = 0,
+	}, TENSOR_LIST(x_tensor), TENSOR_LIST(y_tensor), 0, 0);
+	ccv_cnnp_compiled_data_t* const compiled_data = multi_layer->compiled_data;
+	const ccv_nnc_graph_t* const graph = compiled_data->graph;
+	const ccv_nnc_tensor_arena_t* const tensor_arena = compiled_data->tensor_arena;
+	const ccv_nnc_graph_exec_arena_t* const graph_exec_arena = compiled_data->graph_exec_arena;
+	REQUIRE(graph && tensor_arena && graph_exec_arena, "the model should be compiled");
+	ccv_nnc_tensor_t* const large_x = ccv_nnc_tensor_new(0, max_x, 0);
+	ccv_nnc_tensor_t* const large_y = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 1), 0);
+	memcpy(large_x->data.f32, x_tensor->data.f32, sizeof(float) * 4);
+	for (i = 4; i < 8; i++)
+		large_x->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) * 2 - 1;
+	ccv_cnnp_model_evaluate(multi_layer, (ccv_cnnp_evaluate_param_t){
+		.requires_grad = 0,
+	}, TENSOR_LIST(large_x), TENSOR_LIST(large_y), 0, 0);
+	REQUIRE_ARRAY_EQ_WITH_TOLERANCE(float, large_y->data.f32, y_tensor->data.f32, 2, 1e-5, "the first two rows should match the smaller batch");
+	ccv_nnc_tensor_t* const small_x = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 2), 0);
+	ccv_nnc_tensor_t* const small_y = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 1), 0);
+	memcpy(small_x->data.f32, large_x->data.f32 + 6, sizeof(float) * 2);
+	ccv_cnnp_model_evaluate(multi_layer, (ccv_cnnp_evaluate_param_t){
+		.requires_grad = 0,
+	}, TENSOR_LIST(small_x), TENSOR_LIST(small_y), 0, 0);
+	REQUIRE_EQ_WITH_TOLERANCE(small_y->data.f32[0], large_y->data.f32[3], 1e-5, "the last row should match the single input");
+	ccv_nnc_tensor_t* const y_tensor_2 = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 2, 1), 0);
+	ccv_cnnp_model_evaluate(multi_layer, (ccv_cnnp_evaluate_param_t){
+		.requires_grad = 0,
+	}, TENSOR_LIST(x_tensor), TENSOR_LIST(y_tensor_2), 0, 0);
+	REQUIRE_ARRAY_EQ_WITH_TOLERANCE(float, y_tensor_2->data.f32, y_tensor->data.f32, 2, 1e-5, "should compute the same when getting back to the first shapes");
+	REQUIRE(graph == compiled_data->graph, "the concrete graph should not be compiled again");
+	REQUIRE(tensor_arena == compiled_data->tensor_arena, "the tensor arena should be re-initialized in place");
+	REQUIRE(graph_exec_arena == compiled_data->graph_exec_arena, "the graph exec arena should be re-initialized in place");
+	REQUIRE_EQ(compiled_data->reshapes->rnum, 3, "the model should be built once for each of the 3 shapes");
+	// Switch between fit and evaluate with gradients, each time it is compiled for the maximum shapes, thus, the larger
+	// inputs run without compiling again.
+	ccv_cnnp_model_fit(multi_layer, TENSOR_LIST(small_x), 0, 0, TENSOR_LIST(small_y), 0, 0);
+	const ccv_nnc_graph_t* const fit_graph = compiled_data->graph;
+	const ccv_nnc_tensor_arena_t* const fit_tensor_arena = compiled_data->tensor_arena;
+	ccv_cnnp_model_fit(multi_layer, TENSOR_LIST(large_x), 0, 0, TENSOR_LIST(large_y), 0, 0);
+	REQUIRE(fit_graph == compiled_data->graph, "fit with the larger inputs should not compile again");
+	REQUIRE(fit_tensor_arena == compiled_data->tensor_arena, "fit with the larger inputs should re-initialize in place");
+	ccv_cnnp_model_evaluate(multi_layer, (ccv_cnnp_evaluate_param_t){
+		.requires_grad = 1,
+	}, TENSOR_LIST(small_x), TENSOR_LIST(small_y), 0, 0);
+	const ccv_nnc_graph_t* const evaluate_graph = compiled_data->graph;
+	const ccv_nnc_tensor_arena_t* const evaluate_tensor_arena = compiled_data->tensor_arena;
+	ccv_cnnp_model_evaluate(multi_layer, (ccv_cnnp_evaluate_param_t){
+		.requires_grad = 1,
+	}, TENSOR_LIST(large_x), TENSOR_LIST(large_y), 0, 0);
+	REQUIRE(evaluate_graph == compiled_data->graph, "evaluate with the larger inputs should not compile again");
+	REQUIRE(evaluate_tensor_arena == compiled_data->tensor_arena, "evaluate with the larger inputs should re-initialize in place");
+	ccv_cnnp_model_evaluate(multi_layer, (ccv_cnnp_evaluate_param_t){
+		.requires_grad = 1,
+	}, TENSOR_LIST(small_x), TENSOR_LIST(small_y), 0, 0);
+	REQUIRE_EQ_WITH_TOLERANCE(small_y->data.f32[0], large_y->data.f32[3], 1e-5, "the last row should match the single input after switching modes");
+	ccv_cnnp_model_fit(multi_layer, TENSOR_LIST(small_x), 0, 0, TENSOR_LIST(small_y), 0, 0);
+	const ccv_nnc_graph_t* const refit_graph = compiled_data->graph;
+	const ccv_nnc_tensor_arena_t* const refit_tensor_arena = compiled_data->tensor_arena;
+	ccv_cnnp_model_fit(multi_layer, TENSOR_LIST(large_x), 0, 0, TENSOR_LIST(large_y), 0, 0);
+	REQUIRE(refit_graph == compiled_data->graph, "fit again with the larger inputs should not compile again");
+	REQUIRE(refit_tensor_arena == compiled_data->tensor_arena, "fit again with the larger inputs should re-initialize in place");
+	ccv_nnc_tensor_free(y_tensor_2);
+	ccv_nnc_tensor_free(y_tensor);
+	ccv_nnc_tensor_free(x_tensor);
+	ccv_nnc_tensor_free(small_y);
+	ccv_nnc_tensor_free(small_x);
+	ccv_nnc_tensor_free(large_y);
+	ccv_nnc_tensor_free(large_x);
+	ccv_cnnp_model_free(multi_layer);
+}
+
+TEST_CASE("a model compiled for the maximum shapes keeps the minimizers set between shapes")
+{
+	ccv_cnnp_model_t* const last = ccv_cnnp_dense(1, 0, 0);
+	ccv_cnnp_model_t* const multi_layer = ccv_cnnp_sequential_new(MODEL_LIST(
+		ccv_cnnp_dense(2, 0, 0),
+		ccv_cnnp_dense(2, 0, 0),
+		last
+	), "multi_layer");
+	ccv_cnnp_model_set_max_inputs(multi_layer, TENSOR_PARAM_LIST(CPU_TENSOR_NHWC(32F, 4, 2)));
+	const ccv_nnc_tensor_param_t x = CPU_TENSOR_NHWC(32F, 2, 2);
+	ccv_cnnp_model_compile(multi_layer, TENSOR_PARAM_LIST(x), CMD_SGD_FORWARD(0, 0.01, 1, 0.01, 0, 0), CMD_NOOP());
+	ccv_nnc_tensor_t* const x_tensor = ccv_nnc_tensor_new(0, x, 0);
+	ccv_nnc_tensor_t* const y_tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 2, 1), 0);
+	ccv_nnc_tensor_t* const ingrad = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 2, 1), 0);
+	ccv_nnc_tensor_t* const small_x = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 2), 0);
+	ccv_nnc_tensor_t* const small_y = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 1), 0);
+	ccv_nnc_tensor_t* const small_ingrad = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 1), 0);
+	dsfmt_t dsfmt;
+	int i;
+	dsfmt_init_gen_rand(&dsfmt, 1);
+	for (i = 0; i < 4; i++)
+		x_tensor->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) * 2 - 1;
+	small_x->data.f32[0] = x_tensor->data.f32[0];
+	small_x->data.f32[1] = x_tensor->data.f32[1];
+	ingrad->data.f32[0] = ingrad->data.f32[1] = small_ingrad->data.f32[0] = 1;
+	ccv_cnnp_model_evaluate(multi_layer, (ccv_cnnp_evaluate_param_t){
+		.requires_grad = 1,
+	}, TENSOR_LIST(x_tensor), TENSOR_LIST(y_tensor), 0, 0);
+	ccv_cnnp_model_backward(multi_layer, TENSOR_LIST(ingrad), 0, 0, 0, 0);
+	ccv_cnnp_model_apply_gradients(multi_layer, 0);
+	ccv_cnnp_compiled_data_t* const compiled_data = multi_layer->compiled_data;
+	const ccv_nnc_graph_t* const graph = compiled_data->graph;
+	const ccv_nnc_tensor_arena_t* const tensor_arena = compiled_data->tensor_arena;
+	ccv_cnnp_model_evaluate(multi_layer, (ccv_cnnp_evaluate_param_t){
+		.requires_grad = 1,
+	}, TENSOR_LIST(small_x), TENSOR_LIST(small_y), 0, 0);
+	ccv_cnnp_model_backward(multi_layer, TENSOR_LIST(small_ingrad), 0, 0, 0, 0);
+	ccv_cnnp_model_apply_gradients(multi_layer, 0);
+	REQUIRE_EQ(compiled_data->reshapes->rnum, 3, "the model should be built for the maximum shapes and the 2 input shapes");
+	// Update the learning rate, and freeze the last layer, as a training loop would do every step.
+	ccv_cnnp_model_set_minimizer(multi_layer, CMD_SGD_FORWARD(0, 0.02, 1, 0.01, 0, 0), 0, 0, 0);
+	ccv_cnnp_model_set_minimizer(multi_layer, CMD_SGD_FORWARD(0, 0, 1, 0, 0, 0), 0, MODEL_IO_LIST(ccv_cnnp_model_parameters(last, ALL_PARAMETERS, ALL_PARAMETERS)));
+	REQUIRE_EQ(compiled_data->reshapes->rnum, 3, "the shapes should be kept when the minimizer is updated");
+	ccv_nnc_tensor_t* const weight = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 2), 0);
+	ccv_nnc_tensor_t* const updated_weight = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 2), 0);
+	ccv_cnnp_model_parameter_copy(multi_layer, ccv_cnnp_model_parameters(last, CCV_CNNP_PARAMETER_SELECT_WEIGHT, 0), weight);
+	ccv_cnnp_model_evaluate(multi_layer, (ccv_cnnp_evaluate_param_t){
+		.requires_grad = 1,
+	}, TENSOR_LIST(x_tensor), TENSOR_LIST(y_tensor), 0, 0);
+	ccv_cnnp_model_backward(multi_layer, TENSOR_LIST(ingrad), 0, 0, 0, 0);
+	ccv_cnnp_model_apply_gradients(multi_layer, 0);
+	ccv_cnnp_model_parameter_copy(multi_layer, ccv_cnnp_model_parameters(last, CCV_CNNP_PARAMETER_SELECT_WEIGHT, 0), updated_weight);
+	REQUIRE(graph == compiled_data->graph, "the concrete graph should not be compiled again");
+	REQUIRE(tensor_arena == compiled_data->tensor_arena, "the tensor arena should be re-initialized in place");
+	REQUIRE_EQ(compiled_data->reshapes->rnum, 3, "getting back to the first shapes should not build the model again");
+	REQUIRE_ARRAY_EQ(float, updated_weight->data.f32, weight->data.f32, 2, "the last layer should stay frozen");
+	int frozen = 0, updated = 0;
+	for (i = 0; i < compiled_data->parameters->rnum; i++)
+	{
+		const ccv_nnc_cmd_t minimizer = ccv_nnc_graph_exec_symbol_cmd(multi_layer->graph, compiled_data->update_nodes[i]);
+		if (minimizer.info.sgd.rate == 0)
+			++frozen;
+		else if (minimizer.info.sgd.rate == 0.02f)
+			++updated;
+	}
+	REQUIRE_EQ(frozen, 2, "the weight and bias of the last layer should have the per parameter minimizer");
+	REQUIRE_EQ(updated, 4, "the other parameters should have the updated learning rate");
+	ccv_nnc_tensor_free(updated_weight);
+	ccv_nnc_tensor_free(weight);
+	ccv_nnc_tensor_free(small_ingrad);
+	ccv_nnc_tensor_free(small_y);
+	ccv_nnc_tensor_free(small_x);
+	ccv_nnc_tensor_free(ingrad);
+	ccv_nnc_tensor_free(y_tensor);
+	ccv_nnc_tensor_free(x_tensor);
+	ccv_cnnp_model_free(multi_layer);
+}
+
 TEST_CASE("use linear model's parameter as the input for more computation")
 {
 	ccv_cnnp_model_t* const linear = ccv_cnnp_dense(1, 0, 0);
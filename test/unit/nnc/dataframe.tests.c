@@ -701,4 +701,582 @@ TEST_CASE("iterate through derived column with peek")
 	ccv_cnnp_dataframe_free(dataframe);
 }
 
+static void _ccv_int_box(void* const* const* const column_data, const int column_size, const int batch_size, void** const data, void* const context, ccv_nnc_stream_context_t* const stream_context)
+{
+	int i;
+	for (i = 0; i < batch_size; i++)
+	{
+		if (!data[i])
+			data[i] = ccmalloc(sizeof(int));
+		*(int*)data[i] = (int)(intptr_t)column_data[0][i] * 2;
+	}
+}
+
+static void _ccv_int_box_deinit(void* const data, void* const context)
+{
+	ccfree(data);
+}
+
+TEST_CASE("iterate through an asynchronous iterator")
+{
+	int int_array[8] = {
+		2, 3, 4, 5, 6, 7, 8, 9
+	};
+	ccv_cnnp_column_data_t columns[] = {
+		{
+			.data_enum = _ccv_iter_int,
+			.context = int_array,
+		}
+	};
+	ccv_cnnp_dataframe_t* const dataframe = ccv_cnnp_dataframe_new(columns, sizeof(columns) / sizeof(columns[0]), 8);
+	const int derived = ccv_cnnp_dataframe_map(dataframe, _ccv_int_plus_1, 0, 0, COLUMN_ID_LIST(0), 0, 0, 0);
+	const int boxed = ccv_cnnp_dataframe_map(dataframe, _ccv_int_box, 0, _ccv_int_box_deinit, COLUMN_ID_LIST(derived), 0, 0, 0);
+	ccv_cnnp_dataframe_iter_t* const iter = ccv_cnnp_dataframe_async_iter_new(dataframe, COLUMN_ID_LIST(0, boxed), 3);
+	int result0[8];
+	int result1[8];
+	int should_result1[8];
+	int i, j;
+	for (i = 0; i < 8; i++)
+		should_result1[i] = (int_array[i] + 1) * 2;
+	void* data[2];
+	for (j = 0; j < 2; j++)
+	{
+		ccv_cnnp_dataframe_iter_prefetch(iter, 1, 0);
+		i = 0;
+		while (0 == ccv_cnnp_dataframe_iter_next(iter, data, 2, 0))
+		{
+			result0[i] = (int)(intptr_t)data[0];
+			result1[i] = *(int*)data[1];
+			void* peek;
+			ccv_cnnp_dataframe_iter_peek(iter, &peek, 1, 1, 0);
+			REQUIRE(peek == data[1], "peek should return the same data");
+			++i;
+		}
+		REQUIRE_EQ(i, 8, "should iterate through all rows");
+		REQUIRE_EQ(ccv_cnnp_dataframe_iter_next(iter, data, 2, 0), -2, "already ended");
+		REQUIRE_EQ(ccv_cnnp_dataframe_iter_prefetch(iter, 1, 0), -1, "cannot advance no more");
+		REQUIRE_ARRAY_EQ(int, int_array, result0, 8, "iterated result and actual result should be the same");
+		REQUIRE_ARRAY_EQ(int, should_result1, result1, 8, "iterated result and actual result should be the same");
+		ccv_cnnp_dataframe_iter_set_cursor(iter, 0);
+	}
+	// Restart in the middle, the ready rows should be discarded.
+	for (i = 0; i < 2; i++)
+		ccv_cnnp_dataframe_iter_next(iter, data, 2, 0);
+	ccv_cnnp_dataframe_iter_set_cursor(iter, 5);
+	for (i = 5; i < 8; i++)
+	{
+		REQUIRE_EQ(ccv_cnnp_dataframe_iter_next(iter, data, 2, 0), 0, "should have more rows");
+		REQUIRE_EQ((int)(intptr_t)data[0], int_array[i], "should continue from the cursor");
+		REQUIRE_EQ(*(int*)data[1], should_result1[i], "should continue from the cursor");
+	}
+	REQUIRE_EQ(ccv_cnnp_dataframe_iter_next(iter, data, 2, 0), -1, "no more rows");
+	// Free while the producer is in the middle of the dataframe.
+	ccv_cnnp_dataframe_iter_set_cursor(iter, 0);
+	ccv_cnnp_dataframe_iter_next(iter, data, 2, 0);
+	ccv_cnnp_dataframe_iter_free(iter);
+	ccv_cnnp_dataframe_free(dataframe);
+}
+
+TEST_CASE("iterate through records from shards")
+{
+	const char* const filenames[] = {
+		"/tmp/dataframe_shard_0.shard",
+		"/tmp/dataframe_shard_1.shard",
+		"/tmp/dataframe_shard_2.shard",
+	};
+	int i, j, k;
+	for (i = 0; i < 3; i++)
+		remove(filenames[i]);
+	for (i = 0; i < 3; i++)
+	{
+		ccv_cnnp_shard_writer_t* const writer = ccv_cnnp_shard_writer_new(filenames[i]);
+		for (j = 0; j < 10; j++)
+		{
+			const int id = i * 10 + j;
+			int values[8];
+			for (k = 0; k <= id % 8; k++)
+				values[k] = id;
+			char meta[16];
+			snprintf(meta, sizeof(meta), "%d", id);
+			ccv_cnnp_shard_writer_add(writer, values, sizeof(int) * (id % 8 + 1), meta, strlen(meta));
+		}
+		REQUIRE_EQ(ccv_cnnp_shard_writer_free(writer), 0, "the shard should be written");
+	}
+	// A small buffer such that each shard is read in several chunks.
+	ccv_cnnp_dataframe_t* const dataframe = ccv_cnnp_dataframe_from_shards_new(filenames, 3, 64);
+	REQUIRE_EQ(ccv_cnnp_dataframe_row_count(dataframe), 30, "should have all the records");
+	int result[30];
+	int seen[30];
+	int should_result[30];
+	for (i = 0; i < 30; i++)
+		should_result[i] = i;
+	for (j = 0; j < 2; j++)
+	{
+		ccv_cnnp_dataframe_iter_t* const iter = ccv_cnnp_dataframe_iter_new(dataframe, COLUMN_ID_LIST(0));
+		void* data;
+		memset(seen, 0, sizeof(seen));
+		for (i = 0; 0 == ccv_cnnp_dataframe_iter_next(iter, &data, 1, 0); i++)
+		{
+			const ccv_cnnp_record_t* const record = (ccv_cnnp_record_t*)data;
+			const int id = atoi(record->meta);
+			REQUIRE_EQ(record->size, sizeof(int) * (id % 8 + 1), "the size should match");
+			for (k = 0; k <= id % 8; k++)
+				REQUIRE_EQ(((int*)record->data)[k], id, "the data should match");
+			result[i] = id;
+			++seen[id];
+		}
+		ccv_cnnp_dataframe_iter_free(iter);
+		REQUIRE_EQ(i, 30, "should iterate through all the records");
+		if (j == 0)
+			REQUIRE_ARRAY_EQ(int, result, should_result, 30, "without shuffle, the records are in order");
+		for (i = 0; i < 30; i++)
+			REQUIRE_EQ(seen[i], 1, "each record should be seen once");
+		ccv_cnnp_dataframe_shards_shuffle(dataframe);
+	}
+	ccv_cnnp_dataframe_free(dataframe);
+	// Truncate the second shard after the dataframe is created, its rows should be 0 while the others are still read.
+	ccv_cnnp_dataframe_t* const truncated = ccv_cnnp_dataframe_from_shards_new(filenames, 3, 64);
+	fclose(fopen(filenames[1], "wb"));
+	ccv_cnnp_dataframe_iter_t* const iter = ccv_cnnp_dataframe_iter_new(truncated, COLUMN_ID_LIST(0));
+	void* data;
+	for (i = 0; 0 == ccv_cnnp_dataframe_iter_next(iter, &data, 1, 0); i++)
+	{
+		const ccv_cnnp_record_t* const record = (ccv_cnnp_record_t*)data;
+		if (i >= 10 && i < 20)
+		{
+			REQUIRE(record == 0, "the records of the truncated shard cannot be read");
+		} else {
+			REQUIRE(record != 0, "the records of the other shards should be read");
+			REQUIRE_EQ(atoi(record->meta), i, "the records should be in order");
+		}
+	}
+	REQUIRE_EQ(i, 30, "should iterate through all the rows");
+	ccv_cnnp_dataframe_iter_free(iter);
+	ccv_cnnp_dataframe_free(truncated);
+	for (i = 0; i < 3; i++)
+		remove(filenames[i]);
+	const char* const not_shard[] = {
+		"data/quote.csv"
+	};
+	REQUIRE(ccv_cnnp_dataframe_from_shards_new(not_shard, 1, 0) == 0, "not a shard");
+}
+
+TEST_CASE("decode image from shards")
+{
+	FILE* const r = fopen("../../../samples/nature.png", "rb");
+	fseek(r, 0, SEEK_END);
+	const long size = ftell(r);
+	fseek(r, 0, SEEK_SET);
+	void* const bytes = ccmalloc(size);
+	fread(bytes, 1, size, r);
+	fclose(r);
+	const char* const filenames[] = {
+		"/tmp/dataframe_shard_image.shard"
+	};
+	remove(filenames[0]);
+	ccv_cnnp_shard_writer_t* const writer = ccv_cnnp_shard_writer_new(filenames[0]);
+	ccv_cnnp_shard_writer_add(writer, bytes, size, 0, 0);
+	REQUIRE_EQ(ccv_cnnp_shard_writer_free(writer), 0, "the shard should be written");
+	ccfree(bytes);
+	ccv_cnnp_dataframe_t* const dataframe = ccv_cnnp_dataframe_from_shards_new(filenames, 1, 0);
+	const int image_idx = ccv_cnnp_dataframe_decode_image(dataframe, 0, 0);
+	ccv_cnnp_dataframe_iter_t* const iter = ccv_cnnp_dataframe_iter_new(dataframe, COLUMN_ID_LIST(image_idx));
+	ccv_dense_matrix_t* image = 0;
+	REQUIRE_EQ(ccv_cnnp_dataframe_iter_next(iter, (void**)&image, 1, 0), 0, "should have the image");
+	ccv_dense_matrix_t* should_image = 0;
+	ccv_read("../../../samples/nature.png", &should_image, CCV_IO_ANY_FILE | CCV_IO_RGB_COLOR);
+	REQUIRE_MATRIX_EQ(image, should_image, "decoded image should be the same as read from the file");
+	ccv_matrix_free(should_image);
+	ccv_cnnp_dataframe_iter_free(iter);
+	ccv_cnnp_dataframe_free(dataframe);
+	remove(filenames[0]);
+}
+
+typedef struct {
+	int c;
+} ccv_cnnp_label_t;
+
+static void _ccv_cnnp_label_from_record(void* const* const* const column_data, const int column_size, const int batch_size, void** const data, void* const context, ccv_nnc_stream_context_t* const stream_context)
+{
+	int i;
+	for (i = 0; i < batch_size; i++)
+	{
+		const ccv_cnnp_record_t* const record = (const ccv_cnnp_record_t*)column_data[0][i];
+		if (!data[i])
+			data[i] = ccmalloc(sizeof(ccv_cnnp_label_t));
+		// The record cannot be read, label it as 0.
+		((ccv_cnnp_label_t*)data[i])->c = record ? atoi(record->meta) : 0;
+	}
+}
+
+static void _ccv_cnnp_label_deinit(void* const data, void* const context)
+{
+	ccfree(data);
+}
+
+TEST_CASE("iterate through the images from shards with a corrupted shard")
+{
+	FILE* const r = fopen("../../../samples/nature.png", "rb");
+	fseek(r, 0, SEEK_END);
+	const long size = ftell(r);
+	fseek(r, 0, SEEK_SET);
+	void* const bytes = ccmalloc(size);
+	fread(bytes, 1, size, r);
+	fclose(r);
+	const char* const filenames[] = {
+		"/tmp/dataframe_shard_image_0.shard",
+		"/tmp/dataframe_shard_image_1.shard",
+	};
+	int i, j;
+	for (i = 0; i < 2; i++)
+		remove(filenames[i]);
+	// The first shard has an image and a record that is not an image, the second shard will be truncated.
+	ccv_cnnp_shard_writer_t* writer = ccv_cnnp_shard_writer_new(filenames[0]);
+	ccv_cnnp_shard_writer_add(writer, bytes, size, "1", 1);
+	const char not_image[1024] = {};
+	ccv_cnnp_shard_writer_add(writer, not_image, sizeof(not_image), "2", 1);
+	REQUIRE_EQ(ccv_cnnp_shard_writer_free(writer), 0, "the shard should be written");
+	writer = ccv_cnnp_shard_writer_new(filenames[1]);
+	ccv_cnnp_shard_writer_add(writer, bytes, size, "1", 1);
+	ccv_cnnp_shard_writer_add(writer, bytes, size, "2", 1);
+	REQUIRE_EQ(ccv_cnnp_shard_writer_free(writer), 0, "the shard should be written");
+	ccfree(bytes);
+	ccv_cnnp_dataframe_t* const dataframe = ccv_cnnp_dataframe_from_shards_new(filenames, 2, 0);
+	fclose(fopen(filenames[1], "wb"));
+	const int image_idx = ccv_cnnp_dataframe_decode_image(dataframe, 0, 0);
+	const int label_idx = ccv_cnnp_dataframe_map(dataframe, _ccv_cnnp_label_from_record, 0, _ccv_cnnp_label_deinit, COLUMN_ID_LIST(0), 0, 0, 0);
+	const ccv_cnnp_random_jitter_t random_jitter = {
+		.brightness = 0.4,
+		.contrast = 0.4,
+		.saturation = 0.4,
+		.symmetric = 1,
+		.seed = 1,
+		.resize = {
+			.min = 32,
+			.max = 48,
+		},
+		.size = {
+			.rows = 32,
+			.cols = 32,
+		},
+		.normalize = {
+			.mean = {
+				123.68, 116.779, 103.939
+			},
+			.std = {
+				58.393, 57.12, 57.375
+			},
+		},
+	};
+	const int jitter_idx = ccv_cnnp_dataframe_image_random_jitter(dataframe, image_idx, CCV_32F, random_jitter, 0);
+	const int jitter_tensor_idx = ccv_cnnp_dataframe_image_random_jitter_tensor(dataframe, image_idx, CCV_32F, CCV_TENSOR_FORMAT_NCHW, random_jitter, 0);
+	const int one_hot_idx = ccv_cnnp_dataframe_one_hot(dataframe, label_idx, offsetof(ccv_cnnp_label_t, c), 3, 1, 0, CCV_32F, CCV_TENSOR_FORMAT_NCHW, 0);
+	ccv_cnnp_dataframe_iter_t* iter = ccv_cnnp_dataframe_iter_new(dataframe, COLUMN_ID_LIST(jitter_idx));
+	ccv_dense_matrix_t* image = 0;
+	for (i = 0; 0 == ccv_cnnp_dataframe_iter_next(iter, (void**)&image, 1, 0); i++)
+	{
+		REQUIRE(image, "there should be an image for each row");
+		REQUIRE(image->rows == 32 && image->cols == 32 && CCV_GET_CHANNEL(image->type) == CCV_C3, "the image should be at the final size");
+		int nonzero = 0;
+		for (j = 0; j < 32 * 32 * 3; j++)
+			nonzero += (image->data.f32[j] != 0);
+		if (i == 0)
+			{ REQUIRE(nonzero > 0, "the image should be jittered"); }
+		else
+			{ REQUIRE_EQ(nonzero, 0, "the image cannot be read or decoded, it should be 0"); }
+	}
+	REQUIRE_EQ(i, 4, "should iterate through all the rows");
+	ccv_cnnp_dataframe_iter_free(iter);
+	ccv_cnnp_dataframe_t* const batch = ccv_cnnp_dataframe_combine_new(dataframe, COLUMN_ID_LIST(jitter_tensor_idx, one_hot_idx), 2, 1, CCV_TENSOR_FORMAT_NCHW);
+	iter = ccv_cnnp_dataframe_iter_new(batch, COLUMN_ID_LIST(0));
+	ccv_nnc_tensor_t** tensors = 0;
+	for (i = 0; 0 == ccv_cnnp_dataframe_iter_next(iter, (void**)&tensors, 1, 0); i++)
+	{
+		REQUIRE(ccv_nnc_tensor_count(tensors[0]->info) == 2 * 3 * 32 * 32, "the batch should have 2 images at the final size");
+		int nonzero = 0;
+		for (j = 0; j < 3 * 32 * 32; j++)
+			nonzero += (tensors[0]->data.f32[j] != 0);
+		if (i == 0)
+			{ REQUIRE(nonzero > 0, "the image should be jittered"); }
+		else
+			{ REQUIRE_EQ(nonzero, 0, "the image cannot be read, it should be 0"); }
+		nonzero = 0;
+		for (j = 3 * 32 * 32; j < 2 * 3 * 32 * 32; j++)
+			nonzero += (tensors[0]->data.f32[j] != 0);
+		REQUIRE_EQ(nonzero, 0, "the image cannot be read or decoded, it should be 0");
+		const float label_0[] = {
+			0, 1, 0, 0, 0, 1
+		};
+		const float label_1[] = {
+			1, 0, 0, 1, 0, 0
+		};
+		REQUIRE_ARRAY_EQ(float, tensors[1]->data.f32, i == 0 ? label_0 : label_1, 6, "the records cannot be read should be labeled as 0");
+	}
+	REQUIRE_EQ(i, 2, "should iterate through all the batches");
+	ccv_cnnp_dataframe_iter_free(iter);
+	ccv_cnnp_dataframe_free(batch);
+	ccv_cnnp_dataframe_free(dataframe);
+	for (i = 0; i < 2; i++)
+		remove(filenames[i]);
+}
+
+TEST_CASE("random jitter into tensor is close to random jitter on image")
+{
+	ccv_array_t* const array = ccv_array_new(sizeof(char*), 2, 0);
+	const char* const filename = "../../../samples/nature.png";
+	ccv_array_push(array, &filename);
+	ccv_array_push(array, &filename);
+	ccv_cnnp_dataframe_t* const dataframe = ccv_cnnp_dataframe_from_array_new(array);
+	const int image_idx = ccv_cnnp_dataframe_read_image(dataframe, 0, 0, 0);
+	const ccv_cnnp_random_jitter_t random_jitter = {
+		.brightness = 0.4,
+		.contrast = 0.4,
+		.saturation = 0.4,
+		.lighting = 0.1,
+		.aspect_ratio = 0.5,
+		.symmetric = 1,
+		.seed = 1,
+		.resize = {
+			.min = 180,
+			.max = 480,
+		},
+		.size = {
+			.rows = 224,
+			.cols = 224,
+		},
+		.normalize = {
+			.mean = {
+				123.68, 116.779, 103.939
+			},
+			.std = {
+				58.393, 57.12, 57.375
+			},
+		},
+	};
+	const int jitter_idx = ccv_cnnp_dataframe_image_random_jitter(dataframe, image_idx, CCV_32F, random_jitter, 0);
+	const int tensor_idx = ccv_cnnp_dataframe_image_random_jitter_tensor(dataframe, image_idx, CCV_32F, CCV_TENSOR_FORMAT_NHWC, random_jitter, 0);
+	const int half_idx = ccv_cnnp_dataframe_image_random_jitter_tensor(dataframe, image_idx, CCV_16F, CCV_TENSOR_FORMAT_NCHW, random_jitter, 0);
+	ccv_cnnp_dataframe_iter_t* const iter = ccv_cnnp_dataframe_iter_new(dataframe, COLUMN_ID_LIST(jitter_idx, tensor_idx, half_idx));
+	void* data[3];
+	int i, j, k;
+	for (i = 0; i < 2; i++)
+	{
+		REQUIRE_EQ(ccv_cnnp_dataframe_iter_next(iter, data, 3, 0), 0, "should have the images");
+		ccv_dense_matrix_t* const image = (ccv_dense_matrix_t*)data[0];
+		ccv_nnc_tensor_t* const tensor = (ccv_nnc_tensor_t*)data[1];
+		ccv_nnc_tensor_t* const half = (ccv_nnc_tensor_t*)data[2];
+		REQUIRE_EQ(tensor->info.dim[0], 224, "should have the same rows");
+		REQUIRE_EQ(tensor->info.dim[1], 224, "should have the same cols");
+		REQUIRE_EQ(tensor->info.dim[2], 3, "should have the same channels");
+		REQUIRE_ARRAY_EQ_WITH_TOLERANCE(float, tensor->data.f32, image->data.f32, 224 * 224 * 3, 1e-3, "the tensor should be the same as the image");
+		float* const f32 = (float*)ccmalloc(sizeof(float) * 224 * 224 * 3 * 2);
+		float* const nchw = f32 + 224 * 224 * 3;
+		ccv_half_precision_to_float((uint16_t*)half->data.f16, f32, 224 * 224 * 3);
+		for (j = 0; j < 224 * 224; j++)
+			for (k = 0; k < 3; k++)
+				nchw[j * 3 + k] = f32[k * 224 * 224 + j];
+		REQUIRE_ARRAY_EQ_WITH_TOLERANCE(float, nchw, tensor->data.f32, 224 * 224 * 3, 1e-2, "the half precision tensor in NCHW should be the same");
+		ccfree(f32);
+	}
+	ccv_cnnp_dataframe_iter_free(iter);
+	ccv_cnnp_dataframe_free(dataframe);
+	ccv_array_free(array);
+}
+
+typedef struct {
+	int size; // The number of elements that have the expected shape in both.
+	int padding; // The number of elements that are 0 padding in both.
+	int mismatch; // The number of elements that are 0 padding in one but not the other.
+	float mean_diff;
+	float max_diff;
+} ccv_cnnp_random_jitter_difference_t;
+
+static ccv_cnnp_random_jitter_difference_t _ccv_cnnp_random_jitter_difference(const ccv_cnnp_random_jitter_t random_jitter)
+{
+	ccv_array_t* const array = ccv_array_new(sizeof(char*), 2, 0);
+	const char* const filename = "../../../samples/nature.png";
+	ccv_array_push(array, &filename);
+	ccv_array_push(array, &filename);
+	ccv_cnnp_dataframe_t* const dataframe = ccv_cnnp_dataframe_from_array_new(array);
+	const int image_idx = ccv_cnnp_dataframe_read_image(dataframe, 0, 0, 0);
+	const int jitter_idx = ccv_cnnp_dataframe_image_random_jitter(dataframe, image_idx, CCV_32F, random_jitter, 0);
+	const int tensor_idx = ccv_cnnp_dataframe_image_random_jitter_tensor(dataframe, image_idx, CCV_32F, CCV_TENSOR_FORMAT_NHWC, random_jitter, 0);
+	ccv_cnnp_dataframe_iter_t* const iter = ccv_cnnp_dataframe_iter_new(dataframe, COLUMN_ID_LIST(jitter_idx, tensor_idx));
+	const int size = random_jitter.size.rows * random_jitter.size.cols * 3;
+	void* data[2];
+	double sum = 0;
+	ccv_cnnp_random_jitter_difference_t difference = {};
+	int i, j;
+	for (i = 0; i < 2 && ccv_cnnp_dataframe_iter_next(iter, data, 2, 0) == 0; i++)
+	{
+		const ccv_dense_matrix_t* const image = (ccv_dense_matrix_t*)data[0];
+		const ccv_nnc_tensor_t* const tensor = (ccv_nnc_tensor_t*)data[1];
+		if (image->rows * image->cols * 3 != size || ccv_nnc_tensor_count(tensor->info) != size)
+			continue;
+		difference.size += size;
+		for (j = 0; j < size; j++)
+		{
+			const float diff = fabsf(image->data.f32[j] - tensor->data.f32[j]);
+			sum += diff;
+			difference.max_diff = ccv_max(difference.max_diff, diff);
+			if (image->data.f32[j] == 0 && tensor->data.f32[j] == 0)
+				++difference.padding;
+			else if (image->data.f32[j] == 0 || tensor->data.f32[j] == 0)
+				++difference.mismatch;
+		}
+	}
+	difference.mean_diff = difference.size > 0 ? sum / difference.size : 0;
+	ccv_cnnp_dataframe_iter_free(iter);
+	ccv_cnnp_dataframe_free(dataframe);
+	ccv_array_free(array);
+	return difference;
+}
+
+TEST_CASE("random jitter into tensor scales up close to random jitter on image")
+{
+	const ccv_cnnp_random_jitter_t random_jitter = {
+		.brightness = 0.4,
+		.contrast = 0.4,
+		.saturation = 0.4,
+		.symmetric = 1,
+		.seed = 1,
+		.resize = {
+			.min = 640,
+			.max = 720,
+		},
+		.size = {
+			.rows = 224,
+			.cols = 224,
+		},
+		.normalize = {
+			.mean = {
+				123.68, 116.779, 103.939
+			},
+			.std = {
+				58.393, 57.12, 57.375
+			},
+		},
+	};
+	const ccv_cnnp_random_jitter_difference_t difference = _ccv_cnnp_random_jitter_difference(random_jitter);
+	REQUIRE_EQ(difference.size, 224 * 224 * 3 * 2, "both images should be cropped to the size");
+	REQUIRE_EQ(difference.mismatch, 0, "there shouldn't be 0 padding on either side");
+	// The image is upscaled with bicubic, the tensor with bilinear, and the contrast mean is taken on the
+	// resized image versus the source region, these only differ by a small fraction of the std on average,
+	// but sharp edges can overshoot with bicubic.
+	REQUIRE(difference.mean_diff < 0.08, "the tensor should be close to the image on average");
+	REQUIRE(difference.max_diff < 1.2, "the tensor shouldn't be far off from the image anywhere");
+}
+
+TEST_CASE("random jitter into tensor pads the crop with 0 as random jitter on image")
+{
+	const ccv_cnnp_random_jitter_t random_jitter = {
+		.brightness = 0.4,
+		.contrast = 0.4,
+		.saturation = 0.4,
+		.symmetric = 1,
+		.seed = 1,
+		.resize = {
+			.min = 100,
+			.max = 120,
+		},
+		.offset = {
+			.x = 10,
+			.y = 10,
+		},
+		.size = {
+			.rows = 224,
+			.cols = 224,
+		},
+		.normalize = {
+			.mean = {
+				123.68, 116.779, 103.939
+			},
+			.std = {
+				58.393, 57.12, 57.375
+			},
+		},
+	};
+	const ccv_cnnp_random_jitter_difference_t difference = _ccv_cnnp_random_jitter_difference(random_jitter);
+	REQUIRE_EQ(difference.size, 224 * 224 * 3 * 2, "both images should be cropped to the size");
+	REQUIRE(difference.padding > 0, "the crop should be padded with 0");
+	// The 0 padding is not touched by the color changes or the normalization, it should be at the same place.
+	REQUIRE_EQ(difference.mismatch, 0, "the 0 padding should be at the same place");
+	REQUIRE(difference.mean_diff < 1e-3, "the tensor should be the same as the image on average");
+	REQUIRE(difference.max_diff < 1e-3, "the tensor should be the same as the image");
+}
+
+TEST_CASE("read csv file the same way with and without AVX2")
+{
+	const int cpu_features = ccv_nnc_cpu_features();
+	FILE* const f = fopen("data/scaled_data.csv", "r");
+	int column_size = 0;
+	ccv_cnnp_dataframe_t* const dataframe = ccv_cnnp_dataframe_from_csv_new(f, CCV_CNNP_DATAFRAME_CSV_FILE, 0, ',', '"', 1, &column_size);
+	ccv_nnc_set_cpu_features(0);
+	FILE* const g = fopen("data/scaled_data.csv", "r");
+	int sse2_column_size = 0;
+	ccv_cnnp_dataframe_t* const sse2_dataframe = ccv_cnnp_dataframe_from_csv_new(g, CCV_CNNP_DATAFRAME_CSV_FILE, 0, ',', '"', 1, &sse2_column_size);
+	ccv_nnc_set_cpu_features(cpu_features);
+	REQUIRE(dataframe, "should parse the file");
+	REQUIRE(sse2_dataframe, "should parse the file");
+	REQUIRE_EQ(column_size, sse2_column_size, "should have the same number of columns");
+	REQUIRE_EQ(ccv_cnnp_dataframe_row_count(dataframe), ccv_cnnp_dataframe_row_count(sse2_dataframe), "should have the same number of rows");
+	int i, j;
+	for (i = 0; i < column_size; i++)
+		REQUIRE(strcmp(ccv_cnnp_dataframe_column_name(dataframe, i), ccv_cnnp_dataframe_column_name(sse2_dataframe, i)) == 0, "should have the same header");
+	int* const column_idxs = (int*)ccmalloc(sizeof(int) * column_size);
+	for (i = 0; i < column_size; i++)
+		column_idxs[i] = i;
+	void** const data = (void**)ccmalloc(sizeof(void*) * column_size * 2);
+	void** const sse2_data = data + column_size;
+	ccv_cnnp_dataframe_iter_t* const iter = ccv_cnnp_dataframe_iter_new(dataframe, column_idxs, column_size);
+	ccv_cnnp_dataframe_iter_t* const sse2_iter = ccv_cnnp_dataframe_iter_new(sse2_dataframe, column_idxs, column_size);
+	while (0 == ccv_cnnp_dataframe_iter_next(iter, data, column_size, 0))
+	{
+		REQUIRE_EQ(ccv_cnnp_dataframe_iter_next(sse2_iter, sse2_data, column_size, 0), 0, "should have the same row");
+		for (j = 0; j < column_size; j++)
+			REQUIRE(data[j] == sse2_data[j] || strcmp((char*)data[j], (char*)sse2_data[j]) == 0, "should have the same cell");
+	}
+	ccv_cnnp_dataframe_iter_free(iter);
+	ccv_cnnp_dataframe_iter_free(sse2_iter);
+	ccfree(data);
+	ccfree(column_idxs);
+	ccv_cnnp_dataframe_free(dataframe);
+	ccv_cnnp_dataframe_free(sse2_dataframe);
+	fclose(f);
+	fclose(g);
+}
+
+TEST_CASE("parse csv columns into numerics")
+{
+	char csv[] = "a,b,c\n1.5,2,\"-3.25\"\n-4e2, 5 ,\r\n1.5e-30,abc,0.125\n";
+	int column_size = 0;
+	ccv_cnnp_dataframe_t* const dataframe = ccv_cnnp_dataframe_from_csv_new(csv, CCV_CNNP_DATAFRAME_CSV_MEMORY, sizeof(csv) - 1, ',', '"', 1, &column_size);
+	REQUIRE_EQ(column_size, 3, "should have 3 columns");
+	const int f32_idx = ccv_cnnp_dataframe_csv_numeric(dataframe, COLUMN_ID_LIST(0, 1, 2), CCV_32F, 0);
+	const int i32_idx = ccv_cnnp_dataframe_csv_numeric(dataframe, COLUMN_ID_LIST(1), CCV_32S, 0);
+	ccv_cnnp_dataframe_iter_t* const iter = ccv_cnnp_dataframe_iter_new(dataframe, COLUMN_ID_LIST(f32_idx, i32_idx));
+	const float f32[] = {
+		1.5, 2, -3.25,
+		-400, 5, 0,
+		1.5e-30, 0, 0.125,
+	};
+	const int i32[] = {
+		2, 5, 0,
+	};
+	int i;
+	void* data[2];
+	for (i = 0; i < 3; i++)
+	{
+		REQUIRE_EQ(ccv_cnnp_dataframe_iter_next(iter, data, 2, 0), 0, "should have the row");
+		ccv_nnc_tensor_t* const f32_tensor = (ccv_nnc_tensor_t*)data[0];
+		ccv_nnc_tensor_t* const i32_tensor = (ccv_nnc_tensor_t*)data[1];
+		REQUIRE_EQ(f32_tensor->info.dim[0], 3, "should have 3 values");
+		REQUIRE_ARRAY_EQ_WITH_TOLERANCE(float, f32_tensor->data.f32, f32 + i * 3, 3, 1e-5, "should be parsed");
+		REQUIRE_EQ(i32_tensor->data.i32[0], i32[i], "should be parsed");
+	}
+	REQUIRE_EQ(ccv_cnnp_dataframe_iter_next(iter, data, 2, 0), -1, "should have no more rows");
+	ccv_cnnp_dataframe_iter_free(iter);
+	ccv_cnnp_dataframe_free(dataframe);
+}
+
 #include "case_main.h"
@@ -23,6 +23,30 @@ TEST_CASE("dynamic graph to compute log(19)")
 	ccv_nnc_dynamic_graph_free(graph);
 }
 
+TEST_CASE("dynamic graph reuses freed CPU memory up to the high-water mark")
+{
+	ccv_nnc_dynamic_graph_t* const graph = ccv_nnc_dynamic_graph_new();
+	ccv_nnc_tensor_variable_t a = ccv_nnc_tensor_variable_new(graph, CPU_TENSOR_NHWC(32F, 1024));
+	void* const ptr = ccv_nnc_tensor_from_variable(graph, a)->data.ptr;
+	ccv_nnc_tensor_variable_free(graph, a);
+	ccv_nnc_tensor_variable_t b = ccv_nnc_tensor_variable_new(graph, CPU_TENSOR_NHWC(32F, 512));
+	REQUIRE(ccv_nnc_tensor_from_variable(graph, b)->data.ptr == ptr, "a smaller tensor should reuse the freed memory");
+	ccv_nnc_tensor_from_variable(graph, b)->data.f32[0] = 19;
+	ccv_nnc_tensor_variable_t c = ccv_nnc_tensor_variable_new(graph);
+	ccv_nnc_dynamic_graph_exec(graph, CMD_EWLOG_FORWARD(), ccv_nnc_no_hint, 0, TENSOR_VARIABLE_LIST(b), TENSOR_VARIABLE_LIST(c), 0, 0);
+	REQUIRE_EQ_WITH_TOLERANCE(ccv_nnc_tensor_from_variable(graph, c)->data.f32[0], logf(19), 1e-5, "log(19) result should be equal.");
+	ccv_nnc_tensor_variable_free(graph, c);
+	ccv_nnc_dynamic_graph_gc(graph);
+	ccv_nnc_dynamic_graph_set_cpu_cache_limit(graph, 1024);
+	ccv_nnc_tensor_variable_free(graph, b); // Over the high-water mark, this is released.
+	ccv_nnc_tensor_variable_t d = ccv_nnc_tensor_variable_new(graph, CPU_TENSOR_NHWC(32F, 128));
+	void* const dptr = ccv_nnc_tensor_from_variable(graph, d)->data.ptr;
+	ccv_nnc_tensor_variable_free(graph, d); // Within the high-water mark, this is retained.
+	ccv_nnc_tensor_variable_t e = ccv_nnc_tensor_variable_new(graph, CPU_TENSOR_NHWC(32F, 128));
+	REQUIRE(ccv_nnc_tensor_from_variable(graph, e)->data.ptr == dptr, "the same size tensor should reuse the freed memory");
+	ccv_nnc_dynamic_graph_free(graph);
+}
+
 TEST_CASE("dynamic graph with alias")
 {
 	ccv_nnc_dynamic_graph_t* const graph = ccv_nnc_dynamic_graph_new();
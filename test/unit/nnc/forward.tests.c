@@ -1,9 +1,11 @@
 #include "case.h"
 #include "ccv_case.h"
+#include "ccv_nnc_case.h"
 #include <ccv.h>
 #include <nnc/ccv_nnc.h>
 #include <nnc/ccv_nnc_easy.h>
 #include "3rdparty/dsfmt/dSFMT.h"
+#include "3rdparty/sqlite3/sqlite3.h"
 
 TEST_SETUP()
 {
@@ -463,4 +465,337 @@ TEST_CASE("average pool network of 54x54 with window of 2x2 and stride of 2")
 	ccv_nnc_tensor_free(a);
 }
 
+TEST_CASE("maximum and average pool with CPU_OPT against CPU_REF")
+{
+	ccv_nnc_tensor_t* a = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 55, 55, 13), 0);
+	ccv_nnc_tensor_t* b = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 27, 27, 13), 0);
+	ccv_nnc_tensor_t* c = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 27, 27, 13), 0);
+	dsfmt_t dsfmt;
+	dsfmt_init_gen_rand(&dsfmt, 0);
+	int i;
+	for (i = 0; i < 55 * 55 * 13; i++)
+		a->data.f32[i] = dsfmt_genrand_open_close(&dsfmt);
+	ccv_nnc_cmd_t cmd = CMD_MAX_POOL_FORWARD(3, 3);
+	ccv_nnc_hint_t hint = ccv_nnc_hint_auto(cmd.info, a->info, b->info);
+	cmd.backend = CCV_NNC_BACKEND_CPU_REF;
+	ccv_nnc_cmd_exec(cmd, hint, 0, TENSOR_LIST(a), TENSOR_LIST(b), 0);
+	cmd.backend = CCV_NNC_BACKEND_CPU_OPT;
+	ccv_nnc_cmd_exec(cmd, hint, 0, TENSOR_LIST(a), TENSOR_LIST(c), 0);
+	REQUIRE_TENSOR_EQ(b, c, "max pool from CPU_OPT should match CPU_REF");
+	cmd = CMD_AVERAGE_POOL_FORWARD(3, 3);
+	cmd.backend = CCV_NNC_BACKEND_CPU_REF;
+	ccv_nnc_cmd_exec(cmd, hint, 0, TENSOR_LIST(a), TENSOR_LIST(b), 0);
+	cmd.backend = CCV_NNC_BACKEND_CPU_OPT;
+	ccv_nnc_cmd_exec(cmd, hint, 0, TENSOR_LIST(a), TENSOR_LIST(c), 0);
+	REQUIRE_TENSOR_EQ(b, c, "average pool from CPU_OPT should match CPU_REF");
+	ccv_nnc_tensor_free(c);
+	ccv_nnc_tensor_free(b);
+	ccv_nnc_tensor_free(a);
+}
+
+static void _ccv_nnc_cmd_exec_ref_opt(ccv_nnc_cmd_t cmd, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const ref, ccv_nnc_tensor_t* const opt)
+{
+	cmd.backend = CCV_NNC_BACKEND_CPU_REF;
+	ccv_nnc_cmd_exec(cmd, ccv_nnc_no_hint, 0, inputs, input_size, &ref, 1, 0);
+	cmd.backend = CCV_NNC_BACKEND_CPU_OPT;
+	ccv_nnc_cmd_exec(cmd, ccv_nnc_no_hint, 0, inputs, input_size, &opt, 1, 0);
+}
+
+TEST_CASE("element-wise and activation commands with CPU_OPT against CPU_REF")
+{
+	ccv_nnc_tensor_t* x = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 8, 1001), 0);
+	ccv_nnc_tensor_t* y = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 8, 1001), 0);
+	ccv_nnc_tensor_t* g = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 8, 1001), 0);
+	ccv_nnc_tensor_t* b = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 8, 1001), 0);
+	ccv_nnc_tensor_t* ref = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 8, 1001), 0);
+	ccv_nnc_tensor_t* opt = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 8, 1001), 0);
+	dsfmt_t dsfmt;
+	dsfmt_init_gen_rand(&dsfmt, 0);
+	int i;
+	for (i = 0; i < 8 * 1001; i++)
+		x->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) * 8 - 4;
+	for (i = 0; i < 8 * 1001; i++)
+		y->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) * 2;
+	for (i = 0; i < 8 * 1001; i++)
+		g->data.f32[i] = dsfmt_genrand_open_close(&dsfmt);
+	_ccv_nnc_cmd_exec_ref_opt(CMD_RELU_FORWARD(), TENSOR_LIST(x), ref, opt);
+	REQUIRE_TENSOR_EQ(ref, opt, "relu from CPU_OPT should match CPU_REF");
+	_ccv_nnc_cmd_exec_ref_opt(CMD_RELU_BACKWARD(), TENSOR_LIST(g, 0, x), ref, opt);
+	REQUIRE_TENSOR_EQ(ref, opt, "relu gradient from CPU_OPT should match CPU_REF");
+	_ccv_nnc_cmd_exec_ref_opt(CMD_SIGMOID_FORWARD(), TENSOR_LIST(x), b, opt);
+	REQUIRE_TENSOR_EQ(b, opt, "sigmoid from CPU_OPT should match CPU_REF");
+	_ccv_nnc_cmd_exec_ref_opt(CMD_SIGMOID_BACKWARD(), TENSOR_LIST(g, 0, b), ref, opt);
+	REQUIRE_TENSOR_EQ(ref, opt, "sigmoid gradient from CPU_OPT should match CPU_REF");
+	_ccv_nnc_cmd_exec_ref_opt(CMD_SOFTMAX_FORWARD(), TENSOR_LIST(x), b, opt);
+	REQUIRE_TENSOR_EQ(b, opt, "softmax from CPU_OPT should match CPU_REF");
+	_ccv_nnc_cmd_exec_ref_opt(CMD_SOFTMAX_BACKWARD(), TENSOR_LIST(g, 0, b), ref, opt);
+	REQUIRE_TENSOR_EQ(ref, opt, "softmax gradient from CPU_OPT should match CPU_REF");
+	_ccv_nnc_cmd_exec_ref_opt(CMD_EWEXP_FORWARD(), TENSOR_LIST(x), ref, opt);
+	REQUIRE_TENSOR_EQ(ref, opt, "exp from CPU_OPT should match CPU_REF");
+	_ccv_nnc_cmd_exec_ref_opt(CMD_EWSUM_FORWARD(), TENSOR_LIST(y, g, y), ref, opt);
+	REQUIRE_TENSOR_EQ(ref, opt, "sum from CPU_OPT should match CPU_REF");
+	_ccv_nnc_cmd_exec_ref_opt(CMD_EWPROD_FORWARD(), TENSOR_LIST(x, g), ref, opt);
+	REQUIRE_TENSOR_EQ(ref, opt, "product from CPU_OPT should match CPU_REF");
+	ccv_nnc_tensor_free(x);
+	ccv_nnc_tensor_free(y);
+	ccv_nnc_tensor_free(g);
+	ccv_nnc_tensor_free(b);
+	ccv_nnc_tensor_free(ref);
+	ccv_nnc_tensor_free(opt);
+}
+
+TEST_CASE("fused convolution, batch norm and activation with CPU_OPT against CPU_REF")
+{
+	// 3x3 goes to Winograd, 1x1 goes to GEMM and 5x5 goes to the direct convolution.
+	const int kernel_sizes[] = { 3, 1, 5 };
+	const uint32_t activations[] = { CCV_NNC_RELU_FORWARD, CCV_NNC_SWISH_FORWARD, CCV_NNC_SIGMOID_FORWARD };
+	ccv_nnc_tensor_t* a = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 31, 31, 16), 0);
+	ccv_nnc_tensor_t* b = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 31, 31, 24), 0);
+	ccv_nnc_tensor_t* c = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 31, 31, 24), 0);
+	ccv_nnc_tensor_t* bias = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 24), 0);
+	ccv_nnc_tensor_t* scale = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 24), 0);
+	ccv_nnc_tensor_t* beta = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 24), 0);
+	ccv_nnc_tensor_t* mean = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 24), 0);
+	ccv_nnc_tensor_t* var = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 24), 0);
+	dsfmt_t dsfmt;
+	dsfmt_init_gen_rand(&dsfmt, 0);
+	int i, j;
+	for (i = 0; i < 31 * 31 * 16; i++)
+		a->data.f32[i] = dsfmt_genrand_open_close(&dsfmt);
+	for (i = 0; i < 24; i++)
+	{
+		bias->data.f32[i] = dsfmt_genrand_open_close(&dsfmt);
+		scale->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) + 0.5;
+		beta->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) + 1;
+		mean->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) * 0.5;
+		var->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) + 0.5;
+	}
+	for (i = 0; i < 3; i++)
+	{
+		const int k = kernel_sizes[i];
+		ccv_nnc_tensor_t* w = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 24, k, k, 16), 0);
+		for (j = 0; j < 24 * k * k * 16; j++)
+			w->data.f32[j] = dsfmt_genrand_open_close(&dsfmt) / (k * k * 16);
+		ccv_nnc_cmd_t cmd = CMD_FUSED_CONVOLUTION_FORWARD(activations[i], 1e-4, 24, k, k, 16);
+		ccv_nnc_hint_t hint = ccv_nnc_hint_auto(cmd.info, a->info, b->info);
+		cmd.backend = CCV_NNC_BACKEND_CPU_REF;
+		ccv_nnc_cmd_exec(cmd, hint, 0, TENSOR_LIST(a, w, bias), TENSOR_LIST(b), 0);
+		cmd.backend = CCV_NNC_BACKEND_CPU_OPT;
+		ccv_nnc_cmd_exec(cmd, hint, 0, TENSOR_LIST(a, w, bias), TENSOR_LIST(c), 0);
+		REQUIRE_TENSOR_EQ(b, c, "fused convolution %dx%d from CPU_OPT should match CPU_REF", k, k);
+		cmd.backend = CCV_NNC_BACKEND_CPU_REF;
+		ccv_nnc_cmd_exec(cmd, hint, 0, TENSOR_LIST(a, w, bias, scale, beta, mean, var), TENSOR_LIST(b), 0);
+		cmd.backend = CCV_NNC_BACKEND_CPU_OPT;
+		ccv_nnc_cmd_exec(cmd, hint, 0, TENSOR_LIST(a, w, bias, scale, beta, mean, var), TENSOR_LIST(c), 0);
+		REQUIRE_TENSOR_EQ(b, c, "fused convolution %dx%d with batch norm from CPU_OPT should match CPU_REF", k, k);
+		ccv_nnc_tensor_free(w);
+	}
+	ccv_nnc_tensor_free(a);
+	ccv_nnc_tensor_free(b);
+	ccv_nnc_tensor_free(c);
+	ccv_nnc_tensor_free(bias);
+	ccv_nnc_tensor_free(scale);
+	ccv_nnc_tensor_free(beta);
+	ccv_nnc_tensor_free(mean);
+	ccv_nnc_tensor_free(var);
+}
+
+TEST_CASE("fused GEMM and element-wise commands with CPU_OPT against CPU_REF")
+{
+	ccv_nnc_tensor_t* a = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 64, 128), 0);
+	ccv_nnc_tensor_t* w = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1001, 128), 0);
+	ccv_nnc_tensor_t* bias = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1001), 0);
+	ccv_nnc_tensor_t* x = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 64, 1001), 0);
+	ccv_nnc_tensor_t* y = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 64, 1001), 0);
+	ccv_nnc_tensor_t* ref = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 64, 1001), 0);
+	ccv_nnc_tensor_t* opt = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 64, 1001), 0);
+	dsfmt_t dsfmt;
+	dsfmt_init_gen_rand(&dsfmt, 0);
+	int i;
+	for (i = 0; i < 64 * 128; i++)
+		a->data.f32[i] = dsfmt_genrand_open_close(&dsfmt);
+	for (i = 0; i < 1001 * 128; i++)
+		w->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) / 128;
+	for (i = 0; i < 1001; i++)
+		bias->data.f32[i] = dsfmt_genrand_open_close(&dsfmt);
+	for (i = 0; i < 64 * 1001; i++)
+		x->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) + 0.5;
+	for (i = 0; i < 64 * 1001; i++)
+		y->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) * 2 - 1;
+	_ccv_nnc_cmd_exec_ref_opt(CMD_FUSED_GEMM_FORWARD(CCV_NNC_SIGMOID_FORWARD), TENSOR_LIST(a, w, bias), ref, opt);
+	REQUIRE_TENSOR_EQ(ref, opt, "fused GEMM from CPU_OPT should match CPU_REF");
+	_ccv_nnc_cmd_exec_ref_opt(CMD_FUSED_GEMM_FORWARD(CCV_NNC_SWISH_FORWARD), TENSOR_LIST(a, w), ref, opt);
+	REQUIRE_TENSOR_EQ(ref, opt, "fused GEMM without bias from CPU_OPT should match CPU_REF");
+	_ccv_nnc_cmd_exec_ref_opt(CMD_FUSED_EW_FORWARD(CCV_NNC_EWSQRT_FORWARD, CCV_NNC_EWSUM_FORWARD, CCV_NNC_EWEXP_FORWARD, CCV_NNC_EWPROD_FORWARD, CCV_NNC_EWLOG_FORWARD, CCV_NNC_SWISH_FORWARD), TENSOR_LIST(x, y, x), ref, opt);
+	REQUIRE_TENSOR_EQ(ref, opt, "fused element-wise commands from CPU_OPT should match CPU_REF");
+	ccv_nnc_tensor_free(a);
+	ccv_nnc_tensor_free(w);
+	ccv_nnc_tensor_free(bias);
+	ccv_nnc_tensor_free(x);
+	ccv_nnc_tensor_free(y);
+	ccv_nnc_tensor_free(ref);
+	ccv_nnc_tensor_free(opt);
+}
+
+TEST_CASE("half precision convolution with CPU_OPT against CPU_REF")
+{
+	const int cpu_features = ccv_nnc_cpu_features();
+	ccv_nnc_tensor_t* a = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 23, 21, 6), 0);
+	ccv_nnc_tensor_t* w = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 5, 3, 5, 6), 0);
+	ccv_nnc_tensor_t* bias = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 5), 0);
+	ccv_nnc_tensor_t* ar = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 23, 21, 6), 0);
+	ccv_nnc_tensor_t* wr = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 5, 3, 5, 6), 0);
+	ccv_nnc_tensor_t* b = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 23, 21, 5), 0);
+	ccv_nnc_tensor_t* c = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 23, 21, 5), 0);
+	dsfmt_t dsfmt;
+	dsfmt_init_gen_rand(&dsfmt, 0);
+	int i, j;
+	for (i = 0; i < 23 * 21 * 6; i++)
+		a->data.f32[i] = dsfmt_genrand_open_close(&dsfmt);
+	for (i = 0; i < 5 * 3 * 5 * 6; i++)
+		w->data.f32[i] = (dsfmt_genrand_open_close(&dsfmt) - 0.5) / (3 * 5 * 6);
+	for (i = 0; i < 5; i++)
+		bias->data.f32[i] = dsfmt_genrand_open_close(&dsfmt);
+	const int datatypes[] = {
+		CCV_16F, CCV_16BF
+	};
+	const int features[] = {
+		0, CCV_NNC_CPU_FEATURE_AVX2 | CCV_NNC_CPU_FEATURE_F16C, CCV_NNC_CPU_FEATURE_AVX2 | CCV_NNC_CPU_FEATURE_F16C | CCV_NNC_CPU_FEATURE_AVX512F | CCV_NNC_CPU_FEATURE_AVX512BF16
+	};
+	ccv_nnc_cmd_t cmd = CMD_CONVOLUTION_FORWARD(1, 5, 3, 5, 6);
+	ccv_nnc_hint_t hint = ccv_nnc_hint_auto(cmd.info, a->info, b->info);
+	for (i = 0; i < sizeof(datatypes) / sizeof(datatypes[0]); i++)
+	{
+		ccv_nnc_tensor_param_t ah_params = a->info;
+		ah_params.datatype = datatypes[i];
+		ccv_nnc_tensor_param_t wh_params = w->info;
+		wh_params.datatype = datatypes[i];
+		ccv_nnc_tensor_param_t bh_params = b->info;
+		bh_params.datatype = datatypes[i];
+		ccv_nnc_tensor_t* ah = ccv_nnc_tensor_new(0, ah_params, 0);
+		ccv_nnc_tensor_t* wh = ccv_nnc_tensor_new(0, wh_params, 0);
+		ccv_nnc_tensor_t* bh = ccv_nnc_tensor_new(0, bh_params, 0);
+		ccv_nnc_cmd_exec(CMD_DATATYPE_CONVERSION_FORWARD(), ccv_nnc_no_hint, 0, TENSOR_LIST(a, w), TENSOR_LIST(ah, wh), 0);
+		ccv_nnc_cmd_exec(CMD_DATATYPE_CONVERSION_FORWARD(), ccv_nnc_no_hint, 0, TENSOR_LIST(ah, wh), TENSOR_LIST(ar, wr), 0);
+		cmd.backend = CCV_NNC_BACKEND_CPU_REF;
+		ccv_nnc_cmd_exec(cmd, hint, 0, TENSOR_LIST(ar, wr, bias), TENSOR_LIST(b), 0);
+		cmd.backend = CCV_NNC_BACKEND_CPU_OPT;
+		for (j = 0; j < sizeof(features) / sizeof(features[0]); j++)
+		{
+			ccv_nnc_set_cpu_features(features[j]);
+			ccv_nnc_cmd_exec(cmd, hint, 0, TENSOR_LIST(ah, wh, bias), TENSOR_LIST(c), 0);
+			REQUIRE_ARRAY_EQ_WITH_TOLERANCE(float, c->data.f32, b->data.f32, 23 * 21 * 5, 1e-4, "convolution with reduced precision inputs should match CPU_REF");
+			ccv_nnc_cmd_exec(cmd, hint, 0, TENSOR_LIST(ah, wh, bias), TENSOR_LIST(bh), 0);
+			ccv_nnc_cmd_exec(CMD_DATATYPE_CONVERSION_FORWARD(), ccv_nnc_no_hint, 0, TENSOR_LIST(bh), TENSOR_LIST(c), 0);
+			REQUIRE_ARRAY_EQ_WITH_TOLERANCE(float, c->data.f32, b->data.f32, 23 * 21 * 5, datatypes[i] == CCV_16F ? 2e-3 : 2e-2, "convolution with reduced precision output should match CPU_REF");
+		}
+		ccv_nnc_set_cpu_features(cpu_features);
+		ccv_nnc_tensor_free(ah);
+		ccv_nnc_tensor_free(wh);
+		ccv_nnc_tensor_free(bh);
+	}
+	ccv_nnc_tensor_free(a);
+	ccv_nnc_tensor_free(w);
+	ccv_nnc_tensor_free(bias);
+	ccv_nnc_tensor_free(ar);
+	ccv_nnc_tensor_free(wr);
+	ccv_nnc_tensor_free(b);
+	ccv_nnc_tensor_free(c);
+}
+
+TEST_CASE("autotune decisions are memoized and persisted")
+{
+	remove("autotune.sqlite3");
+	REQUIRE_EQ(0, ccv_nnc_cmd_autotune_cache_set_file("autotune.sqlite3"), "should open the autotune cache");
+	ccv_nnc_tensor_t* a = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 31, 23, 8), 0);
+	ccv_nnc_tensor_t* b = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 31, 23, 16), 0);
+	ccv_nnc_cmd_t cmd = CMD_CONVOLUTION_FORWARD(1, 16, 3, 3, 8);
+	ccv_nnc_hint_t hint = ccv_nnc_hint_auto(cmd.info, a->info, b->info);
+	ccv_nnc_tensor_t* w = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 16, 3, 3, 8), 0);
+	ccv_nnc_tensor_t* bias = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 16), 0);
+	ccv_nnc_cmd_exec(CMD_RANDOM_UNIFORM_FORWARD(-1, 1), ccv_nnc_no_hint, 0, TENSOR_LIST(), TENSOR_LIST(a), 0);
+	ccv_nnc_cmd_exec(CMD_RANDOM_UNIFORM_FORWARD(-1, 1), ccv_nnc_no_hint, 0, TENSOR_LIST(), TENSOR_LIST(w), 0);
+	ccv_nnc_cmd_exec(CMD_RANDOM_UNIFORM_FORWARD(-1, 1), ccv_nnc_no_hint, 0, TENSOR_LIST(), TENSOR_LIST(bias), 0);
+	ccv_nnc_cmd_t tuned_cmd = ccv_nnc_cmd_autotune(cmd, 0, hint, 0, TENSOR_LIST(a, w, bias), TENSOR_LIST(b), 0);
+	ccv_nnc_cmd_t again_cmd = ccv_nnc_cmd_autotune(cmd, 0, hint, 0, TENSOR_LIST(a, w, bias), TENSOR_LIST(b), 0);
+	REQUIRE_EQ(tuned_cmd.backend, again_cmd.backend, "the second autotune should reuse the decision");
+	REQUIRE_EQ(tuned_cmd.algorithm, again_cmd.algorithm, "the second autotune should reuse the decision");
+	ccv_nnc_cmd_autotune_cache_set_file(0);
+	// Overwrite the persisted decision, if it is loaded back, the autotune should return this one.
+	sqlite3* handle;
+	sqlite3_open("autotune.sqlite3", &handle);
+	char update_qs[128];
+	snprintf(update_qs, sizeof(update_qs), "UPDATE autotune SET backend=%d, algorithm=0", CCV_NNC_BACKEND_CPU_REF);
+	REQUIRE_EQ(SQLITE_OK, sqlite3_exec(handle, update_qs, 0, 0, 0), "should update the persisted decision");
+	REQUIRE_EQ(1, sqlite3_changes(handle), "there should be one decision persisted");
+	sqlite3_close(handle);
+	ccv_nnc_cmd_autotune_cache_drain();
+	REQUIRE_EQ(0, ccv_nnc_cmd_autotune_cache_set_file("autotune.sqlite3"), "should reopen the autotune cache");
+	ccv_nnc_cmd_t loaded_cmd = ccv_nnc_cmd_autotune(cmd, 0, hint, 0, TENSOR_LIST(a, w, bias), TENSOR_LIST(b), 0);
+	REQUIRE_EQ(CCV_NNC_BACKEND_CPU_REF, loaded_cmd.backend, "should load the persisted decision");
+	REQUIRE_EQ(0, loaded_cmd.algorithm, "should load the persisted decision");
+	// A different shape needs its own decision.
+	ccv_nnc_tensor_t* c = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 17, 23, 8), 0);
+	ccv_nnc_tensor_t* d = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 17, 23, 16), 0);
+	ccv_nnc_cmd_t other_cmd = ccv_nnc_cmd_autotune(cmd, 0, hint, 0, TENSOR_LIST(c, w, bias), TENSOR_LIST(d), 0);
+	REQUIRE(other_cmd.backend == CCV_NNC_BACKEND_CPU_REF || other_cmd.backend == CCV_NNC_BACKEND_CPU_OPT, "should be one of the CPU backends");
+	ccv_nnc_cmd_autotune_cache_set_file(0);
+	ccv_nnc_cmd_autotune_cache_drain();
+	sqlite3_open("autotune.sqlite3", &handle);
+	sqlite3_stmt* count_stmt = 0;
+	sqlite3_prepare_v2(handle, "SELECT COUNT(*) FROM autotune", -1, &count_stmt, 0);
+	REQUIRE_EQ(SQLITE_ROW, sqlite3_step(count_stmt), "should count the decisions");
+	REQUIRE_EQ(2, sqlite3_column_int(count_stmt, 0), "the new shape should be persisted as well");
+	sqlite3_finalize(count_stmt);
+	sqlite3_close(handle);
+	ccv_nnc_tensor_free(a);
+	ccv_nnc_tensor_free(b);
+	ccv_nnc_tensor_free(c);
+	ccv_nnc_tensor_free(d);
+	ccv_nnc_tensor_free(w);
+	ccv_nnc_tensor_free(bias);
+	remove("autotune.sqlite3");
+}
+
+TEST_CASE("autotune decisions are keyed by the cpu features currently allowed")
+{
+	remove("autotune.sqlite3");
+	REQUIRE_EQ(0, ccv_nnc_cmd_autotune_cache_set_file("autotune.sqlite3"), "should open the autotune cache");
+	ccv_nnc_tensor_t* a = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 31, 23, 8), 0);
+	ccv_nnc_tensor_t* b = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 31, 23, 16), 0);
+	ccv_nnc_tensor_t* w = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 16, 3, 3, 8), 0);
+	ccv_nnc_tensor_t* bias = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 16), 0);
+	ccv_nnc_cmd_t cmd = CMD_CONVOLUTION_FORWARD(1, 16, 3, 3, 8);
+	ccv_nnc_hint_t hint = ccv_nnc_hint_auto(cmd.info, a->info, b->info);
+	ccv_nnc_cmd_exec(CMD_RANDOM_UNIFORM_FORWARD(-1, 1), ccv_nnc_no_hint, 0, TENSOR_LIST(), TENSOR_LIST(a), 0);
+	ccv_nnc_cmd_exec(CMD_RANDOM_UNIFORM_FORWARD(-1, 1), ccv_nnc_no_hint, 0, TENSOR_LIST(), TENSOR_LIST(w), 0);
+	ccv_nnc_cmd_exec(CMD_RANDOM_UNIFORM_FORWARD(-1, 1), ccv_nnc_no_hint, 0, TENSOR_LIST(), TENSOR_LIST(bias), 0);
+	const int features = ccv_nnc_cpu_features();
+	ccv_nnc_cmd_t tuned_cmd = ccv_nnc_cmd_autotune(cmd, 0, hint, 0, TENSOR_LIST(a, w, bias), TENSOR_LIST(b), 0);
+	// Turning the cpu features off at runtime shouldn't reuse the decision made with them on.
+	ccv_nnc_set_cpu_features(0);
+	ccv_nnc_cmd_t baseline_cmd = ccv_nnc_cmd_autotune(cmd, 0, hint, 0, TENSOR_LIST(a, w, bias), TENSOR_LIST(b), 0);
+	REQUIRE(baseline_cmd.backend == CCV_NNC_BACKEND_CPU_REF || baseline_cmd.backend == CCV_NNC_BACKEND_CPU_OPT, "should be one of the CPU backends");
+	// Turning them back on should find the first decision again.
+	ccv_nnc_set_cpu_features(features);
+	ccv_nnc_cmd_t again_cmd = ccv_nnc_cmd_autotune(cmd, 0, hint, 0, TENSOR_LIST(a, w, bias), TENSOR_LIST(b), 0);
+	REQUIRE_EQ(tuned_cmd.backend, again_cmd.backend, "the decision made with the same cpu features should be reused");
+	REQUIRE_EQ(tuned_cmd.algorithm, again_cmd.algorithm, "the decision made with the same cpu features should be reused");
+	ccv_nnc_cmd_autotune_cache_set_file(0);
+	ccv_nnc_cmd_autotune_cache_drain();
+	sqlite3* handle;
+	sqlite3_open("autotune.sqlite3", &handle);
+	sqlite3_stmt* count_stmt = 0;
+	sqlite3_prepare_v2(handle, "SELECT COUNT(*) FROM autotune", -1, &count_stmt, 0);
+	REQUIRE_EQ(SQLITE_ROW, sqlite3_step(count_stmt), "should count the decisions");
+	REQUIRE_EQ(features ? 2 : 1, sqlite3_column_int(count_stmt, 0), "each set of cpu features should have its own decision");
+	sqlite3_finalize(count_stmt);
+	sqlite3_close(handle);
+	ccv_nnc_tensor_free(a);
+	ccv_nnc_tensor_free(b);
+	ccv_nnc_tensor_free(w);
+	ccv_nnc_tensor_free(bias);
+	remove("autotune.sqlite3");
+}
+
 #include "case_main.h"
@@ -839,4 +839,141 @@ TEST_CASE("backward gemm with transpose a and b batch 2, same b")
 	ccv_nnc_tensor_free(dbias);
 }
 
+TEST_CASE("gemm with AVX2 kernels against SSE2 kernels")
+{
+	const int cpu_features = ccv_nnc_cpu_features();
+	ccv_nnc_tensor_t* const a = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 96), 0);
+	ccv_nnc_tensor_t* const w = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 40, 96), 0);
+	ccv_nnc_tensor_t* const bias = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 40), 0);
+	ccv_nnc_tensor_t* const g = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 40), 0);
+	int i;
+	for (i = 0; i < 4 * 96; i++)
+		a->data.f32[i] = (float)(i % 13) / 13;
+	for (i = 0; i < 40 * 96; i++)
+		w->data.f32[i] = (float)(i % 17) / 17;
+	for (i = 0; i < 40; i++)
+		bias->data.f32[i] = (float)i / 40;
+	for (i = 0; i < 4 * 40; i++)
+		g->data.f32[i] = (float)(i % 7) / 7;
+	ccv_nnc_tensor_t* const b = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 40), 0);
+	ccv_nnc_tensor_t* const h = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 96), 0);
+	ccv_nnc_tensor_t* const dw = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 40, 96), 0);
+	ccv_nnc_tensor_t* const dbias = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 40), 0);
+	ccv_nnc_cmd_t forw_cmd = CMD_GEMM_FORWARD(NO_TRANSPOSE, TRANSPOSE(0, 1));
+	forw_cmd.backend = CCV_NNC_BACKEND_CPU_REF;
+	ccv_nnc_cmd_exec(forw_cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(a, w, bias), TENSOR_LIST(b), 0);
+	ccv_nnc_cmd_t back_cmd = CMD_GEMM_BACKWARD(NO_TRANSPOSE, TRANSPOSE(0, 1));
+	back_cmd.backend = CCV_NNC_BACKEND_CPU_REF;
+	ccv_nnc_cmd_exec(back_cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(g, a, w), TENSOR_LIST(h, dw, dbias), 0);
+	ccv_nnc_tensor_t* const ob = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 40), 0);
+	ccv_nnc_tensor_t* const oh = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 96), 0);
+	ccv_nnc_tensor_t* const odw = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 40, 96), 0);
+	ccv_nnc_tensor_t* const odbias = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 40), 0);
+	forw_cmd.backend = CCV_NNC_BACKEND_CPU_OPT;
+	forw_cmd.algorithm = 0; // CCV_NNC_CMD_OPT_GEMM_ALGO_DIRECT
+	back_cmd.backend = CCV_NNC_BACKEND_CPU_OPT;
+	back_cmd.algorithm = 0; // CCV_NNC_CMD_OPT_GEMM_ALGO_DIRECT
+	const int features[] = {
+		0, CCV_NNC_CPU_FEATURE_AVX2, CCV_NNC_CPU_FEATURE_AVX2 | CCV_NNC_CPU_FEATURE_AVX512F
+	};
+	for (i = 0; i < sizeof(features) / sizeof(features[0]); i++)
+	{
+		ccv_nnc_set_cpu_features(features[i]);
+		ccv_nnc_cmd_exec(forw_cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(a, w, bias), TENSOR_LIST(ob), 0);
+		REQUIRE_TENSOR_EQ(ob, b, "forward result should be equal to the reference implementation");
+		ccv_nnc_cmd_exec(back_cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(g, a, w), TENSOR_LIST(oh, odw, odbias), 0);
+		REQUIRE_TENSOR_EQ(oh, h, "h should be equal to the reference implementation");
+		REQUIRE_TENSOR_EQ(odw, dw, "dw should be equal to the reference implementation");
+		REQUIRE_TENSOR_EQ(odbias, dbias, "bias should be equal to the reference implementation");
+	}
+	ccv_nnc_set_cpu_features(cpu_features);
+	ccv_nnc_tensor_free(a);
+	ccv_nnc_tensor_free(w);
+	ccv_nnc_tensor_free(bias);
+	ccv_nnc_tensor_free(g);
+	ccv_nnc_tensor_free(b);
+	ccv_nnc_tensor_free(h);
+	ccv_nnc_tensor_free(dw);
+	ccv_nnc_tensor_free(dbias);
+	ccv_nnc_tensor_free(ob);
+	ccv_nnc_tensor_free(oh);
+	ccv_nnc_tensor_free(odw);
+	ccv_nnc_tensor_free(odbias);
+}
+
+TEST_CASE("gemm with half precision weights and activations against the reference implementation")
+{
+	const int cpu_features = ccv_nnc_cpu_features();
+	ccv_nnc_tensor_t* const a = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 100), 0);
+	ccv_nnc_tensor_t* const w = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 40, 100), 0);
+	ccv_nnc_tensor_t* const bias = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 40), 0);
+	int i, j;
+	for (i = 0; i < 4 * 100; i++)
+		a->data.f32[i] = (float)(i % 13) / 130;
+	for (i = 0; i < 40 * 100; i++)
+		w->data.f32[i] = (float)(i % 17) / 17 - 0.5;
+	for (i = 0; i < 40; i++)
+		bias->data.f32[i] = (float)i / 40;
+	const int datatypes[] = {
+		CCV_16F, CCV_16BF
+	};
+	const int features[] = {
+		0, CCV_NNC_CPU_FEATURE_AVX2 | CCV_NNC_CPU_FEATURE_F16C, CCV_NNC_CPU_FEATURE_AVX2 | CCV_NNC_CPU_FEATURE_F16C | CCV_NNC_CPU_FEATURE_AVX512F | CCV_NNC_CPU_FEATURE_AVX512BF16
+	};
+	ccv_nnc_tensor_t* const ar = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 100), 0);
+	ccv_nnc_tensor_t* const wr = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 40, 100), 0);
+	ccv_nnc_tensor_t* const b = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 40), 0);
+	ccv_nnc_tensor_t* const ob = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 40), 0);
+	for (i = 0; i < sizeof(datatypes) / sizeof(datatypes[0]); i++)
+	{
+		ccv_nnc_tensor_param_t ah_params = a->info;
+		ah_params.datatype = datatypes[i];
+		ccv_nnc_tensor_param_t wh_params = w->info;
+		wh_params.datatype = datatypes[i];
+		ccv_nnc_tensor_param_t bh_params = b->info;
+		bh_params.datatype = datatypes[i];
+		ccv_nnc_tensor_t* const ah = ccv_nnc_tensor_new(0, ah_params, 0);
+		ccv_nnc_tensor_t* const wh = ccv_nnc_tensor_new(0, wh_params, 0);
+		ccv_nnc_tensor_t* const bh = ccv_nnc_tensor_new(0, bh_params, 0);
+		ccv_nnc_cmd_exec(CMD_DATATYPE_CONVERSION_FORWARD(), ccv_nnc_no_hint, 0, TENSOR_LIST(a, w), TENSOR_LIST(ah, wh), 0);
+		// The reference runs on the rounded values, so the only difference left is the accumulation order.
+		ccv_nnc_cmd_exec(CMD_DATATYPE_CONVERSION_FORWARD(), ccv_nnc_no_hint, 0, TENSOR_LIST(ah, wh), TENSOR_LIST(ar, wr), 0);
+		ccv_nnc_cmd_t forw_cmd = CMD_GEMM_FORWARD(NO_TRANSPOSE, TRANSPOSE(0, 1));
+		forw_cmd.backend = CCV_NNC_BACKEND_CPU_REF;
+		ccv_nnc_cmd_exec(forw_cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(a, wr, bias), TENSOR_LIST(b), 0);
+		forw_cmd.backend = CCV_NNC_BACKEND_CPU_OPT;
+		forw_cmd.algorithm = 0; // CCV_NNC_CMD_OPT_GEMM_ALGO_DIRECT
+		for (j = 0; j < sizeof(features) / sizeof(features[0]); j++)
+		{
+			ccv_nnc_set_cpu_features(features[j]);
+			// FP32 activations with reduced precision weights.
+			ccv_nnc_cmd_exec(forw_cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(a, wh, bias), TENSOR_LIST(ob), 0);
+			REQUIRE_ARRAY_EQ_WITH_TOLERANCE(float, ob->data.f32, b->data.f32, 4 * 40, 1e-4, "forward result should be equal to the reference implementation");
+		}
+		ccv_nnc_set_cpu_features(cpu_features);
+		forw_cmd.backend = CCV_NNC_BACKEND_CPU_REF;
+		ccv_nnc_cmd_exec(forw_cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(ar, wr, bias), TENSOR_LIST(b), 0);
+		forw_cmd.backend = CCV_NNC_BACKEND_CPU_OPT;
+		for (j = 0; j < sizeof(features) / sizeof(features[0]); j++)
+		{
+			ccv_nnc_set_cpu_features(features[j]);
+			// Everything in reduced precision, only the accumulation is in FP32.
+			ccv_nnc_cmd_exec(forw_cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(ah, wh, bias), TENSOR_LIST(bh), 0);
+			ccv_nnc_cmd_exec(CMD_DATATYPE_CONVERSION_FORWARD(), ccv_nnc_no_hint, 0, TENSOR_LIST(bh), TENSOR_LIST(ob), 0);
+			REQUIRE_ARRAY_EQ_WITH_TOLERANCE(float, ob->data.f32, b->data.f32, 4 * 40, datatypes[i] == CCV_16F ? 2e-3 : 2e-2, "forward result should be equal to the reference implementation");
+		}
+		ccv_nnc_set_cpu_features(cpu_features);
+		ccv_nnc_tensor_free(ah);
+		ccv_nnc_tensor_free(wh);
+		ccv_nnc_tensor_free(bh);
+	}
+	ccv_nnc_tensor_free(a);
+	ccv_nnc_tensor_free(w);
+	ccv_nnc_tensor_free(bias);
+	ccv_nnc_tensor_free(ar);
+	ccv_nnc_tensor_free(wr);
+	ccv_nnc_tensor_free(b);
+	ccv_nnc_tensor_free(ob);
+}
+
 #include "case_main.h"
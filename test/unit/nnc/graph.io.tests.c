@@ -53,4 +53,129 @@ TEST_CASE("write graph (x + y) * (x + y) and read")
 	ccv_nnc_graph_exec_arena_free(graph_exec_arena);
 }
 
+TEST_CASE("write compiled graph and read it back without compilation")
+{
+	ccv_nnc_symbolic_graph_t* const symbolic_graph = ccv_nnc_symbolic_graph_new();
+	const ccv_nnc_tensor_symbol_t x = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 2, 4), "x");
+	const ccv_nnc_tensor_symbol_t w = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 3, 4), "w");
+	const ccv_nnc_tensor_symbol_t bias = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 3), "bias");
+	const ccv_nnc_tensor_symbol_t h = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 2, 3), "h");
+	const ccv_nnc_tensor_symbol_t r = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 2, 3), "r");
+	const ccv_nnc_tensor_symbol_t y = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 2, 3), "y");
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_GEMM_FORWARD(NO_TRANSPOSE, TRANSPOSE(0, 1)), TENSOR_SYMBOL_LIST(x, w, bias), TENSOR_SYMBOL_LIST(h), "gemm");
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_RELU_FORWARD(), TENSOR_SYMBOL_LIST(h), TENSOR_SYMBOL_LIST(r), "relu");
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_EWSUM_FORWARD(), TENSOR_SYMBOL_LIST(r, h), TENSOR_SYMBOL_LIST(y), "sum");
+	ccv_nnc_graph_exec_symbol_autogen(symbolic_graph, 0, 0, CCV_NNC_AUTOGEN_ALL_EXECS | CCV_NNC_AUTOGEN_SOURCES_AND_DESTINATIONS);
+	ccv_nnc_tensor_t* const w_tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 3, 4), 0);
+	ccv_nnc_tensor_t* const bias_tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 3), 0);
+	int i;
+	for (i = 0; i < 12; i++)
+		w_tensor->data.f32[i] = (i % 5) * 0.25 - 0.5;
+	for (i = 0; i < 3; i++)
+		bias_tensor->data.f32[i] = i * 0.1 - 0.1;
+	float xs[8];
+	for (i = 0; i < 8; i++)
+		xs[i] = i * 0.5 - 2;
+	ccv_nnc_graph_t* graph = 0;
+	ccv_nnc_tensor_arena_t* tensor_arena = 0;
+	ccv_nnc_graph_exec_arena_t* graph_exec_arena = 0;
+	ccv_nnc_symbolic_graph_compile(symbolic_graph, ccv_nnc_default_compile_params, TENSOR_BIND_MAP(KV(w, w_tensor), KV(bias, bias_tensor)), TENSOR_SYMBOL_LIST(y), SYMBOLIC_GRAPH_SOURCES(symbolic_graph), SYMBOLIC_GRAPH_DESTINATIONS(symbolic_graph), &graph, &tensor_arena, &graph_exec_arena);
+	memcpy(ccv_nnc_tensor_from_symbol(tensor_arena, x)->data.f32, xs, sizeof(xs));
+	ccv_nnc_graph_run(graph, 0, TRAVERSE_FULL, 0, 0);
+	static char fn[] = "gen/write_compiled_graph_and_read_it_back_without_compilation.graph";
+	remove(fn);
+	ccv_nnc_symbolic_graph_compile_write(symbolic_graph, ccv_nnc_default_compile_params, TENSOR_BIND_MAP(KV(w, w_tensor), KV(bias, bias_tensor)), TENSOR_SYMBOL_LIST(y), SYMBOLIC_GRAPH_SOURCES(symbolic_graph), SYMBOLIC_GRAPH_DESTINATIONS(symbolic_graph), fn);
+	ccv_nnc_symbolic_graph_t* symbolic_graph_2 = 0;
+	ccv_nnc_tensor_bind_t* tensor_binds = 0;
+	int tensor_bind_size = 0;
+	ccv_nnc_graph_t* graph_2 = 0;
+	ccv_nnc_tensor_arena_t* tensor_arena_2 = 0;
+	ccv_nnc_graph_exec_arena_t* graph_exec_arena_2 = 0;
+	const int with_plan = ccv_nnc_symbolic_graph_compile_read(fn, ccv_nnc_default_compile_params, &symbolic_graph_2, &tensor_binds, &tensor_bind_size, &graph_2, &tensor_arena_2, &graph_exec_arena_2);
+	REQUIRE(with_plan, "should materialize the graph with the plan rather than compiling it");
+	REQUIRE_EQ(tensor_bind_size, 2, "should read both weights back");
+	REQUIRE_EQ(ccv_nnc_tensor_arena_size(tensor_arena), ccv_nnc_tensor_arena_size(tensor_arena_2), "the tensor arena should be restored with the same layout");
+	REQUIRE_EQ(ccv_nnc_tensor_arena_size_lower_bound(tensor_arena), ccv_nnc_tensor_arena_size_lower_bound(tensor_arena_2), "the lower bound should be restored as well");
+	// The symbols keep the same index in the graph read back.
+	const ccv_nnc_tensor_symbol_t x_2 = {
+		.d = x.d,
+		.graph = symbolic_graph_2
+	};
+	const ccv_nnc_tensor_symbol_t y_2 = {
+		.d = y.d,
+		.graph = symbolic_graph_2
+	};
+	memcpy(ccv_nnc_tensor_from_symbol(tensor_arena_2, x_2)->data.f32, xs, sizeof(xs));
+	ccv_nnc_graph_run(graph_2, 0, TRAVERSE_FULL, 0, 0);
+	const ccv_nnc_tensor_t* const y_tensor = ccv_nnc_tensor_from_symbol(tensor_arena, y);
+	const ccv_nnc_tensor_t* const y_tensor_2 = ccv_nnc_tensor_from_symbol(tensor_arena_2, y_2);
+	REQUIRE_ARRAY_EQ_WITH_TOLERANCE(float, y_tensor->data.f32, y_tensor_2->data.f32, 6, 1e-5, "the graph read back should compute the same result");
+	for (i = 0; i < tensor_bind_size; i++)
+		ccv_nnc_tensor_free((ccv_nnc_tensor_t*)tensor_binds[i].tensor);
+	ccfree(tensor_binds);
+	ccv_nnc_symbolic_graph_free(symbolic_graph_2);
+	ccv_nnc_graph_free(graph_2);
+	ccv_nnc_tensor_arena_free(tensor_arena_2);
+	ccv_nnc_graph_exec_arena_free(graph_exec_arena_2);
+	ccv_nnc_symbolic_graph_free(symbolic_graph);
+	ccv_nnc_graph_free(graph);
+	ccv_nnc_tensor_arena_free(tensor_arena);
+	ccv_nnc_graph_exec_arena_free(graph_exec_arena);
+	ccv_nnc_tensor_free(w_tensor);
+	ccv_nnc_tensor_free(bias_tensor);
+}
+
+TEST_CASE("symbolic graph written over a compiled graph doesn't reuse its plan")
+{
+	ccv_nnc_symbolic_graph_t* const symbolic_graph = ccv_nnc_symbolic_graph_new();
+	const ccv_nnc_tensor_symbol_t x = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 2, 4), "x");
+	const ccv_nnc_tensor_symbol_t y = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 2, 4), "y");
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_RELU_FORWARD(), TENSOR_SYMBOL_LIST(x), TENSOR_SYMBOL_LIST(y), "relu");
+	ccv_nnc_graph_exec_symbol_autogen(symbolic_graph, 0, 0, CCV_NNC_AUTOGEN_ALL_EXECS | CCV_NNC_AUTOGEN_SOURCES_AND_DESTINATIONS);
+	static char fn[] = "gen/symbolic_graph_written_over_a_compiled_graph.graph";
+	remove(fn);
+	ccv_nnc_symbolic_graph_compile_write(symbolic_graph, ccv_nnc_default_compile_params, 0, 0, TENSOR_SYMBOL_LIST(y), SYMBOLIC_GRAPH_SOURCES(symbolic_graph), SYMBOLIC_GRAPH_DESTINATIONS(symbolic_graph), fn);
+	// Same graph with a bigger tensor, the plan written before would be too small for it.
+	ccv_nnc_symbolic_graph_t* const bigger_graph = ccv_nnc_symbolic_graph_new();
+	const ccv_nnc_tensor_symbol_t bx = ccv_nnc_tensor_symbol_new(bigger_graph, CPU_TENSOR_NHWC(32F, 8, 4), "x");
+	const ccv_nnc_tensor_symbol_t by = ccv_nnc_tensor_symbol_new(bigger_graph, CPU_TENSOR_NHWC(32F, 8, 4), "y");
+	ccv_nnc_graph_exec_symbol_new(bigger_graph, CMD_RELU_FORWARD(), TENSOR_SYMBOL_LIST(bx), TENSOR_SYMBOL_LIST(by), "relu");
+	ccv_nnc_graph_exec_symbol_autogen(bigger_graph, 0, 0, CCV_NNC_AUTOGEN_ALL_EXECS | CCV_NNC_AUTOGEN_SOURCES_AND_DESTINATIONS);
+	ccv_nnc_symbolic_graph_write(bigger_graph, 0, 0, fn);
+	ccv_nnc_symbolic_graph_t* symbolic_graph_2 = 0;
+	ccv_nnc_tensor_bind_t* tensor_binds = 0;
+	int tensor_bind_size = 0;
+	ccv_nnc_graph_t* graph_2 = 0;
+	ccv_nnc_tensor_arena_t* tensor_arena_2 = 0;
+	ccv_nnc_graph_exec_arena_t* graph_exec_arena_2 = 0;
+	const int with_plan = ccv_nnc_symbolic_graph_compile_read(fn, ccv_nnc_default_compile_params, &symbolic_graph_2, &tensor_binds, &tensor_bind_size, &graph_2, &tensor_arena_2, &graph_exec_arena_2);
+	REQUIRE(!with_plan, "the plan of the graph written over should be gone");
+	const ccv_nnc_tensor_symbol_t x_2 = {
+		.d = bx.d,
+		.graph = symbolic_graph_2
+	};
+	const ccv_nnc_tensor_symbol_t y_2 = {
+		.d = by.d,
+		.graph = symbolic_graph_2
+	};
+	ccv_nnc_tensor_t* const x_tensor = ccv_nnc_tensor_from_symbol(tensor_arena_2, x_2);
+	REQUIRE_EQ(x_tensor->info.dim[0], 8, "should be compiled for the bigger graph");
+	float ys[32];
+	int i;
+	for (i = 0; i < 32; i++)
+	{
+		x_tensor->data.f32[i] = i - 16;
+		ys[i] = ccv_max(i - 16, 0);
+	}
+	ccv_nnc_graph_run(graph_2, 0, TRAVERSE_FULL, 0, 0);
+	REQUIRE_ARRAY_EQ_WITH_TOLERANCE(float, ccv_nnc_tensor_from_symbol(tensor_arena_2, y_2)->data.f32, ys, 32, 1e-5, "the graph read back should compute relu for all rows");
+	ccfree(tensor_binds);
+	ccv_nnc_symbolic_graph_free(symbolic_graph_2);
+	ccv_nnc_graph_free(graph_2);
+	ccv_nnc_tensor_arena_free(tensor_arena_2);
+	ccv_nnc_graph_exec_arena_free(graph_exec_arena_2);
+	ccv_nnc_symbolic_graph_free(bigger_graph);
+	ccv_nnc_symbolic_graph_free(symbolic_graph);
+}
+
 #include "case_main.h"
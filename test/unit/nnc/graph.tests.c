@@ -5,6 +5,7 @@
 #include <nnc/ccv_nnc.h>
 #include <nnc/ccv_nnc_easy.h>
 #include "3rdparty/dsfmt/dSFMT.h"
+#include <pthread.h>
 
 TEST_SETUP()
 {
@@ -106,4 +107,117 @@ TEST_CASE("run simple graph network")
 	ccv_nnc_tensor_free(vgbias);
 }
 
+TEST_CASE("profile graph run and export chrome trace")
+{
+	ccv_nnc_graph_t* graph = ccv_nnc_graph_new();
+	ccv_nnc_tensor_t* a = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 64), 0);
+	ccv_nnc_tensor_t* b = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 64), 0);
+	ccv_nnc_tensor_t* c = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 64), 0);
+	int i;
+	for (i = 0; i < 64; i++)
+		a->data.f32[i] = i;
+	ccv_nnc_graph_exec_t sum = ccv_nnc_graph_exec_new(graph, CMD_EWSUM_FORWARD(), ccv_nnc_no_hint, TENSOR_LIST(a, a), TENSOR_LIST(b));
+	ccv_nnc_graph_exec_t prod = ccv_nnc_graph_exec_new(graph, CMD_EWPROD_FORWARD(), ccv_nnc_no_hint, TENSOR_LIST(a, b), TENSOR_LIST(c));
+	ccv_nnc_graph_exec_concat(graph, sum, prod);
+	ccv_nnc_profiler_reset();
+	ccv_nnc_profiler_start(0);
+	ccv_nnc_graph_run(graph, 0, GRAPH_EXEC_LIST(sum), GRAPH_EXEC_LIST(prod), 0, 0);
+	ccv_nnc_cmd_exec(CMD_EWSUM_FORWARD(), ccv_nnc_no_hint, 0, TENSOR_LIST(b, c), TENSOR_LIST(b), 0);
+	ccv_nnc_profiler_stop();
+	// Not recorded once stopped.
+	ccv_nnc_cmd_exec(CMD_EWSUM_FORWARD(), ccv_nnc_no_hint, 0, TENSOR_LIST(b, c), TENSOR_LIST(b), 0);
+	ccv_array_t* const events = ccv_nnc_profiler_events();
+	REQUIRE_EQ(events->rnum, 3, "should record the two execution nodes and the command executed directly");
+	const ccv_nnc_profiler_event_t* const sum_event = (ccv_nnc_profiler_event_t*)ccv_array_get(events, 0);
+	const ccv_nnc_profiler_event_t* const prod_event = (ccv_nnc_profiler_event_t*)ccv_array_get(events, 1);
+	const ccv_nnc_profiler_event_t* const cmd_event = (ccv_nnc_profiler_event_t*)ccv_array_get(events, 2);
+	REQUIRE_EQ(sum_event->cmd, CCV_NNC_EWSUM_FORWARD, "the first one should be the sum");
+	REQUIRE_EQ(prod_event->cmd, CCV_NNC_EWPROD_FORWARD, "the second one should be the product");
+	REQUIRE(sum_event->graph == graph, "the sum should be attributed to the graph");
+	REQUIRE_EQ(sum_event->exec_idx, sum.d, "the sum should be attributed to its execution node");
+	REQUIRE_EQ(prod_event->exec_idx, prod.d, "the product should be attributed to its execution node");
+	REQUIRE(cmd_event->graph == 0, "the command executed directly doesn't belong to any graph");
+	REQUIRE_EQ(cmd_event->exec_idx, -1, "the command executed directly doesn't belong to any graph");
+	REQUIRE_NOT_EQ(sum_event->backend, CCV_NNC_NO_BACKEND, "should record the backend chosen");
+	REQUIRE_EQ(sum_event->bytes, 3 * 64 * sizeof(float), "should record bytes of the inputs and the output");
+	REQUIRE(sum_event->start <= sum_event->end && sum_event->end <= prod_event->start, "the product should run after the sum");
+	ccv_array_free(events);
+	FILE* const trace = tmpfile();
+	ccv_nnc_profiler_write_chrome_trace(trace);
+	ccv_nnc_profiler_write_summary(trace);
+	rewind(trace);
+	char buf[1024];
+	const size_t len = fread(buf, 1, sizeof(buf) - 1, trace);
+	buf[len] = 0;
+	fclose(trace);
+	REQUIRE(strncmp(buf, "{\"traceEvents\":[", 16) == 0, "should be in chrome trace event format");
+	REQUIRE(strstr(buf, "\"name\":\"CCV_NNC_EWPROD_FORWARD\"") != 0, "should have the product in the trace");
+	ccv_nnc_profiler_reset();
+	ccv_array_t* const empty_events = ccv_nnc_profiler_events();
+	REQUIRE_EQ(empty_events->rnum, 0, "should have no event after reset");
+	ccv_array_free(empty_events);
+	ccv_nnc_graph_free(graph);
+	ccv_nnc_tensor_free(a);
+	ccv_nnc_tensor_free(b);
+	ccv_nnc_tensor_free(c);
+}
+
+static void* _profiler_record(void* const context)
+{
+	ccv_nnc_tensor_t* const a = (ccv_nnc_tensor_t*)context;
+	ccv_nnc_cmd_exec(CMD_EWSUM_FORWARD(), ccv_nnc_no_hint, 0, TENSOR_LIST(a, a), TENSOR_LIST(a), 0);
+	return 0;
+}
+
+TEST_CASE("profiler reset discards events recorded by other threads")
+{
+	ccv_nnc_tensor_t* a = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 64), 0);
+	ccv_nnc_tensor_t* b = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 64), 0);
+	ccv_nnc_profiler_reset();
+	ccv_nnc_profiler_start(0);
+	pthread_t thread;
+	pthread_create(&thread, 0, _profiler_record, a);
+	pthread_join(thread, 0);
+	ccv_nnc_cmd_exec(CMD_EWSUM_FORWARD(), ccv_nnc_no_hint, 0, TENSOR_LIST(b, b), TENSOR_LIST(b), 0);
+	ccv_array_t* events = ccv_nnc_profiler_events();
+	REQUIRE_EQ(events->rnum, 2, "should record events from both threads");
+	ccv_array_free(events);
+	ccv_nnc_profiler_reset();
+	events = ccv_nnc_profiler_events();
+	REQUIRE_EQ(events->rnum, 0, "should have no event after reset, even if the other thread hasn't recorded since");
+	ccv_array_free(events);
+	ccv_nnc_cmd_exec(CMD_EWSUM_FORWARD(), ccv_nnc_no_hint, 0, TENSOR_LIST(b, b), TENSOR_LIST(b), 0);
+	events = ccv_nnc_profiler_events();
+	REQUIRE_EQ(events->rnum, 1, "should only have the event recorded after reset");
+	ccv_array_free(events);
+	ccv_nnc_profiler_stop();
+	ccv_nnc_profiler_reset();
+	ccv_nnc_tensor_free(a);
+	ccv_nnc_tensor_free(b);
+}
+
+TEST_CASE("profiler keeps events recorded by threads exited")
+{
+	ccv_nnc_tensor_t* a = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 64), 0);
+	ccv_nnc_profiler_reset();
+	ccv_nnc_profiler_start(0);
+	int i;
+	// Start a new thread each time, as an iterator with a thread per epoch would do.
+	for (i = 0; i < 8; i++)
+	{
+		pthread_t thread;
+		pthread_create(&thread, 0, _profiler_record, a);
+		pthread_join(thread, 0);
+	}
+	ccv_nnc_profiler_stop();
+	ccv_array_t* events = ccv_nnc_profiler_events();
+	REQUIRE_EQ(events->rnum, 8, "should have the events from all the threads exited");
+	ccv_array_free(events);
+	ccv_nnc_profiler_reset();
+	events = ccv_nnc_profiler_events();
+	REQUIRE_EQ(events->rnum, 0, "should have no event after reset");
+	ccv_array_free(events);
+	ccv_nnc_tensor_free(a);
+}
+
 #include "case_main.h"
@@ -165,4 +165,41 @@ TEST_CASE("compare layer norm gradient with other symbolic graph")
 	ccv_nnc_graph_free(layer_norm_graph);
 }
 
+TEST_CASE("layer norm with CPU_OPT against CPU_REF")
+{
+	ccv_nnc_tensor_t* const x = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 8, 4, 4, 19), 0);
+	ccv_nnc_tensor_t* const ref = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 8, 4, 4, 19), 0);
+	ccv_nnc_tensor_t* const opt = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 8, 4, 4, 19), 0);
+	ccv_nnc_tensor_t* const scale = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 4, 4, 19), 0);
+	ccv_nnc_tensor_t* const bias = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 4, 4, 19), 0);
+	ccv_nnc_tensor_t* const ref_mean = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 8, 1, 1, 1), 0);
+	ccv_nnc_tensor_t* const ref_inv_std = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 8, 1, 1, 1), 0);
+	ccv_nnc_tensor_t* const opt_mean = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 8, 1, 1, 1), 0);
+	ccv_nnc_tensor_t* const opt_inv_std = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 8, 1, 1, 1), 0);
+	dsfmt_t dsfmt;
+	dsfmt_init_gen_rand(&dsfmt, 0);
+	int i;
+	for (i = 0; i < 8 * 4 * 4 * 19; i++)
+		x->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) * 2;
+	for (i = 0; i < 4 * 4 * 19; i++)
+		scale->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) + 0.5, bias->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) + 4;
+	ccv_nnc_cmd_t cmd = CMD_LAYER_NORM_FORWARD(1e-4, 1, 2, 3);
+	cmd.backend = CCV_NNC_BACKEND_CPU_REF;
+	ccv_nnc_cmd_exec(cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(x, scale, bias), TENSOR_LIST(ref, ref_mean, ref_inv_std), 0);
+	cmd.backend = CCV_NNC_BACKEND_CPU_OPT;
+	ccv_nnc_cmd_exec(cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(x, scale, bias), TENSOR_LIST(opt, opt_mean, opt_inv_std), 0);
+	REQUIRE_TENSOR_EQ(ref, opt, "layer norm from CPU_OPT should match CPU_REF");
+	REQUIRE_TENSOR_EQ(ref_mean, opt_mean, "saved mean should match");
+	REQUIRE_TENSOR_EQ(ref_inv_std, opt_inv_std, "saved inv std should match");
+	ccv_nnc_tensor_free(x);
+	ccv_nnc_tensor_free(ref);
+	ccv_nnc_tensor_free(opt);
+	ccv_nnc_tensor_free(scale);
+	ccv_nnc_tensor_free(bias);
+	ccv_nnc_tensor_free(ref_mean);
+	ccv_nnc_tensor_free(ref_inv_std);
+	ccv_nnc_tensor_free(opt_mean);
+	ccv_nnc_tensor_free(opt_inv_std);
+}
+
 #include "case_main.h"
@@ -4,6 +4,8 @@
 #include <ccv.h>
 #include <nnc/ccv_nnc.h>
 #include <nnc/ccv_nnc_easy.h>
+#include <pthread.h>
+#include <unistd.h>
 
 TEST_SETUP()
 {
@@ -59,6 +61,131 @@ TEST_CASE("schedule a simple graph for parallel execution")
 	ccv_nnc_graph_exec_arena_free(graph_exec_arena);
 }
 
+TEST_CASE("run independent branches on CPU streams concurrently")
+{
+	ccv_nnc_symbolic_graph_t* const symbolic_graph = ccv_nnc_symbolic_graph_new();
+	const ccv_nnc_tensor_symbol_t x = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 64, 128), "x");
+	ccv_nnc_tensor_symbol_t w[4];
+	ccv_nnc_tensor_symbol_t y[4];
+	int i, j;
+	for (i = 0; i < 4; i++)
+	{
+		w[i] = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 128, 128), "w");
+		const ccv_nnc_tensor_symbol_t h = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 64, 128), "h");
+		ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_GEMM_FORWARD(NO_TRANSPOSE, TRANSPOSE(0, 1)), TENSOR_SYMBOL_LIST(x, w[i]), TENSOR_SYMBOL_LIST(h), "gemm");
+		y[i] = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 64, 128), "y");
+		ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_SIGMOID_FORWARD(), TENSOR_SYMBOL_LIST(h), TENSOR_SYMBOL_LIST(y[i]), "sigmoid");
+	}
+	const ccv_nnc_tensor_symbol_t z = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 64, 128), "z");
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_EWSUM_FORWARD(), TENSOR_SYMBOL_LIST(y[0], y[1], y[2], y[3]), TENSOR_SYMBOL_LIST(z), "sum");
+	ccv_nnc_graph_exec_symbol_autogen(symbolic_graph, 0, 0, CCV_NNC_AUTOGEN_ALL_EXECS | CCV_NNC_AUTOGEN_SOURCES_AND_DESTINATIONS);
+	ccv_nnc_graph_t* graph;
+	ccv_nnc_tensor_arena_t* tensor_arena;
+	ccv_nnc_graph_exec_arena_t* graph_exec_arena;
+	ccv_nnc_symbolic_graph_compile(symbolic_graph, ccv_nnc_default_compile_params,
+		0, 0,
+		TENSOR_SYMBOL_LIST(z),
+		SYMBOLIC_GRAPH_SOURCES(symbolic_graph), SYMBOLIC_GRAPH_DESTINATIONS(symbolic_graph),
+		&graph, &tensor_arena, &graph_exec_arena);
+	ccv_nnc_graph_set_default_static_schedule(graph, CCV_STREAM_CONTEXT_CPU);
+	ccv_nnc_tensor_t* const x_tensor = ccv_nnc_tensor_from_symbol(tensor_arena, x);
+	for (i = 0; i < 64 * 128; i++)
+		x_tensor->data.f32[i] = (float)(i % 17) / 17 - 0.5;
+	for (i = 0; i < 4; i++)
+	{
+		ccv_nnc_tensor_t* const w_tensor = ccv_nnc_tensor_from_symbol(tensor_arena, w[i]);
+		for (j = 0; j < 128 * 128; j++)
+			w_tensor->data.f32[j] = (float)((j * (i + 3)) % 23) / 230 - 0.05;
+	}
+	ccv_nnc_stream_context_set_cpu_thread_count(1);
+	ccv_nnc_graph_run_with_schedule(graph, 0, 0, 0, 0);
+	ccv_nnc_tensor_t* const z_tensor = ccv_nnc_tensor_from_symbol(tensor_arena, z);
+	ccv_nnc_tensor_t* const expected = ccv_nnc_tensor_new(0, z_tensor->info, 0);
+	memcpy(expected->data.f32, z_tensor->data.f32, sizeof(float) * 64 * 128);
+	ccv_nnc_stream_context_set_cpu_thread_count(4);
+	REQUIRE_EQ(4, ccv_nnc_stream_context_cpu_thread_count(), "should use 4 threads");
+	for (i = 0; i < 10; i++)
+	{
+		memset(z_tensor->data.f32, 0, sizeof(float) * 64 * 128);
+		ccv_nnc_graph_run_with_schedule(graph, 0, 0, 0, 0);
+		REQUIRE_TENSOR_EQ(z_tensor, expected, "running on the thread pool should match running inline");
+	}
+	ccv_nnc_stream_context_set_cpu_thread_count(1);
+	ccv_nnc_tensor_free(expected);
+	ccv_nnc_symbolic_graph_free(symbolic_graph);
+	ccv_nnc_graph_free(graph);
+	ccv_nnc_tensor_arena_free(tensor_arena);
+	ccv_nnc_graph_exec_arena_free(graph_exec_arena);
+}
+
+static struct {
+	int started;
+	int overlapped;
+	pthread_t threads[2];
+	int found_neighbor[2];
+} branches;
+
+static int _ccv_nnc_wait_for_other_branch(const ccv_nnc_cmd_t cmd, const ccv_nnc_hint_t hint, const int flags, ccv_nnc_tensor_t* const* const inputs, const int input_size, ccv_nnc_tensor_t* const* const outputs, const int output_size, ccv_nnc_stream_context_t* const stream_context)
+{
+	const int idx = __atomic_fetch_add(&branches.started, 1, __ATOMIC_SEQ_CST);
+	if (idx < 2)
+	{
+		branches.threads[idx] = pthread_self();
+		branches.found_neighbor[idx] = stream_context && ccv_nnc_stream_context_find_neighbor(stream_context, CCV_STREAM_GET_DEVICE_ID(ccv_nnc_stream_context_type(stream_context))) == stream_context;
+	}
+	// The other branch can only start in the meantime if both run at the same time.
+	int i;
+	for (i = 0; i < 2000 && __atomic_load_n(&branches.started, __ATOMIC_SEQ_CST) < 2; i++)
+		usleep(1000);
+	if (__atomic_load_n(&branches.started, __ATOMIC_SEQ_CST) >= 2)
+		__atomic_add_fetch(&branches.overlapped, 1, __ATOMIC_SEQ_CST);
+	outputs[0]->data.f32[0] = inputs[0]->data.f32[0] + 1;
+	return CCV_NNC_EXEC_SUCCESS;
+}
+
+static ccv_nnc_cmd_vtab_t _wait_for_other_branch_isa = {
+	.exec = _ccv_nnc_wait_for_other_branch,
+};
+
+TEST_CASE("run commands of independent branches on pool threads at the same time")
+{
+	const ccv_nnc_cmd_t cmd = ccv_nnc_cmd(CCV_NNC_CUSTOM_FORWARD, &_wait_for_other_branch_isa, (ccv_nnc_cmd_param_t){}, 0);
+	ccv_nnc_symbolic_graph_t* const symbolic_graph = ccv_nnc_symbolic_graph_new();
+	const ccv_nnc_tensor_symbol_t x = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 1), "x");
+	const ccv_nnc_tensor_symbol_t a = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 1), "a");
+	const ccv_nnc_tensor_symbol_t b = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 1), "b");
+	const ccv_nnc_tensor_symbol_t c = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 1), "c");
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, cmd, TENSOR_SYMBOL_LIST(x), TENSOR_SYMBOL_LIST(a), "a");
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, cmd, TENSOR_SYMBOL_LIST(x), TENSOR_SYMBOL_LIST(b), "b");
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_EWSUM_FORWARD(), TENSOR_SYMBOL_LIST(a, b), TENSOR_SYMBOL_LIST(c), "sum");
+	ccv_nnc_graph_exec_symbol_autogen(symbolic_graph, 0, 0, CCV_NNC_AUTOGEN_ALL_EXECS | CCV_NNC_AUTOGEN_SOURCES_AND_DESTINATIONS);
+	ccv_nnc_graph_t* graph;
+	ccv_nnc_tensor_arena_t* tensor_arena;
+	ccv_nnc_graph_exec_arena_t* graph_exec_arena;
+	ccv_nnc_symbolic_graph_compile(symbolic_graph, ccv_nnc_default_compile_params,
+		0, 0,
+		TENSOR_SYMBOL_LIST(c),
+		SYMBOLIC_GRAPH_SOURCES(symbolic_graph), SYMBOLIC_GRAPH_DESTINATIONS(symbolic_graph),
+		&graph, &tensor_arena, &graph_exec_arena);
+	ccv_nnc_graph_set_default_static_schedule(graph, CCV_STREAM_CONTEXT_CPU);
+	REQUIRE_EQ(1, ccv_nnc_stream_context_cpu_thread_count(), "should run inline by default");
+	ccv_nnc_tensor_from_symbol(tensor_arena, x)->data.f32[0] = 1;
+	ccv_nnc_stream_context_set_cpu_thread_count(2);
+	ccv_nnc_graph_run_with_schedule(graph, 0, 0, 0, 0);
+	REQUIRE_EQ(2, branches.started, "both branches should run");
+	REQUIRE_EQ(2, branches.overlapped, "both branches should be running at the same time");
+	const pthread_t self = pthread_self();
+	REQUIRE(!pthread_equal(branches.threads[0], self) && !pthread_equal(branches.threads[1], self), "the branches should run on the thread pool");
+	REQUIRE(!pthread_equal(branches.threads[0], branches.threads[1]), "the branches should run on different threads");
+	REQUIRE(branches.found_neighbor[0] && branches.found_neighbor[1], "the neighbor discovery should still be valid when the command runs");
+	REQUIRE_EQ_WITH_TOLERANCE(ccv_nnc_tensor_from_symbol(tensor_arena, c)->data.f32[0], 4, 1e-5, "result should be equal");
+	ccv_nnc_stream_context_set_cpu_thread_count(1);
+	ccv_nnc_symbolic_graph_free(symbolic_graph);
+	ccv_nnc_graph_free(graph);
+	ccv_nnc_tensor_arena_free(tensor_arena);
+	ccv_nnc_graph_exec_arena_free(graph_exec_arena);
+}
+
 TEST_CASE("schedule symbolic graph to data parallel")
 {
 	ccv_nnc_symbolic_graph_t* const symbolic_graph = ccv_nnc_symbolic_graph_new();
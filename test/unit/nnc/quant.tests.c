@@ -0,0 +1,200 @@
+#include "case.h"
+#include "ccv_case.h"
+#include "ccv_nnc_case.h"
+#include <ccv.h>
+#include <nnc/ccv_nnc.h>
+#include <nnc/ccv_nnc_easy.h>
+#include "3rdparty/dsfmt/dSFMT.h"
+
+TEST_SETUP()
+{
+	ccv_nnc_init();
+}
+
+TEST_CASE("quantize and dequantize should round trip within half a step")
+{
+	ccv_nnc_tensor_t* const a = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1031), 0);
+	ccv_nnc_tensor_t* const qr = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(8U, 1031), 0);
+	ccv_nnc_tensor_t* const qo = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(8U, 1031), 0);
+	ccv_nnc_tensor_t* const b = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1031), 0);
+	dsfmt_t dsfmt;
+	dsfmt_init_gen_rand(&dsfmt, 0);
+	int i;
+	for (i = 0; i < 1031; i++)
+		a->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) * 4 - 1;
+	const float scale = 4.0 / 255;
+	const int zero_point = 64;
+	ccv_nnc_cmd_exec(CMD_QUANTIZE_FORWARD(scale, zero_point), ccv_nnc_no_hint, 0, TENSOR_LIST(a), TENSOR_LIST(qr), 0);
+	ccv_nnc_cmd_t cmd = CMD_QUANTIZE_FORWARD(scale, zero_point);
+	cmd.backend = CCV_NNC_BACKEND_CPU_OPT;
+	ccv_nnc_cmd_exec(cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(a), TENSOR_LIST(qo), 0);
+	REQUIRE_ARRAY_EQ(uint8_t, qo->data.u8, qr->data.u8, 1031, "CPU_OPT should quantize exactly as CPU_REF");
+	ccv_nnc_cmd_exec(CMD_QUANTIZE_BACKWARD(scale, zero_point), ccv_nnc_no_hint, 0, TENSOR_LIST(qo), TENSOR_LIST(b), 0);
+	REQUIRE_ARRAY_EQ_WITH_TOLERANCE(float, b->data.f32, a->data.f32, 1031, scale * 0.5 + 1e-5, "dequantized values should be within half a step");
+	ccv_nnc_tensor_free(a);
+	ccv_nnc_tensor_free(qr);
+	ccv_nnc_tensor_free(qo);
+	ccv_nnc_tensor_free(b);
+}
+
+TEST_CASE("quantized gemm with CPU_OPT against CPU_REF and FP32 gemm")
+{
+	const int cpu_features = ccv_nnc_cpu_features();
+	ccv_nnc_tensor_t* const a = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 131), 0);
+	ccv_nnc_tensor_t* const qa = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(8U, 4, 131), 0);
+	ccv_nnc_tensor_t* const w = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 23, 131), 0);
+	ccv_nnc_tensor_t* const bias = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 23), 0);
+	ccv_nnc_tensor_t* const b = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 23), 0);
+	ccv_nnc_tensor_t* const br = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 23), 0);
+	ccv_nnc_tensor_t* const bo = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 23), 0);
+	dsfmt_t dsfmt;
+	dsfmt_init_gen_rand(&dsfmt, 1);
+	int i, j;
+	for (i = 0; i < 4 * 131; i++)
+		a->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) * 2 - 0.5;
+	for (i = 0; i < 23 * 131; i++)
+		w->data.f32[i] = (dsfmt_genrand_open_close(&dsfmt) - 0.5) / 131;
+	for (i = 0; i < 23; i++)
+		bias->data.f32[i] = dsfmt_genrand_open_close(&dsfmt);
+	ccv_nnc_cmd_exec(CMD_GEMM_FORWARD(NO_TRANSPOSE, TRANSPOSE(0, 1)), ccv_nnc_no_hint, 0, TENSOR_LIST(a, w, bias), TENSOR_LIST(b), 0);
+	const float scale = 2.0 / 255;
+	const int zero_point = 64;
+	ccv_nnc_cmd_exec(CMD_QUANTIZE_FORWARD(scale, zero_point), ccv_nnc_no_hint, 0, TENSOR_LIST(a), TENSOR_LIST(qa), 0);
+	ccv_nnc_cmd_t cmd = CMD_QUANTIZED_GEMM_FORWARD(scale, zero_point, 0);
+	cmd.backend = CCV_NNC_BACKEND_CPU_REF;
+	ccv_nnc_cmd_exec(cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(qa, w, bias), TENSOR_LIST(br), 0);
+	REQUIRE_ARRAY_EQ_WITH_TOLERANCE(float, br->data.f32, b->data.f32, 4 * 23, 1e-2, "quantized gemm should be close to FP32 gemm");
+	const int features[] = {
+		0, CCV_NNC_CPU_FEATURE_AVX2, CCV_NNC_CPU_FEATURE_AVX2 | CCV_NNC_CPU_FEATURE_AVX512F | CCV_NNC_CPU_FEATURE_AVX512VNNI
+	};
+	cmd.backend = CCV_NNC_BACKEND_CPU_OPT;
+	for (i = 0; i < sizeof(features) / sizeof(features[0]); i++)
+	{
+		ccv_nnc_set_cpu_features(features[i] & cpu_features);
+		ccv_nnc_cmd_exec(cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(qa, w, bias), TENSOR_LIST(bo), 0);
+		REQUIRE_ARRAY_EQ_WITH_TOLERANCE(float, bo->data.f32, br->data.f32, 4 * 23, 1e-5, "quantized gemm with CPU_OPT should match CPU_REF");
+		// One row goes through the path parallel over output channels.
+		ccv_nnc_tensor_t* const qa1 = ccv_nnc_tensor_new(qa->data.u8 + 131, CPU_TENSOR_NHWC(8U, 131), 0);
+		ccv_nnc_tensor_t* const bo1 = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 23), 0);
+		ccv_nnc_cmd_exec(cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(qa1, w, bias), TENSOR_LIST(bo1), 0);
+		for (j = 0; j < 23; j++)
+			bo->data.f32[j] = br->data.f32[23 + j];
+		REQUIRE_ARRAY_EQ_WITH_TOLERANCE(float, bo1->data.f32, bo->data.f32, 23, 1e-5, "quantized gemm with one row should match CPU_REF");
+		ccv_nnc_tensor_free(qa1);
+		ccv_nnc_tensor_free(bo1);
+	}
+	ccv_nnc_set_cpu_features(cpu_features);
+	ccv_nnc_tensor_free(a);
+	ccv_nnc_tensor_free(qa);
+	ccv_nnc_tensor_free(w);
+	ccv_nnc_tensor_free(bias);
+	ccv_nnc_tensor_free(b);
+	ccv_nnc_tensor_free(br);
+	ccv_nnc_tensor_free(bo);
+}
+
+TEST_CASE("quantized convolution with CPU_OPT against CPU_REF and FP32 convolution")
+{
+	const int cpu_features = ccv_nnc_cpu_features();
+	ccv_nnc_tensor_t* const a = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 23, 21, 35), 0);
+	ccv_nnc_tensor_t* const qa = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(8U, 1, 23, 21, 35), 0);
+	ccv_nnc_tensor_t* const w = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 7, 3, 5, 35), 0);
+	ccv_nnc_tensor_t* const bias = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 7), 0);
+	ccv_nnc_tensor_t* const b = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 23, 21, 7), 0);
+	ccv_nnc_tensor_t* const br = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 23, 21, 7), 0);
+	ccv_nnc_tensor_t* const bo = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 23, 21, 7), 0);
+	dsfmt_t dsfmt;
+	dsfmt_init_gen_rand(&dsfmt, 2);
+	int i;
+	for (i = 0; i < 23 * 21 * 35; i++)
+		a->data.f32[i] = dsfmt_genrand_open_close(&dsfmt);
+	for (i = 0; i < 7 * 3 * 5 * 35; i++)
+		w->data.f32[i] = (dsfmt_genrand_open_close(&dsfmt) - 0.5) / (3 * 5 * 35);
+	for (i = 0; i < 7; i++)
+		bias->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) - 0.5;
+	const ccv_nnc_cmd_t conv = CMD_CONVOLUTION_FORWARD(1, 7, 3, 5, 35);
+	const ccv_nnc_hint_t hint = ccv_nnc_hint_auto(conv.info, a->info, b->info);
+	ccv_nnc_cmd_exec(conv, hint, 0, TENSOR_LIST(a, w, bias), TENSOR_LIST(b), 0);
+	// Apply ReLU to the reference, the quantized convolution carries the activation.
+	for (i = 0; i < 23 * 21 * 7; i++)
+		b->data.f32[i] = ccv_max(b->data.f32[i], 0);
+	const float scale = 1.0 / 255;
+	const int zero_point = 0;
+	ccv_nnc_cmd_exec(CMD_QUANTIZE_FORWARD(scale, zero_point), ccv_nnc_no_hint, 0, TENSOR_LIST(a), TENSOR_LIST(qa), 0);
+	ccv_nnc_cmd_t cmd = CMD_QUANTIZED_CONVOLUTION_FORWARD(scale, zero_point, CCV_NNC_RELU_FORWARD, 7, 3, 5, 35);
+	cmd.backend = CCV_NNC_BACKEND_CPU_REF;
+	ccv_nnc_cmd_exec(cmd, hint, 0, TENSOR_LIST(qa, w, bias), TENSOR_LIST(br), 0);
+	REQUIRE_ARRAY_EQ_WITH_TOLERANCE(float, br->data.f32, b->data.f32, 23 * 21 * 7, 1e-2, "quantized convolution should be close to FP32 convolution");
+	// With a non-zero zero point, the border windows need the weight sum correction.
+	const int zero_points[] = {
+		0, 37
+	};
+	const int features[] = {
+		0, CCV_NNC_CPU_FEATURE_AVX2, CCV_NNC_CPU_FEATURE_AVX2 | CCV_NNC_CPU_FEATURE_AVX512F | CCV_NNC_CPU_FEATURE_AVX512VNNI
+	};
+	int j, k;
+	for (k = 0; k < sizeof(zero_points) / sizeof(zero_points[0]); k++)
+	{
+		ccv_nnc_cmd_exec(CMD_QUANTIZE_FORWARD(scale, zero_points[k]), ccv_nnc_no_hint, 0, TENSOR_LIST(a), TENSOR_LIST(qa), 0);
+		cmd = CMD_QUANTIZED_CONVOLUTION_FORWARD(scale, zero_points[k], CCV_NNC_RELU_FORWARD, 7, 3, 5, 35);
+		cmd.backend = CCV_NNC_BACKEND_CPU_REF;
+		ccv_nnc_cmd_exec(cmd, hint, 0, TENSOR_LIST(qa, w, bias), TENSOR_LIST(br), 0);
+		cmd.backend = CCV_NNC_BACKEND_CPU_OPT;
+		for (j = 0; j < sizeof(features) / sizeof(features[0]); j++)
+		{
+			ccv_nnc_set_cpu_features(features[j] & cpu_features);
+			ccv_nnc_cmd_exec(cmd, hint, 0, TENSOR_LIST(qa, w, bias), TENSOR_LIST(bo), 0);
+			REQUIRE_ARRAY_EQ_WITH_TOLERANCE(float, bo->data.f32, br->data.f32, 23 * 21 * 7, 1e-5, "quantized convolution with CPU_OPT should match CPU_REF");
+		}
+		ccv_nnc_set_cpu_features(cpu_features);
+	}
+	ccv_nnc_tensor_free(a);
+	ccv_nnc_tensor_free(qa);
+	ccv_nnc_tensor_free(w);
+	ccv_nnc_tensor_free(bias);
+	ccv_nnc_tensor_free(b);
+	ccv_nnc_tensor_free(br);
+	ccv_nnc_tensor_free(bo);
+}
+
+TEST_CASE("calibrate and quantize a model for inference")
+{
+	ccv_cnnp_model_t* const sequential = ccv_cnnp_sequential_new(MODEL_LIST(
+		ccv_cnnp_convolution(1, 16, DIM_ALLOC(3, 3), 0, HINT((1, 1), (1, 1)), 0),
+		ccv_cnnp_relu(0),
+		ccv_cnnp_flatten(0),
+		ccv_cnnp_dense(32, 0, 0),
+		ccv_cnnp_relu(0),
+		ccv_cnnp_dense(10, 0, 0)
+	), 0);
+	const ccv_nnc_tensor_param_t input = CPU_TENSOR_NHWC(32F, 1, 8, 8, 3);
+	ccv_cnnp_model_compile(sequential, &input, 1, CMD_NOOP(), CMD_NOOP());
+	ccv_nnc_tensor_t* const input_tensor = ccv_nnc_tensor_new(0, input, 0);
+	dsfmt_t dsfmt;
+	int i;
+	dsfmt_init_gen_rand(&dsfmt, 3);
+	for (i = 0; i < 8 * 8 * 3; i++)
+		input_tensor->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) * 2 - 1;
+	ccv_nnc_tensor_t* const b = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 10), 0);
+	ccv_nnc_tensor_t* const bq = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 10), 0);
+	ccv_cnnp_model_evaluate(sequential, (ccv_cnnp_evaluate_param_t){
+		.is_test = 1
+	}, TENSOR_LIST(input_tensor), TENSOR_LIST(b), 0, 0);
+	ccv_cnnp_model_calibrate(sequential, TENSOR_LIST(input_tensor), 0);
+	ccv_cnnp_model_quantize(sequential);
+	ccv_cnnp_model_evaluate(sequential, (ccv_cnnp_evaluate_param_t){
+		.is_test = 1
+	}, TENSOR_LIST(input_tensor), TENSOR_LIST(bq), 0, 0);
+	float max = 0;
+	for (i = 0; i < 10; i++)
+		max = ccv_max(max, fabsf(b->data.f32[i]));
+	REQUIRE(max > 0, "the model output shouldn't be all zeros");
+	REQUIRE(memcmp(bq->data.f32, b->data.f32, sizeof(float) * 10) != 0, "the model should run with quantized commands");
+	REQUIRE_ARRAY_EQ_WITH_TOLERANCE(float, bq->data.f32, b->data.f32, 10, max * 0.05, "quantized model should be close to the FP32 model");
+	ccv_nnc_tensor_free(input_tensor);
+	ccv_nnc_tensor_free(b);
+	ccv_nnc_tensor_free(bq);
+	ccv_cnnp_model_free(sequential);
+}
+
+#include "case_main.h"
@@ -110,4 +110,43 @@ TEST_CASE("use reduce for softmax")
 	ccv_nnc_graph_exec_arena_free(graph_exec_arena);
 }
 
+TEST_CASE("reduce sum and max with CPU_OPT against CPU_REF")
+{
+	ccv_nnc_tensor_t* const a = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 6, 7, 301), 0);
+	dsfmt_t dsfmt;
+	dsfmt_init_gen_rand(&dsfmt, 0);
+	int i, j;
+	for (i = 0; i < 4 * 6 * 7 * 301; i++)
+		a->data.f32[i] = dsfmt_genrand_open_close(&dsfmt);
+	const int bdims[][4] = {
+		{4, 1, 1, 301},
+		{4, 6, 7, 1},
+		{1, 6, 7, 301},
+		{1, 1, 1, 1},
+	};
+	const ccv_nnc_cmd_param_t params[] = {
+		CMD_REDUCE(1, 2),
+		CMD_REDUCE(3),
+		CMD_REDUCE(0),
+		CMD_REDUCE(0, 1, 2, 3),
+	};
+	for (i = 0; i < sizeof(bdims) / sizeof(bdims[0]); i++)
+	{
+		ccv_nnc_tensor_t* const ref = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, bdims[i][0], bdims[i][1], bdims[i][2], bdims[i][3]), 0);
+		ccv_nnc_tensor_t* const opt = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, bdims[i][0], bdims[i][1], bdims[i][2], bdims[i][3]), 0);
+		for (j = 0; j < 2; j++)
+		{
+			ccv_nnc_cmd_t cmd = ccv_nnc_cmd(j == 0 ? CCV_NNC_REDUCE_SUM_FORWARD : CCV_NNC_REDUCE_MAX_FORWARD, 0, params[i], 0);
+			cmd.backend = CCV_NNC_BACKEND_CPU_REF;
+			ccv_nnc_cmd_exec(cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(a), TENSOR_LIST(ref), 0);
+			cmd.backend = CCV_NNC_BACKEND_CPU_OPT;
+			ccv_nnc_cmd_exec(cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(a), TENSOR_LIST(opt), 0);
+			REQUIRE_TENSOR_EQ(ref, opt, "reduce from CPU_OPT should match CPU_REF");
+		}
+		ccv_nnc_tensor_free(ref);
+		ccv_nnc_tensor_free(opt);
+	}
+	ccv_nnc_tensor_free(a);
+}
+
 #include "case_main.h"
@@ -145,6 +145,219 @@ TEST_CASE("simplify graph with softmax + crossentropy")
 	ccv_nnc_tensor_free(da1_tensor);
 }
 
+TEST_CASE("simplify graph with convolution + batch norm + relu")
+{
+	ccv_nnc_symbolic_graph_t* const symbolic_graph = ccv_nnc_symbolic_graph_new();
+	const ccv_nnc_tensor_symbol_t x = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 1, 15, 15, 8), "x");
+	const ccv_nnc_tensor_symbol_t w = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 16, 3, 3, 8), "w");
+	const ccv_nnc_tensor_symbol_t bias = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 16), "bias");
+	const ccv_nnc_tensor_symbol_t y0 = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 1, 15, 15, 16), "y0");
+	const ccv_nnc_graph_exec_symbol_t conv = ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_CONVOLUTION_FORWARD(1, 16, 3, 3, 8), TENSOR_SYMBOL_LIST(x, w, bias), TENSOR_SYMBOL_LIST(y0), "conv");
+	const ccv_nnc_tensor_symbol_t scale = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 16), "scale");
+	const ccv_nnc_tensor_symbol_t beta = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 16), "beta");
+	const ccv_nnc_tensor_symbol_t mean = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 16), "mean");
+	const ccv_nnc_tensor_symbol_t var = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 16), "var");
+	const ccv_nnc_tensor_symbol_t y1 = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 1, 15, 15, 16), "y1");
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_BATCH_NORM_FORWARD(1e-4, 1, 0.9, 0, 1, 2), TENSOR_SYMBOL_LIST(y0, scale, beta, mean, var), TENSOR_SYMBOL_LIST(y1), "batch norm");
+	const ccv_nnc_tensor_symbol_t y = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 1, 15, 15, 16), "y");
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_RELU_FORWARD(), TENSOR_SYMBOL_LIST(y1), TENSOR_SYMBOL_LIST(y), "relu");
+	ccv_nnc_graph_exec_symbol_autogen(symbolic_graph, 0, 0, CCV_NNC_AUTOGEN_ALL_EXECS | CCV_NNC_AUTOGEN_SOURCES_AND_DESTINATIONS);
+	ccv_nnc_symbolic_graph_simplify(symbolic_graph,
+		SYMBOLIC_GRAPH_PASSES(CCV_NNC_SIMPLIFY_OPS_FUSION),
+		TENSOR_SYMBOL_LIST(y), SYMBOLIC_GRAPH_SOURCES(symbolic_graph), SYMBOLIC_GRAPH_DESTINATIONS(symbolic_graph));
+	SYMBOLIC_GRAPH_GEN(symbolic_graph, CCV_NNC_LONG_DOT_GRAPH);
+	REQUIRE_EQ(ccv_nnc_symbolic_graph_active_symbol_count(symbolic_graph, CCV_NNC_SYMBOL_GRAPH_EXEC), 1, "convolution, batch norm and relu should be fused into one");
+	REQUIRE_EQ(ccv_nnc_graph_exec_symbol_cmd(symbolic_graph, conv).cmd, CCV_NNC_FUSED_CONVOLUTION_FORWARD, "the convolution should be the fused one");
+	ccv_nnc_graph_t* graph = 0;
+	ccv_nnc_tensor_arena_t* tensor_arena = 0;
+	ccv_nnc_graph_exec_arena_t* graph_exec_arena = 0;
+	ccv_nnc_symbolic_graph_compile(symbolic_graph, ccv_nnc_default_compile_params, 0, 0, 0, 0, SYMBOLIC_GRAPH_SOURCES(symbolic_graph), SYMBOLIC_GRAPH_DESTINATIONS(symbolic_graph), &graph, &tensor_arena, &graph_exec_arena);
+	GRAPH_GEN(graph, CCV_NNC_LONG_DOT_GRAPH);
+	ccv_nnc_tensor_t* const x_tensor = ccv_nnc_tensor_from_symbol(tensor_arena, x);
+	ccv_nnc_tensor_t* const w_tensor = ccv_nnc_tensor_from_symbol(tensor_arena, w);
+	ccv_nnc_tensor_t* const bias_tensor = ccv_nnc_tensor_from_symbol(tensor_arena, bias);
+	ccv_nnc_tensor_t* const scale_tensor = ccv_nnc_tensor_from_symbol(tensor_arena, scale);
+	ccv_nnc_tensor_t* const beta_tensor = ccv_nnc_tensor_from_symbol(tensor_arena, beta);
+	ccv_nnc_tensor_t* const mean_tensor = ccv_nnc_tensor_from_symbol(tensor_arena, mean);
+	ccv_nnc_tensor_t* const var_tensor = ccv_nnc_tensor_from_symbol(tensor_arena, var);
+	int i;
+	for (i = 0; i < 15 * 15 * 8; i++)
+		x_tensor->data.f32[i] = (float)(i % 19) / 19;
+	for (i = 0; i < 16 * 3 * 3 * 8; i++)
+		w_tensor->data.f32[i] = (float)(i % 13) / 13 - 0.4;
+	for (i = 0; i < 16; i++)
+	{
+		bias_tensor->data.f32[i] = (float)i / 16;
+		scale_tensor->data.f32[i] = 1 + (float)i / 8;
+		beta_tensor->data.f32[i] = 0.5 - (float)i / 16;
+		mean_tensor->data.f32[i] = (float)i / 32;
+		var_tensor->data.f32[i] = 1 + (float)i / 4;
+	}
+	ccv_nnc_graph_run(graph, 0, TRAVERSE_FULL, 0, 0);
+	// Compute the same with the commands not fused.
+	ccv_nnc_tensor_t* const y0_tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 15, 15, 16), 0);
+	ccv_nnc_tensor_t* const y1_tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1, 15, 15, 16), 0);
+	const ccv_nnc_cmd_t conv_cmd = CMD_CONVOLUTION_FORWARD(1, 16, 3, 3, 8);
+	ccv_nnc_cmd_exec(conv_cmd, ccv_nnc_hint_auto(conv_cmd.info, x_tensor->info, y0_tensor->info), 0, TENSOR_LIST(x_tensor, w_tensor, bias_tensor), TENSOR_LIST(y0_tensor), 0);
+	ccv_nnc_cmd_exec(CMD_BATCH_NORM_FORWARD(1e-4, 1, 0.9, 0, 1, 2), ccv_nnc_no_hint, 0, TENSOR_LIST(y0_tensor, scale_tensor, beta_tensor, mean_tensor, var_tensor), TENSOR_LIST(y1_tensor), 0);
+	ccv_nnc_cmd_exec(CMD_RELU_FORWARD(), ccv_nnc_no_hint, 0, TENSOR_LIST(y1_tensor), TENSOR_LIST(y0_tensor), 0);
+	ccv_nnc_tensor_t* const y_tensor = ccv_nnc_tensor_from_symbol(tensor_arena, y);
+	REQUIRE_TENSOR_EQ(y_tensor, y0_tensor, "fused convolution should match the separate commands");
+	ccv_nnc_tensor_free(y0_tensor);
+	ccv_nnc_tensor_free(y1_tensor);
+	ccv_nnc_symbolic_graph_free(symbolic_graph);
+	ccv_nnc_graph_free(graph);
+	ccv_nnc_tensor_arena_free(tensor_arena);
+	ccv_nnc_graph_exec_arena_free(graph_exec_arena);
+}
+
+TEST_CASE("simplify graph with gemm + sigmoid and an element-wise chain, then backward")
+{
+	ccv_nnc_symbolic_graph_t* const symbolic_graph = ccv_nnc_symbolic_graph_new();
+	const ccv_nnc_tensor_symbol_t a = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 4, 6), "a");
+	const ccv_nnc_tensor_symbol_t w = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 5, 6), "w");
+	const ccv_nnc_tensor_symbol_t bias = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 5), "bias");
+	const ccv_nnc_tensor_symbol_t b0 = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 4, 5), "b0");
+	const ccv_nnc_graph_exec_symbol_t gemm = ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_GEMM_FORWARD(NO_TRANSPOSE, TRANSPOSE(0, 1)), TENSOR_SYMBOL_LIST(a, w, bias), TENSOR_SYMBOL_LIST(b0), "gemm");
+	const ccv_nnc_tensor_symbol_t b = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 4, 5), "b");
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_SIGMOID_FORWARD(), TENSOR_SYMBOL_LIST(b0), TENSOR_SYMBOL_LIST(b), "sigmoid");
+	// c = exp(b) * y + z
+	const ccv_nnc_tensor_symbol_t y = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 4, 5), "y");
+	const ccv_nnc_tensor_symbol_t z = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 4, 5), "z");
+	const ccv_nnc_tensor_symbol_t c0 = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 4, 5), "c0");
+	const ccv_nnc_graph_exec_symbol_t exp = ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_EWEXP_FORWARD(), TENSOR_SYMBOL_LIST(b), TENSOR_SYMBOL_LIST(c0), "exp");
+	const ccv_nnc_tensor_symbol_t c1 = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 4, 5), "c1");
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_EWPROD_FORWARD(), TENSOR_SYMBOL_LIST(y, c0), TENSOR_SYMBOL_LIST(c1), "prod");
+	const ccv_nnc_tensor_symbol_t c = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 4, 5), "c");
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_EWSUM_FORWARD(), TENSOR_SYMBOL_LIST(c1, z), TENSOR_SYMBOL_LIST(c), "sum");
+	ccv_nnc_graph_exec_symbol_autogen(symbolic_graph, 0, 0, CCV_NNC_AUTOGEN_ALL_EXECS | CCV_NNC_AUTOGEN_SOURCES_AND_DESTINATIONS);
+	ccv_nnc_symbolic_graph_simplify(symbolic_graph,
+		SYMBOLIC_GRAPH_PASSES(CCV_NNC_SIMPLIFY_OPS_FUSION),
+		TENSOR_SYMBOL_LIST(c), SYMBOLIC_GRAPH_SOURCES(symbolic_graph), SYMBOLIC_GRAPH_DESTINATIONS(symbolic_graph));
+	REQUIRE_EQ(ccv_nnc_symbolic_graph_active_symbol_count(symbolic_graph, CCV_NNC_SYMBOL_GRAPH_EXEC), 2, "gemm + sigmoid and the element-wise chain should be fused");
+	REQUIRE_EQ(ccv_nnc_graph_exec_symbol_cmd(symbolic_graph, gemm).cmd, CCV_NNC_FUSED_GEMM_FORWARD, "the gemm should be the fused one");
+	REQUIRE_EQ(ccv_nnc_graph_exec_symbol_cmd(symbolic_graph, exp).cmd, CCV_NNC_FUSED_EW_FORWARD, "the exp should be the fused one");
+	ccv_nnc_symbolic_graph_backward(symbolic_graph, TENSOR_SYMBOL_LIST(c), TENSOR_SYMBOL_LIST(a, w, y), SYMBOLIC_GRAPH_SOURCES(symbolic_graph), SYMBOLIC_GRAPH_DESTINATIONS(symbolic_graph));
+	const ccv_nnc_tensor_symbol_t dc = ccv_nnc_tensor_symbol_for_backward(symbolic_graph, c);
+	const ccv_nnc_tensor_symbol_t da = ccv_nnc_tensor_symbol_for_backward(symbolic_graph, a);
+	const ccv_nnc_tensor_symbol_t dw = ccv_nnc_tensor_symbol_for_backward(symbolic_graph, w);
+	const ccv_nnc_tensor_symbol_t dy = ccv_nnc_tensor_symbol_for_backward(symbolic_graph, y);
+	ccv_nnc_graph_exec_symbol_autogen(symbolic_graph, 0, 0, CCV_NNC_AUTOGEN_ALL_EXECS | CCV_NNC_AUTOGEN_SOURCES_AND_DESTINATIONS);
+	SYMBOLIC_GRAPH_GEN(symbolic_graph, CCV_NNC_LONG_DOT_GRAPH);
+	ccv_nnc_graph_t* graph = 0;
+	ccv_nnc_tensor_arena_t* tensor_arena = 0;
+	ccv_nnc_graph_exec_arena_t* graph_exec_arena = 0;
+	ccv_nnc_symbolic_graph_compile(symbolic_graph, ccv_nnc_default_compile_params, 0, 0, TENSOR_SYMBOL_LIST(c, da, dw, dy), SYMBOLIC_GRAPH_SOURCES(symbolic_graph), SYMBOLIC_GRAPH_DESTINATIONS(symbolic_graph), &graph, &tensor_arena, &graph_exec_arena);
+	GRAPH_GEN(graph, CCV_NNC_LONG_DOT_GRAPH);
+	ccv_nnc_tensor_t* const a_tensor = ccv_nnc_tensor_from_symbol(tensor_arena, a);
+	ccv_nnc_tensor_t* const w_tensor = ccv_nnc_tensor_from_symbol(tensor_arena, w);
+	ccv_nnc_tensor_t* const bias_tensor = ccv_nnc_tensor_from_symbol(tensor_arena, bias);
+	ccv_nnc_tensor_t* const y_tensor = ccv_nnc_tensor_from_symbol(tensor_arena, y);
+	ccv_nnc_tensor_t* const z_tensor = ccv_nnc_tensor_from_symbol(tensor_arena, z);
+	ccv_nnc_tensor_t* const dc_tensor = ccv_nnc_tensor_from_symbol(tensor_arena, dc);
+	int i;
+	for (i = 0; i < 4 * 6; i++)
+		a_tensor->data.f32[i] = (float)(i % 7) / 7 - 0.3;
+	for (i = 0; i < 5 * 6; i++)
+		w_tensor->data.f32[i] = (float)(i % 5) / 5 - 0.5;
+	for (i = 0; i < 5; i++)
+		bias_tensor->data.f32[i] = (float)i / 5;
+	for (i = 0; i < 4 * 5; i++)
+	{
+		y_tensor->data.f32[i] = 1 + (float)i / 20;
+		z_tensor->data.f32[i] = 2 - (float)i / 20;
+		dc_tensor->data.f32[i] = 1;
+	}
+	// Compute the same with the commands not fused, before running the graph because the inputs may be reused by the gradients.
+	ccv_nnc_tensor_t* const b0_tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 5), 0);
+	ccv_nnc_tensor_t* const b_tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 5), 0);
+	ccv_nnc_tensor_t* const c0_tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 5), 0);
+	ccv_nnc_tensor_t* const c1_tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 5), 0);
+	ccv_nnc_tensor_t* const c_tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 5), 0);
+	ccv_nnc_cmd_exec(CMD_GEMM_FORWARD(NO_TRANSPOSE, TRANSPOSE(0, 1)), ccv_nnc_no_hint, 0, TENSOR_LIST(a_tensor, w_tensor, bias_tensor), TENSOR_LIST(b0_tensor), 0);
+	ccv_nnc_cmd_exec(CMD_SIGMOID_FORWARD(), ccv_nnc_no_hint, 0, TENSOR_LIST(b0_tensor), TENSOR_LIST(b_tensor), 0);
+	ccv_nnc_cmd_exec(CMD_EWEXP_FORWARD(), ccv_nnc_no_hint, 0, TENSOR_LIST(b_tensor), TENSOR_LIST(c0_tensor), 0);
+	ccv_nnc_cmd_exec(CMD_EWPROD_FORWARD(), ccv_nnc_no_hint, 0, TENSOR_LIST(y_tensor, c0_tensor), TENSOR_LIST(c1_tensor), 0);
+	ccv_nnc_cmd_exec(CMD_EWSUM_FORWARD(), ccv_nnc_no_hint, 0, TENSOR_LIST(c1_tensor, z_tensor), TENSOR_LIST(c_tensor), 0);
+	// dc / dy = exp(b), dc / db0 = y * exp(b) * b * (1 - b).
+	ccv_nnc_tensor_t* const db0_tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 5), 0);
+	for (i = 0; i < 4 * 5; i++)
+		db0_tensor->data.f32[i] = y_tensor->data.f32[i] * c0_tensor->data.f32[i] * b_tensor->data.f32[i] * (1 - b_tensor->data.f32[i]);
+	ccv_nnc_tensor_t* const da_tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 4, 6), 0);
+	ccv_nnc_tensor_t* const dw_tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 5, 6), 0);
+	ccv_nnc_cmd_exec(CMD_GEMM_BACKWARD(NO_TRANSPOSE, TRANSPOSE(0, 1)), ccv_nnc_no_hint, 0, TENSOR_LIST(db0_tensor, a_tensor, w_tensor), TENSOR_LIST(da_tensor, dw_tensor), 0);
+	ccv_nnc_graph_run(graph, 0, TRAVERSE_FULL, 0, 0);
+	REQUIRE_TENSOR_EQ(ccv_nnc_tensor_from_symbol(tensor_arena, c), c_tensor, "fused commands should match the separate commands");
+	REQUIRE_TENSOR_EQ(ccv_nnc_tensor_from_symbol(tensor_arena, dy), c0_tensor, "gradient w.r.t. y should be exp(b)");
+	REQUIRE_TENSOR_EQ(ccv_nnc_tensor_from_symbol(tensor_arena, da), da_tensor, "gradient w.r.t. a should match the separate commands");
+	REQUIRE_TENSOR_EQ(ccv_nnc_tensor_from_symbol(tensor_arena, dw), dw_tensor, "gradient w.r.t. w should match the separate commands");
+	ccv_nnc_tensor_free(b0_tensor);
+	ccv_nnc_tensor_free(b_tensor);
+	ccv_nnc_tensor_free(c0_tensor);
+	ccv_nnc_tensor_free(c1_tensor);
+	ccv_nnc_tensor_free(c_tensor);
+	ccv_nnc_tensor_free(db0_tensor);
+	ccv_nnc_tensor_free(da_tensor);
+	ccv_nnc_tensor_free(dw_tensor);
+	ccv_nnc_symbolic_graph_free(symbolic_graph);
+	ccv_nnc_graph_free(graph);
+	ccv_nnc_tensor_arena_free(tensor_arena);
+	ccv_nnc_graph_exec_arena_free(graph_exec_arena);
+}
+
+TEST_CASE("simplify graph with constant folding")
+{
+	ccv_nnc_symbolic_graph_t* const symbolic_graph = ccv_nnc_symbolic_graph_new();
+	ccv_nnc_tensor_t* const w_tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 6, 4), 0);
+	int i, j, k;
+	for (i = 0; i < 6 * 4; i++)
+		w_tensor->data.f32[i] = (float)i / 24 - 0.5;
+	const ccv_nnc_tensor_symbol_t w = ccv_nnc_tensor_symbol_constant_new(symbolic_graph, w_tensor, "w");
+	const ccv_nnc_tensor_symbol_t wt = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 4, 6), "wt");
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_TRANSPOSE_FORWARD(0, 1), TENSOR_SYMBOL_LIST(w), TENSOR_SYMBOL_LIST(wt), "transpose");
+	const ccv_nnc_tensor_symbol_t w1 = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 4, 6), "w1");
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_SCALAR_MUL_FORWARD(0.5), TENSOR_SYMBOL_LIST(wt), TENSOR_SYMBOL_LIST(w1), "scale");
+	const ccv_nnc_tensor_symbol_t x = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 2, 6), "x");
+	const ccv_nnc_tensor_symbol_t y = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 2, 4), "y");
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_GEMM_FORWARD(NO_TRANSPOSE, TRANSPOSE(0, 1)), TENSOR_SYMBOL_LIST(x, w1), TENSOR_SYMBOL_LIST(y), "gemm");
+	ccv_nnc_graph_exec_symbol_autogen(symbolic_graph, 0, 0, CCV_NNC_AUTOGEN_ALL_EXECS | CCV_NNC_AUTOGEN_SOURCES_AND_DESTINATIONS);
+	ccv_nnc_symbolic_graph_simplify(symbolic_graph,
+		SYMBOLIC_GRAPH_PASSES(CCV_NNC_SIMPLIFY_CONSTANT_FOLDING),
+		TENSOR_SYMBOL_LIST(y), SYMBOLIC_GRAPH_SOURCES(symbolic_graph), SYMBOLIC_GRAPH_DESTINATIONS(symbolic_graph));
+	SYMBOLIC_GRAPH_GEN(symbolic_graph, CCV_NNC_LONG_DOT_GRAPH);
+	REQUIRE_EQ(ccv_nnc_symbolic_graph_active_symbol_count(symbolic_graph, CCV_NNC_SYMBOL_GRAPH_EXEC), 1, "only the gemm should be left");
+	const ccv_nnc_tensor_t* const w1_constant = ccv_nnc_tensor_symbol_constant(symbolic_graph, w1);
+	REQUIRE(w1_constant, "w1 should be folded into a constant");
+	for (i = 0; i < 4; i++)
+		for (j = 0; j < 6; j++)
+			REQUIRE_EQ_WITH_TOLERANCE(w1_constant->data.f32[i * 6 + j], w_tensor->data.f32[j * 4 + i] * 0.5, 1e-6, "w1 should be the transposed and scaled w");
+	ccv_nnc_graph_t* graph = 0;
+	ccv_nnc_tensor_arena_t* tensor_arena = 0;
+	ccv_nnc_graph_exec_arena_t* graph_exec_arena = 0;
+	ccv_nnc_symbolic_graph_compile(symbolic_graph, ccv_nnc_default_compile_params, 0, 0, 0, 0, SYMBOLIC_GRAPH_SOURCES(symbolic_graph), SYMBOLIC_GRAPH_DESTINATIONS(symbolic_graph), &graph, &tensor_arena, &graph_exec_arena);
+	// The symbolic graph can be freed before the concrete graph.
+	ccv_nnc_symbolic_graph_free(symbolic_graph);
+	ccv_nnc_tensor_t* const x_tensor = ccv_nnc_tensor_from_symbol(tensor_arena, x);
+	for (i = 0; i < 2 * 6; i++)
+		x_tensor->data.f32[i] = (float)i / 12;
+	ccv_nnc_graph_run(graph, 0, TRAVERSE_FULL, 0, 0);
+	ccv_nnc_tensor_t* const y_tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 2, 4), 0);
+	for (i = 0; i < 2; i++)
+		for (j = 0; j < 4; j++)
+		{
+			float v = 0;
+			for (k = 0; k < 6; k++)
+				v += x_tensor->data.f32[i * 6 + k] * w_tensor->data.f32[k * 4 + j] * 0.5;
+			y_tensor->data.f32[i * 4 + j] = v;
+		}
+	REQUIRE_TENSOR_EQ(ccv_nnc_tensor_from_symbol(tensor_arena, y), y_tensor, "result should be the same as computing with the constant in place");
+	ccv_nnc_tensor_free(w_tensor);
+	ccv_nnc_tensor_free(y_tensor);
+	ccv_nnc_graph_free(graph);
+	ccv_nnc_tensor_arena_free(tensor_arena);
+	ccv_nnc_graph_exec_arena_free(graph_exec_arena);
+}
+
 static int custom_case_of(ccv_nnc_tensor_t* const* const inputs, const int input_size, const void* const data)
 {
 	assert(input_size == 1);
@@ -80,4 +80,33 @@ TEST_CASE("compare swish gradient with fine-grained symbolic graph")
 	ccv_nnc_graph_free(swish_graph);
 }
 
+TEST_CASE("swish with CPU_OPT against CPU_REF")
+{
+	ccv_nnc_tensor_t* const x = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1001), 0);
+	ccv_nnc_tensor_t* const g = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1001), 0);
+	ccv_nnc_tensor_t* const ref = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1001), 0);
+	ccv_nnc_tensor_t* const opt = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 1001), 0);
+	dsfmt_t dsfmt;
+	dsfmt_init_gen_rand(&dsfmt, 0);
+	int i;
+	for (i = 0; i < 1001; i++)
+		x->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) * 8 - 4, g->data.f32[i] = dsfmt_genrand_open_close(&dsfmt);
+	ccv_nnc_cmd_t cmd = CMD_SWISH_FORWARD();
+	cmd.backend = CCV_NNC_BACKEND_CPU_REF;
+	ccv_nnc_cmd_exec(cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(x), TENSOR_LIST(ref), 0);
+	cmd.backend = CCV_NNC_BACKEND_CPU_OPT;
+	ccv_nnc_cmd_exec(cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(x), TENSOR_LIST(opt), 0);
+	REQUIRE_TENSOR_EQ(ref, opt, "swish from CPU_OPT should match CPU_REF");
+	cmd = CMD_SWISH_BACKWARD();
+	cmd.backend = CCV_NNC_BACKEND_CPU_REF;
+	ccv_nnc_cmd_exec(cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(g, x, 0), TENSOR_LIST(ref), 0);
+	cmd.backend = CCV_NNC_BACKEND_CPU_OPT;
+	ccv_nnc_cmd_exec(cmd, ccv_nnc_no_hint, 0, TENSOR_LIST(g, x, 0), TENSOR_LIST(opt), 0);
+	REQUIRE_TENSOR_EQ(ref, opt, "swish gradient from CPU_OPT should match CPU_REF");
+	ccv_nnc_tensor_free(x);
+	ccv_nnc_tensor_free(g);
+	ccv_nnc_tensor_free(ref);
+	ccv_nnc_tensor_free(opt);
+}
+
 #include "case_main.h"
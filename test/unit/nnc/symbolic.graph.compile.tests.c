@@ -213,4 +213,65 @@ TEST_CASE("compile symbolic graph with case..of")
 	ccv_nnc_graph_exec_arena_free(graph_exec_arena);
 }
 
+TEST_CASE("compile symbolic graph with the packing memory planner")
+{
+	ccv_nnc_symbolic_graph_t* const symbolic_graph = ccv_nnc_symbolic_graph_new();
+	ccv_nnc_tensor_symbol_t t[11];
+	ccv_nnc_tensor_symbol_t r[8];
+	int i;
+	for (i = 0; i < 11; i++)
+		t[i] = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 4, i >= 6 && i <= 8 ? 1 : 4), 0);
+	for (i = 0; i < 8; i++)
+		r[i] = ccv_nnc_tensor_symbol_new(symbolic_graph, (i % 2) ? CPU_TENSOR_NHWC(32F, 1, 4) : CPU_TENSOR_NHWC(32F, 4, 1), 0);
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_REDUCE_SUM_FORWARD(1), TENSOR_SYMBOL_LIST(t[0]), TENSOR_SYMBOL_LIST(r[0]), 0);
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_REDUCE_SUM_FORWARD(0), TENSOR_SYMBOL_LIST(t[0]), TENSOR_SYMBOL_LIST(r[1]), 0);
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_ADD_FORWARD(1, 1), TENSOR_SYMBOL_LIST(r[0], r[1]), TENSOR_SYMBOL_LIST(t[1]), 0);
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_EWEXP_FORWARD(), TENSOR_SYMBOL_LIST(t[0]), TENSOR_SYMBOL_LIST(t[2]), 0);
+	ccv_nnc_tensor_symbol_t t3 = ccv_nnc_tensor_symbol_new(symbolic_graph, CPU_TENSOR_NHWC(32F, 1, 4), 0);
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_REDUCE_SUM_FORWARD(0), TENSOR_SYMBOL_LIST(t[2]), TENSOR_SYMBOL_LIST(t3), 0);
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_REDUCE_SUM_FORWARD(1), TENSOR_SYMBOL_LIST(t[0]), TENSOR_SYMBOL_LIST(r[2]), 0);
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_REDUCE_SUM_FORWARD(0), TENSOR_SYMBOL_LIST(t3), TENSOR_SYMBOL_LIST(r[3]), 0);
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_ADD_FORWARD(1, 1), TENSOR_SYMBOL_LIST(r[2], r[3]), TENSOR_SYMBOL_LIST(t[4]), 0);
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_REDUCE_SUM_FORWARD(1), TENSOR_SYMBOL_LIST(t[1]), TENSOR_SYMBOL_LIST(r[4]), 0);
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_REDUCE_SUM_FORWARD(0), TENSOR_SYMBOL_LIST(t[1]), TENSOR_SYMBOL_LIST(r[5]), 0);
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_ADD_FORWARD(1, 1), TENSOR_SYMBOL_LIST(r[4], r[5]), TENSOR_SYMBOL_LIST(t[5]), 0);
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_REDUCE_SUM_FORWARD(1), TENSOR_SYMBOL_LIST(t[5]), TENSOR_SYMBOL_LIST(t[6]), 0);
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_REDUCE_SUM_FORWARD(1), TENSOR_SYMBOL_LIST(t[5]), TENSOR_SYMBOL_LIST(t[7]), 0);
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_REDUCE_SUM_FORWARD(1), TENSOR_SYMBOL_LIST(t[6]), TENSOR_SYMBOL_LIST(t[8]), 0);
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_EWSUM_FORWARD(), TENSOR_SYMBOL_LIST(t[5], t[4]), TENSOR_SYMBOL_LIST(t[9]), 0);
+	ccv_nnc_graph_exec_symbol_new(symbolic_graph, CMD_EWEXP_FORWARD(), TENSOR_SYMBOL_LIST(t[1]), TENSOR_SYMBOL_LIST(t[10]), 0);
+	ccv_nnc_graph_exec_symbol_autogen(symbolic_graph, 0, 0, CCV_NNC_AUTOGEN_ALL_EXECS | CCV_NNC_AUTOGEN_SOURCES_AND_DESTINATIONS);
+	ccv_nnc_graph_t* graphs[2];
+	ccv_nnc_tensor_arena_t* tensor_arenas[2];
+	ccv_nnc_graph_exec_arena_t* graph_exec_arenas[2];
+	ccv_nnc_symbolic_graph_compile(symbolic_graph, ccv_nnc_default_compile_params, 0, 0, TENSOR_SYMBOL_LIST(t[10], t[5]), SYMBOLIC_GRAPH_SOURCES(symbolic_graph), SYMBOLIC_GRAPH_DESTINATIONS(symbolic_graph), &graphs[0], &tensor_arenas[0], &graph_exec_arenas[0]);
+	ccv_nnc_symbolic_graph_compile_param_t compile_params = ccv_nnc_default_compile_params;
+	compile_params.memory_planner.type = CCV_NNC_MEMORY_PLANNER_PACKING;
+	ccv_nnc_symbolic_graph_compile(symbolic_graph, compile_params, 0, 0, TENSOR_SYMBOL_LIST(t[10], t[5]), SYMBOLIC_GRAPH_SOURCES(symbolic_graph), SYMBOLIC_GRAPH_DESTINATIONS(symbolic_graph), &graphs[1], &tensor_arenas[1], &graph_exec_arenas[1]);
+	const uint64_t greedy_size = ccv_nnc_tensor_arena_size(tensor_arenas[0]);
+	const uint64_t packing_size = ccv_nnc_tensor_arena_size(tensor_arenas[1]);
+	const uint64_t lower_bound = ccv_nnc_tensor_arena_size_lower_bound(tensor_arenas[1]);
+	REQUIRE_EQ(lower_bound, ccv_nnc_tensor_arena_size_lower_bound(tensor_arenas[0]), "the lower bound doesn't depend on the planner");
+	REQUIRE(lower_bound <= greedy_size, "greedy cannot do better than the lower bound");
+	REQUIRE(packing_size <= greedy_size, "packing starts from the greedy planner, cannot be worse");
+	REQUIRE_EQ(packing_size, lower_bound, "packing should reach the lower bound for this graph");
+	dsfmt_t dsfmt;
+	dsfmt_init_gen_rand(&dsfmt, 0);
+	ccv_nnc_tensor_t* const x0 = ccv_nnc_tensor_from_symbol(tensor_arenas[0], t[0]);
+	ccv_nnc_tensor_t* const x1 = ccv_nnc_tensor_from_symbol(tensor_arenas[1], t[0]);
+	for (i = 0; i < 16; i++)
+		x1->data.f32[i] = x0->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) * 0.2;
+	ccv_nnc_graph_run(graphs[0], 0, TRAVERSE_FULL, 0, 0);
+	ccv_nnc_graph_run(graphs[1], 0, TRAVERSE_FULL, 0, 0);
+	REQUIRE_TENSOR_EQ(ccv_nnc_tensor_from_symbol(tensor_arenas[1], t[10]), ccv_nnc_tensor_from_symbol(tensor_arenas[0], t[10]), "both planners should compute the same result");
+	REQUIRE_TENSOR_EQ(ccv_nnc_tensor_from_symbol(tensor_arenas[1], t[5]), ccv_nnc_tensor_from_symbol(tensor_arenas[0], t[5]), "both planners should compute the same result");
+	for (i = 0; i < 2; i++)
+	{
+		ccv_nnc_graph_free(graphs[i]);
+		ccv_nnc_tensor_arena_free(tensor_arenas[i]);
+		ccv_nnc_graph_exec_arena_free(graph_exec_arenas[i]);
+	}
+	ccv_nnc_symbolic_graph_free(symbolic_graph);
+}
+
 #include "case_main.h"
@@ -150,6 +150,89 @@ TEST_CASE("tensor persistence")
 	ccv_nnc_tensor_free(tensor);
 }
 
+TEST_CASE("compressed tensor persistence in batch")
+{
+	sqlite3* handle;
+	remove("tensors.compressed.sqlite3");
+	sqlite3_open("tensors.compressed.sqlite3", &handle);
+	ccv_nnc_tensor_t* const x = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 10, 20, 30), 0);
+	ccv_nnc_tensor_t* const y = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 7), 0);
+	int i;
+	dsfmt_t dsfmt;
+	dsfmt_init_gen_rand(&dsfmt, 1);
+	for (i = 0; i < 10 * 20 * 30; i++)
+		x->data.f32[i] = (int)(dsfmt_genrand_open_close(&dsfmt) * 16) * 0.25;
+	for (i = 0; i < 7; i++)
+		y->data.f32[i] = dsfmt_genrand_open_close(&dsfmt);
+	const ccv_nnc_tensor_t* const tensors[] = { x, y };
+	const char* const names[] = { "x", "y" };
+	REQUIRE_EQ(ccv_nnc_tensors_write(tensors, names, 2, handle, CCV_NNC_TENSOR_WRITE_COMPRESS), CCV_IO_FINAL, "should write both tensors");
+	sqlite3_close(handle);
+	handle = 0;
+	sqlite3_open("tensors.compressed.sqlite3", &handle);
+	ccv_nnc_tensor_t* x1 = 0;
+	REQUIRE_EQ(ccv_nnc_tensor_read(handle, "x", &x1), CCV_IO_FINAL, "should read x");
+	ccv_nnc_tensor_t* y1 = 0;
+	REQUIRE_EQ(ccv_nnc_tensor_read(handle, "y", &y1), CCV_IO_FINAL, "should read y");
+	ccv_nnc_tensor_t* x2 = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(16F, 10, 20, 30), 0);
+	REQUIRE_EQ(ccv_nnc_tensor_read(handle, "x", &x2), CCV_IO_FINAL, "should read x with conversion");
+	sqlite3_close(handle);
+	remove("tensors.compressed.sqlite3");
+	REQUIRE_TENSOR_EQ(x1, x, "x should be restored exactly");
+	REQUIRE_TENSOR_EQ(y1, y, "y should be restored exactly");
+	ccv_nnc_tensor_t* const x3 = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 10, 20, 30), 0);
+	ccv_half_precision_to_float((uint16_t*)x2->data.f16, x3->data.f32, 10 * 20 * 30);
+	REQUIRE_TENSOR_EQ(x3, x, "x should be restored in half precision");
+	ccv_nnc_tensor_free(x1);
+	ccv_nnc_tensor_free(x2);
+	ccv_nnc_tensor_free(x3);
+	ccv_nnc_tensor_free(y1);
+	ccv_nnc_tensor_free(x);
+	ccv_nnc_tensor_free(y);
+}
+
+TEST_CASE("tensor persistence with memory-mapped container")
+{
+	ccv_nnc_tensor_t* const tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 10, 20, 30), 0);
+	ccv_nnc_tensor_t* const small = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 3), 0);
+	int i;
+	dsfmt_t dsfmt;
+	dsfmt_init_gen_rand(&dsfmt, 1);
+	for (i = 0; i < 10 * 20 * 30; i++)
+		tensor->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) * 2 - 1;
+	for (i = 0; i < 3; i++)
+		small->data.f32[i] = i + 1;
+	ccv_nnc_tensor_mmap_writer_t* const writer = ccv_nnc_tensor_mmap_writer_new("tensors.mmap");
+	REQUIRE(writer, "should be able to create the container");
+	REQUIRE_EQ(ccv_nnc_tensor_mmap_write(writer, small, "y"), CCV_IO_FINAL, "should write y");
+	REQUIRE_EQ(ccv_nnc_tensor_mmap_write(writer, tensor, "x"), CCV_IO_FINAL, "should write x");
+	REQUIRE_EQ(ccv_nnc_tensor_mmap_writer_free(writer), CCV_IO_FINAL, "should finish the container");
+	ccv_nnc_tensor_mmap_t* const tensor_mmap = ccv_nnc_tensor_mmap_new("tensors.mmap");
+	REQUIRE(tensor_mmap, "should be able to map the container");
+	ccv_nnc_tensor_t* tensor1 = 0;
+	REQUIRE_EQ(ccv_nnc_tensor_mmap_read(tensor_mmap, "x", &tensor1), CCV_IO_FINAL, "should read x");
+	REQUIRE(tensor1->type & CCV_NO_DATA_ALLOC, "x should point to the mapped pages");
+	REQUIRE_EQ((uintptr_t)tensor1->data.u8 & 4095, 0, "x should be page aligned");
+	ccv_nnc_tensor_t* tensor2 = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 10), 0);
+	REQUIRE_EQ(ccv_nnc_tensor_mmap_read(tensor_mmap, "x", &tensor2), CCV_IO_FINAL, "should read x into an existing tensor");
+	ccv_nnc_tensor_t* tensor3 = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(16F, 3), 0);
+	REQUIRE_EQ(ccv_nnc_tensor_mmap_read(tensor_mmap, "y", &tensor3), CCV_IO_FINAL, "should read y with conversion");
+	ccv_nnc_tensor_t* tensor4 = 0;
+	REQUIRE_NOT_EQ(ccv_nnc_tensor_mmap_read(tensor_mmap, "z", &tensor4), CCV_IO_FINAL, "z doesn't exist");
+	REQUIRE_TENSOR_EQ(tensor1, tensor, "the mapped tensor should equal to the original");
+	REQUIRE_ARRAY_EQ_WITH_TOLERANCE(float, tensor2->data.f32, tensor->data.f32, 10, 1e-5, "the first 10 element should be equal");
+	float y[3];
+	ccv_half_precision_to_float((uint16_t*)tensor3->data.f16, y, 3);
+	REQUIRE_ARRAY_EQ_WITH_TOLERANCE(float, y, small->data.f32, 3, 1e-3, "y should be converted to half precision");
+	ccv_nnc_tensor_free(tensor1);
+	ccv_nnc_tensor_free(tensor2);
+	ccv_nnc_tensor_free(tensor3);
+	ccv_nnc_tensor_mmap_free(tensor_mmap);
+	remove("tensors.mmap");
+	ccv_nnc_tensor_free(small);
+	ccv_nnc_tensor_free(tensor);
+}
+
 TEST_CASE("resize tensor")
 {
 	ccv_nnc_tensor_t* tensor = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 12, 12, 3), 0);
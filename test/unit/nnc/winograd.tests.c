@@ -135,4 +135,101 @@ TEST_CASE("convolutional network of 3x3 on 56x56 with no bias")
 	ccv_nnc_tensor_free(a);
 }
 
+TEST_CASE("convolutional network of 3x3 on 56x56 with packed weights cache")
+{
+	ccv_nnc_tensor_packed_cache_set_limit(64 * 1024 * 1024);
+	ccv_nnc_tensor_t* a = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 56, 56, 128), 0);
+	ccv_nnc_tensor_t* b = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 56, 56, 128), 0);
+	ccv_nnc_cmd_t cmd = CMD_CONVOLUTION_FORWARD(1, 128, 3, 3, 128);
+	ccv_nnc_hint_t hint = ccv_nnc_hint_auto(cmd.info, a->info, b->info);
+	ccv_nnc_tensor_t* w = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 128, 3, 3, 128), 0);
+	ccv_nnc_tensor_t* bias = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 128), 0);
+	// configure the inlets.
+	dsfmt_t dsfmt;
+	dsfmt_init_gen_rand(&dsfmt, 0);
+	int i, j;
+	for (i = 0; i < 128 * 3 * 3 * 128; i++)
+		w->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) / (3 * 3 * 128);
+	for (i = 0; i < 56 * 56 * 128; i++)
+		a->data.f32[i] = dsfmt_genrand_open_close(&dsfmt);
+	for (i = 0; i < 128; i++)
+		bias->data.f32[i] = (float)i / 128;
+	ccv_nnc_tensor_t* c = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 56, 56, 128), 0);
+	for (i = 0; i < 2; i++)
+	{
+		ccv_nnc_cmd_t ref_cmd = cmd;
+		ref_cmd.backend = CCV_NNC_BACKEND_CPU_REF;
+		ccv_nnc_cmd_exec(ref_cmd, hint, 0, TENSOR_LIST(a, w, bias), TENSOR_LIST(b), 0);
+		ccv_nnc_cmd_t opt_cmd = cmd;
+		opt_cmd.backend = CCV_NNC_BACKEND_CPU_OPT;
+		// Run both winograd (2) and direct convolution (0) twice, the second time should use the packed weights.
+		opt_cmd.algorithm = 2; // CCV_NNC_CMD_OPT_CONV_ALGO_WINOGRAD
+		for (j = 0; j < 2; j++)
+		{
+			ccv_nnc_cmd_exec(opt_cmd, hint, 0, TENSOR_LIST(a, w, bias), TENSOR_LIST(c), 0);
+			REQUIRE_TENSOR_EQ(b, c, "56x56 matrix should be exactly the same from reference implementation and winograd.");
+		}
+		opt_cmd.algorithm = 0; // CCV_NNC_CMD_OPT_CONV_ALGO_DC
+		for (j = 0; j < 2; j++)
+		{
+			ccv_nnc_cmd_exec(opt_cmd, hint, 0, TENSOR_LIST(a, w, bias), TENSOR_LIST(c), 0);
+			REQUIRE_TENSOR_EQ(b, c, "56x56 matrix should be exactly the same from reference implementation and direct convolution.");
+		}
+		// Modify the weights directly, the packed weights have to be invalidated.
+		for (j = 0; j < 128 * 3 * 3 * 128; j++)
+			w->data.f32[j] = dsfmt_genrand_open_close(&dsfmt) / (3 * 3 * 128);
+		ccv_nnc_tensor_data_touch(w);
+	}
+	ccv_nnc_tensor_free(c);
+	ccv_nnc_tensor_free(bias);
+	ccv_nnc_tensor_free(w);
+	ccv_nnc_tensor_free(b);
+	ccv_nnc_tensor_free(a);
+	ccv_nnc_tensor_packed_cache_set_limit(0);
+}
+
+TEST_CASE("convolutional network of 3x3 on 56x56 with AVX2 kernels against SSE2 kernels")
+{
+	const int cpu_features = ccv_nnc_cpu_features();
+	ccv_nnc_tensor_t* a = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 56, 56, 67), 0);
+	ccv_nnc_tensor_t* b = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 56, 56, 128), 0);
+	ccv_nnc_cmd_t cmd = CMD_CONVOLUTION_FORWARD(1, 128, 3, 3, 67);
+	ccv_nnc_hint_t hint = ccv_nnc_hint_auto(cmd.info, a->info, b->info);
+	ccv_nnc_tensor_t* w = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 128, 3, 3, 67), 0);
+	ccv_nnc_tensor_t* bias = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 128), 0);
+	dsfmt_t dsfmt;
+	dsfmt_init_gen_rand(&dsfmt, 0);
+	int i;
+	for (i = 0; i < 128 * 3 * 3 * 67; i++)
+		w->data.f32[i] = dsfmt_genrand_open_close(&dsfmt) / (3 * 3 * 67);
+	for (i = 0; i < 56 * 56 * 67; i++)
+		a->data.f32[i] = dsfmt_genrand_open_close(&dsfmt);
+	for (i = 0; i < 128; i++)
+		bias->data.f32[i] = (float)i / 128;
+	ccv_nnc_cmd_exec(cmd, hint, 0, TENSOR_LIST(a, w, bias), TENSOR_LIST(b), 0);
+	ccv_nnc_tensor_t* c = ccv_nnc_tensor_new(0, CPU_TENSOR_NHWC(32F, 56, 56, 128), 0);
+	ccv_nnc_cmd_t opt_cmd = cmd;
+	opt_cmd.backend = CCV_NNC_BACKEND_CPU_OPT;
+	int algorithm;
+	for (algorithm = 0; algorithm < 3; algorithm += 2) // CCV_NNC_CMD_OPT_CONV_ALGO_DC, CCV_NNC_CMD_OPT_CONV_ALGO_WINOGRAD
+	{
+		opt_cmd.algorithm = algorithm;
+		ccv_nnc_set_cpu_features(0);
+		ccv_nnc_cmd_exec(opt_cmd, hint, 0, TENSOR_LIST(a, w, bias), TENSOR_LIST(c), 0);
+		REQUIRE_TENSOR_EQ(b, c, "56x56 matrix should be exactly the same from reference implementation and SSE2 kernel.");
+		ccv_nnc_set_cpu_features(CCV_NNC_CPU_FEATURE_AVX2);
+		ccv_nnc_cmd_exec(opt_cmd, hint, 0, TENSOR_LIST(a, w, bias), TENSOR_LIST(c), 0);
+		REQUIRE_TENSOR_EQ(b, c, "56x56 matrix should be exactly the same from reference implementation and AVX2 kernel.");
+		ccv_nnc_set_cpu_features(CCV_NNC_CPU_FEATURE_AVX2 | CCV_NNC_CPU_FEATURE_AVX512F);
+		ccv_nnc_cmd_exec(opt_cmd, hint, 0, TENSOR_LIST(a, w, bias), TENSOR_LIST(c), 0);
+		REQUIRE_TENSOR_EQ(b, c, "56x56 matrix should be exactly the same from reference implementation and AVX-512 kernel.");
+	}
+	ccv_nnc_set_cpu_features(cpu_features);
+	ccv_nnc_tensor_free(c);
+	ccv_nnc_tensor_free(bias);
+	ccv_nnc_tensor_free(w);
+	ccv_nnc_tensor_free(b);
+	ccv_nnc_tensor_free(a);
+}
+
 #include "case_main.h"